@@ -0,0 +1,90 @@
+# x86 Application Processor Startup Trampoline
+#
+# Copied to SMP_TRAMPOLINE_ADDR (include/kernel/smp.h) by arch/x86/smp.c.
+# A STARTUP IPI starts the AP here in real mode at CS:IP = 0x0800:0000.
+# The code switches to protected mode with a temporary flat GDT, turns on
+# paging with the boot CPU's CR0/CR3/CR4, loads the boot stack and calls
+# the C entry point, all taken from the parameter block at the end.
+#
+# CR0 is copied whole rather than just gaining PG: after INIT it holds
+# 0x60000010, with caching off (CD/NW) and WP clear, which copy-on-write
+# depends on. fpu_init_cpu() redoes the FPU bits (EM/MP/TS/NE) later.
+#
+# Everything is addressed relative to the copy, never to the link address.
+
+.set AP_TRAMPOLINE_BASE, 0x8000
+.set AP_CR0_PE, 0x00000001
+
+.section .text
+
+.code16
+.global ap_trampoline_start
+ap_trampoline_start:
+    cli
+    cld
+    xorw %ax, %ax
+    movw %ax, %ds
+
+    lgdtl AP_TRAMPOLINE_BASE + (ap_gdt_ptr - ap_trampoline_start)
+
+    movl %cr0, %eax
+    orl $AP_CR0_PE, %eax
+    movl %eax, %cr0
+
+    ljmpl $0x08, $(AP_TRAMPOLINE_BASE + (ap_protected - ap_trampoline_start))
+
+.code32
+ap_protected:
+    movw $0x10, %ax
+    movw %ax, %ds
+    movw %ax, %es
+    movw %ax, %fs
+    movw %ax, %gs
+    movw %ax, %ss
+
+    # Same paging setup as the boot CPU (PSE/PGE first, then CR3, then
+    # its CR0, which turns on PG)
+    movl AP_TRAMPOLINE_BASE + (ap_param_cr4 - ap_trampoline_start), %eax
+    movl %eax, %cr4
+    movl AP_TRAMPOLINE_BASE + (ap_param_cr3 - ap_trampoline_start), %eax
+    movl %eax, %cr3
+    movl AP_TRAMPOLINE_BASE + (ap_param_cr0 - ap_trampoline_start), %eax
+    movl %eax, %cr0
+
+    movl AP_TRAMPOLINE_BASE + (ap_param_stack - ap_trampoline_start), %esp
+    xorl %ebp, %ebp
+    pushl $0
+    popf
+
+    movl AP_TRAMPOLINE_BASE + (ap_param_entry - ap_trampoline_start), %eax
+    call *%eax
+
+    # The entry point never returns
+ap_hang:
+    cli
+    hlt
+    jmp ap_hang
+
+# Temporary GDT: kernel code (0x08) and data (0x10), flat 4GB
+.align 8
+ap_gdt:
+    .quad 0x0000000000000000
+    .quad 0x00CF9A000000FFFF
+    .quad 0x00CF92000000FFFF
+ap_gdt_ptr:
+    .word ap_gdt_ptr - ap_gdt - 1
+    .long AP_TRAMPOLINE_BASE + (ap_gdt - ap_trampoline_start)
+
+# Parameter block, filled in by smp.c before each STARTUP IPI
+# (layout must match struct ap_boot_params)
+.align 4
+.global ap_trampoline_params
+ap_trampoline_params:
+ap_param_cr0:   .long 0
+ap_param_cr3:   .long 0
+ap_param_cr4:   .long 0
+ap_param_stack: .long 0
+ap_param_entry: .long 0
+
+.global ap_trampoline_end
+ap_trampoline_end:
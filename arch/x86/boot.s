@@ -2,8 +2,8 @@
 .align 4
 multiboot_header:
     .long 0x1BADB002              # Multiboot magic number
-    .long 0x00000000               # Flags (none - let GRUB provide defaults)
-    .long -(0x1BADB002 + 0x00000000)    # Checksum
+    .long 0x00000001               # Flags: page-align modules (mapped as they are)
+    .long -(0x1BADB002 + 0x00000001)    # Checksum
 
 .section .bss
 .align 16
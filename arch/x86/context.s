@@ -1,10 +1,20 @@
 # x86 Context Switch
 #
-# void context_switch(cpu_context_t* old_ctx, cpu_context_t* new_ctx)
+# uint32_t context_switch(cpu_context_t* old_ctx, cpu_context_t* new_ctx)
 #
 # Saves current CPU state to old_ctx, loads new state from new_ctx.
 # Must match the layout of cpu_context_t in include/kernel/task.h
 #
+# The save is always complete (plain stores are cheap), so any context
+# can later be resumed by either load path. Loading is where the cost
+# is: segment register loads and POPF each take tens of cycles. A
+# ring 0 target whose selectors and system EFLAGS equal the live ones
+# (every kernel-to-kernel switch from schedule()) takes the fast path and
+# only reloads the callee-saved registers, ESP and EIP.
+#
+# Returns (in the resumed task, when it resumes through here) 1 if it
+# was resumed by the fast path, 0 otherwise.
+#
 # cpu_context_t layout (from task.h):
 #   +0:  edi
 #   +4:  esi
@@ -56,9 +66,9 @@ context_switch:
     movl %ecx, 20(%eax)     # Save as EIP
 
     # Save segment registers
-    movw %cs, %cx           # Read CS (16-bit)
+    movl %cs, %ecx          # Read CS (zero-extended)
     movl %ecx, 24(%eax)     # Save CS
-    movw %ss, %cx           # Read SS (16-bit)
+    movl %ss, %ecx          # Read SS (zero-extended)
     movl %ecx, 28(%eax)     # Save SS
     movl %ds, %ecx
     movl %ecx, 32(%eax)     # Save DS
@@ -74,6 +84,41 @@ context_switch:
     popl %ecx               # Pop into ECX
     movl %ecx, 48(%eax)     # Save EFLAGS
 
+    # ============================================
+    # Fast path: ring 0 target, same selectors and EFLAGS
+    # ============================================
+    # EAX (old_ctx) holds the live values we just saved
+    testl $0x03, 24(%edx)   # Target CS RPL != 0?
+    jnz .context_switch_slow
+    xorl 48(%edx), %ecx     # EFLAGS (ECX still holds the live value);
+    testl $0xFFFFF72A, %ecx # arithmetic flags (0x8D5) are call-clobbered
+    jnz .context_switch_slow
+    movl 28(%eax), %ecx     # SS
+    cmpl 28(%edx), %ecx
+    jne .context_switch_slow
+    movl 32(%eax), %ecx     # DS
+    cmpl 32(%edx), %ecx
+    jne .context_switch_slow
+    movl 36(%eax), %ecx     # ES
+    cmpl 36(%edx), %ecx
+    jne .context_switch_slow
+    movl 40(%eax), %ecx     # FS
+    cmpl 40(%edx), %ecx
+    jne .context_switch_slow
+    movl 44(%eax), %ecx     # GS
+    cmpl 44(%edx), %ecx
+    jne .context_switch_slow
+
+    movl 0(%edx), %edi      # Restore EDI
+    movl 4(%edx), %esi      # Restore ESI
+    movl 8(%edx), %ebx      # Restore EBX
+    movl 12(%edx), %ebp     # Restore EBP
+    movl 16(%edx), %esp     # Restore kernel ESP
+    movl $1, %eax           # Resumed by the fast path
+    jmp *20(%edx)           # Jump to target EIP
+
+.context_switch_slow:
+
     # ============================================
     # Load new context from new_ctx
     # ============================================
@@ -149,4 +194,5 @@ context_switch:
 
     # Restore kernel ESP and jump to EIP
     movl 16(%edx), %esp     # Restore kernel ESP
+    xorl %eax, %eax         # Resumed by the full path
     jmp *20(%edx)           # Jump to target EIP
@@ -0,0 +1,53 @@
+/**
+ * x86 CPUID (arch-private header)
+ *
+ * CPUID is serializing (~100+ cycles, far more under a hypervisor):
+ * read it at setup and cache what you need.
+ */
+
+#ifndef ARCH_X86_CPUID_H
+#define ARCH_X86_CPUID_H
+
+#include <kernel/types.h>
+
+// EFLAGS.ID: writable only when the CPU implements CPUID
+#define EFLAGS_ID (1u << 21)
+
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx,
+                         uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(0));
+}
+
+static inline bool cpuid_supported(void) {
+    uint32_t before, after;
+    __asm__ volatile(
+        "pushf\n"
+        "pop %0\n"
+        "mov %0, %1\n"
+        "xor %2, %1\n"
+        "push %1\n"
+        "popf\n"
+        "pushf\n"
+        "pop %1\n"
+        "push %0\n"
+        "popf\n"
+        : "=&r"(before), "=&r"(after)
+        : "i"(EFLAGS_ID)
+        : "cc"
+    );
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+// Highest basic leaf (0 if CPUID is missing)
+static inline uint32_t cpuid_max_leaf(void) {
+    uint32_t max_leaf, ebx, ecx, edx;
+    if (!cpuid_supported()) {
+        return 0;
+    }
+    cpuid(0, &max_leaf, &ebx, &ecx, &edx);
+    return max_leaf;
+}
+
+#endif // ARCH_X86_CPUID_H
@@ -0,0 +1,167 @@
+/**
+ * x86 Lazy FPU/SSE Switching
+ *
+ * CR0.TS makes the next x87/MMX/SSE instruction raise #NM (vector 7);
+ * see include/kernel/fpu.h. CPUs without FXSR fall back to FNSAVE/FRSTOR
+ * (x87 state only).
+ */
+
+#include <kernel/fpu.h>
+#include <kernel/hal.h>
+#include <kernel/idt.h>
+#include <kernel/percpu.h>
+#include <kernel/task.h>
+#include <kernel/slab.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+#define CR0_MP  (1u << 1)   // WAIT honours TS
+#define CR0_EM  (1u << 2)   // No FPU: emulate (must be clear)
+#define CR0_TS  (1u << 3)   // Task switched: FPU use traps
+#define CR0_NE  (1u << 5)   // Native FPU error reporting
+
+#define CR4_OSFXSR      (1u << 9)   // FXSAVE/FXRSTOR and SSE enabled
+#define CR4_OSXMMEXCPT  (1u << 10)  // Unmasked SIMD exceptions raise #XM
+
+#define MXCSR_DEFAULT   0x1F80      // All SIMD exceptions masked
+
+#define FPU_VECTOR_NM   7           // Device not available
+
+static bool use_fxsr;
+static bool use_sse;
+
+// Clean state given to each task on its first FPU use
+static struct fpu_state fpu_initial_state;
+
+static inline uint32_t read_cr0(void) {
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void write_cr0(uint32_t cr0) {
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t cr4;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static inline void write_cr4(uint32_t cr4) {
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+static inline void fpu_save(struct fpu_state* st) {
+    if (use_fxsr) {
+        __asm__ volatile("fxsave %0" : "=m"(*st));
+    } else {
+        __asm__ volatile("fnsave %0\n\tfwait" : "=m"(*st));
+    }
+}
+
+static inline void fpu_restore(const struct fpu_state* st) {
+    if (use_fxsr) {
+        __asm__ volatile("fxrstor %0" : : "m"(*st));
+    } else {
+        __asm__ volatile("frstor %0" : : "m"(*st));
+    }
+}
+
+/**
+ * Device-not-available (#NM): load the current task's FPU state
+ *
+ * Runs with interrupts off, in whatever context touched the FPU.
+ */
+static void fpu_nm_handler(struct interrupt_frame* frame) {
+    struct per_cpu_data* cpu = this_cpu();
+    task_t* current = cpu->current_task;
+
+    __asm__ volatile("clts");
+    if (!current || cpu->fpu_owner == current) {
+        return;  // Before tasks exist, or state already loaded
+    }
+
+    if (!current->fpu) {
+        current->fpu = kmalloc(sizeof(struct fpu_state));
+        if (!current->fpu) {
+            kprintf("[FPU] No memory for task '%s' FPU state\n", current->name);
+            idt_dump_frame(frame);
+            hal->panic("Out of memory for FPU state");
+        }
+        memcpy(current->fpu, &fpu_initial_state, sizeof(struct fpu_state));
+    }
+
+    if (cpu->fpu_owner) {
+        fpu_save(cpu->fpu_owner->fpu);
+    }
+    fpu_restore(current->fpu);
+    cpu->fpu_owner = current;
+}
+
+// Enable the FPU (and SSE) on this CPU, leaving it reset and trapping
+static void fpu_setup_cpu(bool capture_initial) {
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    if (use_fxsr) {
+        write_cr4(read_cr4() | CR4_OSFXSR | (use_sse ? CR4_OSXMMEXCPT : 0));
+    }
+
+    __asm__ volatile("fninit");
+    if (use_sse) {
+        uint32_t mxcsr = MXCSR_DEFAULT;
+        __asm__ volatile("ldmxcsr %0" : : "m"(mxcsr));
+    }
+    if (capture_initial) {
+        fpu_save(&fpu_initial_state);
+    }
+
+    this_cpu()->fpu_owner = NULL;
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+void fpu_init(void) {
+    uint32_t features = hal->cpu_features();
+    use_fxsr = (features & HAL_CPU_FEAT_FXSR) != 0;
+    use_sse = use_fxsr && (features & HAL_CPU_FEAT_SSE);
+
+    fpu_setup_cpu(true);
+    idt_register_handler(FPU_VECTOR_NM, fpu_nm_handler);
+
+    kprintf("[FPU] Lazy FPU switching enabled (%s)\n",
+            use_sse ? "FXSAVE, SSE" : (use_fxsr ? "FXSAVE" : "FNSAVE, x87 only"));
+}
+
+void fpu_init_cpu(void) {
+    fpu_setup_cpu(false);
+}
+
+/**
+ * Trap on the next FPU use unless `next` owns the loaded state
+ *
+ * RT: O(1), a CR0 read plus at most one write
+ */
+void fpu_switch(task_t* next) {
+    uint32_t cr0 = read_cr0();
+    uint32_t want = (this_cpu()->fpu_owner == next) ? (cr0 & ~CR0_TS) : (cr0 | CR0_TS);
+    if (want != cr0) {
+        write_cr0(want);
+    }
+}
+
+void fpu_task_release(task_t* task) {
+    uint32_t ncpus = hal->smp_num_cpus();
+    for (uint32_t id = 0; id < ncpus && id < MAX_CPUS; id++) {
+        // Registers are not saved anywhere once the owner is forgotten
+        __sync_bool_compare_and_swap(&per_cpu[id]->fpu_owner, task, NULL);
+    }
+
+    if (task->fpu) {
+        kfree(task->fpu);
+        task->fpu = NULL;
+    }
+}
+
+bool fpu_is_enabled(void) {
+    return (read_cr0() & CR0_TS) == 0;
+}
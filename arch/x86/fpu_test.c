@@ -0,0 +1,41 @@
+/**
+ * Unit tests for lazy FPU switching
+ *
+ * These tests touch the x87 unit from the bootstrap context, so the real
+ * #NM handler in arch/x86/fpu.c hands it the FPU.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/fpu.h>
+#include <kernel/hal.h>
+#include <kernel/task.h>
+#include <kernel/percpu.h>
+
+// Test: first FPU use traps once, then the state stays with the task
+static int test_fpu_lazy_trap(void) {
+    task_t* self = this_cpu()->current_task;
+    task_t* other = this_cpu()->idle_task;
+
+    // Pretend another task ran: its switch leaves the FPU trapping
+    fpu_switch(other);
+    KTEST_ASSERT(!fpu_is_enabled(), "FPU traps after switching away");
+
+    uint16_t status;
+    __asm__ volatile("fld1\n\tfstp %%st(0)\n\tfnstsw %0" : "=m"(status));
+
+    KTEST_ASSERT(fpu_is_enabled(), "#NM handler enabled the FPU");
+    KTEST_ASSERT(this_cpu()->fpu_owner == self, "task owns the FPU");
+    KTEST_ASSERT_NOT_NULL(self->fpu, "FPU area allocated on first use");
+    KTEST_ASSERT_EQ((uintptr_t)self->fpu & 15, 0, "FPU area 16-byte aligned");
+
+    // Switching back to the owner needs no trap
+    fpu_switch(other);
+    KTEST_ASSERT(!fpu_is_enabled(), "non-owner traps");
+    fpu_switch(self);
+    KTEST_ASSERT(fpu_is_enabled(), "owner's state still loaded");
+
+    return KTEST_PASS;
+}
+
+// Register all tests
+KTEST_DEFINE("fpu", fpu_lazy_trap, test_fpu_lazy_trap);
@@ -2,10 +2,13 @@
  * x86 Global Descriptor Table (GDT) Implementation
  *
  * Sets up flat memory model with ring 0 (kernel) and ring 3 (user) segments.
- * Includes TSS for syscall stack switching.
+ * Includes one TSS per CPU for syscall stack switching; all CPUs share
+ * the descriptor table itself.
  */
 
 #include <kernel/gdt.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
 #include <kernel/types.h>
 #include <drivers/vga.h>
 
@@ -69,11 +72,13 @@ typedef struct {
 
 // ========== GDT Data ==========
 
-#define GDT_ENTRIES 6
+// Entries 0-4: null + flat segments, then one TSS descriptor per CPU
+#define GDT_TSS_FIRST 5
+#define GDT_ENTRIES   (GDT_TSS_FIRST + MAX_CPUS)
 
 static gdt_descriptor_t gdt[GDT_ENTRIES];
 static gdt_ptr_t gdt_ptr;
-static tss_t tss;
+static tss_t tss[MAX_CPUS];
 
 // ========== Access Byte Flags ==========
 
@@ -148,17 +153,49 @@ __asm__(
 
 /**
  * Load TSS (assembly helper)
+ *
+ * @param selector TSS selector for the calling CPU
  */
-extern void tss_flush(void);
+extern void tss_flush(uint32_t selector);
 
 __asm__(
     ".global tss_flush\n"
     "tss_flush:\n"
-    "    movw $0x28, %ax\n"            // TSS segment (entry 5)
+    "    movl 4(%esp), %eax\n"         // TSS selector from stack
     "    ltr %ax\n"                     // Load Task Register
     "    ret\n"
 );
 
+static inline uint32_t tss_selector(uint32_t cpu_id) {
+    return GDT_TSS_SEL + cpu_id * sizeof(gdt_descriptor_t);
+}
+
+/**
+ * Reset a CPU's TSS and write its descriptor
+ */
+static void tss_install(uint32_t cpu_id) {
+    tss_t* t = &tss[cpu_id];
+
+    // Clear TSS first
+    for (size_t i = 0; i < sizeof(*t); i++) {
+        ((uint8_t*)t)[i] = 0;
+    }
+
+    // Set TSS fields
+    t->ss0 = GDT_KERNEL_DATA_SEL;  // Kernel data segment for stack
+    t->esp0 = 0;  // Will be updated by gdt_set_kernel_stack()
+    t->iomap_base = sizeof(*t);    // No I/O permission bitmap
+
+    // TSS descriptor: base = address of TSS, limit = size of TSS - 1
+    // (system descriptor, ring 0, available TSS type=0x09)
+    uint32_t tss_base = (uint32_t)t;
+    uint32_t tss_limit = sizeof(*t) - 1;
+    uint8_t tss_access = GDT_ACCESS_PRESENT | GDT_ACCESS_DPL_0 | 0x09;  // Type 9 = Available TSS
+    uint8_t tss_gran = 0;  // Byte granularity (not 4KB)
+    encode_gdt_descriptor(&gdt[GDT_TSS_FIRST + cpu_id], tss_base, tss_limit,
+                          tss_access, tss_gran);
+}
+
 // ========== Public API ==========
 
 /**
@@ -197,23 +234,8 @@ void gdt_init(void) {
     uint8_t user_data_gran = GDT_GRAN_4K | GDT_GRAN_32BIT;
     encode_gdt_descriptor(&gdt[4], 0, 0xFFFFF, user_data_access, user_data_gran);
 
-    // Entry 5: TSS (system descriptor, ring 0, available TSS type=0x09)
-    // Clear TSS first
-    for (size_t i = 0; i < sizeof(tss); i++) {
-        ((uint8_t*)&tss)[i] = 0;
-    }
-
-    // Set TSS fields
-    tss.ss0 = GDT_KERNEL_DATA_SEL;  // Kernel data segment for stack
-    tss.esp0 = 0;  // Will be updated by gdt_set_kernel_stack()
-    tss.iomap_base = sizeof(tss);   // No I/O permission bitmap
-
-    // TSS descriptor: base = address of TSS, limit = size of TSS - 1
-    uint32_t tss_base = (uint32_t)&tss;
-    uint32_t tss_limit = sizeof(tss) - 1;
-    uint8_t tss_access = GDT_ACCESS_PRESENT | GDT_ACCESS_DPL_0 | 0x09;  // Type 9 = Available TSS
-    uint8_t tss_gran = 0;  // Byte granularity (not 4KB)
-    encode_gdt_descriptor(&gdt[5], tss_base, tss_limit, tss_access, tss_gran);
+    // Entry 5: boot CPU's TSS (APs add theirs in gdt_init_cpu())
+    tss_install(0);
 
     // Set up GDT pointer
     gdt_ptr.limit = sizeof(gdt) - 1;
@@ -223,7 +245,20 @@ void gdt_init(void) {
     gdt_flush((uint32_t)&gdt_ptr);
 
     // Load TSS
-    tss_flush();
+    tss_flush(tss_selector(0));
+}
+
+/**
+ * Load the shared GDT and a private TSS on an application processor
+ */
+void gdt_init_cpu(uint32_t cpu_id) {
+    if (cpu_id == 0 || cpu_id >= MAX_CPUS) {
+        return;
+    }
+
+    tss_install(cpu_id);
+    gdt_flush((uint32_t)&gdt_ptr);
+    tss_flush(tss_selector(cpu_id));
 }
 
 /**
@@ -234,6 +269,8 @@ void gdt_init(void) {
  */
 void gdt_verify(void) {
     uint16_t cs, ds, ss, tr;
+    uint32_t cpu_id = hal->cpu_id();
+    uint16_t tr_expected = (uint16_t)tss_selector(cpu_id);
 
     // Read current segment registers
     __asm__ volatile("mov %%cs, %0" : "=r"(cs));
@@ -252,27 +289,37 @@ void gdt_verify(void) {
             (unsigned int)ss, (unsigned int)GDT_KERNEL_DATA_SEL,
             ss == GDT_KERNEL_DATA_SEL ? "OK" : "FAIL");
     kprintf("[GDT]   TR = 0x%04x (expected 0x%04x) %s\n",
-            (unsigned int)tr, (unsigned int)GDT_TSS_SEL,
-            tr == GDT_TSS_SEL ? "OK" : "FAIL");
+            (unsigned int)tr, (unsigned int)tr_expected,
+            tr == tr_expected ? "OK" : "FAIL");
 
     kprintf("[GDT] TSS base: 0x%08lx, limit: %u bytes, ESP0: 0x%08lx\n",
-            (unsigned long)&tss, (unsigned int)sizeof(tss),
-            (unsigned long)tss.esp0);
+            (unsigned long)&tss[cpu_id], (unsigned int)sizeof(tss[cpu_id]),
+            (unsigned long)tss[cpu_id].esp0);
 
     // Verify all passed
     if (cs == GDT_KERNEL_CODE_SEL && ds == GDT_KERNEL_DATA_SEL &&
-        ss == GDT_KERNEL_DATA_SEL && tr == GDT_TSS_SEL) {
+        ss == GDT_KERNEL_DATA_SEL && tr == tr_expected) {
         kprintf("[GDT] All segment registers correct!\n");
     } else {
         kprintf("[GDT] ERROR: Segment register mismatch!\n");
     }
 }
 
+/**
+ * Address of a CPU's TSS.esp0 (the SYSENTER entry stack points here)
+ */
+uintptr_t gdt_kernel_stack_slot(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS) {
+        return 0;
+    }
+    return (uintptr_t)&tss[cpu_id].esp0;
+}
+
 /**
  * Set kernel stack pointer for syscalls
  *
  * MUST be called in context_switch() before switching to a new task.
  */
 void gdt_set_kernel_stack(uintptr_t esp0) {
-    tss.esp0 = esp0;
+    tss[hal->cpu_id()].esp0 = esp0;
 }
@@ -1,17 +1,77 @@
 // x86 Hardware Abstraction Layer Implementation
 
 #include <kernel/hal.h>
+#include <kernel/mmu.h>
 #include <kernel/types.h>
+#include "cpuid.h"
 
-// CPU feature detection using CPUID
+// CPUID leaf 1 EDX feature bits
+#define CPUID_EDX_FPU   (1u << 0)
+#define CPUID_EDX_PSE   (1u << 3)
+#define CPUID_EDX_PAE   (1u << 6)
+#define CPUID_EDX_APIC  (1u << 9)
+#define CPUID_EDX_SEP   (1u << 11)
+#define CPUID_EDX_PGE   (1u << 13)
+#define CPUID_EDX_FXSR  (1u << 24)
+#define CPUID_EDX_SSE   (1u << 25)
+#define CPUID_EDX_SSE2  (1u << 26)
+
+// CPUID leaf 1 ECX feature bits
+#define CPUID_ECX_MONITOR (1u << 3)
+
+// CPUID leaf 5 (MONITOR/MWAIT) ECX bits
+#define CPUID_MWAIT_ECX_EMX (1u << 0)   // Leaf 5 extensions enumerated
+
+// CPUID leaf 0x80000001 EDX feature bits
+#define CPUID_EXT_EDX_RDTSCP (1u << 27)
+
+// CPU feature detection using CPUID (cached after the first call)
 static uint32_t detect_cpu_features(void) {
-    uint32_t features = 0;
+    static uint32_t features;
+    static bool detected = false;
 
-    // TODO: Check if CPUID is supported and use it
-    // For now, assume basic features
+    if (detected) {
+        return features;
+    }
 
-    features |= HAL_CPU_FEAT_FPU;   // x86 always has FPU
+    features = HAL_CPU_FEAT_FPU;   // x86 always has FPU
+
+    if (cpuid_supported()) {
+        uint32_t max_leaf, ebx, ecx, edx;
+        cpuid(0, &max_leaf, &ebx, &ecx, &edx);
+
+        if (max_leaf >= 1) {
+            uint32_t eax;
+            cpuid(1, &eax, &ebx, &ecx, &edx);
+
+            if (edx & CPUID_EDX_PSE)  features |= HAL_CPU_FEAT_PSE;
+            if (edx & CPUID_EDX_PAE)  features |= HAL_CPU_FEAT_PAE;
+            if (edx & CPUID_EDX_APIC) features |= HAL_CPU_FEAT_APIC;
+            if (edx & CPUID_EDX_SEP)  features |= HAL_CPU_FEAT_SEP;
+            if (edx & CPUID_EDX_PGE)  features |= HAL_CPU_FEAT_PGE;
+            if (edx & CPUID_EDX_FXSR) features |= HAL_CPU_FEAT_FXSR;
+            if (edx & CPUID_EDX_SSE)  features |= HAL_CPU_FEAT_SSE;
+            if (edx & CPUID_EDX_SSE2) features |= HAL_CPU_FEAT_SSE2;
+
+            // Used only when leaf 5 describes it as well
+            if ((ecx & CPUID_ECX_MONITOR) && max_leaf >= 5) {
+                uint32_t mwait_ecx;
+                cpuid(5, &eax, &ebx, &mwait_ecx, &edx);
+                if (mwait_ecx & CPUID_MWAIT_ECX_EMX) {
+                    features |= HAL_CPU_FEAT_MWAIT;
+                }
+            }
+        }
+
+        uint32_t max_ext, eax;
+        cpuid(0x80000000, &max_ext, &ebx, &ecx, &edx);
+        if (max_ext >= 0x80000001) {
+            cpuid(0x80000001, &eax, &ebx, &ecx, &edx);
+            if (edx & CPUID_EXT_EDX_RDTSCP) features |= HAL_CPU_FEAT_RDTSCP;
+        }
+    }
 
+    detected = true;
     return features;
 }
 
@@ -20,6 +80,7 @@ static uint32_t detect_cpu_features(void) {
 // Forward declarations
 extern void gdt_init(void);
 extern void idt_init(void);
+extern void x86_string_init(void);
 
 static void cpu_init(void) {
     // Initialize GDT (Global Descriptor Table)
@@ -28,18 +89,42 @@ static void cpu_init(void) {
 
     // Initialize IDT (Interrupt Descriptor Table)
     idt_init();
+
+    // Page zero/copy variants for this CPU (before anything allocates)
+    x86_string_init();
 }
 
+// Forward declarations from smp.c
+extern uint32_t x86_smp_detect(void);
+extern uint32_t x86_smp_cpu_id(void);
+extern uint32_t x86_smp_num_cpus(void);
+extern void x86_smp_send_ipi(uint32_t cpu_id, uint8_t vector);
+extern void x86_smp_broadcast_ipi(uint8_t vector);
+extern int x86_smp_boot_cpu(uint32_t cpu_id, void (*entry_point)(void));
+
 static uint32_t cpu_id(void) {
-    // For single-CPU system, always return 0
-    // TODO: Read from APIC for SMP systems
-    return 0;
+    // LAPIC ID register -> logical ID (0 until the LAPIC is mapped)
+    return x86_smp_cpu_id();
 }
 
 static void cpu_halt(void) {
     __asm__ volatile("hlt");
 }
 
+static void cpu_idle_halt(void) {
+    // STI holds interrupts off for one more instruction
+    __asm__ volatile("sti; hlt" : : : "memory");
+}
+
+static void cpu_monitor(const volatile void* addr) {
+    __asm__ volatile("monitor" : : "a"(addr), "c"(0), "d"(0) : "memory");
+}
+
+static void cpu_mwait(uint32_t hint) {
+    // Same STI shadow as cpu_idle_halt(): MWAIT starts before any interrupt
+    __asm__ volatile("sti; mwait" : : "a"(hint), "c"(0) : "memory");
+}
+
 static uint32_t cpu_features(void) {
     return detect_cpu_features();
 }
@@ -82,7 +167,7 @@ static void irq_unregister(uint8_t vector) {
 
 // ========== Memory Management ==========
 
-static void mmu_init(void) {
+static void hal_mmu_init(void) {
     // TODO: Initialize paging
     // For now, we're using identity mapping from boot.s
 }
@@ -148,10 +233,19 @@ static void io_outl(uint16_t port, uint32_t value) {
 }
 
 static void* mmio_map(phys_addr_t phys, size_t size) {
-    (void)size;
-    // TODO: Map physical address to virtual address with caching disabled
-    // For now, return identity mapping
-    return (void*)phys;
+    // Identity-map the range uncached into the (shared) kernel address space
+    page_table_t* kernel = mmu_get_kernel_address_space();
+    if (!kernel || size == 0) {
+        return NULL;
+    }
+
+    phys_addr_t start = PAGE_ALIGN_DOWN(phys);
+    size_t len = PAGE_ALIGN_UP(phys + size) - start;
+    if (mmu_map_range(kernel, start, start, len,
+                      MMU_PRESENT | MMU_WRITABLE | MMU_NOCACHE | MMU_GLOBAL) < 0) {
+        return NULL;
+    }
+    return (void*)(uintptr_t)phys;
 }
 
 static void mmio_unmap(void* virt, size_t size) {
@@ -162,33 +256,31 @@ static void mmio_unmap(void* virt, size_t size) {
 
 // ========== SMP Operations ==========
 
+static uint32_t smp_detect(void) {
+    return x86_smp_detect();
+}
+
 static uint32_t smp_num_cpus(void) {
-    // TODO: Detect number of CPUs via ACPI/MP tables
-    return 1;  // Single CPU for now
+    return x86_smp_num_cpus();
 }
 
 static void smp_send_ipi(uint32_t cpu_id, uint8_t vector) {
-    (void)cpu_id;
-    (void)vector;
-    // TODO: Implement via APIC
+    x86_smp_send_ipi(cpu_id, vector);
 }
 
 static void smp_broadcast_ipi(uint8_t vector) {
-    (void)vector;
-    // TODO: Implement via APIC
+    x86_smp_broadcast_ipi(vector);
 }
 
 static int smp_boot_cpu(uint32_t cpu_id, void (*entry_point)(void)) {
-    (void)cpu_id;
-    (void)entry_point;
-    // TODO: Implement AP (Application Processor) boot
-    return -ENODEV;
+    return x86_smp_boot_cpu(cpu_id, entry_point);
 }
 
 // ========== Timer Operations ==========
 
 // Forward declarations from timer.c
 extern void timer_init(uint32_t frequency_hz);
+extern int timer_init_ap(uint32_t frequency_hz);
 extern uint64_t timer_read_tsc(void);
 extern uint64_t timer_read_us(void);
 
@@ -202,7 +294,12 @@ static uint64_t hal_timer_read_us(void) {
 }
 
 static void hal_timer_init(uint32_t frequency_hz) {
-    timer_init(frequency_hz);
+    // The PIT drives the boot CPU; APs use their local APIC timer
+    if (cpu_id() == 0) {
+        timer_init(frequency_hz);
+    } else {
+        timer_init_ap(frequency_hz);
+    }
 }
 
 // ========== Special Operations ==========
@@ -211,8 +308,12 @@ static void system_reboot(void) {
     // Use keyboard controller to reboot
     io_outb(0x64, 0xFE);
 
-    // If that didn't work, triple fault
-    __asm__ volatile("int $0xFF");
+    // If that didn't work, triple fault: load an empty IDT and trap
+    static const struct {
+        uint16_t limit;
+        uint32_t base;
+    } __attribute__((packed)) null_idt = { 0, 0 };
+    __asm__ volatile("lidt %0\nint $3" : : "m"(null_idt));
 }
 
 static void system_shutdown(void) {
@@ -240,6 +341,9 @@ static struct hal_ops x86_hal = {
     .cpu_init = cpu_init,
     .cpu_id = cpu_id,
     .cpu_halt = cpu_halt,
+    .cpu_idle_halt = cpu_idle_halt,
+    .cpu_monitor = cpu_monitor,
+    .cpu_mwait = cpu_mwait,
     .cpu_features = cpu_features,
 
     // Interrupts
@@ -250,7 +354,7 @@ static struct hal_ops x86_hal = {
     .irq_unregister = irq_unregister,
 
     // Memory
-    .mmu_init = mmu_init,
+    .mmu_init = hal_mmu_init,
     .mmu_map = mmu_map,
     .mmu_unmap = mmu_unmap,
     .mmu_flush_tlb = mmu_flush_tlb,
@@ -267,6 +371,7 @@ static struct hal_ops x86_hal = {
     .mmio_unmap = mmio_unmap,
 
     // SMP
+    .smp_detect = smp_detect,
     .smp_num_cpus = smp_num_cpus,
     .smp_send_ipi = smp_send_ipi,
     .smp_broadcast_ipi = smp_broadcast_ipi,
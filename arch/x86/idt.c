@@ -3,6 +3,11 @@
 #include <kernel/hal.h>
 #include <kernel/types.h>
 #include <kernel/idt.h>
+#include <kernel/lapic.h>
+#include <kernel/smp.h>
+#include <kernel/trace.h>
+#include <kernel/percpu.h>
+#include <kernel/work.h>
 #include <stdint.h>
 
 // IDT entry structure
@@ -80,6 +85,12 @@ extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
 
+// Local APIC vectors
+extern void lapic_isr_timer(void);
+extern void lapic_isr_resched(void);
+extern void lapic_isr_work(void);
+extern void lapic_isr_spurious(void);
+
 // Set an IDT entry
 static void idt_set_gate(uint8_t num, uint32_t handler, uint16_t selector, uint8_t flags) {
     idt[num].offset_low = handler & 0xFFFF;
@@ -182,6 +193,12 @@ void idt_init(void) {
     idt_set_gate(46, (uint32_t)irq14, 0x08, 0x8E);
     idt_set_gate(47, (uint32_t)irq15, 0x08, 0x8E);
 
+    // Install local APIC vectors (timer, IPIs, spurious)
+    idt_set_gate(LAPIC_TIMER_VECTOR, (uint32_t)lapic_isr_timer, 0x08, 0x8E);
+    idt_set_gate(SMP_IPI_RESCHEDULE, (uint32_t)lapic_isr_resched, 0x08, 0x8E);
+    idt_set_gate(SMP_IPI_WORK, (uint32_t)lapic_isr_work, 0x08, 0x8E);
+    idt_set_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t)lapic_isr_spurious, 0x08, 0x8E);
+
     // Install syscall handler (INT 0x80)
     // CRITICAL: Use 0xEE (DPL=3, interrupt gate) to allow ring 3 calls
     // 0x8E would be DPL=0 and block userspace with #GP
@@ -189,6 +206,11 @@ void idt_init(void) {
     idt_set_gate(0x80, (uint32_t)syscall_entry_int80, 0x08, 0xEE);
 
     // Load IDT
+    idt_load();
+}
+
+// Load the shared IDT on the calling CPU
+void idt_load(void) {
     __asm__ volatile("lidt %0" : : "m"(idtr));
 }
 
@@ -238,6 +260,20 @@ static const char* exception_messages[] = {
     "Reserved"
 };
 
+// Print an exception frame (used before panicking on a fatal exception)
+void idt_dump_frame(const struct interrupt_frame* frame) {
+    extern int kprintf(const char* fmt, ...);
+
+    const char* name = (frame->int_no < 32) ? exception_messages[frame->int_no] : "Interrupt";
+    kprintf("\n*** EXCEPTION: %s ***\n", name);
+    kprintf("INT=%u ERR=%u\n", frame->int_no, frame->err_code);
+    kprintf("EIP=%08x CS=%04x EFLAGS=%08x\n", frame->eip, frame->cs, frame->eflags);
+    kprintf("EAX=%08x EBX=%08x ECX=%08x EDX=%08x\n",
+            frame->eax, frame->ebx, frame->ecx, frame->edx);
+    kprintf("ESP=%08x EBP=%08x ESI=%08x EDI=%08x\n",
+            frame->esp, frame->ebp, frame->esi, frame->edi);
+}
+
 // Common ISR handler (called from assembly stubs)
 void isr_handler(struct interrupt_frame* frame) {
     // Call registered handler if exists
@@ -247,34 +283,51 @@ void isr_handler(struct interrupt_frame* frame) {
     }
 
     // Unhandled exception - panic
-    extern int kprintf(const char* fmt, ...);
     extern void kernel_panic(const char* msg);
 
-    kprintf("\n*** EXCEPTION: %s ***\n", exception_messages[frame->int_no]);
-    kprintf("INT=%u ERR=%u\n", frame->int_no, frame->err_code);
-    kprintf("EIP=%08x CS=%04x EFLAGS=%08x\n", frame->eip, frame->cs, frame->eflags);
-    kprintf("EAX=%08x EBX=%08x ECX=%08x EDX=%08x\n",
-            frame->eax, frame->ebx, frame->ecx, frame->edx);
-    kprintf("ESP=%08x EBP=%08x ESI=%08x EDI=%08x\n",
-            frame->esp, frame->ebp, frame->esi, frame->edi);
-
+    idt_dump_frame(frame);
     kernel_panic("Unhandled exception");
 }
 
 // Common IRQ handler (called from assembly stubs)
 void irq_handler(struct interrupt_frame* frame) {
+    uint64_t trace_start = 0;
+    if (trace_enabled(TRACE_INTERRUPT_EXIT)) {
+        trace_start = hal->timer_read_tsc();
+    }
+    trace_point(TRACE_INTERRUPT, frame->int_no, 0, 0, 0);
+
+    struct per_cpu_data* cpu = this_cpu();
+    cpu->irq_depth++;
+
     // Call registered handler if exists
     if (interrupt_handlers[frame->int_no]) {
         interrupt_handlers[frame->int_no](frame);
     }
 
-    // Send EOI (End Of Interrupt) to PIC
-    if (frame->int_no >= 40) {
-        // Slave PIC
-        hal->io_outb(0xA0, 0x20);
+    // Send EOI (End Of Interrupt) to whichever controller raised it
+    if (frame->int_no >= LAPIC_VECTOR_FIRST || ioapic_active()) {
+        // Local APIC, which also acknowledges I/O APIC inputs (spurious
+        // interrupts must not be acknowledged)
+        if (frame->int_no != LAPIC_SPURIOUS_VECTOR) {
+            lapic_eoi();
+        }
+    } else {
+        if (frame->int_no >= 40) {
+            // Slave PIC
+            hal->io_outb(0xA0, 0x20);
+        }
+        // Master PIC
+        hal->io_outb(0x20, 0x20);
     }
-    // Master PIC
-    hal->io_outb(0x20, 0x20);
+
+    trace_point(TRACE_INTERRUPT_EXIT, frame->int_no,
+                trace_start ? hal->timer_read_tsc() - trace_start : 0, 0, 0);
+
+    // Bottom halves: the controller has been acknowledged, so they can
+    // run with interrupts on
+    cpu->irq_depth--;
+    work_irq_exit();
 
     // Check if we need to reschedule (for preemptive scheduling)
     extern bool scheduler_need_resched(void);
@@ -30,6 +30,15 @@ irq\irq_num:
     jmp irq_common_stub
 .endm
 
+# Macro for vectors raised by the local APIC (acknowledged via LAPIC EOI)
+.macro LAPIC_IRQ num, name
+.global lapic_isr_\name
+lapic_isr_\name:
+    pushl $0                    # Push dummy error code
+    pushl $\num                 # Push interrupt number
+    jmp irq_common_stub
+.endm
+
 # CPU exception handlers (0-31)
 ISR_NOERRCODE 0                 # Divide by zero
 ISR_NOERRCODE 1                 # Debug
@@ -82,6 +91,12 @@ IRQ 45, 13                      # FPU
 IRQ 46, 14                      # Primary ATA
 IRQ 47, 15                      # Secondary ATA
 
+# Local APIC vectors (see include/kernel/lapic.h, include/kernel/smp.h)
+LAPIC_IRQ 239, timer            # LAPIC_TIMER_VECTOR
+LAPIC_IRQ 240, resched          # SMP_IPI_RESCHEDULE
+LAPIC_IRQ 241, work             # SMP_IPI_WORK
+LAPIC_IRQ 255, spurious         # LAPIC_SPURIOUS_VECTOR
+
 # Common ISR stub - saves all registers and calls C handler
 isr_common_stub:
     # Save all general-purpose registers in the order our struct expects
@@ -115,6 +130,9 @@ isr_common_stub:
     movw %ax, %fs
     movw %ax, %gs
 
+    # C code assumes DF = 0 (rep movs/stos in lib memcpy/memset)
+    cld
+
     # Call C handler
     pushl %esp                  # Push pointer to interrupt_frame
     call isr_handler
@@ -171,6 +189,9 @@ irq_common_stub:
     movw %ax, %fs
     movw %ax, %gs
 
+    # C code assumes DF = 0 (rep movs/stos in lib memcpy/memset)
+    cld
+
     # Call C handler
     pushl %esp
     call irq_handler
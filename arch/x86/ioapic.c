@@ -0,0 +1,197 @@
+/**
+ * x86 I/O APIC Driver
+ *
+ * Redirection table programming for the ISA IRQs (see
+ * include/kernel/ioapic.h). Registers are reached through an index
+ * (IOREGSEL) and a data window (IOWIN), so every access is a pair and
+ * holds ioapic_lock.
+ *
+ * All entries use fixed delivery in physical destination mode: the
+ * destination is one APIC ID, which is what per-IRQ affinity needs.
+ */
+
+#include <kernel/ioapic.h>
+#include <kernel/hal.h>
+#include <kernel/lapic.h>
+#include <kernel/percpu.h>
+#include <kernel/spinlock.h>
+#include <drivers/vga.h>
+
+// Register window (bytes from the I/O APIC base)
+#define IOAPIC_IOREGSEL         0x00
+#define IOAPIC_IOWIN            0x10
+
+// Indirect registers
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VERSION      0x01
+#define IOAPIC_REG_REDTBL       0x10    // Two registers per input
+
+// Redirection entry, low word
+#define IOAPIC_RTE_ACTIVE_LOW   (1u << 13)
+#define IOAPIC_RTE_LEVEL        (1u << 15)
+#define IOAPIC_RTE_MASKED       (1u << 16)
+
+// Legacy PIC and the IMCR (MP spec 3.6.2.1)
+#define PIC1_DATA               0x21
+#define PIC2_DATA               0xA1
+#define IMCR_SELECT             0x22
+#define IMCR_DATA               0x23
+#define IMCR_REG                0x70
+#define IMCR_APIC               0x01    // Route INTR/NMI through the APICs
+
+#define PIN_NONE                0xFF
+
+extern uint32_t x86_smp_apic_id(uint32_t cpu_id);
+
+bool ioapic_routing = false;
+
+static volatile uint32_t* ioapic_regs = NULL;
+static spinlock_t ioapic_lock = SPINLOCK_INIT;
+static uint32_t ioapic_pins;
+
+// Per ISA IRQ: input and destination CPU
+static uint8_t irq_pin[IOAPIC_ISA_IRQS];
+static uint8_t irq_cpu[IOAPIC_ISA_IRQS];
+
+static inline uint32_t ioapic_read(uint32_t reg) {
+    ioapic_regs[IOAPIC_IOREGSEL / 4] = reg;
+    return ioapic_regs[IOAPIC_IOWIN / 4];
+}
+
+static inline void ioapic_write(uint32_t reg, uint32_t value) {
+    ioapic_regs[IOAPIC_IOREGSEL / 4] = reg;
+    ioapic_regs[IOAPIC_IOWIN / 4] = value;
+}
+
+static inline uint32_t rte_low(uint32_t pin) {
+    return IOAPIC_REG_REDTBL + 2 * pin;
+}
+
+static inline uint32_t rte_high(uint32_t pin) {
+    return IOAPIC_REG_REDTBL + 2 * pin + 1;
+}
+
+void ioapic_config_defaults(struct ioapic_config* cfg) {
+    cfg->base = 0;
+    cfg->id = 0;
+    cfg->imcr = false;
+    for (uint32_t irq = 0; irq < IOAPIC_ISA_IRQS; irq++) {
+        cfg->isa_pin[irq] = (uint8_t)irq;
+        cfg->isa_flags[irq] = 0;
+    }
+}
+
+static uint32_t rte_flags(uint16_t flags) {
+    uint32_t low = 0;
+    // ISA "conforming" is edge-triggered, active high
+    if ((flags & IOAPIC_FLAG_POLARITY) == IOAPIC_FLAG_ACTIVE_LOW) {
+        low |= IOAPIC_RTE_ACTIVE_LOW;
+    }
+    if ((flags & IOAPIC_FLAG_TRIGGER) == IOAPIC_FLAG_LEVEL) {
+        low |= IOAPIC_RTE_LEVEL;
+    }
+    return low;
+}
+
+int ioapic_init(const struct ioapic_config* cfg) {
+    if (!cfg->base || !lapic_available()) {
+        return -ENODEV;
+    }
+
+    void* regs = hal->mmio_map(cfg->base, IOAPIC_IOWIN + 4);
+    if (!regs) {
+        return -ENOMEM;
+    }
+    ioapic_regs = (volatile uint32_t*)regs;
+    ioapic_pins = ((ioapic_read(IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+
+    uint32_t flags = hal->irq_disable();
+    for (uint32_t pin = 0; pin < ioapic_pins; pin++) {
+        ioapic_write(rte_low(pin), IOAPIC_RTE_MASKED);
+    }
+
+    // IRQs the PIC had unmasked come up unmasked here
+    uint16_t pic_mask = (uint16_t)(hal->io_inb(PIC1_DATA) | (hal->io_inb(PIC2_DATA) << 8));
+    uint32_t boot_apic = x86_smp_apic_id(0);
+    uint32_t routed = 0;
+    for (uint32_t irq = 0; irq < IOAPIC_ISA_IRQS; irq++) {
+        irq_pin[irq] = PIN_NONE;
+        irq_cpu[irq] = 0;
+        // IRQ 2 is the PIC cascade; its input usually carries IRQ 0
+        if (irq == 2 || cfg->isa_pin[irq] >= ioapic_pins) {
+            continue;
+        }
+
+        uint32_t pin = cfg->isa_pin[irq];
+        uint32_t low = (IOAPIC_VECTOR_BASE + irq) | rte_flags(cfg->isa_flags[irq]);
+        if (pic_mask & (1u << irq)) {
+            low |= IOAPIC_RTE_MASKED;
+        }
+        irq_pin[irq] = (uint8_t)pin;
+        ioapic_write(rte_high(pin), boot_apic << 24);
+        ioapic_write(rte_low(pin), low);
+        routed++;
+    }
+
+    // From here on the PIC never raises anything
+    if (cfg->imcr) {
+        hal->io_outb(IMCR_SELECT, IMCR_REG);
+        hal->io_outb(IMCR_DATA, IMCR_APIC);
+    }
+    hal->io_outb(PIC1_DATA, 0xFF);
+    hal->io_outb(PIC2_DATA, 0xFF);
+    ioapic_routing = true;
+    hal->irq_restore(flags);
+
+    kprintf("[IOAPIC] ID %u at 0x%08x: %u inputs, %u ISA IRQs routed (timer on input %u)\n",
+            (unsigned int)cfg->id, (unsigned int)cfg->base, (unsigned int)ioapic_pins,
+            (unsigned int)routed, (unsigned int)cfg->isa_pin[0]);
+    return 0;
+}
+
+static void ioapic_set_masked(uint8_t irq, bool masked) {
+    if (!ioapic_routing || irq >= IOAPIC_ISA_IRQS || irq_pin[irq] == PIN_NONE) {
+        return;
+    }
+
+    uint32_t pin = irq_pin[irq];
+    uint32_t flags = spin_lock_irqsave(&ioapic_lock);
+    uint32_t low = ioapic_read(rte_low(pin));
+    low = masked ? low | IOAPIC_RTE_MASKED : low & ~IOAPIC_RTE_MASKED;
+    ioapic_write(rte_low(pin), low);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+}
+
+void ioapic_mask(uint8_t irq) {
+    ioapic_set_masked(irq, true);
+}
+
+void ioapic_unmask(uint8_t irq) {
+    ioapic_set_masked(irq, false);
+}
+
+int ioapic_set_affinity(uint8_t irq, uint32_t cpu_id) {
+    if (!ioapic_routing) {
+        return -ENODEV;
+    }
+    if (irq >= IOAPIC_ISA_IRQS || irq_pin[irq] == PIN_NONE ||
+        cpu_id >= MAX_CPUS || !per_cpu[cpu_id]->online) {
+        return -EINVAL;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&ioapic_lock);
+    ioapic_write(rte_high(irq_pin[irq]), x86_smp_apic_id(cpu_id) << 24);
+    irq_cpu[irq] = (uint8_t)cpu_id;
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+    return 0;
+}
+
+int ioapic_get_affinity(uint8_t irq) {
+    if (!ioapic_routing) {
+        return -ENODEV;
+    }
+    if (irq >= IOAPIC_ISA_IRQS || irq_pin[irq] == PIN_NONE) {
+        return -EINVAL;
+    }
+    return irq_cpu[irq];
+}
@@ -0,0 +1,46 @@
+/**
+ * Unit tests for I/O APIC routing
+ *
+ * Without an I/O APIC the PIC stays in charge and only the -ENODEV
+ * answers are checked. With one, the boot-time routing and the
+ * affinity argument checks are; these tests run before the APs start,
+ * so every other CPU is offline.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/hal.h>
+#include <kernel/ioapic.h>
+#include <kernel/percpu.h>
+
+// Test: the timer is routed to the boot CPU, or the PIC is still in use
+static int test_ioapic_routing(void) {
+    if (!ioapic_active()) {
+        KTEST_ASSERT_EQ(ioapic_get_affinity(0), -ENODEV, "no routing reported");
+        KTEST_ASSERT_EQ(ioapic_set_affinity(0, 0), -ENODEV, "affinity refused");
+        return KTEST_PASS;
+    }
+
+    KTEST_ASSERT_EQ(ioapic_get_affinity(0), 0, "timer on the boot CPU");
+    KTEST_ASSERT_EQ(ioapic_get_affinity(2), -EINVAL, "cascade input not routed");
+    KTEST_ASSERT_EQ(ioapic_get_affinity(IOAPIC_ISA_IRQS), -EINVAL, "not an ISA IRQ");
+    return KTEST_PASS;
+}
+
+// Test: affinity only accepts online CPUs and routed IRQs
+static int test_ioapic_affinity(void) {
+    if (!ioapic_active()) {
+        return KTEST_PASS;
+    }
+
+    KTEST_ASSERT_EQ(ioapic_set_affinity(0, MAX_CPUS), -EINVAL, "bad CPU refused");
+    if (MAX_CPUS > 1 && !per_cpu[1]->online) {
+        KTEST_ASSERT_EQ(ioapic_set_affinity(0, 1), -EINVAL, "offline CPU refused");
+    }
+    KTEST_ASSERT_EQ(ioapic_set_affinity(2, 0), -EINVAL, "unrouted IRQ refused");
+    KTEST_ASSERT_EQ(ioapic_set_affinity(0, 0), 0, "boot CPU accepted");
+    KTEST_ASSERT_EQ(ioapic_get_affinity(0), 0, "read back");
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("ioapic", ioapic_routing, test_ioapic_routing);
+KTEST_DEFINE("ioapic", ioapic_affinity, test_ioapic_affinity);
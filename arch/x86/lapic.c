@@ -0,0 +1,269 @@
+/**
+ * x86 Local APIC Driver
+ *
+ * xAPIC programming through the memory-mapped register page: enable,
+ * EOI, IPIs (fixed, INIT, STARTUP) and the per-CPU timer.
+ *
+ * RT Constraints:
+ * - EOI and ID reads are single uncached accesses
+ * - IPI sends wait at most LAPIC_ICR_SPIN iterations for the ICR
+ */
+
+#include <kernel/lapic.h>
+#include <kernel/hal.h>
+#include <kernel/timer.h>
+#include <kernel/mmu.h>
+#include <drivers/vga.h>
+
+// Register offsets (bytes from the APIC base)
+#define LAPIC_REG_ID         0x020
+#define LAPIC_REG_VERSION    0x030
+#define LAPIC_REG_TPR        0x080
+#define LAPIC_REG_EOI        0x0B0
+#define LAPIC_REG_SVR        0x0F0
+#define LAPIC_REG_ESR        0x280
+#define LAPIC_REG_ICR_LOW    0x300
+#define LAPIC_REG_ICR_HIGH   0x310
+#define LAPIC_REG_LVT_TIMER  0x320
+#define LAPIC_REG_LVT_PERF   0x340
+#define LAPIC_REG_LVT_LINT0  0x350
+#define LAPIC_REG_LVT_LINT1  0x360
+#define LAPIC_REG_LVT_ERROR  0x370
+#define LAPIC_REG_TIMER_INIT 0x380
+#define LAPIC_REG_TIMER_CUR  0x390
+#define LAPIC_REG_TIMER_DIV  0x3E0
+
+// Spurious-interrupt vector register
+#define LAPIC_SVR_ENABLE     (1u << 8)
+
+// Local vector table bits
+#define LAPIC_LVT_MASKED     (1u << 16)
+#define LAPIC_LVT_PERIODIC   (1u << 17)
+#define LAPIC_LVT_NMI        (4u << 8)
+
+// Interrupt command register
+#define LAPIC_ICR_FIXED      (0u << 8)
+#define LAPIC_ICR_INIT       (5u << 8)
+#define LAPIC_ICR_STARTUP    (6u << 8)
+#define LAPIC_ICR_PENDING    (1u << 12)
+#define LAPIC_ICR_ASSERT     (1u << 14)
+#define LAPIC_ICR_LEVEL      (1u << 15)
+#define LAPIC_ICR_ALL_BUT_SELF (3u << 18)
+
+// Timer divide configuration: divide by 16
+#define LAPIC_TIMER_DIV16    0x3
+
+// Bounded wait for the ICR to accept the previous IPI
+#define LAPIC_ICR_SPIN       100000
+
+// APIC timer calibration window
+#define LAPIC_CALIBRATE_US   10000
+
+static volatile uint32_t* lapic_regs = NULL;
+
+// APIC timer input clock after the divider (0 = not calibrated)
+static uint32_t lapic_timer_hz = 0;
+
+// Timer counts per microsecond, 32.32 fixed point (one-shot arming)
+static uint64_t lapic_timer_us_mult = 0;
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_regs[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_regs[reg / 4] = value;
+}
+
+/**
+ * Busy-wait using the calibrated TSC
+ */
+static void udelay(uint32_t us) {
+    uint64_t end = hal->timer_read_us() + us;
+    while (hal->timer_read_us() < end) {
+        __asm__ volatile("pause");
+    }
+}
+
+/**
+ * Wait until the ICR has sent the previous IPI
+ *
+ * @return true if the ICR is idle
+ */
+static bool lapic_icr_wait(void) {
+    for (uint32_t i = 0; i < LAPIC_ICR_SPIN; i++) {
+        if (!(lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)) {
+            return true;
+        }
+        __asm__ volatile("pause");
+    }
+    return false;
+}
+
+static void lapic_icr_send(uint32_t apic_id, uint32_t low) {
+    uint32_t flags = hal->irq_disable();
+    lapic_icr_wait();
+    lapic_write(LAPIC_REG_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, low);
+    hal->irq_restore(flags);
+}
+
+/**
+ * Common enable sequence for every CPU
+ */
+static void lapic_enable(void) {
+    // Accept all priorities, clear stale errors
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_ESR, 0);
+
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/**
+ * Measure the APIC timer rate against the TSC
+ */
+static void lapic_timer_calibrate(void) {
+    if (timer_get_tsc_freq() == 0) {
+        return;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+
+    udelay(LAPIC_CALIBRATE_US);
+
+    uint32_t elapsed = 0xFFFFFFFFu - lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    lapic_timer_hz = (uint32_t)(((uint64_t)elapsed * 1000000ULL) / LAPIC_CALIBRATE_US);
+    lapic_timer_us_mult = ((uint64_t)elapsed << 32) / LAPIC_CALIBRATE_US;
+}
+
+// Spurious interrupts need neither handling nor an EOI
+static void lapic_spurious_handler(void) {
+}
+
+int lapic_init(phys_addr_t phys_base) {
+    if (!(hal->cpu_features() & HAL_CPU_FEAT_APIC)) {
+        return -ENODEV;
+    }
+
+    void* regs = hal->mmio_map(phys_base, PAGE_SIZE);
+    if (!regs) {
+        return -ENOMEM;
+    }
+    lapic_regs = (volatile uint32_t*)regs;
+
+    hal->irq_register(LAPIC_SPURIOUS_VECTOR, lapic_spurious_handler);
+    lapic_enable();
+    lapic_timer_calibrate();
+
+    kprintf("[LAPIC] APIC ID %u, version 0x%02x, timer %u kHz\n",
+            (unsigned int)lapic_id(),
+            (unsigned int)(lapic_read(LAPIC_REG_VERSION) & 0xFF),
+            (unsigned int)(lapic_timer_hz / 1000));
+    return 0;
+}
+
+void lapic_init_ap(void) {
+    // Only the boot CPU takes ExtINT from the PIC; NMI stays on LINT1
+    lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_enable();
+}
+
+bool lapic_available(void) {
+    return lapic_regs != NULL;
+}
+
+void lapic_perf_nmi(bool enable) {
+    if (lapic_regs) {
+        lapic_write(LAPIC_REG_LVT_PERF, enable ? LAPIC_LVT_NMI : LAPIC_LVT_MASKED | LAPIC_LVT_NMI);
+    }
+}
+
+uint32_t lapic_id(void) {
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector) {
+    lapic_icr_send(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+void lapic_broadcast_ipi(uint8_t vector) {
+    lapic_icr_send(0, LAPIC_ICR_ALL_BUT_SELF | LAPIC_ICR_FIXED |
+                      LAPIC_ICR_ASSERT | vector);
+}
+
+int lapic_start_ap(uint32_t apic_id, phys_addr_t page) {
+    uint32_t vector = (page >> 12) & 0xFF;
+
+    // INIT assert, then de-assert (needed by older APICs)
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_icr_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL | LAPIC_ICR_ASSERT);
+    if (!lapic_icr_wait()) {
+        return -EIO;
+    }
+    lapic_icr_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+    lapic_icr_wait();
+    udelay(10000);
+
+    // Two STARTUP IPIs, as the MP spec recommends
+    for (int i = 0; i < 2; i++) {
+        lapic_icr_send(apic_id, LAPIC_ICR_STARTUP | vector);
+        udelay(200);
+        if (!lapic_icr_wait()) {
+            return -EIO;
+        }
+    }
+    return 0;
+}
+
+int lapic_timer_start(uint32_t frequency_hz) {
+    if (!lapic_regs || lapic_timer_hz == 0 || frequency_hz == 0) {
+        return -ENODEV;
+    }
+
+    uint32_t count = lapic_timer_hz / frequency_hz;
+    if (count == 0) {
+        count = 1;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, count);
+    return 0;
+}
+
+int lapic_timer_oneshot(uint32_t delay_us) {
+    if (!lapic_regs || lapic_timer_us_mult == 0) {
+        return -ENODEV;
+    }
+
+    if (delay_us > LAPIC_ONESHOT_MAX_US) {
+        delay_us = LAPIC_ONESHOT_MAX_US;
+    }
+    uint32_t count = (uint32_t)(((uint64_t)delay_us * lapic_timer_us_mult) >> 32);
+    if (count == 0) {
+        count = 1;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, count);
+    return 0;
+}
+
+void lapic_timer_stop(void) {
+    if (lapic_regs) {
+        lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    }
+}
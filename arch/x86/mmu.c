@@ -6,7 +6,7 @@
  * - Page Tables (1024 entries per table, each covering 4KB)
  *
  * Total address space: 4GB (32-bit)
- * Page size: 4KB
+ * Page size: 4KB, plus 4MB PSE pages for mmu_map_range() when supported
  *
  * RT Constraints enforced:
  * - O(1) map/unmap (direct indexing, no loops)
@@ -15,15 +15,23 @@
 
 #include <kernel/mmu.h>
 #include <kernel/pmm.h>
+#include <kernel/slab.h>
 #include <kernel/hal.h>
+#include <kernel/idt.h>
+#include <kernel/percpu.h>
 #include <kernel/types.h>
+#include <kernel/log.h>
+#include <kernel/trace.h>
+#include <kernel/user.h>
 #include <drivers/vga.h>
+#include <lib/string.h>
 
 // x86 page directory entry flags
 #define PDE_PRESENT    (1 << 0)
 #define PDE_WRITABLE   (1 << 1)
 #define PDE_USER       (1 << 2)
 #define PDE_ACCESSED   (1 << 5)
+#define PDE_LARGE      (1 << 7)   // PS: entry maps a 4MB page (needs CR4.PSE)
 
 // x86 page table entry flags
 #define PTE_PRESENT    (1 << 0)
@@ -32,6 +40,12 @@
 #define PTE_NOCACHE    (1 << 4)
 #define PTE_ACCESSED   (1 << 5)
 #define PTE_DIRTY      (1 << 6)
+#define PTE_GLOBAL     (1 << 8)   // Not flushed by CR3 loads (needs CR4.PGE)
+
+// Page fault error code bits
+#define PF_PRESENT     (1 << 0)   // Protection violation (page was present)
+#define PF_WRITE       (1 << 1)   // Write access
+#define PF_USER        (1 << 2)   // Fault raised in ring 3
 
 // Page directory/table sizes
 #define ENTRIES_PER_TABLE 1024
@@ -39,15 +53,48 @@
 #define PT_INDEX(virt) (((virt) >> 12) & 0x3FF)
 #define PAGE_FRAME(entry) ((entry) & ~0xFFF)
 
+// 4MB large pages
+#define LARGE_PAGE_SIZE  (4u * 1024 * 1024)
+#define LARGE_FRAME(entry) ((entry) & ~(LARGE_PAGE_SIZE - 1))
+#define IS_LARGE_ALIGNED(addr) (((addr) & (LARGE_PAGE_SIZE - 1)) == 0)
+
+// Above this many pages a range update flushes the whole TLB instead of
+// issuing one invlpg per page
+#define TLB_FLUSH_SINGLE_MAX 32
+
+#define CR0_WP  (1u << 16)  // Ring 0 writes honour read-only PTEs (copy-on-write)
+#define CR0_PG  (1u << 31)
+
+#define CR4_PSE (1u << 4)
+#define CR4_PGE (1u << 7)
+
+// Demand-paged region (see mmu_reserve_region)
+struct mmu_region {
+    virt_addr_t start;
+    virt_addr_t end;            // Exclusive
+    uint32_t flags;             // MMU_* flags for committed pages
+    phys_addr_t backing;        // Frames behind the first backing_len bytes
+    size_t backing_len;         // 0 = anonymous (zero-filled) region
+};
+
 // x86 page table structure (opaque to outside)
 struct page_table {
     uint32_t* page_directory;   // Physical address of page directory
     phys_addr_t pd_phys;        // Physical address for CR3
+    uint32_t region_count;
+    bool shares_kernel;         // Kernel PDEs copied in (mmu_create_user_address_space)
+    struct mmu_region regions[MMU_MAX_REGIONS];
 };
 
 // Kernel address space (identity-mapped)
 static page_table_t* kernel_address_space = NULL;
 
+// CR4.PSE is on and mmu_map_range() may use 4MB pages
+static bool pse_enabled = false;
+
+// CR4.PGE is on: MMU_GLOBAL mappings survive CR3 loads
+static bool pge_enabled = false;
+
 /**
  * Convert generic MMU flags to x86 PTE flags
  */
@@ -58,6 +105,7 @@ static inline uint32_t flags_to_x86(uint32_t flags) {
     if (flags & MMU_WRITABLE) x86_flags |= PTE_WRITABLE;
     if (flags & MMU_USER)     x86_flags |= PTE_USER;
     if (flags & MMU_NOCACHE)  x86_flags |= PTE_NOCACHE;
+    if (flags & MMU_GLOBAL)   x86_flags |= PTE_GLOBAL;
 
     return x86_flags;
 }
@@ -67,15 +115,101 @@ static inline uint32_t flags_to_x86(uint32_t flags) {
  */
 static inline void flush_tlb_single(virt_addr_t virt) {
     __asm__ volatile("invlpg (%0)" : : "r"(virt) : "memory");
+    trace_point(TRACE_TLB_FLUSH, TRACE_TLB_PAGE, virt, 0, 0);
 }
 
 /**
- * Flush entire TLB by reloading CR3
+ * Flush entire TLB by reloading CR3 (global entries survive)
  */
 static inline void flush_tlb_all(void) {
     uint32_t cr3;
     __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
     __asm__ volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+    trace_point(TRACE_TLB_FLUSH, TRACE_TLB_ALL, 0, 0, 0);
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t cr4;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static inline void write_cr4(uint32_t cr4) {
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+/**
+ * Flush entire TLB including global entries (toggles CR4.PGE)
+ */
+static inline void flush_tlb_global(void) {
+    if (!pge_enabled) {
+        flush_tlb_all();
+        return;
+    }
+    uint32_t cr4 = read_cr4();
+    write_cr4(cr4 & ~CR4_PGE);
+    write_cr4(cr4);
+    trace_point(TRACE_TLB_FLUSH, TRACE_TLB_GLOBAL, 0, 0, 0);
+}
+
+/**
+ * Whether `pt` is the address space loaded in CR3
+ */
+static inline bool is_active(const page_table_t* pt) {
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return PAGE_FRAME(cr3) == pt->pd_phys;
+}
+
+/**
+ * Replace a 4MB mapping by a page table with the same 1024 mappings
+ *
+ * The caller flushes the TLB for the address it is about to change;
+ * invlpg of any address in the 4MB page drops the large TLB entry.
+ */
+static uint32_t* split_large_page(uint32_t* pd, uint32_t pd_index) {
+    phys_addr_t pt_phys = pmm_alloc_page();
+    if (!pt_phys) {
+        return NULL;
+    }
+
+    uint32_t* page_table = (uint32_t*)(uintptr_t)pt_phys;
+    uint32_t base = LARGE_FRAME(pd[pd_index]);
+    uint32_t attrs = pd[pd_index] &
+                     (PTE_PRESENT | PTE_WRITABLE | PTE_USER | PTE_NOCACHE | PTE_GLOBAL);
+
+    for (uint32_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        page_table[i] = (base + i * PAGE_SIZE) | attrs;
+    }
+
+    pd[pd_index] = pt_phys | PDE_PRESENT | PDE_WRITABLE | PDE_USER;
+    return page_table;
+}
+
+/**
+ * Page table for directory slot `pd_index`, created on first use
+ *
+ * A 4MB mapping in the slot is split into 4KB pages first.
+ *
+ * @return Page table, or NULL if no frame was available
+ */
+static uint32_t* get_page_table(page_table_t* pt, uint32_t pd_index) {
+    uint32_t* pd = pt->page_directory;
+
+    if (!(pd[pd_index] & PDE_PRESENT)) {
+        // Allocate new, already zeroed page table (O(1) on pool hit)
+        phys_addr_t pt_phys = pmm_alloc_zeroed_page();
+        if (!pt_phys) {
+            return NULL;
+        }
+
+        // Install page table in directory
+        pd[pd_index] = pt_phys | PDE_PRESENT | PDE_WRITABLE | PDE_USER;
+    } else if (pd[pd_index] & PDE_LARGE) {
+        return split_large_page(pd, pd_index);
+    }
+
+    return (uint32_t*)(uintptr_t)PAGE_FRAME(pd[pd_index]);
 }
 
 /**
@@ -89,20 +223,24 @@ page_table_t* mmu_create_address_space(void) {
         return NULL;
     }
 
-    // Allocate page_table structure from heap (NOT from PMM)
-    // PMM returns physical addresses, not pointers!
-    static page_table_t pt_storage;  // FIXME: Should use kmalloc when available
-    page_table_t* pt = &pt_storage;
+    // Allocate page_table descriptor from the slab allocator (NOT from PMM)
+    page_table_t* pt = kmalloc(sizeof(page_table_t));
+    if (!pt) {
+        kprintf("[MMU] ERROR: Failed to allocate address space descriptor\n");
+        return NULL;
+    }
 
-    // Allocate page directory (this IS a physical frame)
-    phys_addr_t pd_phys = pmm_alloc_page();
+    // Allocate zeroed page directory (this IS a physical frame)
+    phys_addr_t pd_phys = pmm_alloc_zeroed_page();
     if (!pd_phys) {
         kprintf("[MMU] ERROR: Failed to allocate page directory\n");
+        kfree(pt);
         return NULL;
     }
     if (!IS_PAGE_ALIGNED(pd_phys)) {
         kprintf("[MMU] ERROR: Page directory not page-aligned: 0x%08x\n",
                 (unsigned int)pd_phys);
+        kfree(pt);
         return NULL;
     }
 
@@ -110,19 +248,47 @@ page_table_t* mmu_create_address_space(void) {
     // For now, use identity mapping (phys == virt)
     uint32_t* pd = (uint32_t*)(uintptr_t)pd_phys;
 
-    // Zero out page directory
-    for (int i = 0; i < ENTRIES_PER_TABLE; i++) {
-        pd[i] = 0;
-    }
-
     pt->page_directory = pd;
     pt->pd_phys = pd_phys;
+    pt->region_count = 0;
+    pt->shares_kernel = false;
 
-    kprintf("[MMU] Page directory allocated at phys 0x%08x\n", (unsigned int)pd_phys);
+    log_debug(MMU, "Page directory allocated at phys 0x%08x\n", (unsigned int)pd_phys);
 
     return pt;
 }
 
+// Directory slots of the user window: never shared with the kernel
+static inline bool is_user_slot(uint32_t pd_index) {
+    return pd_index >= PD_INDEX(USER_CODE_BASE) && pd_index < PD_INDEX(USER_STACK_TOP);
+}
+
+/**
+ * Create an address space sharing the kernel's mappings
+ *
+ * RT: O(ENTRIES_PER_TABLE) - one page directory copy
+ */
+page_table_t* mmu_create_user_address_space(void) {
+    if (!kernel_address_space) {
+        return NULL;
+    }
+    page_table_t* pt = mmu_create_address_space();
+    if (!pt) {
+        return NULL;
+    }
+
+    // Kernel page tables are shared, not copied: later 4KB mappings in
+    // them show up here too, new directory slots do not
+    const uint32_t* kpd = kernel_address_space->page_directory;
+    for (uint32_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        if (!is_user_slot(i)) {
+            pt->page_directory[i] = kpd[i];
+        }
+    }
+    pt->shares_kernel = true;
+    return pt;
+}
+
 /**
  * Destroy an address space
  *
@@ -134,21 +300,27 @@ void mmu_destroy_address_space(page_table_t* pt) {
         return;
     }
 
+    // Demand-paged frames belong to the address space
+    while (pt->region_count > 0) {
+        mmu_release_region(pt, pt->regions[0].start);
+    }
+
     uint32_t* pd = pt->page_directory;
 
-    // Free all page tables
-    for (int i = 0; i < ENTRIES_PER_TABLE; i++) {
-        if (pd[i] & PDE_PRESENT) {
+    // Free all page tables (4MB mappings have none, the kernel's stay)
+    for (uint32_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        if (pt->shares_kernel && !is_user_slot(i)) {
+            continue;
+        }
+        if ((pd[i] & (PDE_PRESENT | PDE_LARGE)) == PDE_PRESENT) {
             phys_addr_t pt_phys = PAGE_FRAME(pd[i]);
             pmm_free_page(pt_phys);
         }
     }
 
-    // Free page directory
+    // Free page directory and descriptor
     pmm_free_page(pt->pd_phys);
-
-    // NOTE: pt is static storage, not dynamically allocated
-    // When we have kmalloc, we'll need to kfree(pt) here
+    kfree(pt);
 }
 
 /**
@@ -169,35 +341,16 @@ void* mmu_map_page(page_table_t* pt, phys_addr_t phys,
         return NULL;
     }
 
-    uint32_t* pd = pt->page_directory;
-
     // Calculate indices (O(1))
     uint32_t pd_index = PD_INDEX(virt);
     uint32_t pt_index = PT_INDEX(virt);
 
-    // Check if page table exists
-    if (!(pd[pd_index] & PDE_PRESENT)) {
-        // Allocate new page table (O(1))
-        phys_addr_t pt_phys = pmm_alloc_page();
-        if (!pt_phys) {
-            return NULL;
-        }
-
-        // Map page table (identity mapping for now)
-        uint32_t* page_table = (uint32_t*)(uintptr_t)pt_phys;
-
-        // Zero out page table
-        for (int i = 0; i < ENTRIES_PER_TABLE; i++) {
-            page_table[i] = 0;
-        }
-
-        // Install page table in directory
-        pd[pd_index] = pt_phys | PDE_PRESENT | PDE_WRITABLE | PDE_USER;
+    // Get (or allocate) page table
+    uint32_t* page_table = get_page_table(pt, pd_index);
+    if (!page_table) {
+        return NULL;
     }
 
-    // Get page table
-    uint32_t* page_table = (uint32_t*)(uintptr_t)PAGE_FRAME(pd[pd_index]);
-
     // Convert flags to x86 format
     uint32_t x86_flags = flags_to_x86(flags);
 
@@ -210,6 +363,65 @@ void* mmu_map_page(page_table_t* pt, phys_addr_t phys,
     return (void*)virt;
 }
 
+/**
+ * Map a physically contiguous range
+ *
+ * Uses 4MB pages for every 4MB-aligned stretch when PSE is enabled and
+ * 4KB pages elsewhere; the TLB is flushed once for the whole range.
+ *
+ * NOT RT-safe: O(len / PAGE_SIZE) worst case
+ */
+int mmu_map_range(page_table_t* pt, phys_addr_t phys, virt_addr_t virt,
+                  size_t len, uint32_t flags) {
+    if (!pt || !IS_PAGE_ALIGNED(phys) || !IS_PAGE_ALIGNED(virt) ||
+        !IS_PAGE_ALIGNED(len) || virt + len < virt) {
+        return -EINVAL;
+    }
+
+    uint32_t* pd = pt->page_directory;
+    uint32_t x86_flags = flags_to_x86(flags);
+    size_t done = 0;
+
+    while (done < len) {
+        virt_addr_t v = virt + done;
+        phys_addr_t p = phys + done;
+        uint32_t pd_index = PD_INDEX(v);
+
+        if (pse_enabled && IS_LARGE_ALIGNED(v) && IS_LARGE_ALIGNED(p) &&
+            len - done >= LARGE_PAGE_SIZE && !(pd[pd_index] & PDE_PRESENT)) {
+            pd[pd_index] = p | x86_flags | PDE_LARGE;
+            done += LARGE_PAGE_SIZE;
+            continue;
+        }
+
+        uint32_t* page_table = get_page_table(pt, pd_index);
+        if (!page_table) {
+            break;
+        }
+
+        // Fill this page table up to its end or the end of the range
+        do {
+            page_table[PT_INDEX(virt + done)] = (phys + done) | x86_flags;
+            done += PAGE_SIZE;
+        } while (done < len && PT_INDEX(virt + done) != 0);
+    }
+
+    // One flush for the whole range; inactive address spaces need none
+    if (is_active(pt)) {
+        if (done / PAGE_SIZE <= TLB_FLUSH_SINGLE_MAX) {
+            for (size_t off = 0; off < done; off += PAGE_SIZE) {
+                flush_tlb_single(virt + off);
+            }
+        } else if (x86_flags & PTE_GLOBAL) {
+            flush_tlb_global();
+        } else {
+            flush_tlb_all();
+        }
+    }
+
+    return (done == len) ? 0 : -ENOMEM;
+}
+
 /**
  * Unmap a virtual address
  *
@@ -236,8 +448,13 @@ void mmu_unmap_page(page_table_t* pt, virt_addr_t virt) {
         return;  // Page not mapped
     }
 
-    // Get page table
-    uint32_t* page_table = (uint32_t*)(uintptr_t)PAGE_FRAME(pd[pd_index]);
+    // Get page table (splits a 4MB mapping)
+    uint32_t* page_table = get_page_table(pt, pd_index);
+    if (!page_table) {
+        kprintf("[MMU] ERROR: No frame to split 4MB page at 0x%08x\n",
+                (unsigned int)virt);
+        return;
+    }
 
     // Clear page table entry (O(1))
     page_table[pt_index] = 0;
@@ -246,6 +463,290 @@ void mmu_unmap_page(page_table_t* pt, virt_addr_t virt) {
     flush_tlb_single(virt);
 }
 
+/**
+ * Page table entry for `virt`, or NULL if there is no page table
+ * (unmapped or covered by a 4MB page). Never allocates.
+ */
+static uint32_t* lookup_pte(page_table_t* pt, virt_addr_t virt) {
+    uint32_t pde = pt->page_directory[PD_INDEX(virt)];
+    if ((pde & (PDE_PRESENT | PDE_LARGE)) != PDE_PRESENT) {
+        return NULL;
+    }
+    return &((uint32_t*)(uintptr_t)PAGE_FRAME(pde))[PT_INDEX(virt)];
+}
+
+static struct mmu_region* find_region(page_table_t* pt, virt_addr_t virt) {
+    for (uint32_t i = 0; i < pt->region_count; i++) {
+        if (virt >= pt->regions[i].start && virt < pt->regions[i].end) {
+            return &pt->regions[i];
+        }
+    }
+    return NULL;
+}
+
+// Whether `frame` belongs to the region's backing store (never freed by it)
+static inline bool is_backing_frame(const struct mmu_region* r, phys_addr_t frame) {
+    return r->backing_len && frame >= r->backing && frame - r->backing < r->backing_len;
+}
+
+/**
+ * Reserve a demand-paged region
+ *
+ * RT: O(MMU_MAX_REGIONS); nothing is allocated until first touch
+ */
+int mmu_reserve_region(page_table_t* pt, virt_addr_t start, size_t len, uint32_t flags) {
+    return mmu_reserve_backed_region(pt, start, len, flags, 0, 0);
+}
+
+/**
+ * Reserve a demand-paged region with a physical backing store
+ *
+ * RT: O(MMU_MAX_REGIONS); nothing is allocated until first touch
+ */
+int mmu_reserve_backed_region(page_table_t* pt, virt_addr_t start, size_t len, uint32_t flags,
+                              phys_addr_t backing, size_t backing_len) {
+    if (!pt || len == 0 || !IS_PAGE_ALIGNED(start) || !IS_PAGE_ALIGNED(len) ||
+        start + len < start || start == 0 || backing_len > len ||
+        (backing_len && (backing == 0 || !IS_PAGE_ALIGNED(backing)))) {
+        return -EINVAL;
+    }
+
+    virt_addr_t end = start + len;
+    for (uint32_t i = 0; i < pt->region_count; i++) {
+        if (start < pt->regions[i].end && pt->regions[i].start < end) {
+            return -EBUSY;
+        }
+    }
+    if (pt->region_count == MMU_MAX_REGIONS) {
+        return -ENOMEM;
+    }
+
+    struct mmu_region* r = &pt->regions[pt->region_count++];
+    r->start = start;
+    r->end = end;
+    r->flags = flags | MMU_PRESENT;
+    r->backing = backing_len ? backing : 0;
+    r->backing_len = backing_len;
+    return 0;
+}
+
+/**
+ * Release a region and free its committed frames
+ *
+ * NOT RT-safe: O(region pages)
+ */
+int mmu_release_region(page_table_t* pt, virt_addr_t start) {
+    if (!pt) {
+        return -EINVAL;
+    }
+
+    struct mmu_region* r = find_region(pt, start);
+    if (!r || r->start != start) {
+        return -EINVAL;
+    }
+
+    bool active = is_active(pt);
+    for (virt_addr_t virt = r->start; virt < r->end; virt += PAGE_SIZE) {
+        uint32_t* pte = lookup_pte(pt, virt);
+        if (!pte || !(*pte & PTE_PRESENT)) {
+            continue;
+        }
+        phys_addr_t frame = PAGE_FRAME(*pte);
+        *pte = 0;
+        if (active) {
+            flush_tlb_single(virt);
+        }
+        if (!is_backing_frame(r, frame)) {
+            pmm_page_put(frame);
+        }
+    }
+
+    // Keep the region table dense
+    *r = pt->regions[--pt->region_count];
+    return 0;
+}
+
+/**
+ * Commit a private copy of a backed page: the backing bytes, zeros after
+ *
+ * Replaces a shared mapping of the backing frame if there is one.
+ */
+static int commit_backed_copy(page_table_t* pt, const struct mmu_region* r, virt_addr_t page) {
+    size_t off = page - r->start;
+    size_t bytes = MIN((size_t)PAGE_SIZE, r->backing_len - off);
+
+    phys_addr_t frame = pmm_alloc_page();
+    if (!frame) {
+        return -ENOMEM;
+    }
+    uint8_t* dst = (uint8_t*)(uintptr_t)frame;
+    memcpy(dst, (const void*)(uintptr_t)(r->backing + off), bytes);
+    memset(dst + bytes, 0, PAGE_SIZE - bytes);
+
+    if (!mmu_map_page(pt, frame, page, r->flags)) {
+        pmm_free_page(frame);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+/**
+ * Commit a frame for a fault inside a reserved region
+ *
+ * Anonymous pages get a zeroed frame. Whole pages of the backing store
+ * are mapped in place, read-only, on reads and in read-only regions; a
+ * write to one of them (present or not) in a writable region is served
+ * with a private copy, as is the first access to a page the backing
+ * store only covers partly.
+ *
+ * RT: O(MMU_MAX_REGIONS) plus one frame (and maybe one page table) allocation
+ */
+int mmu_handle_fault(page_table_t* pt, virt_addr_t addr, bool write, bool user) {
+    if (!pt) {
+        return -EFAULT;
+    }
+
+    virt_addr_t page = PAGE_ALIGN_DOWN(addr);
+    struct mmu_region* r = find_region(pt, page);
+    if (!r || (write && !(r->flags & MMU_WRITABLE)) || (user && !(r->flags & MMU_USER))) {
+        return -EFAULT;
+    }
+
+    size_t off = page - r->start;
+    uint32_t* pte = lookup_pte(pt, page);
+    if (pte && (*pte & PTE_PRESENT)) {
+        // Copy-on-write: the region is writable, the shared mapping is not
+        if (write && !(*pte & PTE_WRITABLE) && is_backing_frame(r, PAGE_FRAME(*pte))) {
+            return commit_backed_copy(pt, r, page);
+        }
+        // Another path committed it first (spurious fault)
+        return 0;
+    }
+
+    if (off < r->backing_len) {
+        bool whole = r->backing_len - off >= PAGE_SIZE;
+        if (whole && !(write && (r->flags & MMU_WRITABLE))) {
+            return mmu_map_page(pt, r->backing + off, page, r->flags & ~MMU_WRITABLE)
+                   ? 0 : -ENOMEM;
+        }
+        return commit_backed_copy(pt, r, page);
+    }
+
+    phys_addr_t frame = pmm_alloc_zeroed_page();
+    if (!frame) {
+        return -ENOMEM;
+    }
+    if (!mmu_map_page(pt, frame, page, r->flags)) {
+        pmm_free_page(frame);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+int mmu_prefault_user(page_table_t* pt, virt_addr_t addr, bool write) {
+    if (!pt) {
+        return -EFAULT;
+    }
+
+    uint32_t pde = pt->page_directory[PD_INDEX(addr)];
+    uint32_t* pte = lookup_pte(pt, addr);
+    if (pte && (*pte & PTE_PRESENT)) {
+        uint32_t need = PTE_USER | (write ? PTE_WRITABLE : 0);
+        if ((*pte & need) == need && (pde & PDE_USER)) {
+            return 0;
+        }
+        // A shared copy-on-write page: break the sharing now
+        return (*pte & PTE_USER) ? mmu_handle_fault(pt, addr, write, true) : -EFAULT;
+    }
+
+    // 4MB pages only back the kernel's identity map
+    if (pde & PDE_LARGE) {
+        return -EFAULT;
+    }
+    return mmu_handle_fault(pt, addr, write, true);
+}
+
+/**
+ * Move a committed region page out of an address space
+ *
+ * RT: O(MMU_MAX_REGIONS)
+ */
+int mmu_region_take_page(page_table_t* pt, virt_addr_t virt, phys_addr_t* frame) {
+    struct mmu_region* r = pt ? find_region(pt, virt) : NULL;
+    if (!r || !frame || !IS_PAGE_ALIGNED(virt)) {
+        return -EFAULT;
+    }
+
+    // Backing frames are shared and hold no reference to hand over
+    uint32_t* pte = lookup_pte(pt, virt);
+    if (!pte || !(*pte & PTE_PRESENT) || is_backing_frame(r, PAGE_FRAME(*pte))) {
+        return -EFAULT;
+    }
+
+    // The region's reference on the frame passes to the caller
+    *frame = PAGE_FRAME(*pte);
+    mmu_unmap_page(pt, virt);
+    return 0;
+}
+
+/**
+ * Move a frame into a region page
+ *
+ * RT: O(MMU_MAX_REGIONS) plus at most one page table allocation
+ */
+int mmu_region_give_page(page_table_t* pt, virt_addr_t virt, phys_addr_t frame) {
+    if (!pt || !IS_PAGE_ALIGNED(virt) || !IS_PAGE_ALIGNED(frame)) {
+        return -EFAULT;
+    }
+    struct mmu_region* r = find_region(pt, virt);
+    if (!r) {
+        return -EFAULT;
+    }
+
+    // Whatever was committed here is replaced; drop the region's reference
+    uint32_t* pte = lookup_pte(pt, virt);
+    phys_addr_t old = (pte && (*pte & PTE_PRESENT)) ? PAGE_FRAME(*pte) : 0;
+
+    if (!mmu_map_page(pt, frame, virt, r->flags)) {
+        return -ENOMEM;
+    }
+    if (old && !is_backing_frame(r, old)) {
+        pmm_page_put(old);
+    }
+    return 0;
+}
+
+/**
+ * #PF handler (vector 14)
+ *
+ * Not-present faults and writes to copy-on-write pages in reserved
+ * regions are resolved in place and the faulting instruction restarts;
+ * anything else is fatal.
+ */
+static void page_fault_handler(struct interrupt_frame* frame) {
+    uint32_t cr2;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(cr2));
+
+    uint32_t err = frame->err_code;
+    if (!(err & PF_PRESENT) || (err & PF_WRITE)) {
+        int rc = mmu_handle_fault(mmu_get_current_address_space(), cr2,
+                                  (err & PF_WRITE) != 0, (err & PF_USER) != 0);
+        if (rc == 0) {
+            return;
+        }
+        if (rc == -ENOMEM) {
+            kprintf("[MMU] Out of memory committing page 0x%08x\n", (unsigned int)cr2);
+        }
+    }
+
+    kprintf("[MMU] Page fault at 0x%08x (%s, %s, %s)\n", (unsigned int)cr2,
+            (err & PF_PRESENT) ? "protection" : "not present",
+            (err & PF_WRITE) ? "write" : "read",
+            (err & PF_USER) ? "user" : "kernel");
+    idt_dump_frame(frame);
+    hal->panic("Unhandled page fault");
+}
+
 /**
  * Switch to a different address space
  *
@@ -257,7 +758,13 @@ void mmu_switch_address_space(page_table_t* pt) {
     }
 
     // Load CR3 with physical address of page directory (O(1))
+    // Flushes all non-global TLB entries
     __asm__ volatile("mov %0, %%cr3" : : "r"(pt->pd_phys) : "memory");
+
+    struct per_cpu_data* cpu = this_cpu();
+    cpu->active_address_space = pt;
+    cpu->tlb_flushes++;
+    trace_point(TRACE_TLB_FLUSH, TRACE_TLB_SWITCH, pt->pd_phys, 0, 0);
 }
 
 /**
@@ -266,13 +773,8 @@ void mmu_switch_address_space(page_table_t* pt) {
  * RT: O(1), <10 cycles
  */
 page_table_t* mmu_get_current_address_space(void) {
-    // Read CR3
-    uint32_t cr3;
-    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
-
-    // For now, just return kernel address space
-    // TODO: Track per-CPU current address space
-    return kernel_address_space;
+    page_table_t* active = this_cpu()->active_address_space;
+    return active ? active : kernel_address_space;
 }
 
 /**
@@ -288,12 +790,12 @@ page_table_t* mmu_get_kernel_address_space(void) {
  * Sets up kernel address space with identity mapping and enables paging.
  */
 void mmu_init(void) {
-    kprintf("[MMU] Initializing x86 paging...\n");
+    log_debug(MMU, "Initializing x86 paging...\n");
 
     // Check PMM stats before starting
     struct pmm_stats stats;
     pmm_get_stats(&stats);
-    kprintf("[MMU] PMM stats before init: %u total, %u free, %u reserved\n",
+    log_debug(MMU, "PMM stats before init: %u total, %u free, %u reserved\n",
             (unsigned int)stats.total_frames,
             (unsigned int)stats.free_frames,
             (unsigned int)stats.reserved_frames);
@@ -301,25 +803,25 @@ void mmu_init(void) {
     // Create kernel address space
     kernel_address_space = mmu_create_address_space();
     if (!kernel_address_space) {
-        kprintf("[MMU] ERROR: Failed to create kernel address space\n");
+        log_err(MMU, "Failed to create kernel address space\n");
         return;
     }
     if (!IS_PAGE_ALIGNED(kernel_address_space->pd_phys)) {
-        kprintf("[MMU] ERROR: Kernel page directory not aligned (pd_phys=0x%08x)\n",
+        log_err(MMU, "Kernel page directory not aligned (pd_phys=0x%08x)\n",
                 (unsigned int)kernel_address_space->pd_phys);
         return;
     }
 
-    kprintf("[MMU] Kernel address space created\n");
+    log_debug(MMU, "Kernel address space created\n");
 
     // Check PMM stats after creating address space
     pmm_get_stats(&stats);
-    kprintf("[MMU] PMM stats after creating address space:\n");
-    kprintf("[MMU]   Total: %u frames\n", (unsigned int)stats.total_frames);
-    kprintf("[MMU]   Free: %u frames (%u KB)\n",
+    log_debug(MMU, "PMM stats after creating address space:\n");
+    log_debug(MMU, "  Total: %u frames\n", (unsigned int)stats.total_frames);
+    log_debug(MMU, "  Free: %u frames (%u KB)\n",
             (unsigned int)stats.free_frames,
             (unsigned int)(stats.free_frames * 4));
-    kprintf("[MMU]   Reserved: %u frames\n", (unsigned int)stats.reserved_frames);
+    log_debug(MMU, "  Reserved: %u frames\n", (unsigned int)stats.reserved_frames);
 
     if (stats.free_frames == 0) {
         kprintf("[MMU] FATAL: No free frames available for page tables!\n");
@@ -327,38 +829,54 @@ void mmu_init(void) {
         return;
     }
 
-    // Identity map first 16MB to ensure kernel, stack, GDT, and all low memory is covered
+    // Identity map first 16MB to ensure kernel, stack, GDT, and all low memory is covered,
+    // extended over the PMM's frame descriptors if they reach further
     // Skip NULL page (0x0) for safety
-    kprintf("[MMU] Identity mapping 16MB (skipping NULL page)...\n");
+    virt_addr_t identity_end = MAX((virt_addr_t)16 * 1024 * 1024,
+                                   (virt_addr_t)PAGE_ALIGN_UP(pmm_metadata_end()));
+    log_debug(MMU, "Identity mapping %uMB (skipping NULL page)...\n",
+            (unsigned int)((identity_end + 0xFFFFF) >> 20));
+
+    // 4MB pages cover everything above the first 4MB (which holds the NULL page)
+    uint32_t features = hal->cpu_features();
+    if (features & HAL_CPU_FEAT_PSE) {
+        write_cr4(read_cr4() | CR4_PSE);
+        pse_enabled = true;
+        log_debug(MMU, "PSE enabled: using 4MB pages for the identity map\n");
+    }
 
-    for (virt_addr_t virt = PAGE_SIZE; virt < 16 * 1024 * 1024; virt += PAGE_SIZE) {
-        phys_addr_t phys = virt;  // Identity mapping
+    // Kernel mappings are global so address space switches keep them cached
+    if (features & HAL_CPU_FEAT_PGE) {
+        write_cr4(read_cr4() | CR4_PGE);
+        pge_enabled = true;
+        log_debug(MMU, "PGE enabled: kernel mappings are global\n");
+    }
 
-        void* result = mmu_map_page(kernel_address_space, phys, virt,
-                                     MMU_PRESENT | MMU_WRITABLE);
-        if (!result) {
-            kprintf("[MMU] Failed to map 0x%08x (out of PT frames)\n", (unsigned int)virt);
-            break;  // Stop if we run out of PMM frames for page tables
-        }
+    if (mmu_map_range(kernel_address_space, PAGE_SIZE, PAGE_SIZE, identity_end - PAGE_SIZE,
+                      MMU_PRESENT | MMU_WRITABLE | MMU_GLOBAL) < 0) {
+        log_warn(MMU, "Identity map incomplete (out of PT frames)\n");
     }
 
-    kprintf("[MMU] Identity mapping complete\n");
+    log_debug(MMU, "Identity mapping complete\n");
+
+    // Demand paging: resolve faults in reserved regions
+    idt_register_handler(14, page_fault_handler);
 
     // Load CR3 with page directory BEFORE enabling paging
-    kprintf("[MMU] Loading page directory into CR3...\n");
+    log_debug(MMU, "Loading page directory into CR3...\n");
     mmu_switch_address_space(kernel_address_space);
 
     // Now enable paging by setting CR0.PG bit
-    kprintf("[MMU] Enabling paging...\n");
+    log_debug(MMU, "Enabling paging...\n");
     uint32_t cr0;
     __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
-    cr0 |= (1 << 31);  // Set PG bit
+    cr0 |= CR0_PG | CR0_WP;  // Paging, and copy-on-write also for kernel writes
     __asm__ volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
 
-    kprintf("[MMU] Paging enabled successfully!\n");
-    kprintf("[MMU] Page size: %u bytes\n", (unsigned int)PAGE_SIZE);
-    kprintf("[MMU] Kernel page_table_t struct: %p\n",
+    log_info(MMU, "Paging enabled successfully!\n");
+    log_debug(MMU, "Page size: %u bytes\n", (unsigned int)PAGE_SIZE);
+    log_debug(MMU, "Kernel page_table_t struct: %p\n",
             (void*)kernel_address_space);
-    kprintf("[MMU] Page directory physical address (CR3): 0x%08x\n",
+    log_debug(MMU, "Page directory physical address (CR3): 0x%08x\n",
             (unsigned int)kernel_address_space->pd_phys);
 }
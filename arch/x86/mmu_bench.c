@@ -0,0 +1,56 @@
+/**
+ * Benchmarks for single-page map and unmap
+ *
+ * The page table covering the benchmark address is created in setup, so
+ * the samples measure the steady state: PTE write plus INVLPG.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/mmu.h>
+#include <kernel/pmm.h>
+#include <kernel/timer.h>
+
+// Far above the identity map and the user layout (next to mmu_test.c's)
+#define BENCH_VADDR 0x51000000u
+
+static page_table_t* bench_as;
+static phys_addr_t bench_frame;
+
+static int mmu_bench_setup(void) {
+    bench_as = mmu_get_kernel_address_space();
+    bench_frame = pmm_alloc_page();
+    if (!bench_frame) {
+        return -ENOMEM;
+    }
+    if (!mmu_map_page(bench_as, bench_frame, BENCH_VADDR, MMU_PRESENT | MMU_WRITABLE)) {
+        pmm_free_page(bench_frame);
+        return -ENOMEM;
+    }
+    mmu_unmap_page(bench_as, BENCH_VADDR);
+    return 0;
+}
+
+static void mmu_bench_teardown(void) {
+    pmm_free_page(bench_frame);
+}
+
+static uint64_t bench_map_page(void) {
+    uint64_t start = timer_read_tsc();
+    mmu_map_page(bench_as, bench_frame, BENCH_VADDR, MMU_PRESENT | MMU_WRITABLE);
+    uint64_t cycles = timer_read_tsc() - start;
+    mmu_unmap_page(bench_as, BENCH_VADDR);
+    return cycles;
+}
+
+static uint64_t bench_unmap_page(void) {
+    mmu_map_page(bench_as, bench_frame, BENCH_VADDR, MMU_PRESENT | MMU_WRITABLE);
+    uint64_t start = timer_read_tsc();
+    mmu_unmap_page(bench_as, BENCH_VADDR);
+    return timer_read_tsc() - start;
+}
+
+// Budgets from include/kernel/mmu.h
+KBENCH_DEFINE_SETUP("mmu", map_page, mmu_bench_setup, bench_map_page,
+                    mmu_bench_teardown, 200);
+KBENCH_DEFINE_SETUP("mmu", unmap_page, mmu_bench_setup, bench_unmap_page,
+                    mmu_bench_teardown, 100);
@@ -0,0 +1,68 @@
+/**
+ * Unit tests for demand paging
+ *
+ * These tests reserve regions in the kernel address space and touch them,
+ * so the real #PF handler in arch/x86/mmu.c commits the frames.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/mmu.h>
+#include <kernel/pmm.h>
+#include <kernel/types.h>
+
+// Far above the identity map and the user layout
+#define TEST_REGION_BASE 0x50000000u
+#define TEST_REGION_SIZE (16 * PAGE_SIZE)
+
+// Test: reserving commits nothing, each touched page commits one frame
+static int test_demand_commit(void) {
+    page_table_t* as = mmu_get_kernel_address_space();
+    struct pmm_stats before, after;
+
+    pmm_get_stats(&before);
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_REGION_BASE, TEST_REGION_SIZE,
+                                       MMU_WRITABLE), 0, "region reserved");
+    pmm_get_stats(&after);
+    KTEST_ASSERT_EQ(after.free_frames, before.free_frames, "reservation is free");
+
+    volatile uint32_t* first = (volatile uint32_t*)TEST_REGION_BASE;
+    volatile uint32_t* last = (volatile uint32_t*)(TEST_REGION_BASE + TEST_REGION_SIZE - 4);
+    KTEST_ASSERT_EQ(*first, 0, "fresh page reads as zero");
+    *last = 0xC0FFEE;
+    KTEST_ASSERT_EQ(*last, 0xC0FFEE, "written value sticks");
+
+    pmm_get_stats(&after);
+    // Two data frames plus the page table covering the region
+    KTEST_ASSERT_EQ(before.free_frames - after.free_frames, 3, "two pages committed");
+
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_REGION_BASE), 0, "region released");
+    pmm_get_stats(&after);
+    KTEST_ASSERT_EQ(before.free_frames - after.free_frames, 1, "data frames freed");
+    return KTEST_PASS;
+}
+
+// Test: bad and overlapping reservations are rejected
+static int test_region_validation(void) {
+    page_table_t* as = mmu_get_kernel_address_space();
+
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_REGION_BASE + 1, PAGE_SIZE, 0),
+                    -EINVAL, "misaligned start rejected");
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_REGION_BASE, 0, 0),
+                    -EINVAL, "empty region rejected");
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_REGION_BASE, TEST_REGION_SIZE, 0),
+                    0, "region reserved");
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_REGION_BASE + PAGE_SIZE, PAGE_SIZE, 0),
+                    -EBUSY, "overlap rejected");
+    KTEST_ASSERT_EQ(mmu_handle_fault(as, TEST_REGION_BASE, true, false),
+                    -EFAULT, "write to read-only region refused");
+    KTEST_ASSERT_EQ(mmu_handle_fault(as, TEST_REGION_BASE, false, true),
+                    -EFAULT, "user access to kernel region refused");
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_REGION_BASE + PAGE_SIZE),
+                    -EINVAL, "release needs the region start");
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_REGION_BASE), 0, "region released");
+    return KTEST_PASS;
+}
+
+// Register all tests
+KTEST_DEFINE("mmu", demand_commit, test_demand_commit);
+KTEST_DEFINE("mmu", region_validation, test_region_validation);
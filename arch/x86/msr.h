@@ -0,0 +1,36 @@
+/**
+ * x86 Model-Specific Registers (arch-private header)
+ *
+ * rdmsr/wrmsr are privileged and serializing (~100 cycles): use them in
+ * setup paths, not per context switch.
+ */
+
+#ifndef ARCH_X86_MSR_H
+#define ARCH_X86_MSR_H
+
+#include <kernel/types.h>
+
+#define MSR_IA32_SYSENTER_CS    0x174   // Kernel CS for SYSENTER (SS = CS + 8)
+#define MSR_IA32_SYSENTER_ESP   0x175   // Kernel ESP loaded by SYSENTER
+#define MSR_IA32_SYSENTER_EIP   0x176   // SYSENTER entry point
+#define MSR_IA32_TSC_AUX        0xC0000103  // Returned by RDTSCP in ECX
+
+// Architectural performance monitoring (CPUID leaf 0xA)
+#define MSR_IA32_PMC0           0x0C1   // General-purpose counter 0
+#define MSR_IA32_PERFEVTSEL0    0x186   // Event select for PMC0
+#define MSR_IA32_PERF_GLOBAL_STATUS   0x38E   // Overflow bits (version >= 2)
+#define MSR_IA32_PERF_GLOBAL_CTRL     0x38F   // Counter enables (version >= 2)
+#define MSR_IA32_PERF_GLOBAL_OVF_CTRL 0x390   // Clears overflow bits (version >= 2)
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value),
+                     "d"((uint32_t)(value >> 32)));
+}
+
+#endif // ARCH_X86_MSR_H
@@ -0,0 +1,219 @@
+/**
+ * x86 architectural PMU: sampling profiler (see include/kernel/pmu.h)
+ *
+ * Uses general-purpose counter 0 on every CPU. The counter is loaded
+ * with -period so it overflows after `period` events; the overflow NMI
+ * records a sample, reloads the counter and re-arms the LVT entry. AMD
+ * and pre-Core CPUs do not report leaf 0xA and get -ENODEV.
+ */
+
+#include <kernel/pmu.h>
+#include <kernel/hal.h>
+#include <kernel/idt.h>
+#include <kernel/lapic.h>
+#include <kernel/percpu.h>
+#include <kernel/spinlock.h>
+#include <kernel/task.h>
+#include <kernel/smp.h>
+#include <drivers/vga.h>
+#include "cpuid.h"
+#include "msr.h"
+
+#define CPUID_LEAF_PMU          0xA
+
+// IA32_PERFEVTSELx bits
+#define PERFEVTSEL_USR          (1u << 16)
+#define PERFEVTSEL_OS           (1u << 17)
+#define PERFEVTSEL_INT          (1u << 20)
+#define PERFEVTSEL_EN           (1u << 22)
+
+#define NMI_VECTOR              2
+
+// Event select and unit mask of the architectural events, in pmu_event_t
+// order (Intel SDM vol. 3B, table 20-1)
+static const struct {
+    uint8_t event;
+    uint8_t umask;
+} pmu_events[PMU_EVENT_COUNT] = {
+    [PMU_EVENT_CYCLES]         = { 0x3C, 0x00 },
+    [PMU_EVENT_INSTRUCTIONS]   = { 0xC0, 0x00 },
+    [PMU_EVENT_REF_CYCLES]     = { 0x3C, 0x01 },
+    [PMU_EVENT_LLC_REFERENCES] = { 0x2E, 0x4F },
+    [PMU_EVENT_LLC_MISSES]     = { 0x2E, 0x41 },
+    [PMU_EVENT_BRANCHES]       = { 0xC4, 0x00 },
+    [PMU_EVENT_BRANCH_MISSES]  = { 0xC5, 0x00 },
+};
+
+// What the calling CPU's counter is programmed for
+struct pmu_cpu {
+    uint32_t gen;           // pmu_gen applied
+    uint32_t event;
+    uint32_t period;        // 0 = off
+    uint64_t samples;
+} __attribute__((aligned(64)));
+
+static struct pmu_info pmu_info;
+static struct pmu_cpu pmu_cpus[MAX_CPUS];
+
+// Requested setting; writers hold pmu_lock, CPUs read it in pmu_sync()
+static spinlock_t pmu_lock = SPINLOCK_INIT;
+static volatile uint32_t pmu_gen;
+static volatile uint32_t pmu_req_event;
+static volatile uint32_t pmu_req_period;
+
+// Counter value that overflows after `period` more events
+static inline uint64_t pmu_reload(uint32_t period) {
+    uint64_t mask = pmu_info.width < 64 ? (1ull << pmu_info.width) - 1 : ~0ull;
+    return (0 - (uint64_t)period) & mask;
+}
+
+static bool pmu_overflowed(void) {
+    if (pmu_info.version >= 2) {
+        return (rdmsr(MSR_IA32_PERF_GLOBAL_STATUS) & 1) != 0;
+    }
+    // Counting up from -period: the top bit clears when it wraps
+    return !(rdmsr(MSR_IA32_PMC0) & (1ull << (pmu_info.width - 1)));
+}
+
+static void pmu_program(struct pmu_cpu* cpu, uint32_t event, uint32_t period) {
+    wrmsr(MSR_IA32_PERFEVTSEL0, 0);
+    cpu->period = 0;
+    if (period == 0) {
+        lapic_perf_nmi(false);
+        return;
+    }
+
+    cpu->event = event;
+    wrmsr(MSR_IA32_PMC0, pmu_reload(period));
+    if (pmu_info.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, rdmsr(MSR_IA32_PERF_GLOBAL_CTRL) | 1);
+    }
+    cpu->period = period;   // Before the first NMI can look at it
+    lapic_perf_nmi(true);
+    wrmsr(MSR_IA32_PERFEVTSEL0, pmu_events[event].event |
+                                ((uint32_t)pmu_events[event].umask << 8) |
+                                PERFEVTSEL_USR | PERFEVTSEL_OS |
+                                PERFEVTSEL_INT | PERFEVTSEL_EN);
+}
+
+/**
+ * NMI: a counter overflow, or something else (LINT1, watchdog) that is
+ * as fatal as it was before the profiler existed
+ */
+static void pmu_nmi_handler(struct interrupt_frame* frame) {
+    struct pmu_cpu* cpu = &pmu_cpus[hal->cpu_id()];
+
+    // gen != 0: this CPU's counter has been programmed at least once
+    if (cpu->gen == 0 || !pmu_overflowed()) {
+        extern void kernel_panic(const char* msg);
+        idt_dump_frame(frame);
+        kernel_panic("Unhandled exception");
+    }
+    if (cpu->period == 0) {
+        // Overflowed just before pmu_profile_stop() got here
+        if (pmu_info.version >= 2) {
+            wrmsr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+        }
+        return;
+    }
+
+    struct task* task = this_cpu()->current_task;
+    trace_event(TRACE_PROFILE_SAMPLE, frame->eip, task ? task->task_id : 0,
+                cpu->event, frame->cs & 3);
+    cpu->samples++;
+
+    wrmsr(MSR_IA32_PMC0, pmu_reload(cpu->period));
+    if (pmu_info.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+    }
+    lapic_perf_nmi(true);
+}
+
+int pmu_init(void) {
+    if (!lapic_available() || cpuid_max_leaf() < CPUID_LEAF_PMU) {
+        return -ENODEV;
+    }
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_LEAF_PMU, &eax, &ebx, &ecx, &edx);
+    uint32_t version = eax & 0xFF;
+    uint32_t counters = (eax >> 8) & 0xFF;
+    uint32_t width = (eax >> 16) & 0xFF;
+    uint32_t ebx_len = eax >> 24;
+    if (version == 0 || counters == 0 || width < 32 || width > 64) {
+        return -ENODEV;
+    }
+
+    // EBX: bit set = event not available
+    uint32_t events = 0;
+    for (uint32_t i = 0; i < PMU_EVENT_COUNT && i < ebx_len; i++) {
+        if (!(ebx & (1u << i))) {
+            events |= 1u << i;
+        }
+    }
+
+    pmu_info.version = version;
+    pmu_info.counters = counters;
+    pmu_info.width = width;
+    pmu_info.events = events;
+    idt_register_handler(NMI_VECTOR, pmu_nmi_handler);
+
+    kprintf("[PMU] Architectural PMU v%u: %u counters x %u bits, events 0x%02x\n",
+            (unsigned int)version, (unsigned int)counters, (unsigned int)width,
+            (unsigned int)events);
+    return 0;
+}
+
+void pmu_get_info(struct pmu_info* info) {
+    *info = pmu_info;
+}
+
+static void pmu_request(uint32_t event, uint32_t period) {
+    uint32_t flags = spin_lock_irqsave(&pmu_lock);
+    pmu_req_event = event;
+    pmu_req_period = period;
+    wmb();  // Setting before the generation that announces it
+    pmu_gen++;
+    spin_unlock(&pmu_lock);
+
+    pmu_sync();
+    hal->irq_restore(flags);
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        smp_send_reschedule(cpu);   // Skips the caller and offline CPUs
+    }
+}
+
+int pmu_profile_start(pmu_event_t event, uint32_t period) {
+    if (pmu_info.version == 0) {
+        return -ENODEV;
+    }
+    if ((uint32_t)event >= PMU_EVENT_COUNT || !(pmu_info.events & (1u << event)) ||
+        period < PMU_PERIOD_MIN || period > PMU_PERIOD_MAX) {
+        return -EINVAL;
+    }
+    pmu_request(event, period);
+    return 0;
+}
+
+void pmu_profile_stop(void) {
+    if (pmu_info.version != 0) {
+        pmu_request(0, 0);
+    }
+}
+
+void pmu_sync(void) {
+    uint32_t gen = pmu_gen;
+    struct pmu_cpu* cpu = &pmu_cpus[hal->cpu_id()];
+    if (gen == cpu->gen) {
+        return;
+    }
+    rmb();  // Generation before the setting it announces
+    cpu->gen = gen;
+    pmu_program(cpu, pmu_req_event, pmu_req_period);
+}
+
+uint64_t pmu_samples(uint32_t cpu_id) {
+    return cpu_id < MAX_CPUS ? pmu_cpus[cpu_id].samples : 0;
+}
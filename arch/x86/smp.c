@@ -0,0 +1,407 @@
+/**
+ * x86 SMP Support - CPU Discovery and AP Startup
+ *
+ * Finds the processors through the Intel MultiProcessor Specification
+ * tables, numbers them densely (boot CPU = 0), and starts application
+ * processors with INIT-SIPI-SIPI through a real-mode trampoline. The
+ * same tables describe the I/O APIC, which takes the ISA IRQs over from
+ * the PIC once the boot CPU's local APIC is up.
+ *
+ * cpu_id() is a LAPIC ID register read plus a table lookup: one uncached
+ * load, no CPUID and no serializing instruction.
+ *
+ * RT Constraints:
+ * - x86_smp_cpu_id(): O(1), one MMIO read
+ * - Discovery and AP boot are init-time only
+ */
+
+#include <kernel/smp.h>
+#include <kernel/hal.h>
+#include <kernel/lapic.h>
+#include <kernel/ioapic.h>
+#include <kernel/gdt.h>
+#include <kernel/idt.h>
+#include <kernel/fpu.h>
+#include <kernel/syscall.h>
+#include <kernel/pmm.h>
+#include <kernel/mmu.h>
+#include <kernel/percpu.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+// MP floating pointer structure ("_MP_")
+struct mp_floating {
+    char     signature[4];
+    uint32_t config_table;      // Physical address of the configuration table
+    uint8_t  length;            // In 16-byte units (1)
+    uint8_t  spec_rev;
+    uint8_t  checksum;
+    uint8_t  features[5];       // features[0] != 0: default config, no table
+} __attribute__((packed));
+
+// MP configuration table header ("PCMP")
+struct mp_config {
+    char     signature[4];
+    uint16_t length;            // Base table length including header
+    uint8_t  spec_rev;
+    uint8_t  checksum;
+    char     oem_id[8];
+    char     product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_addr;        // Physical address of the local APICs
+    uint16_t ext_length;
+    uint8_t  ext_checksum;
+    uint8_t  reserved;
+} __attribute__((packed));
+
+// Processor entry (type 0); every other base entry type is 8 bytes
+struct mp_processor {
+    uint8_t  type;
+    uint8_t  lapic_id;
+    uint8_t  lapic_version;
+    uint8_t  flags;             // MP_CPU_ENABLED | MP_CPU_BOOT
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} __attribute__((packed));
+
+// Bus entry (type 1)
+struct mp_bus {
+    uint8_t  type;
+    uint8_t  bus_id;
+    char     bus_type[6];       // "ISA   ", "PCI   ", ...
+} __attribute__((packed));
+
+// I/O APIC entry (type 2)
+struct mp_ioapic {
+    uint8_t  type;
+    uint8_t  id;
+    uint8_t  version;
+    uint8_t  flags;             // MP_IOAPIC_ENABLED
+    uint32_t addr;
+} __attribute__((packed));
+
+// I/O interrupt assignment entry (type 3)
+struct mp_irq {
+    uint8_t  type;
+    uint8_t  irq_type;          // MP_IRQ_INT for ordinary vectored interrupts
+    uint16_t flags;             // Polarity and trigger (IOAPIC_FLAG_*)
+    uint8_t  src_bus;
+    uint8_t  src_irq;
+    uint8_t  dst_ioapic;        // 0xFF = every I/O APIC
+    uint8_t  dst_pin;
+} __attribute__((packed));
+
+#define MP_ENTRY_PROCESSOR  0
+#define MP_ENTRY_BUS        1
+#define MP_ENTRY_IOAPIC     2
+#define MP_ENTRY_IO_IRQ     3
+#define MP_CPU_ENABLED      (1u << 0)
+#define MP_CPU_BOOT         (1u << 1)
+#define MP_IOAPIC_ENABLED   (1u << 0)
+#define MP_IRQ_INT          0
+#define MP_FEATURE_IMCR     0x80    // features[1]: IMCR present (PIC mode)
+#define MP_MAX_BUSES        32
+
+// The BIOS tables always lie inside the boot identity map
+#define MP_TABLE_LIMIT      (16u * 1024 * 1024)
+
+// AP boot stack (order 2 = 16KB, same as the boot CPU's stack)
+#define AP_STACK_ORDER      2
+#define AP_STACK_SIZE       ((1u << AP_STACK_ORDER) * PAGE_SIZE)
+
+// How long the boot CPU waits for a started AP to check in
+#define AP_CHECKIN_TIMEOUT_US 100000
+
+// Parameter block at the end of the trampoline (see ap_trampoline.s)
+struct ap_boot_params {
+    uint32_t cr0;
+    uint32_t cr3;
+    uint32_t cr4;
+    uint32_t stack;
+    uint32_t entry;
+};
+
+extern char ap_trampoline_start[];
+extern char ap_trampoline_params[];
+extern char ap_trampoline_end[];
+
+// Discovered CPUs: logical ID -> APIC ID, and back
+static uint32_t cpu_count = 1;
+static uint8_t cpu_apic_id[MAX_CPUS];
+static uint8_t apic_to_cpu[LAPIC_MAX_ID + 1];
+
+// Hand-off to the AP being started (one at a time)
+static volatile uint32_t ap_boot_cpu;
+static void (*volatile ap_boot_entry)(void);
+static volatile bool ap_checked_in;
+
+static bool checksum_ok(const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+static const struct mp_floating* mp_scan(uintptr_t start, size_t len) {
+    for (uintptr_t p = start; p + sizeof(struct mp_floating) <= start + len; p += 16) {
+        const struct mp_floating* mpf = (const struct mp_floating*)p;
+        if (memcmp(mpf->signature, "_MP_", 4) == 0 &&
+            checksum_ok(mpf, (size_t)mpf->length * 16)) {
+            return mpf;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Locate the MP floating pointer
+ *
+ * The spec's first search area, the EBDA, is found through the BIOS data
+ * area in page 0, which the kernel leaves unmapped. Its usual location,
+ * the last KB of base memory, is scanned instead, then the BIOS ROM.
+ */
+static const struct mp_floating* mp_find(void) {
+    const struct mp_floating* mpf = mp_scan(0x9FC00, 0x400);
+    if (!mpf) {
+        mpf = mp_scan(0xF0000, 0x10000);
+    }
+    return mpf;
+}
+
+/**
+ * Parse the MP configuration table
+ *
+ * Records every enabled processor's APIC ID in `apic_ids`, and the
+ * first enabled I/O APIC with the inputs of the ISA IRQs in `io`.
+ * Interrupt entries come after the bus and I/O APIC entries they refer
+ * to (MP spec 4.3).
+ *
+ * @param lapic_base Set to the table's local APIC address
+ * @return Number of enabled processors (0 if there is no usable table)
+ */
+static uint32_t mp_parse(phys_addr_t* lapic_base, uint8_t* apic_ids,
+                         struct ioapic_config* io) {
+    const struct mp_floating* mpf = mp_find();
+    if (!mpf || mpf->features[0] != 0 || mpf->config_table == 0 ||
+        mpf->config_table >= MP_TABLE_LIMIT) {
+        return 0;
+    }
+
+    const struct mp_config* cfg = (const struct mp_config*)(uintptr_t)mpf->config_table;
+    if (memcmp(cfg->signature, "PCMP", 4) != 0 ||
+        mpf->config_table + cfg->length > MP_TABLE_LIMIT ||
+        !checksum_ok(cfg, cfg->length)) {
+        return 0;
+    }
+
+    *lapic_base = cfg->lapic_addr;
+    io->imcr = (mpf->features[1] & MP_FEATURE_IMCR) != 0;
+
+    uint32_t found = 0;
+    uint32_t isa_buses = 0;
+    const uint8_t* entry = (const uint8_t*)(cfg + 1);
+    const uint8_t* end = (const uint8_t*)cfg + cfg->length;
+    for (uint16_t i = 0; i < cfg->entry_count && entry < end; i++) {
+        if (*entry == MP_ENTRY_BUS) {
+            const struct mp_bus* bus = (const struct mp_bus*)entry;
+            if (bus->bus_id < MP_MAX_BUSES && memcmp(bus->bus_type, "ISA", 3) == 0) {
+                isa_buses |= 1u << bus->bus_id;
+            }
+        } else if (*entry == MP_ENTRY_IOAPIC) {
+            const struct mp_ioapic* ioapic = (const struct mp_ioapic*)entry;
+            if ((ioapic->flags & MP_IOAPIC_ENABLED) && !io->base) {
+                io->base = ioapic->addr;
+                io->id = ioapic->id;
+            }
+        } else if (*entry == MP_ENTRY_IO_IRQ) {
+            const struct mp_irq* irq = (const struct mp_irq*)entry;
+            if (irq->irq_type == MP_IRQ_INT && irq->src_bus < MP_MAX_BUSES &&
+                (isa_buses & (1u << irq->src_bus)) && irq->src_irq < IOAPIC_ISA_IRQS &&
+                io->base && (irq->dst_ioapic == io->id || irq->dst_ioapic == 0xFF)) {
+                io->isa_pin[irq->src_irq] = irq->dst_pin;
+                io->isa_flags[irq->src_irq] = irq->flags;
+            }
+        }
+        if (*entry != MP_ENTRY_PROCESSOR) {
+            entry += 8;
+            continue;
+        }
+
+        const struct mp_processor* proc = (const struct mp_processor*)entry;
+        if ((proc->flags & MP_CPU_ENABLED) && found < MAX_CPUS) {
+            apic_ids[found++] = proc->lapic_id;
+        }
+        entry += sizeof(*proc);
+    }
+    return found;
+}
+
+static inline uint32_t read_cr0(void) {
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline uint32_t read_cr3(void) {
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t cr4;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+/**
+ * C entry point of every AP (called by the trampoline)
+ *
+ * Runs on the AP's boot stack with paging on and interrupts off. Sets up
+ * the CPU-local hardware state, checks in with the boot CPU, and hands
+ * over to the kernel's entry point.
+ */
+static void ap_start(void) {
+    uint32_t cpu_id = ap_boot_cpu;
+    void (*entry)(void) = ap_boot_entry;
+
+    gdt_init_cpu(cpu_id);
+    idt_load();
+    lapic_init_ap();
+    fpu_init_cpu();
+    syscall_init_cpu(cpu_id);
+
+    mb();
+    ap_checked_in = true;
+
+    entry();
+
+    while (1) {
+        hal->cpu_halt();
+    }
+}
+
+// ========== HAL entry points (see hal.c) ==========
+
+uint32_t x86_smp_detect(void) {
+    if (!(hal->cpu_features() & HAL_CPU_FEAT_APIC)) {
+        kprintf("[SMP] No local APIC, running on one CPU\n");
+        return cpu_count;
+    }
+
+    // Until lapic_init() maps the registers, cpu_id() reports 0
+    static uint8_t mp_apic_ids[MAX_CPUS];
+    phys_addr_t lapic_base = LAPIC_DEFAULT_BASE;
+    struct ioapic_config io;
+    ioapic_config_defaults(&io);
+    uint32_t found = mp_parse(&lapic_base, mp_apic_ids, &io);
+
+    if (lapic_init(lapic_base) < 0) {
+        kprintf("[SMP] Local APIC unavailable, running on one CPU\n");
+        return cpu_count;
+    }
+
+    // Boot CPU is logical CPU 0, the others follow in table order
+    uint8_t boot_apic_id = (uint8_t)lapic_id();
+    cpu_apic_id[0] = boot_apic_id;
+    apic_to_cpu[boot_apic_id] = 0;
+    for (uint32_t i = 0; i < found && cpu_count < MAX_CPUS; i++) {
+        if (mp_apic_ids[i] != boot_apic_id) {
+            cpu_apic_id[cpu_count] = mp_apic_ids[i];
+            apic_to_cpu[mp_apic_ids[i]] = (uint8_t)cpu_count;
+            cpu_count++;
+        }
+    }
+
+    if (found == 0) {
+        kprintf("[SMP] No MP configuration table, running on one CPU\n");
+    } else {
+        kprintf("[SMP] MP table: %u CPU(s), boot APIC ID %u\n",
+                (unsigned int)cpu_count, (unsigned int)boot_apic_id);
+    }
+
+    if (ioapic_init(&io) < 0) {
+        kprintf("[IOAPIC] Not available, ISA IRQs stay on the PIC\n");
+    }
+    return cpu_count;
+}
+
+uint32_t x86_smp_apic_id(uint32_t cpu_id) {
+    return cpu_id < cpu_count ? cpu_apic_id[cpu_id] : cpu_apic_id[0];
+}
+
+uint32_t x86_smp_cpu_id(void) {
+    if (!lapic_available()) {
+        return 0;
+    }
+    return apic_to_cpu[lapic_id()];
+}
+
+uint32_t x86_smp_num_cpus(void) {
+    return cpu_count;
+}
+
+void x86_smp_send_ipi(uint32_t cpu_id, uint8_t vector) {
+    if (cpu_id >= cpu_count || !lapic_available()) {
+        return;
+    }
+    lapic_send_ipi(cpu_apic_id[cpu_id], vector);
+}
+
+void x86_smp_broadcast_ipi(uint8_t vector) {
+    if (cpu_count > 1 && lapic_available()) {
+        lapic_broadcast_ipi(vector);
+    }
+}
+
+int x86_smp_boot_cpu(uint32_t cpu_id, void (*entry_point)(void)) {
+    if (cpu_id == 0 || cpu_id >= cpu_count || !entry_point) {
+        return -EINVAL;
+    }
+    if (!lapic_available()) {
+        return -ENODEV;
+    }
+
+    phys_addr_t stack = pmm_alloc_pages(AP_STACK_ORDER);
+    if (!stack) {
+        return -ENOMEM;
+    }
+
+    // Install the trampoline and this AP's parameters
+    size_t size = (size_t)(ap_trampoline_end - ap_trampoline_start);
+    memcpy((void*)(uintptr_t)SMP_TRAMPOLINE_ADDR, ap_trampoline_start, size);
+
+    struct ap_boot_params* params = (struct ap_boot_params*)(uintptr_t)
+        (SMP_TRAMPOLINE_ADDR + (uint32_t)(ap_trampoline_params - ap_trampoline_start));
+    params->cr0 = read_cr0();
+    params->cr3 = read_cr3();
+    params->cr4 = read_cr4();
+    params->stack = (uint32_t)stack + AP_STACK_SIZE;
+    params->entry = (uint32_t)(uintptr_t)ap_start;
+
+    ap_boot_cpu = cpu_id;
+    ap_boot_entry = entry_point;
+    ap_checked_in = false;
+    mb();
+
+    int rc = lapic_start_ap(cpu_apic_id[cpu_id], SMP_TRAMPOLINE_ADDR);
+    if (rc < 0) {
+        pmm_free_pages(stack, AP_STACK_ORDER);
+        return rc;
+    }
+
+    // The stack stays allocated even on timeout: the AP may still show up
+    uint64_t deadline = hal->timer_read_us() + AP_CHECKIN_TIMEOUT_US;
+    while (!ap_checked_in) {
+        if (hal->timer_read_us() > deadline) {
+            return -EIO;
+        }
+        __asm__ volatile("pause");
+    }
+    return 0;
+}
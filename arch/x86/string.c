@@ -0,0 +1,192 @@
+/**
+ * x86 Memory Operations
+ *
+ * memcpy, memmove and memset on the string instructions, and the
+ * fixed-size page operations (see include/lib/string.h).
+ *
+ * rep movsl/stosl move four bytes per iteration and, on every CPU since
+ * the P6, switch to the fast-string microcode for long counts; a leading
+ * rep movsb aligns the destination and a trailing one finishes the tail.
+ *
+ * The non-temporal page operations use MOVNTI (SSE2), which stores a
+ * general-purpose register around the caches. It needs no XMM register,
+ * so it never touches the lazily switched FPU state (kernel/fpu.h) and
+ * is safe in any context. Without SSE2 they fall back to the cached
+ * versions; x86_string_init() picks once at boot.
+ *
+ * RT Constraints:
+ * - All operations: O(n), no allocation, no locks
+ * - memzero_page()/memcpy_page(): fixed 4KB, one rep instruction
+ */
+
+#include <kernel/hal.h>
+#include <lib/string.h>
+
+#define PAGE_BYTES      4096
+
+// Below this a single rep movsb/stosb beats the three-step split
+#define STRING_SMALL    16
+
+static void memzero_page_cached(void* page);
+static void memcpy_page_cached(void* dst, const void* src);
+
+static void (*memzero_page_nt_fn)(void*) = memzero_page_cached;
+static void (*memcpy_page_nt_fn)(void*, const void*) = memcpy_page_cached;
+
+void* memcpy(void* dest, const void* src, size_t n) {
+    void* d = dest;
+    if (n < STRING_SMALL) {
+        __asm__ volatile("rep movsb"
+                         : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+        return dest;
+    }
+
+    size_t head = (0 - (uintptr_t)dest) & 3;
+    size_t words = (n - head) >> 2;
+    size_t tail = (n - head) & 3;
+    __asm__ volatile("rep movsb\n\t"
+                     "mov %[words], %%ecx\n\t"
+                     "rep movsl\n\t"
+                     "mov %[tail], %%ecx\n\t"
+                     "rep movsb"
+                     : "+D"(d), "+S"(src), "+c"(head)
+                     : [words] "r"(words), [tail] "r"(tail)
+                     : "memory");
+    return dest;
+}
+
+void* memmove(void* dest, const void* src, size_t n) {
+    uintptr_t d = (uintptr_t)dest;
+    uintptr_t s = (uintptr_t)src;
+    if (d <= s || d - s >= n) {
+        return memcpy(dest, src, n);   // Ascending copy never overwrites unread source
+    }
+
+    // Overlap with dest above src: copy from the top down
+    void* dp = (uint8_t*)dest + n - 1;
+    const void* sp = (const uint8_t*)src + n - 1;
+    size_t tail = n & 3;
+    __asm__ volatile("std\n\t"
+                     "rep movsb\n\t"
+                     "sub $3, %%esi\n\t"
+                     "sub $3, %%edi\n\t"
+                     "mov %[words], %%ecx\n\t"
+                     "rep movsl\n\t"
+                     "cld"
+                     : "+D"(dp), "+S"(sp), "+c"(tail)
+                     : [words] "r"(n >> 2)
+                     : "memory", "cc");
+    return dest;
+}
+
+void* memset(void* ptr, int value, size_t n) {
+    void* p = ptr;
+    uint32_t v = (uint8_t)value * 0x01010101u;
+    if (n < STRING_SMALL) {
+        __asm__ volatile("rep stosb"
+                         : "+D"(p), "+c"(n) : "a"(v) : "memory");
+        return ptr;
+    }
+
+    size_t head = (0 - (uintptr_t)ptr) & 3;
+    size_t words = (n - head) >> 2;
+    size_t tail = (n - head) & 3;
+    __asm__ volatile("rep stosb\n\t"
+                     "mov %[words], %%ecx\n\t"
+                     "rep stosl\n\t"
+                     "mov %[tail], %%ecx\n\t"
+                     "rep stosb"
+                     : "+D"(p), "+c"(head)
+                     : "a"(v), [words] "r"(words), [tail] "r"(tail)
+                     : "memory");
+    return ptr;
+}
+
+static void memzero_page_cached(void* page) {
+    size_t words = PAGE_BYTES / 4;
+    __asm__ volatile("rep stosl"
+                     : "+D"(page), "+c"(words) : "a"(0) : "memory");
+}
+
+static void memcpy_page_cached(void* dst, const void* src) {
+    size_t words = PAGE_BYTES / 4;
+    __asm__ volatile("rep movsl"
+                     : "+D"(dst), "+S"(src), "+c"(words) : : "memory");
+}
+
+// 64 bytes per iteration; the sfence orders the weakly ordered stores
+// before whatever publishes the page
+static void memzero_page_movnti(void* page) {
+    uint32_t lines = PAGE_BYTES / 64;
+    __asm__ volatile("1:\n\t"
+                     "movnti %[zero], 0(%[p])\n\t"
+                     "movnti %[zero], 4(%[p])\n\t"
+                     "movnti %[zero], 8(%[p])\n\t"
+                     "movnti %[zero], 12(%[p])\n\t"
+                     "movnti %[zero], 16(%[p])\n\t"
+                     "movnti %[zero], 20(%[p])\n\t"
+                     "movnti %[zero], 24(%[p])\n\t"
+                     "movnti %[zero], 28(%[p])\n\t"
+                     "movnti %[zero], 32(%[p])\n\t"
+                     "movnti %[zero], 36(%[p])\n\t"
+                     "movnti %[zero], 40(%[p])\n\t"
+                     "movnti %[zero], 44(%[p])\n\t"
+                     "movnti %[zero], 48(%[p])\n\t"
+                     "movnti %[zero], 52(%[p])\n\t"
+                     "movnti %[zero], 56(%[p])\n\t"
+                     "movnti %[zero], 60(%[p])\n\t"
+                     "add $64, %[p]\n\t"
+                     "dec %[lines]\n\t"
+                     "jnz 1b\n\t"
+                     "sfence"
+                     : [p] "+r"(page), [lines] "+r"(lines)
+                     : [zero] "r"(0)
+                     : "memory", "cc");
+}
+
+// Cached loads, non-temporal stores, 16 bytes per iteration
+static void memcpy_page_movnti(void* dst, const void* src) {
+    uint32_t chunks = PAGE_BYTES / 16;
+    uint32_t a, b;
+    __asm__ volatile("1:\n\t"
+                     "mov 0(%[s]), %[a]\n\t"
+                     "mov 4(%[s]), %[b]\n\t"
+                     "movnti %[a], 0(%[d])\n\t"
+                     "movnti %[b], 4(%[d])\n\t"
+                     "mov 8(%[s]), %[a]\n\t"
+                     "mov 12(%[s]), %[b]\n\t"
+                     "movnti %[a], 8(%[d])\n\t"
+                     "movnti %[b], 12(%[d])\n\t"
+                     "add $16, %[s]\n\t"
+                     "add $16, %[d]\n\t"
+                     "dec %[n]\n\t"
+                     "jnz 1b\n\t"
+                     "sfence"
+                     : [d] "+r"(dst), [s] "+r"(src), [n] "+r"(chunks),
+                       [a] "=&r"(a), [b] "=&r"(b)
+                     :
+                     : "memory", "cc");
+}
+
+void memzero_page(void* page) {
+    memzero_page_cached(page);
+}
+
+void memcpy_page(void* dst, const void* src) {
+    memcpy_page_cached(dst, src);
+}
+
+void memzero_page_nt(void* page) {
+    memzero_page_nt_fn(page);
+}
+
+void memcpy_page_nt(void* dst, const void* src) {
+    memcpy_page_nt_fn(dst, src);
+}
+
+void x86_string_init(void) {
+    if (hal->cpu_features() & HAL_CPU_FEAT_SSE2) {
+        memzero_page_nt_fn = memzero_page_movnti;
+        memcpy_page_nt_fn = memcpy_page_movnti;
+    }
+}
@@ -1,5 +1,5 @@
 /**
- * x86 Syscall Entry/Exit (INT 0x80)
+ * x86 Syscall Entry/Exit (INT 0x80 and SYSENTER)
  *
  * This is the low-level assembly for system call entry and exit.
  *
@@ -75,8 +75,10 @@ syscall_entry_int80:
     # Need to reload from stack
     movl 20(%esp), %esi     # arg3 (from saved ESI)
     movl 16(%esp), %edi     # arg4 (from saved EDI)
+    leal 16(%esp), %ebp     # struct syscall_regs (the pushal frame)
 
     # Now push arguments in reverse order for C calling convention
+    pushl %ebp              # regs
     pushl %edi              # arg4
     pushl %esi              # arg3
     pushl %edx              # arg2
@@ -84,11 +86,12 @@ syscall_entry_int80:
     pushl %ebx              # arg0
     pushl %eax              # syscall_num
 
-    # Call C handler
+    # Call C handler (user code may have left DF set)
+    cld
     call syscall_handler
 
-    # Clean up arguments (6 * 4 = 24 bytes)
-    addl $24, %esp
+    # Clean up arguments (7 * 4 = 28 bytes)
+    addl $28, %esp
 
     # Return value is in EAX, we need to update the saved EAX on stack
     # Stack layout (ESP points here):
@@ -119,6 +122,60 @@ syscall_entry_int80:
     # Return to caller (restores EFLAGS, CS, EIP, and SS/ESP if from ring 3)
     iret
 
+/**
+ * SYSENTER entry point (fast path, see arch/x86/sysenter.c)
+ *
+ * CPU has already:
+ * - Loaded CS = SYSENTER_CS, SS = SYSENTER_CS + 8
+ * - Loaded ESP = SYSENTER_ESP: the top word of this CPU's entry stack,
+ *   which holds the address of its TSS.esp0
+ * - Cleared IF (but not TF, NT or AC)
+ * It saved nothing: ECX/EDX hold the user ESP/EIP to resume with.
+ *
+ * The user's TF/NT/AC are cleared before anything else; a single-step
+ * trap taken before that lands on the entry stack and is dropped by the
+ * #DB handler (sysenter.c). SYSEXIT does not reload EFLAGS, so the user
+ * resumes with them clear.
+ *
+ * pushal saves the user registers as struct syscall_regs, so syscalls
+ * that return words in EBX/ESI/EDI (IPC) work on this path too; ECX/EDX
+ * come back as saved. DS/ES stay at the flat user data segment, so there
+ * is no segment reload.
+ */
+.global syscall_entry_sysenter
+syscall_entry_sysenter:
+    pushfl
+    andl $~0x00044100, (%esp)   # Clear AC (18), NT (14), TF (8)
+    popfl
+.global syscall_sysenter_flags_clear
+syscall_sysenter_flags_clear:
+    movl (%esp), %esp       # &TSS.esp0
+    movl (%esp), %esp       # Current task's kernel stack top
+
+    pushal                  # ECX/EDX = user ESP/EIP (for SYSEXIT)
+    movl %esp, %ecx         # struct syscall_regs
+
+    # syscall_handler(num, arg0, arg1, arg2, arg3, arg4, regs)
+    pushl %ecx              # regs
+    pushl $0                # arg4 (not carried)
+    pushl %ebp              # arg3
+    pushl %edi              # arg2
+    pushl %esi              # arg1
+    pushl %ebx              # arg0
+    pushl %eax              # syscall_num
+
+    cld                     # User code may have left DF set
+    call syscall_handler
+
+    addl $28, %esp          # Drop arguments
+    movl %eax, 28(%esp)     # Return value into the saved EAX
+    popal                   # EDX = user EIP, ECX = user ESP
+
+    # STI takes effect after the next instruction: no interrupt can
+    # arrive on the kernel stack between here and ring 3
+    sti
+    sysexit
+
 /**
  * syscall_int80 - Helper for testing INT 0x80 from C code
  *
@@ -0,0 +1,78 @@
+/**
+ * x86 SYSENTER/SYSEXIT Fast System Call Setup
+ *
+ * SYSENTER loads CS/EIP/ESP from MSRs and saves nothing. SYSENTER_ESP
+ * points at the top of a small per-CPU entry stack whose last word holds
+ * the address of the CPU's TSS.esp0 slot, so the entry stub (syscall.s)
+ * reaches the running task's kernel stack with two loads and no MSR write
+ * is needed per context switch. The entry stack only ever carries the
+ * stub's EFLAGS scrub and whatever #DB or NMI lands before the switch; it
+ * keeps those frames off the TSS. SYSEXIT derives the user selectors from
+ * SYSENTER_CS: CS = +16 (GDT_USER_CODE_SEL), SS = +24 (GDT_USER_DATA_SEL),
+ * which matches the GDT layout.
+ *
+ * SYSENTER does not clear TF: a user that executes it with TF set takes a
+ * single-step #DB on the first instruction of the stub, in ring 0 and on
+ * the entry stack. sysenter_debug_handler() recognises that window and
+ * drops the trap; the stub then clears TF itself.
+ */
+
+#include <kernel/syscall.h>
+#include <kernel/hal.h>
+#include <kernel/gdt.h>
+#include <kernel/idt.h>
+#include <kernel/mmu.h>
+#include <kernel/pmm.h>
+#include "msr.h"
+
+#define DEBUG_VECTOR    1
+#define EFLAGS_TF       (1u << 8)
+
+extern void syscall_entry_sysenter(void);
+extern void syscall_sysenter_flags_clear(void);
+
+/**
+ * #DB handler: drop single-steps taken inside the SYSENTER prologue
+ *
+ * Any other #DB has no consumer (there is no debugger interface) and is
+ * reported like an unhandled exception.
+ */
+static void sysenter_debug_handler(struct interrupt_frame* frame) {
+    uintptr_t eip = frame->eip;
+
+    if (frame->cs == GDT_KERNEL_CODE_SEL &&
+        eip >= (uintptr_t)syscall_entry_sysenter &&
+        eip <= (uintptr_t)syscall_sysenter_flags_clear) {
+        frame->eflags &= ~EFLAGS_TF;
+        return;
+    }
+
+    idt_dump_frame(frame);
+    hal->panic("Unhandled debug exception");
+}
+
+bool syscall_init_cpu(uint32_t cpu_id) {
+    if (!(hal->cpu_features() & HAL_CPU_FEAT_SEP)) {
+        return false;
+    }
+
+    uintptr_t esp0_slot = gdt_kernel_stack_slot(cpu_id);
+    if (!esp0_slot) {
+        return false;
+    }
+
+    phys_addr_t stack = pmm_alloc_page();
+    if (!stack) {
+        return false;
+    }
+    uintptr_t* top = (uintptr_t*)(uintptr_t)(stack + PAGE_SIZE) - 1;
+    *top = esp0_slot;
+
+    // Shared IDT: every CPU installs the same handler
+    idt_register_handler(DEBUG_VECTOR, sysenter_debug_handler);
+
+    wrmsr(MSR_IA32_SYSENTER_CS, GDT_KERNEL_CODE_SEL);
+    wrmsr(MSR_IA32_SYSENTER_ESP, (uintptr_t)top);
+    wrmsr(MSR_IA32_SYSENTER_EIP, (uintptr_t)syscall_entry_sysenter);
+    return true;
+}
@@ -3,8 +3,14 @@
  *
  * This driver:
  * 1. Initializes the 8254 PIT at a specified frequency
- * 2. Calibrates the TSC (Time Stamp Counter) against the PIT
- * 3. Provides microsecond-precision timing via calibrated TSC
+ * 2. Takes the TSC (Time Stamp Counter) rate from CPUID when the CPU or
+ *    hypervisor reports it, else calibrates the TSC against the PIT
+ * 3. Provides nanosecond/microsecond timing via calibrated TSC, as the
+ *    "tsc" clock source (kernel/clocksource.h); the periodic tick is the
+ *    fallback when the TSC could not be calibrated
+ * 4. In tickless mode (CONFIG_TICKLESS), arms one interrupt per CPU for
+ *    its next event instead of ticking: PIT mode 0 on the boot CPU, the
+ *    local APIC timer on APs
  *
  * Real-time constraints:
  * - Timer interrupt handler must be <100 cycles
@@ -17,7 +23,14 @@
 #include <kernel/percpu.h>
 #include <kernel/scheduler.h>
 #include <kernel/idt.h>
+#include <kernel/lapic.h>
+#include <kernel/ktimer.h>
+#include <kernel/clocksource.h>
+#include <kernel/config.h>
+#include <kernel/log.h>
 #include <drivers/vga.h>
+#include "msr.h"
+#include "cpuid.h"
 
 // ========== PIT Hardware Constants ==========
 
@@ -29,6 +42,7 @@
 
 // PIT command byte bits
 #define PIT_CMD_BINARY      0x00    // Binary mode (vs BCD)
+#define PIT_CMD_MODE0       0x00    // Mode 0: Interrupt on terminal count
 #define PIT_CMD_MODE2       0x04    // Mode 2: Rate generator
 #define PIT_CMD_MODE3       0x06    // Mode 3: Square wave
 #define PIT_CMD_RW_BOTH     0x30    // Read/Write LSB then MSB
@@ -37,14 +51,50 @@
 // PIT base frequency (Hz)
 #define PIT_BASE_FREQ   1193182
 
-// Calibration duration (in PIT ticks)
-// At 1000 Hz, 50 ticks = 50ms calibration period
-#define CALIBRATION_TICKS   50
+// PIT counts per microsecond, 32.32 fixed point (folded at compile time)
+#define PIT_US_MULT     (((uint64_t)PIT_BASE_FREQ << 32) / 1000000)
+
+// Longest PIT one-shot: 65535 counts (~54.9ms)
+#define PIT_ONESHOT_MAX_US  54000
+
+// Shortest one-shot delay, so a deadline already due still interrupts
+#define TIMER_MIN_DELAY_US  2
+
+// Calibration duration (in timer periods), only without a CPUID rate
+// At 1000 Hz, 10 ticks = 10ms: +-1 PIT count is under 100 ppm
+#define CALIBRATION_TICKS   10
+
+// TSC rate enumeration
+#define CPUID_LEAF_TSC          0x15        // TSC/crystal ratio, crystal Hz
+#define CPUID_LEAF_FREQ         0x16        // Base frequency in MHz
+#define CPUID_LEAF_HV           0x40000000  // Hypervisor max leaf + vendor
+#define CPUID_LEAF_HV_TIMING    0x40000010  // VMware/KVM: TSC in kHz
+#define CPUID_ECX_HYPERVISOR    (1u << 31)
+#define HV_VENDOR_VMWARE        0x61774D56  // "VMwa"
+#define HV_VENDOR_KVM           0x4B4D564B  // "KVMK"
 
 // ========== Global State ==========
 
 static uint64_t tsc_freq_hz = 0;        // TSC frequency in Hz (calibrated)
 static uint32_t timer_freq_hz = 0;      // Timer interrupt frequency
+static uint32_t pit_divisor = 0;        // Channel 0 reload value (periodic)
+
+static uint64_t tick_read(void) {
+    return per_cpu[0]->ticks;
+}
+
+// Boot CPU's periodic tick: 1/frequency resolution, only if calibration fails
+static struct clocksource tick_clocksource = {
+    .name = "tick",
+    .read = tick_read,
+    .rating = CLOCKSOURCE_RATING_TICK,
+};
+
+static struct clocksource tsc_clocksource = {
+    .name = "tsc",
+    .read = timer_read_tsc,
+    .rating = CLOCKSOURCE_RATING_TSC,
+};
 
 // ========== PIT Operations ==========
 
@@ -62,6 +112,7 @@ static void pit_init(uint32_t frequency_hz) {
     if (divisor < 1) {
         divisor = 1;
     }
+    pit_divisor = divisor;
 
     // Configure PIT channel 0: Rate generator, binary mode, LSB+MSB
     uint8_t command = PIT_CMD_CHANNEL0 | PIT_CMD_RW_BOTH | PIT_CMD_MODE2 | PIT_CMD_BINARY;
@@ -73,83 +124,227 @@ static void pit_init(uint32_t frequency_hz) {
 }
 
 /**
- * Wait for a specified number of PIT ticks
- * Used during TSC calibration
+ * Arm PIT channel 0 for a single interrupt after delay_us
+ *
+ * Mode 0 raises IRQ 0 once at terminal count and then stays quiet, so
+ * loading a new count is all it takes to re-arm.
  */
-static void pit_wait_ticks(uint32_t ticks) {
-    // Read current PIT counter value
-    // We need to send a latch command first
-    hal->io_outb(PIT_COMMAND, 0x00);  // Latch channel 0
+static void pit_oneshot(uint32_t delay_us) {
+    if (delay_us > PIT_ONESHOT_MAX_US) {
+        delay_us = PIT_ONESHOT_MAX_US;
+    }
+    uint32_t count = (uint32_t)(((uint64_t)delay_us * PIT_US_MULT) >> 32);
+    if (count == 0) {
+        count = 1;
+    }
+
+    hal->io_outb(PIT_COMMAND, PIT_CMD_CHANNEL0 | PIT_CMD_RW_BOTH |
+                              PIT_CMD_MODE0 | PIT_CMD_BINARY);
+    hal->io_outb(PIT_CHANNEL0, (uint8_t)(count & 0xFF));
+    hal->io_outb(PIT_CHANNEL0, (uint8_t)((count >> 8) & 0xFF));
+}
 
+/**
+ * Stop PIT channel 0
+ *
+ * Writing the mode word alone halts mode 0 until a count is loaded.
+ */
+static void pit_stop(void) {
+    hal->io_outb(PIT_COMMAND, PIT_CMD_CHANNEL0 | PIT_CMD_RW_BOTH |
+                              PIT_CMD_MODE0 | PIT_CMD_BINARY);
+}
+
+/**
+ * Wait until at least `counts` PIT input clocks have passed
+ * Used during TSC calibration (channel 0 in periodic mode)
+ *
+ * @return Input clocks actually waited
+ */
+static uint32_t pit_wait_counts(uint32_t counts) {
+    hal->io_outb(PIT_COMMAND, 0x00);  // Latch channel 0
     uint8_t low = hal->io_inb(PIT_CHANNEL0);
     uint8_t high = hal->io_inb(PIT_CHANNEL0);
-    uint16_t start_count = (high << 8) | low;
-
-    // Calculate target count
-    // Note: PIT counts DOWN, so we need to handle wraparound
-    uint32_t total_ticks = 0;
-    uint16_t last_count = start_count;
+    uint16_t last_count = (high << 8) | low;
 
-    while (total_ticks < ticks) {
-        // Read current count
+    // The counter runs down from pit_divisor and reloads at zero
+    uint32_t elapsed = 0;
+    while (elapsed < counts) {
         hal->io_outb(PIT_COMMAND, 0x00);  // Latch channel 0
         low = hal->io_inb(PIT_CHANNEL0);
         high = hal->io_inb(PIT_CHANNEL0);
         uint16_t current_count = (high << 8) | low;
 
-        // Calculate ticks elapsed (handle countdown)
         if (current_count > last_count) {
-            // Wrapped around (reached 0 and reloaded)
-            total_ticks += (last_count + (65536 - current_count));
+            elapsed += last_count + (pit_divisor - current_count);
         } else {
-            total_ticks += (last_count - current_count);
+            elapsed += last_count - current_count;
         }
-
         last_count = current_count;
     }
+    return elapsed;
+}
+
+/**
+ * TSC rate reported by CPUID, 0 if not enumerated
+ *
+ * In order of trust: the hypervisor timing leaf (the host's measured
+ * rate), then leaf 0x15 (crystal x ratio; when the crystal is not
+ * enumerated the TSC runs at the leaf 0x16 base frequency). Leaf 0x16
+ * alone does not say the TSC runs at base, so it is not used by itself.
+ * Platform MSRs (MSR_PLATFORM_INFO) are model-specific and fault where
+ * missing, so they are not probed.
+ */
+static uint64_t tsc_freq_from_cpuid(void) {
+    uint32_t max_leaf = cpuid_max_leaf();
+    uint32_t eax, ebx, ecx, edx;
+    if (max_leaf < 1) {
+        return 0;
+    }
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (ecx & CPUID_ECX_HYPERVISOR) {
+        cpuid(CPUID_LEAF_HV, &eax, &ebx, &ecx, &edx);
+        if (eax >= CPUID_LEAF_HV_TIMING &&
+            (ebx == HV_VENDOR_VMWARE || ebx == HV_VENDOR_KVM)) {
+            cpuid(CPUID_LEAF_HV_TIMING, &eax, &ebx, &ecx, &edx);
+            if (eax) {
+                return (uint64_t)eax * 1000;
+            }
+        }
+    }
+
+    if (max_leaf < CPUID_LEAF_TSC) {
+        return 0;
+    }
+    uint32_t denominator, numerator, crystal_hz;
+    cpuid(CPUID_LEAF_TSC, &denominator, &numerator, &crystal_hz, &edx);
+    if (denominator == 0 || numerator == 0) {
+        return 0;
+    }
+    if (crystal_hz) {
+        return (uint64_t)crystal_hz * numerator / denominator;
+    }
+
+    if (max_leaf < CPUID_LEAF_FREQ) {
+        return 0;
+    }
+    cpuid(CPUID_LEAF_FREQ, &eax, &ebx, &ecx, &edx);
+    return (uint64_t)(eax & 0xFFFF) * 1000000;
 }
 
 /**
- * Calibrate TSC frequency against PIT
+ * Determine the TSC frequency
  *
- * Measures TSC cycles over a known PIT period to determine TSC frequency.
- * This is critical for accurate microsecond timing.
+ * Uses the CPUID rate when there is one (no wait at all); otherwise
+ * measures TSC cycles over a known PIT period with interrupts off.
  */
 static void calibrate_tsc(void) {
-    kprintf("[TIMER] Calibrating TSC...\n");
+    tsc_freq_hz = tsc_freq_from_cpuid();
+    if (tsc_freq_hz) {
+        kprintf("[TIMER] TSC from CPUID: %lu MHz (%llu Hz)\n",
+                (unsigned long)(tsc_freq_hz / 1000000),
+                tsc_freq_hz);
+        return;
+    }
+
+    log_debug(TIMER, "Calibrating TSC...\n");
 
     // Disable interrupts during calibration
     uint32_t flags = hal->irq_disable();
 
-    // Read TSC at start
+    // TSC cycles over CALIBRATION_TICKS timer periods of PIT input clocks
     uint64_t tsc_start = hal->timer_read_tsc();
-
-    // Wait for CALIBRATION_TICKS PIT ticks
-    pit_wait_ticks(CALIBRATION_TICKS);
-
-    // Read TSC at end
+    uint32_t counts = pit_wait_counts(CALIBRATION_TICKS * pit_divisor);
     uint64_t tsc_end = hal->timer_read_tsc();
 
     // Restore interrupts
     hal->irq_restore(flags);
 
-    // Calculate TSC cycles elapsed
-    uint64_t tsc_cycles = tsc_end - tsc_start;
-
-    // Calculate time elapsed in microseconds
-    // time_us = (CALIBRATION_TICKS * 1000000) / timer_freq_hz
-    uint64_t time_us = ((uint64_t)CALIBRATION_TICKS * 1000000ULL) / timer_freq_hz;
-
-    // Calculate TSC frequency: cycles / time_in_seconds
-    // tsc_freq = tsc_cycles / (time_us / 1000000)
-    //          = (tsc_cycles * 1000000) / time_us
-    tsc_freq_hz = (tsc_cycles * 1000000ULL) / time_us;
+    // tsc_freq = cycles / (counts / PIT_BASE_FREQ), in whole Hz
+    tsc_freq_hz = ((tsc_end - tsc_start) * PIT_BASE_FREQ) / counts;
 
     kprintf("[TIMER] TSC calibrated: %lu MHz (%llu Hz)\n",
             (unsigned long)(tsc_freq_hz / 1000000),
             tsc_freq_hz);
 }
 
+/**
+ * Tag the calling CPU's TSC reads with its logical ID
+ *
+ * RDTSCP returns IA32_TSC_AUX in ECX, which is how user code finds its
+ * CPU in the kernel data page (kernel/vdso.h) without a syscall.
+ */
+static void tsc_aux_init(void) {
+    if (hal->cpu_features() & HAL_CPU_FEAT_RDTSCP) {
+        wrmsr(MSR_IA32_TSC_AUX, this_cpu()->cpu_id);
+    }
+}
+
+// ========== One-shot Event Programming ==========
+
+/**
+ * Program the calling CPU's one-shot for an absolute deadline
+ *
+ * Deadlines beyond what the hardware can count to are armed at the
+ * hardware limit; that interrupt finds nothing due and re-arms.
+ */
+static void timer_program(struct per_cpu_data* cpu, uint64_t deadline_us) {
+    if (deadline_us == TIMER_NO_EVENT) {
+        cpu->timer_deadline_us = 0;
+        if (cpu->cpu_id == 0) {
+            pit_stop();
+        } else {
+            lapic_timer_stop();
+        }
+        return;
+    }
+
+    uint64_t now = timer_read_us();
+    uint64_t delay = deadline_us > now ? deadline_us - now : 0;
+    if (delay < TIMER_MIN_DELAY_US) {
+        delay = TIMER_MIN_DELAY_US;
+    }
+
+    uint32_t max_us = cpu->cpu_id == 0 ? PIT_ONESHOT_MAX_US : LAPIC_ONESHOT_MAX_US;
+    if (delay > max_us) {
+        delay = max_us;
+    }
+
+    cpu->timer_deadline_us = now + delay;
+    if (cpu->cpu_id == 0) {
+        pit_oneshot((uint32_t)delay);
+    } else {
+        lapic_timer_oneshot((uint32_t)delay);
+    }
+}
+
+/**
+ * Earliest event the calling CPU must wake up for
+ *
+ * The running task's slice end, or the next kernel timer (which also
+ * covers sleeping tasks), whichever comes first.
+ */
+static uint64_t timer_next_event(void) {
+    uint64_t sched = scheduler_next_event_us();
+    uint64_t ktimer = ktimer_next_deadline_us();
+    return sched < ktimer ? sched : ktimer;
+}
+
+bool timer_is_tickless(void) {
+    return CONFIG_TICKLESS != 0;
+}
+
+void timer_event_update(uint64_t deadline_us) {
+    if (!timer_is_tickless() || deadline_us == TIMER_NO_EVENT) {
+        return;
+    }
+
+    struct per_cpu_data* cpu = this_cpu();
+    if (cpu->timer_deadline_us == 0 || deadline_us < cpu->timer_deadline_us) {
+        timer_program(cpu, deadline_us);
+    }
+}
+
 // ========== Public Timer API ==========
 
 /**
@@ -157,7 +352,7 @@ static void calibrate_tsc(void) {
  *
  * Steps:
  * 1. Initialize PIT at specified frequency
- * 2. Calibrate TSC against PIT
+ * 2. Determine the TSC rate (CPUID, else calibrate against the PIT)
  * 3. Register timer interrupt handler
  */
 void timer_init(uint32_t frequency_hz) {
@@ -170,23 +365,53 @@ void timer_init(uint32_t frequency_hz) {
 
     // Calibrate TSC for microsecond timing
     calibrate_tsc();
+    tsc_aux_init();
+
+    // Timebase: the TSC at its calibrated rate (TSC zero is time zero,
+    // like the kernel data page), else the periodic tick
+    if (!timer_is_tickless()) {
+        tick_clocksource.freq_hz = frequency_hz;
+        clocksource_register(&tick_clocksource);
+    }
+    tsc_clocksource.freq_hz = tsc_freq_hz;
+    if (clocksource_register(&tsc_clocksource) < 0) {
+        kprintf("[TIMER] WARNING: TSC not calibrated\n");
+    }
+    kprintf("[TIMER] Clock source: %s\n", clocksource_active->name);
+
+    // Calibration needs the periodic count; afterwards the PIT only
+    // fires for armed events, starting with one slice from now
+    if (timer_is_tickless()) {
+        kprintf("[TIMER] Tickless mode (PIT one-shot)\n");
+        timer_program(this_cpu(), timer_read_us() + (1000000u / frequency_hz));
+    }
 
     // Register timer interrupt handler (IRQ 0 -> INT 32)
     // Note: PIC remapping maps IRQ 0 to INT 32
     hal->irq_register(32, timer_interrupt_handler);
 
-    // Unmask IRQ 0 in the PIC so timer interrupts can fire
-    // By default, all IRQs are masked (0xFF) after pic_remap()
-    uint8_t mask_before = hal->io_inb(0x21);
-    kprintf("[TIMER] PIC mask before: 0x%02x\n", mask_before);
-
+    // Unmask IRQ 0 so timer interrupts can fire (all IRQs are masked
+    // after pic_remap(); ioapic_init() keeps this one unmasked)
     irq_clear_mask(0);
-
-    uint8_t mask_after = hal->io_inb(0x21);
-    kprintf("[TIMER] PIC mask after: 0x%02x\n", mask_after);
     kprintf("[TIMER] Timer initialized successfully (IRQ 0 unmasked)\n");
 }
 
+/**
+ * Start the calling AP's tick
+ *
+ * APs do not see the PIT; each runs its local APIC timer at the boot
+ * CPU's rate and shares timer_interrupt_handler(). In tickless mode the
+ * timer stays off until the scheduler asks for an event.
+ */
+int timer_init_ap(uint32_t frequency_hz) {
+    tsc_aux_init();
+    hal->irq_register(LAPIC_TIMER_VECTOR, timer_interrupt_handler);
+    if (timer_is_tickless()) {
+        return lapic_timer_oneshot(0) < 0 ? -ENODEV : 0;
+    }
+    return lapic_timer_start(frequency_hz);
+}
+
 /**
  * Read TSC (Time Stamp Counter)
  *
@@ -201,23 +426,26 @@ uint64_t timer_read_tsc(void) {
 /**
  * Read time in microseconds
  *
- * Uses calibrated TSC frequency to convert cycles to microseconds.
+ * Converts the active clock source (normally the TSC) with the
+ * multiply-shift computed at calibration: no division.
  * This is the primary timing function for RT constraints.
  */
 uint64_t timer_read_us(void) {
-    if (tsc_freq_hz == 0) {
-        // TSC not calibrated yet, return 0
-        return 0;
-    }
+    return clocksource_read_us();
+}
 
-    uint64_t tsc = timer_read_tsc();
+/**
+ * Read time in nanoseconds (same timebase as timer_read_us())
+ */
+uint64_t timer_read_ns(void) {
+    return clocksource_read_ns();
+}
 
-    // Convert TSC cycles to microseconds:
-    // microseconds = (tsc * 1000000) / tsc_freq_hz
-    //
-    // To avoid overflow, we rearrange:
-    // microseconds = tsc / (tsc_freq_hz / 1000000)
-    return tsc / (tsc_freq_hz / 1000000ULL);
+/**
+ * Get timer interrupt frequency in Hz
+ */
+uint32_t timer_get_frequency(void) {
+    return timer_freq_hz;
 }
 
 /**
@@ -231,7 +459,8 @@ uint64_t timer_get_tsc_freq(void) {
  * Timer interrupt handler (IRQ 0 -> INT 32)
  *
  * Called on every timer tick. Updates per-CPU tick counter and
- * sets scheduler preemption flag.
+ * sets scheduler preemption flag. In tickless mode a "tick" is an armed
+ * event firing; the handler re-arms for the next one.
  *
  * NOTE: We do NOT call schedule() here because we're in interrupt context.
  * We also do NOT send an EOI from here; irq_handler() in idt.c already
@@ -246,11 +475,19 @@ void timer_interrupt_handler(void) {
     cpu->ticks++;
 
     // Debug: Print every 100 ticks to verify interrupts are firing
-    if (cpu->ticks % 100 == 0) {
-        kprintf("[TIMER] Tick %u\n", (unsigned int)cpu->ticks);
+    if (log_compiled(LOG_LEVEL_DEBUG) && cpu->cpu_id == 0 && cpu->ticks % 100 == 0) {
+        log_debug_ratelimited(TIMER, "Tick %u\n", (unsigned int)cpu->ticks);
     }
 
+    // Fire due kernel timers first: wakeups feed the preemption check
+    ktimer_run(timer_read_us());
+
     // Call scheduler tick (updates accounting, sets need_resched flag)
     // This does NOT actually schedule, just sets a flag
     scheduler_tick();
+
+    // The armed event has fired; arm exactly the next one (none if idle)
+    if (timer_is_tickless()) {
+        timer_program(cpu, timer_next_event());
+    }
 }
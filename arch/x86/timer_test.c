@@ -8,6 +8,7 @@
 #include <kernel/timer.h>
 #include <kernel/hal.h>
 #include <kernel/percpu.h>
+#include <kernel/scheduler.h>
 
 // Test: TSC monotonicity
 // Verifies that TSC always increases
@@ -53,6 +54,20 @@ static int test_timer_us_advances(void) {
     return KTEST_PASS;
 }
 
+// Test: Nanosecond time is monotonic and agrees with timer_read_us()
+// Both come from the active clock source; allow 1us for rounding
+static int test_timer_ns_consistent(void) {
+    uint64_t ns1 = timer_read_ns();
+    uint64_t us = timer_read_us();
+    uint64_t ns2 = timer_read_ns();
+
+    KTEST_ASSERT(ns2 >= ns1, "timer_read_ns() is monotonic");
+    KTEST_ASSERT(us * 1000 + 1000 >= ns1, "us not behind ns");
+    KTEST_ASSERT(us * 1000 <= ns2 + 1000, "us not ahead of ns");
+
+    return KTEST_PASS;
+}
+
 // Test: Per-CPU tick counter increments
 // Verifies that timer interrupts are firing and incrementing tick counter
 // Note: This test requires interrupts to be enabled
@@ -78,8 +93,27 @@ static int test_timer_ticks_increment(void) {
     return KTEST_PASS;
 }
 
+// Test: Tickless mode keeps a busy CPU's next event within one slice
+// The running context (boot/ktest) is not idle, so an event must be armed
+static int test_timer_tickless_deadline(void) {
+    if (!timer_is_tickless()) {
+        return KTEST_PASS;
+    }
+
+    uint64_t now = timer_read_us();
+    uint64_t next = scheduler_next_event_us();
+
+    KTEST_ASSERT(next != TIMER_NO_EVENT, "Busy CPU has a pending timer event");
+    KTEST_ASSERT(next <= now + task_quantum_us(task_current()), "Next event within one slice");
+    KTEST_ASSERT_NEQ(this_cpu()->timer_deadline_us, 0, "One-shot is armed");
+
+    return KTEST_PASS;
+}
+
 // Register all timer tests
 KTEST_DEFINE("timer", tsc_monotonic, test_tsc_monotonic);
 KTEST_DEFINE("timer", timer_calibrated, test_timer_calibrated);
 KTEST_DEFINE("timer", timer_us_advances, test_timer_us_advances);
+KTEST_DEFINE("timer", timer_ns_consistent, test_timer_ns_consistent);
 KTEST_DEFINE("timer", timer_ticks_increment, test_timer_ticks_increment);
+KTEST_DEFINE("timer", timer_tickless_deadline, test_timer_tickless_deadline);
@@ -2,13 +2,15 @@
  * Simple Userspace Test Program
  *
  * This is a minimal ring 3 program that tests syscalls from userspace.
- * It will be mapped at USER_CODE_BASE (0x00400000) with USER flag.
+ * It will be mapped at USER_CODE_BASE (0x08000000) with USER flag.
  *
  * Test sequence:
  * 1. Call SYS_GETPID (should return task ID)
- * 2. Call SYS_YIELD (should context switch)
+ * 2. Call SYS_YIELD (should context switch), via SYSENTER when available
  * 3. Loop a few times
- * 4. Call SYS_EXIT (terminate)
+ * 4. Call SYS_GETPID through SYSENTER with TF set (the kernel must drop
+ *    the single-step trap and return with TF clear)
+ * 5. Call SYS_EXIT (terminate)
  */
 
 .section .text
@@ -26,15 +28,35 @@ user_test_start:
     int $0x80
     # EAX now contains our task ID
 
-    # Test 2: SYS_YIELD (do this a few times)
-    movl $5, %ecx          # Loop counter
+    # Test 2: SYS_YIELD a few times, through SYSENTER if the CPU has it
+    movl $1, %eax
+    cpuid                  # Clobbers EBX/ECX/EDX
+    xorl %ebp, %ebp        # EBP = 0: INT 0x80 unless SEP is present
+    testl $(1 << 11), %edx # CPUID.1:EDX.SEP
+    jz 1f
+    incl %ebp              # EBP = 1: use SYSENTER
+1:
+    movl $5, %esi          # Loop counter (preserved by both paths)
 yield_loop:
     movl $2, %eax          # SYS_YIELD
+    testl %ebp, %ebp
+    jz 2f
+    call sysenter_call
+    jmp 3f
+2:
     int $0x80
-    decl %ecx
+3:
+    decl %esi
     jnz yield_loop
 
-    # Test 3: SYS_EXIT
+    # Test 3: SYS_GETPID through SYSENTER with the trap flag set
+    testl %ebp, %ebp
+    jz 6f
+    movl $3, %eax          # SYS_GETPID
+    call sysenter_call_tf
+6:
+
+    # Test 4: SYS_EXIT
     movl $1, %eax          # SYS_EXIT
     movl $42, %ebx         # Exit code = 42
     int $0x80
@@ -42,5 +64,33 @@ yield_loop:
     # Should never reach here
     hlt
 
+    # SYSENTER with EAX/EBX/ESI/EDI/EBP already loaded; returns like a
+    # call. Position independent: this code runs at USER_CODE_BASE.
+sysenter_call:
+    movl %esp, %ecx        # Resume with our return address on top
+    call 4f
+4:
+    popl %edx
+    addl $(5f - 4b), %edx  # Resume at the RET below
+    sysenter
+5:
+    ret
+
+    # As sysenter_call, but enter with EFLAGS.TF set. POPFL arms the trap
+    # for the instruction after it, so the single-step lands in the
+    # kernel's SYSENTER stub rather than in user code.
+sysenter_call_tf:
+    movl %esp, %ecx
+    call 7f
+7:
+    popl %edx
+    addl $(8f - 7b), %edx
+    pushfl
+    orl $0x100, (%esp)     # EFLAGS.TF
+    popfl
+    sysenter
+8:
+    ret
+
 user_test_end:
     # Marker for end of user code (used to calculate size)
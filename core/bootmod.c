@@ -0,0 +1,85 @@
+/**
+ * Boot Module Table
+ *
+ * Copies the bootloader's module list into kernel memory at boot, so it
+ * does not depend on the multiboot tables surviving.
+ */
+
+#include <kernel/bootmod.h>
+#include <kernel/log.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+static struct boot_module modules[BOOTMOD_MAX];
+static uint32_t module_count;
+
+// Last path component of the first word of `cmdline`
+static void module_name(char* name, const char* cmdline, uint32_t index) {
+    const char* base = cmdline;
+    const char* p = cmdline;
+    while (*p && *p != ' ') {
+        if (*p == '/') {
+            base = p + 1;
+        }
+        p++;
+    }
+
+    size_t len = MIN((size_t)(p - base), (size_t)BOOTMOD_NAME_LEN - 1);
+    if (len == 0) {
+        // Nameless module: fall back to its position, "module00" on
+        strlcpy(name, "module00", BOOTMOD_NAME_LEN);
+        name[6] = (char)('0' + index / 10);
+        name[7] = (char)('0' + index % 10);
+        return;
+    }
+    memcpy(name, base, len);
+    name[len] = '\0';
+}
+
+uint32_t bootmod_init(uint32_t multiboot_magic, const struct multiboot_info* mbi) {
+    module_count = 0;
+    if (multiboot_magic != MULTIBOOT_MAGIC || !mbi || !(mbi->flags & MULTIBOOT_FLAG_MODS)) {
+        return 0;
+    }
+
+    const struct multiboot_module* mods =
+        (const struct multiboot_module*)(uintptr_t)mbi->mods_addr;
+    for (uint32_t i = 0; i < mbi->mods_count; i++) {
+        if (module_count == BOOTMOD_MAX) {
+            log_warn(INIT, "Only %u boot modules supported, %u ignored\n",
+                     (unsigned int)BOOTMOD_MAX, (unsigned int)(mbi->mods_count - i));
+            break;
+        }
+        if (mods[i].mod_end < mods[i].mod_start) {
+            continue;
+        }
+
+        struct boot_module* mod = &modules[module_count];
+        const char* cmdline = mods[i].cmdline ? (const char*)(uintptr_t)mods[i].cmdline : "";
+        module_name(mod->name, cmdline, module_count);
+        mod->start = mods[i].mod_start;
+        mod->size = mods[i].mod_end - mods[i].mod_start;
+        module_count++;
+
+        kprintf("[BOOT] Module '%s': %u bytes at 0x%08x\n", mod->name,
+                (unsigned int)mod->size, (unsigned int)mod->start);
+    }
+    return module_count;
+}
+
+uint32_t bootmod_count(void) {
+    return module_count;
+}
+
+const struct boot_module* bootmod_get(uint32_t index) {
+    return index < module_count ? &modules[index] : NULL;
+}
+
+const struct boot_module* bootmod_find(const char* name) {
+    for (uint32_t i = 0; i < module_count; i++) {
+        if (strcmp(modules[i].name, name) == 0) {
+            return &modules[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,198 @@
+/**
+ * Capability tables
+ *
+ * Slots, handles and the per-CPU validation cache (see include/kernel/cap.h).
+ */
+
+#include <kernel/cap.h>
+#include <kernel/percpu.h>
+#include <kernel/slab.h>
+
+#define CAP_CACHE_SLOTS 8   // Per CPU, direct-mapped by handle index
+
+struct cap_cache_entry {
+    uint32_t           table_id;    // 0 = empty
+    cap_handle_t       handle;
+    uint32_t           revokes;     // table->revokes when validated
+    uint32_t           key;
+    void*              obj;
+};
+
+struct cap_cache {
+    struct cap_cache_entry entries[CAP_CACHE_SLOTS];
+    uint64_t               hits;
+    uint64_t               misses;
+} __attribute__((aligned(64)));
+
+static struct cap_cache cap_caches[MAX_CPUS];
+static atomic_t cap_table_ids;
+
+static inline uint32_t handle_index(cap_handle_t handle) {
+    return (uint32_t)handle & (CAP_MAX_ENTRIES - 1);
+}
+
+static inline uint32_t handle_gen(cap_handle_t handle) {
+    return (uint32_t)handle >> CAP_INDEX_BITS;
+}
+
+// Could name a slot: positive, in range, installed (odd) generation
+static inline bool handle_plausible(const cap_table_t* t, cap_handle_t handle) {
+    return handle > 0 && handle_index(handle) < t->capacity && (handle_gen(handle) & 1);
+}
+
+// Slot for a live handle (t->lock held), NULL if stale or bad
+static capability_t* slot_locked(cap_table_t* t, cap_handle_t handle) {
+    if (!handle_plausible(t, handle)) {
+        return NULL;
+    }
+    capability_t* cap = &t->slots[handle_index(handle)];
+    return cap->gen == handle_gen(handle) ? cap : NULL;
+}
+
+// Errno for a key that failed cap_key_allows() (slow path only)
+static int denied(uint32_t key, cap_type_t type) {
+    return (key >> CAP_TYPE_SHIFT) == (uint32_t)type ? -EACCES : -EBADF;
+}
+
+int cap_table_init(cap_table_t* t, uint32_t capacity) {
+    if (capacity == 0 || capacity > CAP_MAX_ENTRIES) {
+        return -EINVAL;
+    }
+    t->slots = kzalloc(capacity * sizeof(capability_t));
+    if (!t->slots) {
+        return -ENOMEM;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        t->slots[i].next_free = i + 1;
+    }
+    t->id = atomic_inc(&cap_table_ids) + 1;
+    t->capacity = capacity;
+    t->count = 0;
+    t->free_head = 0;
+    t->revokes = 0;
+    spin_lock_init(&t->lock);
+    return 0;
+}
+
+void cap_table_destroy(cap_table_t* t) {
+    kfree(t->slots);
+    t->slots = NULL;
+    t->capacity = 0;
+    t->count = 0;
+}
+
+cap_handle_t cap_install(cap_table_t* t, cap_type_t type, void* obj, uint32_t rights) {
+    if (type == CAP_TYPE_NONE || type > (CAP_TYPE_MASK >> CAP_TYPE_SHIFT) ||
+        (rights & ~CAP_RIGHTS_ALL)) {
+        return -EINVAL;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&t->lock);
+    if (t->free_head >= t->capacity) {
+        spin_unlock_irqrestore(&t->lock, flags);
+        return -ENOMEM;
+    }
+    uint32_t index = t->free_head;
+    capability_t* cap = &t->slots[index];
+    t->free_head = cap->next_free;
+    t->count++;
+
+    cap->key = ((uint32_t)type << CAP_TYPE_SHIFT) | rights;
+    cap->obj = obj;
+    wmb();  // Contents before the generation that validates them
+    uint32_t gen = (cap->gen + 1) & CAP_GEN_MAX;
+    cap->gen = gen;
+    spin_unlock_irqrestore(&t->lock, flags);
+
+    return (cap_handle_t)((gen << CAP_INDEX_BITS) | index);
+}
+
+int cap_revoke(cap_table_t* t, cap_handle_t handle) {
+    uint32_t flags = spin_lock_irqsave(&t->lock);
+    capability_t* cap = slot_locked(t, handle);
+    if (!cap) {
+        spin_unlock_irqrestore(&t->lock, flags);
+        return -EBADF;
+    }
+
+    cap->gen = (cap->gen + 1) & CAP_GEN_MAX;  // Even: no handle matches
+    t->revokes++;
+    wmb();  // Handle dead before the contents go
+    cap->key = 0;
+    cap->obj = NULL;
+    cap->next_free = t->free_head;
+    t->free_head = handle_index(handle);
+    t->count--;
+    spin_unlock_irqrestore(&t->lock, flags);
+    return 0;
+}
+
+cap_handle_t cap_grant(cap_table_t* from, cap_handle_t handle, cap_table_t* to,
+                       uint32_t rights) {
+    uint32_t flags = spin_lock_irqsave(&from->lock);
+    capability_t* cap = slot_locked(from, handle);
+    if (!cap) {
+        spin_unlock_irqrestore(&from->lock, flags);
+        return -EBADF;
+    }
+    uint32_t key = cap->key;
+    void* obj = cap->obj;
+    spin_unlock_irqrestore(&from->lock, flags);
+
+    // GRANT on the source, and no rights it does not have
+    if (!(key & CAP_RIGHT_GRANT) || (rights & ~key & CAP_RIGHTS_ALL)) {
+        return -EACCES;
+    }
+    return cap_install(to, (cap_type_t)(key >> CAP_TYPE_SHIFT), obj, rights);
+}
+
+int cap_lookup(cap_table_t* t, cap_handle_t handle, cap_type_t type, uint32_t rights,
+               void** obj) {
+    struct cap_cache* cache = &cap_caches[this_cpu()->cpu_id];
+    struct cap_cache_entry* entry = &cache->entries[handle_index(handle) % CAP_CACHE_SLOTS];
+
+    uint32_t revokes = t->revokes;
+    rmb();  // Revoke count before the slot: a revoke in between stales the entry
+    if (entry->table_id == t->id && entry->handle == handle && entry->revokes == revokes) {
+        cache->hits++;
+        if (!cap_key_allows(entry->key, type, rights)) {
+            return denied(entry->key, type);
+        }
+        *obj = entry->obj;
+        return 0;
+    }
+    cache->misses++;
+
+    if (!handle_plausible(t, handle)) {
+        return -EBADF;
+    }
+    const capability_t* cap = &t->slots[handle_index(handle)];
+    uint32_t gen = cap->gen;
+    if (gen != handle_gen(handle)) {
+        return -EBADF;
+    }
+    rmb();  // Generation before the contents
+    uint32_t key = cap->key;
+    void* found = cap->obj;
+    rmb();  // Contents before the recheck
+    if (cap->gen != gen) {
+        return -EBADF;  // Revoked meanwhile
+    }
+
+    entry->table_id = t->id;
+    entry->handle = handle;
+    entry->revokes = revokes;
+    entry->key = key;
+    entry->obj = found;
+
+    if (!cap_key_allows(key, type, rights)) {
+        return denied(key, type);
+    }
+    *obj = found;
+    return 0;
+}
+
+void cap_cache_get_stats(uint32_t cpu_id, struct cap_cache_stats* stats) {
+    stats->hits = cap_caches[cpu_id].hits;
+    stats->misses = cap_caches[cpu_id].misses;
+}
@@ -0,0 +1,121 @@
+/**
+ * Unit tests for capability tables
+ *
+ * Covers handle encoding, rights checks, revocation (including cached
+ * validations going stale) and granting between tables.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/cap.h>
+#include <kernel/rcu.h>
+#include <kernel/percpu.h>
+
+static int lookup(cap_table_t* t, cap_handle_t h, cap_type_t type, uint32_t rights,
+                  void** obj) {
+    uint32_t flags = rcu_read_lock();
+    int rc = cap_lookup(t, h, type, rights, obj);
+    rcu_read_unlock(flags);
+    return rc;
+}
+
+// Test: install, look up, check rights and type
+static int test_cap_lookup(void) {
+    cap_table_t t;
+    int objs[2];
+    void* obj = NULL;
+
+    KTEST_ASSERT_EQ(cap_table_init(&t, 0), -EINVAL, "empty table refused");
+    KTEST_ASSERT_EQ(cap_table_init(&t, 4), 0, "table created");
+
+    cap_handle_t ch = cap_install(&t, CAP_TYPE_CHANNEL, &objs[0],
+                                  CAP_RIGHT_READ | CAP_RIGHT_WRITE);
+    cap_handle_t ep = cap_install(&t, CAP_TYPE_ENDPOINT, &objs[1], CAP_RIGHT_WRITE);
+    KTEST_ASSERT(ch > 0 && ep > 0 && ch != ep, "distinct positive handles");
+    KTEST_ASSERT_EQ(cap_install(&t, CAP_TYPE_NONE, &objs[0], 0), -EINVAL, "no untyped caps");
+
+    KTEST_ASSERT_EQ(lookup(&t, ch, CAP_TYPE_CHANNEL, CAP_RIGHT_READ, &obj), 0, "lookup");
+    KTEST_ASSERT(obj == &objs[0], "object returned");
+    KTEST_ASSERT_EQ(lookup(&t, ch, CAP_TYPE_CHANNEL, CAP_RIGHT_READ, &obj), 0,
+                    "repeated lookup");
+    KTEST_ASSERT_EQ(lookup(&t, ep, CAP_TYPE_ENDPOINT, CAP_RIGHT_READ, &obj), -EACCES,
+                    "missing right refused");
+    KTEST_ASSERT_EQ(lookup(&t, ep, CAP_TYPE_CHANNEL, CAP_RIGHT_WRITE, &obj), -EBADF,
+                    "wrong type refused");
+    KTEST_ASSERT_EQ(lookup(&t, 0, CAP_TYPE_CHANNEL, 0, &obj), -EBADF, "handle 0 refused");
+    KTEST_ASSERT_EQ(lookup(&t, ch + 2, CAP_TYPE_CHANNEL, 0, &obj), -EBADF,
+                    "unused slot refused");
+
+    KTEST_ASSERT(cap_key_allows((CAP_TYPE_RING << CAP_TYPE_SHIFT) | CAP_RIGHT_READ,
+                                CAP_TYPE_RING, CAP_RIGHT_READ), "mask check passes");
+    KTEST_ASSERT(!cap_key_allows((CAP_TYPE_RING << CAP_TYPE_SHIFT) | CAP_RIGHT_READ,
+                                 CAP_TYPE_RING, CAP_RIGHT_READ | CAP_RIGHT_WRITE),
+                 "mask check needs every right");
+
+    cap_table_destroy(&t);
+    return KTEST_PASS;
+}
+
+// Test: revoking kills the handle, cached or not, and slots are reused
+static int test_cap_revoke(void) {
+    cap_table_t t;
+    int thing;
+    void* obj = NULL;
+    KTEST_ASSERT_EQ(cap_table_init(&t, 1), 0, "table created");
+
+    struct cap_cache_stats before, after;
+    cap_cache_get_stats(this_cpu()->cpu_id, &before);
+
+    cap_handle_t h = cap_install(&t, CAP_TYPE_MEMORY, &thing, CAP_RIGHT_READ);
+    KTEST_ASSERT_EQ(lookup(&t, h, CAP_TYPE_MEMORY, CAP_RIGHT_READ, &obj), 0, "miss fills");
+    KTEST_ASSERT_EQ(lookup(&t, h, CAP_TYPE_MEMORY, CAP_RIGHT_READ, &obj), 0, "hit");
+    KTEST_ASSERT_EQ(cap_install(&t, CAP_TYPE_MEMORY, &thing, 0), -ENOMEM, "table full");
+
+    KTEST_ASSERT_EQ(cap_revoke(&t, h), 0, "revoked");
+    KTEST_ASSERT_EQ(cap_revoke(&t, h), -EBADF, "double revoke refused");
+    KTEST_ASSERT_EQ(lookup(&t, h, CAP_TYPE_MEMORY, CAP_RIGHT_READ, &obj), -EBADF,
+                    "cached validation went stale");
+
+    cap_handle_t again = cap_install(&t, CAP_TYPE_MEMORY, &thing, CAP_RIGHT_READ);
+    KTEST_ASSERT(again > 0 && again != h, "slot reused under a new generation");
+    KTEST_ASSERT_EQ(lookup(&t, h, CAP_TYPE_MEMORY, CAP_RIGHT_READ, &obj), -EBADF,
+                    "old handle stays dead");
+
+    cap_cache_get_stats(this_cpu()->cpu_id, &after);
+    KTEST_ASSERT(after.hits > before.hits, "cache hit counted");
+    KTEST_ASSERT(after.misses > before.misses, "cache miss counted");
+
+    cap_table_destroy(&t);
+    return KTEST_PASS;
+}
+
+// Test: grant needs GRANT and cannot add rights
+static int test_cap_grant(void) {
+    cap_table_t a, b;
+    int thing;
+    void* obj = NULL;
+    KTEST_ASSERT_EQ(cap_table_init(&a, 2), 0, "source created");
+    KTEST_ASSERT_EQ(cap_table_init(&b, 2), 0, "target created");
+
+    cap_handle_t plain = cap_install(&a, CAP_TYPE_CHANNEL, &thing, CAP_RIGHT_READ);
+    cap_handle_t owner = cap_install(&a, CAP_TYPE_CHANNEL, &thing,
+                                     CAP_RIGHT_READ | CAP_RIGHT_WRITE | CAP_RIGHT_GRANT);
+
+    KTEST_ASSERT_EQ(cap_grant(&a, plain, &b, CAP_RIGHT_READ), -EACCES, "GRANT required");
+    KTEST_ASSERT_EQ(cap_grant(&a, owner, &b, CAP_RIGHT_EXECUTE), -EACCES,
+                    "no rights beyond the source's");
+    cap_handle_t copy = cap_grant(&a, owner, &b, CAP_RIGHT_READ);
+    KTEST_ASSERT(copy > 0, "granted");
+    KTEST_ASSERT_EQ(lookup(&b, copy, CAP_TYPE_CHANNEL, CAP_RIGHT_READ, &obj), 0,
+                    "copy usable in the target");
+    KTEST_ASSERT(obj == &thing, "same object");
+    KTEST_ASSERT_EQ(lookup(&b, copy, CAP_TYPE_CHANNEL, CAP_RIGHT_WRITE, &obj), -EACCES,
+                    "copy has only the granted rights");
+
+    cap_table_destroy(&a);
+    cap_table_destroy(&b);
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("cap", cap_lookup, test_cap_lookup);
+KTEST_DEFINE("cap", cap_revoke, test_cap_revoke);
+KTEST_DEFINE("cap", cap_grant, test_cap_grant);
@@ -0,0 +1,347 @@
+/**
+ * Channels
+ *
+ * Bounded message queues with inline copies and page moves (see
+ * include/kernel/channel.h).
+ *
+ * A sender or receiver checks the ring under its own wait queue lock and
+ * the channel lock, and blocks without dropping the wait queue lock. The
+ * other side changes the ring under the channel lock only and wakes the
+ * queue afterwards, so a wake can never fall between the check and the
+ * block.
+ *
+ * User memory is only touched outside both locks: messages are staged in
+ * a struct chan_msg on the caller's stack.
+ */
+
+#include <kernel/channel.h>
+#include <kernel/task.h>
+#include <kernel/mmu.h>
+#include <kernel/pmm.h>
+#include <kernel/slab.h>
+#include <kernel/timer.h>
+#include <kernel/hal.h>
+#include <lib/string.h>
+
+// Channel IDs for user tasks; slot i holds ID i + 1, usable only from
+// the address space in chan_owner[i]
+static channel_t* chan_table[CHAN_MAX_CHANNELS];
+static page_table_t* chan_owner[CHAN_MAX_CHANNELS];
+static spinlock_t chan_table_lock;
+
+static inline void chan_lock(channel_t* ch) {
+    spin_lock(&ch->lock);
+}
+
+static inline void chan_unlock(channel_t* ch) {
+    spin_unlock(&ch->lock);
+}
+
+static inline uint32_t chan_table_acquire(void) {
+    return spin_lock_irqsave(&chan_table_lock);
+}
+
+static inline void chan_table_release(uint32_t flags) {
+    spin_unlock_irqrestore(&chan_table_lock, flags);
+}
+
+channel_t* chan_create(uint32_t depth) {
+    if (depth == 0 || depth > CHAN_MAX_DEPTH) {
+        return NULL;
+    }
+
+    channel_t* ch = kzalloc(sizeof(*ch));
+    if (!ch) {
+        return NULL;
+    }
+    ch->slots = kzalloc(depth * sizeof(struct chan_msg));
+    if (!ch->slots) {
+        kfree(ch);
+        return NULL;
+    }
+
+    ch->depth = depth;
+    atomic_init(&ch->refs, 1);
+    wait_queue_init(&ch->recv_waiters);
+    wait_queue_init(&ch->send_waiters);
+    return ch;
+}
+
+void chan_get(channel_t* ch) {
+    atomic_inc(&ch->refs);
+}
+
+void chan_put(channel_t* ch) {
+    if (!atomic_dec_and_test(&ch->refs)) {
+        return;
+    }
+
+    // Nobody else can reach the ring: drop the frames still in flight
+    for (uint32_t i = 0; i < ch->count; i++) {
+        struct chan_msg* msg = &ch->slots[(ch->head + i) % ch->depth];
+        for (uint32_t p = 0; p < msg->npages; p++) {
+            pmm_page_put(msg->pages[p]);
+        }
+    }
+    kfree(ch->slots);
+    kfree(ch);
+}
+
+void chan_close(channel_t* ch) {
+    uint32_t flags = hal->irq_disable();
+    chan_lock(ch);
+    ch->closed = true;
+    chan_unlock(ch);
+    hal->irq_restore(flags);
+
+    wait_queue_wake_all(&ch->send_waiters);
+    wait_queue_wake_all(&ch->recv_waiters);
+    chan_put(ch);
+}
+
+// Map the first `count` frames of msg at base; frames that don't fit are dropped
+static int give_pages(page_table_t* as, struct chan_msg* msg, uintptr_t base,
+                      uint32_t count) {
+    int rc = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        int err = mmu_region_give_page(as, base + i * PAGE_SIZE, msg->pages[i]);
+        if (err < 0) {
+            pmm_page_put(msg->pages[i]);
+            rc = rc ? rc : err;
+        }
+    }
+    return rc;
+}
+
+// Move msg->npages pages at base into msg, committing untouched ones first
+static int take_pages(page_table_t* as, struct chan_msg* msg, uintptr_t base) {
+    for (uint32_t i = 0; i < msg->npages; i++) {
+        uintptr_t va = base + i * PAGE_SIZE;
+        int rc = mmu_prefault_user(as, va, false);
+        if (rc == 0) {
+            rc = mmu_region_take_page(as, va, &msg->pages[i]);
+        }
+        if (rc < 0) {
+            give_pages(as, msg, base, i);
+            return -EFAULT;
+        }
+    }
+    return 0;
+}
+
+// Microseconds left until deadline (0 = none), or -ETIMEDOUT once past
+static int64_t time_left(uint64_t deadline) {
+    if (deadline == 0) {
+        return 0;
+    }
+    uint64_t now = timer_read_us();
+    return now < deadline ? (int64_t)(deadline - now) : -ETIMEDOUT;
+}
+
+// Slot header plus the part of the payload in use
+static inline size_t msg_size(const struct chan_msg* msg) {
+    size_t payload = msg->npages ? msg->npages * sizeof(phys_addr_t) : msg->len;
+    return offsetof(struct chan_msg, data) + payload;
+}
+
+int chan_send(channel_t* ch, const void* buf, size_t len, uint32_t flags,
+              uint64_t timeout_us) {
+    if (!ch || (!buf && len)) {
+        return -EINVAL;
+    }
+
+    task_t* current = task_current();
+    page_table_t* as = current ? current->address_space : NULL;
+    struct chan_msg msg;
+    msg.len = len;
+    msg.npages = 0;
+
+    if (flags & CHAN_PAGES) {
+        if (!as || len == 0 || !IS_PAGE_ALIGNED((uintptr_t)buf)) {
+            return -EINVAL;
+        }
+        if (len > CHAN_MAX_PAGES * PAGE_SIZE) {
+            return -EMSGSIZE;
+        }
+        msg.npages = PAGE_ALIGN_UP(len) / PAGE_SIZE;
+        int rc = take_pages(as, &msg, (uintptr_t)buf);
+        if (rc < 0) {
+            return rc;
+        }
+    } else {
+        if (len > CHAN_INLINE_MAX) {
+            return -EMSGSIZE;
+        }
+        memcpy(msg.data, buf, len);
+    }
+
+    uint64_t deadline = timeout_us ? timer_read_us() + timeout_us : 0;
+    int rc;
+    for (;;) {
+        uint32_t irq = wait_queue_lock(&ch->send_waiters);
+        chan_lock(ch);
+        if (ch->closed) {
+            rc = -EPIPE;
+        } else if (ch->count < ch->depth) {
+            struct chan_msg* slot = &ch->slots[(ch->head + ch->count) % ch->depth];
+            memcpy(slot, &msg, msg_size(&msg));
+            ch->count++;
+            ch->msgs_sent++;
+            ch->pages_moved += msg.npages;
+            rc = 0;
+        } else if (flags & CHAN_NONBLOCK) {
+            rc = -EAGAIN;
+        } else {
+            rc = 1;
+        }
+        chan_unlock(ch);
+
+        if (rc <= 0) {
+            wait_queue_unlock(&ch->send_waiters, irq);
+            break;
+        }
+        int64_t left = time_left(deadline);
+        if (left < 0) {
+            wait_queue_unlock(&ch->send_waiters, irq);
+            rc = (int)left;
+            break;
+        }
+        rc = wait_queue_block_locked(&ch->send_waiters, irq, 0, (uint64_t)left);
+        if (rc < 0) {
+            break;
+        }
+    }
+
+    if (rc == 0) {
+        wait_queue_wake_one(&ch->recv_waiters);
+        return 0;
+    }
+    if (msg.npages) {
+        give_pages(as, &msg, (uintptr_t)buf, msg.npages);
+    }
+    return rc;
+}
+
+int chan_recv(channel_t* ch, void* buf, size_t buf_len, uint32_t flags,
+              uint64_t timeout_us) {
+    if (!ch || (!buf && buf_len)) {
+        return -EINVAL;
+    }
+
+    task_t* current = task_current();
+    page_table_t* as = current ? current->address_space : NULL;
+    struct chan_msg msg;
+
+    uint64_t deadline = timeout_us ? timer_read_us() + timeout_us : 0;
+    int rc;
+    for (;;) {
+        uint32_t irq = wait_queue_lock(&ch->recv_waiters);
+        chan_lock(ch);
+        if (ch->count > 0) {
+            struct chan_msg* slot = &ch->slots[ch->head];
+            bool fits = slot->npages
+                ? as && IS_PAGE_ALIGNED((uintptr_t)buf) &&
+                  buf_len >= slot->npages * PAGE_SIZE
+                : buf_len >= slot->len;
+            if (fits) {
+                memcpy(&msg, slot, msg_size(slot));
+                ch->head = (ch->head + 1) % ch->depth;
+                ch->count--;
+                ch->msgs_received++;
+                rc = 0;
+            } else {
+                rc = -EMSGSIZE;
+            }
+        } else if (ch->closed) {
+            rc = -EPIPE;
+        } else if (flags & CHAN_NONBLOCK) {
+            rc = -EAGAIN;
+        } else {
+            rc = 1;
+        }
+        chan_unlock(ch);
+
+        if (rc <= 0) {
+            wait_queue_unlock(&ch->recv_waiters, irq);
+            break;
+        }
+        int64_t left = time_left(deadline);
+        if (left < 0) {
+            wait_queue_unlock(&ch->recv_waiters, irq);
+            rc = (int)left;
+            break;
+        }
+        rc = wait_queue_block_locked(&ch->recv_waiters, irq, 0, (uint64_t)left);
+        if (rc < 0) {
+            break;
+        }
+    }
+    if (rc < 0) {
+        return rc;
+    }
+
+    // A slot is free again
+    wait_queue_wake_one(&ch->send_waiters);
+
+    if (msg.npages) {
+        rc = give_pages(as, &msg, (uintptr_t)buf, msg.npages);
+        if (rc < 0) {
+            return rc;
+        }
+    } else {
+        memcpy(buf, msg.data, msg.len);
+    }
+    return (int)msg.len;
+}
+
+int chan_install(channel_t* ch, page_table_t* owner) {
+    uint32_t flags = chan_table_acquire();
+    for (int i = 0; i < CHAN_MAX_CHANNELS; i++) {
+        if (!chan_table[i]) {
+            chan_table[i] = ch;
+            chan_owner[i] = owner;
+            chan_table_release(flags);
+            return i + 1;
+        }
+    }
+    chan_table_release(flags);
+    return -ENOMEM;
+}
+
+channel_t* chan_lookup(int id, page_table_t* as) {
+    if (id <= 0 || id > CHAN_MAX_CHANNELS) {
+        return NULL;
+    }
+    uint32_t flags = chan_table_acquire();
+    channel_t* ch = chan_owner[id - 1] == as ? chan_table[id - 1] : NULL;
+    if (ch) {
+        chan_get(ch);
+    }
+    chan_table_release(flags);
+    return ch;
+}
+
+int chan_uninstall(int id, page_table_t* as) {
+    if (id <= 0 || id > CHAN_MAX_CHANNELS) {
+        return -EINVAL;
+    }
+    uint32_t flags = chan_table_acquire();
+    channel_t* ch = chan_owner[id - 1] == as ? chan_table[id - 1] : NULL;
+    if (ch) {
+        chan_table[id - 1] = NULL;
+        chan_owner[id - 1] = NULL;
+    }
+    chan_table_release(flags);
+
+    if (!ch) {
+        return -EINVAL;
+    }
+    chan_close(ch);
+    return 0;
+}
+
+void chan_release_owner(page_table_t* owner) {
+    for (int id = 1; id <= CHAN_MAX_CHANNELS; id++) {
+        chan_uninstall(id, owner);
+    }
+}
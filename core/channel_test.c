@@ -0,0 +1,100 @@
+/**
+ * Unit tests for channels
+ *
+ * Tests run from the bootstrap context, which cannot block, so full and
+ * empty channels are exercised with CHAN_NONBLOCK. Page messages move
+ * between two halves of a user-accessible reserved region.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/channel.h>
+#include <kernel/mmu.h>
+#include <lib/string.h>
+
+// Clear of the identity map, the user layout and the other tests' regions
+#define TEST_CHAN_BASE 0x52000000u
+
+// Test: inline copies, backpressure and close
+static int test_chan_inline(void) {
+    KTEST_ASSERT_NULL(chan_create(0), "zero depth refused");
+    KTEST_ASSERT_NULL(chan_create(CHAN_MAX_DEPTH + 1), "oversized depth refused");
+
+    channel_t* ch = chan_create(2);
+    KTEST_ASSERT_NOT_NULL(ch, "channel created");
+
+    char big[CHAN_INLINE_MAX + 1];
+    char out[16];
+    memset(big, 'x', sizeof(big));
+
+    KTEST_ASSERT_EQ(chan_recv(ch, out, sizeof(out), CHAN_NONBLOCK, 0), -EAGAIN,
+                    "empty channel would block");
+    KTEST_ASSERT_EQ(chan_send(ch, big, sizeof(big), 0, 0), -EMSGSIZE,
+                    "oversized inline message refused");
+    KTEST_ASSERT_EQ(chan_send(ch, "hello", 6, 0, 0), 0, "first message queued");
+    KTEST_ASSERT_EQ(chan_send(ch, "world!", 7, 0, 0), 0, "second message queued");
+    KTEST_ASSERT_EQ(chan_send(ch, "more", 5, CHAN_NONBLOCK, 0), -EAGAIN,
+                    "full channel would block");
+
+    KTEST_ASSERT_EQ(chan_recv(ch, out, 3, 0, 0), -EMSGSIZE, "short buffer refused");
+    KTEST_ASSERT_EQ(chan_recv(ch, out, sizeof(out), 0, 0), 6, "oldest first");
+    KTEST_ASSERT_EQ(memcmp(out, "hello", 6), 0, "payload copied");
+    KTEST_ASSERT_EQ(ch->msgs_sent, 2, "sends counted");
+    KTEST_ASSERT_EQ(ch->msgs_received, 1, "receives counted");
+
+    // Closing keeps the queued message readable: hold a reference to look
+    chan_get(ch);
+    chan_close(ch);
+    KTEST_ASSERT_EQ(chan_send(ch, "late", 5, 0, 0), -EPIPE, "send after close");
+    KTEST_ASSERT_EQ(chan_recv(ch, out, sizeof(out), 0, 0), 7, "queued message drained");
+    KTEST_ASSERT_EQ(memcmp(out, "world!", 7), 0, "second payload copied");
+    KTEST_ASSERT_EQ(chan_recv(ch, out, sizeof(out), 0, 0), -EPIPE, "closed and empty");
+    chan_put(ch);
+
+    return KTEST_PASS;
+}
+
+// Test: page messages move frames instead of copying
+static int test_chan_pages(void) {
+    page_table_t* as = mmu_get_kernel_address_space();
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_CHAN_BASE, 4 * PAGE_SIZE,
+                                       MMU_WRITABLE | MMU_USER), 0, "region reserved");
+
+    volatile uint32_t* src = (volatile uint32_t*)TEST_CHAN_BASE;
+    volatile uint32_t* dst = (volatile uint32_t*)(TEST_CHAN_BASE + 2 * PAGE_SIZE);
+    src[0] = 0xC0FFEE;
+    src[PAGE_SIZE / sizeof(uint32_t)] = 0xBEEF;  // Second page
+    dst[0] = 1;                                  // Replaced by the receive
+
+    channel_t* ch = chan_create(1);
+    KTEST_ASSERT_NOT_NULL(ch, "channel created");
+
+    int misaligned = chan_send(ch, (void*)(TEST_CHAN_BASE + 4), PAGE_SIZE, CHAN_PAGES, 0);
+    int outside = chan_send(ch, (void*)(TEST_CHAN_BASE + 2 * PAGE_SIZE), 3 * PAGE_SIZE,
+                            CHAN_PAGES, 0);
+    bool restored = dst[0] == 1;
+    int sent = chan_send(ch, (void*)TEST_CHAN_BASE, PAGE_SIZE + 8, CHAN_PAGES, 0);
+    bool moved = src[0] == 0 && src[PAGE_SIZE / sizeof(uint32_t)] == 0;
+
+    int small = chan_recv(ch, (void*)dst, PAGE_SIZE, 0, 0);
+    int got = chan_recv(ch, (void*)dst, 2 * PAGE_SIZE, 0, 0);
+    bool delivered = dst[0] == 0xC0FFEE && dst[PAGE_SIZE / sizeof(uint32_t)] == 0xBEEF;
+    uint64_t pages = ch->pages_moved;
+    chan_put(ch);
+
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_CHAN_BASE), 0, "region released");
+
+    KTEST_ASSERT_EQ(misaligned, -EINVAL, "misaligned page send refused");
+    KTEST_ASSERT_EQ(outside, -EFAULT, "pages beyond the region refused");
+    KTEST_ASSERT(restored, "failed send gives its pages back");
+    KTEST_ASSERT_EQ(sent, 0, "page message queued");
+    KTEST_ASSERT(moved, "sender's pages unmapped");
+    KTEST_ASSERT_EQ(small, -EMSGSIZE, "receive needs room for every page");
+    KTEST_ASSERT_EQ(got, PAGE_SIZE + 8, "length preserved");
+    KTEST_ASSERT(delivered, "receiver sees the sender's frames");
+    KTEST_ASSERT_EQ(pages, 2, "two pages moved");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("channel", chan_inline, test_chan_inline);
+KTEST_DEFINE("channel", chan_pages, test_chan_pages);
@@ -0,0 +1,58 @@
+/**
+ * Clock sources
+ *
+ * Conversion factors and selection (see include/kernel/clocksource.h).
+ * Everything here is boot-time; the read side is inline in the header.
+ */
+
+#ifdef HOST_TEST
+    #include <stddef.h>
+    #include "../include/kernel/clocksource.h"
+    #include "../include/kernel/types.h"
+#else
+    #include <kernel/clocksource.h>
+    #include <kernel/types.h>
+#endif
+
+static uint64_t clocksource_none_read(void) {
+    return 0;
+}
+
+// Reads 0 and converts to 0: the timebase before anything calibrates
+static struct clocksource clocksource_none = {
+    .name = "none",
+    .read = clocksource_none_read,
+    .rating = 0,
+};
+
+const struct clocksource* clocksource_active = &clocksource_none;
+
+void clocks_calc_mult_shift(uint32_t* mult, uint32_t* shift, uint64_t from_hz,
+                            uint64_t to_hz) {
+    // mul_u64_u32_shr() keeps all 96 bits, so the only limit on the
+    // shift (the precision) is that mult fits in 32 bits
+    uint32_t sft;
+    uint64_t tmp = 0;
+    for (sft = 32; sft > 0; sft--) {
+        tmp = ((to_hz << sft) + from_hz / 2) / from_hz;
+        if ((tmp >> 32) == 0) {
+            break;
+        }
+    }
+    *mult = (uint32_t)tmp;
+    *shift = sft;
+}
+
+int clocksource_register(struct clocksource* cs) {
+    if (!cs || !cs->read || cs->freq_hz == 0) {
+        return -EINVAL;
+    }
+
+    clocks_calc_mult_shift(&cs->ns_mult, &cs->ns_shift, cs->freq_hz, 1000000000ULL);
+    clocks_calc_mult_shift(&cs->us_mult, &cs->us_shift, cs->freq_hz, 1000000ULL);
+
+    if (cs->rating > clocksource_active->rating) {
+        clocksource_active = cs;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * ELF32 Executable Loader
+ *
+ * Turns PT_LOAD segments into backed regions over the image; the page
+ * fault handler does the rest (see include/kernel/elf.h).
+ */
+
+#include <kernel/elf.h>
+#include <kernel/mmu.h>
+#include <kernel/user.h>
+#include <kernel/log.h>
+
+static inline const struct elf32_phdr* elf_phdr(const struct elf32_ehdr* eh, uint32_t i) {
+    return (const struct elf32_phdr*)((const uint8_t*)eh + eh->e_phoff + i * eh->e_phentsize);
+}
+
+// [start, start + len) lies in [base, base + limit), without overflow
+static inline bool range_within(uint32_t start, uint32_t len, uint32_t base, uint32_t limit) {
+    return start >= base && start - base <= limit && len <= limit - (start - base);
+}
+
+static int elf_check_segment(const struct elf32_phdr* ph, size_t size) {
+    if (ph->p_filesz > ph->p_memsz ||
+        !range_within(ph->p_offset, ph->p_filesz, 0, (uint32_t)size) ||
+        !range_within(ph->p_vaddr, ph->p_memsz, USER_CODE_BASE, USER_CODE_SIZE)) {
+        return -ENOEXEC;
+    }
+    // p_offset and p_vaddr share their offset in the page, so the file
+    // pages can be mapped as they are
+    if ((ph->p_vaddr - ph->p_offset) & (PAGE_SIZE - 1)) {
+        return -ENOEXEC;
+    }
+    return 0;
+}
+
+int elf_check(const void* image, size_t size) {
+    const struct elf32_ehdr* eh = image;
+    if (!image || size < sizeof(*eh)) {
+        return -ENOEXEC;
+    }
+
+    uint32_t magic = eh->e_ident[0] | (eh->e_ident[1] << 8) |
+                     (eh->e_ident[2] << 16) | ((uint32_t)eh->e_ident[3] << 24);
+    if (magic != ELF_MAGIC || eh->e_ident[EI_CLASS] != ELFCLASS32 ||
+        eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_ident[EI_VERSION] != EV_CURRENT ||
+        eh->e_type != ET_EXEC || eh->e_machine != EM_386 ||
+        eh->e_phentsize < sizeof(struct elf32_phdr) ||
+        !range_within(eh->e_phoff, (uint32_t)eh->e_phnum * eh->e_phentsize, 0, (uint32_t)size)) {
+        return -ENOEXEC;
+    }
+
+    bool entry_ok = false;
+    for (uint32_t i = 0; i < eh->e_phnum; i++) {
+        const struct elf32_phdr* ph = elf_phdr(eh, i);
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+            continue;
+        }
+        if (elf_check_segment(ph, size) < 0) {
+            return -ENOEXEC;
+        }
+        if ((ph->p_flags & PF_X) && eh->e_entry >= ph->p_vaddr &&
+            eh->e_entry - ph->p_vaddr < ph->p_memsz) {
+            entry_ok = true;
+        }
+    }
+    return entry_ok ? 0 : -ENOEXEC;
+}
+
+int elf_load(page_table_t* pt, phys_addr_t image, size_t size, uintptr_t* entry) {
+    if (!pt || !entry || !IS_PAGE_ALIGNED(image)) {
+        return -EINVAL;
+    }
+
+    const struct elf32_ehdr* eh = (const struct elf32_ehdr*)(uintptr_t)image;
+    int rc = elf_check(eh, size);
+    if (rc < 0) {
+        log_warn(USER, "Image at 0x%08x is not a loadable ELF32 executable\n",
+                 (unsigned int)image);
+        return rc;
+    }
+
+    for (uint32_t i = 0; i < eh->e_phnum; i++) {
+        const struct elf32_phdr* ph = elf_phdr(eh, i);
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0) {
+            continue;
+        }
+
+        // Whole pages: the bytes before p_vaddr in its first page come
+        // from the file as well, so the backing starts page-aligned
+        virt_addr_t start = PAGE_ALIGN_DOWN(ph->p_vaddr);
+        virt_addr_t end = PAGE_ALIGN_UP(ph->p_vaddr + ph->p_memsz);
+        size_t backed = ph->p_filesz ? (ph->p_vaddr - start) + ph->p_filesz : 0;
+        uint32_t flags = MMU_USER | ((ph->p_flags & PF_W) ? MMU_WRITABLE : 0);
+
+        rc = mmu_reserve_backed_region(pt, start, end - start, flags,
+                                       image + PAGE_ALIGN_DOWN(ph->p_offset), backed);
+        if (rc < 0) {
+            log_warn(USER, "Segment %u at 0x%08x not mapped (%d)\n",
+                     (unsigned int)i, (unsigned int)ph->p_vaddr, rc);
+            // Undo the segments before this one
+            while (i-- > 0) {
+                ph = elf_phdr(eh, i);
+                if (ph->p_type == PT_LOAD && ph->p_memsz != 0) {
+                    mmu_release_region(pt, PAGE_ALIGN_DOWN(ph->p_vaddr));
+                }
+            }
+            return rc;
+        }
+    }
+
+    *entry = eh->e_entry;
+    return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * Unit tests for the ELF loader and backed regions
+ *
+ * Builds a small executable in a page-aligned buffer (kernel memory,
+ * identity-mapped and reserved like a boot module), loads it into a user
+ * address space and touches its pages from ring 0 with that address
+ * space loaded. IRQs stay off meanwhile, so no other task runs on it.
+ *
+ * Image layout (one page each):
+ *   0: ELF and program headers  \  text segment, read-only, executable
+ *   1: code (0x90 bytes)        /
+ *   2: data (0x11 bytes)        \  data segment, writable: two file
+ *   3: data (64 x 0x22), 0xAA   /  pages (the second only partly), one BSS
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/elf.h>
+#include <kernel/mmu.h>
+#include <kernel/pmm.h>
+#include <kernel/hal.h>
+#include <kernel/user.h>
+#include <lib/string.h>
+
+#define TEST_TEXT_VADDR   USER_CODE_BASE
+#define TEST_DATA_VADDR   (USER_CODE_BASE + 16 * PAGE_SIZE)
+#define TEST_DATA_TAIL    64
+#define TEST_IMAGE_SIZE   (4 * PAGE_SIZE)
+
+static uint8_t test_image[TEST_IMAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+static struct elf32_ehdr* test_ehdr(void) {
+    return (struct elf32_ehdr*)test_image;
+}
+
+static struct elf32_phdr* test_phdr(uint32_t i) {
+    return (struct elf32_phdr*)(test_image + sizeof(struct elf32_ehdr)) + i;
+}
+
+static void build_image(void) {
+    memset(test_image, 0, PAGE_SIZE);
+    memset(test_image + PAGE_SIZE, 0x90, PAGE_SIZE);
+    memset(test_image + 2 * PAGE_SIZE, 0x11, PAGE_SIZE);
+    memset(test_image + 3 * PAGE_SIZE, 0xAA, PAGE_SIZE);
+    memset(test_image + 3 * PAGE_SIZE, 0x22, TEST_DATA_TAIL);
+
+    struct elf32_ehdr* eh = test_ehdr();
+    eh->e_ident[0] = 0x7F;
+    eh->e_ident[1] = 'E';
+    eh->e_ident[2] = 'L';
+    eh->e_ident[3] = 'F';
+    eh->e_ident[EI_CLASS] = ELFCLASS32;
+    eh->e_ident[EI_DATA] = ELFDATA2LSB;
+    eh->e_ident[EI_VERSION] = EV_CURRENT;
+    eh->e_type = ET_EXEC;
+    eh->e_machine = EM_386;
+    eh->e_version = EV_CURRENT;
+    eh->e_entry = TEST_TEXT_VADDR + PAGE_SIZE;
+    eh->e_phoff = sizeof(struct elf32_ehdr);
+    eh->e_ehsize = sizeof(struct elf32_ehdr);
+    eh->e_phentsize = sizeof(struct elf32_phdr);
+    eh->e_phnum = 2;
+
+    *test_phdr(0) = (struct elf32_phdr){
+        .p_type = PT_LOAD, .p_offset = 0, .p_vaddr = TEST_TEXT_VADDR,
+        .p_filesz = 2 * PAGE_SIZE, .p_memsz = 2 * PAGE_SIZE,
+        .p_flags = PF_R | PF_X, .p_align = PAGE_SIZE,
+    };
+    *test_phdr(1) = (struct elf32_phdr){
+        .p_type = PT_LOAD, .p_offset = 2 * PAGE_SIZE, .p_vaddr = TEST_DATA_VADDR,
+        .p_filesz = PAGE_SIZE + TEST_DATA_TAIL, .p_memsz = 3 * PAGE_SIZE,
+        .p_flags = PF_R | PF_W, .p_align = PAGE_SIZE,
+    };
+}
+
+static size_t free_frames(void) {
+    struct pmm_stats stats;
+    pmm_get_stats(&stats);
+    return stats.free_frames;
+}
+
+// Test: malformed or misplaced images are refused before mapping anything
+static int test_elf_check(void) {
+    build_image();
+    KTEST_ASSERT_EQ(elf_check(test_image, TEST_IMAGE_SIZE), 0, "test image is valid");
+    KTEST_ASSERT_EQ(elf_check(test_image, sizeof(struct elf32_ehdr)), -ENOEXEC,
+                    "truncated image refused");
+
+    test_ehdr()->e_machine = 62;    // x86-64
+    KTEST_ASSERT_EQ(elf_check(test_image, TEST_IMAGE_SIZE), -ENOEXEC, "wrong machine refused");
+    build_image();
+
+    test_phdr(1)->p_filesz = 3 * PAGE_SIZE;
+    KTEST_ASSERT_EQ(elf_check(test_image, TEST_IMAGE_SIZE), -ENOEXEC,
+                    "segment past the image refused");
+    build_image();
+
+    test_phdr(1)->p_vaddr = USER_HEAP_BASE;
+    KTEST_ASSERT_EQ(elf_check(test_image, TEST_IMAGE_SIZE), -ENOEXEC,
+                    "segment outside the code window refused");
+    build_image();
+
+    test_phdr(1)->p_vaddr = TEST_DATA_VADDR + 8;
+    KTEST_ASSERT_EQ(elf_check(test_image, TEST_IMAGE_SIZE), -ENOEXEC,
+                    "offset and address out of phase refused");
+    build_image();
+
+    test_ehdr()->e_entry = TEST_DATA_VADDR;
+    KTEST_ASSERT_EQ(elf_check(test_image, TEST_IMAGE_SIZE), -ENOEXEC,
+                    "entry outside executable segments refused");
+    return KTEST_PASS;
+}
+
+// Test: text is shared, data is copy-on-write, the file tail and BSS are zero
+static int test_elf_load_shared(void) {
+    build_image();
+    page_table_t* kernel = mmu_get_kernel_address_space();
+    page_table_t* as = mmu_create_user_address_space();
+    KTEST_ASSERT_NOT_NULL(as, "user address space created");
+
+    size_t before = free_frames();
+    uintptr_t entry = 0;
+    KTEST_ASSERT_EQ(elf_load(as, (phys_addr_t)(uintptr_t)test_image, TEST_IMAGE_SIZE, &entry),
+                    0, "image loaded");
+    KTEST_ASSERT_EQ(entry, TEST_TEXT_VADDR + PAGE_SIZE, "entry point");
+    KTEST_ASSERT_EQ(free_frames(), before, "loading allocates nothing");
+
+    uint32_t flags = hal->irq_disable();
+    mmu_switch_address_space(as);
+
+    volatile uint8_t* text = (volatile uint8_t*)TEST_TEXT_VADDR;
+    volatile uint8_t* data = (volatile uint8_t*)TEST_DATA_VADDR;
+
+    // The first touch pays for the page table, text pages cost nothing
+    uint8_t code = text[PAGE_SIZE];
+    size_t after_pt = free_frames();
+    uint32_t magic = *(volatile uint32_t*)text;
+    uint8_t shared = data[0];
+    size_t after_reads = free_frames();
+
+    data[1] = 0x5A;
+    size_t after_cow = free_frames();
+    uint8_t written = data[1];
+
+    uint8_t tail = data[PAGE_SIZE];
+    uint8_t past_tail = data[PAGE_SIZE + TEST_DATA_TAIL];
+    uint8_t bss = data[2 * PAGE_SIZE + 100];
+    size_t after_all = free_frames();
+
+    mmu_switch_address_space(kernel);
+    hal->irq_restore(flags);
+
+    KTEST_ASSERT_EQ(code, 0x90, "text reads the image");
+    KTEST_ASSERT_EQ(magic, ELF_MAGIC, "headers page reads the image");
+    KTEST_ASSERT_EQ(shared, 0x11, "data reads the image before a write");
+    KTEST_ASSERT_EQ(before - after_pt, 1, "one page table");
+    KTEST_ASSERT_EQ(after_reads, after_pt, "shared pages are not copied");
+    KTEST_ASSERT_EQ(after_pt - after_cow, 1, "a write copies the page");
+    KTEST_ASSERT_EQ(written, 0x5A, "the copy takes the write");
+    KTEST_ASSERT_EQ(test_image[2 * PAGE_SIZE + 1], 0x11, "the image is unchanged");
+    KTEST_ASSERT_EQ(tail, 0x22, "partial page reads the file bytes");
+    KTEST_ASSERT_EQ(past_tail, 0, "bytes past the file size read as zero");
+    KTEST_ASSERT_EQ(bss, 0, "BSS reads as zero");
+    KTEST_ASSERT_EQ(after_cow - after_all, 2, "partial page and BSS page committed");
+
+    // Private frames go back, the image's frames stay where they are
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_TEXT_VADDR), 0, "text released");
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_DATA_VADDR), 0, "data released");
+    KTEST_ASSERT_EQ(before - free_frames(), 1, "only the page table is left");
+    mmu_destroy_address_space(as);
+    return KTEST_PASS;
+}
+
+// Test: a failed load leaves no region behind
+static int test_elf_load_busy(void) {
+    build_image();
+    page_table_t* as = mmu_create_user_address_space();
+    KTEST_ASSERT_NOT_NULL(as, "user address space created");
+
+    // Data segment lands on a region that is already there
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_DATA_VADDR, PAGE_SIZE, MMU_USER), 0,
+                    "blocking region reserved");
+    uintptr_t entry = 0;
+    KTEST_ASSERT_EQ(elf_load(as, (phys_addr_t)(uintptr_t)test_image, TEST_IMAGE_SIZE, &entry),
+                    -EBUSY, "overlap refused");
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_TEXT_VADDR, PAGE_SIZE, MMU_USER), 0,
+                    "text segment was rolled back");
+    mmu_destroy_address_space(as);
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("elf", check, test_elf_check);
+KTEST_DEFINE("elf", load_shared, test_elf_load_shared);
+KTEST_DEFINE("elf", load_busy, test_elf_load_busy);
@@ -0,0 +1,85 @@
+/**
+ * Futexes
+ *
+ * Hashed wait queues keyed by address space and user address (see
+ * include/kernel/futex.h).
+ */
+
+#include <kernel/futex.h>
+#include <kernel/waitqueue.h>
+#include <kernel/task.h>
+#include <kernel/mmu.h>
+#include <kernel/user.h>
+
+// Zero-filled, so every bucket starts out as an empty wait queue
+static wait_queue_t futex_buckets[FUTEX_HASH_BUCKETS];
+
+_Static_assert(sizeof(uintptr_t) == 4, "futex keys pack two 32-bit words");
+
+// Address space in the high word, user address in the low word
+static inline uint64_t futex_key(const page_table_t* as, uintptr_t uaddr) {
+    return ((uint64_t)(uintptr_t)as << 32) | uaddr;
+}
+
+static inline wait_queue_t* futex_bucket(const page_table_t* as, uintptr_t uaddr) {
+    // Fibonacci hash of the word index: neighbouring words spread out,
+    // and so does one address in different programs
+    uint32_t hash = ((uint32_t)(uaddr >> 2) ^ (uint32_t)((uintptr_t)as >> 6)) * 0x9E3779B1u;
+    return &futex_buckets[hash >> (32 - FUTEX_HASH_BITS)];
+}
+
+// Aligned and below the kernel
+static int futex_check_addr(uintptr_t uaddr) {
+    if (uaddr & (sizeof(uint32_t) - 1)) {
+        return -EINVAL;
+    }
+    if (uaddr == 0 || uaddr > USER_STACK_TOP - sizeof(uint32_t)) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+int futex_wait(uintptr_t uaddr, uint32_t expected, uint64_t timeout_us) {
+    int rc = futex_check_addr(uaddr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    task_t* current = task_current();
+    if (!current || !current->address_space) {
+        return -EPERM;
+    }
+
+    // Commit a lazily backed page now: no faults under the bucket lock
+    rc = mmu_prefault_user(current->address_space, uaddr, false);
+    if (rc < 0) {
+        return rc;
+    }
+
+    page_table_t* as = current->address_space;
+    wait_queue_t* wq = futex_bucket(as, uaddr);
+    uint32_t flags = wait_queue_lock(wq);
+    if (*(volatile uint32_t*)uaddr != expected) {
+        wait_queue_unlock(wq, flags);
+        return -EAGAIN;
+    }
+    return wait_queue_block_locked(wq, flags, futex_key(as, uaddr), timeout_us);
+}
+
+int futex_wake(uintptr_t uaddr, uint32_t count) {
+    int rc = futex_check_addr(uaddr);
+    if (rc < 0) {
+        return rc;
+    }
+
+    task_t* current = task_current();
+    if (!current || !current->address_space) {
+        return -EPERM;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    page_table_t* as = current->address_space;
+    return (int)wait_queue_wake_key(futex_bucket(as, uaddr), futex_key(as, uaddr), count);
+}
@@ -0,0 +1,187 @@
+/**
+ * Idle Loop Policy
+ *
+ * Poll, then MWAIT or HLT on the run queue's need_resched flag (see
+ * include/kernel/idle.h).
+ *
+ * Wakers and the idle CPU order their accesses like Dekker's algorithm:
+ * the idle CPU stores its state and then reads the flag, a waker stores
+ * the flag and then reads the state, each with a full barrier between.
+ * Either the idle CPU sees the flag before it sleeps, or the waker sees
+ * the state the CPU sleeps in and knows whether the store alone wakes it.
+ */
+
+#include <kernel/idle.h>
+#include <kernel/percpu.h>
+#include <kernel/scheduler.h>
+#include <kernel/smp.h>
+#include <kernel/hal.h>
+#include <kernel/timer.h>
+#include <kernel/spinlock.h>
+#include <kernel/config.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+static uint64_t idle_poll_cycles;
+static uint64_t idle_tsc_per_us;
+static bool idle_use_mwait;
+static bool idle_ready;
+
+static const char* const idle_state_names[IDLE_STATE_COUNT] = {
+    [IDLE_RUNNING] = "running",
+    [IDLE_POLL] = "poll",
+    [IDLE_MWAIT] = "mwait",
+    [IDLE_HLT] = "hlt",
+};
+
+void idle_init(void) {
+    idle_tsc_per_us = timer_get_tsc_freq() / 1000000;
+    idle_poll_cycles = idle_tsc_per_us * CONFIG_IDLE_POLL_US;
+    idle_use_mwait = CONFIG_IDLE_MWAIT && (hal->cpu_features() & HAL_CPU_FEAT_MWAIT);
+    idle_ready = true;
+
+    kprintf("[IDLE] Poll %u us, then %s\n", (unsigned int)CONFIG_IDLE_POLL_US,
+            idle_use_mwait ? "MWAIT on need_resched" : "HLT");
+}
+
+// Charge the time in the current state and move to `state`
+static void idle_set_state(struct per_cpu_data* cpu, uint32_t state, uint64_t now) {
+    if (cpu->idle_state != IDLE_RUNNING) {
+        cpu->idle.residency[cpu->idle_state] += now - cpu->idle_since_tsc;
+    }
+    cpu->idle_since_tsc = now;
+    cpu->idle_state = state;
+}
+
+void idle_exit(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    uint32_t state = cpu->idle_state;
+    uint32_t stamp = cpu->idle_wake_tsc;
+    cpu->idle_wake_tsc = 0;
+    if (state == IDLE_RUNNING) {
+        return;
+    }
+
+    uint64_t now = timer_read_tsc();
+    idle_set_state(cpu, IDLE_RUNNING, now);
+    cpu->idle.exits[state]++;
+
+    if (stamp) {
+        // 32 bits of TSC: a wakeup is orders of magnitude below the wrap
+        uint64_t latency = (uint32_t)((uint32_t)now - stamp);
+        cpu->idle.wakeups++;
+        if (state != IDLE_HLT) {
+            cpu->idle.wakeups_no_ipi++;
+        }
+        cpu->idle.wake_latency_total += latency;
+        if (latency > cpu->idle.wake_latency_max) {
+            cpu->idle.wake_latency_max = latency;
+        }
+    }
+}
+
+void idle_enter(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    scheduler_t* rq = cpu->sched;
+    if (!idle_ready || !rq) {
+        hal->cpu_halt();
+        return;
+    }
+    volatile bool* flag = &rq->need_resched;
+
+    uint64_t now = timer_read_tsc();
+    idle_set_state(cpu, IDLE_POLL, now);
+    mb();   // State before the flag (idle_wake_cpu() does the reverse)
+
+    uint64_t until = now + idle_poll_cycles;
+    while (!*flag && now < until) {
+        cpu_relax();
+        now = timer_read_tsc();
+    }
+
+    // Interrupts off from the last check to the sleep instruction, which
+    // turns them back on atomically: a wakeup in between still wakes it
+    uint32_t flags = hal->irq_disable();
+    if (!*flag && cpu->idle_state == IDLE_POLL) {
+        if (idle_use_mwait) {
+            idle_set_state(cpu, IDLE_MWAIT, timer_read_tsc());
+            mb();
+            hal->cpu_monitor(flag);
+            if (!*flag) {
+                hal->cpu_mwait(CONFIG_IDLE_MWAIT_HINT);
+                hal->irq_disable();
+            }
+        } else {
+            idle_set_state(cpu, IDLE_HLT, timer_read_tsc());
+            mb();
+            if (!*flag) {
+                hal->cpu_idle_halt();
+                hal->irq_disable();
+            }
+        }
+    }
+
+    // An interrupt handler that switched away from us has closed the pass
+    idle_exit();
+    hal->irq_restore(flags);
+}
+
+void idle_wake_cpu(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS || cpu_id == hal->cpu_id()) {
+        return;
+    }
+    struct per_cpu_data* cpu = per_cpu[cpu_id];
+    scheduler_t* rq = cpu->sched;
+    if (!rq || !cpu->online) {
+        return;
+    }
+
+    // First request while idle starts the latency clock
+    if (cpu->current_task == cpu->idle_task && !cpu->idle_wake_tsc) {
+        uint32_t stamp = (uint32_t)timer_read_tsc();
+        cpu->idle_wake_tsc = stamp ? stamp : 1;
+    }
+
+    rq->need_resched = true;
+    mb();   // Flag before the state (idle_enter() does the reverse)
+
+    uint32_t state = cpu->idle_state;
+    if (state == IDLE_POLL || state == IDLE_MWAIT) {
+        return;  // The store is the wakeup
+    }
+    smp_send_reschedule(cpu_id);
+}
+
+int idle_get_stats(uint32_t cpu_id, struct idle_stats* out) {
+    if (cpu_id >= MAX_CPUS || !out) {
+        return -EINVAL;
+    }
+    memcpy(out, &per_cpu[cpu_id]->idle, sizeof(*out));
+    return 0;
+}
+
+void idle_dump_stats(void) {
+    uint32_t ncpus = hal->smp_num_cpus();
+    uint64_t per_us = idle_tsc_per_us ? idle_tsc_per_us : 1;
+
+    for (uint32_t id = 0; id < ncpus && id < MAX_CPUS; id++) {
+        const struct idle_stats* st = &per_cpu[id]->idle;
+        if (!per_cpu[id]->online) {
+            continue;
+        }
+        kprintf("[IDLE] CPU %u:", (unsigned int)id);
+        for (uint32_t s = IDLE_POLL; s < IDLE_STATE_COUNT; s++) {
+            kprintf(" %s %llu us (%llu exits)", idle_state_names[s],
+                    (unsigned long long)(st->residency[s] / per_us),
+                    (unsigned long long)st->exits[s]);
+        }
+        kprintf("\n");
+        if (st->wakeups) {
+            kprintf("    %llu wakeups, %llu without IPI, latency avg %llu max %llu cycles\n",
+                    (unsigned long long)st->wakeups,
+                    (unsigned long long)st->wakeups_no_ipi,
+                    (unsigned long long)(st->wake_latency_total / st->wakeups),
+                    (unsigned long long)st->wake_latency_max);
+        }
+    }
+}
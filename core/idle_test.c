@@ -0,0 +1,101 @@
+/**
+ * Unit tests for the idle loop policy
+ *
+ * Run from the bootstrap context with IRQs off and need_resched already
+ * set, so idle_enter() leaves in its poll phase without sleeping: the
+ * tests check the exit accounting and the wakeup latency bookkeeping.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/idle.h>
+#include <kernel/scheduler.h>
+#include <kernel/percpu.h>
+#include <kernel/hal.h>
+#include <kernel/timer.h>
+
+// Test: pending work ends the pass in the poll phase
+static int test_poll_exit(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    KTEST_ASSERT_NOT_NULL(cpu->sched, "scheduler running");
+
+    struct idle_stats before, after;
+    uint32_t flags = hal->irq_disable();
+    bool saved = cpu->sched->need_resched;
+    idle_get_stats(cpu->cpu_id, &before);
+
+    cpu->sched->need_resched = true;
+    idle_enter();
+
+    idle_get_stats(cpu->cpu_id, &after);
+    uint32_t state = cpu->idle_state;
+    cpu->sched->need_resched = saved;
+    hal->irq_restore(flags);
+
+    KTEST_ASSERT_EQ(state, IDLE_RUNNING, "pass closed");
+    KTEST_ASSERT_EQ(after.exits[IDLE_POLL], before.exits[IDLE_POLL] + 1, "exit from poll");
+    KTEST_ASSERT_EQ(after.exits[IDLE_MWAIT], before.exits[IDLE_MWAIT], "no MWAIT");
+    KTEST_ASSERT_EQ(after.exits[IDLE_HLT], before.exits[IDLE_HLT], "no HLT");
+    KTEST_ASSERT_EQ(after.wakeups, before.wakeups, "no wakeup request pending");
+    return KTEST_PASS;
+}
+
+// Test: a stamped request is timed and counted as served without an IPI
+static int test_wake_latency(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    struct idle_stats before, after;
+
+    uint32_t flags = hal->irq_disable();
+    bool saved = cpu->sched->need_resched;
+    idle_get_stats(cpu->cpu_id, &before);
+
+    // What idle_wake_cpu() does from another CPU
+    cpu->idle_wake_tsc = (uint32_t)timer_read_tsc() | 1;
+    cpu->sched->need_resched = true;
+    idle_enter();
+
+    idle_get_stats(cpu->cpu_id, &after);
+    uint32_t stamp = cpu->idle_wake_tsc;
+    cpu->sched->need_resched = saved;
+    hal->irq_restore(flags);
+
+    KTEST_ASSERT_EQ(stamp, 0, "request consumed");
+    KTEST_ASSERT_EQ(after.wakeups, before.wakeups + 1, "wakeup counted");
+    KTEST_ASSERT_EQ(after.wakeups_no_ipi, before.wakeups_no_ipi + 1, "served by polling");
+    KTEST_ASSERT(after.wake_latency_total > before.wake_latency_total, "latency recorded");
+    KTEST_ASSERT(after.wake_latency_max >= after.wake_latency_total - before.wake_latency_total,
+                 "max covers the sample");
+    return KTEST_PASS;
+}
+
+// Test: waking yourself or a CPU that is not running is a no-op, and a
+// CPU that is not idle only loses a stale request
+static int test_wake_noop(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    uint32_t flags = hal->irq_disable();
+    bool saved = cpu->sched->need_resched;
+
+    cpu->sched->need_resched = false;
+    idle_wake_cpu(cpu->cpu_id);
+    bool self_set = cpu->sched->need_resched;
+    idle_wake_cpu(MAX_CPUS);
+
+    struct idle_stats before, after;
+    idle_get_stats(cpu->cpu_id, &before);
+    cpu->idle_wake_tsc = 1;
+    idle_exit();
+    idle_get_stats(cpu->cpu_id, &after);
+    uint32_t stamp = cpu->idle_wake_tsc;
+
+    cpu->sched->need_resched = saved;
+    hal->irq_restore(flags);
+
+    KTEST_ASSERT(!self_set, "own CPU left alone");
+    KTEST_ASSERT_EQ(stamp, 0, "stale stamp dropped");
+    KTEST_ASSERT_EQ(after.wakeups, before.wakeups, "not counted outside idle");
+    KTEST_ASSERT_EQ(idle_get_stats(MAX_CPUS, &after), -EINVAL, "unknown CPU refused");
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("idle", poll_exit, test_poll_exit);
+KTEST_DEFINE("idle", wake_latency, test_wake_latency);
+KTEST_DEFINE("idle", wake_noop, test_wake_noop);
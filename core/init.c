@@ -7,12 +7,24 @@
 #include <kernel/idt.h>
 #include <kernel/gdt.h>
 #include <kernel/pmm.h>
+#include <kernel/slab.h>
 #include <kernel/mmu.h>
 #include <kernel/task.h>
 #include <kernel/scheduler.h>
+#include <kernel/idle.h>
 #include <kernel/syscall.h>
 #include <kernel/user.h>
+#include <kernel/bootmod.h>
 #include <kernel/console.h>
+#include <kernel/smp.h>
+#include <kernel/fpu.h>
+#include <kernel/vdso.h>
+#include <kernel/klog.h>
+#include <kernel/trace.h>
+#include <kernel/pmu.h>
+#include <kernel/work.h>
+#include <kernel/timer.h>
+#include <kernel/clocksource.h>
 #include <drivers/vga.h>
 #include <drivers/serial.h>
 
@@ -24,16 +36,57 @@ extern void hal_x86_init(void);
 #define KERNEL_VERSION_MINOR 1
 #define KERNEL_VERSION_PATCH 0
 
+// ========== Boot Timeline ==========
+
+// TSC at the end of each kmain phase; converted once the TSC rate is
+// known (the timer phase), so stamps before it cost only an RDTSC
+#define BOOT_PHASES_MAX 16
+
+static struct {
+    const char* name;
+    uint64_t tsc;
+} boot_phases[BOOT_PHASES_MAX];
+static uint32_t boot_phase_count;
+static uint64_t boot_tsc_start;
+
+static void boot_phase_done(const char* name) {
+    if (boot_phase_count < BOOT_PHASES_MAX) {
+        boot_phases[boot_phase_count].name = name;
+        boot_phases[boot_phase_count].tsc = timer_read_tsc();
+        boot_phase_count++;
+    }
+}
+
+static uint32_t boot_cycles_to_us(uint64_t cycles) {
+    return (uint32_t)(clocksource_cyc2ns(cycles) / 1000);
+}
+
+// The TSC usually counts from reset: the first line is firmware and loader
+static void boot_phase_report(void) {
+    kprintf("\nBoot timeline:\n");
+    kprintf("  %s: %u us\n", "before kmain", (unsigned int)boot_cycles_to_us(boot_tsc_start));
+    uint64_t prev = boot_tsc_start;
+    for (uint32_t i = 0; i < boot_phase_count; i++) {
+        kprintf("  %s: %u us\n", boot_phases[i].name,
+                (unsigned int)boot_cycles_to_us(boot_phases[i].tsc - prev));
+        prev = boot_phases[i].tsc;
+    }
+    kprintf("  %s: %u us\n", "kmain total", (unsigned int)boot_cycles_to_us(prev - boot_tsc_start));
+}
+
 // Kernel entry point (called from boot.s)
 // Parameters: multiboot_magic, multiboot_info_addr (passed from boot.s)
 __attribute__((noreturn)) void kmain(uint32_t multiboot_magic, uint32_t multiboot_info_addr) {
     // Phase 1: Initialize HAL (Hardware Abstraction Layer)
     // This must happen first - provides CPU, interrupt, I/O operations
+    boot_tsc_start = timer_read_tsc();
     hal_x86_init();
+    boot_phase_done("hal");
 
     // Phase 2: Initialize per-CPU infrastructure
     // Sets up per-CPU data structures for this boot CPU
     percpu_init();
+    boot_phase_done("percpu");
 
     // Phase 3: Initialize VGA display
     // Now we can print to screen!
@@ -66,31 +119,64 @@ __attribute__((noreturn)) void kmain(uint32_t multiboot_magic, uint32_t multiboo
     kprintf("[OK] Per-CPU data initialized (CPU #%u)\n", (unsigned int)this_cpu()->cpu_id);
     kprintf("[OK] VGA text driver loaded\n");
     kprintf("[OK] IDT initialized (exceptions + IRQs)\n");
+    boot_phase_done("vga");
 
     // Phase 4: Initialize timer
     // Initialize PIT at 1000 Hz and calibrate TSC
     kprintf("\n");
     hal->timer_init(1000);
+    boot_phase_done("timer");
+
+    // Phase 4b: Interrupt-driven serial console (THRE refills the FIFO)
+    if (serial_console_enable_irq() == 0) {
+        kprintf("[OK] Serial console on IRQ %u (%u-byte FIFO)\n",
+                (unsigned int)SERIAL_COM1_IRQ,
+                (unsigned int)serial_console_port()->fifo_size);
+    }
 
     // Phase 5: Initialize physical memory manager
     kprintf("\n");
     struct multiboot_info *mbi = (struct multiboot_info *)(uintptr_t)multiboot_info_addr;
     pmm_init(multiboot_magic, mbi);
+    bootmod_init(multiboot_magic, mbi);
+
+    // Phase 5b: Small-object allocator (needed by the MMU and tasks)
+    slab_init();
+    boot_phase_done("pmm");
 
     // Phase 6: Initialize MMU and enable paging
     kprintf("\n");
     mmu_init();
+    boot_phase_done("mmu");
+
+    // Phase 6b: Find the other CPUs (maps the local APIC)
+    hal->smp_detect();
+    pmu_init();  // Sampling profiler counters, if the CPU has them
+
+    // Phase 6c: Kernel data page (clock and identity readable from ring 3)
+    if (vdso_init() < 0) {
+        kprintf("[VDSO] ERROR: Failed to set up the kernel data page\n");
+    }
+    boot_phase_done("smp detect");
 
     // Phase 7: Initialize task subsystem
     kprintf("\n");
     task_init();
 
-    // Phase 8: Initialize scheduler
+    // Phase 7b: Lazy FPU/SSE switching (tasks own FPU state from here on)
+    fpu_init();
+    boot_phase_done("task");
+
+    // Phase 8: Initialize scheduler and the idle policy (TSC is calibrated)
     scheduler_init();
+    idle_init();
+    boot_phase_done("scheduler");
 
     // Phase 9: Initialize syscalls
     kprintf("\n");
     syscall_init();
+    boot_phase_done("syscall");
+    boot_phase_report();
 
 #ifdef KERNEL_TESTS
     // Run kernel self-tests
@@ -108,6 +194,38 @@ __attribute__((noreturn)) void kmain(uint32_t multiboot_magic, uint32_t multiboo
     }
 #endif
 
+#ifdef KERNEL_BENCH
+    // Cycle budgets of the RT paths (make bench checks the summary line)
+    extern int ktest_bench_all(void);
+    ktest_bench_all();
+#endif
+
+    // Phase 10: Bring up the application processors
+    kprintf("\n");
+    smp_init();
+
+    // Phase 10b: Buffered console (from here on printing never waits for the UART)
+    if (klog_start() < 0) {
+        kprintf("[KLOG] WARNING: no log rings, console stays synchronous\n");
+    }
+    if (work_start() < 0) {
+        kprintf("[WORK] WARNING: no worker threads, deferred work runs at interrupt exit only\n");
+    }
+
+#if CONFIG_TRACE && CONFIG_TRACE_EXPORT
+    // Phase 10c: Trace stream on COM1 (scripts/trace2json.py converts it)
+    trace_set_mask(~0u);
+    if (trace_export_start(serial_console_port(), TRACE_EXPORT_US) < 0) {
+        kprintf("[TRACE] WARNING: trace export not started\n");
+    }
+#endif
+
+#if CONFIG_PMU_PROFILE_PERIOD
+    if (pmu_profile_start(PMU_EVENT_CYCLES, CONFIG_PMU_PROFILE_PERIOD) < 0) {
+        kprintf("[PMU] WARNING: cycle profile not started\n");
+    }
+#endif
+
     // Display CPU information
     uint32_t features = hal->cpu_features();
     kprintf("\nCPU Features: ");
@@ -116,12 +234,14 @@ __attribute__((noreturn)) void kmain(uint32_t multiboot_magic, uint32_t multiboo
     if (features & HAL_CPU_FEAT_SSE2) kprintf("SSE2 ");
     if (features & HAL_CPU_FEAT_PAE)  kprintf("PAE ");
     if (features & HAL_CPU_FEAT_APIC) kprintf("APIC ");
+    if (features & HAL_CPU_FEAT_PSE)  kprintf("PSE ");
+    if (features & HAL_CPU_FEAT_PGE)  kprintf("PGE ");
     kprintf("\n");
 
     // Display memory info
     kprintf("\nMemory Layout:\n");
     kprintf("  Kernel: 0x%08x\n", 0x100000);
-    kprintf("  Per-CPU data: 0x%08x\n", (unsigned int)(uintptr_t)&per_cpu[0]);
+    kprintf("  Per-CPU data: 0x%08x\n", (unsigned int)(uintptr_t)per_cpu[0]);
 
     // Test thread entry point
     extern void test_thread_entry(void* arg);
@@ -138,12 +258,25 @@ __attribute__((noreturn)) void kmain(uint32_t multiboot_magic, uint32_t multiboo
         kprintf("[TEST] ERROR: Failed to create userspace task\n");
     }
 
+    // Every boot module is a user program: one task each, sharing nothing
+    // but the module's read-only pages
+    for (uint32_t i = 0; i < bootmod_count(); i++) {
+        const struct boot_module* mod = bootmod_get(i);
+        task_t* mod_task = task_create_user_elf(mod->name, mod->start, mod->size);
+        if (mod_task) {
+            scheduler_enqueue(mod_task);
+        } else {
+            kprintf("[TEST] ERROR: Boot module '%s' not started\n", mod->name);
+        }
+    }
+
     // Create a test kernel thread
     task_t* test_task = task_create_kernel_thread("test_thread",
                                                     test_thread_entry,
                                                     NULL,
                                                     SCHED_DEFAULT_PRIORITY,
-                                                    4096);
+                                                    4096,
+                                                    0);
     if (test_task) {
         scheduler_enqueue(test_task);
         kprintf("[INIT] Test thread created and enqueued\n");
@@ -185,17 +318,18 @@ void test_thread_entry(void* arg) {
 
     // Wait for timer ticks to confirm interrupts are working
     kprintf("[TEST] Waiting for timer interrupts...\n");
-    extern struct per_cpu_data per_cpu[];
-    uint64_t start_ticks = per_cpu[0].ticks;
+    // Watch this CPU: in tickless mode an idle CPU 0 does not tick
+    struct per_cpu_data* cpu = this_cpu();
+    uint64_t start_ticks = cpu->ticks;
     uint64_t timeout = 10000000;  // Safety timeout
     for (volatile uint64_t i = 0; i < timeout; i++) {
-        if (per_cpu[0].ticks > start_ticks + 10) {
+        if (cpu->ticks > start_ticks + 10) {
             kprintf("[TEST] Timer confirmed working (saw %llu ticks)\n\n",
-                    (unsigned long long)(per_cpu[0].ticks - start_ticks));
+                    (unsigned long long)(cpu->ticks - start_ticks));
             break;
         }
     }
-    if (per_cpu[0].ticks <= start_ticks) {
+    if (cpu->ticks <= start_ticks) {
         kprintf("[TEST] WARNING: No timer ticks detected! Interrupts may be disabled!\n\n");
     }
 
@@ -205,23 +339,25 @@ void test_thread_entry(void* arg) {
 
     // Test 1: sys_getpid
     kprintf("[TEST] Testing sys_getpid()...\n");
-    long pid = syscall_handler(SYS_GETPID, 0, 0, 0, 0, 0);
+    long pid = syscall_handler(SYS_GETPID, 0, 0, 0, 0, 0, NULL);
     kprintf("[TEST] sys_getpid() returned: %ld\n", pid);
 
     // Test 2: sys_yield
     kprintf("[TEST] Testing sys_yield()...\n");
-    long ret = syscall_handler(SYS_YIELD, 0, 0, 0, 0, 0);
+    long ret = syscall_handler(SYS_YIELD, 0, 0, 0, 0, 0, NULL);
     kprintf("[TEST] sys_yield() returned: %ld\n", ret);
 
     // Test 3: Invalid syscall
     kprintf("[TEST] Testing invalid syscall (999)...\n");
-    ret = syscall_handler(999, 0, 0, 0, 0, 0);
+    ret = syscall_handler(999, 0, 0, 0, 0, 0, NULL);
     kprintf("[TEST] Invalid syscall returned: %ld (expected -38)\n", ret);
 
-    // Test 4: sys_sleep_us (disabled for now – needs stable sleep queues)
-    // kprintf("[TEST] Testing sys_sleep_us(100000) - 100ms...\n");
-    // ret = syscall_handler(SYS_SLEEP_US, 100000, 0, 0, 0, 0);
-    // kprintf("[TEST] sys_sleep_us() returned: %ld\n", ret);
+    // Test 4: sys_sleep_us
+    kprintf("[TEST] Testing sys_sleep_us(100000) - 100ms...\n");
+    uint64_t sleep_start = hal->timer_read_us();
+    ret = syscall_handler(SYS_SLEEP_US, 100000, 0, 0, 0, 0, NULL);
+    kprintf("[TEST] sys_sleep_us() returned: %ld after %u us\n", ret,
+            (unsigned int)(hal->timer_read_us() - sleep_start));
 
     kprintf("[TEST] Phase A tests complete!\n\n");
 
@@ -271,6 +407,9 @@ __attribute__((noreturn)) void kernel_panic(const char* message) {
         hal->irq_disable();
     }
 
+    // Write out what is still queued, then print directly
+    klog_panic_flush();
+
     // Red screen of death
     if (vga) {
         vga->set_color(VGA_COLOR_WHITE, VGA_COLOR_RED);
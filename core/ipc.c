@@ -0,0 +1,170 @@
+/**
+ * Synchronous IPC
+ *
+ * Call / reply-and-wait on endpoints (see include/kernel/ipc.h).
+ *
+ * A task blocked in IPC is on no wait queue: it is owned by whichever
+ * side unblocked it (the server owes its caller a reply, a caller hands
+ * the waiting server a request), and only that side makes it runnable,
+ * either by switching to it directly or through scheduler_enqueue().
+ * The owner writes the message into the sleeper's task struct first.
+ *
+ * A sleeper may still be switching out on another CPU when it is handed
+ * over; scheduler_switch_to() then takes the normal wakeup path, which
+ * copes with that (see core/waitqueue.c).
+ */
+
+#include <kernel/ipc.h>
+#include <kernel/task.h>
+#include <kernel/scheduler.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+
+static ipc_endpoint_t ipc_endpoints[IPC_MAX_ENDPOINTS];
+static atomic_t ipc_endpoints_used;
+
+// Spin only: callers run with interrupts off
+static inline void ep_lock(ipc_endpoint_t* ep) {
+    spin_lock(&ep->lock);
+}
+
+static inline void ep_unlock(ipc_endpoint_t* ep) {
+    spin_unlock(&ep->lock);
+}
+
+// Current task, if it may sleep (IRQs off)
+static task_t* ipc_current(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    task_t* current = cpu->current_task;
+    if (!current || current == cpu->idle_task || current->state != TASK_STATE_RUNNING) {
+        return NULL;
+    }
+    return current;
+}
+
+void ipc_endpoint_init(ipc_endpoint_t* ep) {
+    spin_lock_init(&ep->lock);
+    ep->server = NULL;
+    ep->callers = NULL;
+    ep->callers_tail = NULL;
+    ep->calls = 0;
+    ep->queued_calls = 0;
+}
+
+int ipc_call(ipc_endpoint_t* ep, struct ipc_msg* msg) {
+    uint32_t flags = hal->irq_disable();
+    task_t* current = ipc_current();
+    if (!current) {
+        hal->irq_restore(flags);
+        return -EPERM;
+    }
+
+    ep_lock(ep);
+    ep->calls++;
+    current->state = TASK_STATE_BLOCKED;
+
+    task_t* server = ep->server;
+    if (server) {
+        ep->server = NULL;
+        server->ipc_msg = *msg;
+        server->ipc_reply_to = current;
+    } else {
+        // Server busy: it picks the request up in its next ipc_reply_wait()
+        current->ipc_msg = *msg;
+        current->ipc_next = NULL;
+        if (ep->callers_tail) {
+            ep->callers_tail->ipc_next = current;
+        } else {
+            ep->callers = current;
+        }
+        ep->callers_tail = current;
+        ep->queued_calls++;
+    }
+    ep_unlock(ep);
+
+    if (server) {
+        scheduler_switch_to(server);
+    } else {
+        schedule();
+    }
+    hal->irq_restore(flags);
+
+    *msg = current->ipc_msg;
+    return 0;
+}
+
+int ipc_reply_wait(ipc_endpoint_t* ep, struct ipc_msg* msg) {
+    uint32_t flags = hal->irq_disable();
+    task_t* current = ipc_current();
+    if (!current) {
+        hal->irq_restore(flags);
+        return -EPERM;
+    }
+
+    ep_lock(ep);
+    if (ep->server) {
+        ep_unlock(ep);
+        hal->irq_restore(flags);
+        return -EBUSY;
+    }
+
+    task_t* caller = current->ipc_reply_to;
+    current->ipc_reply_to = NULL;
+    if (caller) {
+        caller->ipc_msg = *msg;
+    }
+
+    // A queued request: take it without sleeping; the caller just
+    // replied to waits its turn on the run queue
+    task_t* next = ep->callers;
+    if (next) {
+        ep->callers = next->ipc_next;
+        if (!ep->callers) {
+            ep->callers_tail = NULL;
+        }
+        next->ipc_next = NULL;
+        current->ipc_reply_to = next;
+        *msg = next->ipc_msg;
+        ep_unlock(ep);
+
+        if (caller) {
+            caller->state = TASK_STATE_READY;
+            scheduler_enqueue(caller);
+        }
+        hal->irq_restore(flags);
+        return 0;
+    }
+
+    ep->server = current;
+    current->state = TASK_STATE_BLOCKED;
+    ep_unlock(ep);
+
+    // The reply goes straight back to the caller's CPU slot
+    if (caller) {
+        scheduler_switch_to(caller);
+    } else {
+        schedule();
+    }
+    hal->irq_restore(flags);
+
+    *msg = current->ipc_msg;
+    return 0;
+}
+
+int ipc_endpoint_create(void) {
+    uint32_t index = atomic_inc(&ipc_endpoints_used);
+    if (index >= IPC_MAX_ENDPOINTS) {
+        atomic_dec(&ipc_endpoints_used);
+        return -ENOMEM;
+    }
+    ipc_endpoint_init(&ipc_endpoints[index]);
+    return (int)index + 1;
+}
+
+ipc_endpoint_t* ipc_endpoint_lookup(int id) {
+    if (id <= 0 || (uint32_t)id > atomic_read(&ipc_endpoints_used) ||
+        id > IPC_MAX_ENDPOINTS) {
+        return NULL;
+    }
+    return &ipc_endpoints[id - 1];
+}
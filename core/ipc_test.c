@@ -0,0 +1,32 @@
+/**
+ * Unit tests for synchronous IPC
+ *
+ * Tests run from the bootstrap context, which cannot block, so only the
+ * paths that return without sleeping are covered here.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/ipc.h>
+
+// Test: endpoint IDs and the wrong-context refusals leave no trace
+static int test_ipc_no_block(void) {
+    int id = ipc_endpoint_create();
+    KTEST_ASSERT(id > 0 && id <= IPC_MAX_ENDPOINTS, "endpoint created");
+
+    ipc_endpoint_t* ep = ipc_endpoint_lookup(id);
+    KTEST_ASSERT_NOT_NULL(ep, "endpoint found");
+    KTEST_ASSERT_NULL(ipc_endpoint_lookup(0), "ID 0 is invalid");
+    KTEST_ASSERT_NULL(ipc_endpoint_lookup(id + 1), "unclaimed ID is invalid");
+
+    struct ipc_msg msg = { { 1, 2, 3 } };
+    KTEST_ASSERT_EQ(ipc_call(ep, &msg), -EPERM, "bootstrap cannot call");
+    KTEST_ASSERT_EQ(ipc_reply_wait(ep, &msg), -EPERM, "bootstrap cannot serve");
+    KTEST_ASSERT_EQ(msg.w[0], 1, "message untouched");
+    KTEST_ASSERT_NULL(ep->server, "no server recorded");
+    KTEST_ASSERT_NULL(ep->callers, "no caller queued");
+    KTEST_ASSERT_EQ(ep->calls, 0, "no call counted");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("ipc", ipc_no_block, test_ipc_no_block);
@@ -0,0 +1,342 @@
+/**
+ * Buffered console log
+ *
+ * Per-CPU record rings, the drainer and klogd (see include/kernel/klog.h).
+ *
+ * A record is a header followed by its text, padded to 4 bytes; records
+ * wrap around the end of the ring. head and tail count bytes and run
+ * freely; only the owning CPU moves head, only the drain lock holder
+ * moves tail.
+ */
+
+#include <kernel/klog.h>
+#include <kernel/console.h>
+#include <kernel/spinlock.h>
+#include <kernel/scheduler.h>
+#include <kernel/task.h>
+#include <kernel/pmm.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+#define KLOG_RING_ORDER     2
+#define KLOG_RING_MASK      (KLOG_RING_SIZE - 1)
+#define KLOG_PRIORITY       (SCHED_IDLE_PRIORITY + 1)
+
+_Static_assert((PAGE_SIZE << KLOG_RING_ORDER) == KLOG_RING_SIZE,
+               "KLOG_RING_ORDER must match KLOG_RING_SIZE");
+
+struct klog_rec {
+    uint32_t stamp_lo;      // TSC when appended
+    uint32_t stamp_hi;
+    uint16_t len;           // Text bytes after the header
+    uint8_t  type;          // klog_rec_type_t
+    uint8_t  arg;
+};
+
+struct klog_ring {
+    // Producer (owning CPU)
+    volatile uint32_t head;
+    uint32_t          dropped;
+    uint64_t          records;
+    uint64_t          bytes;
+    char*             buf;
+    // Consumer (drain lock holder)
+    volatile uint32_t tail __attribute__((aligned(64)));
+    uint32_t          reported;     // `dropped` already reported
+} __attribute__((aligned(64)));
+
+static struct klog_ring klog_rings[MAX_CPUS];
+static uint32_t klog_nr_rings;
+static volatile bool klog_buffering;
+static spinlock_t klog_drain_lock;
+static uint64_t klog_drained;
+static task_t* klogd_task;
+
+static inline uint32_t rec_size(uint32_t len) {
+    return (uint32_t)(sizeof(struct klog_rec) + len + 3) & ~3u;
+}
+
+static void ring_copy_in(struct klog_ring* ring, uint32_t pos, const void* src, uint32_t n) {
+    uint32_t off = pos & KLOG_RING_MASK;
+    uint32_t first = n < KLOG_RING_SIZE - off ? n : KLOG_RING_SIZE - off;
+    memcpy(ring->buf + off, src, first);
+    memcpy(ring->buf, (const char*)src + first, n - first);
+}
+
+static void ring_copy_out(const struct klog_ring* ring, uint32_t pos, void* dst, uint32_t n) {
+    uint32_t off = pos & KLOG_RING_MASK;
+    uint32_t first = n < KLOG_RING_SIZE - off ? n : KLOG_RING_SIZE - off;
+    memcpy(dst, ring->buf + off, first);
+    memcpy((char*)dst + first, ring->buf, n - first);
+}
+
+// Queue a record on this CPU's ring; false if the caller should print directly
+static bool klog_append(uint8_t type, uint8_t arg, const char* text, uint32_t len) {
+    if (!klog_buffering) {
+        return false;
+    }
+
+    uint32_t flags = hal->irq_disable();
+    uint32_t cpu = hal->cpu_id();
+    if (cpu >= klog_nr_rings || !klog_buffering) {
+        hal->irq_restore(flags);
+        return false;
+    }
+    struct klog_ring* ring = &klog_rings[cpu];
+
+    uint32_t head = ring->head;
+    uint32_t need = rec_size(len);
+    if (need > KLOG_RING_SIZE - (head - ring->tail)) {
+        ring->dropped++;
+        hal->irq_restore(flags);
+        return true;
+    }
+
+    uint64_t stamp = hal->timer_read_tsc();
+    struct klog_rec rec = {
+        .stamp_lo = (uint32_t)stamp,
+        .stamp_hi = (uint32_t)(stamp >> 32),
+        .len = (uint16_t)len,
+        .type = type,
+        .arg = arg,
+    };
+    ring_copy_in(ring, head, &rec, sizeof(rec));
+    ring_copy_in(ring, head + sizeof(rec), text, len);
+    wmb();  // Record before the head that publishes it
+    ring->head = head + need;
+    ring->records++;
+    ring->bytes += len;
+
+    hal->irq_restore(flags);
+    return true;
+}
+
+static void emit(uint8_t type, uint8_t arg, const char* text, uint32_t len) {
+    switch (type) {
+        case KLOG_REC_TEXT:
+            console_write(text, len);
+            break;
+        case KLOG_REC_COLOR:
+            if (vga && vga->set_color) {
+                vga->set_color((enum vga_color)(arg & 0xF), (enum vga_color)(arg >> 4));
+            }
+            break;
+        case KLOG_REC_CLEAR:
+            if (vga && vga->clear) {
+                vga->clear();
+            }
+            break;
+    }
+}
+
+static void report_dropped(uint32_t cpu, uint32_t count) {
+    char line[48] = "[KLOG] CPU ";
+    size_t len = 11;
+    uint32_t values[2] = { cpu, count };
+    for (int v = 0; v < 2; v++) {
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = (char)('0' + values[v] % 10);
+            values[v] /= 10;
+        } while (values[v]);
+        while (n) {
+            line[len++] = digits[--n];
+        }
+        if (v == 0) {
+            memcpy(line + len, ": ", 2);
+            len += 2;
+        }
+    }
+    memcpy(line + len, " record(s) dropped\n", 19);
+    console_write(line, len + 19);
+}
+
+// Write out every queued record, oldest first (drain lock held)
+static void drain_locked(void) {
+    char text[KLOG_RECORD_MAX];
+
+    for (;;) {
+        struct klog_ring* oldest = NULL;
+        struct klog_rec rec = { 0 };
+        uint64_t oldest_stamp = 0;
+
+        for (uint32_t cpu = 0; cpu < klog_nr_rings; cpu++) {
+            struct klog_ring* ring = &klog_rings[cpu];
+            if (ring->head == ring->tail) {
+                continue;
+            }
+            rmb();  // Head before the record it published
+            struct klog_rec peek;
+            ring_copy_out(ring, ring->tail, &peek, sizeof(peek));
+            uint64_t stamp = ((uint64_t)peek.stamp_hi << 32) | peek.stamp_lo;
+            if (!oldest || (int64_t)(stamp - oldest_stamp) < 0) {
+                oldest = ring;
+                oldest_stamp = stamp;
+                rec = peek;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+
+        uint32_t len = rec.len <= KLOG_RECORD_MAX ? rec.len : KLOG_RECORD_MAX;
+        ring_copy_out(oldest, oldest->tail + sizeof(rec), text, len);
+        mb();  // Record copied out before the producer may reuse it
+        oldest->tail += rec_size(rec.len);
+        klog_drained++;
+
+        emit(rec.type, rec.arg, text, len);
+    }
+
+    for (uint32_t cpu = 0; cpu < klog_nr_rings; cpu++) {
+        struct klog_ring* ring = &klog_rings[cpu];
+        uint32_t dropped = ring->dropped;
+        if (dropped != ring->reported) {
+            report_dropped(cpu, dropped - ring->reported);
+            ring->reported = dropped;
+        }
+    }
+}
+
+int klog_init(void) {
+    if (klog_nr_rings) {
+        return 0;
+    }
+
+    uint32_t nr = hal->smp_num_cpus();
+    if (nr == 0) {
+        nr = 1;
+    }
+    if (nr > MAX_CPUS) {
+        nr = MAX_CPUS;
+    }
+
+    for (uint32_t cpu = 0; cpu < nr; cpu++) {
+        phys_addr_t block = pmm_alloc_pages(KLOG_RING_ORDER);
+        if (!block) {
+            for (uint32_t i = 0; i < cpu; i++) {
+                pmm_free_pages((phys_addr_t)(uintptr_t)klog_rings[i].buf, KLOG_RING_ORDER);
+                klog_rings[i].buf = NULL;
+            }
+            return -ENOMEM;
+        }
+        klog_rings[cpu].buf = (char*)(uintptr_t)block;
+    }
+
+    spin_lock_init(&klog_drain_lock);
+    wmb();  // Rings ready before anyone sees the count
+    klog_nr_rings = nr;
+    return 0;
+}
+
+int klog_buffer(bool on) {
+    if (on && !klog_nr_rings) {
+        return -ENODEV;
+    }
+    klog_buffering = on;
+    return 0;
+}
+
+static void klogd_main(void* arg) {
+    (void)arg;
+    for (;;) {
+        klog_flush();
+        task_sleep_us(KLOG_DRAIN_US);
+    }
+}
+
+int klog_start(void) {
+    int rc = klog_init();
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (!klogd_task) {
+        klogd_task = task_create_kernel_thread("klogd", klogd_main, NULL,
+                                               KLOG_PRIORITY, 4096, 0);
+        if (!klogd_task) {
+            return -ENOMEM;
+        }
+        scheduler_enqueue(klogd_task);
+    }
+
+    kprintf("[KLOG] Buffered console: %u x %u KB rings, drained by klogd\n",
+            (unsigned int)klog_nr_rings, (unsigned int)(KLOG_RING_SIZE / 1024));
+    return klog_buffer(true);
+}
+
+void klog_write(const char* str, size_t len) {
+    while (len > 0) {
+        uint32_t chunk = len < KLOG_RECORD_MAX ? (uint32_t)len : KLOG_RECORD_MAX;
+        if (!klog_append(KLOG_REC_TEXT, 0, str, chunk)) {
+            console_write(str, len);
+            return;
+        }
+        str += chunk;
+        len -= chunk;
+    }
+}
+
+void klog_set_color(uint8_t fg, uint8_t bg) {
+    uint8_t arg = (uint8_t)((fg & 0xF) | (bg << 4));
+    if (!klog_append(KLOG_REC_COLOR, arg, NULL, 0)) {
+        emit(KLOG_REC_COLOR, arg, NULL, 0);
+    }
+}
+
+void klog_clear(void) {
+    if (!klog_append(KLOG_REC_CLEAR, 0, NULL, 0)) {
+        emit(KLOG_REC_CLEAR, 0, NULL, 0);
+    }
+}
+
+void klog_flush(void) {
+    if (!klog_nr_rings || !spin_trylock(&klog_drain_lock)) {
+        return;
+    }
+    drain_locked();
+    spin_unlock(&klog_drain_lock);
+}
+
+void klog_panic_flush(void) {
+    klog_buffering = false;
+    if (!klog_nr_rings) {
+        return;
+    }
+
+    // A drainer elsewhere may never let go; duplicated lines beat lost ones
+    bool locked = spin_trylock(&klog_drain_lock);
+    drain_locked();
+    if (locked) {
+        spin_unlock(&klog_drain_lock);
+    }
+}
+
+uint32_t klog_pending(void) {
+    uint32_t pending = 0;
+    for (uint32_t cpu = 0; cpu < klog_nr_rings; cpu++) {
+        const struct klog_ring* ring = &klog_rings[cpu];
+        for (uint32_t pos = ring->tail; pos != ring->head; ) {
+            struct klog_rec rec;
+            ring_copy_out(ring, pos, &rec, sizeof(rec));
+            pos += rec_size(rec.len);
+            pending++;
+        }
+    }
+    return pending;
+}
+
+void klog_get_stats(struct klog_stats* stats) {
+    stats->records = 0;
+    stats->bytes = 0;
+    stats->dropped = 0;
+    for (uint32_t cpu = 0; cpu < klog_nr_rings; cpu++) {
+        stats->records += klog_rings[cpu].records;
+        stats->bytes += klog_rings[cpu].bytes;
+        stats->dropped += klog_rings[cpu].dropped;
+    }
+    stats->drained = klog_drained;
+}
@@ -0,0 +1,69 @@
+/**
+ * Unit tests for the buffered console log
+ *
+ * klogd is not running yet, so the tests turn buffering on themselves,
+ * queue a few records, turn it off again and drain by hand. Assertions
+ * come after the drain so a failure message is never left queued.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/klog.h>
+#include <drivers/vga.h>
+
+// Test: records queue up in order and drain completely
+static int test_klog_buffered(void) {
+    KTEST_ASSERT_EQ(klog_init(), 0, "rings allocated");
+    KTEST_ASSERT_EQ(klog_pending(), 0, "nothing queued before buffering");
+
+    struct klog_stats before, queued, after;
+    klog_get_stats(&before);
+
+    KTEST_ASSERT_EQ(klog_buffer(true), 0, "buffering on");
+    kprintf("  [klog] first buffered line\n");
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    kprintf("  [klog] second buffered line\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+    uint32_t pending = klog_pending();
+    klog_get_stats(&queued);
+    klog_buffer(false);
+
+    klog_flush();
+    klog_get_stats(&after);
+
+    KTEST_ASSERT_EQ(pending, 4, "two lines and two colors queued");
+    KTEST_ASSERT_EQ(queued.records - before.records, 4, "records counted");
+    KTEST_ASSERT_EQ(queued.dropped, before.dropped, "nothing dropped");
+    KTEST_ASSERT_EQ(klog_pending(), 0, "flush emptied the rings");
+    KTEST_ASSERT_EQ(after.drained - before.drained, 4, "every record drained");
+
+    return KTEST_PASS;
+}
+
+// Test: a write longer than one record is split, not truncated
+static int test_klog_split(void) {
+    static char line[KLOG_RECORD_MAX + 40];
+    for (size_t i = 0; i < sizeof(line) - 1; i++) {
+        line[i] = '.';
+    }
+    line[sizeof(line) - 1] = '\n';
+
+    struct klog_stats before, after;
+    KTEST_ASSERT_EQ(klog_init(), 0, "rings allocated");
+    klog_get_stats(&before);
+
+    klog_buffer(true);
+    klog_write(line, sizeof(line));
+    uint32_t pending = klog_pending();
+    klog_buffer(false);
+    klog_flush();
+    klog_get_stats(&after);
+
+    KTEST_ASSERT_EQ(pending, 2, "split into two records");
+    KTEST_ASSERT_EQ(after.bytes - before.bytes, sizeof(line), "every byte queued");
+    KTEST_ASSERT_EQ(klog_pending(), 0, "drained");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("klog", klog_buffered, test_klog_buffered);
+KTEST_DEFINE("klog", klog_split, test_klog_split);
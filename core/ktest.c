@@ -1,16 +1,26 @@
 /**
  * Kernel Testing Framework Implementation
  *
- * Runs tests registered in the .ktests section at boot time.
+ * Runs tests registered in the .ktests section at boot time, and the
+ * benchmarks in .kbenches.
  */
 
 #include <kernel/ktest.h>
+#include <kernel/timer.h>
+#include <kernel/task.h>
+#include <kernel/scheduler.h>
+#include <kernel/percpu.h>
+#include <kernel/hal.h>
 #include <drivers/vga.h>
 
 // External symbols provided by linker for .ktests section
 extern struct ktest __start_ktests[];
 extern struct ktest __stop_ktests[];
 
+// External symbols provided by linker for .kbenches section
+extern struct kbench __start_kbenches[];
+extern struct kbench __stop_kbenches[];
+
 /**
  * Run all registered kernel tests
  * Returns: Number of failed tests (0 = all pass)
@@ -125,3 +135,118 @@ int ktest_run_subsystem(const char *subsystem) {
 
     return failed;
 }
+
+int ktest_run_queued(struct task *task, ktest_queued_fn probe, void *arg) {
+    KTEST_ASSERT_NOT_NULL(task, "task created");
+
+    // Nothing may run the task: it stays queued only within this window
+    uint32_t flags = hal->irq_disable();
+    scheduler_enqueue(task);
+
+    int result = probe(task, arg);
+
+    if (task->on_rq) {
+        scheduler_dequeue(task);
+    }
+    this_cpu()->sched->need_resched = false;
+    hal->irq_restore(flags);
+    task_destroy(task);
+
+    return result;
+}
+
+// ========== Benchmarks ==========
+
+static uint64_t bench_samples[KBENCH_SAMPLES];
+
+// Cheapest back-to-back TSC read pair: subtracted from every sample
+static uint64_t bench_tsc_overhead(void) {
+    uint64_t best = ~0ULL;
+    for (int i = 0; i < 64; i++) {
+        uint64_t start = timer_read_tsc();
+        uint64_t cycles = timer_read_tsc() - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+static void bench_sort(uint64_t *v, int n) {
+    for (int i = 1; i < n; i++) {
+        uint64_t x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+}
+
+/**
+ * Run all registered benchmarks
+ * Returns: Number of benchmarks whose median exceeds the budget
+ */
+int ktest_bench_all(void) {
+    struct kbench *bench;
+    int over = 0;
+    uint64_t overhead = bench_tsc_overhead();
+
+    kprintf("\n");
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    kprintf("========================================\n");
+    kprintf("  KERNEL BENCHMARKS (TSC cycles)\n");
+    kprintf("========================================\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+    kprintf("TSC read overhead: %u cycles (subtracted)\n\n", (unsigned int)overhead);
+
+    for (bench = __start_kbenches; bench < __stop_kbenches; bench++) {
+        if (bench->setup && bench->setup() != 0) {
+            kprintf("[BENCH] %s::%s SKIP (setup failed)\n", bench->subsystem, bench->name);
+            continue;
+        }
+
+        for (int i = 0; i < KBENCH_WARMUP; i++) {
+            bench->bench_fn();
+        }
+        for (int i = 0; i < KBENCH_SAMPLES; i++) {
+            uint64_t cycles = bench->bench_fn();
+            bench_samples[i] = cycles > overhead ? cycles - overhead : 0;
+        }
+
+        if (bench->teardown) {
+            bench->teardown();
+        }
+
+        bench_sort(bench_samples, KBENCH_SAMPLES);
+        uint64_t median = bench_samples[KBENCH_SAMPLES / 2];
+        bool within = bench->budget_cycles == 0 || median <= bench->budget_cycles;
+
+        kprintf("[BENCH] %s::%s min=%u median=%u p99=%u max=%u",
+                bench->subsystem, bench->name,
+                (unsigned int)bench_samples[0], (unsigned int)median,
+                (unsigned int)bench_samples[KBENCH_SAMPLES * 99 / 100],
+                (unsigned int)bench_samples[KBENCH_SAMPLES - 1]);
+        if (bench->budget_cycles == 0) {
+            kprintf("\n");
+        } else if (within) {
+            vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+            kprintf(" budget=%u OK\n", (unsigned int)bench->budget_cycles);
+            vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+        } else {
+            vga_set_color(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK);
+            kprintf(" budget=%u OVER\n", (unsigned int)bench->budget_cycles);
+            vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+            over++;
+        }
+    }
+
+    kprintf("\n");
+    if (over == 0) {
+        kprintf("[BENCH] All budgets met\n");
+    } else {
+        kprintf("[BENCH] %d benchmark(s) over budget\n", over);
+    }
+    return over;
+}
@@ -0,0 +1,382 @@
+/**
+ * Kernel Timers - Hierarchical Timing Wheel
+ *
+ * Classic cascading wheel (see include/kernel/ktimer.h). A timer due at
+ * wheel tick E lives in the lowest level L whose span covers E - now, in
+ * slot (E >> (L * KTIMER_SLOT_BITS)) % KTIMER_SLOTS. When level 0 wraps,
+ * the current slot of level 1 is re-filed into level 0, and so on up the
+ * levels whose index just wrapped as well.
+ *
+ * Per-slot occupancy bitmaps make the next-deadline query O(1), and let
+ * ktimer_run() skip ahead over empty ticks after a long tickless sleep.
+ *
+ * RT Constraints:
+ * - ktimer_add()/ktimer_cancel(): O(1), one wheel lock
+ * - Callbacks run with the wheel unlocked, so they may add or cancel
+ */
+
+#ifdef HOST_TEST
+    // Host-side testing: one CPU, time supplied by the test
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <stdbool.h>
+    #include "../include/kernel/ktimer.h"
+    #include "../include/kernel/spinlock.h"
+
+    #define KTIMER_NR_WHEELS 1
+    #define ktimer_cpu() 0u
+    #define ktimer_now_us() ktimer_host_now_us
+    #define ktimer_kick_hw(deadline_us) ((void)(deadline_us))
+
+    uint64_t ktimer_host_now_us;
+#else
+    #include <kernel/ktimer.h>
+    #include <kernel/hal.h>
+    #include <kernel/spinlock.h>
+    #include <kernel/percpu.h>
+    #include <kernel/timer.h>
+
+    #define KTIMER_NR_WHEELS MAX_CPUS
+    #define ktimer_cpu() hal->cpu_id()
+    #define ktimer_now_us() timer_read_us()
+
+    // Tickless: make sure this CPU's one-shot fires by the new deadline
+    #define ktimer_kick_hw(deadline_us) timer_event_update(deadline_us)
+#endif
+
+#define KTIMER_SLOT_MASK    (KTIMER_SLOTS - 1)
+#define KTIMER_BITMAP_WORDS (KTIMER_SLOTS / 32)
+
+// Whole-wheel span in ticks; later deadlines park at its far end
+#define KTIMER_SPAN         (1ULL << (KTIMER_SLOT_BITS * KTIMER_LEVELS))
+
+// Pseudo-level of timers detached for firing (wheel.expired)
+#define KTIMER_LEVEL_EXPIRED KTIMER_LEVELS
+
+struct ktimer_wheel {
+    struct ktimer* slots[KTIMER_LEVELS][KTIMER_SLOTS];
+    uint32_t occupied[KTIMER_LEVELS][KTIMER_BITMAP_WORDS];
+    struct ktimer* expired;     // Timers due this tick, being fired
+    struct ktimer* running;     // Callback executing right now
+    uint64_t now;               // Next wheel tick to process
+    uint32_t pending;           // Timers queued (slots + expired)
+    spinlock_t lock;
+};
+
+static struct ktimer_wheel wheels[KTIMER_NR_WHEELS];
+
+#ifdef HOST_TEST
+static inline uint32_t wheel_lock(struct ktimer_wheel* wheel) {
+    (void)wheel;
+    return 0;
+}
+
+static inline void wheel_unlock(struct ktimer_wheel* wheel, uint32_t state) {
+    (void)wheel;
+    (void)state;
+}
+#else
+// Wheels are touched from their own CPU's interrupt and by cancels from
+// anywhere: spin with interrupts off, innermost in the lock order
+static inline uint32_t wheel_lock(struct ktimer_wheel* wheel) {
+    return spin_lock_irqsave(&wheel->lock);
+}
+
+static inline void wheel_unlock(struct ktimer_wheel* wheel, uint32_t state) {
+    spin_unlock_irqrestore(&wheel->lock, state);
+}
+#endif
+
+static inline struct ktimer** slot_head(struct ktimer_wheel* wheel, const struct ktimer* timer) {
+    if (timer->level == KTIMER_LEVEL_EXPIRED) {
+        return &wheel->expired;
+    }
+    return &wheel->slots[timer->level][timer->slot];
+}
+
+static inline bool level_empty(const struct ktimer_wheel* wheel, uint32_t level) {
+    for (uint32_t w = 0; w < KTIMER_BITMAP_WORDS; w++) {
+        if (wheel->occupied[level][w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * First occupied slot at or after `from` in one level
+ *
+ * @return Slot index, or -1 if none
+ */
+static int find_slot_from(const struct ktimer_wheel* wheel, uint32_t level, uint32_t from) {
+    for (uint32_t w = from / 32; w < KTIMER_BITMAP_WORDS; w++) {
+        uint32_t bits = wheel->occupied[level][w];
+        if (w == from / 32) {
+            bits &= ~0u << (from % 32);
+        }
+        if (bits) {
+            return (int)(w * 32 + (uint32_t)__builtin_ctz(bits));
+        }
+    }
+    return -1;
+}
+
+/**
+ * Next wheel tick that has work: a level-0 slot to fire or an occupied
+ * higher slot to cascade. Ticks before it can be skipped wholesale.
+ *
+ * A level-L slot s is processed when the wheel reaches the tick whose
+ * level-L digit is s and whose lower digits are all 0. Slots behind the
+ * current digit belong to the next rotation, which starts at a cascade
+ * point of the level above.
+ *
+ * RT: O(KTIMER_LEVELS)
+ */
+static uint64_t wheel_next_tick(const struct ktimer_wheel* wheel) {
+    uint64_t best = UINT64_MAX;
+
+    for (uint32_t level = 0; level < KTIMER_LEVELS; level++) {
+        if (level_empty(wheel, level)) {
+            continue;
+        }
+
+        uint32_t shift = KTIMER_SLOT_BITS * level;
+        uint64_t rotation = 1ULL << (shift + KTIMER_SLOT_BITS);
+        uint64_t base = wheel->now & ~(rotation - 1);
+        uint32_t digit = (uint32_t)(wheel->now >> shift) & KTIMER_SLOT_MASK;
+
+        // The current slot is still ahead only if its tick is now itself
+        bool current_due = (wheel->now & ((1ULL << shift) - 1)) == 0;
+        uint32_t from = current_due ? digit : digit + 1;
+
+        int slot = from < KTIMER_SLOTS ? find_slot_from(wheel, level, from) : -1;
+        uint64_t tick = slot >= 0 ? base + ((uint64_t)(uint32_t)slot << shift)
+                                  : base + rotation;
+        if (tick < best) {
+            best = tick;
+        }
+    }
+    return best;
+}
+
+/**
+ * File a timer into the level and slot its deadline falls into
+ */
+static void wheel_link(struct ktimer_wheel* wheel, struct ktimer* timer) {
+    // Overdue timers go into the slot processed next
+    uint64_t expires = timer->expires < wheel->now ? wheel->now : timer->expires;
+    uint64_t delta = expires - wheel->now;
+
+    if (delta >= KTIMER_SPAN) {
+        expires = wheel->now + KTIMER_SPAN - 1;
+        delta = KTIMER_SPAN - 1;
+    }
+
+    uint32_t level = 0;
+    while (level < KTIMER_LEVELS - 1 &&
+           delta >= (1ULL << (KTIMER_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint32_t slot = (uint32_t)(expires >> (KTIMER_SLOT_BITS * level)) & KTIMER_SLOT_MASK;
+
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    timer->prev = NULL;
+    timer->next = wheel->slots[level][slot];
+    if (timer->next) {
+        timer->next->prev = timer;
+    }
+    wheel->slots[level][slot] = timer;
+    wheel->occupied[level][slot / 32] |= 1u << (slot % 32);
+    wheel->pending++;
+}
+
+static void wheel_unlink(struct ktimer_wheel* wheel, struct ktimer* timer) {
+    struct ktimer** head = slot_head(wheel, timer);
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        *head = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+
+    if (timer->level != KTIMER_LEVEL_EXPIRED && !*head) {
+        wheel->occupied[timer->level][timer->slot / 32] &= ~(1u << (timer->slot % 32));
+    }
+    wheel->pending--;
+}
+
+/**
+ * Re-file one slot of a higher level into the levels below
+ */
+static void wheel_cascade(struct ktimer_wheel* wheel, uint32_t level, uint32_t slot) {
+    struct ktimer* timer = wheel->slots[level][slot];
+    while (timer) {
+        struct ktimer* next = timer->next;
+        wheel_unlink(wheel, timer);
+        wheel_link(wheel, timer);
+        timer = next;
+    }
+}
+
+void ktimer_init(struct ktimer* timer, ktimer_fn fn, void* arg) {
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->cpu = 0;
+    timer->level = 0;
+    timer->slot = 0;
+    timer->pending = false;
+}
+
+int ktimer_add(struct ktimer* timer, uint64_t delay_us) {
+    if (!timer || !timer->fn) {
+        return -EINVAL;
+    }
+
+    uint32_t cpu = ktimer_cpu();
+    struct ktimer_wheel* wheel = &wheels[cpu];
+    uint64_t now_us = ktimer_now_us();
+
+    uint32_t state = wheel_lock(wheel);
+    if (timer->pending) {
+        wheel_unlock(wheel, state);
+        return -EBUSY;
+    }
+
+    // An empty wheel has nothing to catch up on
+    uint64_t now_tick = now_us >> KTIMER_TICK_SHIFT;
+    if (wheel->pending == 0 && wheel->now < now_tick) {
+        wheel->now = now_tick;
+    }
+
+    // Round up: never fire before delay_us has passed
+    uint64_t deadline_us = now_us + delay_us;
+    if (deadline_us < now_us) {
+        deadline_us = UINT64_MAX - KTIMER_TICK_US;
+    }
+    timer->expires = (deadline_us + KTIMER_TICK_US - 1) >> KTIMER_TICK_SHIFT;
+    timer->cpu = cpu;
+    timer->pending = true;
+    wheel_link(wheel, timer);
+
+    // Still on this CPU with interrupts off, so the right one-shot
+    ktimer_kick_hw(timer->expires << KTIMER_TICK_SHIFT);
+
+    wheel_unlock(wheel, state);
+    return 0;
+}
+
+bool ktimer_cancel(struct ktimer* timer) {
+    if (!timer || !timer->pending || timer->cpu >= KTIMER_NR_WHEELS) {
+        return false;
+    }
+
+    struct ktimer_wheel* wheel = &wheels[timer->cpu];
+    uint32_t state = wheel_lock(wheel);
+
+    // Recheck under the lock: it may have fired or moved meanwhile
+    bool was_pending = timer->pending && &wheels[timer->cpu] == wheel;
+    if (was_pending) {
+        wheel_unlink(wheel, timer);
+        timer->pending = false;
+    }
+
+    wheel_unlock(wheel, state);
+    return was_pending;
+}
+
+bool ktimer_cancel_sync(struct ktimer* timer) {
+    if (ktimer_cancel(timer)) {
+        return true;
+    }
+    if (!timer || timer->cpu >= KTIMER_NR_WHEELS) {
+        return false;
+    }
+
+    // Fired already: its callback may still be running on the owning CPU
+    struct ktimer_wheel* wheel = &wheels[timer->cpu];
+    while (wheel->running == timer) {
+        barrier();
+    }
+    return false;
+}
+
+void ktimer_run(uint64_t now_us) {
+    struct ktimer_wheel* wheel = &wheels[ktimer_cpu()];
+    uint64_t target = now_us >> KTIMER_TICK_SHIFT;
+
+    uint32_t state = wheel_lock(wheel);
+
+    while (wheel->now <= target) {
+        if (wheel->pending == 0) {
+            wheel->now = target + 1;
+            break;
+        }
+
+        // Skip ticks with nothing to fire or cascade (long tickless sleeps)
+        uint64_t next = wheel_next_tick(wheel);
+        if (next > wheel->now) {
+            wheel->now = next < target + 1 ? next : target + 1;
+            continue;
+        }
+
+        // Level 0 wrapped: pull the next window down from above
+        uint32_t index = (uint32_t)wheel->now & KTIMER_SLOT_MASK;
+        if (index == 0) {
+            for (uint32_t level = 1; level < KTIMER_LEVELS; level++) {
+                uint32_t slot = (uint32_t)(wheel->now >> (KTIMER_SLOT_BITS * level)) &
+                                KTIMER_SLOT_MASK;
+                wheel_cascade(wheel, level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        // Detach this tick's slot, so callbacks that re-arm land in the
+        // wheel proper rather than in the list being fired
+        struct ktimer* due = wheel->slots[0][index];
+        wheel->slots[0][index] = NULL;
+        wheel->occupied[0][index / 32] &= ~(1u << (index % 32));
+        for (struct ktimer* t = due; t; t = t->next) {
+            t->level = KTIMER_LEVEL_EXPIRED;
+        }
+        wheel->expired = due;
+        wheel->now++;
+
+        struct ktimer* timer;
+        while ((timer = wheel->expired) != NULL) {
+            wheel_unlink(wheel, timer);
+            timer->pending = false;
+            wheel->running = timer;
+
+            wheel_unlock(wheel, state);
+            timer->fn(timer, timer->arg);
+            state = wheel_lock(wheel);
+            wheel->running = NULL;
+        }
+    }
+
+    wheel_unlock(wheel, state);
+}
+
+uint64_t ktimer_next_deadline_us(void) {
+    struct ktimer_wheel* wheel = &wheels[ktimer_cpu()];
+    uint64_t deadline = KTIMER_NO_DEADLINE;
+
+    uint32_t state = wheel_lock(wheel);
+    if (wheel->pending > 0) {
+        deadline = wheel_next_tick(wheel) << KTIMER_TICK_SHIFT;
+    }
+    wheel_unlock(wheel, state);
+
+    return deadline;
+}
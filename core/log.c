@@ -0,0 +1,74 @@
+/**
+ * Leveled logging
+ *
+ * Run-time subsystem mask and the rate limiter (see include/kernel/log.h).
+ */
+
+#include <kernel/log.h>
+#include <kernel/timer.h>
+
+volatile uint32_t log_enabled_mask = (uint32_t)((1ull << LOG_SUB_COUNT) - 1);
+
+static const char* const log_subsystem_names[LOG_SUB_COUNT] = {
+#define LOG_SUBSYSTEM_NAME(name) #name,
+    LOG_SUBSYSTEMS(LOG_SUBSYSTEM_NAME)
+#undef LOG_SUBSYSTEM_NAME
+};
+
+bool log_ratelimit_allow(struct log_ratelimit* rl, const char* tag) {
+    uint32_t flags = hal->irq_disable();
+    if (!spin_trylock(&rl->lock)) {
+        rl->suppressed++;  // Racy, but only a statistic
+        hal->irq_restore(flags);
+        return false;
+    }
+
+    uint64_t now = timer_read_us();
+    uint32_t suppressed = 0;
+    if (rl->printed == 0 || now - rl->window_start_us >= LOG_RATELIMIT_INTERVAL_US) {
+        suppressed = rl->suppressed;
+        rl->window_start_us = now;
+        rl->printed = 0;
+        rl->suppressed = 0;
+    }
+
+    bool allow = rl->printed < LOG_RATELIMIT_BURST;
+    if (allow) {
+        rl->printed++;
+    } else {
+        rl->suppressed++;
+    }
+    spin_unlock(&rl->lock);
+    hal->irq_restore(flags);
+
+    if (suppressed) {
+        kprintf("[%s] %u message(s) suppressed\n", tag, (unsigned int)suppressed);
+    }
+    return allow;
+}
+
+void log_set_enabled(enum log_subsystem sub, bool on) {
+    if ((uint32_t)sub >= LOG_SUB_COUNT) {
+        return;
+    }
+    if (on) {
+        __sync_fetch_and_or(&log_enabled_mask, 1u << sub);
+    } else {
+        __sync_fetch_and_and(&log_enabled_mask, ~(1u << sub));
+    }
+}
+
+int log_subsystem_lookup(const char* name) {
+    for (int i = 0; i < LOG_SUB_COUNT; i++) {
+        const char* a = log_subsystem_names[i];
+        const char* b = name;
+        while (*a && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return i;
+        }
+    }
+    return -EINVAL;
+}
@@ -0,0 +1,49 @@
+/**
+ * Unit tests for leveled logging
+ *
+ * Covers the run-time subsystem mask, compile-time level cut-off and the
+ * per-call-site rate limiter (one window, no ticks needed).
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/log.h>
+
+// Test: masks and levels decide what is printed
+static int test_log_filters(void) {
+    KTEST_ASSERT_EQ(log_subsystem_lookup("SCHED"), LOG_SUB_SCHED, "lookup by tag");
+    KTEST_ASSERT_EQ(log_subsystem_lookup("SCHEDX"), -EINVAL, "unknown tag");
+
+    KTEST_ASSERT(log_enabled(LOG_LEVEL_ERR, SCHED), "errors always built in");
+    KTEST_ASSERT(!log_compiled(CONFIG_LOG_LEVEL + 1), "levels above the config compiled out");
+
+    log_set_enabled(LOG_SUB_SCHED, false);
+    bool off = log_enabled(LOG_LEVEL_ERR, SCHED);
+    bool others = log_enabled(LOG_LEVEL_ERR, PMM);
+    log_set_enabled(LOG_SUB_SCHED, true);
+
+    KTEST_ASSERT(!off, "disabled subsystem silent");
+    KTEST_ASSERT(others, "other subsystems unaffected");
+    KTEST_ASSERT(log_enabled(LOG_LEVEL_ERR, SCHED), "re-enabled");
+
+    return KTEST_PASS;
+}
+
+// Test: a burst passes, the rest of the window is suppressed
+static int test_log_ratelimit(void) {
+    struct log_ratelimit rl = { 0 };
+    uint32_t allowed = 0;
+
+    for (int i = 0; i < LOG_RATELIMIT_BURST + 3; i++) {
+        if (log_ratelimit_allow(&rl, "TEST")) {
+            allowed++;
+        }
+    }
+
+    KTEST_ASSERT_EQ(allowed, LOG_RATELIMIT_BURST, "burst allowed");
+    KTEST_ASSERT_EQ(rl.suppressed, 3, "excess counted");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("log", log_filters, test_log_filters);
+KTEST_DEFINE("log", log_ratelimit, test_log_ratelimit);
@@ -0,0 +1,321 @@
+/**
+ * Priority-Inheritance Mutexes
+ *
+ * See include/kernel/mutex.h. The owner word only changes without the PI
+ * lock on the uncontended paths (0 <-> owner). Once MUTEX_HAS_WAITERS is
+ * set, the owner, the waiter list, every waiter's blocked_on and all
+ * inherited priorities change only under the PI lock, which makes the
+ * boost chain safe to walk.
+ *
+ * Each task's held_mutexes list is private to it: only the owner pushes
+ * (on acquire, including after a handoff) and pops (on release).
+ */
+
+#include <kernel/mutex.h>
+#include <kernel/scheduler.h>
+#include <kernel/percpu.h>
+#include <kernel/timer.h>
+#include <kernel/hal.h>
+#include <kernel/spinlock.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+// Serializes waiters, handoffs and inherited priorities
+static spinlock_t pi_lock;
+
+// Named mutexes, newest first (push-only, never unlinked)
+static mutex_t* mutex_list;
+static spinlock_t mutex_list_lock;
+
+static inline uint32_t pi_lock_irqsave(void) {
+    return spin_lock_irqsave(&pi_lock);
+}
+
+// Release the PI lock but leave interrupts as they are
+static inline void pi_unlock(void) {
+    spin_unlock(&pi_lock);
+}
+
+static inline void pi_unlock_irqrestore(uint32_t flags) {
+    pi_unlock();
+    hal->irq_restore(flags);
+}
+
+static inline uint64_t mutex_clock_us(void) {
+#if CONFIG_MUTEX_STATS
+    return timer_read_us();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Highest waiter priority of a mutex (0 if none)
+ *
+ * RT: O(waiters)
+ */
+static uint8_t top_waiter_priority(mutex_t* m) {
+    uint8_t top = 0;
+
+    uint32_t flags = wait_queue_lock(&m->waiters);
+    for (task_t* t = m->waiters.head; t; t = t->wait_next) {
+        if (t->priority > top) {
+            top = t->priority;
+        }
+    }
+    wait_queue_unlock(&m->waiters, flags);
+
+    return top;
+}
+
+/**
+ * Boost the owner chain starting at `owner` to at least `priority`
+ *
+ * Stops at an owner already running that high, at an owner that is not
+ * blocked on another mutex, or after MUTEX_PI_MAX_DEPTH links (which
+ * also bounds a deadlock cycle). PI lock held.
+ */
+static void pi_boost_chain(task_t* owner, uint8_t priority) {
+    for (int depth = 0; owner && depth < MUTEX_PI_MAX_DEPTH; depth++) {
+        if (owner->priority >= priority) {
+            return;
+        }
+        scheduler_set_priority(owner, priority);
+        if (!owner->blocked_on) {
+            return;
+        }
+        owner = mutex_owner(owner->blocked_on);
+    }
+}
+
+/**
+ * Drop `task` to the highest priority it still inherits (PI lock held)
+ *
+ * RT: O(waiters of the mutexes it holds)
+ */
+static void pi_restore(task_t* task) {
+    uint8_t priority = task->base_priority;
+
+    for (mutex_t* h = task->held_mutexes; h; h = h->held_next) {
+        if (atomic_read(&h->owner) & MUTEX_HAS_WAITERS) {
+            uint8_t top = top_waiter_priority(h);
+            if (top > priority) {
+                priority = top;
+            }
+        }
+    }
+
+    if (priority != task->priority) {
+        scheduler_set_priority(task, priority);
+    }
+}
+
+// Caller just became owner: bookkeeping (serialized by ownership)
+static void mutex_acquired(mutex_t* m, task_t* self, bool contended,
+                           uint64_t wait_start_us) {
+    m->held_next = self->held_mutexes;
+    self->held_mutexes = m;
+
+    m->stats.acquisitions++;
+    m->acquired_us = mutex_clock_us();
+    if (contended) {
+        uint64_t waited = m->acquired_us - wait_start_us;
+        m->stats.contentions++;
+        m->stats.wait_total_us += waited;
+        if (waited > m->stats.wait_max_us) {
+            m->stats.wait_max_us = waited;
+        }
+    }
+}
+
+// Caller is about to give up ownership: bookkeeping (still serialized)
+static void mutex_releasing(mutex_t* m, task_t* self) {
+    mutex_t** link = &self->held_mutexes;
+    while (*link && *link != m) {
+        link = &(*link)->held_next;
+    }
+    if (*link) {
+        *link = m->held_next;
+    }
+    m->held_next = NULL;
+
+    uint64_t held = mutex_clock_us() - m->acquired_us;
+    m->stats.hold_total_us += held;
+    if (held > m->stats.hold_max_us) {
+        m->stats.hold_max_us = held;
+    }
+}
+
+void mutex_init(mutex_t* m, const char* name) {
+    atomic_init(&m->owner, 0);
+    wait_queue_init(&m->waiters);
+    m->held_next = NULL;
+    m->name = name;
+    m->list_next = NULL;
+    m->acquired_us = 0;
+    memset(&m->stats, 0, sizeof(m->stats));
+
+    if (name) {
+        uint32_t flags = spin_lock_irqsave(&mutex_list_lock);
+        m->list_next = mutex_list;
+        mutex_list = m;
+        spin_unlock_irqrestore(&mutex_list_lock, flags);
+    }
+}
+
+bool mutex_trylock(mutex_t* m) {
+    task_t* self = task_current();
+    if (!atomic_cas(&m->owner, 0, (uint32_t)(uintptr_t)self)) {
+        return false;
+    }
+    mutex_acquired(m, self, false, 0);
+    return true;
+}
+
+/**
+ * Contended lock: queue behind the owner and lend it our priority
+ *
+ * The PI lock is held from setting MUTEX_HAS_WAITERS until we are on the
+ * wait queue, so the owner's slow unlock (which takes the PI lock first)
+ * always finds us there. Unlock hands ownership over before waking us.
+ */
+static int mutex_lock_slow(mutex_t* m, task_t* self) {
+    struct per_cpu_data* cpu = this_cpu();
+    if (self == cpu->idle_task || self->state != TASK_STATE_RUNNING) {
+        return -EPERM;
+    }
+
+    uint32_t me = (uint32_t)(uintptr_t)self;
+    uint64_t start = mutex_clock_us();
+
+    for (;;) {
+        uint32_t flags = pi_lock_irqsave();
+
+        uint32_t owner = atomic_read(&m->owner);
+        if (owner == 0) {
+            // Released meanwhile
+            bool got = atomic_cas(&m->owner, 0, me);
+            pi_unlock_irqrestore(flags);
+            if (got) {
+                break;
+            }
+            continue;
+        }
+        if (!(owner & MUTEX_HAS_WAITERS) &&
+            !atomic_cas(&m->owner, owner, owner | MUTEX_HAS_WAITERS)) {
+            pi_unlock_irqrestore(flags);
+            continue;
+        }
+
+        self->blocked_on = m;
+        pi_boost_chain(mutex_owner(m), self->priority);
+
+        wait_queue_lock(&m->waiters);
+        pi_unlock();
+        wait_queue_block_locked(&m->waiters, flags, 0, 0);
+
+        if (mutex_owner(m) == self) {
+            break;  // Handed over by mutex_unlock()
+        }
+    }
+
+    mutex_acquired(m, self, true, start);
+    return 0;
+}
+
+int mutex_lock(mutex_t* m) {
+    task_t* self = task_current();
+    if (atomic_cas(&m->owner, 0, (uint32_t)(uintptr_t)self)) {
+        mutex_acquired(m, self, false, 0);
+        return 0;
+    }
+    if (mutex_owner(m) == self) {
+        return -EDEADLK;
+    }
+    return mutex_lock_slow(m, self);
+}
+
+/**
+ * Contended unlock: hand over to the highest-priority waiter
+ *
+ * Ties go to the longest waiter. The new owner inherits from whoever is
+ * left waiting; the old owner drops to what its other mutexes lend it.
+ */
+static void mutex_unlock_slow(mutex_t* m, task_t* self) {
+    uint32_t flags = pi_lock_irqsave();
+    uint32_t wq_flags = wait_queue_lock(&m->waiters);
+
+    task_t* top = NULL;
+    uint8_t rest = 0;
+    for (task_t* t = m->waiters.head; t; t = t->wait_next) {
+        if (!top || t->priority > top->priority) {
+            if (top && top->priority > rest) {
+                rest = top->priority;
+            }
+            top = t;
+        } else if (t->priority > rest) {
+            rest = t->priority;
+        }
+    }
+
+    if (top) {
+        uint32_t next = (uint32_t)(uintptr_t)top;
+        if (m->waiters.count > 1) {
+            next |= MUTEX_HAS_WAITERS;
+        }
+        atomic_write(&m->owner, next);
+        top->blocked_on = NULL;
+        if (rest > top->priority) {
+            scheduler_set_priority(top, rest);
+        }
+        wait_queue_wake_task_locked(&m->waiters, top);
+    } else {
+        atomic_write(&m->owner, 0);
+    }
+    wait_queue_unlock(&m->waiters, wq_flags);
+
+    pi_restore(self);
+    pi_unlock_irqrestore(flags);
+
+    // Unboosted below a ready task or handed to a higher one: let it run
+    if (scheduler_need_resched()) {
+        schedule();
+    }
+}
+
+int mutex_unlock(mutex_t* m) {
+    task_t* self = task_current();
+    uint32_t me = (uint32_t)(uintptr_t)self;
+    if (mutex_owner(m) != self) {
+        return -EPERM;
+    }
+
+    mutex_releasing(m, self);
+    if (!atomic_cas(&m->owner, me, 0)) {
+        mutex_unlock_slow(m, self);
+    }
+    return 0;
+}
+
+void mutex_get_stats(const mutex_t* m, struct mutex_stats* out) {
+    *out = m->stats;
+}
+
+void mutex_dump_stats(void) {
+    kprintf("[MUTEX] Contended locks (times in us):\n");
+    for (mutex_t* m = mutex_list; m; m = m->list_next) {
+        struct mutex_stats s;
+        mutex_get_stats(m, &s);
+        if (s.contentions == 0) {
+            continue;
+        }
+        kprintf("  %s: %llu/%llu contended, wait avg %llu max %llu, hold avg %llu max %llu\n",
+                m->name,
+                (unsigned long long)s.contentions,
+                (unsigned long long)s.acquisitions,
+                (unsigned long long)(s.wait_total_us / s.contentions),
+                (unsigned long long)s.wait_max_us,
+                (unsigned long long)(s.hold_total_us / s.acquisitions),
+                (unsigned long long)s.hold_max_us);
+    }
+}
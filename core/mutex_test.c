@@ -0,0 +1,74 @@
+/**
+ * Unit tests for priority-inheritance mutexes
+ *
+ * Tests run from the bootstrap context, which cannot block: they cover
+ * the uncontended paths, error returns, statistics and the O(1)
+ * priority moves that boosting relies on.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/mutex.h>
+#include <kernel/scheduler.h>
+#include <kernel/hal.h>
+
+static void idle_entry(void* arg) {
+    (void)arg;
+}
+
+// Test: lock/trylock/unlock without contention, with error returns
+static int test_mutex_uncontended(void) {
+    mutex_t m;
+    mutex_init(&m, "ktest");
+
+    KTEST_ASSERT_EQ(mutex_lock(&m), 0, "free mutex locks");
+    KTEST_ASSERT(mutex_owner(&m) == task_current(), "caller owns it");
+    KTEST_ASSERT(!mutex_trylock(&m), "trylock of held mutex fails");
+    KTEST_ASSERT_EQ(mutex_lock(&m), -EDEADLK, "relock by owner refused");
+    KTEST_ASSERT_EQ(mutex_unlock(&m), 0, "owner unlocks");
+    KTEST_ASSERT_NULL(mutex_owner(&m), "mutex free again");
+    KTEST_ASSERT_EQ(mutex_unlock(&m), -EPERM, "unlock of free mutex refused");
+
+    KTEST_ASSERT(mutex_trylock(&m), "trylock of free mutex succeeds");
+    KTEST_ASSERT_EQ(mutex_unlock(&m), 0, "trylock owner unlocks");
+    KTEST_ASSERT_NULL(task_current()->held_mutexes, "held list empty");
+
+    struct mutex_stats s;
+    mutex_get_stats(&m, &s);
+    KTEST_ASSERT_EQ(s.acquisitions, 2, "both acquisitions counted");
+    KTEST_ASSERT_EQ(s.contentions, 0, "no contention");
+
+    // Held elsewhere: the bootstrap context cannot wait for it
+    task_t* other = this_cpu()->idle_task;
+    atomic_write(&m.owner, (uint32_t)(uintptr_t)other);
+    KTEST_ASSERT_EQ(mutex_lock(&m), -EPERM, "bootstrap cannot block");
+    KTEST_ASSERT_EQ(mutex_unlock(&m), -EPERM, "non-owner cannot unlock");
+    KTEST_ASSERT(mutex_owner(&m) == other, "owner untouched");
+    atomic_write(&m.owner, 0);
+
+    return KTEST_PASS;
+}
+
+static int probe_priority_move(task_t* t, void* arg) {
+    (void)arg;
+
+    scheduler_set_priority(t, 250);
+    bool picked = scheduler_pick_next() == t;
+    bool base_kept = t->base_priority == 10;
+    scheduler_set_priority(t, 10);
+
+    KTEST_ASSERT(picked, "boosted task is picked next");
+    KTEST_ASSERT(base_kept, "base priority unchanged by boost");
+    KTEST_ASSERT(t->priority == 10 && t->on_rq, "unboost requeues at base priority");
+
+    return KTEST_PASS;
+}
+
+// Test: a boost moves a queued task between ready queues and back
+static int test_mutex_priority_move(void) {
+    task_t* t = task_create_kernel_thread("pi_test", idle_entry, NULL, 10, 4096, 0);
+    return ktest_run_queued(t, probe_priority_move, NULL);
+}
+
+// Register all tests
+KTEST_DEFINE("mutex", mutex_uncontended, test_mutex_uncontended);
+KTEST_DEFINE("mutex", mutex_priority_move, test_mutex_priority_move);
@@ -3,9 +3,23 @@
 #include <kernel/percpu.h>
 #include <kernel/hal.h>
 #include <kernel/types.h>
+#include <kernel/trace.h>
+#include <lib/string.h>
 
-// Global per-CPU data array
-struct per_cpu_data per_cpu[MAX_CPUS];
+// Boot CPU's area: in use from the first instruction, before any allocator
+static struct trace_event percpu_boot_events[TRACE_BUFFER_SIZE];
+static struct per_cpu_data percpu_boot = {
+    .trace = { .events = percpu_boot_events },
+};
+
+// Stand-in for CPUs without an area: offline, no trace storage
+static struct per_cpu_data percpu_offline;
+
+// Per-CPU areas (the boot CPU is logical CPU 0, kernel/smp.h)
+struct per_cpu_data* per_cpu[MAX_CPUS] = {
+    [0] = &percpu_boot,
+    [1 ... MAX_CPUS - 1] = &percpu_offline,
+};
 
 // Number of online CPUs
 uint32_t num_cpus_online = 0;
@@ -21,11 +35,11 @@ void percpu_init(void) {
 
 // Initialize a specific CPU's data
 void percpu_init_cpu(uint32_t cpu_id) {
-    if (cpu_id >= MAX_CPUS) {
+    if (cpu_id >= MAX_CPUS || per_cpu[cpu_id] == &percpu_offline) {
         return;
     }
 
-    struct per_cpu_data* cpu = &per_cpu[cpu_id];
+    struct per_cpu_data* cpu = per_cpu[cpu_id];
 
     // Initialize basic fields
     cpu->cpu_id = cpu_id;
@@ -34,36 +48,96 @@ void percpu_init_cpu(uint32_t cpu_id) {
     cpu->kernel_stack = NULL;  // TODO: Allocate stack
     cpu->idle_task = NULL;
     cpu->ticks = 0;
+    cpu->timer_deadline_us = 0;
     cpu->context_switches = 0;
+    cpu->fpu_owner = NULL;
+    cpu->zombies = NULL;
+    cpu->task_cache = NULL;
+    cpu->task_cache_count = 0;
+    cpu->idle_state = IDLE_RUNNING;
+    cpu->idle_wake_tsc = 0;
     cpu->interrupts_handled = 0;
     cpu->ipis_received = 0;
     cpu->tlb_flushes = 0;
 
-    // Initialize run queue
-    list_init(&cpu->run_queue);
+    // Run queues are attached by scheduler_init_cpu()
+    cpu->sched = NULL;
 
     // Initialize trace buffer
     cpu->trace.head = 0;
     cpu->trace.tail = 0;
     atomic_init(&cpu->trace.overflow, 0);
+    cpu->trace.busy = 0;
 
     // Slab cache will be initialized later when memory management is ready
     cpu->slab_cache = NULL;
+    cpu->active_address_space = NULL;
+
+    // Frame magazine is filled on first pmm_alloc_page() on this CPU
+    cpu->page_cache.count = 0;
+}
+
+// Allocate an AP's area with its trace events behind it
+int percpu_alloc_cpu(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS) {
+        return -EINVAL;
+    }
+    if (per_cpu[cpu_id] != &percpu_offline) {
+        return 0;
+    }
+
+    size_t size = sizeof(struct per_cpu_data) + TRACE_BUFFER_SIZE * sizeof(struct trace_event);
+    phys_addr_t block = pmm_alloc_pages(pmm_order_for_size(size));
+    if (!block) {
+        return -ENOMEM;
+    }
+
+    struct per_cpu_data* cpu = (struct per_cpu_data*)(uintptr_t)block;
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->cpu_id = cpu_id;
+    cpu->trace.events = (struct trace_event*)(cpu + 1);
+
+    wmb();  // Area complete before the slot points at it
+    per_cpu[cpu_id] = cpu;
+    return 0;
+}
+
+// Event types trace_point() records (kernel/trace.h)
+volatile uint32_t trace_enabled_mask = TRACE_DEFAULT_MASK;
+
+void trace_set_mask(uint32_t mask) {
+    trace_enabled_mask = mask & ((1u << TRACE_EVENT_COUNT) - 1);
 }
 
 // Trace an event (lock-free, safe from interrupt context)
+//
+// Interrupts stay off from reading head to publishing it: an interrupt
+// that traced in between would otherwise claim the same slot. NMIs (the
+// profiler, kernel/pmu.h) are not held off; busy makes one that lands
+// mid-write drop its event instead.
 void trace_event(enum trace_event_type type, uint64_t d0, uint64_t d1,
                  uint64_t d2, uint64_t d3) {
+    uint32_t flags = hal->irq_disable();
     struct per_cpu_data* cpu = this_cpu();
     struct trace_buffer* trace = &cpu->trace;
 
+    if (trace->busy) {
+        atomic_inc(&trace->overflow);
+        hal->irq_restore(flags);
+        return;
+    }
+    trace->busy = 1;
+    barrier();  // Claimed before head is read
+
     // Get next write position
     uint32_t head = trace->head;
-    uint32_t next = (head + 1) % TRACE_BUFFER_SIZE;
+    uint32_t next = (head + 1) & (TRACE_BUFFER_SIZE - 1);
 
     // Check for overflow
     if (next == trace->tail) {
         atomic_inc(&trace->overflow);
+        trace->busy = 0;
+        hal->irq_restore(flags);
         return;  // Buffer full, drop event
     }
 
@@ -80,35 +154,30 @@ void trace_event(enum trace_event_type type, uint64_t d0, uint64_t d1,
     // Commit write
     mb();  // Memory barrier
     trace->head = next;
+    barrier();
+    trace->busy = 0;
+    hal->irq_restore(flags);
 }
 
 // Read trace events (for debugging tools)
 int trace_read(uint32_t cpu_id, struct trace_event* events, size_t count) {
-    if (cpu_id >= MAX_CPUS || !per_cpu[cpu_id].online) {
+    if (cpu_id >= MAX_CPUS || !per_cpu[cpu_id]->online) {
         return -EINVAL;
     }
 
-    struct trace_buffer* trace = &per_cpu[cpu_id].trace;
+    struct trace_buffer* trace = &per_cpu[cpu_id]->trace;
+    uint32_t head = trace->head;
+    uint32_t tail = trace->tail;
     size_t read = 0;
 
-    while (read < count && trace->tail != trace->head) {
-        events[read] = trace->events[trace->tail];
-        trace->tail = (trace->tail + 1) % TRACE_BUFFER_SIZE;
+    rmb();  // Head before the events it published
+    while (read < count && tail != head) {
+        events[read] = trace->events[tail];
+        tail = (tail + 1) & (TRACE_BUFFER_SIZE - 1);
         read++;
     }
+    mb();   // Events copied out before the slots are handed back
+    trace->tail = tail;
 
     return read;
 }
-
-// Schedule work on a specific CPU (will be used for IPI-based work)
-void schedule_work_on_cpu(uint32_t cpu_id, struct work_item* work) {
-    // TODO: Implement work queue
-    // For now, this is a stub
-    (void)cpu_id;
-    (void)work;
-}
-
-// Process pending work on this CPU
-void process_pending_work(void) {
-    // TODO: Implement work queue processing
-}
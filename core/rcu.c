@@ -0,0 +1,153 @@
+/**
+ * RCU-style deferred reclamation
+ *
+ * Grace periods and callback batches (see include/kernel/rcu.h).
+ *
+ * One grace period runs at a time. Starting one snapshots every online
+ * CPU's quiescent-state count; it completes once each count has moved.
+ * Each CPU keeps two callback batches: `next` collects new callbacks,
+ * `wait` waits for the grace period number recorded in wait_gp. A batch
+ * always waits for a grace period that starts after its last callback
+ * was queued, so its readers are done by the time it completes.
+ */
+
+#include <kernel/rcu.h>
+#include <kernel/spinlock.h>
+#include <kernel/smp.h>
+
+struct rcu_cpu {
+    struct rcu_head*  next;         // Queued, no grace period assigned yet
+    struct rcu_head** next_tail;
+    struct rcu_head*  wait;         // Waiting for grace period wait_gp
+    uint32_t          wait_gp;
+    uint32_t          pending;      // Callbacks in both batches
+} __attribute__((aligned(64)));
+
+static struct rcu_cpu rcu_cpus[MAX_CPUS];
+
+// Grace period state, under rcu_lock
+static spinlock_t rcu_lock;
+static volatile uint32_t gp_started;    // Last grace period started
+static volatile uint32_t gp_completed;  // Last grace period completed
+static uint32_t gp_wanted;              // Last grace period some batch waits for
+static uint32_t gp_snap[MAX_CPUS];      // rcu_qs at the start of gp_started
+static uint32_t gp_ipi[MAX_CPUS];       // Grace period the CPU was last kicked for
+
+// Wrap-safe "a is at or after b"
+static inline bool gp_reached(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+// Start grace period gp_started + 1 (rcu_lock held)
+static void gp_start(void) {
+    uint32_t count = hal->smp_num_cpus();
+    gp_started++;
+    for (uint32_t i = 0; i < count && i < MAX_CPUS; i++) {
+        gp_snap[i] = cpu_data(i)->rcu_qs;
+    }
+    mb();  // Snapshot before anything freed at its end
+}
+
+/**
+ * Complete the grace period in progress if every CPU passed a quiescent
+ * state, then start the next one somebody waits for
+ *
+ * Skips the check if another CPU is already making it.
+ */
+static void gp_advance(uint32_t self) {
+    if (!spin_trylock(&rcu_lock)) {
+        return;
+    }
+
+    if (gp_started != gp_completed) {
+        uint32_t count = hal->smp_num_cpus();
+        bool done = true;
+        for (uint32_t i = 0; i < count && i < MAX_CPUS; i++) {
+            struct per_cpu_data* cpu = cpu_data(i);
+            if (!cpu->online || cpu->rcu_qs != gp_snap[i]) {
+                continue;
+            }
+            done = false;
+            // Tickless idle may not count one for a long time
+            if (i != self && cpu->current_task == cpu->idle_task && gp_ipi[i] != gp_started) {
+                gp_ipi[i] = gp_started;
+                smp_send_reschedule(i);
+            }
+            break;
+        }
+        if (done) {
+            mb();  // Every count read before callbacks may free
+            gp_completed = gp_started;
+        }
+    }
+
+    if (gp_started == gp_completed && gp_wanted != gp_completed) {
+        gp_start();
+    }
+    spin_unlock(&rcu_lock);
+}
+
+// Grace period a batch closing now must wait for
+static uint32_t gp_request(void) {
+    spin_lock(&rcu_lock);
+    uint32_t gp = gp_started + 1;
+    gp_wanted = gp;
+    if (gp_started == gp_completed) {
+        gp_start();
+    }
+    spin_unlock(&rcu_lock);
+    return gp;
+}
+
+void call_rcu(struct rcu_head* head, void (*func)(struct rcu_head* head)) {
+    head->func = func;
+    head->next = NULL;
+
+    uint32_t flags = hal->irq_disable();
+    struct rcu_cpu* rc = &rcu_cpus[this_cpu()->cpu_id];
+    if (!rc->next) {
+        rc->next_tail = &rc->next;
+    }
+    *rc->next_tail = head;
+    rc->next_tail = &head->next;
+    rc->pending++;
+    hal->irq_restore(flags);
+}
+
+void rcu_tick(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    struct rcu_cpu* rc = &rcu_cpus[cpu->cpu_id];
+
+    rcu_quiescent(cpu);
+    if (gp_started != gp_completed) {
+        gp_advance(cpu->cpu_id);
+    }
+
+    if (rc->wait && gp_reached(gp_completed, rc->wait_gp)) {
+        struct rcu_head* head = rc->wait;
+        rc->wait = NULL;
+        while (head) {
+            struct rcu_head* next = head->next;
+            head->func(head);
+            rc->pending--;
+            head = next;
+        }
+    }
+
+    if (!rc->wait && rc->next) {
+        rc->wait = rc->next;
+        rc->next = NULL;
+        rc->wait_gp = gp_request();
+    }
+}
+
+uint32_t rcu_gp_completed(void) {
+    return gp_completed;
+}
+
+uint32_t rcu_callbacks_pending(void) {
+    uint32_t flags = hal->irq_disable();
+    uint32_t pending = rcu_cpus[this_cpu()->cpu_id].pending;
+    hal->irq_restore(flags);
+    return pending;
+}
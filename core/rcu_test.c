@@ -0,0 +1,90 @@
+/**
+ * Unit tests for RCU-style deferred reclamation
+ *
+ * Tests run before interrupts are enabled and before the APs start, so
+ * no tick fires on its own: the test calls rcu_tick() itself and only
+ * the boot CPU takes part in grace periods.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/rcu.h>
+#include <kernel/hal.h>
+
+struct rcu_test_obj {
+    int value;
+    int freed_order;
+    struct rcu_head rcu;
+};
+
+static int rcu_test_frees;
+
+static void rcu_test_free(struct rcu_head* head) {
+    struct rcu_test_obj* obj = container_of(head, struct rcu_test_obj, rcu);
+    obj->freed_order = ++rcu_test_frees;
+}
+
+// Test: a replaced object is reclaimed after a grace period, not before
+static int test_rcu_deferred_free(void) {
+    struct rcu_test_obj first = { .value = 1 };
+    struct rcu_test_obj second = { .value = 2 };
+    struct rcu_test_obj* table = &first;
+    rcu_test_frees = 0;
+
+    uint32_t flags = rcu_read_lock();
+    int seen = rcu_dereference(table)->value;
+    rcu_read_unlock(flags);
+    KTEST_ASSERT_EQ(seen, 1, "reader sees the published object");
+
+    // Writer: publish the replacement, retire the old one
+    rcu_assign_pointer(table, &second);
+    call_rcu(&first.rcu, rcu_test_free);
+    KTEST_ASSERT_EQ(rcu_callbacks_pending(), 1, "callback queued");
+    KTEST_ASSERT_EQ(first.freed_order, 0, "not freed at call_rcu()");
+    KTEST_ASSERT(rcu_dereference(table) == &second, "replacement published");
+
+    uint32_t gp = rcu_gp_completed();
+    flags = hal->irq_disable();
+    rcu_tick();  // Batch closed, grace period starts
+    bool early = first.freed_order != 0;
+    int ticks = 1;
+    while (first.freed_order == 0 && ticks < 4) {
+        rcu_tick();
+        ticks++;
+    }
+    hal->irq_restore(flags);
+
+    KTEST_ASSERT(!early, "not freed before the grace period ends");
+    KTEST_ASSERT_EQ(first.freed_order, 1, "freed after the grace period");
+    KTEST_ASSERT(rcu_gp_completed() != gp, "grace period completed");
+    KTEST_ASSERT_EQ(rcu_callbacks_pending(), 0, "nothing left queued");
+    KTEST_ASSERT_EQ(second.freed_order, 0, "live object untouched");
+
+    return KTEST_PASS;
+}
+
+// Test: callbacks in one batch run in queue order
+static int test_rcu_batch_order(void) {
+    struct rcu_test_obj objs[3];
+    rcu_test_frees = 0;
+
+    for (int i = 0; i < 3; i++) {
+        objs[i].freed_order = 0;
+        call_rcu(&objs[i].rcu, rcu_test_free);
+    }
+
+    uint32_t flags = hal->irq_disable();
+    for (int i = 0; i < 4 && rcu_callbacks_pending() > 0; i++) {
+        rcu_tick();
+    }
+    hal->irq_restore(flags);
+
+    KTEST_ASSERT_EQ(rcu_callbacks_pending(), 0, "batch ran");
+    for (int i = 0; i < 3; i++) {
+        KTEST_ASSERT_EQ(objs[i].freed_order, i + 1, "queue order kept");
+    }
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("rcu", rcu_deferred_free, test_rcu_deferred_free);
+KTEST_DEFINE("rcu", rcu_batch_order, test_rcu_batch_order);
@@ -0,0 +1,133 @@
+/**
+ * Shared-memory SPSC rings
+ *
+ * Page allocation, mapping and the doorbell (see include/kernel/ring.h).
+ */
+
+#include <kernel/ring.h>
+#include <kernel/pmm.h>
+#include <kernel/slab.h>
+
+static ring_t* ring_table[RING_MAX_RINGS];
+static atomic_t ring_table_used;
+
+ring_t* ring_create(uint32_t record_size, uint32_t nr_records) {
+    if (!ring_geometry_ok(record_size, nr_records)) {
+        return NULL;
+    }
+    uint64_t bytes = sizeof(struct ring_header) + (uint64_t)record_size * nr_records;
+
+    ring_t* ring = kzalloc(sizeof(*ring));
+    if (!ring) {
+        return NULL;
+    }
+    ring->npages = (uint32_t)PAGE_ALIGN_UP(bytes) / PAGE_SIZE;
+    for (uint32_t i = 0; i < ring->npages; i++) {
+        ring->frames[i] = pmm_alloc_zeroed_page();
+        if (!ring->frames[i]) {
+            ring_destroy(ring);
+            return NULL;
+        }
+    }
+
+    ring->record_size = record_size;
+    ring->nr_records = nr_records;
+    ring->hdr = (struct ring_header*)(uintptr_t)ring->frames[0];
+    ring->hdr->record_size = record_size;
+    ring->hdr->nr_records = nr_records;
+    wait_queue_init(&ring->consumer_wq);
+    return ring;
+}
+
+int ring_map(ring_t* ring, page_table_t* as, virt_addr_t addr) {
+    int rc = mmu_reserve_region(as, addr, ring->npages * PAGE_SIZE,
+                                MMU_WRITABLE | MMU_USER);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Each mapping holds its own reference, dropped by mmu_release_region()
+    for (uint32_t i = 0; i < ring->npages; i++) {
+        pmm_page_get(ring->frames[i]);
+        rc = mmu_region_give_page(as, addr + i * PAGE_SIZE, ring->frames[i]);
+        if (rc < 0) {
+            pmm_page_put(ring->frames[i]);
+            mmu_release_region(as, addr);
+            return rc;
+        }
+    }
+    return 0;
+}
+
+void ring_destroy(ring_t* ring) {
+    for (uint32_t i = 0; i < ring->npages && ring->frames[i]; i++) {
+        pmm_page_put(ring->frames[i]);
+    }
+    kfree(ring);
+}
+
+int ring_wait(ring_t* ring, uint64_t timeout_us) {
+    struct ring_header* hdr = ring->hdr;
+
+    uint32_t flags = wait_queue_lock(&ring->consumer_wq);
+    hdr->consumer_waiting = 1;
+    mb();  // Flag store before the head load
+    if (hdr->head != hdr->tail) {
+        hdr->consumer_waiting = 0;
+        wait_queue_unlock(&ring->consumer_wq, flags);
+        return 0;
+    }
+    ring->waits++;
+    int rc = wait_queue_block_locked(&ring->consumer_wq, flags, 0, timeout_us);
+    if (rc < 0) {
+        hdr->consumer_waiting = 0;
+    }
+    return rc;
+}
+
+int ring_doorbell(ring_t* ring) {
+    struct ring_header* hdr = ring->hdr;
+    int woken = 0;
+
+    uint32_t flags = wait_queue_lock(&ring->consumer_wq);
+    if (hdr->consumer_waiting) {
+        hdr->consumer_waiting = 0;
+        if (ring->consumer_wq.head) {
+            wait_queue_wake_task_locked(&ring->consumer_wq, ring->consumer_wq.head);
+            ring->doorbells++;
+            woken = 1;
+        }
+    }
+    wait_queue_unlock(&ring->consumer_wq, flags);
+    return woken;
+}
+
+int ring_install(ring_t* ring, page_table_t* owner) {
+    uint32_t index = atomic_inc(&ring_table_used);
+    if (index >= RING_MAX_RINGS) {
+        atomic_dec(&ring_table_used);
+        return -ENOMEM;
+    }
+    ring->owner = owner;
+    ring_table[index] = ring;
+    return (int)index + 1;
+}
+
+ring_t* ring_lookup(int id, page_table_t* as) {
+    if (id <= 0 || id > RING_MAX_RINGS) {
+        return NULL;
+    }
+    ring_t* ring = ring_table[id - 1];
+    return ring && ring->owner == as ? ring : NULL;
+}
+
+void ring_release_owner(page_table_t* owner) {
+    uint32_t used = MIN(atomic_read(&ring_table_used), RING_MAX_RINGS);
+
+    for (uint32_t i = 0; i < used; i++) {
+        ring_t* ring = ring_table[i];
+        if (ring && ring->owner == owner) {
+            ring->owner = NULL;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * Unit tests for shared-memory rings
+ *
+ * Tests run from the bootstrap context, which cannot block. Both ends of
+ * the ring are mapped into the kernel address space at different
+ * addresses, so records pushed through one mapping must show up in the
+ * other.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/ring.h>
+
+// Clear of the identity map, the user layout and the other tests' regions
+#define TEST_RING_PROD 0x53000000u
+#define TEST_RING_CONS 0x53100000u
+
+// Test: records cross between the two mappings without the kernel
+static int test_ring_shared(void) {
+    KTEST_ASSERT_NULL(ring_create(6, 4), "unaligned record size refused");
+    KTEST_ASSERT_NULL(ring_create(16, 1), "single slot refused");
+    KTEST_ASSERT_NULL(ring_create(PAGE_SIZE, RING_MAX_PAGES), "oversized ring refused");
+    KTEST_ASSERT(!ring_geometry_ok(PAGE_SIZE, RING_MAX_PAGES), "syscall check agrees");
+    KTEST_ASSERT(ring_geometry_ok(16, 4), "valid geometry accepted");
+
+    ring_t* ring = ring_create(16, 4);
+    KTEST_ASSERT_NOT_NULL(ring, "ring created");
+
+    page_table_t* as = mmu_get_kernel_address_space();
+    KTEST_ASSERT_EQ(ring_map(ring, as, TEST_RING_PROD), 0, "producer end mapped");
+    KTEST_ASSERT_EQ(ring_map(ring, as, TEST_RING_CONS), 0, "consumer end mapped");
+
+    struct ring_view prod, cons;
+    ring_view_init(&prod, (void*)TEST_RING_PROD);
+    ring_view_init(&cons, (void*)TEST_RING_CONS);
+
+    uint32_t rec[4] = { 0 };
+    uint32_t out[4];
+    bool pushed = true;
+    for (uint32_t i = 0; i < 3; i++) {
+        rec[0] = i;
+        pushed = pushed && ring_push(&prod, rec);
+    }
+    bool full = !ring_push(&prod, rec);
+    bool quiet = !ring_doorbell_needed(&prod);
+    int ready = ring_wait(ring, 0);
+
+    bool ordered = true;
+    for (uint32_t i = 0; i < 3; i++) {
+        ordered = ordered && ring_pop(&cons, out) && out[0] == i;
+    }
+    bool empty = !ring_pop(&cons, out);
+
+    int no_sleeper = ring_doorbell(ring);
+    int refused = ring_wait(ring, 0);
+    bool lowered = ring->hdr->consumer_waiting == 0;
+
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_RING_CONS), 0, "consumer end released");
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_RING_PROD), 0, "producer end released");
+    ring_destroy(ring);
+
+    KTEST_ASSERT(pushed, "three records pushed");
+    KTEST_ASSERT(full, "one slot stays empty");
+    KTEST_ASSERT(quiet, "no doorbell while the consumer is awake");
+    KTEST_ASSERT_EQ(ready, 0, "wait on a non-empty ring returns at once");
+    KTEST_ASSERT(ordered, "records popped in order from the other mapping");
+    KTEST_ASSERT(empty, "ring drained");
+    KTEST_ASSERT_EQ(no_sleeper, 0, "doorbell without a sleeper wakes nobody");
+    KTEST_ASSERT_EQ(refused, -EPERM, "bootstrap cannot sleep on an empty ring");
+    KTEST_ASSERT(lowered, "failed wait lowers consumer_waiting");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("ring", ring_shared, test_ring_shared);
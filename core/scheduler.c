@@ -3,40 +3,68 @@
  *
  * Priority-based scheduler with 256 priority levels.
  * Uses bitmap for O(1) highest-priority task selection.
+ * One instance per CPU; idle CPUs steal work from the busiest peer.
  *
  * RT Constraints:
  * - Pick next task: O(1), < 100 cycles
  * - Enqueue/dequeue: O(1), < 50 cycles
  * - Context switch: < 200 cycles total
+ * - Work stealing: O(MAX_CPUS) scan, only when the local queues are empty
+ * - Deadline class: O(log n) heap insert/remove, O(1) pick of the earliest
+ *
+ * Also builds on the host with -DHOST_TEST: tests/sched_sim.c supplies
+ * the HAL, context_switch() and the rest, and drives it with simulated
+ * CPUs (make sim-sched).
  */
 
 #include <kernel/scheduler.h>
 #include <kernel/task.h>
 #include <kernel/hal.h>
 #include <kernel/gdt.h>
+#include <kernel/percpu.h>
+#include <kernel/slab.h>
+#include <kernel/smp.h>
+#include <kernel/idle.h>
+#include <kernel/timer.h>
+#include <kernel/fpu.h>
+#include <kernel/vdso.h>
+#include <kernel/rcu.h>
+#include <kernel/trace.h>
+#include <kernel/pmu.h>
+#include <kernel/log.h>
 #include <drivers/vga.h>
 #include <lib/string.h>
 
-// Global scheduler state
-// Future: one per CPU for SMP
-scheduler_t g_scheduler;
+// Per-CPU scheduler instances: one block per CPU that comes online
+#define SCHED_RQ_ORDER pmm_order_for_size(sizeof(scheduler_t))
 
-// Bootstrap task representing the code running before scheduler takes over.
-// It is never enqueued; we treat it as already "dead" so it won't be rescheduled.
-static task_t bootstrap_task;
+// Forward declaration for context switch (in arch/x86/context.s);
+// returns 1 in the resumed task if it took the fast (ring 0) path
+extern uint32_t context_switch(cpu_context_t* old_ctx, cpu_context_t* new_ctx);
 
-// Forward declaration for context switch (in arch/x86/context.s)
-extern void context_switch(cpu_context_t* old_ctx, cpu_context_t* new_ctx);
+/**
+ * Run queue lock
+ *
+ * Only contended by remote enqueue and work stealing. Callers disable
+ * interrupts first.
+ */
+static inline void rq_lock(scheduler_t* rq) {
+    spin_lock(&rq->lock);
+}
+
+static inline void rq_unlock(scheduler_t* rq) {
+    spin_unlock(&rq->lock);
+}
 
 /**
  * Set priority bit in bitmap
  *
  * RT: O(1), < 10 cycles
  */
-static inline void set_priority_bit(uint8_t priority) {
+static inline void set_priority_bit(scheduler_t* rq, uint8_t priority) {
     uint32_t word_idx = priority / 32;
     uint32_t bit_idx = priority % 32;
-    g_scheduler.priority_bitmap[word_idx] |= (1u << bit_idx);
+    rq->priority_bitmap[word_idx] |= (1u << bit_idx);
 }
 
 /**
@@ -44,10 +72,10 @@ static inline void set_priority_bit(uint8_t priority) {
  *
  * RT: O(1), < 10 cycles
  */
-static inline void clear_priority_bit(uint8_t priority) {
+static inline void clear_priority_bit(scheduler_t* rq, uint8_t priority) {
     uint32_t word_idx = priority / 32;
     uint32_t bit_idx = priority % 32;
-    g_scheduler.priority_bitmap[word_idx] &= ~(1u << bit_idx);
+    rq->priority_bitmap[word_idx] &= ~(1u << bit_idx);
 }
 
 /**
@@ -59,13 +87,13 @@ static inline void clear_priority_bit(uint8_t priority) {
  *
  * RT: O(1), < 50 cycles
  */
-static uint8_t find_highest_priority(void) {
+static uint8_t find_highest_priority(const scheduler_t* rq) {
     // Search from highest to lowest (index 7 down to 0)
     for (int i = 7; i >= 0; i--) {
-        if (g_scheduler.priority_bitmap[i]) {
+        if (rq->priority_bitmap[i]) {
             // Found a non-zero word, find highest bit
             // __builtin_clz counts leading zeros from MSB
-            int bit = 31 - __builtin_clz(g_scheduler.priority_bitmap[i]);
+            int bit = 31 - __builtin_clz(rq->priority_bitmap[i]);
             return (uint8_t)(i * 32 + bit);
         }
     }
@@ -73,50 +101,147 @@ static uint8_t find_highest_priority(void) {
 }
 
 /**
- * Initialize scheduler
+ * Whether `a` should run before `b`
+ *
+ * Deadline tasks outrank every fixed priority and order among themselves
+ * by absolute deadline.
  */
-void scheduler_init(void) {
-    kprintf("[SCHED] Initializing O(1) scheduler...\n");
-
-    // Zero out scheduler state
-    memset(&g_scheduler, 0, sizeof(g_scheduler));
-    memset(&bootstrap_task, 0, sizeof(bootstrap_task));
-
-    strlcpy(bootstrap_task.name, "bootstrap", sizeof(bootstrap_task.name));
-    bootstrap_task.task_id = 0xFFFFFFFF;  // Sentinel ID
-    bootstrap_task.state = TASK_STATE_ZOMBIE;  // Never reschedule this context
-    bootstrap_task.priority = SCHED_IDLE_PRIORITY;
-    bootstrap_task.address_space = mmu_get_kernel_address_space();
-    g_scheduler.current_task = &bootstrap_task;
-
-    // Get idle task from task subsystem
-    task_t* idle = task_get_idle();
-    if (!idle) {
-        kprintf("[SCHED] FATAL: No idle task\n");
-        return;
+static inline bool task_preempts(const task_t* a, const task_t* b) {
+    bool a_dl = task_is_deadline(a);
+    if (a_dl != task_is_deadline(b)) {
+        return a_dl;
+    }
+    if (a_dl) {
+        return a->dl_abs_deadline_us < b->dl_abs_deadline_us;
     }
+    return a->priority > b->priority;
+}
 
-    // Enqueue idle task as READY so it appears in the bitmap/queues
-    idle->state = TASK_STATE_READY;
-    scheduler_enqueue(idle);
+static inline void dl_heap_set(scheduler_t* rq, uint32_t i, task_t* task) {
+    rq->dl_heap[i] = task;
+    task->dl_heap_index = i;
+}
+
+// Move heap entry i towards the root while it is earlier than its parent
+static void dl_heap_up(scheduler_t* rq, uint32_t i) {
+    task_t* task = rq->dl_heap[i];
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (rq->dl_heap[parent]->dl_abs_deadline_us <= task->dl_abs_deadline_us) {
+            break;
+        }
+        dl_heap_set(rq, i, rq->dl_heap[parent]);
+        i = parent;
+    }
+    dl_heap_set(rq, i, task);
+}
 
-    kprintf("[SCHED] Scheduler initialized (idle task: %s)\n", idle->name);
+// Move heap entry i towards the leaves while a child is earlier
+static void dl_heap_down(scheduler_t* rq, uint32_t i) {
+    task_t* task = rq->dl_heap[i];
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= rq->dl_nr_ready) {
+            break;
+        }
+        if (child + 1 < rq->dl_nr_ready &&
+            rq->dl_heap[child + 1]->dl_abs_deadline_us <
+            rq->dl_heap[child]->dl_abs_deadline_us) {
+            child++;
+        }
+        if (task->dl_abs_deadline_us <= rq->dl_heap[child]->dl_abs_deadline_us) {
+            break;
+        }
+        dl_heap_set(rq, i, rq->dl_heap[child]);
+        i = child;
+    }
+    dl_heap_set(rq, i, task);
 }
 
 /**
- * Enqueue a task in the ready queue
+ * Start a deadline task's next period at `now_us`: full budget, new deadline
+ */
+static void dl_new_period(task_t* task, uint64_t now_us) {
+    task->dl_runtime_cycles =
+        (int64_t)((uint64_t)task->dl_budget_us * timer_get_tsc_freq() / 1000000);
+    task->dl_abs_deadline_us = now_us + task->dl_deadline_us;
+    task->dl_period_end_us = now_us + task->dl_period_us;
+}
+
+/**
+ * Queue a ready deadline task on the heap (rq locked)
  *
- * RT: O(1), < 50 cycles
+ * A throttled task waits for dl_replenish() instead. One activated after
+ * its period ended starts a new period; within the period it keeps what
+ * is left, so sleeping or yielding never earns extra budget.
+ * Admission bounds the heap at SCHED_DL_MAX_TASKS.
+ *
+ * RT: O(log n)
  */
-void scheduler_enqueue(task_t* task) {
-    if (!task || task->state != TASK_STATE_READY) {
+static void dl_enqueue(scheduler_t* rq, task_t* task) {
+    if (task->dl_throttled) {
         return;
     }
 
+    uint64_t now = timer_read_us();
+    if (now >= task->dl_period_end_us) {
+        dl_new_period(task, now);
+    }
+
+    task->on_rq = true;
+    dl_heap_set(rq, rq->dl_nr_ready++, task);
+    dl_heap_up(rq, task->dl_heap_index);
+    rq->nr_ready++;
+}
+
+/**
+ * Remove a queued deadline task from the heap (rq locked)
+ *
+ * RT: O(log n)
+ */
+static void dl_dequeue(scheduler_t* rq, task_t* task) {
+    task->on_rq = false;
+    rq->nr_ready--;
+
+    // Refill the hole with the last entry and sift it whichever way it needs
+    uint32_t i = task->dl_heap_index;
+    uint32_t last = --rq->dl_nr_ready;
+    task_t* moved = rq->dl_heap[last];
+    rq->dl_heap[last] = NULL;
+    if (i != last) {
+        dl_heap_set(rq, i, moved);
+        dl_heap_up(rq, i);
+        dl_heap_down(rq, moved->dl_heap_index);
+    }
+}
+
+/**
+ * Append a task to its priority queue (rq locked)
+ *
+ * RT: O(1), < 50 cycles
+ */
+static void rq_enqueue(scheduler_t* rq, task_t* task) {
     uint8_t priority = task->priority;
-    task_queue_t* queue = &g_scheduler.ready[priority];
+    task_queue_t* queue = &rq->ready[priority];
+
+    // A woken task may be queued early by its waker (see schedule())
+    if (task->on_rq) {
+        return;
+    }
+#if CONFIG_SCHED_STATS
+    // Requeues (priority changes) keep the original stamp
+    if (!task->ready_tsc) {
+        task->ready_tsc = timer_read_tsc();
+    }
+#endif
+    if (task_is_deadline(task)) {
+        dl_enqueue(rq, task);
+        return;
+    }
+    task->on_rq = true;
+    task->slice_left_us = task_quantum_us(task);
 
-    // Add to end of queue (circular doubly-linked list)
+    // Add to end of queue (doubly-linked list)
     if (!queue->head) {
         // Empty queue
         queue->head = task;
@@ -132,32 +257,29 @@ void scheduler_enqueue(task_t* task) {
     }
 
     queue->count++;
+    rq->nr_ready++;
 
     // Set priority bit in bitmap
-    set_priority_bit(priority);
+    set_priority_bit(rq, priority);
 }
 
 /**
- * Dequeue a task from the ready queue
+ * Unlink a task from its priority queue (rq locked)
  *
  * RT: O(1), < 50 cycles
  */
-void scheduler_dequeue(task_t* task) {
-    if (!task) {
-        return;
-    }
-
+static void rq_dequeue(scheduler_t* rq, task_t* task) {
     uint8_t priority = task->priority;
-    task_queue_t* queue = &g_scheduler.ready[priority];
+    task_queue_t* queue = &rq->ready[priority];
 
-    // Fast exit if queue empty or task clearly not linked here
-    if (queue->count == 0) {
+    if (!task->on_rq) {
         return;  // Not enqueued
     }
-    if (queue->head != task && queue->tail != task &&
-        task->prev == NULL && task->next == NULL) {
-        return;  // Task not in this queue
+    if (task_is_deadline(task)) {
+        dl_dequeue(rq, task);
+        return;
     }
+    task->on_rq = false;
 
     // Remove from queue
     if (task->prev) {
@@ -177,36 +299,729 @@ void scheduler_dequeue(task_t* task) {
     task->next = NULL;
     task->prev = NULL;
     queue->count--;
+    rq->nr_ready--;
 
     // Clear priority bit if queue is now empty
     if (queue->count == 0) {
-        clear_priority_bit(priority);
+        clear_priority_bit(rq, priority);
+    }
+}
+
+/**
+ * Highest-priority ready fixed-priority task of `rq`, or NULL (rq locked)
+ *
+ * RT: O(1), < 100 cycles
+ */
+static task_t* rq_peek_fixed(const scheduler_t* rq) {
+    if (rq->nr_ready == rq->dl_nr_ready) {
+        return NULL;
+    }
+    return rq->ready[find_highest_priority(rq)].head;
+}
+
+/**
+ * Task `rq` should run next: earliest deadline, else highest priority,
+ * or NULL (rq locked)
+ *
+ * RT: O(1), < 100 cycles
+ */
+static task_t* rq_peek(const scheduler_t* rq) {
+    if (rq->dl_nr_ready > 0) {
+        return rq->dl_heap[0];
+    }
+    return rq_peek_fixed(rq);
+}
+
+/**
+ * Take the highest-priority ready task from the busiest other CPU
+ *
+ * The queue lengths are read without locks; only the chosen victim is
+ * locked, so no two run queue locks are ever held together. A task whose
+ * context is still live on its old CPU (on_cpu), or whose FPU registers
+ * are (fpu_owner), is left alone, as are pinned tasks; deadline tasks
+ * stay on the CPU that admitted them.
+ *
+ * @return  Stolen task (already removed from the victim), or NULL
+ *
+ * RT: O(MAX_CPUS) scan + O(1) removal
+ */
+static task_t* steal_task(uint32_t self) {
+    scheduler_t* victim = NULL;
+    uint32_t busiest = 0;
+    uint32_t ncpus = hal->smp_num_cpus();
+
+    for (uint32_t cpu = 0; cpu < ncpus && cpu < MAX_CPUS; cpu++) {
+        scheduler_t* rq = per_cpu[cpu]->sched;
+        if (cpu == self || !rq || !per_cpu[cpu]->online) {
+            continue;
+        }
+        if (rq->nr_ready > busiest) {
+            busiest = rq->nr_ready;
+            victim = rq;
+        }
+    }
+    if (!victim) {
+        return NULL;
+    }
+
+    rq_lock(victim);
+    task_t* task = rq_peek_fixed(victim);
+    if (task && (task->on_cpu || task->pinned ||
+                 task == per_cpu[victim->cpu_id]->fpu_owner)) {
+        task = NULL;
+    }
+    if (task) {
+        rq_dequeue(victim, task);
+        task->cpu = self;
+    }
+    rq_unlock(victim);
+
+    return task;
+}
+
+/**
+ * Release the task this CPU last switched away from
+ *
+ * Its context is saved once context_switch() is past it, so from here on
+ * other CPUs may steal it, and an exited one may be torn down. Bootstrap
+ * contexts run on the boot stack (no kernel_stack) and are never reaped.
+ */
+static inline void finish_switch(scheduler_t* rq) {
+    task_t* prev = rq->switched_from;
+    if (prev) {
+        prev->on_cpu = false;
+        rq->switched_from = NULL;
+        if (prev->state == TASK_STATE_ZOMBIE && prev->kernel_stack) {
+            task_queue_zombie(prev);
+        }
+    }
+}
+
+/**
+ * Account the switch that just resumed us (rq = the CPU we resumed on)
+ *
+ * Cost runs from the outgoing task's TSS/CR3/FPU updates until the
+ * incoming task is back in schedule(). Logged as TRACE_TASK_SWITCH:
+ * cycles, previous task ID, next task ID, fast path (1/0). Fresh tasks
+ * start at their entry point instead and are not measured.
+ */
+static inline void switch_account(scheduler_t* rq, uint32_t fast) {
+    rq->fast_switches += fast;
+#if CONFIG_SCHED_SWITCH_TRACE
+    uint64_t cycles = timer_read_tsc() - rq->switch_start_tsc;
+    rq->switch_cycles_total += cycles;
+    if (cycles > rq->switch_cycles_max) {
+        rq->switch_cycles_max = cycles;
+    }
+    trace_point(TRACE_TASK_SWITCH, cycles, rq->switched_from->task_id,
+                this_cpu()->current_task->task_id, fast);
+#endif
+}
+
+static inline uint32_t hist_bucket(uint64_t cycles) {
+    uint32_t bucket = cycles ? 63 - (uint32_t)__builtin_clzll(cycles) : 0;
+    return bucket < SCHED_HIST_BUCKETS ? bucket : SCHED_HIST_BUCKETS - 1;
+}
+
+#if CONFIG_SCHED_STATS
+/**
+ * Account a switch from `prev` to `next` at `now` (TSC)
+ *
+ * Closes prev's run burst and next's wait. Idle bursts are idle time,
+ * not work, so they stay out of the burst histogram.
+ *
+ * RT: O(1)
+ */
+static inline void stats_switch(scheduler_t* rq, task_t* prev, task_t* next,
+                                const task_t* idle, uint64_t now) {
+    if (prev->dispatch_tsc) {
+        uint64_t burst = now - prev->dispatch_tsc;
+        prev->run_cycles += burst;
+        if (prev != idle) {
+            rq->burst_hist[hist_bucket(burst)]++;
+        }
+    }
+    if (next->ready_tsc) {
+        uint64_t wait = now - next->ready_tsc;
+        next->wait_cycles += wait;
+        rq->latency_hist[hist_bucket(wait)]++;
+        next->ready_tsc = 0;
+    }
+    next->dispatch_tsc = now;
+    next->dispatches++;
+}
+#endif
+
+/**
+ * Replenishment timer: a throttled deadline task's period is over
+ *
+ * Interrupt context, on the CPU that throttled the task (deadline tasks
+ * never migrate). A task that is still running picks the new budget up
+ * in place; a ready one goes back on the heap.
+ */
+static void dl_replenish(struct ktimer* timer, void* arg) {
+    (void)timer;
+    task_t* task = (task_t*)arg;
+    scheduler_t* rq = per_cpu[task->cpu]->sched;
+
+    rq_lock(rq);
+    task->dl_throttled = false;
+    dl_new_period(task, timer_read_us());
+    if (task->state == TASK_STATE_READY) {
+        rq_enqueue(rq, task);
+    }
+    rq_unlock(rq);
+
+    if (rq == this_cpu()->sched) {
+        rq->need_resched = true;
+    } else {
+        idle_wake_cpu(rq->cpu_id);
+    }
+}
+
+/**
+ * Charge the running deadline task for the CPU time since the last charge
+ *
+ * Once the budget is gone the task is throttled until its period ends
+ * (or, if that has already passed, continues in a new period), and the
+ * CPU reschedules. Interrupts disabled, owning CPU.
+ *
+ * RT: O(1)
+ */
+static void dl_charge(scheduler_t* rq, task_t* task) {
+    uint64_t now = timer_read_tsc();
+    task->dl_runtime_cycles -= (int64_t)(now - rq->dl_charge_tsc);
+    rq->dl_charge_tsc = now;
+    if (task->dl_runtime_cycles > 0 || task->dl_throttled) {
+        return;
+    }
+
+    rq->dl_throttles++;
+    rq->need_resched = true;
+
+    uint64_t now_us = timer_read_us();
+    if (now_us < task->dl_period_end_us) {
+        task->dl_throttled = true;
+        if (ktimer_add(&task->dl_timer, task->dl_period_end_us - now_us) == 0) {
+            return;
+        }
+        task->dl_throttled = false;
+    }
+    dl_new_period(task, now_us);
+}
+
+/**
+ * Slice to arm for `task`: its quantum, cut short where a deadline
+ * task's budget runs out (tickless mode)
+ */
+static uint32_t slice_us(const task_t* task) {
+    uint32_t us = task_quantum_us(task);
+    uint64_t tsc_freq = timer_get_tsc_freq();
+    if (task_is_deadline(task) && tsc_freq) {
+        uint64_t left = task->dl_runtime_cycles > 0 ?
+            (uint64_t)task->dl_runtime_cycles * 1000000 / tsc_freq : 0;
+        if (left < us) {
+            us = (uint32_t)left;
+        }
+    }
+    return us;
+}
+
+/**
+ * Wake one idle peer so it can steal freshly queued work
+ *
+ * RT: O(CPUs)
+ */
+static void wake_idle_cpu(uint32_t self) {
+    uint32_t ncpus = hal->smp_num_cpus();
+
+    for (uint32_t cpu = 0; cpu < ncpus && cpu < MAX_CPUS; cpu++) {
+        struct per_cpu_data* peer = per_cpu[cpu];
+        if (cpu != self && peer->sched && peer->current_task == peer->idle_task) {
+            idle_wake_cpu(cpu);
+            return;
+        }
+    }
+}
+
+/**
+ * Reschedule IPI (SMP_IPI_RESCHEDULE)
+ *
+ * Only sets need_resched (and picks up a new profiler setting);
+ * irq_handler() calls schedule() on the way out.
+ */
+static void resched_ipi_handler(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    cpu->ipis_received++;
+    rcu_quiescent(cpu);  // Interrupts were on: no read section here
+    pmu_sync();          // Profiler setting changed (pmu_profile_start())
+    if (cpu->sched) {
+        cpu->sched->need_resched = true;
+    }
+}
+
+/**
+ * Initialize a CPU's scheduler instance
+ */
+int scheduler_init_cpu(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS) {
+        return -EINVAL;
+    }
+
+    struct per_cpu_data* cpu = cpu_data(cpu_id);
+    scheduler_t* rq = cpu->sched;
+    bool fresh = !rq;
+    if (fresh) {
+        phys_addr_t block = pmm_alloc_pages(SCHED_RQ_ORDER);
+        if (!block) {
+            return -ENOMEM;
+        }
+        rq = (scheduler_t*)(uintptr_t)block;
+    }
+
+    memset(rq, 0, sizeof(*rq));
+    rq->cpu_id = cpu_id;
+    spin_lock_init(&rq->lock);
+
+    // Bootstrap task representing the code running before the scheduler
+    // takes over. It is never enqueued; we treat it as already "dead" so
+    // it won't be rescheduled.
+    task_t* bootstrap = NULL;
+    if (cpu->idle_task || task_create_idle(cpu_id)) {
+        bootstrap = kzalloc(sizeof(task_t));
+    }
+    if (!bootstrap) {
+        if (fresh) {
+            pmm_free_pages((phys_addr_t)(uintptr_t)rq, SCHED_RQ_ORDER);
+        }
+        return -ENOMEM;
+    }
+    strlcpy(bootstrap->name, "bootstrap", sizeof(bootstrap->name));
+    bootstrap->task_id = 0xFFFFFFFF;  // Sentinel ID
+    bootstrap->state = TASK_STATE_ZOMBIE;  // Never reschedule this context
+    bootstrap->priority = SCHED_IDLE_PRIORITY;
+    bootstrap->base_priority = SCHED_IDLE_PRIORITY;
+    bootstrap->cpu = cpu_id;
+    bootstrap->on_cpu = true;
+    bootstrap->address_space = mmu_get_kernel_address_space();
+
+    cpu->current_task = bootstrap;
+    cpu->sched = rq;
+    return 0;
+}
+
+/**
+ * Initialize scheduler
+ */
+void scheduler_init(void) {
+    log_debug(SCHED, "Initializing O(1) scheduler...\n");
+
+    uint32_t boot_cpu = hal->cpu_id();
+    hal->irq_register(SMP_IPI_RESCHEDULE, resched_ipi_handler);
+    if (scheduler_init_cpu(boot_cpu) < 0) {
+        kprintf("[SCHED] FATAL: Cannot set up scheduler for CPU %u\n",
+                (unsigned int)boot_cpu);
+        return;
+    }
+
+    log_info(SCHED, "Scheduler initialized (CPU %u, idle task: %s)\n",
+            (unsigned int)boot_cpu, cpu_data(boot_cpu)->idle_task->name);
+}
+
+/**
+ * Enqueue a task in the ready queue
+ *
+ * RT: O(1), < 50 cycles
+ */
+void scheduler_enqueue(task_t* task) {
+    if (!task || task->state != TASK_STATE_READY || task->cpu >= MAX_CPUS) {
+        return;
+    }
+
+    scheduler_t* rq = per_cpu[task->cpu]->sched;
+    if (!rq || task == per_cpu[task->cpu]->idle_task) {
+        return;  // CPU not scheduling yet; idle tasks are never queued
+    }
+
+    uint32_t flags = hal->irq_disable();
+    rq_lock(rq);
+    rq_enqueue(rq, task);
+    rq_unlock(rq);
+
+    // Get the task running: poke its CPU if that is idle or running
+    // something less important, otherwise let an idle peer steal it
+    uint32_t self = hal->cpu_id();
+    task_t* running = per_cpu[task->cpu]->current_task;
+    if (task->cpu != self) {
+        if (!running || running == per_cpu[task->cpu]->idle_task ||
+            task_preempts(task, running)) {
+            idle_wake_cpu(task->cpu);
+        }
+    } else if (running == per_cpu[self]->idle_task) {
+        // No tick will come along to notice it (tickless idle)
+        rq->need_resched = true;
+    } else if (running && task_is_deadline(task) && task_preempts(task, running)) {
+        // Deadline work must not wait for the end of a fixed-priority slice
+        rq->need_resched = true;
+    } else if (running) {
+        wake_idle_cpu(self);
+    }
+
+    hal->irq_restore(flags);
+}
+
+/**
+ * Dequeue a task from the ready queue
+ *
+ * RT: O(1), < 50 cycles
+ */
+void scheduler_dequeue(task_t* task) {
+    if (!task || task->cpu >= MAX_CPUS) {
+        return;
+    }
+
+    scheduler_t* rq = per_cpu[task->cpu]->sched;
+    if (!rq) {
+        return;
+    }
+
+    uint32_t flags = hal->irq_disable();
+    rq_lock(rq);
+    rq_dequeue(rq, task);
+    rq_unlock(rq);
+    hal->irq_restore(flags);
+}
+
+/**
+ * Change a task's effective priority
+ *
+ * task->cpu only changes under the owning run queue lock (stealing), so
+ * recheck it once locked.
+ *
+ * RT: O(1), < 50 cycles
+ */
+void scheduler_set_priority(task_t* task, uint8_t priority) {
+    if (!task || task->cpu >= MAX_CPUS) {
+        return;
+    }
+
+    uint32_t flags = hal->irq_disable();
+
+    scheduler_t* rq;
+    for (;;) {
+        uint32_t cpu = task->cpu;
+        rq = per_cpu[cpu]->sched;
+        if (!rq) {
+            task->priority = priority;  // CPU not scheduling yet
+            hal->irq_restore(flags);
+            return;
+        }
+        rq_lock(rq);
+        if (task->cpu == cpu) {
+            break;
+        }
+        rq_unlock(rq);
+    }
+
+    bool queued = task->on_rq;
+    if (queued) {
+        rq_dequeue(rq, task);
+    }
+    task->priority = priority;
+    if (queued) {
+        rq_enqueue(rq, task);
+    }
+
+    // Preempt whatever this leaves outranked
+    struct per_cpu_data* owner = per_cpu[rq->cpu_id];
+    task_t* running = owner->current_task;
+    bool preempt = false;
+    if (queued) {
+        preempt = running && task_preempts(task, running);
+    } else if (running == task && !task_is_deadline(task) &&
+               rq->nr_ready > rq->dl_nr_ready) {
+        preempt = find_highest_priority(rq) > priority;
+    }
+    rq_unlock(rq);
+
+    if (preempt) {
+        if (rq->cpu_id == hal->cpu_id()) {
+            rq->need_resched = true;
+        } else {
+            idle_wake_cpu(rq->cpu_id);
+        }
+    }
+
+    hal->irq_restore(flags);
+}
+
+/**
+ * Change a task's round-robin quantum
+ *
+ * Plain stores: the owning CPU reads them from its tick, and a stale
+ * value only affects the slice in progress.
+ */
+int scheduler_set_quantum(task_t* task, uint32_t quantum_us) {
+    if (!task || (quantum_us != 0 &&
+                  (quantum_us < SCHED_QUANTUM_MIN_US ||
+                   quantum_us > SCHED_QUANTUM_MAX_US))) {
+        return -EINVAL;
+    }
+
+    task->quantum_us = quantum_us;
+    uint32_t quantum = task_quantum_us(task);
+    if (task->slice_left_us > quantum) {
+        task->slice_left_us = quantum;
+    }
+    return 0;
+}
+
+static inline uint64_t cycles_to_us(uint64_t cycles, uint64_t tsc_freq) {
+    return tsc_freq ? cycles * 1000000 / tsc_freq : 0;
+}
+
+/**
+ * Snapshot a task's statistics
+ *
+ * The burst or wait in progress comes from the open stamp, so a running
+ * or queued task's totals are current.
+ */
+void scheduler_get_task_stats(const task_t* task, struct sched_task_stats* out) {
+    uint64_t tsc_freq = timer_get_tsc_freq();
+    uint64_t now = timer_read_tsc();
+    uint64_t run = task->run_cycles;
+    uint64_t wait = task->wait_cycles;
+
+    if (task->cpu < MAX_CPUS && per_cpu[task->cpu]->current_task == task &&
+        task->dispatch_tsc) {
+        run += now - task->dispatch_tsc;
+    }
+    uint64_t ready = task->ready_tsc;
+    if (ready && ready < now) {
+        wait += now - ready;
+    }
+
+    out->run_us = cycles_to_us(run, tsc_freq);
+    out->wait_us = cycles_to_us(wait, tsc_freq);
+    out->dispatches = task->dispatches;
+    out->cpu_ticks = task->cpu_time_ticks;
+}
+
+#if CONFIG_SCHED_STATS
+// One histogram, empty buckets skipped; bounds in nanoseconds
+static void dump_hist(const char* name, const uint64_t* hist, uint64_t tsc_freq) {
+    kprintf("    %s:\n", name);
+    for (uint32_t i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+        uint64_t low_ns = tsc_freq ? (1ull << i) * 1000000000ull / tsc_freq : 0;
+        kprintf("      >= %llu ns%s: %llu\n", (unsigned long long)low_ns,
+                i == SCHED_HIST_BUCKETS - 1 ? " (and longer)" : "",
+                (unsigned long long)hist[i]);
+    }
+}
+#endif
+
+void scheduler_dump_stats(void) {
+    uint32_t ncpus = hal->smp_num_cpus();
+
+    for (uint32_t id = 0; id < ncpus && id < MAX_CPUS; id++) {
+        const scheduler_t* rq = per_cpu[id]->sched;
+        if (!rq || !per_cpu[id]->online) {
+            continue;
+        }
+        kprintf("[SCHED] CPU %u: %llu switches (%llu fast, %llu direct), %llu steals, "
+                "%llu ticks, %llu throttles, %u lock waits\n",
+                (unsigned int)id,
+                (unsigned long long)rq->context_switches,
+                (unsigned long long)rq->fast_switches,
+                (unsigned long long)rq->direct_switches,
+                (unsigned long long)rq->steals,
+                (unsigned long long)rq->ticks,
+                (unsigned long long)rq->dl_throttles,
+                (unsigned int)rq->lock.contended);
+#if CONFIG_SCHED_SWITCH_TRACE
+        if (rq->context_switches) {
+            kprintf("    switch cost: avg %llu max %llu cycles\n",
+                    (unsigned long long)(rq->switch_cycles_total / rq->context_switches),
+                    (unsigned long long)rq->switch_cycles_max);
+        }
+#endif
+#if CONFIG_SCHED_STATS
+        uint64_t tsc_freq = timer_get_tsc_freq();
+        dump_hist("ready-to-run latency", rq->latency_hist, tsc_freq);
+        dump_hist("run bursts", rq->burst_hist, tsc_freq);
+#endif
+    }
+}
+
+/**
+ * Give a task a deadline reservation, or take it away
+ *
+ * Admission and the class switch happen under the run queue lock (with
+ * task->cpu rechecked, as in scheduler_set_priority()); a replenishment
+ * still pending for the old parameters is cancelled first.
+ */
+int scheduler_set_deadline(task_t* task, uint32_t budget_us,
+                           uint32_t deadline_us, uint32_t period_us) {
+    if (!task || task->cpu >= MAX_CPUS || task == per_cpu[task->cpu]->idle_task) {
+        return -EINVAL;
+    }
+    if (budget_us != 0 &&
+        (budget_us < SCHED_DL_MIN_BUDGET_US || deadline_us < budget_us ||
+         period_us < deadline_us || period_us > SCHED_DL_MAX_PERIOD_US)) {
+        return -EINVAL;
+    }
+    uint32_t util = budget_us ?
+        (uint32_t)((uint64_t)budget_us * 1000000 / period_us) : 0;
+
+    if (task_is_deadline(task)) {
+        ktimer_cancel_sync(&task->dl_timer);
+    }
+
+    uint32_t flags = hal->irq_disable();
+
+    scheduler_t* rq;
+    for (;;) {
+        uint32_t cpu = task->cpu;
+        rq = per_cpu[cpu]->sched;
+        if (!rq) {
+            hal->irq_restore(flags);
+            return -ENODEV;
+        }
+        rq_lock(rq);
+        if (task->cpu == cpu) {
+            break;
+        }
+        rq_unlock(rq);
+    }
+
+    bool was_deadline = task_is_deadline(task);
+    uint32_t old_util = was_deadline ?
+        (uint32_t)((uint64_t)task->dl_budget_us * 1000000 / task->dl_period_us) : 0;
+    if (budget_us &&
+        (rq->dl_util_ppm - old_util + util > SCHED_DL_MAX_UTIL_PPM ||
+         (!was_deadline && rq->dl_nr_tasks >= SCHED_DL_MAX_TASKS))) {
+        rq_unlock(rq);
+        hal->irq_restore(flags);
+        return -EBUSY;
+    }
+
+    // Leave the old queue before the class (and so the queue) changes
+    bool queued = task->on_rq;
+    if (queued) {
+        rq_dequeue(rq, task);
+    }
+
+    rq->dl_util_ppm = rq->dl_util_ppm - old_util + util;
+    rq->dl_nr_tasks += (budget_us != 0) - was_deadline;
+    task->dl_budget_us = budget_us;
+    task->dl_deadline_us = deadline_us;
+    task->dl_period_us = period_us;
+    task->dl_throttled = false;
+    if (budget_us) {
+        ktimer_init(&task->dl_timer, dl_replenish, task);
+        dl_new_period(task, timer_read_us());
+        if (task == per_cpu[rq->cpu_id]->current_task) {
+            rq->dl_charge_tsc = timer_read_tsc();
+        }
+    }
+
+    if (queued) {
+        rq_enqueue(rq, task);
+    }
+
+    task_t* running = per_cpu[rq->cpu_id]->current_task;
+    bool preempt = queued && running && task_preempts(task, running);
+    rq_unlock(rq);
+
+    if (preempt) {
+        if (rq->cpu_id == hal->cpu_id()) {
+            rq->need_resched = true;
+        } else {
+            idle_wake_cpu(rq->cpu_id);
+        }
     }
+
+    hal->irq_restore(flags);
+    return 0;
 }
 
 /**
  * Pick next task to run
  *
- * Selects highest-priority READY task.
+ * Selects this CPU's highest-priority READY task.
  * Never returns NULL (falls back to idle task).
  *
  * RT: O(1), < 100 cycles
  */
 task_t* scheduler_pick_next(void) {
-    // Find highest priority with ready tasks
-    uint8_t priority = find_highest_priority();
+    struct per_cpu_data* cpu = this_cpu();
 
-    // Get head of that priority's queue
-    task_queue_t* queue = &g_scheduler.ready[priority];
-    task_t* next = queue->head;
+    uint32_t flags = hal->irq_disable();
+    rq_lock(cpu->sched);
+    task_t* next = rq_peek(cpu->sched);
+    rq_unlock(cpu->sched);
+    hal->irq_restore(flags);
 
-    if (!next) {
-        // Should never happen (idle task should always be ready)
-        kprintf("[SCHED] WARNING: No tasks in priority %u queue!\n", priority);
-        return task_get_idle();
+    return next ? next : cpu->idle_task;
+}
+
+/**
+ * Switch this CPU from `current` to `next` (IRQs off)
+ *
+ * `next` is RUNNING and off every run queue; `current` has been requeued
+ * or parked by the caller. Returns once `current` is switched back in,
+ * possibly on another CPU.
+ */
+static void switch_tasks(struct per_cpu_data* cpu, scheduler_t* rq,
+                         task_t* current, task_t* next) {
+    next->on_cpu = true;
+    rq->switched_from = current;
+    cpu->current_task = next;
+    rq->context_switches++;
+    cpu->context_switches++;
+    vdso_switch(cpu->cpu_id, next->task_id);
+    rcu_quiescent(cpu);
+
+#if CONFIG_SCHED_SWITCH_TRACE || CONFIG_SCHED_STATS
+    uint64_t now_tsc = timer_read_tsc();
+#endif
+#if CONFIG_SCHED_SWITCH_TRACE
+    rq->switch_start_tsc = now_tsc;
+#endif
+#if CONFIG_SCHED_STATS
+    stats_switch(rq, current, next, cpu->idle_task, now_tsc);
+#endif
+
+    // Update TSS.esp0 to point to next task's kernel stack top
+    // CRITICAL: Must happen BEFORE context switch
+    // When next task is in ring 3 and makes a syscall (INT 0x80),
+    // CPU will load ESP from TSS.esp0 to switch to kernel stack
+    if (next->kernel_stack && next->kernel_stack_size > 0) {
+        uintptr_t kernel_stack_top = (uintptr_t)next->kernel_stack + next->kernel_stack_size;
+        gdt_set_kernel_stack(kernel_stack_top);
+    }
+
+    // Only reload CR3 when the address space actually changes; tasks
+    // sharing one (all kernel threads) keep their TLB entries
+    if (next->address_space && next->address_space != current->address_space) {
+        mmu_switch_address_space(next->address_space);
     }
 
-    return next;
+    // FPU state follows lazily: trap on first use unless still loaded
+    fpu_switch(next);
+
+    // Context switch
+    uint32_t fast = context_switch(&current->context, &next->context);
+
+    // When we return here, we've been scheduled back in, possibly on
+    // another CPU. Whichever task that CPU switched away from to get
+    // here has its context saved now, so other CPUs may steal it.
+    rq = this_cpu()->sched;
+    switch_account(rq, fast);
+    finish_switch(rq);
 }
 
 /**
@@ -220,61 +1035,136 @@ void schedule(void) {
     // Disable interrupts during scheduling
     uint32_t flags = hal->irq_disable();
 
-    task_t* current = g_scheduler.current_task;
-    task_t* next = scheduler_pick_next();
+    struct per_cpu_data* cpu = this_cpu();
+    scheduler_t* rq = cpu->sched;
+    task_t* current = cpu->current_task;
+    task_t* idle = cpu->idle_task;
 
-    // Debug (disabled - preemptive scheduling verified working)
-    // static int sched_count = 0;
-    // if (sched_count < 20) {
-    //     kprintf("[SCHED] schedule() #%d: %s -> %s\n",
-    //             sched_count, current->name, next->name);
-    //     sched_count++;
-    // }
+    // Leaving the idle loop (possibly from an interrupt that woke it):
+    // wakers must stop treating this CPU as polling
+    if (current == idle) {
+        idle_exit();
+    }
 
-    // If same task, nothing to do
-    if (current == next) {
-        g_scheduler.need_resched = false;
-        hal->irq_restore(flags);
-        return;
+    // A fresh task starts at its entry point rather than returning into
+    // schedule(), so its predecessor may still be marked as on_cpu
+    finish_switch(rq);
+
+    // Charge a deadline task up to here; this may throttle it
+    if (task_is_deadline(current)) {
+        dl_charge(rq, current);
     }
 
-    // Handle current task state
+    rq_lock(rq);
+
+    // Still runnable: back to the tail of its queue first, so equal
+    // priorities round-robin and a lone highest-priority task gets
+    // picked again. A task woken between blocking and getting here is
+    // already READY and may already be queued by its waker.
     if (current->state == TASK_STATE_RUNNING) {
-        // Task is still runnable, move to READY
         current->state = TASK_STATE_READY;
-    } else if (current->state == TASK_STATE_ZOMBIE) {
-        // Task exited, remove from run queue
-        scheduler_dequeue(current);
-        // TODO: Add to zombie list for cleanup
+    }
+    if (current->state == TASK_STATE_READY && current != idle && !current->on_rq) {
+        rq_enqueue(rq, current);
+    }
+    // A ZOMBIE is not re-enqueued; finish_switch() queues it for reaping
+
+    task_t* next = rq_peek(rq);
+    if (next) {
+        rq_dequeue(rq, next);
+    }
+    rq_unlock(rq);
+
+    // Nothing local: try to steal before going idle
+    if (!next) {
+        next = steal_task(cpu->cpu_id);
+        if (next) {
+            rq->steals++;
+        }
+    }
+    if (!next) {
+        next = idle;
     }
 
-    // Dequeue next task and mark as RUNNING
-    scheduler_dequeue(next);
     next->state = TASK_STATE_RUNNING;
+    rq->need_resched = false;
+    if (task_is_deadline(next)) {
+        rq->dl_charge_tsc = timer_read_tsc();
+    }
 
-    // Re-enqueue current task if still READY
-    if (current->state == TASK_STATE_READY) {
-        scheduler_enqueue(current);
+    // Fresh time slice; make sure an interrupt ends it (idle needs none)
+    if (timer_is_tickless()) {
+        rq->slice_end_us = timer_read_us() + slice_us(next);
+        if (next != idle) {
+            timer_event_update(rq->slice_end_us);
+        }
+    }
+
+    // If same task, nothing to do
+    if (current == next) {
+        current->ready_tsc = 0;  // Requeued and picked again: never waited
+        hal->irq_restore(flags);
+        return;
     }
 
-    // Update scheduler state
-    g_scheduler.current_task = next;
-    g_scheduler.context_switches++;
-    g_scheduler.need_resched = false;
+    trace_point(TRACE_SCHEDULE, current->task_id, next->task_id, 0, 0);
+    switch_tasks(cpu, rq, current, next);
+    hal->irq_restore(flags);
+}
 
-    // Update TSS.esp0 to point to next task's kernel stack top
-    // CRITICAL: Must happen BEFORE context switch
-    // When next task is in ring 3 and makes a syscall (INT 0x80),
-    // CPU will load ESP from TSS.esp0 to switch to kernel stack
-    if (next->kernel_stack && next->kernel_stack_size > 0) {
-        uintptr_t kernel_stack_top = (uintptr_t)next->kernel_stack + next->kernel_stack_size;
-        gdt_set_kernel_stack(kernel_stack_top);
+/**
+ * Direct switch to a blocked task
+ *
+ * Taken only where `next` would win the pick anyway, so skipping the run
+ * queue changes nothing but the cost. Deadline tasks need their budget
+ * charged and stay on their CPU, and a task still on (or last run on)
+ * another CPU cannot be resumed here: those go the long way.
+ *
+ * RT: O(1), one context switch
+ */
+void scheduler_switch_to(task_t* next) {
+    uint32_t flags = hal->irq_disable();
+
+    struct per_cpu_data* cpu = this_cpu();
+    scheduler_t* rq = cpu->sched;
+    task_t* current = cpu->current_task;
+
+    finish_switch(rq);
+
+    bool direct = current != next && next->cpu == cpu->cpu_id && !next->on_cpu &&
+                  !task_is_deadline(current) && !task_is_deadline(next);
+    if (direct) {
+        rq_lock(rq);
+        task_t* queued = rq_peek(rq);
+        direct = !queued || !task_preempts(queued, next);
+        if (direct) {
+            // As in schedule(): a runnable current goes back on its queue
+            if (current->state == TASK_STATE_RUNNING) {
+                current->state = TASK_STATE_READY;
+            }
+            if (current->state == TASK_STATE_READY && current != cpu->idle_task &&
+                !current->on_rq) {
+                rq_enqueue(rq, current);
+            }
+        }
+        rq_unlock(rq);
     }
 
-    // Context switch
-    context_switch(&current->context, &next->context);
+    if (!direct) {
+        next->state = TASK_STATE_READY;
+        scheduler_enqueue(next);
+        schedule();
+        hal->irq_restore(flags);
+        return;
+    }
+
+    // next runs out the rest of current's slice (tickless: slice_end_us)
+    next->state = TASK_STATE_RUNNING;
+    next->slice_left_us = current->slice_left_us;
+    rq->direct_switches++;
 
-    // When we return here, we've been scheduled back in
+    trace_point(TRACE_SCHEDULE, current->task_id, next->task_id, 1, 0);
+    switch_tasks(cpu, rq, current, next);
     hal->irq_restore(flags);
 }
 
@@ -284,38 +1174,120 @@ void schedule(void) {
  * Called from timer interrupt.
  * Updates accounting and sets need_resched for preemption.
  *
- * RT: < 100 cycles
+ * RT: < 100 cycles (plus an O(MAX_CPUS) scan when idle)
  */
 bool scheduler_tick(void) {
-    g_scheduler.ticks++;
+    struct per_cpu_data* cpu = this_cpu();
+    scheduler_t* rq = cpu->sched;
+    if (!rq) {
+        return false;
+    }
+
+    rq->ticks++;
+    rcu_tick();
 
-    task_t* current = g_scheduler.current_task;
+    task_t* current = cpu->current_task;
     if (current) {
         current->cpu_time_ticks++;
     }
 
     // Check if we should preempt current task:
-    // 1. Round-robin: other tasks at same priority
-    // 2. Priority preemption: higher-priority tasks ready
+    // 1. Budget: a deadline task that has used up its reservation
+    // 2. Deadline preemption: an earlier deadline is ready
+    // 3. Round-robin: other tasks at same priority
+    // 4. Priority preemption: higher-priority tasks ready
+    // 5. Idle balancing: an idle CPU looks for work on its peers
     uint8_t priority = current->priority;
+    bool deadline = task_is_deadline(current);
+
+    if (deadline) {
+        dl_charge(rq, current);
+        if (rq->need_resched) {
+            return true;
+        }
+    }
+    if (rq->dl_nr_ready > 0) {
+        // Remote wakeups may be sifting the heap
+        rq_lock(rq);
+        bool earlier = rq->dl_nr_ready > 0 && task_preempts(rq->dl_heap[0], current);
+        rq_unlock(rq);
+        if (earlier) {
+            rq->need_resched = true;
+            return true;
+        }
+    }
 
-    // Check for higher priority tasks
-    uint8_t highest_ready = find_highest_priority();
-    if (highest_ready > priority) {
+    // Check for higher priority tasks (deadline tasks outrank them all)
+    uint8_t highest_ready = find_highest_priority(rq);
+    if (!deadline && rq->nr_ready > rq->dl_nr_ready && highest_ready > priority) {
         // Higher priority task is ready, preempt immediately
-        g_scheduler.need_resched = true;
+        rq->need_resched = true;
         return true;
     }
 
+    // Only a quantum that has run out round-robins (an uncontested one
+    // renews). Tickless: the interrupt may be for some other event, so
+    // check the deadline; periodic: charge the task one tick.
+    if (timer_is_tickless()) {
+        uint64_t now = timer_read_us();
+        if (now < rq->slice_end_us) {
+            return false;
+        }
+        rq->slice_end_us = now + slice_us(current);
+    } else if (current != cpu->idle_task && !deadline) {
+        uint32_t tick_us = 1000000 / timer_get_frequency();
+        if (current->slice_left_us > tick_us) {
+            current->slice_left_us -= tick_us;
+            return false;
+        }
+        current->slice_left_us = task_quantum_us(current);
+    }
+
+    // Deadline tasks do not round-robin: EDF alone orders them
+    if (deadline) {
+        return false;
+    }
+
     // Check for other tasks at same priority (round-robin)
-    if (g_scheduler.ready[priority].count > 0) {
-        g_scheduler.need_resched = true;
+    if (rq->ready[priority].count > 0) {
+        rq->need_resched = true;
         return true;
     }
 
+    if (current == cpu->idle_task) {
+        uint32_t ncpus = hal->smp_num_cpus();
+        for (uint32_t id = 0; id < ncpus && id < MAX_CPUS; id++) {
+            if (id != cpu->cpu_id && per_cpu[id]->sched && per_cpu[id]->sched->nr_ready > 0) {
+                rq->need_resched = true;
+                return true;
+            }
+        }
+    }
+
     return false;
 }
 
+/**
+ * Next scheduler deadline on this CPU (tickless mode)
+ *
+ * The running task's quantum end; nothing while idle, since enqueues kick
+ * idle CPUs directly. Before the scheduler runs, plain slice-length ticks.
+ */
+uint64_t scheduler_next_event_us(void) {
+    struct per_cpu_data* cpu = this_cpu();
+    scheduler_t* rq = cpu->sched;
+    if (!rq) {
+        return timer_read_us() + SCHED_TIME_SLICE_US;
+    }
+
+    // schedule() is about to run and arms the new slice itself
+    if (rq->need_resched || cpu->current_task == cpu->idle_task) {
+        return TIMER_NO_EVENT;
+    }
+    return rq->slice_end_us;
+}
+
 bool scheduler_need_resched(void) {
-    return g_scheduler.need_resched;
+    scheduler_t* rq = this_cpu()->sched;
+    return rq && rq->need_resched;
 }
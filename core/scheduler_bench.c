@@ -0,0 +1,132 @@
+/**
+ * Benchmarks for the run queue and the context switch
+ *
+ * The run queue benchmarks use one task that is queued but never runs:
+ * IRQs stay off from setup to teardown, as in scheduler_test.c.
+ *
+ * The switch benchmark ping-pongs between the bootstrap context and a
+ * bare partner context on its own stack, through context_switch() only
+ * (no run queue, no per-CPU current task), so it measures exactly the
+ * register switch that schedule() pays on top of pick_next.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/scheduler.h>
+#include <kernel/task.h>
+#include <kernel/hal.h>
+#include <kernel/timer.h>
+
+extern uint32_t context_switch(cpu_context_t* old_ctx, cpu_context_t* new_ctx);
+
+static task_t* bench_task;
+static uint32_t bench_flags;
+
+static void noop_entry(void* arg) {
+    (void)arg;
+}
+
+static int rq_bench_setup(void) {
+    bench_task = task_create_kernel_thread("bench", noop_entry, NULL, 10, 4096, 0);
+    if (!bench_task) {
+        return -ENOMEM;
+    }
+    bench_flags = hal->irq_disable();
+    return 0;
+}
+
+static void rq_bench_teardown(void) {
+    hal->irq_restore(bench_flags);
+    task_destroy(bench_task);
+    bench_task = NULL;
+}
+
+static int rq_bench_queued_setup(void) {
+    int ret = rq_bench_setup();
+    if (ret == 0) {
+        scheduler_enqueue(bench_task);
+    }
+    return ret;
+}
+
+static void rq_bench_queued_teardown(void) {
+    scheduler_dequeue(bench_task);
+    rq_bench_teardown();
+}
+
+static uint64_t bench_enqueue(void) {
+    uint64_t start = timer_read_tsc();
+    scheduler_enqueue(bench_task);
+    uint64_t cycles = timer_read_tsc() - start;
+    scheduler_dequeue(bench_task);
+    return cycles;
+}
+
+static uint64_t bench_dequeue(void) {
+    scheduler_enqueue(bench_task);
+    uint64_t start = timer_read_tsc();
+    scheduler_dequeue(bench_task);
+    return timer_read_tsc() - start;
+}
+
+static uint64_t bench_pick_next(void) {
+    uint64_t start = timer_read_tsc();
+    task_t* next = scheduler_pick_next();
+    uint64_t cycles = timer_read_tsc() - start;
+    (void)next;
+    return cycles;
+}
+
+// ========== Context switch ==========
+
+static cpu_context_t boot_ctx;
+static cpu_context_t partner_ctx;
+static uint8_t partner_stack[4096] __attribute__((aligned(16)));
+static volatile uint64_t partner_resumed_tsc;
+
+// Stamps the moment it is running again, then hands the CPU straight back
+static void switch_partner(void) {
+    for (;;) {
+        partner_resumed_tsc = timer_read_tsc();
+        context_switch(&partner_ctx, &boot_ctx);
+    }
+}
+
+static int switch_bench_setup(void) {
+    uint32_t* sp = (uint32_t*)(partner_stack + sizeof(partner_stack));
+    *--sp = 0;      // switch_partner() never returns
+
+    partner_ctx = (cpu_context_t){ 0 };
+    partner_ctx.esp = (uint32_t)sp;
+    partner_ctx.eip = (uint32_t)switch_partner;
+    partner_ctx.cs = 0x08;  // Kernel code segment
+    partner_ctx.ss = 0x10;  // Kernel data segment
+    partner_ctx.ds = 0x10;
+    partner_ctx.es = 0x10;
+    partner_ctx.fs = 0x10;
+    partner_ctx.gs = 0x10;
+    partner_ctx.eflags = 0x002;     // IF clear, like the live flags below
+
+    bench_flags = hal->irq_disable();
+    return 0;
+}
+
+static void switch_bench_teardown(void) {
+    hal->irq_restore(bench_flags);
+}
+
+// One kernel-to-kernel switch: from the call until the partner runs
+static uint64_t bench_context_switch(void) {
+    uint64_t start = timer_read_tsc();
+    context_switch(&boot_ctx, &partner_ctx);
+    return partner_resumed_tsc - start;
+}
+
+// Budgets from docs/RT_CONSTRAINTS.md
+KBENCH_DEFINE_SETUP("sched", enqueue, rq_bench_setup, bench_enqueue,
+                    rq_bench_teardown, 50);
+KBENCH_DEFINE_SETUP("sched", dequeue, rq_bench_setup, bench_dequeue,
+                    rq_bench_teardown, 50);
+KBENCH_DEFINE_SETUP("sched", pick_next, rq_bench_queued_setup, bench_pick_next,
+                    rq_bench_queued_teardown, 100);
+KBENCH_DEFINE_SETUP("sched", context_switch, switch_bench_setup, bench_context_switch,
+                    switch_bench_teardown, 200);
@@ -0,0 +1,133 @@
+/**
+ * Unit tests for the deadline scheduling class and scheduler statistics
+ *
+ * Tests run from the bootstrap context, which cannot switch away: they
+ * check parameter validation, admission control, EDF ordering and wait
+ * accounting on tasks that are queued but never run.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/scheduler.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+#include <kernel/timer.h>
+
+static void noop_entry(void* arg) {
+    (void)arg;
+}
+
+// Test: bad reservations are refused and admission caps the CPU share
+static int test_dl_admission(void) {
+    task_t* a = task_create_kernel_thread("dl_a", noop_entry, NULL, 10, 4096, 0);
+    task_t* b = task_create_kernel_thread("dl_b", noop_entry, NULL, 10, 4096, 0);
+    KTEST_ASSERT_NOT_NULL(a, "task a created");
+    KTEST_ASSERT_NOT_NULL(b, "task b created");
+
+    scheduler_t* rq = this_cpu()->sched;
+    uint32_t util = rq->dl_util_ppm;
+
+    KTEST_ASSERT_EQ(scheduler_set_deadline(a, 2000, 1000, 4000), -EINVAL,
+                    "budget beyond deadline refused");
+    KTEST_ASSERT_EQ(scheduler_set_deadline(a, 1000, 5000, 4000), -EINVAL,
+                    "deadline beyond period refused");
+    KTEST_ASSERT_EQ(scheduler_set_deadline(a, SCHED_DL_MIN_BUDGET_US - 1, 1000, 1000),
+                    -EINVAL, "tiny budget refused");
+
+    KTEST_ASSERT_EQ(scheduler_set_deadline(a, 5000, 10000, 10000), 0, "50% admitted");
+    KTEST_ASSERT(task_is_deadline(a), "task a in deadline class");
+    int over = scheduler_set_deadline(b, 5000, 10000, 10000);
+    bool b_fixed = !task_is_deadline(b);
+    int fits = scheduler_set_deadline(b, 3000, 10000, 10000);
+    uint32_t reserved = rq->dl_util_ppm - util;
+
+    task_destroy(a);
+    bool released = rq->dl_util_ppm - util == 300000;
+    task_destroy(b);
+
+    KTEST_ASSERT_EQ(over, -EBUSY, "100% refused");
+    KTEST_ASSERT(b_fixed, "refused task stays fixed-priority");
+    KTEST_ASSERT_EQ(fits, 0, "80% admitted");
+    KTEST_ASSERT_EQ(reserved, 800000, "both reservations counted");
+    KTEST_ASSERT(released, "destroy releases the reservation");
+    KTEST_ASSERT_EQ(rq->dl_util_ppm, util, "all reservations released");
+
+    return KTEST_PASS;
+}
+
+// Test: earliest deadline first, ahead of any fixed priority
+static int test_dl_edf_order(void) {
+    task_t* late = task_create_kernel_thread("dl_late", noop_entry, NULL, 10, 4096, 0);
+    task_t* early = task_create_kernel_thread("dl_early", noop_entry, NULL, 10, 4096, 0);
+    task_t* high = task_create_kernel_thread("fixed_hi", noop_entry, NULL, 250, 4096, 0);
+    KTEST_ASSERT_NOT_NULL(late, "late task created");
+    KTEST_ASSERT_NOT_NULL(early, "early task created");
+    KTEST_ASSERT_NOT_NULL(high, "fixed task created");
+
+    KTEST_ASSERT_EQ(scheduler_set_deadline(late, 1000, 50000, 100000), 0, "late admitted");
+    KTEST_ASSERT_EQ(scheduler_set_deadline(early, 1000, 2000, 100000), 0, "early admitted");
+
+    // Nothing may run the tasks: they stay queued only within this window
+    uint32_t flags = hal->irq_disable();
+    scheduler_enqueue(high);
+    scheduler_enqueue(late);
+    scheduler_enqueue(early);
+
+    bool first = scheduler_pick_next() == early;
+    scheduler_dequeue(early);
+    bool second = scheduler_pick_next() == late;
+    scheduler_dequeue(late);
+    bool third = scheduler_pick_next() == high;
+    scheduler_dequeue(high);
+
+    this_cpu()->sched->need_resched = false;
+    hal->irq_restore(flags);
+
+    task_destroy(high);
+    task_destroy(early);
+    task_destroy(late);
+
+    KTEST_ASSERT(first, "earliest deadline picked first");
+    KTEST_ASSERT(second, "later deadline next");
+    KTEST_ASSERT(third, "fixed priority only after deadline tasks");
+
+    return KTEST_PASS;
+}
+
+static int probe_wait_stats(task_t* t, void* arg) {
+    (void)arg;
+
+    KTEST_ASSERT(t->ready_tsc != 0, "enqueue stamps the wait start");
+    uint64_t start = timer_read_us();
+    while (timer_read_us() - start < 200) {
+        barrier();
+    }
+
+    struct sched_task_stats during;
+    scheduler_get_task_stats(t, &during);
+    KTEST_ASSERT(during.wait_us >= 200, "wait in progress counted");
+    KTEST_ASSERT_EQ(during.run_us, 0, "queued task has not run");
+
+    return KTEST_PASS;
+}
+
+// Test: a queued task's wait accrues from its enqueue stamp
+static int test_sched_wait_stats(void) {
+    if (!CONFIG_SCHED_STATS) {
+        return KTEST_PASS;
+    }
+
+    task_t* t = task_create_kernel_thread("stats", noop_entry, NULL, 10, 4096, 0);
+    KTEST_ASSERT_NOT_NULL(t, "task created");
+
+    struct sched_task_stats before;
+    scheduler_get_task_stats(t, &before);
+    int rc = ktest_run_queued(t, probe_wait_stats, NULL);
+
+    KTEST_ASSERT_EQ(before.wait_us, 0, "fresh task has not waited");
+    KTEST_ASSERT_EQ(before.dispatches, 0, "fresh task never dispatched");
+    return rc;
+}
+
+KTEST_DEFINE("sched", dl_admission, test_dl_admission);
+KTEST_DEFINE("sched", dl_edf_order, test_dl_edf_order);
+KTEST_DEFINE("sched", wait_stats, test_sched_wait_stats);
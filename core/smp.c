@@ -0,0 +1,115 @@
+/**
+ * SMP Bring-up (architecture-independent part)
+ *
+ * Starts every CPU the HAL found and turns it into a scheduling CPU:
+ * per-CPU data, slab front cache, run queues and idle task, local tick.
+ * After that the AP only ever runs tasks, reached through schedule().
+ */
+
+#include <kernel/smp.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+#include <kernel/slab.h>
+#include <kernel/scheduler.h>
+#include <kernel/task.h>
+#include <kernel/timer.h>
+#include <drivers/vga.h>
+
+// How long to wait for an AP to finish its per-CPU setup
+#define AP_ONLINE_TIMEOUT_US 1000000
+
+// Logical ID of the last AP that finished ap_main() setup
+static volatile uint32_t ap_ready_cpu;
+
+/**
+ * Kernel entry for application processors
+ *
+ * Called by the HAL on the AP's boot stack with interrupts off. The boot
+ * stack becomes this CPU's bootstrap task, which is never resumed once
+ * schedule() switches away from it.
+ */
+static void ap_main(void) {
+    uint32_t cpu_id = hal->cpu_id();
+    struct per_cpu_data* cpu = cpu_data(cpu_id);
+
+    percpu_init_cpu(cpu_id);
+
+    if (slab_cpu_init(cpu_id) < 0) {
+        kprintf("[SMP] CPU %u: no slab front cache\n", (unsigned int)cpu_id);
+    }
+
+    if (scheduler_init_cpu(cpu_id) < 0) {
+        kprintf("[SMP] CPU %u: scheduler setup failed, parking\n", (unsigned int)cpu_id);
+        cpu->online = false;
+        mb();
+        ap_ready_cpu = cpu_id;
+        while (1) {
+            hal->cpu_halt();
+        }
+    }
+
+    hal->timer_init(timer_get_frequency());
+
+    mb();
+    ap_ready_cpu = cpu_id;
+
+    // Join scheduling; the idle task enables interrupts
+    schedule();
+
+    kprintf("[SMP] CPU %u: returned to bootstrap context!\n", (unsigned int)cpu_id);
+    while (1) {
+        hal->cpu_halt();
+    }
+}
+
+uint32_t smp_init(void) {
+    uint32_t count = hal->smp_num_cpus();
+    kprintf("[SMP] Starting %u application processor(s)...\n",
+            (unsigned int)(count > 0 ? count - 1 : 0));
+
+    for (uint32_t cpu_id = 1; cpu_id < count && cpu_id < MAX_CPUS; cpu_id++) {
+        int rc = percpu_alloc_cpu(cpu_id);
+        if (rc < 0) {
+            kprintf("[SMP] CPU %u: no per-CPU area (%d)\n", (unsigned int)cpu_id, rc);
+            continue;
+        }
+
+        ap_ready_cpu = 0;
+        mb();
+
+        rc = hal->smp_boot_cpu(cpu_id, ap_main);
+        if (rc < 0) {
+            kprintf("[SMP] CPU %u failed to start (%d)\n", (unsigned int)cpu_id, rc);
+            continue;
+        }
+
+        uint64_t deadline = hal->timer_read_us() + AP_ONLINE_TIMEOUT_US;
+        while (ap_ready_cpu != cpu_id && hal->timer_read_us() < deadline) {
+            barrier();
+        }
+
+        if (ap_ready_cpu == cpu_id && cpu_data(cpu_id)->online) {
+            num_cpus_online++;
+            kprintf("[SMP] CPU %u online\n", (unsigned int)cpu_id);
+        } else {
+            kprintf("[SMP] CPU %u did not come online\n", (unsigned int)cpu_id);
+        }
+    }
+
+    kprintf("[SMP] %u CPU(s) online\n", (unsigned int)num_cpus_online);
+    return num_cpus_online;
+}
+
+void smp_send_reschedule(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS || cpu_id == hal->cpu_id() || !per_cpu[cpu_id]->online) {
+        return;
+    }
+    hal->smp_send_ipi(cpu_id, SMP_IPI_RESCHEDULE);
+}
+
+void smp_send_work(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS || cpu_id == hal->cpu_id() || !per_cpu[cpu_id]->online) {
+        return;
+    }
+    hal->smp_send_ipi(cpu_id, SMP_IPI_WORK);
+}
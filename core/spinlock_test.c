@@ -0,0 +1,73 @@
+/**
+ * Unit tests for ticket and reader-writer spinlocks
+ *
+ * One CPU runs the tests, so nothing ever waits: they cover ticket
+ * bookkeeping, trylock, interrupt state and reader/writer exclusion.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/spinlock.h>
+#include <kernel/hal.h>
+
+// Test: tickets, trylock and the irqsave variants
+static int test_spinlock_ticket(void) {
+    spinlock_t lock = SPINLOCK_INIT;
+
+    KTEST_ASSERT(!spin_is_locked(&lock), "zeroed lock is free");
+    spin_lock(&lock);
+    KTEST_ASSERT(spin_is_locked(&lock), "locked");
+    KTEST_ASSERT(!spin_trylock(&lock), "trylock of held lock fails");
+    spin_unlock(&lock);
+    KTEST_ASSERT(!spin_is_locked(&lock), "unlocked");
+
+    KTEST_ASSERT(spin_trylock(&lock), "trylock of free lock succeeds");
+    spin_unlock(&lock);
+    KTEST_ASSERT_EQ(atomic_read(&lock.next), 2, "two tickets handed out");
+    KTEST_ASSERT_EQ(atomic_read(&lock.owner), 2, "both served");
+    KTEST_ASSERT_EQ(lock.contended, 0, "nobody waited");
+
+    // A ticket taken but not yet served blocks trylock too
+    atomic_inc(&lock.next);
+    KTEST_ASSERT(!spin_trylock(&lock), "queued waiter blocks trylock");
+    atomic_inc(&lock.owner);
+
+    uint32_t outer = hal->irq_disable();
+    hal->irq_restore(outer);
+    uint32_t flags = spin_lock_irqsave(&lock);
+    KTEST_ASSERT_EQ(flags, outer, "irqsave returns the previous state");
+    spin_unlock_irqrestore(&lock, flags);
+    KTEST_ASSERT(!spin_is_locked(&lock), "irqrestore unlocks");
+
+    return KTEST_PASS;
+}
+
+// Test: readers share, a writer excludes them
+static int test_rwlock(void) {
+    rwlock_t rw = RWLOCK_INIT;
+
+    read_lock(&rw);
+    read_lock(&rw);
+    KTEST_ASSERT_EQ(atomic_read(&rw.readers), 2, "readers share the lock");
+    read_unlock(&rw);
+    read_unlock(&rw);
+    KTEST_ASSERT_EQ(atomic_read(&rw.readers), 0, "readers gone");
+
+    write_lock(&rw);
+    KTEST_ASSERT(rw.writer, "writer holds off readers");
+    KTEST_ASSERT(spin_is_locked(&rw.wlock), "writer holds off writers");
+    write_unlock(&rw);
+    KTEST_ASSERT(!rw.writer && !spin_is_locked(&rw.wlock), "writer gone");
+
+    uint32_t flags = read_lock_irqsave(&rw);
+    read_unlock_irqrestore(&rw, flags);
+    flags = write_lock_irqsave(&rw);
+    write_unlock_irqrestore(&rw, flags);
+
+    KTEST_ASSERT_EQ(atomic_read(&rw.read_contended), 0, "no reader waited");
+    KTEST_ASSERT_EQ(rw.write_contended, 0, "no writer waited");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("spinlock", spinlock_ticket, test_spinlock_ticket);
+KTEST_DEFINE("spinlock", rwlock, test_rwlock);
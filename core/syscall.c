@@ -7,15 +7,26 @@
  * - sys_exit: O(1), < 500 cycles
  * - sys_yield: O(1), < 200 cycles (just calls schedule)
  * - sys_getpid: O(1), < 20 cycles (register read)
- * - sys_sleep_us: O(1) per call, but blocks task
+ * - sys_sleep_us: O(1) to block; the task waits on a kernel timer
+ * - sys_wait/sys_wake: O(1) to block, O(bucket sleepers) to wake (futex.c)
+ * - sys_set_quantum: O(1)
+ * - sys_task_stats: O(1) plus at most two page faults
  */
 
 #include <kernel/syscall.h>
 #include <kernel/task.h>
+#include <kernel/futex.h>
+#include <kernel/channel.h>
+#include <kernel/ipc.h>
+#include <kernel/ring.h>
+#include <kernel/uring.h>
 #include <kernel/scheduler.h>
 #include <kernel/percpu.h>
+#include <kernel/user.h>
+#include <kernel/mmu.h>
 #include <kernel/hal.h>
 #include <kernel/idt.h>
+#include <kernel/trace.h>
 #include <drivers/vga.h>
 
 // Forward declarations of syscall implementations
@@ -23,6 +34,22 @@ static long sys_exit(long arg0, long arg1, long arg2, long arg3, long arg4);
 static long sys_yield(long arg0, long arg1, long arg2, long arg3, long arg4);
 static long sys_getpid(long arg0, long arg1, long arg2, long arg3, long arg4);
 static long sys_sleep_us(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_wait(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_wake(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_set_quantum(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_task_stats(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_chan_create(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_chan_send(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_chan_recv(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_chan_close(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_ipc_create(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_call(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_reply_wait(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_ring_create(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_ring_wait(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_ring_doorbell(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_uring_setup(long arg0, long arg1, long arg2, long arg3, long arg4);
+static long sys_uring_enter(long arg0, long arg1, long arg2, long arg3, long arg4);
 
 /**
  * Syscall table
@@ -36,6 +63,22 @@ static const syscall_fn_t syscall_table[MAX_SYSCALLS] = {
     [SYS_YIELD] = sys_yield,     // Yield CPU
     [SYS_GETPID] = sys_getpid,   // Get task ID
     [SYS_SLEEP_US] = sys_sleep_us, // Sleep microseconds
+    [SYS_WAIT] = sys_wait,       // Futex wait
+    [SYS_WAKE] = sys_wake,       // Futex wake
+    [SYS_SET_QUANTUM] = sys_set_quantum, // Round-robin quantum
+    [SYS_TASK_STATS] = sys_task_stats, // Scheduling statistics
+    [SYS_CHAN_CREATE] = sys_chan_create, // Channel IPC
+    [SYS_CHAN_SEND] = sys_chan_send,
+    [SYS_CHAN_RECV] = sys_chan_recv,
+    [SYS_CHAN_CLOSE] = sys_chan_close,
+    [SYS_IPC_CREATE] = sys_ipc_create, // Synchronous IPC
+    [SYS_CALL] = sys_call,
+    [SYS_REPLY_WAIT] = sys_reply_wait,
+    [SYS_RING_CREATE] = sys_ring_create, // Shared-memory rings
+    [SYS_RING_WAIT] = sys_ring_wait,
+    [SYS_RING_DOORBELL] = sys_ring_doorbell,
+    [SYS_URING_SETUP] = sys_uring_setup, // Batched submission
+    [SYS_URING_ENTER] = sys_uring_enter,
     // Rest are NULL (not implemented)
 };
 
@@ -46,10 +89,11 @@ static const syscall_fn_t syscall_table[MAX_SYSCALLS] = {
  *
  * @param syscall_num  Syscall number (from EAX)
  * @param arg0-arg4    Arguments (from EBX, ECX, EDX, ESI, EDI)
+ * @param regs         Saved user registers, for syscalls returning more
  * @return             Return value (placed in EAX), or -ENOSYS if invalid
  */
 long syscall_handler(uint32_t syscall_num, long arg0, long arg1,
-                     long arg2, long arg3, long arg4) {
+                     long arg2, long arg3, long arg4, struct syscall_regs* regs) {
     // Validate syscall number
     if (syscall_num >= MAX_SYSCALLS) {
         // Note: kprintf removed from hot path (can reenter console from IRQ)
@@ -64,7 +108,19 @@ long syscall_handler(uint32_t syscall_num, long arg0, long arg1,
     }
 
     // Call syscall implementation
-    return syscall(arg0, arg1, arg2, arg3, arg4);
+    task_t* current = scheduler_current();
+    if (current) {
+        current->syscall_regs = regs;
+    }
+    if (!trace_enabled(TRACE_SYSCALL)) {
+        return syscall(arg0, arg1, arg2, arg3, arg4);
+    }
+
+    uint64_t start = hal->timer_read_tsc();
+    long ret = syscall(arg0, arg1, arg2, arg3, arg4);
+    trace_point(TRACE_SYSCALL, syscall_num, (uint64_t)ret,
+                hal->timer_read_tsc() - start, 0);
+    return ret;
 }
 
 /**
@@ -79,11 +135,15 @@ static long sys_exit(long arg0, long arg1, long arg2, long arg3, long arg4) {
     (void)arg1; (void)arg2; (void)arg3; (void)arg4;
     int status = (int)arg0;
 
-    // Use scheduler's current_task (not per-CPU, which may not be set yet)
-    extern scheduler_t g_scheduler;
-    task_t* current = g_scheduler.current_task;
+    task_t* current = scheduler_current();
     if (current) {
         kprintf("[SYSCALL] sys_exit(%d) from task '%s'\n", status, current->name);
+        // SQPOLL threads leave the address space before it is destroyed,
+        // its IDs stop working before another can reuse its pointer, and
+        // its channels are closed
+        uring_release_owner(current->address_space);
+        ring_release_owner(current->address_space);
+        chan_release_owner(current->address_space);
     } else {
         kprintf("[SYSCALL] sys_exit(%d) from unknown task\n", status);
     }
@@ -119,9 +179,7 @@ static long sys_yield(long arg0, long arg1, long arg2, long arg3, long arg4) {
 static long sys_getpid(long arg0, long arg1, long arg2, long arg3, long arg4) {
     (void)arg0; (void)arg1; (void)arg2; (void)arg3; (void)arg4;
 
-    // Use scheduler's current_task (not per-CPU, which may not be set yet)
-    extern scheduler_t g_scheduler;
-    task_t* current = g_scheduler.current_task;
+    task_t* current = scheduler_current();
     if (!current) {
         kprintf("[SYSCALL] sys_getpid: current_task is NULL!\n");
         return -1;  // No current task (shouldn't happen)
@@ -131,30 +189,535 @@ static long sys_getpid(long arg0, long arg1, long arg2, long arg3, long arg4) {
 }
 
 /**
- * sys_sleep_us - Sleep for microseconds (STUB)
+ * sys_sleep_us - Sleep for microseconds
  *
- * **IMPORTANT:** This is currently a STUB implementation that just yields once.
- * It does NOT actually sleep for the requested duration.
+ * Blocks the caller on a kernel timer (task_sleep_us()); other tasks run
+ * meanwhile. The sleep lasts at least arg0 microseconds, rounded up to
+ * the timer wheel's tick (KTIMER_TICK_US). 0 just yields.
  *
- * The full implementation will be added in Phase 4 with:
- * - Sleep queue for blocked tasks
- * - Timer-based wakeup mechanism
- * - Proper accounting of elapsed time
+ * @param arg0  Duration in microseconds (>= 0)
+ * @return      0 after the sleep, -EINVAL for a negative duration,
+ *              -EPERM from a context that cannot block
+ *
+ * RT: O(1) to block and to wake
+ */
+static long sys_sleep_us(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg1; (void)arg2; (void)arg3; (void)arg4;
+
+    if (arg0 < 0) {
+        return -EINVAL;
+    }
+    return task_sleep_us((uint64_t)arg0);
+}
+
+/**
+ * sys_wait - Sleep while a user word holds an expected value
  *
- * For now, this just proves the syscall mechanism works.
+ * Atomically checks *arg0 == arg1 and blocks until sys_wake() on the
+ * same address, or until the timeout. User-space locks call this only
+ * when contended.
  *
- * @param arg0  Duration in microseconds (currently IGNORED)
- * @return      0 on success
+ * @param arg0  User address of a 4-byte aligned 32-bit word
+ * @param arg1  Expected value
+ * @param arg2  Timeout in microseconds (0 = none)
+ * @return      0 when woken, -EAGAIN if the word changed, -ETIMEDOUT,
+ *              -EINVAL, -EFAULT or -EPERM (see futex_wait())
  *
- * RT: O(1) - single yield, does not wait for duration
+ * RT: O(1) to block
  */
-static long sys_sleep_us(long arg0, long arg1, long arg2, long arg3, long arg4) {
-    (void)arg0;  // Duration is ignored - not implemented
+static long sys_wait(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg3; (void)arg4;
+
+    if (arg2 < 0) {
+        return -EINVAL;
+    }
+    return futex_wait((uintptr_t)arg0, (uint32_t)arg1, (uint64_t)arg2);
+}
+
+/**
+ * sys_wake - Wake tasks sleeping on a user word
+ *
+ * @param arg0  User address passed to sys_wait()
+ * @param arg1  Maximum number of tasks to wake (> 0)
+ * @return      Number of tasks woken, -EINVAL, -EFAULT or -EPERM
+ *              (see futex_wake())
+ *
+ * RT: O(sleepers hashed to the same bucket)
+ */
+static long sys_wake(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg2; (void)arg3; (void)arg4;
+
+    if (arg1 <= 0) {
+        return -EINVAL;
+    }
+    return futex_wake((uintptr_t)arg0, (uint32_t)arg1);
+}
+
+/**
+ * sys_set_quantum - Set the caller's round-robin quantum
+ *
+ * Peers at the caller's priority only take over once it has run this
+ * long; applies from the caller's next slice.
+ *
+ * @param arg0  Quantum in microseconds (0 = default SCHED_TIME_SLICE_US,
+ *              otherwise SCHED_QUANTUM_MIN_US..SCHED_QUANTUM_MAX_US)
+ * @return      0 on success, -EINVAL for an out-of-range quantum
+ *
+ * RT: O(1)
+ */
+static long sys_set_quantum(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg1; (void)arg2; (void)arg3; (void)arg4;
+
+    if (arg0 < 0) {
+        return -EINVAL;
+    }
+    return scheduler_set_quantum(scheduler_current(), (uint32_t)arg0);
+}
+
+/**
+ * Check a user buffer and commit its pages
+ *
+ * Syscalls then touch it without faulting. Only used for small buffers:
+ * every page in the range is faulted in.
+ *
+ * @return 0, or -EFAULT if the range is not mapped user memory
+ */
+static int user_buffer(uintptr_t uaddr, size_t len, bool write) {
+    if (uaddr == 0 || len > USER_STACK_TOP || uaddr > USER_STACK_TOP - len) {
+        return -EFAULT;
+    }
+
+    page_table_t* as = scheduler_current()->address_space;
+    uintptr_t page = PAGE_ALIGN_DOWN(uaddr);
+    for (; page < uaddr + len; page += PAGE_SIZE) {
+        if (mmu_prefault_user(as, page, write) < 0) {
+            return -EFAULT;
+        }
+    }
+    return 0;
+}
+
+/**
+ * sys_task_stats - Copy the caller's scheduling statistics out
+ *
+ * Run and wait time (TSC-accurate, in microseconds), dispatch count and
+ * ticks, as struct sched_task_stats.
+ *
+ * @param arg0  User address of an 8-byte aligned struct sched_task_stats
+ * @return      0 on success, -EINVAL if misaligned, -EFAULT for a bad
+ *              address
+ *
+ * RT: O(1) plus at most two page faults
+ */
+static long sys_task_stats(long arg0, long arg1, long arg2, long arg3, long arg4) {
     (void)arg1; (void)arg2; (void)arg3; (void)arg4;
 
-    // Not implemented yet
-    // TODO Phase 4: Implement sleep queue with timer-based wakeup
-    return -ENOSYS;
+    uintptr_t uaddr = (uintptr_t)arg0;
+    if (uaddr & (sizeof(uint64_t) - 1)) {
+        return -EINVAL;
+    }
+    // The copy may straddle a page boundary: both pages are faulted in
+    if (user_buffer(uaddr, sizeof(struct sched_task_stats), true) < 0) {
+        return -EFAULT;
+    }
+
+    scheduler_get_task_stats(scheduler_current(), (struct sched_task_stats*)uaddr);
+    return 0;
+}
+
+/**
+ * sys_chan_create - Create a channel
+ *
+ * @param arg0  Messages it can queue (1..CHAN_MAX_DEPTH)
+ * @return      Channel ID, -EINVAL for a bad depth, -ENOMEM
+ *
+ * RT: O(CHAN_MAX_CHANNELS), allocates
+ */
+static long sys_chan_create(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg1; (void)arg2; (void)arg3; (void)arg4;
+
+    if (arg0 <= 0 || arg0 > CHAN_MAX_DEPTH) {
+        return -EINVAL;
+    }
+    channel_t* ch = chan_create((uint32_t)arg0);
+    if (!ch) {
+        return -ENOMEM;
+    }
+    int id = chan_install(ch, scheduler_current()->address_space);
+    if (id < 0) {
+        chan_close(ch);
+    }
+    return id;
+}
+
+/**
+ * sys_chan_send - Queue a message on a channel
+ *
+ * @param arg0  Channel ID
+ * @param arg1  User address of the message (page-aligned with CHAN_PAGES)
+ * @param arg2  Length in bytes
+ * @param arg3  CHAN_NONBLOCK, CHAN_PAGES
+ * @param arg4  Timeout in microseconds (0 = none)
+ * @return      0 or an error from chan_send(); -EINVAL for an unknown ID
+ *              or another program's channel
+ *
+ * RT: see chan_send()
+ */
+static long sys_chan_send(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    uintptr_t uaddr = (uintptr_t)arg1;
+    size_t len = (size_t)arg2;
+    uint32_t flags = (uint32_t)arg3;
+
+    if (arg2 < 0 || arg4 < 0) {
+        return -EINVAL;
+    }
+    if (flags & CHAN_PAGES) {
+        // chan_send() faults the pages in itself while taking them
+        if (uaddr == 0 || len > USER_STACK_TOP || uaddr > USER_STACK_TOP - len) {
+            return -EFAULT;
+        }
+    } else if (len > CHAN_INLINE_MAX) {
+        return -EMSGSIZE;
+    } else if (len && user_buffer(uaddr, len, false) < 0) {
+        return -EFAULT;
+    }
+
+    channel_t* ch = chan_lookup((int)arg0, scheduler_current()->address_space);
+    if (!ch) {
+        return -EINVAL;
+    }
+    int rc = chan_send(ch, (const void*)uaddr, len, flags, (uint64_t)arg4);
+    chan_put(ch);
+    return rc;
+}
+
+/**
+ * sys_chan_recv - Take the oldest message off a channel
+ *
+ * @param arg0  Channel ID
+ * @param arg1  User address to copy or map the message at
+ * @param arg2  Room there in bytes
+ * @param arg3  CHAN_NONBLOCK
+ * @param arg4  Timeout in microseconds (0 = none)
+ * @return      Message length or an error from chan_recv(); -EINVAL for an
+ *              unknown ID or another program's channel
+ *
+ * RT: see chan_recv()
+ */
+static long sys_chan_recv(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    uintptr_t uaddr = (uintptr_t)arg1;
+    size_t len = (size_t)arg2;
+
+    if (arg2 < 0 || arg4 < 0) {
+        return -EINVAL;
+    }
+    // Page messages remap the whole range; inline ones copy at most this much
+    if (len && (len > USER_STACK_TOP || uaddr > USER_STACK_TOP - len ||
+                user_buffer(uaddr, MIN(len, CHAN_INLINE_MAX), true) < 0)) {
+        return -EFAULT;
+    }
+
+    channel_t* ch = chan_lookup((int)arg0, scheduler_current()->address_space);
+    if (!ch) {
+        return -EINVAL;
+    }
+    int rc = chan_recv(ch, (void*)uaddr, len, (uint32_t)arg3, (uint64_t)arg4);
+    chan_put(ch);
+    return rc;
+}
+
+/**
+ * sys_chan_close - Close a channel and release its ID
+ *
+ * Tasks blocked on it are woken (see chan_close()).
+ *
+ * @param arg0  Channel ID
+ * @return      0, or -EINVAL for an unknown ID or another program's channel
+ *
+ * RT: O(waiters)
+ */
+static long sys_chan_close(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg1; (void)arg2; (void)arg3; (void)arg4;
+
+    return chan_uninstall((int)arg0, scheduler_current()->address_space);
+}
+
+/**
+ * sys_ipc_create - Create an IPC endpoint
+ *
+ * @return      Endpoint ID, or -ENOMEM when all are taken
+ *
+ * RT: O(1)
+ */
+static long sys_ipc_create(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg0; (void)arg1; (void)arg2; (void)arg3; (void)arg4;
+
+    return ipc_endpoint_create();
+}
+
+// Message words from arg1..arg3; they travel back in EBX/ESI/EDI
+static inline void ipc_msg_in(struct ipc_msg* msg, long w0, long w1, long w2) {
+    msg->w[0] = (uint32_t)w0;
+    msg->w[1] = (uint32_t)w1;
+    msg->w[2] = (uint32_t)w2;
+}
+
+static inline void ipc_msg_out(const struct ipc_msg* msg) {
+    struct syscall_regs* regs = scheduler_current()->syscall_regs;
+    if (regs) {
+        regs->ebx = msg->w[0];
+        regs->esi = msg->w[1];
+        regs->edi = msg->w[2];
+    }
+}
+
+/**
+ * sys_call - Send an IPC request and wait for the reply
+ *
+ * @param arg0      Endpoint ID
+ * @param arg1-3    Request words
+ * @return          0 with the reply words in EBX/ESI/EDI, -EINVAL for an
+ *                  unknown endpoint, -EPERM
+ *
+ * RT: O(1), one context switch each way to a waiting server on this CPU
+ */
+static long sys_call(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg4;
+
+    ipc_endpoint_t* ep = ipc_endpoint_lookup((int)arg0);
+    if (!ep) {
+        return -EINVAL;
+    }
+
+    struct ipc_msg msg;
+    ipc_msg_in(&msg, arg1, arg2, arg3);
+    int rc = ipc_call(ep, &msg);
+    if (rc == 0) {
+        ipc_msg_out(&msg);
+    }
+    return rc;
+}
+
+/**
+ * sys_reply_wait - Reply to the last IPC caller, wait for the next request
+ *
+ * @param arg0      Endpoint ID
+ * @param arg1-3    Reply words (ignored on the first call)
+ * @return          0 with the request words in EBX/ESI/EDI, -EINVAL for
+ *                  an unknown endpoint, -EBUSY if another task serves it,
+ *                  -EPERM
+ *
+ * RT: O(1), one context switch back to the caller
+ */
+static long sys_reply_wait(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg4;
+
+    ipc_endpoint_t* ep = ipc_endpoint_lookup((int)arg0);
+    if (!ep) {
+        return -EINVAL;
+    }
+
+    struct ipc_msg msg;
+    ipc_msg_in(&msg, arg1, arg2, arg3);
+    int rc = ipc_reply_wait(ep, &msg);
+    if (rc == 0) {
+        ipc_msg_out(&msg);
+    }
+    return rc;
+}
+
+/**
+ * sys_ring_create - Create a shared ring and map both ends
+ *
+ * Both the producer and consumer mappings go into the caller's address
+ * space (ring_map() takes any two; mapping an end into another
+ * program's address space is not exposed as a syscall yet).
+ *
+ * @param arg0  Record size in bytes (4-byte multiple)
+ * @param arg1  Number of slots (one stays empty)
+ * @param arg2  Page-aligned user address for the producer mapping
+ * @param arg3  Page-aligned user address for the consumer mapping
+ * @return      Ring ID, -EINVAL for bad geometry or addresses, -EFAULT,
+ *              -EBUSY if a mapping overlaps a region, -ENOMEM
+ *
+ * NOT RT-safe: allocates pages
+ */
+static long sys_ring_create(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg4;
+
+    if (arg0 <= 0 || arg1 <= 0 || !ring_geometry_ok((uint32_t)arg0, (uint32_t)arg1)) {
+        return -EINVAL;
+    }
+    ring_t* ring = ring_create((uint32_t)arg0, (uint32_t)arg1);
+    if (!ring) {
+        return -ENOMEM;
+    }
+
+    size_t len = ring->npages * PAGE_SIZE;
+    uintptr_t prod = (uintptr_t)arg2;
+    uintptr_t cons = (uintptr_t)arg3;
+    if (prod == 0 || cons == 0 || prod > USER_STACK_TOP - len ||
+        cons > USER_STACK_TOP - len) {
+        ring_destroy(ring);
+        return -EFAULT;
+    }
+
+    page_table_t* as = scheduler_current()->address_space;
+    int rc = ring_map(ring, as, prod);
+    if (rc == 0) {
+        rc = ring_map(ring, as, cons);
+        if (rc < 0) {
+            mmu_release_region(as, prod);
+        }
+    }
+    if (rc == 0) {
+        rc = ring_install(ring, as);
+        if (rc < 0) {
+            mmu_release_region(as, cons);
+            mmu_release_region(as, prod);
+        }
+    }
+    if (rc < 0) {
+        ring_destroy(ring);
+    }
+    return rc;
+}
+
+/**
+ * sys_ring_wait - Consumer: sleep while a ring is empty
+ *
+ * @param arg0  Ring ID
+ * @param arg1  Timeout in microseconds (0 = none)
+ * @return      0 once records are available, -ETIMEDOUT, -EINVAL (also for
+ *              another program's ring), -EPERM
+ *
+ * RT: O(1) to block
+ */
+static long sys_ring_wait(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg2; (void)arg3; (void)arg4;
+
+    ring_t* ring = ring_lookup((int)arg0, scheduler_current()->address_space);
+    if (!ring || arg1 < 0) {
+        return -EINVAL;
+    }
+    return ring_wait(ring, (uint64_t)arg1);
+}
+
+/**
+ * sys_ring_doorbell - Producer: wake a consumer sleeping on a ring
+ *
+ * Only needed when the shared consumer_waiting flag is set after a push.
+ *
+ * @param arg0  Ring ID
+ * @return      1 if the consumer was woken, 0 if not, -EINVAL (also for
+ *              another program's ring)
+ *
+ * RT: O(1)
+ */
+static long sys_ring_doorbell(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg1; (void)arg2; (void)arg3; (void)arg4;
+
+    ring_t* ring = ring_lookup((int)arg0, scheduler_current()->address_space);
+    if (!ring) {
+        return -EINVAL;
+    }
+    return ring_doorbell(ring);
+}
+
+/**
+ * sys_uring_setup - Create and map batched submission/completion rings
+ *
+ * Each ring is one page, a struct ring_header followed by URING_SQ_ENTRIES
+ * struct uring_sqe or URING_CQ_ENTRIES struct uring_cqe.
+ *
+ * @param arg0  Page-aligned user address for the submission ring
+ * @param arg1  Page-aligned user address for the completion ring
+ * @param arg2  URING_SETUP_SQPOLL to have a kernel thread consume it
+ * @return      uring ID, -EINVAL, -EFAULT, -EBUSY if a mapping overlaps a
+ *              region, -ENOMEM
+ *
+ * NOT RT-safe: allocates pages (and a thread)
+ */
+static long sys_uring_setup(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg3; (void)arg4;
+
+    uintptr_t sq_addr = (uintptr_t)arg0;
+    uintptr_t cq_addr = (uintptr_t)arg1;
+    uint32_t flags = (uint32_t)arg2;
+    if (flags & ~URING_SETUP_SQPOLL) {
+        return -EINVAL;
+    }
+    if (sq_addr == 0 || cq_addr == 0 || sq_addr > USER_STACK_TOP - PAGE_SIZE ||
+        cq_addr > USER_STACK_TOP - PAGE_SIZE) {
+        return -EFAULT;
+    }
+
+    page_table_t* as = scheduler_current()->address_space;
+    uring_t* uring = uring_create(as);
+    if (!uring) {
+        return -ENOMEM;
+    }
+
+    // Everything up to here is undone on failure; the poller is not
+    int rc = ring_map(uring->sq, as, sq_addr);
+    if (rc == 0) {
+        rc = ring_map(uring->cq, as, cq_addr);
+        if (rc < 0) {
+            mmu_release_region(as, sq_addr);
+        }
+    }
+    if (rc < 0) {
+        uring_destroy(uring);
+        return rc;
+    }
+
+    rc = uring_install(uring);
+    if (rc > 0 && (flags & URING_SETUP_SQPOLL) && uring_start_poller(uring) < 0) {
+        return -ENOMEM;  // The ID stays taken; the rings still work via enter
+    }
+    return rc;
+}
+
+/**
+ * sys_uring_enter - Run queued submissions
+ *
+ * Without a poller, runs up to arg1 entries from the submission ring and
+ * queues their results. With one, only wakes it if it sleeps.
+ *
+ * @param arg0  uring ID
+ * @param arg1  Most entries to run
+ * @param arg2  URING_ENTER_WAIT: then sleep until a completion is queued
+ * @return      Entries run, -EINVAL (also for another program's pair),
+ *              -EBUSY if another task is running the batch, -EPERM if it
+ *              cannot sleep
+ *
+ * RT: O(arg1) plus what the entries cost
+ */
+static long sys_uring_enter(long arg0, long arg1, long arg2, long arg3, long arg4) {
+    (void)arg3; (void)arg4;
+
+    uring_t* uring = uring_lookup((int)arg0, scheduler_current()->address_space);
+    if (!uring || arg1 < 0 || ((uint32_t)arg2 & ~URING_ENTER_WAIT)) {
+        return -EINVAL;
+    }
+
+    int done = 0;
+    if (uring->poller) {
+        ring_doorbell(uring->sq);
+    } else {
+        done = uring_submit(uring, (uint32_t)arg1);
+        if (done < 0) {
+            return done;
+        }
+    }
+
+    if ((uint32_t)arg2 & URING_ENTER_WAIT) {
+        int rc = ring_wait(uring->cq, 0);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return done;
 }
 
 /**
@@ -166,7 +729,8 @@ static long sys_sleep_us(long arg0, long arg1, long arg2, long arg3, long arg4)
 void syscall_init(void) {
     // INT 0x80 is registered in IDT during idt_init()
     // with DPL=3 to allow userspace calls
-    // Nothing to do here for now
+    bool fast = syscall_init_cpu(hal->cpu_id());
 
-    kprintf("[SYSCALL] Syscall subsystem initialized (INT 0x80)\n");
+    kprintf("[SYSCALL] Syscall subsystem initialized (INT 0x80%s)\n",
+            fast ? ", SYSENTER" : "");
 }
@@ -0,0 +1,22 @@
+/**
+ * Benchmark for the INT 0x80 syscall path
+ *
+ * A ring 0 INT 0x80 (the same helper init.c's Phase B check uses) with
+ * SYS_GETPID: gate entry, register save, table dispatch and IRET, with
+ * the least possible work in the handler. There is no documented budget,
+ * so it is reported only.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/syscall.h>
+#include <kernel/timer.h>
+
+extern long syscall_int80(long syscall_num, long arg0, long arg1, long arg2, long arg3, long arg4);
+
+static uint64_t bench_int80_getpid(void) {
+    uint64_t start = timer_read_tsc();
+    syscall_int80(SYS_GETPID, 0, 0, 0, 0, 0);
+    return timer_read_tsc() - start;
+}
+
+KBENCH_DEFINE("syscall", int80_getpid, bench_int80_getpid, 0);
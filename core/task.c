@@ -8,16 +8,19 @@
 #include <kernel/task.h>
 #include <kernel/scheduler.h>
 #include <kernel/pmm.h>
+#include <kernel/slab.h>
 #include <kernel/mmu.h>
 #include <kernel/hal.h>
+#include <kernel/percpu.h>
+#include <kernel/ktimer.h>
+#include <kernel/fpu.h>
+#include <kernel/idle.h>
+#include <kernel/log.h>
 #include <drivers/vga.h>
 #include <lib/string.h>
 
 // Next task ID (monotonically increasing)
-static uint32_t next_task_id = 1;
-
-// Idle task (always schedulable, never blocks)
-static task_t* idle_task = NULL;
+static atomic_t next_task_id = { 1 };
 
 /**
  * Allocate a new task structure
@@ -25,18 +28,50 @@ static task_t* idle_task = NULL;
  * @return  Pointer to allocated task, or NULL on failure
  */
 task_t* task_alloc(void) {
-    // Allocate task structure from PMM
-    task_t* task = (task_t*)pmm_alloc_page();
+    // Allocate zeroed task structure from the slab allocator
+    task_t* task = kzalloc(sizeof(task_t));
     if (!task) {
         return NULL;
     }
 
-    // Zero out structure
-    memset(task, 0, sizeof(task_t));
+    // Assign unique task ID; runs on the creating CPU until stolen
+    task->task_id = atomic_inc(&next_task_id);
+    task->cpu = hal->cpu_id();
+
+    return task;
+}
 
-    // Assign unique task ID
-    task->task_id = next_task_id++;
+/**
+ * Take a cached task/stack pair with a stack of exactly `stack_size`
+ *
+ * @return  Zeroed task owning its old stack, or NULL if none is cached
+ *
+ * RT: O(TASK_CACHE_SIZE)
+ */
+static task_t* task_cache_get(size_t stack_size) {
+    uint32_t flags = hal->irq_disable();
+    struct per_cpu_data* cpu = this_cpu();
+
+    task_t** link = &cpu->task_cache;
+    while (*link && (*link)->kernel_stack_size != stack_size) {
+        link = &(*link)->reap_next;
+    }
+    task_t* task = *link;
+    if (task) {
+        *link = task->reap_next;
+        cpu->task_cache_count--;
+    }
+    hal->irq_restore(flags);
 
+    if (!task) {
+        return NULL;
+    }
+
+    // Only the struct is cleared; the stack is rewritten from the top
+    void* stack = task->kernel_stack;
+    memset(task, 0, sizeof(*task));
+    task->kernel_stack = stack;
+    task->kernel_stack_size = stack_size;
     return task;
 }
 
@@ -44,7 +79,8 @@ task_t* task_alloc(void) {
  * Idle thread entry point
  *
  * Runs when no other tasks are ready.
- * Just halts CPU until next interrupt.
+ * Reaps exited tasks and tops up the PMM's pre-zeroed pool, then halts
+ * until the next interrupt.
  *
  * CRITICAL: Must enable interrupts before halting!
  * schedule() disables interrupts during context switch,
@@ -53,48 +89,65 @@ task_t* task_alloc(void) {
 static void idle_thread_entry(void* arg) {
     (void)arg;
 
-    kprintf("[TASK] Idle thread started\n");
+    log_debug(TASK, "Idle thread started\n");
 
     while (1) {
         // CRITICAL: Enable interrupts before halting
         // schedule() might have disabled them during context switch
         hal->irq_enable();
 
-        // Halt CPU until next interrupt
-        // Timer IRQs will wake us up and scheduler will preempt if needed
-        hal->cpu_halt();
+        // Tear down exited tasks first so their memory is reusable
+        if (task_reap(1) > 0) {
+            continue;
+        }
+
+        // Spend idle time pre-zeroing frames for pmm_alloc_zeroed_page().
+        // One frame per pass bounds wakeup latency to a single 4KB clear.
+        if (pmm_zero_pool_refill(1) > 0) {
+            continue;
+        }
+
+        // Poll, then sleep until new work or an interrupt (kernel/idle.h);
+        // a wakeup by flag store comes without an interrupt to reschedule
+        idle_enter();
+        if (scheduler_need_resched()) {
+            schedule();
+        }
     }
 }
 
 /**
- * Initialize task subsystem
+ * Create the idle task for a CPU
+ *
+ * Note: We can't use task_create_kernel_thread() because idle tasks are
+ * never enqueued, so we manually create it
  */
-void task_init(void) {
-    kprintf("[TASK] Initializing task subsystem...\n");
+task_t* task_create_idle(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS) {
+        return NULL;
+    }
 
-    // Create idle task
-    // Note: We can't use task_create_kernel_thread() yet because
-    // the scheduler isn't initialized, so we manually create it
-    idle_task = (task_t*)pmm_alloc_page();
-    if (!idle_task) {
+    task_t* idle = kzalloc(sizeof(task_t));
+    if (!idle) {
         kprintf("[TASK] FATAL: Failed to allocate idle task\n");
-        return;
+        return NULL;
     }
 
-    memset(idle_task, 0, sizeof(task_t));
-
-    idle_task->task_id = 0;  // Idle task always has ID 0
-    strlcpy(idle_task->name, "idle", sizeof(idle_task->name));
-    idle_task->state = TASK_STATE_READY;
-    idle_task->priority = SCHED_IDLE_PRIORITY;
-    idle_task->address_space = mmu_get_kernel_address_space();
+    idle->task_id = 0;  // Idle tasks always have ID 0
+    strlcpy(idle->name, "idle", sizeof(idle->name));
+    idle->state = TASK_STATE_READY;
+    idle->priority = SCHED_IDLE_PRIORITY;
+    idle->base_priority = SCHED_IDLE_PRIORITY;
+    idle->cpu = cpu_id;
+    idle->address_space = mmu_get_kernel_address_space();
 
     // Allocate kernel stack for idle task
-    idle_task->kernel_stack_size = 4096;
-    idle_task->kernel_stack = (void*)pmm_alloc_page();
-    if (!idle_task->kernel_stack) {
+    idle->kernel_stack_size = 4096;
+    idle->kernel_stack = (void*)pmm_alloc_page();
+    if (!idle->kernel_stack) {
         kprintf("[TASK] FATAL: Failed to allocate idle task stack\n");
-        return;
+        kfree(idle);
+        return NULL;
     }
 
     // Set up stack for idle_thread_entry(void*):
@@ -102,39 +155,52 @@ void task_init(void) {
     // [esp]   = return address (unused, set to 0)
     // [esp+4] = first argument (NULL)
     // Stack grows DOWN, so push arg first (higher address), then return (lower address)
-    uint8_t* stack_top = (uint8_t*)idle_task->kernel_stack + idle_task->kernel_stack_size;
+    uint8_t* stack_top = (uint8_t*)idle->kernel_stack + idle->kernel_stack_size;
     uint32_t* sp = (uint32_t*)stack_top;
     --sp;            // Push argument at higher address
     *sp = 0;         // arg = NULL (will be at [esp+4])
     --sp;            // Push return address at lower address
     *sp = 0;         // return = 0 (will be at [esp])
 
-    idle_task->context.esp = (uint32_t)sp;
-    idle_task->context.ebp = idle_task->context.esp;
+    idle->context.esp = (uint32_t)sp;
+    idle->context.ebp = idle->context.esp;
 
     // Set entry point
-    idle_task->context.eip = (uint32_t)idle_thread_entry;
+    idle->context.eip = (uint32_t)idle_thread_entry;
 
     // Set up segment registers for kernel mode
-    idle_task->context.cs = 0x08;  // Kernel code segment
-    idle_task->context.ss = 0x10;  // Kernel data segment
-    idle_task->context.ds = 0x10;
-    idle_task->context.es = 0x10;
-    idle_task->context.fs = 0x10;
-    idle_task->context.gs = 0x10;
+    idle->context.cs = 0x08;  // Kernel code segment
+    idle->context.ss = 0x10;  // Kernel data segment
+    idle->context.ds = 0x10;
+    idle->context.es = 0x10;
+    idle->context.fs = 0x10;
+    idle->context.gs = 0x10;
 
     // Set EFLAGS (IF=1 to enable interrupts)
-    idle_task->context.eflags = 0x202;  // IF bit set
+    idle->context.eflags = 0x202;  // IF bit set
 
-    kprintf("[TASK] Idle task created (ID: %u, stack: %p)\n",
-            (unsigned int)idle_task->task_id, idle_task->kernel_stack);
+    cpu_data(cpu_id)->idle_task = idle;
+
+    log_debug(TASK, "Idle task for CPU %u created (stack: %p)\n",
+            (unsigned int)cpu_id, idle->kernel_stack);
+    return idle;
+}
+
+/**
+ * Initialize task subsystem
+ */
+void task_init(void) {
+    log_debug(TASK, "Initializing task subsystem...\n");
+
+    // Boot CPU's idle task; APs create theirs in scheduler_init_cpu()
+    task_create_idle(hal->cpu_id());
 }
 
 /**
  * Get idle task
  */
 task_t* task_get_idle(void) {
-    return idle_task;
+    return this_cpu()->idle_task;
 }
 
 /**
@@ -170,32 +236,57 @@ task_t* task_create_kernel_thread(const char* name,
                                    void (*entry_point)(void* arg),
                                    void* arg,
                                    uint8_t priority,
-                                   size_t stack_size) {
+                                   size_t stack_size,
+                                   uint32_t quantum_us) {
     // Validate inputs
     if (!entry_point) {
         return NULL;
     }
 
-    // IMPORTANT: We only allocate ONE page (4096 bytes) for the stack.
-    // Enforce stack_size == 4096 to prevent memory corruption.
-    // TODO Phase 4: Allocate multiple pages for larger stacks
-    if (stack_size != 4096) {
-        kprintf("[TASK] ERROR: stack_size must be exactly 4096 bytes (requested: %u)\n",
+    // Stacks are contiguous page blocks from the buddy allocator
+    if (stack_size == 0 || (stack_size & (PAGE_SIZE - 1)) != 0 ||
+        stack_size > TASK_MAX_STACK_SIZE) {
+        log_err(TASK, "stack_size must be a multiple of %u up to %u bytes (requested: %u)\n",
+                (unsigned int)PAGE_SIZE, (unsigned int)TASK_MAX_STACK_SIZE,
                 (unsigned int)stack_size);
         return NULL;
     }
-
-    // Allocate task struct
-    task_t* task = (task_t*)pmm_alloc_page();
-    if (!task) {
-        kprintf("[TASK] Failed to allocate task struct\n");
+    if (quantum_us != 0 &&
+        (quantum_us < SCHED_QUANTUM_MIN_US || quantum_us > SCHED_QUANTUM_MAX_US)) {
+        log_err(TASK, "quantum must be %u-%u us (requested: %u)\n",
+                (unsigned int)SCHED_QUANTUM_MIN_US, (unsigned int)SCHED_QUANTUM_MAX_US,
+                (unsigned int)quantum_us);
         return NULL;
     }
 
-    memset(task, 0, sizeof(task_t));
+    unsigned int stack_order = pmm_order_for_size(stack_size);
+    stack_size = (size_t)PAGE_SIZE << stack_order;
+
+    // Prefer a warm task/stack pair, reaping this CPU's zombies for one
+    task_t* task = task_cache_get(stack_size);
+    if (!task && task_reap(TASK_REAP_BATCH) > 0) {
+        task = task_cache_get(stack_size);
+    }
+
+    if (!task) {
+        task = kzalloc(sizeof(task_t));
+        if (!task) {
+            log_err(TASK, "Failed to allocate task struct\n");
+            return NULL;
+        }
+
+        // Allocate kernel stack (rounded up to a whole buddy block)
+        task->kernel_stack_size = stack_size;
+        task->kernel_stack = (void*)pmm_alloc_pages(stack_order);
+        if (!task->kernel_stack) {
+            log_err(TASK, "Failed to allocate stack for task %s\n", name);
+            kfree(task);
+            return NULL;
+        }
+    }
 
     // Assign task ID
-    task->task_id = next_task_id++;
+    task->task_id = atomic_inc(&next_task_id);
 
     // Copy name
     strlcpy(task->name, name, sizeof(task->name));
@@ -203,17 +294,11 @@ task_t* task_create_kernel_thread(const char* name,
     // Set initial state
     task->state = TASK_STATE_READY;
     task->priority = priority;
+    task->base_priority = priority;
+    task->quantum_us = quantum_us;
+    task->cpu = hal->cpu_id();
     task->address_space = mmu_get_kernel_address_space();  // Kernel address space
 
-    // Allocate kernel stack
-    task->kernel_stack_size = stack_size;
-    task->kernel_stack = (void*)pmm_alloc_page();
-    if (!task->kernel_stack) {
-        kprintf("[TASK] Failed to allocate stack for task %s\n", name);
-        pmm_free_page((phys_addr_t)task);
-        return NULL;
-    }
-
     // Set up stack layout for task_wrapper(wrapper_args*):
     // cdecl calling convention requires:
     // [esp]   = return address (what function would RET to)
@@ -254,7 +339,7 @@ task_t* task_create_kernel_thread(const char* name,
     // Set EFLAGS (IF=1 to enable interrupts)
     task->context.eflags = 0x202;
 
-    kprintf("[TASK] Created task '%s' (ID: %u, priority: %u, stack: %p)\n",
+    log_debug(TASK, "Created task '%s' (ID: %u, priority: %u, stack: %p)\n",
             name, (unsigned int)task->task_id, (unsigned int)priority, task->kernel_stack);
 
     return task;
@@ -268,15 +353,78 @@ void task_destroy(task_t* task) {
         return;
     }
 
-    kprintf("[TASK] Destroying task '%s' (ID: %u)\n", task->name, (unsigned int)task->task_id);
+    log_debug(TASK, "Destroying task '%s' (ID: %u)\n", task->name, (unsigned int)task->task_id);
+
+    fpu_task_release(task);
+
+    // Give back its CPU reservation and stop any replenishment
+    if (task_is_deadline(task)) {
+        scheduler_set_deadline(task, 0, 0, 0);
+    }
+
+    // A private address space (task_create_user_elf()) dies with its task
+    page_table_t* kernel_as = mmu_get_kernel_address_space();
+    if (task->address_space && task->address_space != kernel_as) {
+        mmu_destroy_address_space(task->address_space);
+        task->address_space = kernel_as;
+    }
+
+    // Keep the pair for reuse while this CPU's cache has room
+    uint32_t flags = hal->irq_disable();
+    struct per_cpu_data* cpu = this_cpu();
+    bool cached = task->kernel_stack && cpu->task_cache_count < TASK_CACHE_SIZE;
+    if (cached) {
+        task->reap_next = cpu->task_cache;
+        cpu->task_cache = task;
+        cpu->task_cache_count++;
+    }
+    hal->irq_restore(flags);
+    if (cached) {
+        return;
+    }
 
     // Free kernel stack
     if (task->kernel_stack) {
-        pmm_free_page((phys_addr_t)task->kernel_stack);
+        pmm_free_pages((phys_addr_t)task->kernel_stack,
+                       pmm_order_for_size(task->kernel_stack_size));
     }
 
     // Free task struct
-    pmm_free_page((phys_addr_t)task);
+    kfree(task);
+}
+
+/**
+ * Queue an exited task for reaping (interrupts disabled)
+ */
+void task_queue_zombie(task_t* task) {
+    struct per_cpu_data* cpu = this_cpu();
+    task->reap_next = cpu->zombies;
+    cpu->zombies = task;
+}
+
+/**
+ * Reap exited tasks on this CPU
+ */
+uint32_t task_reap(uint32_t max) {
+    uint32_t reaped = 0;
+
+    while (reaped < max) {
+        uint32_t flags = hal->irq_disable();
+        struct per_cpu_data* cpu = this_cpu();
+        task_t* zombie = cpu->zombies;
+        if (zombie) {
+            cpu->zombies = zombie->reap_next;
+        }
+        hal->irq_restore(flags);
+
+        if (!zombie) {
+            break;
+        }
+        task_destroy(zombie);
+        reaped++;
+    }
+
+    return reaped;
 }
 
 /**
@@ -285,14 +433,15 @@ void task_destroy(task_t* task) {
 void task_exit(int exit_code) {
     task_t* current = task_current();
 
-    kprintf("[TASK] Task '%s' (ID: %u) exiting with code %d\n",
+    log_debug(TASK, "Task '%s' (ID: %u) exiting with code %d\n",
             current->name, (unsigned int)current->task_id, exit_code);
 
     // Mark as zombie
     current->state = TASK_STATE_ZOMBIE;
     current->exit_code = exit_code;
 
-    // Yield to scheduler (will never return)
+    // Yield to scheduler (will never return); the CPU that switches
+    // away from us queues us for task_reap()
     schedule();
 
     // Should never reach here
@@ -307,3 +456,50 @@ void task_exit(int exit_code) {
 void task_yield(void) {
     schedule();
 }
+
+// Sleep timer expired: make the sleeper runnable again
+static void task_sleep_expired(struct ktimer* timer, void* arg) {
+    (void)timer;
+    task_t* task = (task_t*)arg;
+
+    if (task->state == TASK_STATE_BLOCKED) {
+        task->state = TASK_STATE_READY;
+        scheduler_enqueue(task);
+    }
+}
+
+/**
+ * Block the current task for at least `us` microseconds
+ *
+ * The timer lives on this stack and on this CPU's wheel; interrupts stay
+ * off from arming it until schedule() has switched away, so the wakeup
+ * cannot run before the task is off the CPU.
+ */
+int task_sleep_us(uint64_t us) {
+    task_t* current = task_current();
+    if (!current || current == task_get_idle() ||
+        current->state != TASK_STATE_RUNNING) {
+        return -EPERM;
+    }
+
+    if (us == 0) {
+        task_yield();
+        return 0;
+    }
+
+    struct ktimer timer;
+    ktimer_init(&timer, task_sleep_expired, current);
+
+    uint32_t flags = hal->irq_disable();
+    current->state = TASK_STATE_BLOCKED;
+    int rc = ktimer_add(&timer, us);
+    if (rc < 0) {
+        current->state = TASK_STATE_RUNNING;
+        hal->irq_restore(flags);
+        return rc;
+    }
+    schedule();
+    hal->irq_restore(flags);
+
+    return 0;
+}
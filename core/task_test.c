@@ -0,0 +1,103 @@
+/**
+ * Unit tests for task recycling
+ *
+ * Tests run from the bootstrap context, which cannot switch away: they
+ * queue never-run tasks as zombies by hand and check that reaping and
+ * creation recycle task structs with their stacks, and that quanta are
+ * validated and refilled.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/task.h>
+#include <kernel/scheduler.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+
+static void noop_entry(void* arg) {
+    (void)arg;
+}
+
+// Test: a destroyed pair is reused by the next same-sized creation only
+static int test_task_cache_reuse(void) {
+    task_t* a = task_create_kernel_thread("cache_a", noop_entry, NULL, 10, 4096, 0);
+    KTEST_ASSERT_NOT_NULL(a, "task created");
+
+    void* stack = a->kernel_stack;
+    uint32_t id = a->task_id;
+    a->on_rq = true;  // Stale state must not survive recycling
+    task_destroy(a);
+
+    task_t* big = task_create_kernel_thread("cache_big", noop_entry, NULL, 10, 8192, 0);
+    KTEST_ASSERT_NOT_NULL(big, "larger task created");
+    bool big_fresh = big != a;
+
+    task_t* b = task_create_kernel_thread("cache_b", noop_entry, NULL, 10, 4096, 0);
+    KTEST_ASSERT_NOT_NULL(b, "task recreated");
+    bool reused = b == a && b->kernel_stack == stack;
+    bool reset = !b->on_rq && b->task_id != id && b->state == TASK_STATE_READY;
+
+    task_destroy(big);
+    task_destroy(b);
+
+    KTEST_ASSERT(big_fresh, "different stack size skips the cached pair");
+    KTEST_ASSERT(reused, "same size reuses struct and stack");
+    KTEST_ASSERT(reset, "recycled task starts clean");
+
+    return KTEST_PASS;
+}
+
+// Test: queued zombies are only torn down by task_reap()
+static int test_task_reap(void) {
+    task_t* t = task_create_kernel_thread("zombie", noop_entry, NULL, 10, 4096, 0);
+    KTEST_ASSERT_NOT_NULL(t, "task created");
+    t->state = TASK_STATE_ZOMBIE;
+
+    uint32_t flags = hal->irq_disable();
+    task_queue_zombie(t);
+    hal->irq_restore(flags);
+
+    bool queued = this_cpu()->zombies == t;
+    uint32_t reaped = task_reap(TASK_REAP_BATCH);
+    bool drained = this_cpu()->zombies == NULL;
+
+    task_t* again = task_create_kernel_thread("zombie2", noop_entry, NULL, 10, 4096, 0);
+    bool recycled = again == t;
+    task_destroy(again);
+
+    KTEST_ASSERT(queued, "zombie queued on this CPU");
+    KTEST_ASSERT_EQ(reaped, 1, "one zombie reaped");
+    KTEST_ASSERT(drained, "zombie list empty");
+    KTEST_ASSERT(recycled, "reaped task is reused");
+
+    return KTEST_PASS;
+}
+
+static int probe_quantum(task_t* t, void* arg) {
+    (void)arg;
+
+    KTEST_ASSERT_EQ(task_quantum_us(t), 20000, "creation sets the quantum");
+    KTEST_ASSERT_EQ(t->slice_left_us, 20000, "enqueue refills the slice");
+    KTEST_ASSERT_EQ(scheduler_set_quantum(t, SCHED_QUANTUM_MAX_US + 1), -EINVAL,
+                    "too long a quantum refused");
+    KTEST_ASSERT_EQ(scheduler_set_quantum(t, SCHED_QUANTUM_MIN_US), 0, "quantum changed");
+    KTEST_ASSERT_EQ(t->slice_left_us, SCHED_QUANTUM_MIN_US,
+                    "rest of the slice shortened to the new quantum");
+    scheduler_set_quantum(t, 0);
+    KTEST_ASSERT_EQ(task_quantum_us(t), SCHED_TIME_SLICE_US, "0 selects the default quantum");
+
+    return KTEST_PASS;
+}
+
+// Test: quanta are validated and refill the slice on enqueue
+static int test_task_quantum(void) {
+    KTEST_ASSERT_NULL(task_create_kernel_thread("q_bad", noop_entry, NULL, 10, 4096,
+                                                SCHED_QUANTUM_MIN_US - 1),
+                      "too short a quantum refused");
+
+    task_t* t = task_create_kernel_thread("q_long", noop_entry, NULL, 10, 4096, 20000);
+    return ktest_run_queued(t, probe_quantum, NULL);
+}
+
+KTEST_DEFINE("task", task_cache_reuse, test_task_cache_reuse);
+KTEST_DEFINE("task", task_reap, test_task_reap);
+KTEST_DEFINE("task", task_quantum, test_task_quantum);
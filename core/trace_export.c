@@ -0,0 +1,172 @@
+/**
+ * Binary trace export
+ *
+ * Encoder, chunking and the streaming thread (format in
+ * include/kernel/trace.h).
+ */
+
+#include <kernel/trace.h>
+#include <kernel/spinlock.h>
+#include <kernel/scheduler.h>
+#include <kernel/task.h>
+#include <kernel/timer.h>
+#include <kernel/hal.h>
+#include <drivers/serial.h>
+
+#define EXPORT_BUF_SIZE     2048
+#define EXPORT_BATCH        8       // Events copied out per trace_read()
+#define EXPORT_PRIORITY     (SCHED_IDLE_PRIORITY + 1)
+
+struct export_thread {
+    struct serial_port* port;
+    uint64_t            period_us;
+};
+
+static spinlock_t export_lock = SPINLOCK_INIT;
+static uint8_t export_buf[EXPORT_BUF_SIZE];      // export_lock
+static uint32_t export_reported[MAX_CPUS];       // Overflow count already exported
+static struct export_thread export_thread;
+static task_t* export_task;
+
+static size_t put_varint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t put_le(uint8_t* out, uint64_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(v >> (8 * i));
+    }
+    return bytes;
+}
+
+static size_t put_record(uint8_t* out, uint32_t type, uint32_t cpu, uint64_t delta,
+                         const uint64_t* words, uint32_t nwords) {
+    size_t n = 0;
+    out[n++] = (uint8_t)(type | (nwords << 5));
+    n += put_varint(out + n, cpu);
+    n += put_varint(out + n, delta);
+    for (uint32_t i = 0; i < nwords; i++) {
+        n += put_varint(out + n, words[i]);
+    }
+    return n;
+}
+
+size_t trace_export_header(uint8_t* out, uint16_t nr_cpus, uint64_t tsc_freq_hz) {
+    size_t n = put_le(out, TRACE_EXPORT_MAGIC, 4);
+    out[n++] = TRACE_EXPORT_VERSION;
+    out[n++] = 0;
+    n += put_le(out + n, nr_cpus, 2);
+    n += put_le(out + n, tsc_freq_hz, 8);
+    return n;
+}
+
+size_t trace_export_encode(uint8_t* out, const struct trace_event* event, uint64_t* last_tsc) {
+    uint32_t nwords = 4;
+    while (nwords > 0 && event->data[nwords - 1] == 0) {
+        nwords--;
+    }
+    // One CPU's stamps only go forward; never emit a wrapped delta
+    uint64_t delta = event->timestamp > *last_tsc ? event->timestamp - *last_tsc : 0;
+    *last_tsc += delta;
+    return put_record(out, event->event_type, event->cpu_id, delta, event->data, nwords);
+}
+
+// Write out the chunk in export_buf and start the next one
+static size_t export_flush(struct serial_port* port, size_t len, uint16_t nr_cpus,
+                           uint64_t tsc_freq, uint64_t* last_tsc) {
+    export_buf[len++] = TRACE_EXPORT_TAG_END;
+    serial_write_raw(port, export_buf, len);
+    *last_tsc = 0;
+    return trace_export_header(export_buf, nr_cpus, tsc_freq);
+}
+
+int trace_export(struct serial_port* port) {
+    if (!port || !port->initialized) {
+        return -ENODEV;
+    }
+    if (!spin_trylock(&export_lock)) {
+        return -EBUSY;
+    }
+
+    uint32_t nr_cpus = hal->smp_num_cpus();
+    if (nr_cpus == 0) {
+        nr_cpus = 1;
+    }
+    if (nr_cpus > MAX_CPUS) {
+        nr_cpus = MAX_CPUS;
+    }
+    uint64_t tsc_freq = timer_get_tsc_freq();
+    size_t empty = trace_export_header(export_buf, (uint16_t)nr_cpus, tsc_freq);
+    size_t len = empty;
+    int written = 0;
+
+    for (uint32_t cpu = 0; cpu < nr_cpus; cpu++) {
+        if (!per_cpu[cpu]->online) {
+            continue;
+        }
+        uint64_t last_tsc = 0;
+
+        uint32_t lost = atomic_read(&per_cpu[cpu]->trace.overflow);
+        if (lost != export_reported[cpu]) {
+            uint64_t count = lost - export_reported[cpu];
+            len += put_record(export_buf + len, TRACE_EXPORT_TAG_LOST, cpu, 0, &count, 1);
+            export_reported[cpu] = lost;
+        }
+
+        struct trace_event batch[EXPORT_BATCH];
+        int got;
+        while ((got = trace_read(cpu, batch, EXPORT_BATCH)) > 0) {
+            for (int i = 0; i < got; i++) {
+                if (len + TRACE_EXPORT_RECORD_MAX + 1 > EXPORT_BUF_SIZE) {
+                    len = export_flush(port, len, (uint16_t)nr_cpus, tsc_freq, &last_tsc);
+                }
+                len += trace_export_encode(export_buf + len, &batch[i], &last_tsc);
+                written++;
+            }
+        }
+        // Room for the next CPU's lost record
+        if (len + TRACE_EXPORT_RECORD_MAX + 1 > EXPORT_BUF_SIZE) {
+            len = export_flush(port, len, (uint16_t)nr_cpus, tsc_freq, &last_tsc);
+        }
+    }
+
+    if (len > empty) {
+        uint64_t last_tsc;
+        export_flush(port, len, (uint16_t)nr_cpus, tsc_freq, &last_tsc);
+    }
+    spin_unlock(&export_lock);
+    return written;
+}
+
+static void trace_export_main(void* arg) {
+    struct export_thread* thread = arg;
+    for (;;) {
+        trace_export(thread->port);
+        task_sleep_us(thread->period_us);
+    }
+}
+
+int trace_export_start(struct serial_port* port, uint64_t period_us) {
+    if (!port || !port->initialized) {
+        return -ENODEV;
+    }
+    if (export_task) {
+        return 0;
+    }
+
+    export_thread.port = port;
+    export_thread.period_us = period_us ? period_us : TRACE_EXPORT_US;
+    export_task = task_create_kernel_thread("tracedump", trace_export_main, &export_thread,
+                                            EXPORT_PRIORITY, 4096, 0);
+    if (!export_task) {
+        return -ENOMEM;
+    }
+    scheduler_enqueue(export_task);
+    return 0;
+}
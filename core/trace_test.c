@@ -0,0 +1,137 @@
+/**
+ * Unit tests for trace points
+ *
+ * Covers the per-event enable mask, that recorded events come back
+ * from trace_read() in order with their data, the per-CPU areas holding
+ * the buffers, and the export encoding.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/trace.h>
+#include <kernel/hal.h>
+#include <lib/string.h>
+
+static void trace_drain(uint32_t cpu) {
+    struct trace_event scratch[8];
+    while (trace_read(cpu, scratch, 8) > 0) {
+    }
+}
+
+// Test: only enabled event types are recorded
+static int test_trace_mask(void) {
+    uint32_t cpu = this_cpu()->cpu_id;
+    uint32_t saved = trace_enabled_mask;
+    struct trace_event ev[4];
+
+    trace_drain(cpu);
+    trace_set_mask(0);
+    trace_point(TRACE_CUSTOM, 1, 2, 3, 4);
+    int none = trace_read(cpu, ev, 4);
+
+    trace_set_mask(TRACE_BIT(TRACE_CUSTOM));
+    trace_point(TRACE_SYSCALL, 9, 0, 0, 0);
+    trace_point(TRACE_CUSTOM, 1, 2, 3, 4);
+    trace_point(TRACE_CUSTOM, 5, 6, 7, 8);
+    int got = trace_read(cpu, ev, 4);
+    trace_set_mask(saved);
+
+    KTEST_ASSERT_EQ(none, 0, "disabled type not recorded");
+    if (CONFIG_TRACE) {
+        KTEST_ASSERT_EQ(got, 2, "enabled type recorded, others not");
+        KTEST_ASSERT_EQ(ev[0].event_type, TRACE_CUSTOM, "type kept");
+        KTEST_ASSERT_EQ(ev[0].data[0], 1, "first event first");
+        KTEST_ASSERT_EQ(ev[1].data[3], 8, "data kept");
+        KTEST_ASSERT(ev[1].timestamp >= ev[0].timestamp, "timestamps ordered");
+        KTEST_ASSERT_EQ(ev[0].cpu_id, cpu, "CPU recorded");
+    } else {
+        KTEST_ASSERT_EQ(got, 0, "compiled out");
+    }
+
+    return KTEST_PASS;
+}
+
+// Test: a full buffer drops and counts instead of overwriting
+static int test_trace_overflow(void) {
+    uint32_t cpu = this_cpu()->cpu_id;
+    struct trace_buffer* trace = &this_cpu()->trace;
+    struct trace_event ev;
+
+    trace_drain(cpu);
+    uint32_t lost = atomic_read(&trace->overflow);
+    for (uint32_t i = 0; i < TRACE_BUFFER_SIZE + 2; i++) {
+        trace_event(TRACE_CUSTOM, i, 0, 0, 0);
+    }
+
+    KTEST_ASSERT_EQ(atomic_read(&trace->overflow) - lost, 3, "excess events counted");
+    KTEST_ASSERT_EQ(trace_read(cpu, &ev, 1), 1, "oldest event readable");
+    KTEST_ASSERT_EQ(ev.data[0], 0, "oldest event kept");
+    trace_drain(cpu);
+
+    return KTEST_PASS;
+}
+
+// Test: online CPUs have separate line-aligned areas with trace storage;
+// trace_read() refuses the rest
+static int test_trace_areas(void) {
+    struct trace_event ev;
+
+    for (uint32_t id = 0; id < MAX_CPUS; id++) {
+        const struct per_cpu_data* cpu = cpu_data(id);
+        KTEST_ASSERT_NOT_NULL(cpu, "every slot has an area");
+        if (!cpu->online) {
+            KTEST_ASSERT_EQ(trace_read(id, &ev, 1), -EINVAL, "absent CPU not readable");
+            continue;
+        }
+        KTEST_ASSERT_EQ((uintptr_t)cpu & 63, 0, "area starts a cache line");
+        KTEST_ASSERT_NOT_NULL(cpu->trace.events, "trace storage allocated");
+        KTEST_ASSERT_EQ(cpu->cpu_id, id, "area belongs to its CPU");
+        for (uint32_t other = 0; other < id; other++) {
+            KTEST_ASSERT(cpu_data(other) != cpu, "areas are separate");
+        }
+    }
+
+    return KTEST_PASS;
+}
+
+// Test: header and records are encoded as documented in kernel/trace.h
+static int test_trace_export_encode(void) {
+    uint8_t out[TRACE_EXPORT_RECORD_MAX];
+
+    KTEST_ASSERT_EQ(trace_export_header(out, 2, 0x0102030405ull), TRACE_EXPORT_HEADER_SIZE,
+                    "header size");
+    KTEST_ASSERT(out[0] == 'A' && out[1] == 'K' && out[2] == 'T' && out[3] == 'R', "magic");
+    KTEST_ASSERT_EQ(out[4], TRACE_EXPORT_VERSION, "version");
+    KTEST_ASSERT_EQ(out[6], 2, "CPU count");
+    KTEST_ASSERT(out[8] == 0x05 && out[12] == 0x01 && out[15] == 0, "TSC Hz little-endian");
+
+    struct trace_event ev = {
+        .timestamp = 1000, .cpu_id = 1, .event_type = TRACE_CUSTOM,
+        .data = { 5, 300, 0, 0 },
+    };
+    uint64_t last = 0;
+    static const uint8_t first[] = { TRACE_CUSTOM | 2 << 5, 1, 0xE8, 0x07, 5, 0xAC, 0x02 };
+    KTEST_ASSERT_EQ(trace_export_encode(out, &ev, &last), sizeof(first), "record size");
+    KTEST_ASSERT(memcmp(out, first, sizeof(first)) == 0, "record bytes");
+    KTEST_ASSERT_EQ(last, 1000, "last stamp advanced");
+
+    ev.timestamp = 1001;
+    ev.data[0] = 0;
+    ev.data[1] = 0;
+    KTEST_ASSERT_EQ(trace_export_encode(out, &ev, &last), 3, "zero words dropped");
+    KTEST_ASSERT(out[0] == TRACE_CUSTOM && out[2] == 1, "delta from the previous stamp");
+
+    ev.timestamp = 900;
+    KTEST_ASSERT_EQ(trace_export_encode(out, &ev, &last), 3, "backwards stamp");
+    KTEST_ASSERT_EQ(out[2], 0, "never a wrapped delta");
+
+    ev.data[3] = ~0ull;
+    KTEST_ASSERT_EQ(trace_export_encode(out, &ev, &last), 3 + 3 + 10, "widest word");
+    KTEST_ASSERT(trace_export_encode(out, &ev, &last) <= TRACE_EXPORT_RECORD_MAX, "bounded");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("trace", trace_mask, test_trace_mask);
+KTEST_DEFINE("trace", trace_overflow, test_trace_overflow);
+KTEST_DEFINE("trace", trace_areas, test_trace_areas);
+KTEST_DEFINE("trace", trace_export_encode, test_trace_export_encode);
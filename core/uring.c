@@ -0,0 +1,187 @@
+/**
+ * Batched syscall submission and completion rings
+ *
+ * See include/kernel/uring.h. Both rings fit in one page, so the kernel
+ * reaches them through its own views (ring_view_kernel()) and never
+ * touches user mappings.
+ */
+
+#include <kernel/uring.h>
+#include <kernel/syscall.h>
+#include <kernel/task.h>
+#include <kernel/scheduler.h>
+#include <kernel/slab.h>
+#include <kernel/timer.h>
+#include <kernel/mmu.h>
+#include <kernel/hal.h>
+
+static uring_t* uring_table[URING_MAX_RINGS];
+static atomic_t uring_table_used;
+
+#define URING_OP(nr)        (1u << (nr))
+
+// Never in a batch: ones that would end or recurse into the consumer, and
+// IPC, whose words travel in registers a completion has no room for
+#define URING_OPS_REFUSED   (URING_OP(SYS_EXIT) | URING_OP(SYS_CALL) | \
+                             URING_OP(SYS_REPLY_WAIT) | URING_OP(SYS_URING_SETUP) | \
+                             URING_OP(SYS_URING_ENTER))
+
+// Not under SQPOLL: ones that act on the calling task, which is the poller
+#define URING_OPS_CALLER    (URING_OP(SYS_YIELD) | URING_OP(SYS_GETPID) | \
+                             URING_OP(SYS_SLEEP_US) | URING_OP(SYS_SET_QUANTUM) | \
+                             URING_OP(SYS_TASK_STATS))
+
+uring_t* uring_create(page_table_t* owner) {
+    uring_t* uring = kzalloc(sizeof(*uring));
+    if (!uring) {
+        return NULL;
+    }
+    uring->owner = owner;
+    uring->sq = ring_create(sizeof(struct uring_sqe), URING_SQ_ENTRIES);
+    uring->cq = ring_create(sizeof(struct uring_cqe), URING_CQ_ENTRIES);
+    if (!uring->sq || !uring->cq) {
+        uring_destroy(uring);
+        return NULL;
+    }
+    return uring;
+}
+
+void uring_destroy(uring_t* uring) {
+    if (uring->sq) {
+        ring_destroy(uring->sq);
+    }
+    if (uring->cq) {
+        ring_destroy(uring->cq);
+    }
+    kfree(uring);
+}
+
+// Whether another completion fits (we are the CQ's only producer)
+static inline bool cq_has_room(const struct ring_view* cq) {
+    uint32_t head = cq->hdr->head;
+    uint32_t next = head + 1 == cq->nr_records ? 0 : head + 1;
+    return head < cq->nr_records && next != cq->hdr->tail;
+}
+
+// Run one entry through the syscall table
+static int32_t uring_exec(const uring_t* uring, const struct uring_sqe* sqe) {
+    if (sqe->opcode < 32) {
+        uint32_t refused = URING_OPS_REFUSED | (uring->poller ? URING_OPS_CALLER : 0);
+        if (refused & URING_OP(sqe->opcode)) {
+            return -EINVAL;
+        }
+    }
+    return (int32_t)syscall_handler(sqe->opcode, sqe->args[0], sqe->args[1],
+                                    sqe->args[2], sqe->args[3], sqe->args[4], NULL);
+}
+
+int uring_submit(uring_t* uring, uint32_t max) {
+    if (!atomic_cas(&uring->busy, 0, 1)) {
+        return -EBUSY;
+    }
+
+    struct ring_view sq, cq;
+    ring_view_kernel(uring->sq, &sq);
+    ring_view_kernel(uring->cq, &cq);
+
+    uint32_t done = 0;
+    struct uring_sqe sqe;
+    while (done < max && cq_has_room(&cq) && ring_pop(&sq, &sqe)) {
+        struct uring_cqe cqe = { sqe.user_data, uring_exec(uring, &sqe) };
+        ring_push(&cq, &cqe);
+        done++;
+    }
+    if (done) {
+        uring->submitted += done;
+        uring->batches++;
+    }
+    barrier();
+    atomic_write(&uring->busy, 0);
+
+    if (done && ring_doorbell_needed(&cq)) {
+        ring_doorbell(uring->cq);
+    }
+    return (int)done;
+}
+
+// SQPOLL: drain while busy, poll a little when idle, then sleep on the SQ.
+// Runs in the owner's address space until uring_release_owner() stops it.
+static void uring_poll_entry(void* arg) {
+    uring_t* uring = (uring_t*)arg;
+    uint64_t idle_since = timer_read_us();
+
+    while (!atomic_read(&uring->poller_stop)) {
+        if (uring_submit(uring, URING_SQ_ENTRIES) > 0) {
+            idle_since = timer_read_us();
+        } else if (timer_read_us() - idle_since < URING_POLL_IDLE_US) {
+            task_yield();
+        } else {
+            ring_wait(uring->sq, 0);
+            idle_since = timer_read_us();
+        }
+    }
+
+    // Back to the kernel's address space: the owner's goes away after
+    // this, and task_destroy() must not take it for ours
+    page_table_t* kernel_as = mmu_get_kernel_address_space();
+    uint32_t flags = hal->irq_disable();
+    mmu_switch_address_space(kernel_as);
+    task_current()->address_space = kernel_as;
+    hal->irq_restore(flags);
+
+    atomic_write(&uring->poller_done, 1);
+    task_exit(0);
+}
+
+int uring_start_poller(uring_t* uring) {
+    task_t* poller = task_create_kernel_thread("uring_poll", uring_poll_entry, uring,
+                                               SCHED_DEFAULT_PRIORITY, 4096, 0);
+    if (!poller) {
+        return -ENOMEM;
+    }
+    // Pointer arguments and futex keys resolve in the owner's memory
+    poller->address_space = uring->owner;
+    uring->poller = poller;
+    scheduler_enqueue(poller);
+    return 0;
+}
+
+void uring_release_owner(page_table_t* owner) {
+    uint32_t used = MIN(atomic_read(&uring_table_used), URING_MAX_RINGS);
+
+    for (uint32_t i = 0; i < used; i++) {
+        uring_t* uring = uring_table[i];
+        if (!uring || uring->owner != owner) {
+            continue;
+        }
+        if (uring->poller) {
+            atomic_write(&uring->poller_stop, 1);
+            // Until it sees the flag: a doorbell can miss a poller that
+            // is just about to sleep
+            while (!atomic_read(&uring->poller_done)) {
+                ring_doorbell(uring->sq);
+                task_sleep_us(URING_POLL_IDLE_US);
+            }
+            uring->poller = NULL;
+        }
+        uring->owner = NULL;
+    }
+}
+
+int uring_install(uring_t* uring) {
+    uint32_t index = atomic_inc(&uring_table_used);
+    if (index >= URING_MAX_RINGS) {
+        atomic_dec(&uring_table_used);
+        return -ENOMEM;
+    }
+    uring_table[index] = uring;
+    return (int)index + 1;
+}
+
+uring_t* uring_lookup(int id, page_table_t* as) {
+    if (id <= 0 || id > URING_MAX_RINGS) {
+        return NULL;
+    }
+    uring_t* uring = uring_table[id - 1];
+    return uring && uring->owner == as ? uring : NULL;
+}
@@ -0,0 +1,109 @@
+/**
+ * Unit tests for batched syscall submission
+ *
+ * Tests run from the bootstrap context and only submit syscalls that
+ * return without blocking. Both rings are driven through kernel views, as
+ * a user task would through its mappings.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/uring.h>
+#include <kernel/syscall.h>
+#include <kernel/task.h>
+
+static bool queue(struct ring_view* sq, uint32_t opcode, uint32_t user_data, int32_t arg0) {
+    struct uring_sqe sqe = { opcode, user_data, { arg0, 0, 0, 0, 0 }, 0 };
+    return ring_push(sq, &sqe);
+}
+
+// Test: a batch runs in order through the syscall table, bounded by max
+static int test_uring_batch(void) {
+    uring_t* uring = uring_create(task_current()->address_space);
+    KTEST_ASSERT_NOT_NULL(uring, "rings created");
+
+    struct ring_view sq, cq;
+    ring_view_kernel(uring->sq, &sq);
+    ring_view_kernel(uring->cq, &cq);
+
+    bool queued = queue(&sq, SYS_GETPID, 1, 0) &&
+                  queue(&sq, 999, 2, 0) &&
+                  queue(&sq, SYS_EXIT, 3, 0) &&
+                  queue(&sq, SYS_SET_QUANTUM, 4, -1) &&
+                  queue(&sq, SYS_GETPID, 5, 0);
+
+    int first = uring_submit(uring, 4);
+    atomic_write(&uring->busy, 1);
+    int busy = uring_submit(uring, 4);
+    atomic_write(&uring->busy, 0);
+    int second = uring_submit(uring, 4);
+    int none = uring_submit(uring, 4);
+
+    struct uring_cqe cqe[5];
+    bool completed = true;
+    for (uint32_t i = 0; i < 5; i++) {
+        completed = completed && ring_pop(&cq, &cqe[i]);
+    }
+    bool drained = !ring_pop(&cq, &cqe[0]);
+    uint64_t submitted = uring->submitted;
+    uint32_t pid = task_current()->task_id;
+    uring_destroy(uring);
+
+    KTEST_ASSERT(queued, "five entries queued");
+    KTEST_ASSERT_EQ(first, 4, "first batch capped at max");
+    KTEST_ASSERT_EQ(busy, -EBUSY, "one SQ consumer at a time");
+    KTEST_ASSERT_EQ(second, 1, "rest in the next batch");
+    KTEST_ASSERT_EQ(none, 0, "empty SQ runs nothing");
+    KTEST_ASSERT(completed, "one completion per entry");
+    KTEST_ASSERT(drained, "no extra completions");
+    KTEST_ASSERT_EQ(submitted, 5, "entries counted");
+
+    KTEST_ASSERT_EQ(cqe[0].user_data, 1, "completions in order");
+    KTEST_ASSERT_EQ(cqe[0].result, (int32_t)pid, "getpid through the table");
+    KTEST_ASSERT_EQ(cqe[1].result, -ENOSYS, "unknown syscall");
+    KTEST_ASSERT_EQ(cqe[2].result, -EINVAL, "exit refused in a batch");
+    KTEST_ASSERT_EQ(cqe[3].result, -EINVAL, "syscall errors passed through");
+    KTEST_ASSERT_EQ(cqe[4].user_data, 5, "last completion tagged");
+
+    return KTEST_PASS;
+}
+
+// Test: IPC never runs in a batch, caller-identity syscalls not under SQPOLL
+static int test_uring_refused(void) {
+    uring_t* uring = uring_create(task_current()->address_space);
+    KTEST_ASSERT_NOT_NULL(uring, "rings created");
+
+    struct ring_view sq, cq;
+    ring_view_kernel(uring->sq, &sq);
+    ring_view_kernel(uring->cq, &cq);
+
+    bool queued = queue(&sq, SYS_CALL, 1, 1) && queue(&sq, SYS_GETPID, 2, 0);
+    int direct = uring_submit(uring, 2);
+
+    // As the poller would see them (no thread is started)
+    bool requeued = queue(&sq, SYS_GETPID, 3, 0) && queue(&sq, SYS_SLEEP_US, 4, 0);
+    uring->poller = task_current();
+    int polled = uring_submit(uring, 2);
+    uring->poller = NULL;
+
+    struct uring_cqe cqe[4];
+    bool completed = true;
+    for (uint32_t i = 0; i < 4; i++) {
+        completed = completed && ring_pop(&cq, &cqe[i]);
+    }
+    uint32_t pid = task_current()->task_id;
+    uring_destroy(uring);
+
+    KTEST_ASSERT(queued && requeued, "entries queued");
+    KTEST_ASSERT_EQ(direct, 2, "first batch ran");
+    KTEST_ASSERT_EQ(polled, 2, "second batch ran");
+    KTEST_ASSERT(completed, "one completion per entry");
+    KTEST_ASSERT_EQ(cqe[0].result, -EINVAL, "IPC call refused");
+    KTEST_ASSERT_EQ(cqe[1].result, (int32_t)pid, "getpid for the caller");
+    KTEST_ASSERT_EQ(cqe[2].result, -EINVAL, "getpid refused under SQPOLL");
+    KTEST_ASSERT_EQ(cqe[3].result, -EINVAL, "sleep refused under SQPOLL");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("uring", uring_batch, test_uring_batch);
+KTEST_DEFINE("uring", uring_refused, test_uring_refused);
@@ -9,6 +9,8 @@
 #include <kernel/mmu.h>
 #include <kernel/pmm.h>
 #include <kernel/scheduler.h>
+#include <kernel/vdso.h>
+#include <kernel/elf.h>
 #include <drivers/vga.h>
 #include <lib/string.h>
 
@@ -16,10 +18,74 @@
 extern uint8_t user_test_start[];
 extern uint8_t user_test_end[];
 
+/**
+ * Reserve user stack and heap; frames are committed on first touch
+ *
+ * @return 0, or the first mmu_reserve_region() error (nothing reserved)
+ */
+static int user_reserve_stack_heap(page_table_t* as) {
+    uintptr_t user_stack_base = USER_STACK_TOP - USER_STACK_SIZE;
+    kprintf("[USER] Reserving user stack at 0x%08lx-0x%08lx (demand-paged)\n",
+            (unsigned long)user_stack_base, (unsigned long)USER_STACK_TOP);
+
+    int rc = mmu_reserve_region(as, user_stack_base, USER_STACK_SIZE, MMU_USER | MMU_WRITABLE);
+    if (rc < 0) {
+        kprintf("[USER] ERROR: Failed to reserve user stack\n");
+        return rc;
+    }
+
+    rc = mmu_reserve_region(as, USER_HEAP_BASE, USER_HEAP_SIZE, MMU_USER | MMU_WRITABLE);
+    if (rc < 0) {
+        kprintf("[USER] ERROR: Failed to reserve user heap\n");
+        mmu_release_region(as, user_stack_base);
+        return rc;
+    }
+    return 0;
+}
+
+/**
+ * Initialize CPU context for ring 3, starting at `entry` on an empty stack
+ */
+static void user_context_init(task_t* task, uintptr_t entry) {
+    memset(&task->context, 0, sizeof(task->context));
+
+    // Set ring 3 segments
+    task->context.cs = USER_CS_SELECTOR;  // 0x1B (GDT entry 3, RPL=3)
+    task->context.ss = USER_DS_SELECTOR;  // 0x23 (GDT entry 4, RPL=3)
+    task->context.ds = USER_DS_SELECTOR;
+    task->context.es = USER_DS_SELECTOR;
+    task->context.fs = USER_DS_SELECTOR;
+    task->context.gs = USER_DS_SELECTOR;
+
+    // Set entry point and stack
+    task->context.eip = entry;
+    task->context.esp = USER_STACK_TOP;
+    task->context.ebp = USER_STACK_TOP;
+
+    // Set EFLAGS with IF=1 (interrupts enabled)
+    task->context.eflags = USER_EFLAGS;
+
+    // Note: Other registers (eax, ebx, etc.) aren't in cpu_context_t
+    // They will be 0 after the memset above
+
+    kprintf("[USER] Task '%s' initialized:\n", task->name);
+    kprintf("[USER]   CS=0x%04lx SS=0x%04lx DS=0x%04lx\n",
+            (unsigned long)task->context.cs,
+            (unsigned long)task->context.ss,
+            (unsigned long)task->context.ds);
+    kprintf("[USER]   EIP=0x%08lx ESP=0x%08lx EFLAGS=0x%08lx\n",
+            (unsigned long)task->context.eip,
+            (unsigned long)task->context.esp,
+            (unsigned long)task->context.eflags);
+    kprintf("[USER]   Kernel stack: %p (size=%lu)\n",
+            task->kernel_stack, (unsigned long)task->kernel_stack_size);
+}
+
 /**
  * Create a userspace task (ring 3)
  *
- * Allocates and maps user code and stack pages with USER flag.
+ * Allocates and maps the user code page with USER flag; stack and heap
+ * are reserved as demand-paged regions and cost nothing until touched.
  * Initializes task with ring 3 segments and privilege level.
  *
  * @param name        Task name
@@ -48,6 +114,7 @@ task_t* task_create_user(const char* name, void* entry_point, size_t code_size)
     strlcpy(task->name, name, sizeof(task->name));
     task->state = TASK_STATE_READY;
     task->priority = SCHED_DEFAULT_PRIORITY;
+    task->base_priority = SCHED_DEFAULT_PRIORITY;
 
     // Allocate user code page
     phys_addr_t code_phys = pmm_alloc_page();
@@ -56,14 +123,6 @@ task_t* task_create_user(const char* name, void* entry_point, size_t code_size)
         return NULL;
     }
 
-    // Allocate user stack page
-    phys_addr_t stack_phys = pmm_alloc_page();
-    if (!stack_phys) {
-        kprintf("[USER] ERROR: Failed to allocate stack page\n");
-        pmm_free_page(code_phys);
-        return NULL;
-    }
-
     // For now, use kernel address space with user mappings
     // TODO Phase 3.4: Create separate address space per task
     task->address_space = mmu_get_kernel_address_space();
@@ -79,7 +138,6 @@ task_t* task_create_user(const char* name, void* entry_point, size_t code_size)
     if (!code_virt) {
         kprintf("[USER] ERROR: Failed to map user code page\n");
         pmm_free_page(code_phys);
-        pmm_free_page(stack_phys);
         return NULL;
     }
 
@@ -87,20 +145,14 @@ task_t* task_create_user(const char* name, void* entry_point, size_t code_size)
     // Since we're still in kernel address space, we can access it directly
     memcpy((void*)USER_CODE_BASE, entry_point, code_size);
 
-    // Map user stack with USER|PRESENT|WRITABLE
-    uintptr_t user_stack_base = USER_STACK_TOP - USER_STACK_SIZE;
-    kprintf("[USER] Mapping user stack at 0x%08lx-0x%08lx (phys=0x%08x)\n",
-            (unsigned long)user_stack_base, (unsigned long)USER_STACK_TOP, (unsigned int)stack_phys);
-
-    void* stack_virt = mmu_map_page(task->address_space,
-                                     stack_phys,
-                                     user_stack_base,
-                                     MMU_PRESENT | MMU_USER | MMU_WRITABLE);
-    if (!stack_virt) {
-        kprintf("[USER] ERROR: Failed to map user stack page\n");
+    // Kernel data page, already there while tasks share the kernel's
+    if (vdso_map(task->address_space) < 0) {
+        kprintf("[USER] WARNING: No kernel data page for '%s'\n", name);
+    }
+
+    if (user_reserve_stack_heap(task->address_space) < 0) {
         mmu_unmap_page(task->address_space, USER_CODE_BASE);
         pmm_free_page(code_phys);
-        pmm_free_page(stack_phys);
         return NULL;
     }
 
@@ -109,46 +161,69 @@ task_t* task_create_user(const char* name, void* entry_point, size_t code_size)
     task->kernel_stack = (void*)pmm_alloc_page();
     if (!task->kernel_stack) {
         kprintf("[USER] ERROR: Failed to allocate kernel stack\n");
+        mmu_release_region(task->address_space, USER_HEAP_BASE);
+        mmu_release_region(task->address_space, USER_STACK_TOP - USER_STACK_SIZE);
         mmu_unmap_page(task->address_space, USER_CODE_BASE);
-        mmu_unmap_page(task->address_space, user_stack_base);
         pmm_free_page(code_phys);
-        pmm_free_page(stack_phys);
         return NULL;
     }
 
-    // Initialize CPU context for ring 3
-    memset(&task->context, 0, sizeof(task->context));
+    user_context_init(task, USER_CODE_BASE);
+    return task;
+}
 
-    // Set ring 3 segments
-    task->context.cs = USER_CS_SELECTOR;  // 0x1B (GDT entry 3, RPL=3)
-    task->context.ss = USER_DS_SELECTOR;  // 0x23 (GDT entry 4, RPL=3)
-    task->context.ds = USER_DS_SELECTOR;
-    task->context.es = USER_DS_SELECTOR;
-    task->context.fs = USER_DS_SELECTOR;
-    task->context.gs = USER_DS_SELECTOR;
+/**
+ * Create a userspace task from an ELF32 executable
+ *
+ * The image is mapped, not copied (elf_load()); the task pays for the
+ * pages it writes and for its page tables only.
+ */
+task_t* task_create_user_elf(const char* name, phys_addr_t image, size_t size) {
+    kprintf("[USER] Creating userspace task '%s' from ELF image at 0x%08x\n",
+            name, (unsigned int)image);
 
-    // Set entry point and stack
-    task->context.eip = USER_CODE_BASE;
-    task->context.esp = USER_STACK_TOP;
-    task->context.ebp = USER_STACK_TOP;
+    task_t* task = task_alloc();
+    if (!task) {
+        kprintf("[USER] ERROR: Failed to allocate task structure\n");
+        return NULL;
+    }
 
-    // Set EFLAGS with IF=1 (interrupts enabled)
-    task->context.eflags = USER_EFLAGS;
+    strlcpy(task->name, name, sizeof(task->name));
+    task->state = TASK_STATE_READY;
+    task->priority = SCHED_DEFAULT_PRIORITY;
+    task->base_priority = SCHED_DEFAULT_PRIORITY;
 
-    // Note: Other registers (eax, ebx, etc.) aren't in cpu_context_t
-    // They will be 0 after the memset above
+    // Own address space: the kernel's mappings plus this program's
+    page_table_t* as = mmu_create_user_address_space();
+    if (!as) {
+        kprintf("[USER] ERROR: Failed to create address space\n");
+        task_destroy(task);
+        return NULL;
+    }
 
-    kprintf("[USER] Task '%s' initialized:\n", name);
-    kprintf("[USER]   CS=0x%04lx SS=0x%04lx DS=0x%04lx\n",
-            (unsigned long)task->context.cs,
-            (unsigned long)task->context.ss,
-            (unsigned long)task->context.ds);
-    kprintf("[USER]   EIP=0x%08lx ESP=0x%08lx EFLAGS=0x%08lx\n",
-            (unsigned long)task->context.eip,
-            (unsigned long)task->context.esp,
-            (unsigned long)task->context.eflags);
-    kprintf("[USER]   Kernel stack: %p (size=%lu)\n",
-            task->kernel_stack, (unsigned long)task->kernel_stack_size);
+    uintptr_t entry;
+    if (elf_load(as, image, size, &entry) < 0 || user_reserve_stack_heap(as) < 0) {
+        kprintf("[USER] ERROR: Failed to load '%s'\n", name);
+        mmu_destroy_address_space(as);
+        task_destroy(task);
+        return NULL;
+    }
+    if (vdso_map(as) < 0) {
+        kprintf("[USER] WARNING: No kernel data page for '%s'\n", name);
+    }
+
+    // Allocate kernel stack for syscall entry
+    task->kernel_stack_size = 4096;
+    task->kernel_stack = (void*)pmm_alloc_page();
+    if (!task->kernel_stack) {
+        kprintf("[USER] ERROR: Failed to allocate kernel stack\n");
+        mmu_destroy_address_space(as);
+        task_destroy(task);
+        return NULL;
+    }
 
+    // From here on the address space dies with the task (task_destroy())
+    task->address_space = as;
+    user_context_init(task, entry);
     return task;
 }
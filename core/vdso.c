@@ -0,0 +1,72 @@
+/**
+ * Kernel data page
+ *
+ * Allocation, mapping and the clock writer (see include/kernel/vdso.h).
+ */
+
+#include <kernel/vdso.h>
+#include <kernel/user.h>
+#include <kernel/pmm.h>
+#include <kernel/hal.h>
+#include <kernel/timer.h>
+#include <drivers/vga.h>
+
+_Static_assert(sizeof(struct vdso_data) <= PAGE_SIZE, "vdso_data must fit one page");
+
+struct vdso_data* vdso_data_page;
+
+int vdso_init(void) {
+    phys_addr_t frame = pmm_alloc_zeroed_page();
+    if (!frame) {
+        return -ENOMEM;
+    }
+
+    struct vdso_data* data = (struct vdso_data*)(uintptr_t)frame;
+    data->clock.version = VDSO_VERSION;
+    data->clock.nr_cpus = hal->smp_num_cpus();
+    if (data->clock.nr_cpus == 0) {
+        data->clock.nr_cpus = 1;
+    }
+    if (hal->cpu_features() & HAL_CPU_FEAT_RDTSCP) {
+        data->clock.features |= VDSO_FEAT_RDTSCP;
+    }
+
+    // Same base as timer_read_us(): TSC zero is time zero
+    vdso_data_page = data;
+    vdso_update_clock(timer_get_tsc_freq(), 0, 0);
+
+    int rc = vdso_map(mmu_get_kernel_address_space());
+    if (rc < 0) {
+        return rc;
+    }
+
+    kprintf("[VDSO] Data page at 0x%08x, %u CPU(s)%s\n", USER_VDSO_BASE,
+            (unsigned int)data->clock.nr_cpus,
+            (data->clock.features & VDSO_FEAT_RDTSCP) ? ", RDTSCP" : "");
+    return 0;
+}
+
+int vdso_map(page_table_t* as) {
+    if (!vdso_data_page) {
+        return -ENODEV;
+    }
+    // Read-only for user mode; the kernel writes through the identity map
+    if (!mmu_map_page(as, (phys_addr_t)(uintptr_t)vdso_data_page, USER_VDSO_BASE,
+                      MMU_PRESENT | MMU_USER)) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+void vdso_update_clock(uint64_t tsc_freq_hz, uint64_t base_tsc, uint64_t base_us) {
+    struct vdso_clock* clock = &vdso_data_page->clock;
+
+    clock->seq++;
+    wmb();  // Odd sequence before the fields
+    clock->tsc_freq_hz = tsc_freq_hz;
+    clock->tsc_per_us = tsc_freq_hz / 1000000ULL;
+    clock->base_tsc = base_tsc;
+    clock->base_us = base_us;
+    wmb();  // Fields before the even sequence
+    clock->seq++;
+}
@@ -0,0 +1,71 @@
+/**
+ * Unit tests for the kernel data page
+ *
+ * The page is mapped into the kernel address space too, so the user-side
+ * readers run here unchanged. Tests run before interrupts are enabled:
+ * nothing switches tasks while a CPU slot is borrowed.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+#include <kernel/timer.h>
+#include <user/vdso.h>
+
+// Test: the clock matches timer_read_us() and follows a new base
+static int test_vdso_clock(void) {
+    struct vdso_data* data = vdso_data_page;
+    KTEST_ASSERT_NOT_NULL(data, "data page set up");
+    KTEST_ASSERT(vdso_data() != data, "user mapping apart from the identity map");
+    KTEST_ASSERT_EQ(vdso_data()->clock.version, VDSO_VERSION, "same frame at USER_VDSO_BASE");
+    KTEST_ASSERT_EQ(vdso_tsc_freq_hz(), timer_get_tsc_freq(), "TSC frequency published");
+
+    uint64_t before = timer_read_us();
+    uint64_t now = vdso_time_us();
+    uint64_t after = timer_read_us();
+    KTEST_ASSERT(now >= before && now <= after, "same clock as timer_read_us()");
+
+    // A base one second ahead moves the reader with it
+    uint32_t seq = data->clock.seq;
+    uint64_t hz = data->clock.tsc_freq_hz;
+    uint64_t tsc = timer_read_tsc();
+    vdso_update_clock(hz, tsc, after + 1000000);
+    uint64_t shifted = vdso_time_us();
+    uint32_t seq_after = data->clock.seq;
+    vdso_update_clock(hz, 0, 0);
+
+    KTEST_ASSERT(shifted >= after + 1000000, "new base published");
+    KTEST_ASSERT_EQ(seq_after, seq + 2, "one even-to-even sequence step");
+    KTEST_ASSERT_EQ(data->clock.seq & 1, 0, "no update in progress");
+
+    return KTEST_PASS;
+}
+
+// Test: the CPU slot names the task published by the last switch
+static int test_vdso_identity(void) {
+    struct vdso_data* data = vdso_data_page;
+    uint32_t cpu = this_cpu()->cpu_id;
+    KTEST_ASSERT(cpu < VDSO_MAX_CPUS, "CPU has a slot");
+
+    int id = vdso_cpu_id();
+    KTEST_ASSERT(id == (int)cpu || id == -ENOSYS, "CPU ID from RDTSCP or the CPU count");
+    if (id < 0) {
+        return KTEST_PASS;  // Several CPUs without RDTSCP: syscall fallback
+    }
+
+    uint32_t saved = data->cpu[cpu].task_id;
+    uint32_t seq = data->cpu[cpu].seq;
+    vdso_switch(cpu, 4242);
+    int task_id = vdso_task_id();
+    uint32_t seq_after = data->cpu[cpu].seq;
+    vdso_switch(cpu, saved);
+
+    KTEST_ASSERT_EQ(task_id, 4242, "task ID read back");
+    KTEST_ASSERT_EQ(seq_after, seq + 2, "switch bumps the slot sequence twice");
+    KTEST_ASSERT_EQ(data->cpu[cpu].task_id, saved, "slot restored");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("vdso", vdso_clock, test_vdso_clock);
+KTEST_DEFINE("vdso", vdso_identity, test_vdso_identity);
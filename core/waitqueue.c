@@ -0,0 +1,179 @@
+/**
+ * Wait Queues
+ *
+ * Blocking and waking on top of the per-CPU run queues (see
+ * include/kernel/waitqueue.h).
+ *
+ * A waker may find its target still running on another CPU: the task has
+ * queued itself and dropped the lock but not yet switched away. The wake
+ * then enqueues it early; schedule() sees the task already on_rq and the
+ * on_cpu flag keeps other CPUs from stealing it until it is off the CPU.
+ */
+
+#include <kernel/waitqueue.h>
+#include <kernel/scheduler.h>
+#include <kernel/ktimer.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+
+// Timed wait: the timer plus what its callback needs (on the waiter's stack)
+struct wait_timeout {
+    struct ktimer timer;
+    task_t* task;
+    wait_queue_t* wq;
+};
+
+void wait_queue_init(wait_queue_t* wq) {
+    wq->head = NULL;
+    wq->tail = NULL;
+    wq->count = 0;
+    spin_lock_init(&wq->lock);
+}
+
+uint32_t wait_queue_lock(wait_queue_t* wq) {
+    return spin_lock_irqsave(&wq->lock);
+}
+
+void wait_queue_unlock(wait_queue_t* wq, uint32_t flags) {
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+// Append at the tail (wq locked)
+static void wq_link(wait_queue_t* wq, task_t* task) {
+    task->wait_queue = wq;
+    task->wait_next = NULL;
+    task->wait_prev = wq->tail;
+    if (wq->tail) {
+        wq->tail->wait_next = task;
+    } else {
+        wq->head = task;
+    }
+    wq->tail = task;
+    wq->count++;
+}
+
+// Remove from the queue (wq locked)
+static void wq_unlink(wait_queue_t* wq, task_t* task) {
+    if (task->wait_prev) {
+        task->wait_prev->wait_next = task->wait_next;
+    } else {
+        wq->head = task->wait_next;
+    }
+    if (task->wait_next) {
+        task->wait_next->wait_prev = task->wait_prev;
+    } else {
+        wq->tail = task->wait_prev;
+    }
+    task->wait_next = NULL;
+    task->wait_prev = NULL;
+    task->wait_queue = NULL;
+    wq->count--;
+}
+
+// Dequeue and make runnable (wq locked)
+static void wq_wake(wait_queue_t* wq, task_t* task, int result) {
+    wq_unlink(wq, task);
+    task->wait_result = result;
+    task->state = TASK_STATE_READY;
+    scheduler_enqueue(task);
+}
+
+static void wait_timeout_expired(struct ktimer* timer, void* arg) {
+    (void)arg;
+    struct wait_timeout* wt = (struct wait_timeout*)timer;
+
+    uint32_t flags = wait_queue_lock(wt->wq);
+    if (wt->task->wait_queue == wt->wq) {
+        wq_wake(wt->wq, wt->task, -ETIMEDOUT);
+    }
+    wait_queue_unlock(wt->wq, flags);
+}
+
+int wait_queue_block_locked(wait_queue_t* wq, uint32_t flags, uint64_t key,
+                            uint64_t timeout_us) {
+    struct per_cpu_data* cpu = this_cpu();
+    task_t* current = cpu->current_task;
+    if (!current || current == cpu->idle_task ||
+        current->state != TASK_STATE_RUNNING) {
+        wait_queue_unlock(wq, flags);
+        return -EPERM;
+    }
+
+    current->wait_key = key;
+    current->wait_result = 0;
+    current->state = TASK_STATE_BLOCKED;
+    wq_link(wq, current);
+
+    // Armed on this CPU with interrupts off: cannot fire before we block
+    struct wait_timeout timeout;
+    if (timeout_us > 0) {
+        ktimer_init(&timeout.timer, wait_timeout_expired, NULL);
+        timeout.task = current;
+        timeout.wq = wq;
+        ktimer_add(&timeout.timer, timeout_us);
+    }
+
+    // Drop the lock but keep interrupts off until we are switched out
+    spin_unlock(&wq->lock);
+    schedule();
+    hal->irq_restore(flags);
+
+    // The timeout lives on this stack: make sure it is dead before return
+    if (timeout_us > 0) {
+        ktimer_cancel_sync(&timeout.timer);
+    }
+
+    return current->wait_result;
+}
+
+int wait_queue_block(wait_queue_t* wq, uint64_t timeout_us) {
+    uint32_t flags = wait_queue_lock(wq);
+    return wait_queue_block_locked(wq, flags, 0, timeout_us);
+}
+
+bool wait_queue_wake_one(wait_queue_t* wq) {
+    uint32_t flags = wait_queue_lock(wq);
+    task_t* task = wq->head;
+    if (task) {
+        wq_wake(wq, task, 0);
+    }
+    wait_queue_unlock(wq, flags);
+    return task != NULL;
+}
+
+uint32_t wait_queue_wake_all(wait_queue_t* wq) {
+    uint32_t woken = 0;
+
+    uint32_t flags = wait_queue_lock(wq);
+    while (wq->head) {
+        wq_wake(wq, wq->head, 0);
+        woken++;
+    }
+    wait_queue_unlock(wq, flags);
+
+    return woken;
+}
+
+uint32_t wait_queue_wake_key(wait_queue_t* wq, uint64_t key, uint32_t max) {
+    uint32_t woken = 0;
+
+    uint32_t flags = wait_queue_lock(wq);
+    task_t* task = wq->head;
+    while (task && woken < max) {
+        task_t* next = task->wait_next;
+        if (task->wait_key == key) {
+            wq_wake(wq, task, 0);
+            woken++;
+        }
+        task = next;
+    }
+    wait_queue_unlock(wq, flags);
+
+    return woken;
+}
+
+void wait_queue_wake_task_locked(wait_queue_t* wq, task_t* task) {
+    if (task && task->wait_queue == wq) {
+        wq_wake(wq, task, 0);
+    }
+}
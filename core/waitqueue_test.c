@@ -0,0 +1,58 @@
+/**
+ * Unit tests for wait queues and futexes
+ *
+ * Tests run from the bootstrap context, which cannot block, so these
+ * cover the paths that return without sleeping. Futex words live in a
+ * user-accessible reserved region, committed by futex_wait() itself.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/waitqueue.h>
+#include <kernel/futex.h>
+#include <kernel/mmu.h>
+
+// Clear of the identity map, the user layout and mmu_test.c's region
+#define TEST_FUTEX_BASE 0x51000000u
+
+// Test: waking an empty queue is a no-op, blocking needs a real task
+static int test_waitqueue_empty(void) {
+    wait_queue_t wq;
+    wait_queue_init(&wq);
+
+    KTEST_ASSERT(!wait_queue_wake_one(&wq), "wake-one on empty queue");
+    KTEST_ASSERT_EQ(wait_queue_wake_all(&wq), 0, "wake-all on empty queue");
+    KTEST_ASSERT_EQ(wait_queue_wake_key(&wq, 1, 8), 0, "wake-key on empty queue");
+
+    KTEST_ASSERT_EQ(wait_queue_block(&wq, 0), -EPERM, "bootstrap cannot block");
+    KTEST_ASSERT_EQ(wq.count, 0, "nothing left queued");
+    KTEST_ASSERT_NULL(wq.head, "queue still empty");
+
+    return KTEST_PASS;
+}
+
+// Test: futex argument checks and the value-mismatch fast path
+static int test_futex_no_block(void) {
+    page_table_t* as = mmu_get_kernel_address_space();
+    KTEST_ASSERT_EQ(mmu_reserve_region(as, TEST_FUTEX_BASE, 2 * PAGE_SIZE,
+                                       MMU_WRITABLE | MMU_USER), 0, "region reserved");
+
+    uintptr_t word = TEST_FUTEX_BASE;
+    KTEST_ASSERT_EQ(futex_wait(word, 1, 0), -EAGAIN, "fresh word is 0, not 1");
+    KTEST_ASSERT_EQ(*(volatile uint32_t*)word, 0, "page committed by the wait");
+
+    *(volatile uint32_t*)word = 7;
+    KTEST_ASSERT_EQ(futex_wait(word, 0, 0), -EAGAIN, "changed word is not 0");
+    KTEST_ASSERT_EQ(futex_wake(word, 1), 0, "no sleepers to wake");
+
+    KTEST_ASSERT_EQ(futex_wait(word + 1, 7, 0), -EINVAL, "misaligned wait rejected");
+    KTEST_ASSERT_EQ(futex_wake(word + 2, 1), -EINVAL, "misaligned wake rejected");
+    KTEST_ASSERT_EQ(futex_wait(0, 0, 0), -EFAULT, "null address rejected");
+    KTEST_ASSERT_EQ(futex_wait(0xC0000000u, 0, 0), -EFAULT, "kernel address rejected");
+
+    KTEST_ASSERT_EQ(mmu_release_region(as, TEST_FUTEX_BASE), 0, "region released");
+    return KTEST_PASS;
+}
+
+// Register all tests
+KTEST_DEFINE("waitqueue", waitqueue_empty, test_waitqueue_empty);
+KTEST_DEFINE("waitqueue", futex_no_block, test_futex_no_block);
@@ -0,0 +1,210 @@
+/**
+ * Deferred work
+ *
+ * Per-CPU queues, the interrupt-exit drain and the worker threads (see
+ * include/kernel/work.h).
+ *
+ * head is a lock-free stack: producers push with a CAS, the owner takes
+ * the whole stack with one exchange and reverses it onto local. Only the
+ * owner touches local, with interrupts off; `draining` keeps a nested
+ * interrupt on the same CPU from running items while an outer drain is
+ * between two of them.
+ */
+
+#include <kernel/work.h>
+#include <kernel/percpu.h>
+#include <kernel/scheduler.h>
+#include <kernel/task.h>
+#include <kernel/waitqueue.h>
+#include <kernel/smp.h>
+#include <kernel/hal.h>
+#include <lib/printf.h>
+
+struct work_queue {
+    struct work_item* volatile head;    // Pushed, newest first (any CPU)
+    struct work_item* local;            // Taken off head, oldest first (owner)
+    bool              draining;         // Owner is between two items
+    atomic_t          queued;
+    atomic_t          kicks;
+    uint64_t          done;
+    uint64_t          worker_done;
+    wait_queue_t      wait;             // Worker sleeps here
+    task_t*           worker;
+} __attribute__((aligned(64)));
+
+static struct work_queue work_queues[MAX_CPUS];
+
+static inline bool queue_empty(const struct work_queue* q) {
+    return !q->head && !q->local;
+}
+
+// Wake the calling CPU's worker (nothing else will drain the queue)
+static void wake_worker(struct work_queue* q) {
+    if (q->worker) {
+        atomic_inc(&q->kicks);
+        wait_queue_wake_one(&q->wait);
+    }
+}
+
+bool schedule_work_on_cpu(uint32_t cpu_id, struct work_item* work) {
+    if (cpu_id >= MAX_CPUS || !per_cpu[cpu_id]->online) {
+        return false;
+    }
+    if (!__sync_bool_compare_and_swap(&work->pending, 0, 1)) {
+        return false;
+    }
+
+    struct work_queue* q = &work_queues[cpu_id];
+    struct work_item* old;
+    do {
+        old = q->head;
+        work->next = old;
+    } while (!__sync_bool_compare_and_swap(&q->head, old, work));
+    atomic_inc(&q->queued);
+
+    if (old) {
+        return true;  // Whoever made the queue non-empty has kicked it
+    }
+    uint32_t flags = hal->irq_disable();
+    if (cpu_id != hal->cpu_id()) {
+        atomic_inc(&q->kicks);
+        smp_send_work(cpu_id);
+    } else if (this_cpu()->irq_depth == 0) {
+        wake_worker(q);  // Task context: no interrupt exit is coming
+    }
+    hal->irq_restore(flags);
+    return true;
+}
+
+// Next item to run, oldest first (interrupts off, owner)
+static struct work_item* take_locked(struct work_queue* q) {
+    if (!q->local && q->head) {
+        struct work_item* list = __sync_lock_test_and_set(&q->head, NULL);
+        struct work_item* fifo = NULL;
+        while (list) {
+            struct work_item* next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+        q->local = fifo;
+    }
+
+    struct work_item* work = q->local;
+    if (work) {
+        q->local = work->next;
+    }
+    return work;
+}
+
+// Run up to `budget` items; true if some are left
+static bool drain(struct work_queue* q, uint32_t budget, bool worker) {
+    uint32_t flags = hal->irq_disable();
+    if (q->draining) {
+        hal->irq_restore(flags);
+        return !queue_empty(q);
+    }
+    q->draining = true;
+
+    for (uint32_t n = 0; n < budget; n++) {
+        struct work_item* work = take_locked(q);
+        if (!work) {
+            break;
+        }
+        work->next = NULL;
+        work->pending = 0;   // May be queued again from here on
+        barrier();
+        hal->irq_restore(flags);
+
+        work->func(work->data);
+
+        flags = hal->irq_disable();
+        q->done++;
+        q->worker_done += worker;
+    }
+
+    q->draining = false;
+    bool left = !queue_empty(q);
+    hal->irq_restore(flags);
+    return left;
+}
+
+bool process_pending_work(uint32_t budget) {
+    struct work_queue* q = &work_queues[hal->cpu_id()];
+    if (queue_empty(q)) {
+        return false;
+    }
+    return drain(q, budget, false);
+}
+
+void work_irq_exit(void) {
+    struct work_queue* q = &work_queues[hal->cpu_id()];
+    if (queue_empty(q) || q->draining) {
+        return;
+    }
+
+    // Bottom halves run with interrupts on so other devices are not held off
+    hal->irq_enable();
+    bool left = drain(q, WORK_IRQ_BUDGET, false);
+    hal->irq_disable();
+    if (left) {
+        wake_worker(q);
+    }
+}
+
+static void worker_main(void* arg) {
+    struct work_queue* q = arg;
+    for (;;) {
+        if (drain(q, WORK_WORKER_BUDGET, true)) {
+            task_yield();  // More left: let equal-priority tasks in between passes
+            continue;
+        }
+
+        uint32_t flags = wait_queue_lock(&q->wait);
+        while (queue_empty(q)) {
+            wait_queue_block_locked(&q->wait, flags, 0, 0);
+            flags = wait_queue_lock(&q->wait);
+        }
+        wait_queue_unlock(&q->wait, flags);
+    }
+}
+
+// SMP_IPI_WORK: the queue is drained on the way out, by work_irq_exit()
+static void work_ipi_handler(void) {
+    this_cpu()->ipis_received++;
+}
+
+int work_start(void) {
+    hal->irq_register(SMP_IPI_WORK, work_ipi_handler);
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        struct work_queue* q = &work_queues[cpu];
+        if (!per_cpu[cpu]->online || q->worker) {
+            continue;
+        }
+
+        char name[16];
+        ksnprintf(name, sizeof(name), "kworker/%u", (unsigned int)cpu);
+        task_t* worker = task_create_kernel_thread(name, worker_main, q,
+                                                   WORK_WORKER_PRIORITY, 4096, 0);
+        if (!worker) {
+            return -ENOMEM;
+        }
+        worker->cpu = cpu;
+        worker->pinned = true;
+        q->worker = worker;
+        scheduler_enqueue(worker);
+    }
+    return 0;
+}
+
+bool work_pending(uint32_t cpu_id) {
+    return cpu_id < MAX_CPUS && !queue_empty(&work_queues[cpu_id]);
+}
+
+void work_get_stats(uint32_t cpu_id, struct work_stats* stats) {
+    const struct work_queue* q = &work_queues[cpu_id];
+    stats->queued = atomic_read(&q->queued);
+    stats->kicks = atomic_read(&q->kicks);
+    stats->done = q->done;
+    stats->worker = q->worker_done;
+}
@@ -0,0 +1,100 @@
+/**
+ * Unit tests for deferred work
+ *
+ * Run on the boot CPU before the workers exist, so nothing drains the
+ * queue behind the test's back: items run only when the test calls
+ * process_pending_work().
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/work.h>
+#include <kernel/percpu.h>
+#include <kernel/hal.h>
+
+static uint32_t work_log[8];
+static uint32_t work_log_len;
+
+static void log_item(void* data) {
+    if (work_log_len < 8) {
+        work_log[work_log_len++] = (uint32_t)(uintptr_t)data;
+    }
+}
+
+static struct work_item requeue_item;
+static uint32_t requeue_left;
+
+static void requeue_fn(void* data) {
+    (void)data;
+    work_log_len++;
+    if (requeue_left > 0) {
+        requeue_left--;
+        schedule_work_on_cpu(this_cpu()->cpu_id, &requeue_item);
+    }
+}
+
+// Test: items run once each, oldest first
+static int test_work_fifo(void) {
+    uint32_t cpu = this_cpu()->cpu_id;
+    struct work_item items[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        work_init_item(&items[i], log_item, (void*)(uintptr_t)(i + 1));
+    }
+
+    process_pending_work(~0u);
+    work_log_len = 0;
+    KTEST_ASSERT(!work_pending(cpu), "queue starts empty");
+    KTEST_ASSERT(schedule_work_on_cpu(cpu, &items[0]), "queued");
+    KTEST_ASSERT(schedule_work_on_cpu(cpu, &items[1]), "queued");
+    KTEST_ASSERT(!schedule_work_on_cpu(cpu, &items[0]), "already pending");
+    KTEST_ASSERT(schedule_work_on_cpu(cpu, &items[2]), "queued");
+    KTEST_ASSERT(work_pending(cpu), "pending");
+
+    KTEST_ASSERT(!process_pending_work(~0u), "nothing left");
+    KTEST_ASSERT_EQ(work_log_len, 3, "each item ran once");
+    KTEST_ASSERT_EQ(work_log[0], 1, "oldest first");
+    KTEST_ASSERT_EQ(work_log[1], 2, "in order");
+    KTEST_ASSERT_EQ(work_log[2], 3, "newest last");
+    KTEST_ASSERT(!work_pending(cpu), "queue empty");
+
+    if (MAX_CPUS > 1 && !per_cpu[(cpu + 1) % MAX_CPUS]->online) {
+        KTEST_ASSERT(!schedule_work_on_cpu((cpu + 1) % MAX_CPUS, &items[0]),
+                     "offline CPU refused");
+    }
+    KTEST_ASSERT(!schedule_work_on_cpu(MAX_CPUS, &items[0]), "bad CPU refused");
+    KTEST_ASSERT_EQ(items[0].pending, 0, "refused item still free");
+
+    return KTEST_PASS;
+}
+
+// Test: the budget bounds a pass; an item may queue itself again
+static int test_work_budget(void) {
+    uint32_t cpu = this_cpu()->cpu_id;
+    struct work_item items[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        work_init_item(&items[i], log_item, (void*)(uintptr_t)(i + 1));
+        schedule_work_on_cpu(cpu, &items[i]);
+    }
+
+    work_log_len = 0;
+    KTEST_ASSERT(process_pending_work(3), "one item left over");
+    KTEST_ASSERT_EQ(work_log_len, 3, "budget respected");
+    KTEST_ASSERT(!process_pending_work(3), "rest drained");
+    KTEST_ASSERT_EQ(work_log[3], 4, "left-over item kept its place");
+
+    work_init_item(&requeue_item, requeue_fn, NULL);
+    requeue_left = 2;
+    work_log_len = 0;
+    schedule_work_on_cpu(cpu, &requeue_item);
+    KTEST_ASSERT(!process_pending_work(8), "re-queued runs in the same pass");
+    KTEST_ASSERT_EQ(work_log_len, 3, "ran once per queueing");
+    KTEST_ASSERT_EQ(requeue_item.pending, 0, "not pending after its last run");
+
+    struct work_stats stats;
+    work_get_stats(cpu, &stats);
+    KTEST_ASSERT(stats.done >= 10 && stats.queued >= 10, "counted");
+
+    return KTEST_PASS;
+}
+
+KTEST_DEFINE("work", work_fifo, test_work_fifo);
+KTEST_DEFINE("work", work_budget, test_work_budget);
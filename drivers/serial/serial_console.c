@@ -39,6 +39,22 @@ static struct console_backend serial_console = {
 	.enabled = false
 };
 
+/*
+ * Make the serial console interrupt-driven
+ */
+int serial_console_enable_irq(void)
+{
+	return serial_enable_irq(&com1, SERIAL_COM1_IRQ);
+}
+
+/*
+ * Port behind the serial console
+ */
+struct serial_port* serial_console_port(void)
+{
+	return &com1;
+}
+
 /*
  * Get serial console backend
  */
@@ -5,6 +5,7 @@
 
 #include <drivers/serial.h>
 #include <kernel/hal.h>
+#include <kernel/idt.h>
 
 /* External HAL pointer */
 extern struct hal_ops* hal;
@@ -12,7 +13,8 @@ extern struct hal_ops* hal;
 /* UART register offsets */
 #define UART_DATA         0  /* Data register (R/W) */
 #define UART_INT_ENABLE   1  /* Interrupt enable register */
-#define UART_FIFO_CTRL    2  /* FIFO control register */
+#define UART_INT_ID       2  /* Interrupt identification register (R) */
+#define UART_FIFO_CTRL    2  /* FIFO control register (W) */
 #define UART_LINE_CTRL    3  /* Line control register */
 #define UART_MODEM_CTRL   4  /* Modem control register */
 #define UART_LINE_STATUS  5  /* Line status register */
@@ -20,8 +22,26 @@ extern struct hal_ops* hal;
 
 /* Line status register bits */
 #define UART_LSR_DATA_READY    (1 << 0)  /* Data ready */
+#define UART_LSR_OVERRUN       (1 << 1)  /* Receiver overrun */
 #define UART_LSR_TRANSMIT_EMPTY (1 << 5) /* Transmit buffer empty */
 
+/* Interrupt enable register bits */
+#define UART_IER_RX            0x01      /* Received data available */
+#define UART_IER_THRE          0x02      /* Transmit holding register empty */
+#define UART_IER_LINE_STATUS   0x04      /* Receiver line status */
+
+/* Interrupt identification register values */
+#define UART_IIR_NONE          0x01      /* No interrupt pending */
+#define UART_IIR_ID_MASK       0x0E
+#define UART_IIR_MODEM_STATUS  0x00
+#define UART_IIR_THRE          0x02
+#define UART_IIR_RX            0x04
+#define UART_IIR_LINE_STATUS   0x06
+#define UART_IIR_RX_TIMEOUT    0x0C
+#define UART_IIR_FIFO_ENABLED  0xC0      /* Both set: working 16550A FIFO */
+
+#define UART_FIFO_SIZE         16        /* 16550A transmit FIFO depth */
+
 /* Line control register bits */
 #define UART_LCR_DLAB          (1 << 7)  /* Divisor latch access bit */
 #define UART_LCR_8BITS         0x03      /* 8 data bits */
@@ -30,6 +50,7 @@ extern struct hal_ops* hal;
 #define UART_FCR_ENABLE        0x01      /* Enable FIFO */
 #define UART_FCR_CLEAR_RX      0x02      /* Clear receive FIFO */
 #define UART_FCR_CLEAR_TX      0x04      /* Clear transmit FIFO */
+#define UART_FCR_TRIGGER_8     0x80      /* RX interrupt at 8 bytes */
 
 /* Modem control register bits */
 #define UART_MCR_DTR           0x01      /* Data terminal ready */
@@ -42,6 +63,18 @@ extern struct hal_ops* hal;
 #define UART_BAUD_38400        3
 #define UART_BAUD_9600         12
 
+/* PIC lines are remapped to vectors 32-47 (arch/x86/idt.c) */
+#define UART_IRQ_VECTOR_BASE   32
+
+/* EFLAGS.IF in the state returned by hal->irq_disable() */
+#define UART_IRQ_FLAGS_IF      0x200
+
+#define TX_MASK (SERIAL_TX_BUF_SIZE - 1)
+#define RX_MASK (SERIAL_RX_BUF_SIZE - 1)
+
+/* Ports driven by interrupts, by IRQ line */
+static struct serial_port* irq_ports[16];
+
 /*
  * Initialize serial port with default configuration
  * Default: 115200 baud, 8 data bits, 1 stop bit, no parity
@@ -105,6 +138,62 @@ bool serial_transmit_empty(struct serial_port* serial)
 	return (hal->io_inb(serial->port + UART_LINE_STATUS) & UART_LSR_TRANSMIT_EMPTY) != 0;
 }
 
+/* ========== Interrupt-driven TX ========== */
+
+/*
+ * Load up to one FIFO's worth of queued bytes (lock held, THR empty)
+ */
+static void tx_fill_locked(struct serial_port* serial)
+{
+	uint32_t n = 0;
+
+	while (n < serial->fifo_size && serial->tx_tail != serial->tx_head) {
+		hal->io_outb(serial->port + UART_DATA, serial->tx_buf[serial->tx_tail & TX_MASK]);
+		serial->tx_tail++;
+		n++;
+	}
+	serial->tx_busy = n > 0;
+}
+
+/*
+ * Poll the transmitter until at most `keep` bytes are queued (lock held)
+ */
+static void tx_drain_locked(struct serial_port* serial, uint32_t keep)
+{
+	while (serial->tx_head - serial->tx_tail > keep) {
+		if (serial_transmit_empty(serial)) {
+			tx_fill_locked(serial);
+		} else {
+			cpu_relax();
+		}
+	}
+}
+
+static void tx_queue_locked(struct serial_port* serial, char c)
+{
+	if (serial->tx_head - serial->tx_tail == SERIAL_TX_BUF_SIZE) {
+		/* Full: make room for a burst rather than drop console output */
+		serial->tx_stalls++;
+		tx_drain_locked(serial, SERIAL_TX_BUF_SIZE - SERIAL_TX_BUF_SIZE / 4);
+	}
+	serial->tx_buf[serial->tx_head & TX_MASK] = c;
+	serial->tx_head++;
+}
+
+/*
+ * Start the transmitter if it is idle; push everything out by polling if
+ * the caller runs with interrupts off (lock held)
+ */
+static void tx_kick_locked(struct serial_port* serial, uint32_t flags)
+{
+	if (!serial->tx_busy && serial_transmit_empty(serial)) {
+		tx_fill_locked(serial);
+	}
+	if (!(flags & UART_IRQ_FLAGS_IF)) {
+		tx_drain_locked(serial, 0);
+	}
+}
+
 /*
  * Write a single character to serial port
  */
@@ -114,6 +203,14 @@ void serial_putchar(struct serial_port* serial, char c)
 		return;
 	}
 
+	if (serial->irq_mode) {
+		uint32_t flags = spin_lock_irqsave(&serial->lock);
+		tx_queue_locked(serial, c);
+		tx_kick_locked(serial, flags);
+		spin_unlock_irqrestore(&serial->lock, flags);
+		return;
+	}
+
 	/* Wait for transmit buffer to be empty */
 	while (!serial_transmit_empty(serial)) {
 		/* Busy wait */
@@ -132,6 +229,19 @@ void serial_write(struct serial_port* serial, const char* str, size_t len)
 		return;
 	}
 
+	if (serial->irq_mode) {
+		uint32_t flags = spin_lock_irqsave(&serial->lock);
+		for (size_t i = 0; i < len; i++) {
+			if (str[i] == '\n') {
+				tx_queue_locked(serial, '\r');
+			}
+			tx_queue_locked(serial, str[i]);
+		}
+		tx_kick_locked(serial, flags);
+		spin_unlock_irqrestore(&serial->lock, flags);
+		return;
+	}
+
 	for (size_t i = 0; i < len; i++) {
 		/* Convert LF to CRLF for proper terminal display */
 		if (str[i] == '\n') {
@@ -141,6 +251,32 @@ void serial_write(struct serial_port* serial, const char* str, size_t len)
 	}
 }
 
+/*
+ * Write bytes without LF translation (binary data)
+ */
+void serial_write_raw(struct serial_port* serial, const void* buf, size_t len)
+{
+	const char* bytes = buf;
+
+	if (!serial || !bytes) {
+		return;
+	}
+
+	if (serial->irq_mode) {
+		uint32_t flags = spin_lock_irqsave(&serial->lock);
+		for (size_t i = 0; i < len; i++) {
+			tx_queue_locked(serial, bytes[i]);
+		}
+		tx_kick_locked(serial, flags);
+		spin_unlock_irqrestore(&serial->lock, flags);
+		return;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		serial_putchar(serial, bytes[i]);
+	}
+}
+
 /*
  * Check if data is available to read
  */
@@ -162,9 +298,163 @@ int serial_getchar(struct serial_port* serial)
 		return -1;
 	}
 
+	if (serial->irq_mode) {
+		int c = -1;
+		uint32_t flags = spin_lock_irqsave(&serial->lock);
+		if (serial->rx_tail != serial->rx_head) {
+			c = (uint8_t)serial->rx_buf[serial->rx_tail & RX_MASK];
+			serial->rx_tail++;
+		}
+		spin_unlock_irqrestore(&serial->lock, flags);
+		return c;
+	}
+
 	if (!serial_data_available(serial)) {
 		return -1;
 	}
 
 	return hal->io_inb(serial->port + UART_DATA);
 }
+
+/*
+ * Read a character, blocking until the RX interrupt delivers one
+ *
+ * Lock order: rx_wait, then the port lock. The interrupt handler queues
+ * bytes under the port lock and wakes after dropping it, so a reader that
+ * found rx_buf empty under the rx_wait lock is always queued in time.
+ */
+int serial_read_wait(struct serial_port* serial, uint64_t timeout_us)
+{
+	if (!serial || !serial->irq_mode) {
+		return -ENODEV;
+	}
+
+	uint32_t flags = wait_queue_lock(&serial->rx_wait);
+	for (;;) {
+		int c = serial_getchar(serial);
+		if (c >= 0) {
+			wait_queue_unlock(&serial->rx_wait, flags);
+			return c;
+		}
+		int rc = wait_queue_block_locked(&serial->rx_wait, flags, 0, timeout_us);
+		if (rc < 0) {
+			return rc;
+		}
+		flags = wait_queue_lock(&serial->rx_wait);
+	}
+}
+
+/* ========== Interrupt handling ========== */
+
+static void serial_handle_irq(struct serial_port* serial)
+{
+	if (!serial) {
+		return;
+	}
+
+	bool received = false;
+
+	spin_lock(&serial->lock);
+	for (;;) {
+		uint8_t iir = hal->io_inb(serial->port + UART_INT_ID);
+		if (iir & UART_IIR_NONE) {
+			break;
+		}
+
+		switch (iir & UART_IIR_ID_MASK) {
+		case UART_IIR_RX:
+		case UART_IIR_RX_TIMEOUT:
+			serial->rx_irqs++;
+			while (serial_data_available(serial)) {
+				char c = (char)hal->io_inb(serial->port + UART_DATA);
+				if (serial->rx_head - serial->rx_tail == SERIAL_RX_BUF_SIZE) {
+					serial->rx_dropped++;
+					continue;
+				}
+				serial->rx_buf[serial->rx_head & RX_MASK] = c;
+				serial->rx_head++;
+				received = true;
+			}
+			break;
+
+		case UART_IIR_THRE:
+			serial->tx_irqs++;
+			tx_fill_locked(serial);
+			break;
+
+		case UART_IIR_LINE_STATUS:
+			if (hal->io_inb(serial->port + UART_LINE_STATUS) & UART_LSR_OVERRUN) {
+				serial->rx_dropped++;
+			}
+			break;
+
+		default:
+			hal->io_inb(serial->port + UART_MODEM_STATUS);
+			break;
+		}
+	}
+	spin_unlock(&serial->lock);
+
+	if (received) {
+		wait_queue_wake_all(&serial->rx_wait);
+	}
+}
+
+static void serial_irq3_handler(void)
+{
+	serial_handle_irq(irq_ports[3]);
+}
+
+static void serial_irq4_handler(void)
+{
+	serial_handle_irq(irq_ports[4]);
+}
+
+/*
+ * Switch a polled port to interrupt-driven I/O
+ */
+int serial_enable_irq(struct serial_port* serial, uint8_t irq)
+{
+	void (*handler)(void);
+
+	if (!serial || !serial->initialized || serial->irq_mode) {
+		return -1;
+	}
+	if (irq == SERIAL_COM1_IRQ) {
+		handler = serial_irq4_handler;
+	} else if (irq == SERIAL_COM2_IRQ) {
+		handler = serial_irq3_handler;
+	} else {
+		return -1;
+	}
+	if (irq_ports[irq]) {
+		return -1;
+	}
+
+	/* Let polled output finish, then set the RX trigger level */
+	while (!serial_transmit_empty(serial)) {
+		cpu_relax();
+	}
+	hal->io_outb(serial->port + UART_FIFO_CTRL,
+		     UART_FCR_ENABLE | UART_FCR_CLEAR_RX | UART_FCR_TRIGGER_8);
+	bool fifo = (hal->io_inb(serial->port + UART_INT_ID) & UART_IIR_FIFO_ENABLED) ==
+		    UART_IIR_FIFO_ENABLED;
+	serial->fifo_size = fifo ? UART_FIFO_SIZE : 1;
+
+	spin_lock_init(&serial->lock);
+	wait_queue_init(&serial->rx_wait);
+	serial->tx_head = serial->tx_tail = 0;
+	serial->rx_head = serial->rx_tail = 0;
+	serial->tx_busy = false;
+	serial->irq = irq;
+	irq_ports[irq] = serial;
+	hal->irq_register(UART_IRQ_VECTOR_BASE + irq, handler);
+
+	uint32_t flags = hal->irq_disable();
+	serial->irq_mode = true;
+	hal->io_outb(serial->port + UART_INT_ENABLE,
+		     UART_IER_RX | UART_IER_THRE | UART_IER_LINE_STATUS);
+	irq_clear_mask(irq);
+	hal->irq_restore(flags);
+	return 0;
+}
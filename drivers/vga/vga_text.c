@@ -1,5 +1,10 @@
 // VGA Text Mode Driver
 // Modular implementation that can be replaced with other display drivers
+//
+// Drawing goes to a shadow copy of the screen in normal RAM. Rows are a
+// ring (`top` is the physical row shown first), so scrolling moves no
+// cells; changed rows are marked dirty and copied to VGA memory in bulk
+// at the end of each operation, with one hardware cursor update.
 
 #include <drivers/vga.h>
 #include <kernel/types.h>
@@ -12,6 +17,10 @@
 #define VGA_CTRL_REG  0x3D4
 #define VGA_DATA_REG  0x3D5
 
+_Static_assert(VGA_HEIGHT < 32, "dirty row mask is 32 bits");
+#define ALL_ROWS ((1u << VGA_HEIGHT) - 1)
+_Static_assert(VGA_WIDTH % 2 == 0, "rows are copied two cells at a time");
+
 // Driver state
 static struct {
     volatile uint16_t* buffer;
@@ -19,6 +28,10 @@ static struct {
     uint16_t cursor_y;
     uint8_t current_color;
     bool initialized;
+    uint16_t top;               // Shadow row shown as screen row 0
+    uint32_t dirty;             // Screen rows that differ from VGA memory
+    uint16_t hw_cursor;         // Position last sent to the hardware
+    uint16_t shadow[VGA_HEIGHT][VGA_WIDTH];
 } vga_state;
 
 // Forward declarations
@@ -45,11 +58,41 @@ static inline uint16_t make_entry(char c, uint8_t color) {
     return (uint16_t)c | ((uint16_t)color << 8);
 }
 
-// Helper: update hardware cursor position
+// Helper: shadow row behind screen row y
+static inline uint16_t* shadow_row(uint16_t y) {
+    uint16_t row = vga_state.top + y;
+    if (row >= VGA_HEIGHT) {
+        row -= VGA_HEIGHT;
+    }
+    return vga_state.shadow[row];
+}
+
+// Helper: copy dirty rows to VGA memory, 32 bits per store
+static void flush_rows(void) {
+    uint32_t dirty = vga_state.dirty;
+    vga_state.dirty = 0;
+
+    while (dirty) {
+        uint16_t y = (uint16_t)__builtin_ctz(dirty);
+        dirty &= dirty - 1;
+
+        const uint16_t* src = shadow_row(y);
+        volatile uint32_t* dst = (volatile uint32_t*)(vga_state.buffer + y * VGA_WIDTH);
+        for (size_t i = 0; i < VGA_WIDTH / 2; i++) {
+            dst[i] = (uint32_t)src[2 * i] | ((uint32_t)src[2 * i + 1] << 16);
+        }
+    }
+}
+
+// Helper: update hardware cursor position (skipped if unchanged)
 static void update_hardware_cursor(void) {
     if (!hal) return;  // HAL not initialized yet
 
     uint16_t pos = vga_state.cursor_y * VGA_WIDTH + vga_state.cursor_x;
+    if (pos == vga_state.hw_cursor) {
+        return;
+    }
+    vga_state.hw_cursor = pos;
 
     // Send low byte
     hal->io_outb(VGA_CTRL_REG, 0x0F);
@@ -71,6 +114,8 @@ static int vga_text_init(void) {
     vga_state.cursor_x = 0;
     vga_state.cursor_y = 0;
     vga_state.current_color = make_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+    vga_state.top = 0;
+    vga_state.hw_cursor = 0xFFFF;  // Force the first update
     vga_state.initialized = true;
 
     // Clear screen
@@ -88,39 +133,47 @@ static void vga_text_shutdown(void) {
     vga_state.initialized = false;
 }
 
-// Clear the entire screen
-static void vga_text_clear(void) {
+// Helper: fill screen row y with blanks in the current color
+static void blank_row(uint16_t y) {
     uint16_t blank = make_entry(' ', vga_state.current_color);
+    uint16_t* row = shadow_row(y);
 
-    for (size_t y = 0; y < VGA_HEIGHT; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            size_t index = y * VGA_WIDTH + x;
-            vga_state.buffer[index] = blank;
-        }
+    for (size_t x = 0; x < VGA_WIDTH; x++) {
+        row[x] = blank;
+    }
+    vga_state.dirty |= 1u << y;
+}
+
+// Clear the entire screen
+static void vga_text_clear(void) {
+    vga_state.top = 0;
+    for (uint16_t y = 0; y < VGA_HEIGHT; y++) {
+        blank_row(y);
     }
+    flush_rows();
 
     vga_state.cursor_x = 0;
     vga_state.cursor_y = 0;
     update_hardware_cursor();
 }
 
+// Helper: scroll the shadow up one line (every screen row changes)
+static void scroll_shadow(void) {
+    vga_state.top = vga_state.top + 1 == VGA_HEIGHT ? 0 : vga_state.top + 1;
+    blank_row(VGA_HEIGHT - 1);
+    vga_state.dirty = ALL_ROWS;
+}
+
 // Scroll screen up by one line
 static void vga_text_scroll(void) {
-    // Move all lines up
-    for (size_t y = 0; y < VGA_HEIGHT - 1; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            size_t src = (y + 1) * VGA_WIDTH + x;
-            size_t dst = y * VGA_WIDTH + x;
-            vga_state.buffer[dst] = vga_state.buffer[src];
-        }
-    }
+    scroll_shadow();
+    flush_rows();
+}
 
-    // Clear bottom line
-    uint16_t blank = make_entry(' ', vga_state.current_color);
-    for (size_t x = 0; x < VGA_WIDTH; x++) {
-        size_t index = (VGA_HEIGHT - 1) * VGA_WIDTH + x;
-        vga_state.buffer[index] = blank;
-    }
+// Helper: store a cell in the shadow
+static inline void put_cell(char c, uint16_t x, uint16_t y) {
+    shadow_row(y)[x] = make_entry(c, vga_state.current_color);
+    vga_state.dirty |= 1u << y;
 }
 
 // Write character at specific position (with bounds checking)
@@ -129,12 +182,12 @@ static void vga_text_putchar_at(char c, uint16_t x, uint16_t y) {
         return;  // Out of bounds - silently ignore
     }
 
-    size_t index = y * VGA_WIDTH + x;
-    vga_state.buffer[index] = make_entry(c, vga_state.current_color);
+    put_cell(c, x, y);
+    flush_rows();
 }
 
-// Write character at cursor position
-static void vga_text_putchar(char c) {
+// Helper: interpret one character at the cursor, shadow only
+static void emit_char(char c) {
     // Handle special characters
     if (c == '\n') {
         // Newline
@@ -150,11 +203,11 @@ static void vga_text_putchar(char c) {
         // Backspace
         if (vga_state.cursor_x > 0) {
             vga_state.cursor_x--;
-            vga_text_putchar_at(' ', vga_state.cursor_x, vga_state.cursor_y);
+            put_cell(' ', vga_state.cursor_x, vga_state.cursor_y);
         }
     } else if (c >= ' ' && c <= '~') {
         // Printable ASCII
-        vga_text_putchar_at(c, vga_state.cursor_x, vga_state.cursor_y);
+        put_cell(c, vga_state.cursor_x, vga_state.cursor_y);
         vga_state.cursor_x++;
     }
     // Ignore other control characters
@@ -167,25 +220,33 @@ static void vga_text_putchar(char c) {
 
     // Handle scroll
     if (vga_state.cursor_y >= VGA_HEIGHT) {
-        vga_text_scroll();
+        scroll_shadow();
         vga_state.cursor_y = VGA_HEIGHT - 1;
     }
+}
 
+// Write character at cursor position
+static void vga_text_putchar(char c) {
+    emit_char(c);
+    flush_rows();
     update_hardware_cursor();
 }
 
-// Write string at cursor position
+// Write string at cursor position (one flush and cursor update per call)
 static void vga_text_write(const char* str, size_t len) {
     for (size_t i = 0; i < len; i++) {
-        vga_text_putchar(str[i]);
+        emit_char(str[i]);
     }
+    flush_rows();
+    update_hardware_cursor();
 }
 
 // Write string at specific position
 static void vga_text_write_at(const char* str, size_t len, uint16_t x, uint16_t y) {
     for (size_t i = 0; i < len && (x + i) < VGA_WIDTH && y < VGA_HEIGHT; i++) {
-        vga_text_putchar_at(str[i], x + i, y);
+        put_cell(str[i], x + i, y);
     }
+    flush_rows();
 }
 
 // Set foreground and background color
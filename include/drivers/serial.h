@@ -9,6 +9,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <kernel/spinlock.h>
+#include <kernel/waitqueue.h>
 
 /* Serial port definitions */
 #define SERIAL_COM1 0x3F8
@@ -25,10 +27,42 @@ struct serial_config {
 	bool parity;        /* Parity enabled */
 };
 
-/* Serial port handle */
+/* Legacy IRQ lines */
+#define SERIAL_COM1_IRQ 4
+#define SERIAL_COM2_IRQ 3
+
+/* Software buffers for interrupt-driven mode (powers of two) */
+#define SERIAL_TX_BUF_SIZE 4096
+#define SERIAL_RX_BUF_SIZE 256
+
+/*
+ * Serial port handle
+ *
+ * Polled until serial_enable_irq(). After that, writes only queue bytes
+ * in tx_buf and the THRE interrupt refills the hardware FIFO (up to
+ * fifo_size bytes per interrupt); received bytes are moved to rx_buf by
+ * the RX interrupt, which wakes tasks in serial_read_wait().
+ */
 struct serial_port {
 	uint16_t port;
 	bool initialized;
+	bool irq_mode;
+	uint8_t irq;
+	uint8_t fifo_size;        /* 16 on a 16550A, 1 without a working FIFO */
+	bool tx_busy;             /* FIFO loaded, THRE interrupt expected */
+
+	spinlock_t lock;          /* Rings and tx_busy */
+	uint32_t tx_head, tx_tail;
+	uint32_t rx_head, rx_tail;
+	char tx_buf[SERIAL_TX_BUF_SIZE];
+	char rx_buf[SERIAL_RX_BUF_SIZE];
+	wait_queue_t rx_wait;
+
+	/* Statistics */
+	uint32_t tx_irqs;
+	uint32_t rx_irqs;
+	uint32_t rx_dropped;      /* rx_buf full or hardware overrun */
+	uint32_t tx_stalls;       /* Writes that found tx_buf full and polled */
 };
 
 /*
@@ -43,9 +77,18 @@ int serial_init(struct serial_port* serial, uint16_t port);
  */
 int serial_init_config(struct serial_port* serial, const struct serial_config* config);
 
+/*
+ * Switch the port to interrupt-driven I/O on a legacy PIC line
+ * Returns 0 on success, -1 on failure
+ */
+int serial_enable_irq(struct serial_port* serial, uint8_t irq);
+
 /*
  * Write a single character to serial port
- * Blocks until transmit buffer is ready
+ * Polled mode: blocks until the transmitter is ready. Interrupt mode:
+ * queues the byte; only waits (polling) if the software buffer is full.
+ * With interrupts disabled (early boot, panic) no THRE interrupt can be
+ * waited for, so the queue is pushed out by polling before returning.
  */
 void serial_putchar(struct serial_port* serial, char c);
 
@@ -54,12 +97,27 @@ void serial_putchar(struct serial_port* serial, char c);
  */
 void serial_write(struct serial_port* serial, const char* str, size_t len);
 
+/*
+ * Write bytes as they are, without LF to CRLF conversion
+ * In interrupt mode the bytes are queued under one lock hold, so other
+ * writers cannot land in the middle of them.
+ */
+void serial_write_raw(struct serial_port* serial, const void* buf, size_t len);
+
 /*
  * Read a character from serial port (non-blocking)
  * Returns -1 if no data available, character otherwise
  */
 int serial_getchar(struct serial_port* serial);
 
+/*
+ * Read a character, blocking the calling task until one arrives
+ * Interrupt mode only. timeout_us = 0 waits forever.
+ * Returns the character, -ETIMEDOUT, -EPERM (idle/bootstrap context) or
+ * -ENODEV (port not interrupt-driven)
+ */
+int serial_read_wait(struct serial_port* serial, uint64_t timeout_us);
+
 /*
  * Check if data is available to read
  */
@@ -73,4 +131,13 @@ bool serial_transmit_empty(struct serial_port* serial);
 /* Get serial console backend for console multiplexer */
 struct console_backend* serial_get_console_backend(void);
 
+/*
+ * Make the serial console interrupt-driven (COM1, IRQ 4)
+ * Call once the IDT and PIC are set up
+ */
+int serial_console_enable_irq(void);
+
+/* Port behind the serial console (for input and statistics) */
+struct serial_port* serial_console_port(void);
+
 #endif /* DRIVERS_SERIAL_H */
@@ -0,0 +1,63 @@
+#ifndef KERNEL_BOOTMOD_H
+#define KERNEL_BOOTMOD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/types.h>
+#include <kernel/pmm.h>
+
+/**
+ * Boot modules
+ *
+ * Files the bootloader loaded next to the kernel (GRUB `module`, QEMU
+ * `-initrd a,b,...`), kept in place for the lifetime of the kernel: the
+ * PMM reserves their frames, and user programs among them are mapped
+ * straight into address spaces (task_create_user_elf()) instead of
+ * being copied.
+ *
+ * A module is named after the last path component of the first word of
+ * its command line ("/boot/echo.elf arg" is "echo.elf").
+ *
+ * RT Constraints:
+ * - bootmod_init(): boot only, O(modules)
+ * - bootmod_count()/bootmod_get(): O(1); bootmod_find(): O(BOOTMOD_MAX)
+ */
+
+#define BOOTMOD_MAX       16
+#define BOOTMOD_NAME_LEN  32
+
+struct boot_module {
+    char name[BOOTMOD_NAME_LEN];
+    phys_addr_t start;          // Page-aligned (see the header flags in boot.s)
+    size_t size;                // Bytes
+};
+
+/**
+ * Record the modules listed in the multiboot information
+ *
+ * Must run after pmm_init() (which reserves the modules' frames) and
+ * before anything overwrites the bootloader's tables in low memory.
+ * Modules beyond BOOTMOD_MAX are ignored with a warning.
+ *
+ * @param multiboot_magic Magic value from the bootloader
+ * @param mbi Multiboot information
+ * @return Number of modules recorded
+ */
+uint32_t bootmod_init(uint32_t multiboot_magic, const struct multiboot_info* mbi);
+
+/**
+ * Number of modules recorded by bootmod_init()
+ */
+uint32_t bootmod_count(void);
+
+/**
+ * Module `index` in load order, or NULL if out of range
+ */
+const struct boot_module* bootmod_get(uint32_t index);
+
+/**
+ * Module named `name`, or NULL if there is none
+ */
+const struct boot_module* bootmod_find(const char* name);
+
+#endif // KERNEL_BOOTMOD_H
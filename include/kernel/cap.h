@@ -0,0 +1,159 @@
+#ifndef KERNEL_CAP_H
+#define KERNEL_CAP_H
+
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/spinlock.h>
+
+/**
+ * Capability tables
+ *
+ * A unit's capabilities live in one dense array (docs/UNITS_ARCHITECTURE.md).
+ * A handle is an index into it plus the generation of the slot when the
+ * capability was installed; revoking bumps the generation, so stale
+ * handles fail without any search:
+ *
+ *   handle = generation << CAP_INDEX_BITS | index
+ *
+ * A slot's generation wraps after 2^20 reuses.
+ *
+ * Type and rights share one word (type in the top byte), so checking a
+ * capability for "a channel with READ|WRITE" is a single mask test.
+ *
+ * Lookups take no lock: a reader checks the generation, loads the slot,
+ * and checks the generation again; a writer bumps it before reusing the
+ * slot. The object a capability points to must outlive concurrent
+ * lookups: owners retire objects with call_rcu() (kernel/rcu.h), and
+ * users of cap_lookup() stay inside an RCU read section while they use
+ * the object.
+ *
+ * On top of that, each CPU keeps a few recently validated (table, handle)
+ * pairs. A hit needs no access to the table's slot at all; any revoke in
+ * a table invalidates its cached entries everywhere.
+ *
+ * RT Constraints:
+ * - cap_lookup(): O(1), no lock, no locked instruction
+ * - cap_install()/cap_revoke()/cap_grant(): O(1) under the table lock
+ * - cap_table_init(): allocates, not RT-safe
+ */
+
+typedef int32_t cap_handle_t;
+
+#define CAP_INDEX_BITS      10
+#define CAP_MAX_ENTRIES     (1u << CAP_INDEX_BITS)
+#define CAP_GEN_MAX         ((1u << (31 - CAP_INDEX_BITS)) - 1)  // Handles stay positive
+
+typedef enum {
+    CAP_TYPE_NONE = 0,
+    CAP_TYPE_CHANNEL,
+    CAP_TYPE_ENDPOINT,
+    CAP_TYPE_RING,
+    CAP_TYPE_MEMORY,
+    CAP_TYPE_IRQ,
+    CAP_TYPE_IO_PORT,
+    CAP_TYPE_UNIT,
+} cap_type_t;
+
+#define CAP_RIGHT_READ      (1u << 0)
+#define CAP_RIGHT_WRITE     (1u << 1)
+#define CAP_RIGHT_EXECUTE   (1u << 2)
+#define CAP_RIGHT_GRANT     (1u << 3)  // May be copied to another table
+#define CAP_RIGHTS_ALL      0x00FFFFFFu
+
+#define CAP_TYPE_SHIFT      24
+#define CAP_TYPE_MASK       (0xFFu << CAP_TYPE_SHIFT)
+
+typedef struct capability {
+    volatile uint32_t gen;      // Odd while installed, bumped by install and revoke
+    uint32_t          key;      // Type << CAP_TYPE_SHIFT | rights
+    void*             obj;      // channel_t, ipc_endpoint_t, ...
+    uint32_t          next_free; // Free list link (index) while free
+} capability_t;
+
+typedef struct cap_table {
+    uint32_t          id;           // Unique, never reused: keys the CPU caches
+    capability_t*     slots;
+    uint32_t          capacity;
+    uint32_t          count;        // Installed capabilities
+    uint32_t          free_head;    // First free index, capacity if none
+    volatile uint32_t revokes;      // Bumped by every revoke: stales cached lookups
+    spinlock_t        lock;         // Writers only
+} cap_table_t;
+
+/**
+ * Type-and-rights check, one mask operation
+ *
+ * @return true if `key` is of `type` and holds every right in `rights`
+ */
+static inline bool cap_key_allows(uint32_t key, cap_type_t type, uint32_t rights) {
+    uint32_t want = ((uint32_t)type << CAP_TYPE_SHIFT) | rights;
+    return (((key ^ want) & CAP_TYPE_MASK) | (want & ~key)) == 0;
+}
+
+/**
+ * Set up an empty table
+ *
+ * @param capacity Slots, 1..CAP_MAX_ENTRIES
+ * @return 0, -EINVAL, -ENOMEM
+ */
+int cap_table_init(cap_table_t* t, uint32_t capacity);
+
+/**
+ * Free a table's slots
+ *
+ * Nobody may look anything up in it any more.
+ */
+void cap_table_destroy(cap_table_t* t);
+
+/**
+ * Install a capability
+ *
+ * @return New handle (> 0), -EINVAL for a bad type or rights, -ENOMEM if full
+ */
+cap_handle_t cap_install(cap_table_t* t, cap_type_t type, void* obj, uint32_t rights);
+
+/**
+ * Revoke a capability
+ *
+ * The handle and every cached validation of it stop working at once.
+ *
+ * @return 0, -EBADF for a stale or bad handle
+ */
+int cap_revoke(cap_table_t* t, cap_handle_t handle);
+
+/**
+ * Copy a capability to another table with fewer or equal rights
+ *
+ * Requires CAP_RIGHT_GRANT on the source.
+ *
+ * @return New handle in `to`, -EBADF, -EACCES, -ENOMEM
+ */
+cap_handle_t cap_grant(cap_table_t* from, cap_handle_t handle, cap_table_t* to,
+                       uint32_t rights);
+
+/**
+ * Validate a handle and return its object
+ *
+ * Consults this CPU's cache first. Call from an RCU read section (or
+ * with interrupts off) and use the object only inside it.
+ *
+ * @param type    Expected type
+ * @param rights  Rights the operation needs
+ * @return 0 with *obj set, -EBADF (stale, bad or wrong type), -EACCES
+ *
+ * RT: O(1), no lock
+ */
+int cap_lookup(cap_table_t* t, cap_handle_t handle, cap_type_t type, uint32_t rights,
+               void** obj);
+
+/**
+ * This CPU's handle cache counters
+ */
+struct cap_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+};
+
+void cap_cache_get_stats(uint32_t cpu_id, struct cap_cache_stats* stats);
+
+#endif // KERNEL_CAP_H
@@ -0,0 +1,147 @@
+#ifndef KERNEL_CHANNEL_H
+#define KERNEL_CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+#include <kernel/mmu.h>
+#include <kernel/waitqueue.h>
+
+/**
+ * Channels (bounded message queues)
+ *
+ * A channel holds up to `depth` messages in a ring of fixed-size slots
+ * allocated at creation; nothing is allocated per message. Senders block
+ * while the ring is full and receivers while it is empty, each on their
+ * own wait queue.
+ *
+ * Messages come in two forms:
+ * - Inline: up to CHAN_INLINE_MAX bytes, copied into the slot on send and
+ *   out of it on receive.
+ * - Pages (CHAN_PAGES): whole pages of a reserved region are unmapped from
+ *   the sender and mapped into the receiver's region, so bulk data moves
+ *   without being copied. The sender's pages read as fresh zeroed pages
+ *   afterwards.
+ *
+ * Lock order: wait queue lock, then channel lock.
+ *
+ * RT Constraints:
+ * - Inline send/receive: O(len), no allocation
+ * - Page send/receive: O(pages * MMU_MAX_REGIONS), plus page table
+ *   allocations on receive
+ */
+
+#define CHAN_INLINE_MAX     120  // Largest inline message (slot payload)
+#define CHAN_MAX_PAGES      (CHAN_INLINE_MAX / sizeof(phys_addr_t))
+#define CHAN_MAX_DEPTH      16   // Slots per channel
+#define CHAN_MAX_CHANNELS   64   // Channel IDs handed out to user tasks
+
+// Flags for chan_send() and chan_recv()
+#define CHAN_NONBLOCK  (1u << 0)   // Fail with -EAGAIN instead of blocking
+#define CHAN_PAGES     (1u << 1)   // Send: move whole pages, don't copy
+
+struct chan_msg {
+    uint32_t len;               // Payload bytes
+    uint32_t npages;            // 0 = inline, else frames in pages[]
+    union {
+        uint8_t     data[CHAN_INLINE_MAX];
+        phys_addr_t pages[CHAN_MAX_PAGES];
+    };
+};
+
+typedef struct channel {
+    spinlock_t       lock;      // Taken under a wait queue lock
+    atomic_t         refs;
+    bool             closed;    // No more sends; receives drain, then -EPIPE
+
+    struct chan_msg* slots;     // Ring of `depth` messages
+    uint32_t         depth;
+    uint32_t         head;      // Oldest queued message
+    uint32_t         count;
+
+    wait_queue_t     recv_waiters;  // Blocked on an empty channel
+    wait_queue_t     send_waiters;  // Blocked on a full channel
+
+    // Statistics
+    uint64_t         msgs_sent;
+    uint64_t         msgs_received;
+    uint64_t         pages_moved;
+} channel_t;
+
+/**
+ * Create a channel
+ *
+ * @param depth Messages it can queue (1..CHAN_MAX_DEPTH)
+ * @return Channel holding one reference, or NULL on bad depth or no memory
+ */
+channel_t* chan_create(uint32_t depth);
+
+/**
+ * Take and drop references
+ *
+ * The last chan_put() frees the channel and any frames still queued.
+ */
+void chan_get(channel_t* ch);
+void chan_put(channel_t* ch);
+
+/**
+ * Close a channel and drop the caller's reference
+ *
+ * Blocked senders fail with -EPIPE; receivers get the queued messages,
+ * then -EPIPE.
+ */
+void chan_close(channel_t* ch);
+
+/**
+ * Send a message
+ *
+ * Inline: copies `len` bytes from `buf`. CHAN_PAGES: `buf` is
+ * page-aligned inside a reserved region of the current address space and
+ * the ceil(len / PAGE_SIZE) pages there move into the message. They are
+ * given back if the send fails.
+ *
+ * @param timeout_us Give up after this long (0 = wait forever)
+ * @return 0 once queued, -EAGAIN if full and CHAN_NONBLOCK, -ETIMEDOUT,
+ *         -EPIPE if closed, -EMSGSIZE if too long, -EINVAL for a
+ *         misaligned page send, -EFAULT for pages outside a region,
+ *         -EPERM from a context that cannot block
+ */
+int chan_send(channel_t* ch, const void* buf, size_t len, uint32_t flags,
+              uint64_t timeout_us);
+
+/**
+ * Receive the oldest message
+ *
+ * Inline messages are copied to `buf`. Page messages are mapped at `buf`,
+ * which must be page-aligned inside a reserved region of the current
+ * address space; whatever those pages held is released.
+ *
+ * @param buf_len Room at `buf`; page messages need whole pages
+ * @param timeout_us Give up after this long (0 = wait forever)
+ * @return Message length, -EAGAIN if empty and CHAN_NONBLOCK, -ETIMEDOUT,
+ *         -EPIPE if closed and drained, -EMSGSIZE if `buf` is too small
+ *         or misaligned for the message (it stays queued), -EFAULT or
+ *         -ENOMEM if pages could not be mapped (the message is lost),
+ *         -EPERM from a context that cannot block
+ */
+int chan_recv(channel_t* ch, void* buf, size_t buf_len, uint32_t flags,
+              uint64_t timeout_us);
+
+/**
+ * Channel IDs for user tasks
+ *
+ * IDs index one global table, but each belongs to the program (address
+ * space) it was installed for, and only that program may use it.
+ * chan_install() moves the caller's reference into the table and returns
+ * the ID (1..CHAN_MAX_CHANNELS), or -ENOMEM when full. chan_lookup()
+ * returns the channel with a new reference, or NULL for an unknown ID or
+ * one of another owner. chan_uninstall() removes the ID and closes the
+ * channel, or returns -EINVAL in those cases. chan_release_owner()
+ * uninstalls all of an exiting program's IDs.
+ */
+int chan_install(channel_t* ch, page_table_t* owner);
+channel_t* chan_lookup(int id, page_table_t* as);
+int chan_uninstall(int id, page_table_t* as);
+void chan_release_owner(page_table_t* owner);
+
+#endif // KERNEL_CHANNEL_H
@@ -0,0 +1,106 @@
+/**
+ * Clock sources
+ *
+ * A clock source is a free-running counter with a known rate. Drivers
+ * register the ones their hardware has; the highest-rated one becomes
+ * the kernel's timebase for timer_read_us() and timer_read_ns().
+ *
+ * Counter values are converted with a multiply and a shift computed at
+ * registration:
+ *
+ *   ns = (cycles * mult) >> shift
+ *
+ * The multiply is 64 x 32 bits: two 32 x 32 -> 64 multiplies on i686,
+ * no division and no libgcc call. mult is derived from the full rate in
+ * Hz, so there is no rounding to whole MHz and no drift from it.
+ *
+ * Registration is boot-time only (boot CPU, before the APs start); the
+ * timebase resets when the source changes, so switch before anything
+ * has taken timestamps it needs to compare.
+ *
+ * RT Constraints:
+ * - clocksource_read_ns()/_us(): one counter read plus two multiplies
+ */
+
+#ifndef KERNEL_CLOCKSOURCE_H
+#define KERNEL_CLOCKSOURCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Ratings: higher wins
+#define CLOCKSOURCE_RATING_TICK   100     // Coarse, interrupt-driven
+#define CLOCKSOURCE_RATING_HPET   250
+#define CLOCKSOURCE_RATING_TSC    300
+
+struct clocksource {
+    const char* name;
+    uint64_t  (*read)(void);    // Counts since the source's zero
+    uint64_t    freq_hz;
+    int         rating;
+
+    // Filled in by clocksource_register()
+    uint32_t    ns_mult, ns_shift;
+    uint32_t    us_mult, us_shift;
+};
+
+// Timebase in use (a source that always reads 0 until one registers)
+extern const struct clocksource* clocksource_active;
+
+/**
+ * (a * mul) >> shift with a 96-bit intermediate, shift <= 32
+ *
+ * RT: O(1), two 32 x 32 -> 64 multiplies
+ */
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift) {
+    uint32_t hi = (uint32_t)(a >> 32);
+    uint64_t ret = ((uint64_t)(uint32_t)a * mul) >> shift;
+    if (hi) {
+        ret += ((uint64_t)hi * mul) << (32 - shift);
+    }
+    return ret;
+}
+
+/**
+ * Pick mult/shift for converting from_hz counts to to_hz units
+ *
+ * Uses the largest shift (most precision) that keeps mult in 32 bits.
+ * to_hz must be below 2^32.
+ */
+void clocks_calc_mult_shift(uint32_t* mult, uint32_t* shift, uint64_t from_hz,
+                            uint64_t to_hz);
+
+/**
+ * Make a clock source available
+ *
+ * Computes its conversion factors and switches to it if it outrates
+ * the active one. The structure must stay alive.
+ *
+ * @return 0, -EINVAL without a read function or rate
+ */
+int clocksource_register(struct clocksource* cs);
+
+/**
+ * Current time in nanoseconds / microseconds of the active source
+ *
+ * RT: O(1), no division
+ */
+static inline uint64_t clocksource_read_ns(void) {
+    const struct clocksource* cs = clocksource_active;
+    return mul_u64_u32_shr(cs->read(), cs->ns_mult, cs->ns_shift);
+}
+
+static inline uint64_t clocksource_read_us(void) {
+    const struct clocksource* cs = clocksource_active;
+    return mul_u64_u32_shr(cs->read(), cs->us_mult, cs->us_shift);
+}
+
+/**
+ * Convert a count of the active source to nanoseconds
+ */
+static inline uint64_t clocksource_cyc2ns(uint64_t cycles) {
+    const struct clocksource* cs = clocksource_active;
+    return mul_u64_u32_shr(cycles, cs->ns_mult, cs->ns_shift);
+}
+
+#endif // KERNEL_CLOCKSOURCE_H
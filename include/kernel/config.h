@@ -55,5 +55,87 @@
 #error "Unknown CONFIG_PROFILE_* selection"
 #endif
 
+// ---------------------------------------------------------------------------
+// Independent options (override with -D on the compiler command line)
+// ---------------------------------------------------------------------------
+
+// Most verbose log level built in (include/kernel/log.h): 1 error,
+// 2 warning, 3 info, 4 debug. Messages above it are not in the binary.
+#ifndef CONFIG_LOG_LEVEL
+#if CONFIG_ENABLE_LOG_VERBOSE
+#define CONFIG_LOG_LEVEL                 4
+#else
+#define CONFIG_LOG_LEVEL                 3
+#endif
+#endif
+
+// Tickless timer: each CPU arms a one-shot interrupt for its next event
+// instead of ticking at a fixed rate (0 = periodic tick)
+#ifndef CONFIG_TICKLESS
+#define CONFIG_TICKLESS                  1
+#endif
+
+// Trace points at hot paths (include/kernel/trace.h); each is still off
+// until enabled in trace_enabled_mask (0 = compiled out entirely)
+#ifndef CONFIG_TRACE
+#define CONFIG_TRACE                     1
+#endif
+
+// Events each CPU's trace buffer holds (power of two); allocated with the
+// per-CPU area, so only CPUs that are present pay for it
+#ifndef CONFIG_TRACE_BUFFER_SIZE
+#define CONFIG_TRACE_BUFFER_SIZE         1024
+#endif
+
+// Stream every trace event type to COM1 in the binary export format
+// (scripts/trace2json.py); binary bytes mix with the serial console text
+#ifndef CONFIG_TRACE_EXPORT
+#define CONFIG_TRACE_EXPORT              0
+#endif
+
+// Sample unhalted cycles every N events from boot (kernel/pmu.h);
+// 0 = the profiler only runs when pmu_profile_start() is called
+#ifndef CONFIG_PMU_PROFILE_PERIOD
+#define CONFIG_PMU_PROFILE_PERIOD        0
+#endif
+
+// Per-switch TSC cost of context switches, logged to the per-CPU trace
+// buffer as TRACE_TASK_SWITCH (0 = no timestamps on the switch path)
+#ifndef CONFIG_SCHED_SWITCH_TRACE
+#define CONFIG_SCHED_SWITCH_TRACE        1
+#endif
+
+// Scheduler statistics: per-task run and wait time and per-CPU log2
+// histograms of ready-to-run latency and run bursts, from TSC stamps on
+// enqueue and switch (0 = none of those stamps)
+#ifndef CONFIG_SCHED_STATS
+#define CONFIG_SCHED_STATS               1
+#endif
+
+// Mutex hold/wait time statistics: two timestamps per acquisition
+// (0 = count acquisitions and contentions only)
+#ifndef CONFIG_MUTEX_STATS
+#define CONFIG_MUTEX_STATS               1
+#endif
+
+// Idle loop (kernel/idle.h): spin on need_resched this long before
+// sleeping, so a wakeup soon after going idle costs no interrupt
+// (0 = sleep right away)
+#ifndef CONFIG_IDLE_POLL_US
+#define CONFIG_IDLE_POLL_US              20
+#endif
+
+// Sleep with MONITOR/MWAIT on need_resched where the CPU supports it, so
+// remote wakeups need no IPI (0 = always HLT)
+#ifndef CONFIG_IDLE_MWAIT
+#define CONFIG_IDLE_MWAIT                1
+#endif
+
+// MWAIT hint (EAX): bits 7:4 target C-state minus one, bits 3:0
+// sub-state; 0 is C1, the shallowest and quickest to leave
+#ifndef CONFIG_IDLE_MWAIT_HINT
+#define CONFIG_IDLE_MWAIT_HINT           0x00
+#endif
+
 #endif // KERNEL_CONFIG_H
 
@@ -0,0 +1,116 @@
+#ifndef KERNEL_ELF_H
+#define KERNEL_ELF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/types.h>
+#include <kernel/mmu.h>
+
+/**
+ * ELF32 executable loader
+ *
+ * Loads statically linked i386 executables (ET_EXEC) into a user address
+ * space without copying them. Each PT_LOAD segment becomes one backed
+ * region (mmu_reserve_backed_region()) over the image itself:
+ *
+ * - Read-only segments (text, rodata) map the image's frames directly;
+ *   every address space loaded from the same image shares them.
+ * - Writable segments (data) share them too until the first write to a
+ *   page, which gets a private copy (copy-on-write).
+ * - The part of a segment past its file size (BSS) is zero-filled on
+ *   first touch, like any demand-paged region.
+ *
+ * So loading costs no frames at all; a task pays only for the pages it
+ * writes and the page tables it touches. The image must be page-aligned
+ * (multiboot modules are, see the header flags in arch/x86/boot.s),
+ * identity-mapped, and must outlive every address space loaded from it.
+ *
+ * Segments must lie in the user code window (USER_CODE_BASE, kernel/user.h)
+ * with p_vaddr congruent to p_offset modulo the page size, as linkers
+ * produce by default, and must not share a page with each other.
+ *
+ * RT Constraints:
+ * - Not RT-safe: O(program headers), use at task creation
+ */
+
+#define ELF_MAGIC       0x464C457Fu  // "\x7FELF", read little-endian
+
+// e_ident indices and values
+#define EI_NIDENT       16
+#define EI_CLASS        4
+#define EI_DATA         5
+#define EI_VERSION      6
+#define ELFCLASS32      1
+#define ELFDATA2LSB     1
+#define EV_CURRENT      1
+
+#define ET_EXEC         2   // e_type: executable
+#define EM_386          3   // e_machine: Intel 80386
+
+// Program header types and flags
+#define PT_NULL         0
+#define PT_LOAD         1
+#define PF_X            (1 << 0)
+#define PF_W            (1 << 1)
+#define PF_R            (1 << 2)
+
+struct elf32_ehdr {
+    uint8_t e_ident[EI_NIDENT];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;           // Virtual address of the first instruction
+    uint32_t e_phoff;           // Program header table offset
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;       // Size of one program header
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} __attribute__((packed));
+
+struct elf32_phdr {
+    uint32_t p_type;
+    uint32_t p_offset;          // Segment start in the file
+    uint32_t p_vaddr;           // Segment start in memory
+    uint32_t p_paddr;
+    uint32_t p_filesz;          // Bytes taken from the file
+    uint32_t p_memsz;           // Bytes in memory, the rest zero-filled
+    uint32_t p_flags;           // PF_*
+    uint32_t p_align;
+} __attribute__((packed));
+
+/**
+ * Check that an image is an ELF32 executable elf_load() accepts
+ *
+ * Validates the header, the program header table and every PT_LOAD
+ * segment (bounds, user window, alignment), and that the entry point
+ * lies in an executable segment. Reads the image, maps nothing.
+ *
+ * @param image Image, identity-mapped
+ * @param size Image size in bytes
+ * @return 0 if loadable, -ENOEXEC otherwise
+ */
+int elf_check(const void* image, size_t size);
+
+/**
+ * Load an ELF32 executable into an address space
+ *
+ * Reserves one backed region per non-empty PT_LOAD segment (user
+ * accessible, writable if PF_W) over the image; nothing is copied or
+ * allocated until the program touches its pages. On failure the regions
+ * reserved so far are released again.
+ *
+ * @param pt Target address space, normally from mmu_create_user_address_space()
+ * @param image Physical address of the page-aligned image
+ * @param size Image size in bytes
+ * @param entry Receives the entry point
+ * @return 0 on success, -EINVAL on bad arguments, -ENOEXEC if elf_check()
+ *         refuses the image, -EBUSY if a segment overlaps a region of
+ *         `pt`, -ENOMEM if the address space has no region slot left
+ */
+int elf_load(page_table_t* pt, phys_addr_t image, size_t size, uintptr_t* entry);
+
+#endif // KERNEL_ELF_H
@@ -0,0 +1,73 @@
+#ifndef KERNEL_FPU_H
+#define KERNEL_FPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+
+/**
+ * Lazy FPU/SSE Context Switching
+ *
+ * Integer context switches leave the x87/SSE registers alone. Instead
+ * schedule() marks the FPU unavailable (CR0.TS) whenever the incoming
+ * task's state is not the one loaded, and the first FPU instruction that
+ * follows traps (#NM). The trap saves the previous owner's registers
+ * into its area and loads the current task's, allocating a fresh area
+ * on a task's first use. Tasks that never touch the FPU never trap, own
+ * no area and add nothing to the switch.
+ *
+ * Per CPU, per_cpu_data.fpu_owner names the task whose state is live in
+ * the registers. That state may be newer than the owner's saved copy,
+ * so the scheduler does not steal a CPU's FPU owner away from it.
+ *
+ * RT Constraints:
+ * - Switch: O(1), one CR0 write at most, no save or restore
+ * - #NM trap: one save + one restore (~100-300 cycles); the first use
+ *   also allocates FPU_STATE_SIZE bytes
+ */
+
+#define FPU_STATE_SIZE  512     // FXSAVE area (FNSAVE uses the first 108)
+
+/**
+ * Saved FPU/SSE registers (FXSAVE needs 16-byte alignment)
+ */
+struct fpu_state {
+    uint8_t data[FPU_STATE_SIZE];
+} __attribute__((aligned(16)));
+
+struct task;
+
+/**
+ * Set up the boot CPU and the #NM handler
+ *
+ * Call once after the slab allocator is up, before any task runs.
+ */
+void fpu_init(void);
+
+/**
+ * Enable the FPU on an application processor (after idt_load())
+ */
+void fpu_init_cpu(void);
+
+/**
+ * Prepare this CPU's FPU for `next` (interrupts disabled)
+ *
+ * Called by schedule() before switching to `next`.
+ *
+ * RT: O(1), < 30 cycles
+ */
+void fpu_switch(struct task* next);
+
+/**
+ * Forget a dying task's FPU state and free its area
+ *
+ * Called by task_destroy(); the task must not be running.
+ */
+void fpu_task_release(struct task* task);
+
+/**
+ * Whether the FPU is usable without trapping (CR0.TS clear)
+ */
+bool fpu_is_enabled(void);
+
+#endif // KERNEL_FPU_H
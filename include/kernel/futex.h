@@ -0,0 +1,53 @@
+#ifndef KERNEL_FUTEX_H
+#define KERNEL_FUTEX_H
+
+#include <stdint.h>
+#include <kernel/types.h>
+
+/**
+ * Futexes (user-address wait/wake)
+ *
+ * Lets user tasks build locks and condition variables that only enter
+ * the kernel under contention: a task sleeps on a 32-bit word while it
+ * holds an expected value, and another task wakes sleepers after
+ * changing it. Sleepers are hashed by address space and address into
+ * FUTEX_HASH_BUCKETS wait queues; the value check and the block happen
+ * under the bucket lock, so a wake issued after the value changed is
+ * never lost.
+ *
+ * The key is the caller's address space plus the user address: each ELF
+ * program has its own address space, so the same address in two of them
+ * is two futexes. A word mapped into two address spaces (a shared ring)
+ * is not one futex across them.
+ *
+ * RT Constraints:
+ * - futex_wait(): O(1) to block, plus one page commit if not yet mapped
+ * - futex_wake(): O(sleepers in the bucket)
+ */
+
+#define FUTEX_HASH_BITS     6
+#define FUTEX_HASH_BUCKETS  (1u << FUTEX_HASH_BITS)
+
+/**
+ * Block while *uaddr == expected
+ *
+ * @param uaddr      User address of a 32-bit, 4-byte aligned word
+ * @param expected   Value the caller last saw there
+ * @param timeout_us Give up after this long (0 = wait forever)
+ * @return 0 when woken by futex_wake(), -EAGAIN if the value already
+ *         differs, -ETIMEDOUT, -EINVAL if misaligned, -EFAULT if not a
+ *         readable user address, -EPERM from a context that cannot block
+ *         or has no address space
+ */
+int futex_wait(uintptr_t uaddr, uint32_t expected, uint64_t timeout_us);
+
+/**
+ * Wake up to `count` tasks sleeping on uaddr in the caller's address
+ * space, oldest first
+ *
+ * @return Number of tasks woken, or -EINVAL if misaligned, -EFAULT if
+ *         not a user address, -EPERM without an address space
+ */
+int futex_wake(uintptr_t uaddr, uint32_t count);
+
+#endif // KERNEL_FUTEX_H
@@ -19,12 +19,22 @@
  * - Kernel data segment (ring 0)
  * - User code segment (ring 3)
  * - User data segment (ring 3)
- * - TSS (Task State Segment) for stack switching
+ * - TSS (Task State Segment) for stack switching, boot CPU
  *
  * Must be called early in HAL initialization.
  */
 void gdt_init(void);
 
+/**
+ * Set up segmentation on an application processor
+ *
+ * Loads the shared GDT and gives the CPU its own TSS (entry 5 + cpu_id),
+ * so every CPU has a private ESP0 for ring 3 -> ring 0 transitions.
+ *
+ * @param cpu_id Logical CPU ID of the caller (1 .. MAX_CPUS - 1)
+ */
+void gdt_init_cpu(uint32_t cpu_id);
+
 /**
  * Verify GDT is loaded correctly
  *
@@ -36,7 +46,8 @@ void gdt_verify(void);
 /**
  * Set kernel stack pointer for syscalls
  *
- * Updates TSS.esp0 to point to the kernel stack for the current task.
+ * Updates the calling CPU's TSS.esp0 to point to the kernel stack for the
+ * current task.
  * MUST be called in context_switch() before switching to a userspace task.
  *
  * @param esp0 Kernel stack pointer (top of kernel stack)
@@ -45,6 +56,17 @@ void gdt_verify(void);
  */
 void gdt_set_kernel_stack(uintptr_t esp0);
 
+/**
+ * Address of a CPU's TSS.esp0 field
+ *
+ * Lets entry paths that get no stack switch from the CPU (SYSENTER) find
+ * the current task's kernel stack with one load.
+ *
+ * @param cpu_id Logical CPU ID
+ * @return Address of that CPU's ESP0 slot, or 0 for a bad ID
+ */
+uintptr_t gdt_kernel_stack_slot(uint32_t cpu_id);
+
 /**
  * GDT segment selectors
  *
@@ -57,6 +79,6 @@ void gdt_set_kernel_stack(uintptr_t esp0);
 #define GDT_KERNEL_DATA_SEL  0x10  // Entry 2, ring 0
 #define GDT_USER_CODE_SEL    0x1B  // Entry 3, ring 3 (0x18 | 3)
 #define GDT_USER_DATA_SEL    0x23  // Entry 4, ring 3 (0x20 | 3)
-#define GDT_TSS_SEL          0x28  // Entry 5, ring 0
+#define GDT_TSS_SEL          0x28  // Entry 5, ring 0 (CPU 0; CPU n uses + n*8)
 
 #endif // KERNEL_GDT_H
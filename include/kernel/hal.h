@@ -6,7 +6,7 @@
 #include <kernel/types.h>
 
 // Virtual address type (phys_addr_t is defined in types.h)
-typedef uint32_t virt_addr_t;
+typedef uintptr_t virt_addr_t;
 
 // Hardware Abstraction Layer Operations
 // This interface isolates hardware-specific code from the kernel core
@@ -16,12 +16,26 @@ struct hal_ops {
     // Initialize CPU-specific features (GDT, IDT, etc.)
     void (*cpu_init)(void);
 
-    // Get current CPU ID (for SMP systems)
+    // Get current CPU ID: dense logical ID, boot CPU = 0
+    // Hot path (this_cpu()): must be a register or MMIO read, never CPUID
     uint32_t (*cpu_id)(void);
 
     // Halt the CPU until next interrupt
     void (*cpu_halt)(void);
 
+    // Enable interrupts and halt, with no interrupt taken in between:
+    // call with interrupts disabled after checking the wakeup condition
+    void (*cpu_idle_halt)(void);
+
+    // Arm address monitoring on the cache line holding `addr`
+    // (only with HAL_CPU_FEAT_MWAIT)
+    void (*cpu_monitor)(const volatile void* addr);
+
+    // Enable interrupts and wait, in the C-state `hint` asks for, until
+    // the monitored line is written or an interrupt arrives; call with
+    // interrupts disabled after cpu_monitor() and a last check
+    void (*cpu_mwait)(uint32_t hint);
+
     // Detect CPU features (SSE, PAE, etc.)
     uint32_t (*cpu_features)(void);
 
@@ -76,16 +90,22 @@ struct hal_ops {
 
     // ========== SMP/Multicore Operations ==========
 
-    // Get number of CPUs
+    // Discover CPUs and enable the boot CPU's interrupt controller
+    // Call once after mmu_init() and timer_init(); returns the CPU count
+    uint32_t (*smp_detect)(void);
+
+    // Get number of CPUs (found by smp_detect, online or not)
     uint32_t (*smp_num_cpus)(void);
 
-    // Send inter-processor interrupt
+    // Send inter-processor interrupt (ignored for unknown CPUs)
     void (*smp_send_ipi)(uint32_t cpu_id, uint8_t vector);
 
-    // Broadcast IPI to all CPUs
+    // Broadcast IPI to all CPUs except the caller
     void (*smp_broadcast_ipi)(uint8_t vector);
 
-    // Boot a secondary CPU (AP)
+    // Boot a secondary CPU (AP). entry_point runs on the AP with a
+    // private boot stack, paging on and interrupts off; it must not return.
+    // Returns 0 once the AP is running, -EINVAL/-ENODEV/-ENOMEM/-EIO
     int (*smp_boot_cpu)(uint32_t cpu_id, void (*entry_point)(void));
 
     // ========== Timer Operations ==========
@@ -96,7 +116,7 @@ struct hal_ops {
     // Get time in microseconds
     uint64_t (*timer_read_us)(void);
 
-    // Initialize timer hardware
+    // Initialize timer hardware for the calling CPU
     void (*timer_init)(uint32_t frequency_hz);
 
     // ========== Special Operations ==========
@@ -127,6 +147,12 @@ extern struct hal_ops* hal;
 #define HAL_CPU_FEAT_SSE2  (1 << 2)
 #define HAL_CPU_FEAT_PAE   (1 << 3)
 #define HAL_CPU_FEAT_APIC  (1 << 4)
+#define HAL_CPU_FEAT_PSE   (1 << 5)  // 4MB pages
+#define HAL_CPU_FEAT_PGE   (1 << 6)  // Global pages
+#define HAL_CPU_FEAT_FXSR  (1 << 7)  // FXSAVE/FXRSTOR
+#define HAL_CPU_FEAT_SEP   (1 << 8)  // SYSENTER/SYSEXIT
+#define HAL_CPU_FEAT_RDTSCP (1 << 9) // RDTSCP and IA32_TSC_AUX
+#define HAL_CPU_FEAT_MWAIT (1 << 10) // MONITOR/MWAIT in ring 0
 
 // Initialize HAL for specific architecture
 void hal_init(void);
@@ -0,0 +1,110 @@
+#ifndef KERNEL_IDLE_H
+#define KERNEL_IDLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+
+/**
+ * Idle state policy
+ *
+ * What a CPU does when it has nothing to run, from cheapest to leave to
+ * cheapest to stay in:
+ *
+ * 1. Poll: spin on the run queue's need_resched flag for
+ *    CONFIG_IDLE_POLL_US. Work arriving in that window starts without
+ *    any interrupt.
+ * 2. MWAIT: sleep with the flag's cache line monitored (CPUs with
+ *    HAL_CPU_FEAT_MWAIT, CONFIG_IDLE_MWAIT). The store that sets the
+ *    flag wakes the CPU; interrupts still do too.
+ * 3. HLT otherwise: only an interrupt wakes the CPU.
+ *
+ * Wakers go through idle_wake_cpu(): it sets the flag and sends a
+ * reschedule IPI only if the target is neither polling nor in MWAIT.
+ *
+ * Each CPU counts, in TSC cycles, the time spent in each state and the
+ * latency from a remote wakeup request to the idle loop resuming
+ * (struct idle_stats). Latencies compare TSCs of two CPUs and assume
+ * they are synchronized, as on any CPU with an invariant TSC.
+ *
+ * RT Constraints:
+ * - idle_wake_cpu(): O(1), one store plus at most one IPI
+ * - idle_enter(): returns within CONFIG_IDLE_POLL_US of new work when
+ *   polling, else on the flag store (MWAIT) or the IPI (HLT)
+ */
+
+// Where a CPU's idle loop is (per_cpu_data.idle_state)
+enum idle_state {
+    IDLE_RUNNING = 0,   // Not idle, or between idle passes
+    IDLE_POLL,
+    IDLE_MWAIT,
+    IDLE_HLT,
+    IDLE_STATE_COUNT
+};
+
+// Per-CPU idle counters, TSC cycles (owning CPU only)
+struct idle_stats {
+    uint64_t residency[IDLE_STATE_COUNT];   // Time spent per state ([IDLE_RUNNING] unused)
+    uint64_t exits[IDLE_STATE_COUNT];       // Idle passes that ended in each state
+    uint64_t wakeups;                       // Exits requested by idle_wake_cpu()
+    uint64_t wakeups_no_ipi;                // ... of which found it polling or in MWAIT
+    uint64_t wake_latency_total;            // Request until the idle loop resumed
+    uint64_t wake_latency_max;
+};
+
+/**
+ * Choose the idle policy for this machine
+ *
+ * Converts CONFIG_IDLE_POLL_US to TSC cycles and picks MWAIT or HLT.
+ * Call once after the TSC is calibrated (timer_init()) and before any
+ * CPU goes idle; until then idle_enter() only halts.
+ */
+void idle_init(void);
+
+/**
+ * One idle pass of the calling CPU's idle task
+ *
+ * Polls, then sleeps as above. Returns when need_resched is set or
+ * after an interrupt; the caller then reschedules if needed and calls
+ * it again. Interrupts must be enabled on entry and are on return.
+ */
+void idle_enter(void);
+
+/**
+ * Close the calling CPU's idle pass: account the state it was in
+ *
+ * Called by idle_enter() on its way out and by schedule() when it
+ * switches away from the idle task (an interrupt handler preempting a
+ * sleeping idle loop), so a CPU never looks idle to wakers while it
+ * runs a task. No-op if the CPU is not idle. Interrupts disabled.
+ *
+ * RT: O(1)
+ */
+void idle_exit(void);
+
+/**
+ * Make `cpu_id` reschedule
+ *
+ * Sets its need_resched flag; a CPU polling or in MWAIT on it wakes from
+ * the store alone, any other gets a reschedule IPI. Does nothing for the
+ * calling CPU or a CPU without a scheduler (set the local flag directly).
+ *
+ * RT: O(1)
+ */
+void idle_wake_cpu(uint32_t cpu_id);
+
+/**
+ * Copy a CPU's idle counters
+ *
+ * @return 0, or -EINVAL for an unknown CPU
+ */
+int idle_get_stats(uint32_t cpu_id, struct idle_stats* out);
+
+/**
+ * Print every online CPU's idle residency and wakeup latency
+ *
+ * RT: O(CPUs); not for hot paths
+ */
+void idle_dump_stats(void);
+
+#endif // KERNEL_IDLE_H
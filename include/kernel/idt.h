@@ -2,6 +2,7 @@
 #define KERNEL_IDT_H
 
 #include <stdint.h>
+#include <kernel/ioapic.h>
 
 // Interrupt frame structure (matches assembly layout)
 struct interrupt_frame {
@@ -22,15 +23,25 @@ typedef void (*irq_handler_fn)(struct interrupt_frame* frame);
 // Initialize IDT
 void idt_init(void);
 
+// Load the (shared) IDT on the calling CPU; APs call this during bring-up
+void idt_load(void);
+
 // Register/unregister interrupt handlers
 void idt_register_handler(uint8_t num, irq_handler_fn handler);
 void idt_unregister_handler(uint8_t num);
 
-// Enable/disable specific IRQ lines
+// Print an interrupt frame (exception name, error code, registers)
+void idt_dump_frame(const struct interrupt_frame* frame);
+
+// Enable/disable specific ISA IRQ lines (I/O APIC if active, else PIC)
 static inline void irq_clear_mask(uint8_t irq) {
     uint16_t port;
     uint8_t value;
 
+    if (ioapic_active()) {
+        ioapic_unmask(irq);
+        return;
+    }
     if (irq < 8) {
         port = 0x21;
     } else {
@@ -47,6 +58,10 @@ static inline void irq_set_mask(uint8_t irq) {
     uint16_t port;
     uint8_t value;
 
+    if (ioapic_active()) {
+        ioapic_mask(irq);
+        return;
+    }
     if (irq < 8) {
         port = 0x21;
     } else {
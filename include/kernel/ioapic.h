@@ -0,0 +1,100 @@
+/**
+ * x86 I/O APIC
+ *
+ * Routes the 16 ISA IRQs through the I/O APIC instead of the 8259 PIC
+ * when the MP configuration table describes one. IRQ n keeps vector
+ * 32 + n, so handlers registered for PIC vectors keep working; what
+ * changes is that the interrupt is acknowledged with one LAPIC MMIO
+ * write instead of one or two PIC port writes, and that each IRQ can be
+ * sent to any online CPU.
+ *
+ * Without an I/O APIC (or local APIC, or MP table) the PIC stays in
+ * charge and everything here reports -ENODEV. irq_clear_mask() and
+ * irq_set_mask() (kernel/idt.h) pick whichever controller is active.
+ *
+ * Only the first I/O APIC is used, and only for ISA IRQs; PCI inputs
+ * above 15 stay masked.
+ *
+ * RT Constraints:
+ * - ioapic_active(): one load
+ * - Mask, unmask and affinity changes: two MMIO accesses under a lock
+ */
+
+#ifndef KERNEL_IOAPIC_H
+#define KERNEL_IOAPIC_H
+
+#include <kernel/types.h>
+
+#define IOAPIC_ISA_IRQS         16
+#define IOAPIC_VECTOR_BASE      32      // ISA IRQ n -> vector 32 + n
+
+// MP interrupt assignment flags (MP spec table 4-10), kept per ISA IRQ
+#define IOAPIC_FLAG_POLARITY    0x3
+#define IOAPIC_FLAG_ACTIVE_LOW  0x3
+#define IOAPIC_FLAG_TRIGGER     0xC
+#define IOAPIC_FLAG_LEVEL       0xC
+
+// What the MP table says about the I/O APIC (filled in by smp.c)
+struct ioapic_config {
+    phys_addr_t base;                       // 0 = no I/O APIC
+    uint8_t     id;
+    bool        imcr;                       // IMCR present: board starts in PIC mode
+    uint8_t     isa_pin[IOAPIC_ISA_IRQS];   // I/O APIC input of each ISA IRQ
+    uint16_t    isa_flags[IOAPIC_ISA_IRQS]; // IOAPIC_FLAG_* (0 = ISA default, edge high)
+};
+
+// Set while the I/O APIC delivers the ISA IRQs (see ioapic.c)
+extern bool ioapic_routing;
+
+/**
+ * Check whether ISA IRQs come through the I/O APIC
+ *
+ * RT: O(1), one load (irq_handler() runs this for every IRQ)
+ */
+static inline bool ioapic_active(void) {
+    return ioapic_routing;
+}
+
+/**
+ * Identity mapping (IRQ n on input n), ISA default polarity and trigger
+ */
+void ioapic_config_defaults(struct ioapic_config* cfg);
+
+/**
+ * Take the ISA IRQs over from the PIC
+ *
+ * Boot CPU, after lapic_init(). Every IRQ goes to the boot CPU; IRQs
+ * unmasked in the PIC stay unmasked, then the PIC is masked for good.
+ *
+ * @return 0, -ENODEV without an I/O APIC or local APIC, -ENOMEM if the
+ *         registers could not be mapped
+ */
+int ioapic_init(const struct ioapic_config* cfg);
+
+/**
+ * Mask or unmask one ISA IRQ at the I/O APIC
+ *
+ * No-op for IRQs that have no input.
+ */
+void ioapic_mask(uint8_t irq);
+void ioapic_unmask(uint8_t irq);
+
+/**
+ * Deliver one ISA IRQ to a CPU
+ *
+ * Takes effect for the next interrupt; one already in flight still
+ * arrives at the old CPU.
+ *
+ * @return 0, -ENODEV without I/O APIC routing, -EINVAL for an IRQ with
+ *         no input or a CPU that is not online
+ */
+int ioapic_set_affinity(uint8_t irq, uint32_t cpu_id);
+
+/**
+ * CPU an ISA IRQ is delivered to
+ *
+ * @return Logical CPU ID, -ENODEV, -EINVAL for an IRQ with no input
+ */
+int ioapic_get_affinity(uint8_t irq);
+
+#endif // KERNEL_IOAPIC_H
@@ -0,0 +1,95 @@
+#ifndef KERNEL_IPC_H
+#define KERNEL_IPC_H
+
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/spinlock.h>
+
+/**
+ * Synchronous IPC (call / reply-and-wait)
+ *
+ * L4-style RPC on an endpoint: a client's ipc_call() delivers a short
+ * message to the server blocked in ipc_reply_wait() and sleeps until the
+ * reply; the server's next ipc_reply_wait() delivers the reply and sleeps
+ * until the next call. Messages are a few words carried in registers from
+ * user mode (SYS_CALL / SYS_REPLY_WAIT) and in the task struct in
+ * between, never through a buffer.
+ *
+ * When the other side is blocked on this CPU, both directions hand the
+ * CPU over with scheduler_switch_to(): no run queue, no priority search,
+ * and the rest of the time slice travels with the message. An RPC is
+ * then one context switch each way.
+ *
+ * One server per endpoint; callers that find it busy queue FIFO. There
+ * are no timeouts: a caller sleeps until its reply.
+ *
+ * Lock order: endpoint lock, then run queue lock.
+ *
+ * RT Constraints:
+ * - ipc_call(), ipc_reply_wait(): O(1)
+ */
+
+#define IPC_MSG_WORDS       3    // Message registers (EBX, ESI, EDI from user mode)
+#define IPC_MAX_ENDPOINTS   32   // Endpoint IDs handed out to user tasks
+
+struct task;
+
+struct ipc_msg {
+    uint32_t w[IPC_MSG_WORDS];
+};
+
+typedef struct ipc_endpoint {
+    spinlock_t    lock;         // Taken with IRQs off
+    struct task*  server;       // Blocked in ipc_reply_wait(), NULL if none
+    struct task*  callers;      // Waiting for the server, oldest first
+    struct task*  callers_tail;
+
+    // Statistics
+    uint64_t      calls;
+    uint64_t      queued_calls; // Found the server busy
+} ipc_endpoint_t;
+
+/**
+ * Initialize an endpoint
+ *
+ * A zero-filled ipc_endpoint_t is already initialized.
+ */
+void ipc_endpoint_init(ipc_endpoint_t* ep);
+
+/**
+ * Send a request and sleep until the reply
+ *
+ * @param msg  Request in, reply out
+ * @return 0 once replied to, -EPERM from a context that cannot block
+ *
+ * RT: O(1), one context switch when the server is waiting on this CPU
+ */
+int ipc_call(ipc_endpoint_t* ep, struct ipc_msg* msg);
+
+/**
+ * Reply to the last caller, then wait for the next request
+ *
+ * The first call (nobody to reply to yet) only waits. With a caller
+ * queued, returns at once with its request and the replied-to caller is
+ * made runnable the normal way.
+ *
+ * @param msg  Reply in (ignored without a caller), next request out
+ * @return 0 with a request, -EBUSY if another task serves the endpoint,
+ *         -EPERM from a context that cannot block
+ *
+ * RT: O(1), one context switch back to the caller when nothing is queued
+ */
+int ipc_reply_wait(ipc_endpoint_t* ep, struct ipc_msg* msg);
+
+/**
+ * Endpoint IDs for user tasks
+ *
+ * ipc_endpoint_create() claims one of IPC_MAX_ENDPOINTS static endpoints
+ * and returns its ID (1..IPC_MAX_ENDPOINTS), or -ENOMEM once all are
+ * taken. ipc_endpoint_lookup() returns the endpoint or NULL. Endpoints
+ * are never freed: a task may be asleep on any of them.
+ */
+int ipc_endpoint_create(void);
+ipc_endpoint_t* ipc_endpoint_lookup(int id);
+
+#endif // KERNEL_IPC_H
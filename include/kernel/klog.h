@@ -0,0 +1,118 @@
+#ifndef KERNEL_KLOG_H
+#define KERNEL_KLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/types.h>
+
+/**
+ * Buffered console log
+ *
+ * kprintf() output goes through klog_write(). Early in boot that writes
+ * straight to the console backends, as before. Once klog_start() has run,
+ * it only appends a record to the calling CPU's ring, and a low-priority
+ * kernel thread ("klogd") writes the records out, so code that prints no
+ * longer waits for the UART and the VGA memory.
+ *
+ * Each CPU's ring has one producer (that CPU, with interrupts off while it
+ * appends) and one consumer (whoever holds the drain lock), so appending
+ * takes no lock and no locked instruction. Records carry a TSC stamp; the
+ * drainer merges the rings oldest record first. Color changes and clears
+ * from vga_set_color()/vga_clear() are records too, so they stay in order
+ * with the text around them.
+ *
+ * A full ring drops the record and counts it; the drainer reports the
+ * count. Nothing a producer does ever waits.
+ *
+ * klog_panic_flush() writes out whatever is queued from the panicking CPU
+ * and switches back to direct output for good.
+ *
+ * RT Constraints:
+ * - klog_write(), klog_set_color(), klog_clear(): O(len) copy with
+ *   interrupts off once buffering is on; direct output before that
+ * - klog_flush(): O(queued bytes), writes to the backends
+ */
+
+#define KLOG_RING_SIZE      (16 * 1024)   // Per CPU, a power of two
+#define KLOG_RECORD_MAX     256           // Longer writes are split
+#define KLOG_DRAIN_US       10000         // klogd poll period
+
+typedef enum {
+    KLOG_REC_TEXT = 0,
+    KLOG_REC_COLOR,     // arg = fg | bg << 4
+    KLOG_REC_CLEAR,
+} klog_rec_type_t;
+
+struct klog_stats {
+    uint64_t records;   // Appended to the rings
+    uint64_t bytes;     // Text bytes appended
+    uint64_t dropped;   // Records lost to a full ring
+    uint64_t drained;   // Records written out
+};
+
+/**
+ * Allocate a ring for every CPU
+ *
+ * Safe to call more than once. Does not turn buffering on.
+ *
+ * @return 0, -ENOMEM
+ */
+int klog_init(void);
+
+/**
+ * Turn buffering on or off
+ *
+ * Turning it off does not flush; call klog_flush() for that.
+ *
+ * @return 0, -ENODEV if klog_init() has not succeeded
+ */
+int klog_buffer(bool on);
+
+/**
+ * Allocate the rings, start klogd and turn buffering on
+ *
+ * Call once the scheduler is up.
+ *
+ * @return 0, -ENOMEM
+ */
+int klog_start(void);
+
+/**
+ * Write text to the console (buffered or direct)
+ */
+void klog_write(const char* str, size_t len);
+
+/**
+ * Change the VGA color, in order with the text around it
+ */
+void klog_set_color(uint8_t fg, uint8_t bg);
+
+/**
+ * Clear the VGA screen, in order with the text around it
+ */
+void klog_clear(void);
+
+/**
+ * Write out everything queued so far
+ *
+ * Returns at once if another CPU is draining.
+ */
+void klog_flush(void);
+
+/**
+ * Panic mode: write out what is queued, then print directly from now on
+ *
+ * Does not wait for a drainer on another CPU.
+ */
+void klog_panic_flush(void);
+
+/**
+ * Records queued in all rings
+ *
+ * Exact only while nothing prints or drains; meant for tests.
+ */
+uint32_t klog_pending(void);
+
+void klog_get_stats(struct klog_stats* stats);
+
+#endif // KERNEL_KLOG_H
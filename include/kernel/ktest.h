@@ -81,4 +81,67 @@ struct ktest {
 int ktest_run_all(void);
 int ktest_run_subsystem(const char *subsystem);
 
+struct task;
+
+// Probe run on a queued task (ktest_run_queued())
+typedef int (*ktest_queued_fn)(struct task *task, void *arg);
+
+/**
+ * Run `probe` on a task that sits on this CPU's ready queue
+ *
+ * For tests in the bootstrap context, which cannot switch away. Enqueues
+ * `task` (created, never run) with interrupts off so nothing can run it,
+ * calls probe(task, arg), then dequeues it, drops the need_resched the
+ * enqueue may have raised and destroys the task. The probe may use
+ * KTEST_ASSERT: the cleanup runs whatever it returns.
+ *
+ * @return The probe's result, or KTEST_FAIL if `task` is NULL
+ */
+int ktest_run_queued(struct task *task, ktest_queued_fn probe, void *arg);
+
+/**
+ * Microbenchmarks (kbench, built with -DKERNEL_BENCH)
+ *
+ * A benchmark function performs the operation once and returns what it
+ * cost in TSC cycles, timing only the operation itself (any undo work
+ * goes after the second TSC read). The runner calls it KBENCH_WARMUP
+ * times untimed, then KBENCH_SAMPLES times, subtracts the cost of an
+ * empty TSC read pair and reports min/median/p99/max.
+ *
+ * A nonzero budget is checked against the median (the typical cost;
+ * p99 and max show refills and cache misses, and what an emulator
+ * adds). Benchmarks run where ktests do: boot CPU, IRQs off.
+ */
+#define KBENCH_WARMUP   32
+#define KBENCH_SAMPLES  512
+
+typedef uint64_t (*kbench_fn)(void);
+
+struct kbench {
+    const char *name;
+    const char *subsystem;
+    int       (*setup)(void);    // Optional, nonzero skips the benchmark
+    kbench_fn   bench_fn;
+    void      (*teardown)(void); // Optional
+    uint32_t    budget_cycles;   // 0: report only
+};
+
+#define KBENCH_DEFINE_SETUP(subsys, benchname, setup_fn, fn, teardown_fn, budget) \
+    static struct kbench __kbench_##benchname \
+    __attribute__((section(".kbenches"), used)) = { \
+        .name = #benchname, \
+        .subsystem = subsys, \
+        .setup = setup_fn, \
+        .bench_fn = fn, \
+        .teardown = teardown_fn, \
+        .budget_cycles = budget \
+    }
+
+#define KBENCH_DEFINE(subsys, benchname, fn, budget) \
+    KBENCH_DEFINE_SETUP(subsys, benchname, NULL, fn, NULL, budget)
+
+// Benchmark runner
+// Returns number of benchmarks over budget (0 = all within)
+int ktest_bench_all(void);
+
 #endif // KERNEL_KTEST_H
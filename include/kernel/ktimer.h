@@ -0,0 +1,132 @@
+#ifndef KERNEL_KTIMER_H
+#define KERNEL_KTIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+
+/**
+ * Kernel Timers (hierarchical timing wheel)
+ *
+ * One-shot callbacks at microsecond deadlines, for kernel subsystems and
+ * for sleeping tasks (task_sleep_us()). Each CPU owns a wheel of
+ * KTIMER_LEVELS levels with KTIMER_SLOTS slots each; level L slots are
+ * KTIMER_SLOTS^L wheel ticks wide. A timer sits in the level its delay
+ * falls into and cascades one level down whenever the level below wraps,
+ * so insert and cancel never search.
+ *
+ * The wheel advances from the timer interrupt (every tick, or at the
+ * tickless deadline ktimer_next_deadline_us() reports).
+ *
+ * RT Constraints:
+ * - ktimer_add()/ktimer_cancel(): O(1)
+ * - ktimer_run(): O(expired + cascaded + elapsed / KTIMER_SLOTS)
+ * - Callbacks run in interrupt context with interrupts disabled: they
+ *   must not block and should only wake tasks or queue work
+ */
+
+// Wheel geometry: 64us ticks, 4 levels of 64 slots (~17.9 minutes);
+// longer delays wait in the top level and are re-filed until due
+#define KTIMER_TICK_SHIFT   6
+#define KTIMER_TICK_US      (1u << KTIMER_TICK_SHIFT)
+#define KTIMER_SLOT_BITS    6
+#define KTIMER_SLOTS        (1u << KTIMER_SLOT_BITS)
+#define KTIMER_LEVELS       4
+
+// No pending timer (ktimer_next_deadline_us())
+#define KTIMER_NO_DEADLINE  UINT64_MAX
+
+struct ktimer;
+
+/**
+ * Timer callback
+ *
+ * @param timer The expired timer (no longer pending; may be re-added)
+ * @param arg   Argument given to ktimer_init()
+ */
+typedef void (*ktimer_fn)(struct ktimer* timer, void* arg);
+
+/**
+ * Timer (embedded in the owner's structure, never allocated here)
+ *
+ * Initialize with ktimer_init(); all other fields are private.
+ */
+struct ktimer {
+    struct ktimer* next;        // Slot list linkage
+    struct ktimer* prev;
+    uint64_t       expires;     // Absolute wheel tick
+    ktimer_fn      fn;
+    void*          arg;
+    uint32_t       cpu;         // Owning wheel (valid while pending)
+    uint8_t        level;       // Position in the wheel (valid while pending)
+    uint8_t        slot;
+    bool           pending;     // Queued and not yet fired or cancelled
+};
+
+/**
+ * Prepare a timer
+ *
+ * RT: O(1)
+ */
+void ktimer_init(struct ktimer* timer, ktimer_fn fn, void* arg);
+
+/**
+ * Arm a timer on the calling CPU
+ *
+ * The callback runs on this CPU, no earlier than delay_us from now
+ * (rounded up to the next wheel tick).
+ *
+ * @return 0 on success, -EINVAL without a callback, -EBUSY if already
+ *         pending (cancel first to re-arm)
+ *
+ * RT: O(1)
+ */
+int ktimer_add(struct ktimer* timer, uint64_t delay_us);
+
+/**
+ * Disarm a timer
+ *
+ * Safe from any CPU. If the callback is already running it is not
+ * waited for.
+ *
+ * @return true if the timer was pending (its callback will not run)
+ *
+ * RT: O(1)
+ */
+bool ktimer_cancel(struct ktimer* timer);
+
+/**
+ * Disarm a timer and wait out a callback already in progress
+ *
+ * After this returns the timer is neither pending nor running, so it may
+ * be freed (e.g. when it lives on the caller's stack). Must not be called
+ * from the timer's own callback, or on its CPU with interrupts off.
+ *
+ * @return true if the timer was pending (its callback will not run)
+ *
+ * RT: O(1), plus the remaining callback time if one is running
+ */
+bool ktimer_cancel_sync(struct ktimer* timer);
+
+/**
+ * Run every timer on the calling CPU's wheel that is due by now_us
+ *
+ * Called from the timer interrupt with interrupts disabled.
+ *
+ * @param now_us Current time (timer_read_us() timebase)
+ */
+void ktimer_run(uint64_t now_us);
+
+/**
+ * Latest time the calling CPU must wake up to keep its timers on time
+ *
+ * Exact for timers in the lowest level; otherwise the next cascade point,
+ * where the wheel refiles and reports again.
+ *
+ * @return Absolute time in microseconds, or KTIMER_NO_DEADLINE
+ *
+ * RT: O(1)
+ */
+uint64_t ktimer_next_deadline_us(void);
+
+#endif // KERNEL_KTIMER_H
@@ -0,0 +1,128 @@
+/**
+ * x86 Local APIC
+ *
+ * Per-CPU interrupt controller: CPU identity, end-of-interrupt,
+ * inter-processor interrupts and the per-CPU timer. External IRQs come
+ * through the I/O APIC when there is one (kernel/ioapic.h), else through
+ * the 8259 PIC on the boot CPU (virtual wire mode). The vectors below are
+ * raised by the local APIC itself; they, and I/O APIC IRQs, are
+ * acknowledged with lapic_eoi() instead of a PIC EOI.
+ *
+ * RT Constraints:
+ * - lapic_id()/lapic_eoi(): O(1), one uncached MMIO access
+ * - lapic_send_ipi(): O(1), bounded wait for the previous IPI to leave
+ */
+
+#ifndef KERNEL_LAPIC_H
+#define KERNEL_LAPIC_H
+
+#include <kernel/types.h>
+
+// Default physical base (overridden by the MP configuration table)
+#define LAPIC_DEFAULT_BASE   0xFEE00000u
+
+// Vectors delivered by the local APIC (>= LAPIC_VECTOR_FIRST)
+#define LAPIC_VECTOR_FIRST   0xEF
+#define LAPIC_TIMER_VECTOR   0xEF
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// Largest APIC ID in xAPIC mode
+#define LAPIC_MAX_ID         255
+
+// Longest delay a single timer one-shot is armed for
+#define LAPIC_ONESHOT_MAX_US 1000000
+
+/**
+ * Map and enable the boot CPU's local APIC
+ *
+ * Must run after mmu_init() (the registers are mapped uncached into the
+ * kernel address space) and after timer_init() (the APIC timer is
+ * calibrated against the TSC).
+ *
+ * @param phys_base Physical register base (LAPIC_DEFAULT_BASE if unknown)
+ * @return 0 on success, -ENODEV without an APIC, -ENOMEM if the
+ *         registers could not be mapped
+ */
+int lapic_init(phys_addr_t phys_base);
+
+/**
+ * Enable the calling AP's local APIC and start its periodic timer
+ *
+ * Masks LINT0 so only the boot CPU takes PIC interrupts.
+ */
+void lapic_init_ap(void);
+
+/**
+ * Check whether the local APIC is mapped and enabled
+ */
+bool lapic_available(void);
+
+/**
+ * APIC ID of the calling CPU
+ *
+ * RT: O(1), one MMIO read
+ */
+uint32_t lapic_id(void);
+
+/**
+ * Deliver the calling CPU's performance counter overflows as NMIs
+ *
+ * Most CPUs mask the entry when they deliver one; the handler calls
+ * this again to re-arm it. enable = false masks it.
+ */
+void lapic_perf_nmi(bool enable);
+
+/**
+ * Signal end-of-interrupt for a LAPIC-delivered vector
+ *
+ * RT: O(1), one MMIO write
+ */
+void lapic_eoi(void);
+
+/**
+ * Send a fixed-vector IPI to one CPU
+ *
+ * @param apic_id Destination APIC ID
+ * @param vector  Interrupt vector (>= 32)
+ */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+
+/**
+ * Send a fixed-vector IPI to every CPU except the caller
+ */
+void lapic_broadcast_ipi(uint8_t vector);
+
+/**
+ * Send INIT followed by two STARTUP IPIs (Intel MP spec B.4)
+ *
+ * @param apic_id Destination APIC ID
+ * @param page    Trampoline physical address (page-aligned, below 1MB)
+ * @return 0 on success, -EIO if the IPIs were never accepted
+ */
+int lapic_start_ap(uint32_t apic_id, phys_addr_t page);
+
+/**
+ * Start the calling CPU's APIC timer in periodic mode
+ *
+ * @param frequency_hz Interrupt rate (vector LAPIC_TIMER_VECTOR)
+ * @return 0 on success, -ENODEV if the timer was not calibrated
+ */
+int lapic_timer_start(uint32_t frequency_hz);
+
+/**
+ * Arm the calling CPU's APIC timer for one interrupt
+ *
+ * @param delay_us Microseconds until LAPIC_TIMER_VECTOR fires (capped
+ *                 at LAPIC_ONESHOT_MAX_US; the caller re-arms)
+ * @return 0 on success, -ENODEV if the timer was not calibrated
+ *
+ * RT: O(1), three MMIO writes, no division
+ */
+int lapic_timer_oneshot(uint32_t delay_us);
+
+/**
+ * Stop the calling CPU's APIC timer
+ */
+void lapic_timer_stop(void);
+
+#endif // KERNEL_LAPIC_H
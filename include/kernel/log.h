@@ -0,0 +1,125 @@
+#ifndef KERNEL_LOG_H
+#define KERNEL_LOG_H
+
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/config.h>
+#include <kernel/spinlock.h>
+#include <drivers/vga.h>
+
+/**
+ * Leveled, per-subsystem logging over kprintf()
+ *
+ *   log_info(SCHED, "Scheduler initialized (CPU %u)\n", cpu);
+ *   -> "[SCHED] Scheduler initialized (CPU 0)"
+ *
+ * Levels above CONFIG_LOG_LEVEL (kernel/config.h) are compiled out: the
+ * test is a constant, so the call and its format string vanish from the
+ * binary while the arguments are still type-checked. Below that, each
+ * subsystem can be switched off at run time (log_set_enabled()).
+ *
+ * The *_ratelimited variants allow LOG_RATELIMIT_BURST messages per call
+ * site every LOG_RATELIMIT_INTERVAL_US and count the rest; the count is
+ * printed when the next window opens. Use them for anything that can
+ * print from interrupt context or a hot path.
+ *
+ * RT: a disabled message costs one load and a branch (nothing at all
+ * above CONFIG_LOG_LEVEL); an enabled one costs kprintf() (buffered once
+ * klog_start() has run, see kernel/klog.h)
+ */
+
+#define LOG_LEVEL_ERR      1
+#define LOG_LEVEL_WARN     2
+#define LOG_LEVEL_INFO     3
+#define LOG_LEVEL_DEBUG    4
+
+#define LOG_RATELIMIT_BURST        5
+#define LOG_RATELIMIT_INTERVAL_US  1000000
+
+// Subsystem tags; the name is also the printed "[TAG]"
+#define LOG_SUBSYSTEMS(X) \
+    X(INIT)    \
+    X(TIMER)   \
+    X(PMM)     \
+    X(SLAB)    \
+    X(MMU)     \
+    X(TASK)    \
+    X(SCHED)   \
+    X(SMP)     \
+    X(SYSCALL) \
+    X(USER)    \
+    X(IPC)     \
+    X(FPU)     \
+    X(KLOG)    \
+    X(SERIAL)
+
+enum log_subsystem {
+#define LOG_SUBSYSTEM_ENUM(name) LOG_SUB_##name,
+    LOG_SUBSYSTEMS(LOG_SUBSYSTEM_ENUM)
+#undef LOG_SUBSYSTEM_ENUM
+    LOG_SUB_COUNT
+};
+
+_Static_assert(LOG_SUB_COUNT <= 32, "log_enabled_mask is 32 bits");
+
+// Bit per subsystem, all on at boot
+extern volatile uint32_t log_enabled_mask;
+
+// Per-call-site rate limiter state (zero-initialized)
+struct log_ratelimit {
+    uint64_t   window_start_us;
+    uint32_t   printed;
+    uint32_t   suppressed;
+    spinlock_t lock;
+};
+
+#define log_compiled(level)       ((level) <= CONFIG_LOG_LEVEL)
+#define log_enabled(level, sub) \
+    (log_compiled(level) && (log_enabled_mask & (1u << LOG_SUB_##sub)))
+
+#define log_printf(level, sub, prefix, fmt, ...) do { \
+        if (log_enabled(level, sub)) { \
+            kprintf("[" #sub "] " prefix fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define log_printf_ratelimited(level, sub, prefix, fmt, ...) do { \
+        static struct log_ratelimit log_rl_; \
+        if (log_enabled(level, sub) && log_ratelimit_allow(&log_rl_, #sub)) { \
+            kprintf("[" #sub "] " prefix fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define log_err(sub, fmt, ...)    log_printf(LOG_LEVEL_ERR, sub, "ERROR: ", fmt, ##__VA_ARGS__)
+#define log_warn(sub, fmt, ...)   log_printf(LOG_LEVEL_WARN, sub, "WARNING: ", fmt, ##__VA_ARGS__)
+#define log_info(sub, fmt, ...)   log_printf(LOG_LEVEL_INFO, sub, "", fmt, ##__VA_ARGS__)
+#define log_debug(sub, fmt, ...)  log_printf(LOG_LEVEL_DEBUG, sub, "", fmt, ##__VA_ARGS__)
+
+#define log_warn_ratelimited(sub, fmt, ...) \
+    log_printf_ratelimited(LOG_LEVEL_WARN, sub, "WARNING: ", fmt, ##__VA_ARGS__)
+#define log_info_ratelimited(sub, fmt, ...) \
+    log_printf_ratelimited(LOG_LEVEL_INFO, sub, "", fmt, ##__VA_ARGS__)
+#define log_debug_ratelimited(sub, fmt, ...) \
+    log_printf_ratelimited(LOG_LEVEL_DEBUG, sub, "", fmt, ##__VA_ARGS__)
+
+/**
+ * Rate limiter check for one call site
+ *
+ * Never waits: a call racing another CPU on the same site is suppressed.
+ *
+ * @param tag  Printed with the suppressed count
+ * @return true if the message may be printed
+ */
+bool log_ratelimit_allow(struct log_ratelimit* rl, const char* tag);
+
+/**
+ * Switch a subsystem's messages on or off at run time
+ */
+void log_set_enabled(enum log_subsystem sub, bool on);
+
+/**
+ * Subsystem by tag name (e.g. "SCHED"), -EINVAL if unknown
+ */
+int log_subsystem_lookup(const char* name);
+
+#endif // KERNEL_LOG_H
@@ -35,6 +35,8 @@ typedef uintptr_t virt_addr_t;
 #define MMU_USER      (1 << 2)  // Page is accessible from user mode
 #define MMU_NOCACHE   (1 << 3)  // Page is not cached (for MMIO)
 #define MMU_EXEC      (1 << 4)  // Page is executable (if arch supports NX)
+#define MMU_GLOBAL    (1 << 5)  // Same mapping in every address space: TLB
+                                // entry survives address space switches
 
 /**
  * Create a new address space
@@ -51,11 +53,28 @@ typedef uintptr_t virt_addr_t;
  */
 page_table_t* mmu_create_address_space(void);
 
+/**
+ * Create an address space for a user task
+ *
+ * Like mmu_create_address_space(), but every directory slot outside the
+ * user window (USER_CODE_BASE up to USER_STACK_TOP, see kernel/user.h)
+ * is copied from the kernel address space, so the identity map, kernel
+ * stacks and MMIO stay reachable while the task runs. The kernel's page
+ * tables are shared, not copied: kernel mappings created later are seen
+ * only if they land in a page table that already existed.
+ *
+ * @return Pointer to new address space, or NULL on failure
+ *
+ * RT: O(1) - one page directory frame and a 4KB copy
+ */
+page_table_t* mmu_create_user_address_space(void);
+
 /**
  * Destroy an address space
  *
- * Frees all page tables associated with the address space.
- * Does NOT free the physical pages mapped into the address space.
+ * Releases every reserved region and frees all page tables associated
+ * with the address space (except the kernel's, for a user address space).
+ * Does NOT free physical pages mapped with mmu_map_page().
  * The caller is responsible for tracking and freeing those separately.
  *
  * @param pt Address space to destroy
@@ -85,6 +104,29 @@ void mmu_destroy_address_space(page_table_t* pt);
 void* mmu_map_page(page_table_t* pt, phys_addr_t phys,
                    virt_addr_t virt, uint32_t flags);
 
+/**
+ * Map a physically contiguous range
+ *
+ * Maps [virt, virt + len) to [phys, phys + len). Where both addresses are
+ * aligned to the architecture's large page size and the CPU supports it
+ * (4MB PSE pages on x86), one large mapping replaces a whole page table.
+ * The TLB is flushed once for the range instead of once per page.
+ * Large mappings are split transparently by later mmu_map_page() or
+ * mmu_unmap_page() calls inside them.
+ *
+ * @param pt Address space to map into
+ * @param phys Physical start address (must be page-aligned)
+ * @param virt Virtual start address (must be page-aligned)
+ * @param len Length in bytes (must be a multiple of PAGE_SIZE)
+ * @param flags Page flags (MMU_PRESENT | MMU_WRITABLE | etc)
+ * @return 0 on success, -EINVAL on bad arguments, -ENOMEM if page tables
+ *         ran out (the range is then mapped only partially)
+ *
+ * NOT RT-safe: O(len / PAGE_SIZE). Use at init and unit creation.
+ */
+int mmu_map_range(page_table_t* pt, phys_addr_t phys, virt_addr_t virt,
+                  size_t len, uint32_t flags);
+
 /**
  * Unmap a virtual address
  *
@@ -100,6 +142,136 @@ void* mmu_map_page(page_table_t* pt, phys_addr_t phys,
  */
 void mmu_unmap_page(page_table_t* pt, virt_addr_t virt);
 
+// Lazily populated regions per address space
+#define MMU_MAX_REGIONS 8
+
+/**
+ * Reserve a demand-paged virtual region
+ *
+ * Records [start, start + len) as backed by anonymous memory without
+ * allocating anything. The first access to each page faults, and the
+ * page-fault handler maps a fresh zeroed frame with `flags`. Frames
+ * committed this way belong to the address space and are freed by
+ * mmu_release_region() or mmu_destroy_address_space().
+ *
+ * @param pt Address space
+ * @param start Region start (must be page-aligned)
+ * @param len Region length in bytes (page multiple, > 0)
+ * @param flags Mapping flags for committed pages (MMU_WRITABLE | MMU_USER ...)
+ * @return 0 on success, -EINVAL on bad arguments, -EBUSY if the range
+ *         overlaps another region, -ENOMEM if MMU_MAX_REGIONS are in use
+ *
+ * RT: O(MMU_MAX_REGIONS), no memory is allocated
+ */
+int mmu_reserve_region(page_table_t* pt, virt_addr_t start, size_t len, uint32_t flags);
+
+/**
+ * Reserve a demand-paged region backed by existing physical memory
+ *
+ * Like mmu_reserve_region(), but the first `backing_len` bytes of the
+ * region read as the physically contiguous bytes at `backing` (a file
+ * image, such as an ELF segment in a boot module), the rest as zeros.
+ * Whole backing pages are mapped in place, read-only, so any number of
+ * address spaces share them without copying; in a writable region the
+ * first write to one commits a private copy (copy-on-write). A page the
+ * backing store covers only partly gets a private copy on first touch.
+ *
+ * The backing memory is never freed by the region and must stay
+ * allocated (reserved) for as long as any region uses it.
+ *
+ * @param backing Page-aligned physical address of the backing bytes
+ * @param backing_len Backed bytes from `start`, at most `len` (0 = anonymous)
+ * @return As mmu_reserve_region()
+ *
+ * RT: O(MMU_MAX_REGIONS), no memory is allocated
+ */
+int mmu_reserve_backed_region(page_table_t* pt, virt_addr_t start, size_t len, uint32_t flags,
+                              phys_addr_t backing, size_t backing_len);
+
+/**
+ * Release a region created by mmu_reserve_region()
+ *
+ * Unmaps and frees every page committed in the region (backing frames
+ * are only unmapped).
+ *
+ * @param pt Address space
+ * @param start Start address the region was reserved with
+ * @return 0 on success, -EINVAL if no region starts at `start`
+ *
+ * NOT RT-safe: O(region pages)
+ */
+int mmu_release_region(page_table_t* pt, virt_addr_t start);
+
+/**
+ * Resolve a page fault against the reserved regions
+ *
+ * Called by the architecture's page-fault handler. Commits a frame when
+ * `addr` lies in a region, the page is not present, and the access is
+ * allowed by the region's flags: zeroed, or from the backing store (see
+ * mmu_reserve_backed_region()). A write to a shared backing page of a
+ * writable region replaces it by a private copy.
+ *
+ * @param pt Address space active at the time of the fault
+ * @param addr Faulting virtual address
+ * @param write Fault was caused by a write
+ * @param user Fault was raised in user mode
+ * @return 0 if the page was mapped, -EFAULT if the access is invalid,
+ *         -ENOMEM if no frame or page table could be allocated
+ *
+ * RT: O(MMU_MAX_REGIONS) plus one frame allocation
+ */
+int mmu_handle_fault(page_table_t* pt, virt_addr_t addr, bool write, bool user);
+
+/**
+ * Make a user page accessible to the kernel before touching it
+ *
+ * For syscalls that dereference user pointers: succeeds if the page is
+ * mapped for user mode (writable if `write`), committing it first if it
+ * lies in a reserved region, so the access cannot fault fatally.
+ *
+ * @return 0 if the access is safe, -EFAULT if user mode could not make
+ *         it either, -ENOMEM if committing failed
+ *
+ * RT: O(1) if mapped, else as mmu_handle_fault()
+ */
+int mmu_prefault_user(page_table_t* pt, virt_addr_t addr, bool write);
+
+/**
+ * Detach a committed page of a reserved region
+ *
+ * Unmaps `virt` and hands the region's reference on its frame to the
+ * caller, who must pass it on (mmu_region_give_page()) or drop it
+ * (pmm_page_put()). The page reads as untouched again afterwards, so the
+ * next access commits a fresh zeroed frame. For moving pages between
+ * address spaces without copying.
+ *
+ * @param pt Address space
+ * @param virt Page-aligned address inside a region
+ * @param frame Receives the detached frame
+ * @return 0 on success, -EFAULT if `virt` is not a committed region page
+ *         (shared backing pages are not: they belong to nobody)
+ *
+ * RT: O(MMU_MAX_REGIONS)
+ */
+int mmu_region_take_page(page_table_t* pt, virt_addr_t virt, phys_addr_t* frame);
+
+/**
+ * Install a frame as a page of a reserved region
+ *
+ * Maps `frame` at `virt` with the region's flags and takes over the
+ * caller's reference on it; the region then frees it like any page it
+ * committed itself. A frame already committed at `virt` is released.
+ *
+ * @param pt Address space
+ * @param virt Page-aligned address inside a region
+ * @param frame Page-aligned frame the caller holds a reference on
+ * @return 0 on success, -EFAULT if `virt` is not in a region, -ENOMEM if
+ *         no page table could be allocated (the caller keeps the frame)
+ *
+ * RT: O(MMU_MAX_REGIONS) plus at most one page table allocation
+ */
+int mmu_region_give_page(page_table_t* pt, virt_addr_t virt, phys_addr_t frame);
+
 /**
  * Switch to a different address space
  *
@@ -119,8 +291,8 @@ void mmu_switch_address_space(page_table_t* pt);
 /**
  * Get current address space
  *
- * Returns the currently active address space by reading the CPU's
- * address space register (e.g., CR3 on x86).
+ * Returns the address space this CPU last loaded with
+ * mmu_switch_address_space() (tracked per CPU, no register read).
  *
  * @return Current address space
  *
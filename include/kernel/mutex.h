@@ -0,0 +1,133 @@
+#ifndef KERNEL_MUTEX_H
+#define KERNEL_MUTEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+#include <kernel/config.h>
+#include <kernel/task.h>
+#include <kernel/waitqueue.h>
+
+/**
+ * Priority-Inheritance Mutexes
+ *
+ * Sleeping locks for task context. While a task waits, the owner runs at
+ * the waiter's priority if that is higher, and so on down a chain of
+ * owners blocked on further mutexes (up to MUTEX_PI_MAX_DEPTH), so a
+ * low-priority holder cannot be starved by medium-priority work while a
+ * high-priority task waits (priority inversion). Unlock hands the mutex
+ * straight to the highest-priority waiter and drops the old owner back
+ * to the highest priority it still inherits.
+ *
+ * The uncontended paths are a single compare-and-swap each; waiters and
+ * boosts are serialized by one PI lock (lock order: PI lock, wait queue,
+ * run queue).
+ *
+ * Every named mutex keeps statistics and is listed by
+ * mutex_dump_stats(), to find contended locks.
+ *
+ * RT Constraints:
+ * - Uncontended lock/unlock: O(1)
+ * - Boost/unboost: O(1) run queue moves (scheduler_set_priority()),
+ *   O(MUTEX_PI_MAX_DEPTH) along a chain
+ * - Contended unlock: O(waiters) to pick the next owner, plus
+ *   O(waiters of other held mutexes) to recompute the inherited priority
+ * - Not for interrupt context: contended lock blocks
+ */
+
+#define MUTEX_PI_MAX_DEPTH  8       // Owner chain length boosts follow
+
+/**
+ * Lock statistics
+ *
+ * Updated by the owner while it holds the mutex, so a snapshot taken by
+ * anyone else may be slightly stale but never torn per field. Times are
+ * in microseconds and only kept with CONFIG_MUTEX_STATS.
+ */
+struct mutex_stats {
+    uint64_t acquisitions;          // Successful locks
+    uint64_t contentions;           // Locks that had to wait
+    uint64_t wait_total_us;         // Time spent waiting, all contentions
+    uint64_t wait_max_us;
+    uint64_t hold_total_us;         // Time held, all acquisitions
+    uint64_t hold_max_us;
+};
+
+/**
+ * Mutex
+ *
+ * A zero-filled mutex is unlocked, unnamed and unlisted; mutex_init()
+ * names it and lists it for mutex_dump_stats().
+ */
+typedef struct mutex {
+    atomic_t           owner;       // Owning task | MUTEX_HAS_WAITERS, 0 = free
+    wait_queue_t       waiters;     // Blocked lockers (PI lock held to queue)
+    struct mutex*      held_next;   // Owner's held_mutexes list
+    const char*        name;
+    struct mutex*      list_next;   // Statistics registry
+    uint64_t           acquired_us; // When the current owner got it
+    struct mutex_stats stats;
+} mutex_t;
+
+// Owner word flag: someone is or is about to be queued (forces slow unlock)
+#define MUTEX_HAS_WAITERS   1u
+
+/**
+ * Initialize an unlocked mutex and register it for statistics
+ *
+ * @param name  Static string shown by mutex_dump_stats() (NULL = unlisted)
+ */
+void mutex_init(mutex_t* m, const char* name);
+
+/**
+ * Acquire a mutex, blocking while another task holds it
+ *
+ * @return 0 once held, -EDEADLK if the caller already holds it, -EPERM
+ *         if it is held elsewhere and the caller cannot block (idle or
+ *         bootstrap context)
+ *
+ * RT: O(1) uncontended; bounded by the owner's critical section otherwise
+ */
+int mutex_lock(mutex_t* m);
+
+/**
+ * Acquire a mutex only if it is free
+ *
+ * @return true if the caller now holds it
+ *
+ * RT: O(1)
+ */
+bool mutex_trylock(mutex_t* m);
+
+/**
+ * Release a mutex held by the caller
+ *
+ * Hands it to the highest-priority waiter, if any, and gives up any
+ * priority inherited through it (which may preempt the caller).
+ *
+ * @return 0 on success, -EPERM if the caller is not the owner
+ *
+ * RT: O(1) uncontended; O(waiters) contended
+ */
+int mutex_unlock(mutex_t* m);
+
+/**
+ * Current owner, or NULL if unlocked (racy unless the caller owns it)
+ */
+static inline task_t* mutex_owner(const mutex_t* m) {
+    return (task_t*)(uintptr_t)(atomic_read(&m->owner) & ~MUTEX_HAS_WAITERS);
+}
+
+/**
+ * Copy a mutex's statistics
+ */
+void mutex_get_stats(const mutex_t* m, struct mutex_stats* out);
+
+/**
+ * Print every named mutex that has ever been contended
+ *
+ * RT: O(named mutexes); not for hot paths
+ */
+void mutex_dump_stats(void);
+
+#endif // KERNEL_MUTEX_H
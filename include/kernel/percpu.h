@@ -2,17 +2,25 @@
 #define KERNEL_PERCPU_H
 
 #include <kernel/types.h>
+#include <kernel/pmm.h>
+#include <kernel/idle.h>
+#include <kernel/config.h>
 
 // Maximum number of CPUs supported
 #define MAX_CPUS 256
 
-// Trace buffer size per CPU
-#define TRACE_BUFFER_SIZE 1024
+// Trace buffer size per CPU (events, power of two)
+#define TRACE_BUFFER_SIZE CONFIG_TRACE_BUFFER_SIZE
+
+_Static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0,
+               "trace buffer size must be a power of two");
 
 // Forward declarations
 struct task;
+struct page_table;
+struct scheduler;
 
-// Trace event types
+// Trace event types (data words per type: see include/kernel/trace.h)
 enum trace_event_type {
     TRACE_INTERRUPT = 0,
     TRACE_SCHEDULE,
@@ -21,6 +29,9 @@ enum trace_event_type {
     TRACE_IPI,
     TRACE_TLB_FLUSH,
     TRACE_CUSTOM,
+    TRACE_INTERRUPT_EXIT,
+    TRACE_PROFILE_SAMPLE,
+    TRACE_EVENT_COUNT
 };
 
 // Lightweight trace event (for performance debugging)
@@ -33,15 +44,21 @@ struct trace_event {
 
 // Per-CPU trace buffer (circular)
 struct trace_buffer {
-    struct trace_event events[TRACE_BUFFER_SIZE];
-    uint32_t head;          // Write position
-    uint32_t tail;          // Read position (for userspace reader)
+    struct trace_event* events; // TRACE_BUFFER_SIZE slots, allocated with the area
+    volatile uint32_t head; // Write position (owning CPU, interrupts off)
+    volatile uint32_t tail; // Read position (for userspace reader)
     atomic_t overflow;      // Count of lost events
+    volatile uint32_t busy; // Inside trace_event(): an NMI's event is dropped
 };
 
 // Per-CPU data structure
 // Each CPU has its own instance - NO SHARED DATA!
 // This eliminates lock contention and improves cache locality
+//
+// Areas exist only for CPUs the HAL detected: the boot CPU's is static,
+// each AP's is allocated by percpu_alloc_cpu() before the AP starts, so
+// areas never share a cache line. Slots of other CPUs point at a shared
+// offline stand-in that is never written.
 struct per_cpu_data {
     // Identity
     uint32_t cpu_id;                // This CPU's ID (0-based)
@@ -50,64 +67,78 @@ struct per_cpu_data {
     // Current execution context
     struct task* current_task;      // Currently running task
     void* kernel_stack;             // Kernel mode stack for this CPU
+    struct page_table* active_address_space;  // Loaded in CR3 (NULL before paging)
 
     // Scheduling
     struct task* idle_task;         // Idle task for this CPU
-    struct list_head run_queue;     // Ready-to-run tasks
+    struct scheduler* sched;        // This CPU's run queues (scheduler.h)
     uint64_t ticks;                 // Timer ticks on this CPU
+    uint64_t timer_deadline_us;     // Armed one-shot deadline (0 = none)
     uint64_t context_switches;      // Performance counter
+    struct task* fpu_owner;         // Task whose FPU state is in the registers
+    struct task* zombies;           // Exited tasks awaiting task_reap()
+    struct task* task_cache;        // Destroyed tasks with their stacks
+    uint32_t task_cache_count;
+    volatile uint32_t rcu_qs;       // Quiescent states passed (rcu.h)
+
+    // Idle loop (kernel/idle.h); wakers read the state, stamp the request.
+    // Own cache line, so their stores miss the owner's scheduling fields
+    volatile uint32_t idle_state __attribute__((aligned(64)));  // enum idle_state
+    volatile uint32_t idle_wake_tsc; // Low TSC bits of the first wakeup request, 0 = none
+    uint64_t idle_since_tsc;        // Entered idle_state
+    struct idle_stats idle;
 
     // Memory allocator (per-CPU cache)
     void* slab_cache;               // CPU-local memory cache
+    struct pmm_magazine page_cache; // CPU-local free frames
 
     // Tracing and debugging
     struct trace_buffer trace;      // Lock-free trace buffer
 
     // Statistics
     uint64_t interrupts_handled;    // Total interrupts
+    uint32_t irq_depth;             // irq_handler() nesting (kernel/work.h)
     uint64_t ipis_received;         // Inter-processor interrupts
     uint64_t tlb_flushes;           // TLB flush count
-
-    // Padding to avoid false sharing (64-byte cache line)
-    uint8_t padding[0];
 } __attribute__((aligned(64)));     // Align to cache line
 
-// Global per-CPU data array
-extern struct per_cpu_data per_cpu[MAX_CPUS];
+// Per-CPU areas by logical CPU ID (never NULL, see above)
+extern struct per_cpu_data* per_cpu[MAX_CPUS];
 
 // Number of online CPUs
 extern uint32_t num_cpus_online;
 
 // Get this CPU's data (fast - no function call)
-#define this_cpu() (&per_cpu[hal->cpu_id()])
+#define this_cpu() (per_cpu[hal->cpu_id()])
 
 // Get specific CPU's data
-#define cpu_data(cpu_id) (&per_cpu[cpu_id])
+#define cpu_data(cpu_id) (per_cpu[cpu_id])
 
 // Initialize per-CPU infrastructure
 void percpu_init(void);
 
-// Initialize a specific CPU's data
+/**
+ * Allocate the per-CPU area of an application processor
+ *
+ * One block holds the area and its TRACE_BUFFER_SIZE trace events.
+ * Called on the boot CPU before the AP starts (smp_init()); the AP's
+ * percpu_init_cpu() then fills it in. No-op if the CPU has an area.
+ *
+ * @return 0, -EINVAL for a bad CPU ID, or -ENOMEM
+ *
+ * RT: boot-time only (contiguous PMM allocation)
+ */
+int percpu_alloc_cpu(uint32_t cpu_id);
+
+// Initialize a specific CPU's data (no-op for a CPU without an area)
 void percpu_init_cpu(uint32_t cpu_id);
 
-// Trace an event (lock-free, safe to call from interrupt context)
+// Trace an event (lock-free, safe to call from interrupt context; use the
+// trace_point() wrapper from kernel/trace.h at instrumentation sites)
 void trace_event(enum trace_event_type type, uint64_t d0, uint64_t d1,
                  uint64_t d2, uint64_t d3);
 
 // Read trace events (for debugging tools)
 int trace_read(uint32_t cpu_id, struct trace_event* events, size_t count);
 
-// CPU-local work queue (for deferred work)
-struct work_item {
-    void (*func)(void* data);
-    void* data;
-    struct work_item* next;
-};
-
-// Schedule work on a specific CPU
-void schedule_work_on_cpu(uint32_t cpu_id, struct work_item* work);
-
-// Process pending work on this CPU
-void process_pending_work(void);
-
 #endif // KERNEL_PERCPU_H
@@ -13,8 +13,10 @@
  *
  * Design:
  * - Bitmap tracks allocated/free frames
- * - Per-CPU free lists for O(1) allocation (future optimization)
- * - Frame ownership tracking for unit accounting
+ * - Per-CPU frame magazines for O(1) allocation; the bitmap is only
+ *   touched in batches when a magazine runs empty or overflows
+ * - struct page descriptor per frame: reference counts for shared and
+ *   copy-on-write frames, owner for unit accounting
  * - Reserved regions for kernel, per-CPU data, MMIO
  *
  * RT Constraints:
@@ -66,12 +68,68 @@ struct multiboot_info {
 #endif
 } __attribute__((packed));
 
+// Multiboot module: mbi->mods_addr points to mods_count of these
+struct multiboot_module {
+    uint32_t mod_start;     // Physical start (page-aligned, see boot.s)
+    uint32_t mod_end;       // One past the last byte
+    uint32_t cmdline;       // NUL-terminated string
+    uint32_t reserved;
+} __attribute__((packed));
+
+// Per-CPU frame magazine geometry
+#define PMM_MAGAZINE_SIZE  64   // Frames cached per CPU
+#define PMM_MAGAZINE_BATCH 32   // Frames moved per refill/drain
+
+/**
+ * Per-CPU frame magazine
+ *
+ * Small LIFO stack of free frames owned by one CPU. Frames in a magazine
+ * are marked allocated in the bitmap but still count as free in the stats.
+ * Embedded in struct per_cpu_data; only touched by its own CPU with
+ * interrupts disabled.
+ */
+struct pmm_magazine {
+    uint32_t count;                         // Frames currently cached
+    phys_addr_t frames[PMM_MAGAZINE_SIZE];  // Cached frame addresses
+};
+
+// Frames kept pre-zeroed for pmm_alloc_zeroed_page()
+#define PMM_ZERO_POOL_SIZE 32
+
+// Largest contiguous allocation: 2^PMM_MAX_ORDER frames (4MB)
+#define PMM_MAX_ORDER 10
+
+/**
+ * Per-frame descriptor
+ *
+ * One entry per managed frame, in an array the PMM places right after the
+ * kernel image at init. A frame with refcount 0 is free or reserved; the
+ * allocator hands frames out with refcount 1, and every additional holder
+ * (e.g. a second address space mapping a shared or copy-on-write frame)
+ * takes a reference with pmm_page_get(). For pmm_alloc_pages() blocks only
+ * the first frame carries the reference count and order.
+ */
+struct page {
+    uint16_t refcount;  // Holders of this frame (0 = not allocated)
+    uint8_t  flags;     // PAGE_FLAG_*
+    uint8_t  order;     // Block order, valid on the first frame of a block
+    uint32_t owner;     // Owning unit ID for accounting (0 = kernel)
+};
+
+// struct page flags
+#define PAGE_FLAG_RESERVED 0x01  // Reserved region, never allocated
+#define PAGE_FLAG_COW      0x02  // Mapped copy-on-write (maintained by the VM layer)
+
 // PMM statistics
 struct pmm_stats {
     size_t total_frames;
     size_t free_frames;
     size_t reserved_frames;
     size_t kernel_frames;
+    size_t cached_frames;   // Free frames held in per-CPU magazines
+    size_t zeroed_frames;   // Free frames held pre-zeroed in the zero pool
+    size_t free_blocks[PMM_MAX_ORDER + 1];  // Maximal free blocks per order
+    size_t largest_free_run;  // Longest run of free frames (not in magazines)
 };
 
 /**
@@ -91,7 +149,8 @@ bool pmm_is_initialized(void);
 /**
  * Allocate a physical frame (4KB page)
  *
- * Allocates from per-CPU free list for O(1) performance.
+ * Pops a frame from this CPU's magazine. When the magazine is empty it is
+ * refilled with PMM_MAGAZINE_BATCH frames from the bitmap in one pass.
  *
  * @return Physical address of allocated frame, or 0 on failure
  *
@@ -102,7 +161,9 @@ phys_addr_t pmm_alloc_page(void);
 /**
  * Free a physical frame
  *
- * Returns frame to free list for future allocation.
+ * Pushes the frame onto this CPU's magazine. A full magazine first
+ * returns its PMM_MAGAZINE_BATCH coldest frames to the bitmap.
+ * Shared frames (refcount > 1) are refused; use pmm_page_put() for them.
  *
  * @param page Physical address of frame to free (must be 4KB aligned)
  *
@@ -110,6 +171,126 @@ phys_addr_t pmm_alloc_page(void);
  */
 void pmm_free_page(phys_addr_t page);
 
+/**
+ * Allocate a zero-filled physical frame
+ *
+ * Takes a frame from the pre-zeroed pool that the idle thread keeps
+ * topped up. Falls back to pmm_alloc_page() plus synchronous zeroing
+ * when the pool is empty. Free with pmm_free_page().
+ *
+ * @return Physical address of a zeroed frame, or 0 on failure
+ *
+ * RT: O(1), < 100 cycles on pool hit; a miss zeroes 4KB inline
+ */
+phys_addr_t pmm_alloc_zeroed_page(void);
+
+/**
+ * Zero free frames into the pre-zeroed pool
+ *
+ * Called from the idle thread with interrupts enabled; each frame is
+ * zeroed outside any critical section, so the caller stays preemptible.
+ * Keeps a reserve of unzeroed frames so the pool never starves
+ * pmm_alloc_page().
+ *
+ * @param max_frames Upper bound on frames to zero in this call
+ * @return Number of frames added to the pool
+ */
+uint32_t pmm_zero_pool_refill(uint32_t max_frames);
+
+/**
+ * Allocate physically contiguous frames
+ *
+ * Buddy-style allocation of 2^order frames, naturally aligned to the
+ * block size. Coexists with pmm_alloc_page(); order 0 is the same call.
+ *
+ * @param order Block size as log2(frames), 0..PMM_MAX_ORDER
+ * @return Physical address of the first frame, or 0 on failure
+ *
+ * NOT RT-safe: block search is O(n) worst case. Use at init time or for
+ * DMA buffers, stacks and other long-lived allocations.
+ */
+phys_addr_t pmm_alloc_pages(unsigned int order);
+
+/**
+ * Free a block allocated by pmm_alloc_pages()
+ *
+ * Adjacent free buddies coalesce automatically.
+ *
+ * @param addr  Address returned by pmm_alloc_pages()
+ * @param order Same order that was passed to pmm_alloc_pages()
+ */
+void pmm_free_pages(phys_addr_t addr, unsigned int order);
+
+/**
+ * Smallest order whose block holds `bytes`
+ *
+ * @return Order, or PMM_MAX_ORDER + 1 if `bytes` is too large
+ *
+ * RT: O(PMM_MAX_ORDER)
+ */
+static inline unsigned int pmm_order_for_size(size_t bytes) {
+    unsigned int order = 0;
+    while (order <= PMM_MAX_ORDER && ((size_t)4096 << order) < bytes) {
+        order++;
+    }
+    return order;
+}
+
+/**
+ * Look up the descriptor of a frame
+ *
+ * @param addr Physical address inside the frame
+ * @return Descriptor, or NULL if the frame is not managed by the PMM
+ *
+ * RT: O(1)
+ */
+struct page *pmm_page(phys_addr_t addr);
+
+/**
+ * Take an extra reference on an allocated frame
+ *
+ * Used when a frame becomes shared, e.g. mapped into a second address
+ * space. Each reference is dropped with pmm_page_put().
+ *
+ * @param addr Physical address of an allocated frame (or block head)
+ * @return New reference count, -EINVAL if the frame is not allocated,
+ *         -EOVERFLOW if the count is saturated
+ *
+ * RT: O(1)
+ */
+int pmm_page_get(phys_addr_t addr);
+
+/**
+ * Drop a reference on an allocated frame
+ *
+ * The last reference frees the frame (or the whole block it heads).
+ *
+ * @param addr Physical address of an allocated frame (or block head)
+ * @return Remaining reference count (0 = freed), -EINVAL if the frame is
+ *         not allocated
+ *
+ * RT: O(1), plus the cost of pmm_free_pages() on the last reference
+ */
+int pmm_page_put(phys_addr_t addr);
+
+/**
+ * End of memory the kernel must reach through the identity map
+ *
+ * Covers the kernel image and the PMM's frame descriptor array; the MMU
+ * identity-maps at least this much.
+ *
+ * @return Physical address one past the last byte of PMM metadata
+ */
+phys_addr_t pmm_metadata_end(void);
+
+/**
+ * Return this CPU's cached frames to the bitmap
+ *
+ * Used before taking a CPU offline and by tests that need an exact view
+ * of the bitmap. Not an RT path (O(PMM_MAGAZINE_SIZE)).
+ */
+void pmm_drain_local_cache(void);
+
 /**
  * Reserve a physical memory region
  *
@@ -127,6 +308,8 @@ void pmm_reserve_region(phys_addr_t start, size_t size);
  * Returns information about memory usage.
  *
  * @param stats Pointer to stats structure to fill
+ *
+ * NOT RT-safe: scans the free-frame index and the bitmap.
  */
 void pmm_get_stats(struct pmm_stats *stats);
 
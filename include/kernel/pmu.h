@@ -0,0 +1,99 @@
+/**
+ * Sampling profiler (performance counters)
+ *
+ * Programs general-purpose counter 0 of the architectural PMU (CPUID
+ * leaf 0xA) to overflow every `period` events. The overflow arrives as
+ * an NMI through the local APIC's performance counter LVT entry, so
+ * code running with interrupts off is sampled too. Each sample goes into
+ * the interrupted CPU's trace buffer as TRACE_PROFILE_SAMPLE with
+ *
+ *   data[0] interrupted EIP
+ *   data[1] running task ID
+ *   data[2] pmu_event_t being counted
+ *   data[3] ring of the interrupted code (0 kernel, 3 user)
+ *
+ * Samples are recorded regardless of trace_enabled_mask (kernel/trace.h).
+ * trace_export() ships them with everything else, and
+ * scripts/profile_report.py turns them into per-function hot-spot tables
+ * against kernel.elf.
+ *
+ * Every CPU counts the same event. pmu_profile_start() programs the
+ * calling CPU and sends the others a reschedule IPI; each one picks the
+ * new setting up in pmu_sync().
+ *
+ * RT Constraints:
+ * - Each sample costs one NMI (a few hundred cycles plus two MSR writes);
+ *   keep the period at PMU_PERIOD_MIN or above
+ * - pmu_sync(): one load when nothing changed
+ */
+
+#ifndef KERNEL_PMU_H
+#define KERNEL_PMU_H
+
+#include <kernel/types.h>
+
+typedef enum {
+    PMU_EVENT_CYCLES = 0,       // Unhalted core cycles
+    PMU_EVENT_INSTRUCTIONS,     // Instructions retired
+    PMU_EVENT_REF_CYCLES,       // Unhalted reference cycles
+    PMU_EVENT_LLC_REFERENCES,   // Last-level cache references
+    PMU_EVENT_LLC_MISSES,       // Last-level cache misses
+    PMU_EVENT_BRANCHES,         // Branch instructions retired
+    PMU_EVENT_BRANCH_MISSES,    // Mispredicted branches retired
+    PMU_EVENT_COUNT
+} pmu_event_t;
+
+#define PMU_PERIOD_MIN      10000
+#define PMU_PERIOD_MAX      0x7FFFFFFFu   // Counter writes sign-extend bit 31
+
+struct pmu_info {
+    uint32_t version;           // Architectural PMU version (0 = none)
+    uint32_t counters;          // General-purpose counters per CPU
+    uint32_t width;             // Counter bits
+    uint32_t events;            // Bit per supported pmu_event_t
+};
+
+/**
+ * Detect the PMU and install the NMI handler
+ *
+ * Boot CPU, after lapic_init().
+ *
+ * @return 0, -ENODEV without an architectural PMU or local APIC
+ */
+int pmu_init(void);
+
+/**
+ * What pmu_init() found
+ */
+void pmu_get_info(struct pmu_info* info);
+
+/**
+ * Start sampling on every CPU
+ *
+ * Replaces a running profile.
+ *
+ * @param period Events between samples, PMU_PERIOD_MIN..PMU_PERIOD_MAX
+ * @return 0, -ENODEV, -EINVAL for an unsupported event or bad period
+ */
+int pmu_profile_start(pmu_event_t event, uint32_t period);
+
+/**
+ * Stop sampling on every CPU
+ */
+void pmu_profile_stop(void);
+
+/**
+ * Apply the current profile setting to the calling CPU
+ *
+ * Called from the reschedule IPI, interrupts off.
+ *
+ * RT: O(1); a few MSR writes when the setting changed
+ */
+void pmu_sync(void);
+
+/**
+ * Samples recorded on one CPU
+ */
+uint64_t pmu_samples(uint32_t cpu_id);
+
+#endif // KERNEL_PMU_H
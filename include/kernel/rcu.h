@@ -0,0 +1,101 @@
+#ifndef KERNEL_RCU_H
+#define KERNEL_RCU_H
+
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/hal.h>
+#include <kernel/percpu.h>
+
+/**
+ * RCU-style deferred reclamation
+ *
+ * For read-mostly tables: readers follow pointers with no lock and no
+ * locked instruction; a writer publishes a new version with
+ * rcu_assign_pointer(), unlinks the old one and hands it to call_rcu(),
+ * which frees it once every reader that could still see it is done.
+ *
+ * A read section runs with interrupts off, so it can neither be
+ * preempted nor span a context switch, and it must not block. Any point
+ * where a CPU is known to be outside one is a quiescent state: a context
+ * switch, and any hardware interrupt it takes (which needs interrupts
+ * on). The scheduler tick and switch path count them per CPU. A grace
+ * period is over once every online CPU has counted one since it began;
+ * callbacks queued before it started may then run.
+ *
+ * Callbacks run from the scheduler tick of the CPU that queued them,
+ * with interrupts off: keep them short (kfree() is fine). A CPU whose
+ * tick is stopped (tickless idle) runs them when it next wakes; idle
+ * CPUs holding up a grace period are woken with a reschedule IPI.
+ *
+ * Writers serialize among themselves (a spinlock or mutex of their own).
+ *
+ * RT Constraints:
+ * - rcu_read_lock()/rcu_read_unlock(): O(1), interrupt disable/restore
+ * - call_rcu(): O(1)
+ * - rcu_tick(): O(1) with nothing pending, O(CPUs) while a grace period
+ *   is in progress, plus the callbacks that became ready
+ */
+
+struct rcu_head {
+    struct rcu_head* next;
+    void (*func)(struct rcu_head* head);
+};
+
+static inline uint32_t rcu_read_lock(void) {
+    return hal->irq_disable();
+}
+
+static inline void rcu_read_unlock(uint32_t flags) {
+    hal->irq_restore(flags);
+}
+
+// Load a pointer a writer may replace at any time
+#define rcu_dereference(p) ({                       \
+    typeof(p) __p = *(volatile typeof(p)*)&(p);     \
+    barrier();                                      \
+    __p; })
+
+// Publish a pointer: everything it points to is visible first
+#define rcu_assign_pointer(p, v) do {               \
+    wmb();                                          \
+    *(volatile typeof(p)*)&(p) = (v);               \
+} while (0)
+
+/**
+ * Free something after a grace period
+ *
+ * `func` runs once no reader can hold a reference obtained before this
+ * call. Embed the rcu_head in the object and use container_of().
+ *
+ * RT: O(1), safe from interrupt context
+ */
+void call_rcu(struct rcu_head* head, void (*func)(struct rcu_head* head));
+
+/**
+ * Note a quiescent state for a CPU
+ *
+ * Called with interrupts off, on the CPU itself, from points that are
+ * outside any read section.
+ */
+static inline void rcu_quiescent(struct per_cpu_data* cpu) {
+    cpu->rcu_qs++;
+}
+
+/**
+ * Per-tick work: note the quiescent state, advance the grace period,
+ * run ready callbacks
+ *
+ * Called from the scheduler tick with interrupts off.
+ */
+void rcu_tick(void);
+
+/**
+ * Grace periods
+ *
+ * rcu_gp_completed() is the number of grace periods finished so far;
+ * rcu_callbacks_pending() counts this CPU's callbacks not yet run.
+ */
+uint32_t rcu_gp_completed(void);
+uint32_t rcu_callbacks_pending(void);
+
+#endif // KERNEL_RCU_H
@@ -0,0 +1,222 @@
+#ifndef KERNEL_RING_H
+#define KERNEL_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+#include <kernel/mmu.h>
+#include <kernel/waitqueue.h>
+#include <lib/string.h>
+
+/**
+ * Shared-memory SPSC rings
+ *
+ * A ring is a few pages mapped into a producer's and a consumer's address
+ * space: a header, then `nr_records` fixed-size records. Both sides move
+ * records with plain loads and stores, lock-free like the per-CPU
+ * trace_buffer: the producer owns head, the consumer owns tail, one slot
+ * always stays empty, and each index lives on its own cache line.
+ *
+ * The kernel is only involved when the consumer runs dry. It raises
+ * consumer_waiting and sleeps in ring_wait(); a producer that sees the
+ * flag after publishing rings the doorbell (ring_doorbell()). Both sides
+ * store their flag or index, then fence, then load the other's, so one
+ * of them always notices the other. In the steady state neither side
+ * enters the kernel.
+ *
+ * Everything in the shared pages is writable by user mode: the kernel
+ * keeps its own copy of the geometry and only ever compares head and tail.
+ *
+ * RT Constraints:
+ * - ring_push()/ring_pop(): O(record_size), no syscall
+ * - ring_wait()/ring_doorbell(): O(1)
+ * - ring_create()/ring_map(): allocate, not RT-safe
+ */
+
+#define RING_CACHE_LINE     64
+#define RING_MAX_PAGES      16   // Header plus records
+#define RING_MAX_RINGS      32   // Ring IDs handed out to user tasks
+
+// First bytes of the shared pages
+struct ring_header {
+    volatile uint32_t head __attribute__((aligned(RING_CACHE_LINE)));  // Producer
+    uint32_t record_size;       // Geometry, for the user side's ring_view_init()
+    uint32_t nr_records;
+    volatile uint32_t tail __attribute__((aligned(RING_CACHE_LINE)));  // Consumer
+    volatile uint32_t consumer_waiting __attribute__((aligned(RING_CACHE_LINE)));
+};
+
+// One side's handle on a mapped ring
+struct ring_view {
+    struct ring_header* hdr;
+    uint8_t*            records;
+    uint32_t            record_size;
+    uint32_t            nr_records;
+};
+
+typedef struct ring {
+    phys_addr_t         frames[RING_MAX_PAGES];  // Kernel holds a reference on each
+    uint32_t            npages;
+    uint32_t            record_size;
+    uint32_t            nr_records;
+    struct ring_header* hdr;    // Kernel view of frames[0] (identity map)
+    wait_queue_t        consumer_wq;
+    page_table_t*       owner;      // Program that may use its ID, NULL once it exited
+
+    // Statistics
+    uint64_t            waits;      // Consumer went to sleep
+    uint64_t            doorbells;  // Doorbells that woke it
+} ring_t;
+
+/**
+ * Set up a view from a mapping of the ring
+ *
+ * RT: O(1)
+ */
+static inline void ring_view_init(struct ring_view* view, void* base) {
+    view->hdr = (struct ring_header*)base;
+    view->records = (uint8_t*)base + sizeof(struct ring_header);
+    view->record_size = view->hdr->record_size;
+    view->nr_records = view->hdr->nr_records;
+}
+
+/**
+ * Set up the kernel's own view of a single-page ring
+ *
+ * Uses the kernel's geometry rather than the shared header's. Only the
+ * first frame is reachable contiguously (identity map), so the ring must
+ * fit in one page.
+ *
+ * RT: O(1)
+ */
+static inline void ring_view_kernel(const ring_t* ring, struct ring_view* view) {
+    view->hdr = ring->hdr;
+    view->records = (uint8_t*)ring->hdr + sizeof(struct ring_header);
+    view->record_size = ring->record_size;
+    view->nr_records = ring->nr_records;
+}
+
+/**
+ * Producer: append one record
+ *
+ * @return false if the ring is full (or its head corrupted)
+ */
+static inline bool ring_push(const struct ring_view* view, const void* record) {
+    struct ring_header* hdr = view->hdr;
+    uint32_t head = hdr->head;
+    uint32_t next = head + 1 == view->nr_records ? 0 : head + 1;
+    if (head >= view->nr_records || next == hdr->tail) {
+        return false;
+    }
+
+    memcpy(view->records + head * view->record_size, record, view->record_size);
+    wmb();  // Record before the head that publishes it
+    hdr->head = next;
+    return true;
+}
+
+/**
+ * Producer: after pushing, whether the consumer needs ring_doorbell()
+ */
+static inline bool ring_doorbell_needed(const struct ring_view* view) {
+    mb();  // Head store before the flag load
+    return view->hdr->consumer_waiting != 0;
+}
+
+/**
+ * Consumer: take the oldest record
+ *
+ * @return false if the ring is empty (or its tail corrupted)
+ */
+static inline bool ring_pop(const struct ring_view* view, void* record) {
+    struct ring_header* hdr = view->hdr;
+    uint32_t tail = hdr->tail;
+    if (tail >= view->nr_records || tail == hdr->head) {
+        return false;
+    }
+
+    rmb();  // Head before the record it published
+    memcpy(record, view->records + tail * view->record_size, view->record_size);
+    mb();   // Done reading before the producer may reuse the slot
+    hdr->tail = tail + 1 == view->nr_records ? 0 : tail + 1;
+    return true;
+}
+
+/**
+ * Whether ring_create() accepts a geometry
+ *
+ * Records are a nonzero 4-byte multiple, there are at least two slots,
+ * and header plus records fit in RING_MAX_PAGES pages.
+ */
+static inline bool ring_geometry_ok(uint32_t record_size, uint32_t nr_records) {
+    if (record_size == 0 || (record_size & 3) || nr_records < 2) {
+        return false;
+    }
+    uint64_t bytes = sizeof(struct ring_header) + (uint64_t)record_size * nr_records;
+    return bytes <= RING_MAX_PAGES * PAGE_SIZE;
+}
+
+/**
+ * Create a ring
+ *
+ * Allocates zeroed pages for the header and `nr_records - 1` usable
+ * records of `record_size` bytes.
+ *
+ * @param record_size Bytes per record, 4-byte multiple
+ * @param nr_records  Slots, >= 2, all fitting in RING_MAX_PAGES pages
+ * @return Ring, or NULL on bad geometry (see ring_geometry_ok()) or no memory
+ */
+ring_t* ring_create(uint32_t record_size, uint32_t nr_records);
+
+/**
+ * Map a ring into an address space
+ *
+ * Reserves a region of the ring's pages at `addr` backed by the ring's
+ * frames; releasing the region with mmu_release_region() unmaps it.
+ *
+ * @return 0, or an error from mmu_reserve_region() / -ENOMEM
+ */
+int ring_map(ring_t* ring, page_table_t* as, virt_addr_t addr);
+
+/**
+ * Free a ring
+ *
+ * Mappings keep their references to the pages: the memory goes away with
+ * the last of them. Nobody may be asleep in ring_wait().
+ */
+void ring_destroy(ring_t* ring);
+
+/**
+ * Consumer: sleep while the ring is empty
+ *
+ * Raises consumer_waiting and rechecks under the wait queue lock, so a
+ * producer that published meanwhile is never missed.
+ *
+ * @param timeout_us Give up after this long (0 = wait forever)
+ * @return 0 with a record available (or after a doorbell), -ETIMEDOUT,
+ *         -EPERM from a context that cannot block
+ */
+int ring_wait(ring_t* ring, uint64_t timeout_us);
+
+/**
+ * Producer: wake the consumer if it sleeps on an empty ring
+ *
+ * @return 1 if the consumer was woken, 0 if it was not waiting
+ */
+int ring_doorbell(ring_t* ring);
+
+/**
+ * Ring IDs for user tasks
+ *
+ * ring_install() returns an ID (1..RING_MAX_RINGS) or -ENOMEM once all
+ * are taken; rings installed there live until shutdown. ring_lookup()
+ * returns the ring, or NULL if the ID is unknown or the ring does not
+ * belong to `as` (IDs are global, but only the owner may use them).
+ * ring_release_owner() detaches an exiting program from its rings, so
+ * an address space that later reuses its page_table_t gets nothing.
+ */
+int ring_install(ring_t* ring, page_table_t* owner);
+ring_t* ring_lookup(int id, page_table_t* as);
+void ring_release_owner(page_table_t* owner);
+
+#endif // KERNEL_RING_H
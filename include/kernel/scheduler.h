@@ -3,7 +3,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <kernel/config.h>
 #include <kernel/task.h>
+#include <kernel/percpu.h>
+#include <kernel/hal.h>
+#include <kernel/spinlock.h>
 
 /**
  * Real-Time Scheduler
@@ -19,12 +23,35 @@
  * Design (based on RT_CONSTRAINTS.md section 3.1):
  * - 256 run queues (one per priority level 0-255)
  * - 8 x 32-bit bitmap for O(1) priority search
- * - Per-CPU scheduler state (for future SMP)
+ * - One scheduler instance per CPU (per_cpu_data.sched), each with its
+ *   own idle task; the running task is never on a ready queue
+ * - Work stealing: a CPU with nothing ready takes the highest-priority
+ *   ready task from the busiest peer before falling back to idle
+ * - Deadline class: tasks with a (budget, deadline, period) reservation
+ *   run before every fixed priority, earliest absolute deadline first
+ *   from a per-CPU min-heap (O(log n)). Each one gets its budget of CPU
+ *   time per period, charged in TSC cycles; once spent it is throttled
+ *   until the period ends, so an overrunning deadline task cannot starve
+ *   the rest. Admission keeps the reserved share of each CPU at or below
+ *   SCHED_DL_MAX_UTIL_PPM, and deadline tasks are never stolen.
  */
 
 #define SCHED_NUM_PRIORITIES 256    // Priority levels: 0 (lowest) to 255 (highest)
 #define SCHED_IDLE_PRIORITY  0      // Idle task priority
 #define SCHED_DEFAULT_PRIORITY 128  // Default priority for new tasks
+#define SCHED_TIME_SLICE_US  1000   // Default round-robin quantum
+#define SCHED_QUANTUM_MIN_US 100    // Shortest quantum a task may ask for
+#define SCHED_QUANTUM_MAX_US 1000000 // Longest quantum a task may ask for
+
+// Latency/burst histograms: bucket i counts [2^i, 2^(i+1)) TSC cycles,
+// the last one everything longer
+#define SCHED_HIST_BUCKETS      32
+
+// Deadline class (scheduler_set_deadline())
+#define SCHED_DL_MAX_TASKS      32          // Deadline tasks admitted per CPU
+#define SCHED_DL_MIN_BUDGET_US  100         // Smallest budget per period
+#define SCHED_DL_MAX_PERIOD_US  10000000    // Longest period (10 s)
+#define SCHED_DL_MAX_UTIL_PPM   900000      // CPU share deadline tasks may reserve
 
 /**
  * Per-priority run queue
@@ -38,43 +65,87 @@ typedef struct {
 } task_queue_t;
 
 /**
- * Scheduler state (per-CPU in future)
+ * Per-CPU scheduler state
  *
- * For now: single global scheduler
- * Future: one per CPU for SMP
+ * The current and idle tasks live in per_cpu_data (current_task,
+ * idle_task). `lock` serializes the queues against remote CPUs
+ * (enqueue onto another CPU, work stealing); the owning CPU also runs
+ * with interrupts disabled while holding it.
  */
-typedef struct {
-    // Priority queues
-    task_queue_t ready[SCHED_NUM_PRIORITIES];   // One queue per priority
+typedef struct scheduler {
+    // First cache line: what every enqueue, pick and tick reads
+    spinlock_t lock;                            // Queue lock
+    uint32_t nr_ready;                          // Tasks on the ready queues
+    uint32_t cpu_id;                            // Owning CPU
+    bool need_resched;                          // Set by timer to request reschedule
 
     // Bitmap for O(1) priority search
     // priority_bitmap[i] has bit j set if ready[i*32 + j] is non-empty
     uint32_t priority_bitmap[8];                // 8 * 32 = 256 bits
+    task_t* switched_from;                      // Previous task, still on_cpu
+
+    uint64_t slice_end_us;                      // Current quantum expiry (tickless)
+
+    // Priority queues
+    task_queue_t ready[SCHED_NUM_PRIORITIES];   // One queue per priority
 
-    // Current task
-    task_t* current_task;                       // Currently running task
+    // Deadline class: ready tasks in a min-heap on absolute deadline
+    task_t* dl_heap[SCHED_DL_MAX_TASKS];        // dl_heap[0] is the earliest
+    uint32_t dl_nr_ready;                       // Heap size (counted in nr_ready too)
+    uint32_t dl_nr_tasks;                       // Admitted to this CPU
+    uint32_t dl_util_ppm;                       // Their budget/period, summed
+    uint64_t dl_charge_tsc;                     // Running deadline task charged up to here
+    uint64_t dl_throttles;                      // Budgets run out before the period ended
 
     // Statistics
     uint64_t context_switches;                  // Total context switches
     uint64_t ticks;                             // Scheduler ticks
+    uint64_t steals;                            // Tasks taken from other CPUs
+    uint64_t fast_switches;                     // Resumed without segment/EFLAGS reload
+    uint64_t direct_switches;                   // scheduler_switch_to() without the queues
 
-    // Preemption flag
-    bool need_resched;                          // Set by timer to request reschedule
-} scheduler_t;
+    // Switch cost (CONFIG_SCHED_SWITCH_TRACE), in TSC cycles
+    uint64_t switch_start_tsc;                  // Outgoing side of the switch in flight
+    uint64_t switch_cycles_total;
+    uint64_t switch_cycles_max;
+
+    // CONFIG_SCHED_STATS, log2 of TSC cycles (SCHED_HIST_BUCKETS)
+    uint64_t latency_hist[SCHED_HIST_BUCKETS];  // READY until switched to
+    uint64_t burst_hist[SCHED_HIST_BUCKETS];    // Switched to until switched away
+} __attribute__((aligned(64))) scheduler_t;
+
+_Static_assert(sizeof(void*) != 4 ||
+               offsetof(scheduler_t, switched_from) + sizeof(task_t*) <= 64,
+               "scheduler-hot run queue fields must fit the first cache line");
 
 /**
  * Initialize scheduler
  *
  * Must be called once during kernel initialization, after task_init().
- * Creates the idle task.
+ * Sets up the boot CPU's scheduler instance (see scheduler_init_cpu()).
  */
 void scheduler_init(void);
 
+/**
+ * Initialize a CPU's scheduler instance
+ *
+ * Allocates its queues (one PMM block, so only CPUs that come online pay
+ * for them) or clears them on a second call, creates its idle task if it
+ * has none yet and makes the code already running on it the (never
+ * rescheduled) bootstrap task.
+ * Called by scheduler_init() for the boot CPU and by each AP as it comes
+ * online.
+ *
+ * @param cpu_id  CPU to initialize
+ * @return 0 on success, -EINVAL for a bad CPU ID, -ENOMEM on allocation failure
+ */
+int scheduler_init_cpu(uint32_t cpu_id);
+
 /**
  * Enqueue a task in the ready queue
  *
- * Adds task to the appropriate priority queue and updates bitmap.
- * Task must be in READY state.
+ * Adds task to the appropriate priority queue of the CPU in task->cpu
+ * and updates its bitmap. Task must be in READY state.
  *
  * @param task  Task to enqueue
  *
@@ -93,11 +164,112 @@ void scheduler_enqueue(task_t* task);
  */
 void scheduler_dequeue(task_t* task);
 
+/**
+ * Change a task's effective priority
+ *
+ * A queued task moves to the tail of its new priority queue; its CPU is
+ * poked if it now outranks what runs there. A running task lowered below
+ * a ready one is preempted at the next safe point. base_priority is left
+ * alone (priority inheritance boosts and restores through here).
+ *
+ * @param task      Task to change
+ * @param priority  New effective priority (0-255)
+ *
+ * RT: O(1), < 50 cycles
+ */
+void scheduler_set_priority(task_t* task, uint8_t priority);
+
+/**
+ * Change a task's round-robin quantum
+ *
+ * Peers at the same priority only rotate once the running one has used
+ * its whole quantum, so throughput-bound tasks can take long slices and
+ * latency-bound ones short slices. Takes effect from the task's next
+ * slice.
+ *
+ * @param task        Task to change
+ * @param quantum_us  Quantum (0 = SCHED_TIME_SLICE_US, otherwise
+ *                    SCHED_QUANTUM_MIN_US..SCHED_QUANTUM_MAX_US)
+ * @return 0 on success, -EINVAL for a NULL task or out-of-range quantum
+ *
+ * RT: O(1)
+ */
+int scheduler_set_quantum(task_t* task, uint32_t quantum_us);
+
+/**
+ * Per-task scheduling statistics (CONFIG_SCHED_STATS)
+ *
+ * Also the layout SYS_TASK_STATS copies out to user space.
+ */
+struct sched_task_stats {
+    uint64_t run_us;        // Time on a CPU, including a burst in progress
+    uint64_t wait_us;       // Time READY but not running, including now
+    uint64_t dispatches;    // Times switched to
+    uint64_t cpu_ticks;     // Timer ticks it was running at (cpu_time_ticks)
+};
+
+/**
+ * Snapshot a task's statistics
+ *
+ * Lock-free: fields of another CPU's task may be a switch apart.
+ *
+ * RT: O(1)
+ */
+void scheduler_get_task_stats(const task_t* task, struct sched_task_stats* out);
+
+/**
+ * Print every online CPU's scheduler counters and histograms
+ *
+ * RT: O(CPUs * SCHED_HIST_BUCKETS); not for hot paths
+ */
+void scheduler_dump_stats(void);
+
+/**
+ * Give a task a deadline reservation, or return it to fixed priorities
+ *
+ * The task gets up to budget_us of CPU time in every period_us, each
+ * budget due within deadline_us of the period start. Among deadline
+ * tasks the earliest absolute deadline runs; all of them run before any
+ * fixed priority. A task that wakes after its period has ended starts a
+ * fresh one (sporadic activation). Budgets are charged in TSC cycles at
+ * every tick and switch; enforcement is as fine as the tick (periodic)
+ * or exact to the timer event (tickless).
+ *
+ * Must be called on the caller itself or on a task that is not running.
+ *
+ * @param task         Task to change
+ * @param budget_us    CPU time per period (0 = leave the deadline class)
+ * @param deadline_us  Relative deadline, budget_us..period_us
+ * @param period_us    Period, up to SCHED_DL_MAX_PERIOD_US
+ * @return 0 on success, -EINVAL for bad parameters (or the idle task),
+ *         -ENODEV if the task's CPU is not scheduling yet, -EBUSY if its
+ *         CPU cannot admit the reservation (SCHED_DL_MAX_UTIL_PPM,
+ *         SCHED_DL_MAX_TASKS)
+ *
+ * RT: O(log n) in deadline tasks on the CPU; not for interrupt context
+ */
+int scheduler_set_deadline(task_t* task, uint32_t budget_us,
+                           uint32_t deadline_us, uint32_t period_us);
+
+/**
+ * True if the task is in the deadline class
+ */
+static inline bool task_is_deadline(const task_t* task) {
+    return task->dl_budget_us != 0;
+}
+
+/**
+ * A task's effective quantum in microseconds
+ */
+static inline uint32_t task_quantum_us(const task_t* task) {
+    return task->quantum_us ? task->quantum_us : SCHED_TIME_SLICE_US;
+}
+
 /**
  * Pick next task to run
  *
- * Selects highest-priority READY task using bitmap.
- * If no tasks are ready, returns idle task.
+ * Selects this CPU's highest-priority READY task using bitmap, without
+ * removing it. If no tasks are ready, returns this CPU's idle task.
  *
  * @return  Next task to run (never NULL)
  *
@@ -119,6 +291,26 @@ task_t* scheduler_pick_next(void);
  */
 void schedule(void);
 
+/**
+ * Switch straight to a blocked task, bypassing the run queue
+ *
+ * For synchronous IPC: a caller hands its CPU to the server it just
+ * unblocked, and the server hands it back with the reply. `next` does not
+ * go through scheduler_enqueue() or the priority bitmap and inherits the
+ * rest of the current time slice. The current task must already be
+ * BLOCKED (or READY, if woken meanwhile) unless it just wants to yield to
+ * `next`.
+ *
+ * Falls back to waking `next` and calling schedule() when something
+ * queued outranks `next`, when either task is in the deadline class, or
+ * when `next` last ran on another CPU.
+ *
+ * @param next  BLOCKED task the caller owns, i.e. nothing else may wake it
+ *
+ * RT: O(1), one context switch
+ */
+void scheduler_switch_to(task_t* next);
+
 /**
  * Timer tick callback
  *
@@ -131,6 +323,18 @@ void schedule(void);
  */
 bool scheduler_tick(void);
 
+/**
+ * Earliest scheduler deadline on this CPU
+ *
+ * Used by the tickless timer to arm the next interrupt.
+ *
+ * @return  Absolute time (timer_read_us()), or TIMER_NO_EVENT if the CPU
+ *          can sleep until something else wakes it
+ *
+ * RT: O(1)
+ */
+uint64_t scheduler_next_event_us(void);
+
 /**
  * Get current task
  *
@@ -141,8 +345,7 @@ bool scheduler_tick(void);
  * RT: O(1), < 10 cycles
  */
 static inline task_t* scheduler_current(void) {
-    extern scheduler_t g_scheduler;
-    return g_scheduler.current_task;
+    return this_cpu()->current_task;
 }
 
 /**
@@ -154,8 +357,7 @@ static inline task_t* scheduler_current(void) {
  * RT: O(1), < 5 cycles
  */
 static inline void scheduler_set_need_resched(void) {
-    extern scheduler_t g_scheduler;
-    g_scheduler.need_resched = true;
+    this_cpu()->sched->need_resched = true;
 }
 
 /**
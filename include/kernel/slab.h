@@ -0,0 +1,99 @@
+#ifndef KERNEL_SLAB_H
+#define KERNEL_SLAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/types.h>
+
+/**
+ * Slab Allocator (kmalloc)
+ *
+ * Small-object allocator layered on the PMM. Objects are grouped into
+ * power-of-two size classes (16 .. 2048 bytes); each class carves
+ * one-page slabs into equal objects, with a slab header at the start of
+ * the page so kfree() finds it by masking the address.
+ *
+ * Design:
+ * - Per-class depot: partial/empty slab lists (shared, under a spin lock)
+ * - Per-CPU front cache: small LIFO of free objects per class hung off
+ *   per_cpu_data.slab_cache; alloc/free touch only CPU-local state on hit
+ * - Refill/flush move SLAB_CPU_BATCH objects between front cache and depot
+ *
+ * RT Constraints:
+ * - kmalloc()/kfree(): O(1), < 100 cycles on front-cache hit
+ * - Depot refill/flush: O(SLAB_CPU_BATCH), may call pmm_alloc_page()
+ * - Not for interrupt handlers or RT hot paths (see KERNEL_C_STYLE.md 3.2)
+ */
+
+// Size classes: 16, 32, ..., 2048 bytes
+#define SLAB_MIN_SHIFT    4
+#define SLAB_MAX_SHIFT    11
+#define SLAB_NUM_CLASSES  (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define KMALLOC_MAX_SIZE  (1u << SLAB_MAX_SHIFT)
+
+// Per-CPU front cache geometry
+#define SLAB_CPU_CACHE_SIZE 16  // Objects cached per class per CPU
+#define SLAB_CPU_BATCH      8   // Objects moved per refill/flush
+
+// Slab allocator statistics (per size class)
+struct slab_class_stats {
+    size_t object_size;     // Bytes per object
+    size_t slabs;           // Slab pages owned by this class
+    size_t objects_in_use;  // Objects handed out (including front caches)
+};
+
+/**
+ * Initialize the slab allocator
+ *
+ * Must be called after pmm_init() and before any kmalloc().
+ * Sets up the depots and the boot CPU's front cache.
+ */
+void slab_init(void);
+
+/**
+ * Set up a CPU's front cache
+ *
+ * Called for the boot CPU by slab_init() and for each AP as it comes up.
+ *
+ * @param cpu_id CPU whose per_cpu_data.slab_cache to initialize
+ * @return 0 on success, -ENOMEM if the cache could not be allocated
+ */
+int slab_cpu_init(uint32_t cpu_id);
+
+/**
+ * Allocate kernel memory
+ *
+ * Returns memory owned by the caller, free with kfree(). Contents are
+ * undefined. Objects are aligned to MIN(size class, 64) bytes.
+ *
+ * @param size Bytes to allocate (1 .. KMALLOC_MAX_SIZE)
+ * @return Pointer to memory, or NULL on failure or if size is too large
+ *
+ * RT: O(1), < 100 cycles on front-cache hit
+ */
+void* kmalloc(size_t size);
+
+/**
+ * Allocate zeroed kernel memory
+ *
+ * Same as kmalloc() but the returned memory is zero-filled.
+ */
+void* kzalloc(size_t size);
+
+/**
+ * Free memory returned by kmalloc()/kzalloc()
+ *
+ * @param ptr Pointer to free (NULL is ignored)
+ *
+ * RT: O(1), < 100 cycles when the front cache is not full
+ */
+void kfree(void* ptr);
+
+/**
+ * Get per-class statistics
+ *
+ * @param stats Array of SLAB_NUM_CLASSES entries to fill
+ */
+void slab_get_stats(struct slab_class_stats* stats);
+
+#endif // KERNEL_SLAB_H
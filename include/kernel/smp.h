@@ -0,0 +1,62 @@
+/**
+ * Symmetric Multiprocessing (SMP) Bring-up
+ *
+ * The HAL discovers the CPUs (hal->smp_detect) and starts each
+ * application processor (hal->smp_boot_cpu) on a private boot stack with
+ * paging, segmentation and interrupts set up. The core side here gives
+ * every AP its per-CPU data, slab front cache, run queues and timer,
+ * then lets it join scheduling from its idle task.
+ *
+ * Logical CPU IDs are dense: the boot CPU is 0 and APs are 1 .. n-1 in
+ * discovery order, so per_cpu[] and the run queues are indexed directly.
+ *
+ * RT Constraints:
+ * - Bring-up is boot-time only (waits on hardware with timeouts)
+ * - smp_send_reschedule(): O(1), one IPI
+ */
+
+#ifndef KERNEL_SMP_H
+#define KERNEL_SMP_H
+
+#include <kernel/types.h>
+
+// Low physical page the architecture's AP startup code runs from. The
+// PMM keeps it reserved; it must be page-aligned and below 1MB.
+#define SMP_TRAMPOLINE_ADDR  0x8000
+
+// IPI vectors (architecture stubs exist for exactly these)
+#define SMP_IPI_RESCHEDULE   0xF0   // Run schedule() on the target CPU
+#define SMP_IPI_WORK         0xF1   // Run queued work (kernel/work.h)
+
+/**
+ * Boot all application processors
+ *
+ * Call on the boot CPU once the scheduler is initialized. APs are
+ * started one at a time; each must finish its per-CPU setup before the
+ * next one is kicked.
+ *
+ * @return Number of CPUs online afterwards (>= 1)
+ */
+uint32_t smp_init(void);
+
+/**
+ * Ask another CPU to reschedule
+ *
+ * No-op for the calling CPU, offline CPUs, or without IPI support.
+ *
+ * @param cpu_id Logical CPU ID
+ *
+ * RT: O(1)
+ */
+void smp_send_reschedule(uint32_t cpu_id);
+
+/**
+ * Ask another CPU to run its queued work
+ *
+ * Same rules as smp_send_reschedule().
+ *
+ * RT: O(1)
+ */
+void smp_send_work(uint32_t cpu_id);
+
+#endif // KERNEL_SMP_H
@@ -1,9 +1,11 @@
 /**
  * System Call Interface
  *
- * ABI: INT 0x80 (classic Linux-style syscalls)
+ * ABI: INT 0x80 (classic Linux-style syscalls), plus a SYSENTER fast path
+ * on CPUs that have it (CPUID.1:EDX.SEP), both dispatching through the
+ * same syscall table.
  *
- * Register convention:
+ * INT 0x80 register convention:
  * - EAX: syscall number
  * - EBX: arg0
  * - ECX: arg1
@@ -17,6 +19,17 @@
  * - Ring 0 → Ring 0: CPU uses current stack, pushes EFLAGS/CS/EIP only
  *
  * INT 0x80 gate MUST be DPL=3 (type 0xEE) to allow userspace calls.
+ *
+ * SYSENTER register convention (user mode only; ECX/EDX carry the way back):
+ * - EAX: syscall number
+ * - EBX, ESI, EDI, EBP: arg0 - arg3 (arg4 is always 0; use INT 0x80)
+ * - ECX: user ESP to resume with
+ * - EDX: user EIP to resume at
+ * - Return value: EAX; EBX/ESI/EDI/EBP preserved, ECX/EDX as passed,
+ *   arithmetic flags clobbered
+ *
+ * IPC syscalls (SYS_CALL, SYS_REPLY_WAIT) also return message words in
+ * EBX, ESI and EDI, on either path.
  */
 
 #ifndef KERNEL_SYSCALL_H
@@ -33,17 +46,40 @@
  * Syscall numbers
  *
  * Start at 1 (0 is reserved for "invalid syscall")
- *
- * **IMPORTANT:** SYS_SLEEP_US is NOT implemented (returns -ENOSYS).
- * Full implementation (sleep queues + timer wakeup) will be added in Phase 4.
  */
 #define SYS_EXIT        1    // Exit current task
 #define SYS_YIELD       2    // Yield CPU to another task
 #define SYS_GETPID      3    // Get current task ID
-#define SYS_SLEEP_US    4    // Sleep for microseconds (NOT IMPLEMENTED - returns -ENOSYS)
+#define SYS_SLEEP_US    4    // Sleep for microseconds (kernel timer wakeup)
+#define SYS_WAIT        5    // Sleep while a user word holds a value (futex)
+#define SYS_WAKE        6    // Wake tasks sleeping on a user word
+#define SYS_SET_QUANTUM 7    // Set the caller's round-robin quantum
+#define SYS_TASK_STATS  8    // Copy the caller's scheduling statistics out
+#define SYS_CHAN_CREATE 9    // Create a channel, returns its ID
+#define SYS_CHAN_SEND   10   // Queue a message on a channel
+#define SYS_CHAN_RECV   11   // Take the oldest message off a channel
+#define SYS_CHAN_CLOSE  12   // Close a channel and release its ID
+#define SYS_IPC_CREATE  13   // Create an IPC endpoint, returns its ID
+#define SYS_CALL        14   // Send an IPC request and wait for the reply
+#define SYS_REPLY_WAIT  15   // Reply to the last IPC caller, wait for the next
+#define SYS_RING_CREATE 16   // Create a shared ring, map producer and consumer ends
+#define SYS_RING_WAIT   17   // Consumer: sleep while a ring is empty
+#define SYS_RING_DOORBELL 18 // Producer: wake a consumer sleeping on a ring
+#define SYS_URING_SETUP 19   // Create and map batched submission/completion rings
+#define SYS_URING_ENTER 20   // Run queued submissions, optionally wait for one
 
 #define MAX_SYSCALLS    256  // Maximum number of syscalls
 
+/**
+ * User registers saved by the syscall entry stubs (pushal order)
+ *
+ * Syscalls may overwrite EBX/ESI/EDI to return more than EAX. ECX/EDX
+ * must be left alone: SYSEXIT resumes from them.
+ */
+struct syscall_regs {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+};
+
 /**
  * Syscall function signature
  *
@@ -61,12 +97,13 @@ typedef long (*syscall_fn_t)(long arg0, long arg1, long arg2, long arg3, long ar
  * @param arg2         Third argument (from EDX)
  * @param arg3         Fourth argument (from ESI)
  * @param arg4         Fifth argument (from EDI)
+ * @param regs         Saved user registers, NULL when called from C
  * @return             Return value (placed in EAX)
  *
  * RT: < 2µs for simple syscalls
  */
 long syscall_handler(uint32_t syscall_num, long arg0, long arg1,
-                     long arg2, long arg3, long arg4);
+                     long arg2, long arg3, long arg4, struct syscall_regs* regs);
 
 /**
  * Initialize syscall subsystem
@@ -76,4 +113,14 @@ long syscall_handler(uint32_t syscall_num, long arg0, long arg1,
  */
 void syscall_init(void);
 
+/**
+ * Enable the fast system call instruction on one CPU (arch hook)
+ *
+ * Called by syscall_init() for the boot CPU and by each AP as it starts.
+ *
+ * @param cpu_id  Calling CPU
+ * @return true if the fast path is enabled on this CPU
+ */
+bool syscall_init_cpu(uint32_t cpu_id);
+
 #endif // KERNEL_SYSCALL_H
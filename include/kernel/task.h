@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <kernel/types.h>
 #include <kernel/mmu.h>
+#include <kernel/ktimer.h>
+#include <kernel/ipc.h>
 
 /**
  * Task/Thread Management
@@ -19,9 +21,22 @@
  * - Priority-based scheduling with O(1) pick
  */
 
+// Largest kernel stack task_create_kernel_thread() accepts (order-4 block)
+#define TASK_MAX_STACK_SIZE (16 * PAGE_SIZE)
+
+// Destroyed task/stack pairs each CPU keeps for reuse
+#define TASK_CACHE_SIZE     8
+
+// Zombies task_create_kernel_thread() reaps when the cache has no match
+#define TASK_REAP_BATCH     4
+
 // Forward declarations
 struct task;
 typedef struct task task_t;
+struct wait_queue;
+struct mutex;
+struct fpu_state;
+struct syscall_regs;
 
 /**
  * Task state
@@ -67,35 +82,87 @@ typedef struct {
  *
  * Represents a single thread of execution.
  * For now: kernel threads only (no user mode, no separate address spaces)
+ *
+ * The first cache line holds what enqueue, pick and switch touch on every
+ * pass (linkage, state, priority, quantum, wait timestamps); the name,
+ * saved registers and everything per-subsystem follow it.
  */
 struct task {
+    // Scheduler linkage
+    struct task*    next;               // Next in run queue
+    struct task*    prev;               // Previous in run queue
+    task_state_t    state;              // Current state
+    uint32_t        cpu;                // CPU whose run queue owns the task
+
+    // Scheduling
+    uint8_t         priority;           // 0 (lowest) - 255 (highest), effective
+    uint8_t         base_priority;      // Own priority, without inheritance
+    bool            on_cpu;             // Context live on a CPU (not yet saved)
+    bool            on_rq;              // Linked on a run queue
+    bool            pinned;             // Never stolen by another CPU
+    bool            dl_throttled;       // Budget spent, waiting for dl_timer
+    uint32_t        quantum_us;         // Round-robin quantum, 0 = SCHED_TIME_SLICE_US
+    uint32_t        slice_left_us;      // Rest of it, refilled on enqueue (periodic tick)
+    uint32_t        dl_budget_us;       // Deadline class CPU time per period, 0 = none
+    uint64_t        ready_tsc;          // Became READY, 0 = not waiting
+    uint64_t        dispatch_tsc;       // Last switched to, 0 = never
+    uint64_t        dl_abs_deadline_us; // Current absolute deadline (EDF key)
+
     // Identity
     uint32_t        task_id;            // Unique task ID
     char            name[32];           // Human-readable name (for debugging)
-
-    // State
-    task_state_t    state;              // Current state
     int             exit_code;          // Exit code (if ZOMBIE)
 
     // CPU context
     cpu_context_t   context;            // Saved CPU state
+    struct fpu_state* fpu;              // Saved FPU/SSE state, NULL until first use
 
     // Memory
     page_table_t*   address_space;      // Address space (for now: kernel's)
     void*           kernel_stack;       // Kernel stack pointer
     size_t          kernel_stack_size;  // Stack size
 
-    // Scheduling
-    uint8_t         priority;           // 0 (lowest) - 255 (highest)
+    // Accounting
     uint64_t        cpu_time_ticks;     // Total CPU time in timer ticks
     uint64_t        last_run_tick;      // When last scheduled
+    uint64_t        run_cycles;         // TSC cycles on a CPU (CONFIG_SCHED_STATS)
+    uint64_t        wait_cycles;        // TSC cycles READY but not running
+    uint64_t        dispatches;         // Times switched to
 
-    // Scheduler linkage
-    struct task*    next;               // Next in run queue
-    struct task*    prev;               // Previous in run queue
+    // Deadline class (scheduler_set_deadline()), inactive while dl_budget_us == 0
+    uint32_t        dl_deadline_us;     // Relative deadline
+    uint32_t        dl_period_us;       // Replenishment period
+    uint64_t        dl_period_end_us;   // When the current budget is replenished
+    int64_t         dl_runtime_cycles;  // Budget left this period, TSC cycles
+    uint32_t        dl_heap_index;      // Slot in the run queue's deadline heap
+    struct ktimer   dl_timer;           // Replenishment
+
+    // Wait queue linkage (waitqueue.h), valid while BLOCKED on one
+    struct wait_queue* wait_queue;      // Queue blocked on, NULL if none
+    struct task*    wait_next;
+    struct task*    wait_prev;
+    uint64_t        wait_key;           // Waiter's key (futex address space and address)
+    int             wait_result;        // 0 = woken, -ETIMEDOUT
+
+    // Priority inheritance (mutex.h)
+    struct mutex*   blocked_on;         // Mutex being waited for, NULL if none
+    struct mutex*   held_mutexes;       // Mutexes owned, most recent first
+
+    // Synchronous IPC (ipc.h)
+    struct ipc_msg  ipc_msg;            // Request or reply being delivered
+    struct task*    ipc_next;           // Next caller queued on an endpoint
+    struct task*    ipc_reply_to;       // Caller this server owes a reply
+    struct syscall_regs* syscall_regs;  // User registers of the syscall in progress
+
+    // Per-CPU zombie list or free task cache, valid once ZOMBIE
+    struct task*    reap_next;
 
     // Future: capability table, unit membership, etc.
-};
+} __attribute__((aligned(64)));     // Slab objects this size are line-aligned
+
+_Static_assert(sizeof(void*) != 4 ||
+               offsetof(struct task, dl_abs_deadline_us) + sizeof(uint64_t) <= 64,
+               "scheduler-hot task fields must fit the first cache line");
 
 /**
  * Initialize task subsystem
@@ -109,7 +176,9 @@ void task_init(void);
  *
  * @return  Pointer to allocated task, or NULL on failure
  *
- * RT: O(1) - single page allocation
+ * Allocated from the slab allocator; free with task_destroy().
+ *
+ * RT: O(1) - kmalloc front-cache hit
  */
 task_t* task_alloc(void);
 
@@ -120,22 +189,34 @@ task_t* task_alloc(void);
  * @param entry_point   Function to execute
  * @param arg           Argument to pass to entry_point
  * @param priority      Priority (0-255, higher = more important)
- * @param stack_size    Stack size in bytes (must be page-aligned)
+ * @param stack_size    Stack size in bytes (page multiple, <= TASK_MAX_STACK_SIZE;
+ *                      rounded up to a power-of-two number of pages)
+ * @param quantum_us    Round-robin quantum (0 = SCHED_TIME_SLICE_US, otherwise
+ *                      SCHED_QUANTUM_MIN_US..SCHED_QUANTUM_MAX_US)
  * @return              New task, or NULL on failure
  *
- * RT: O(1) - allocates fixed structures, no loops
+ * Reuses a cached task/stack pair of the same size when one exists
+ * (reaping exited tasks for one if needed), so the struct and stack are
+ * warm and need no allocation.
+ *
+ * RT: O(1) on a cache hit. Otherwise NOT RT-safe for stacks > 4096:
+ * contiguous allocation searches the PMM.
  */
 task_t* task_create_kernel_thread(const char* name,
                                    void (*entry_point)(void* arg),
                                    void* arg,
                                    uint8_t priority,
-                                   size_t stack_size);
+                                   size_t stack_size,
+                                   uint32_t quantum_us);
 
 /**
  * Destroy a task
  *
- * Frees task resources and removes from scheduler.
- * Must NOT be called on currently running task.
+ * Releases its FPU state and parks the task struct with its kernel stack
+ * in this CPU's free cache for the next task_create_kernel_thread() of
+ * the same stack size; only a full cache returns them to the allocators.
+ * Must NOT be called on currently running task, nor from interrupt
+ * context (exited tasks reach here through task_reap()).
  *
  * @param task  Task to destroy
  *
@@ -143,6 +224,28 @@ task_t* task_create_kernel_thread(const char* name,
  */
 void task_destroy(task_t* task);
 
+/**
+ * Queue an exited task for task_reap() on this CPU
+ *
+ * Called by the scheduler once the task's context is saved and no CPU
+ * runs on its stack any more. Interrupts must be disabled.
+ *
+ * RT: O(1)
+ */
+void task_queue_zombie(task_t* task);
+
+/**
+ * Destroy up to `max` of this CPU's exited tasks
+ *
+ * Runs in task context from the idle loop and task_create_kernel_thread(),
+ * so teardown never lengthens a context switch or an interrupt.
+ *
+ * @return  Number of tasks reaped
+ *
+ * RT: O(max)
+ */
+uint32_t task_reap(uint32_t max);
+
 /**
  * Exit current task
  *
@@ -162,6 +265,20 @@ void task_exit(int exit_code) __attribute__((noreturn));
  */
 void task_yield(void);
 
+/**
+ * Sleep for at least `us` microseconds
+ *
+ * Blocks the current task (TASK_STATE_BLOCKED) on a kernel timer; the
+ * timer makes it READY again on expiry. `us == 0` just yields.
+ *
+ * @param us  Minimum sleep time (rounded up to KTIMER_TICK_US)
+ * @return    0 after waking, -EPERM from the idle or bootstrap context
+ *
+ * RT: O(1) to block; wakeup latency is the timer interrupt plus one
+ *     scheduling decision
+ */
+int task_sleep_us(uint64_t us);
+
 /**
  * Get current task
  *
@@ -176,10 +293,21 @@ task_t* task_current(void);
 /**
  * Get idle task
  *
- * Returns the idle task (always schedulable, lowest priority).
+ * Returns this CPU's idle task (always schedulable, lowest priority).
  *
  * @return  Idle task pointer
  */
 task_t* task_get_idle(void);
 
+/**
+ * Create the idle task for a CPU
+ *
+ * Stores it in per_cpu_data.idle_task. Idle tasks are never on a ready
+ * queue; the scheduler runs them when nothing else is ready.
+ *
+ * @param cpu_id  CPU the idle task belongs to
+ * @return        Idle task, or NULL on allocation failure
+ */
+task_t* task_create_idle(uint32_t cpu_id);
+
 #endif // KERNEL_TASK_H
@@ -2,29 +2,56 @@
 #define KERNEL_TIMER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * Timer subsystem - Provides microsecond-precision timing via TSC calibration
  *
  * Uses PIT (Programmable Interval Timer) to calibrate the TSC (Time Stamp Counter)
  * for accurate microsecond timing.
+ *
+ * With CONFIG_TICKLESS the timer does not tick at a fixed rate: each CPU
+ * arms one interrupt for its nearest deadline and none at all while idle.
  */
 
+// No pending event (used by timer_event_update and its callers)
+#define TIMER_NO_EVENT UINT64_MAX
+
 // Initialize timer hardware and calibrate TSC
 // frequency_hz: Timer interrupt frequency (typically 1000 Hz)
 void timer_init(uint32_t frequency_hz);
 
+// Start the calling AP's local APIC timer at frequency_hz
+// Returns: 0 on success, -ENODEV if the APIC timer is unavailable
+int timer_init_ap(uint32_t frequency_hz);
+
 // Read TSC (Time Stamp Counter) directly
 // Returns: CPU cycle count since boot
 uint64_t timer_read_tsc(void);
 
 // Read time in microseconds
 // Returns: Microseconds since boot (calibrated via TSC)
+// RT: O(1), multiply-shift, no division (kernel/clocksource.h)
 uint64_t timer_read_us(void);
 
+// Read time in nanoseconds, same timebase as timer_read_us()
+uint64_t timer_read_ns(void);
+
+// Get timer interrupt frequency in Hz (as passed to timer_init)
+uint32_t timer_get_frequency(void);
+
 // Get TSC frequency in Hz (available after calibration)
 uint64_t timer_get_tsc_freq(void);
 
+// True if the timer runs one-shot (CONFIG_TICKLESS) rather than periodic
+bool timer_is_tickless(void);
+
+// Ask for a timer interrupt on the calling CPU no later than deadline_us
+// (absolute, timer_read_us() timebase). Only ever moves the armed event
+// earlier, so a later or TIMER_NO_EVENT deadline costs no hardware access;
+// the next interrupt re-arms from scratch. No-op in periodic mode.
+void timer_event_update(uint64_t deadline_us);
+
 // Timer interrupt handler (called by IRQ 0 -> INT 32)
 void timer_interrupt_handler(void);
 
@@ -0,0 +1,127 @@
+#ifndef KERNEL_TRACE_H
+#define KERNEL_TRACE_H
+
+#include <stdint.h>
+#include <kernel/config.h>
+#include <kernel/percpu.h>
+
+/**
+ * Trace points
+ *
+ * Instrumentation sites call trace_point(), which records into this
+ * CPU's trace buffer (trace_event(), kernel/percpu.h) only if the event
+ * type's bit is set in trace_enabled_mask. With CONFIG_TRACE=0 every
+ * trace point compiles to nothing, arguments included.
+ *
+ * Events and their data words:
+ *
+ *   TRACE_INTERRUPT       vector                          (handler entry)
+ *   TRACE_INTERRUPT_EXIT  vector, cycles in the handler   (after EOI)
+ *   TRACE_SCHEDULE        from task ID, to task ID, direct (1) or picked (0)
+ *   TRACE_TASK_SWITCH     cycles, from task ID, to task ID, fast path
+ *   TRACE_SYSCALL         number, result, cycles
+ *   TRACE_TLB_FLUSH       TRACE_TLB_*, address (TRACE_TLB_PAGE only)
+ *   TRACE_PROFILE_SAMPLE  EIP, task ID, pmu_event_t, ring (kernel/pmu.h)
+ *
+ * RT: a disabled trace point is one load and a branch; an enabled one
+ * also reads the TSC and copies 48 bytes with interrupts off
+ */
+
+// Kinds of TRACE_TLB_FLUSH
+#define TRACE_TLB_PAGE      0   // invlpg
+#define TRACE_TLB_ALL       1   // CR3 reload, global entries kept
+#define TRACE_TLB_GLOBAL    2   // CR4.PGE toggle, everything
+#define TRACE_TLB_SWITCH    3   // Address space switch
+
+#define TRACE_BIT(type)     (1u << (type))
+
+// Context switch costs were always recorded; keep them on by default
+#define TRACE_DEFAULT_MASK  TRACE_BIT(TRACE_TASK_SWITCH)
+
+extern volatile uint32_t trace_enabled_mask;
+
+#if CONFIG_TRACE
+#define trace_enabled(type) ((trace_enabled_mask & TRACE_BIT(type)) != 0)
+#else
+#define trace_enabled(type) 0
+#endif
+
+#define trace_point(type, d0, d1, d2, d3) do { \
+        if (trace_enabled(type)) { \
+            trace_event((type), (d0), (d1), (d2), (d3)); \
+        } \
+    } while (0)
+
+/**
+ * Choose which event types trace_point() records (TRACE_BIT() per type)
+ */
+void trace_set_mask(uint32_t mask);
+
+/**
+ * Binary export
+ *
+ * trace_export() drains every CPU's buffer and writes it to a serial port
+ * as chunks that scripts/trace2json.py turns into Chrome trace JSON (which
+ * Perfetto also loads). A chunk is written in one serial_write_raw(), so
+ * console text can only land between chunks; the converter skips it by
+ * looking for the magic. All integers are little-endian.
+ *
+ *   header  u32 magic "AKTR", u8 version, u8 0, u16 CPUs, u64 TSC Hz
+ *   record  u8 tag, varint CPU, varint TSC delta, varint word x N
+ *   ...
+ *   end     u8 TRACE_EXPORT_TAG_END
+ *
+ * tag = type | N << 5: N is the number of data words kept (trailing zero
+ * words are dropped). The TSC delta is from the CPU's previous record in
+ * the same chunk, from 0 for its first one. A TRACE_EXPORT_TAG_LOST
+ * record carries the events that CPU dropped since the last export.
+ * Varints are LEB128: 7 bits per byte, low bits first, top bit set on all
+ * but the last byte.
+ */
+
+#define TRACE_EXPORT_MAGIC       0x52544B41u   // "AKTR"
+#define TRACE_EXPORT_VERSION     1
+#define TRACE_EXPORT_HEADER_SIZE 16
+#define TRACE_EXPORT_RECORD_MAX  56            // Tag, 5 + 10 + 4 x 10 varint bytes
+#define TRACE_EXPORT_TAG_LOST    0x1E
+#define TRACE_EXPORT_TAG_END     0x1F
+#define TRACE_EXPORT_US          100000        // Streaming thread period
+
+_Static_assert(TRACE_EVENT_COUNT < TRACE_EXPORT_TAG_LOST, "event types must fit in a tag");
+
+struct serial_port;
+
+/**
+ * Encode a chunk header
+ *
+ * @return TRACE_EXPORT_HEADER_SIZE
+ */
+size_t trace_export_header(uint8_t* out, uint16_t nr_cpus, uint64_t tsc_freq_hz);
+
+/**
+ * Encode one event
+ *
+ * @param last_tsc  The CPU's previous timestamp in this chunk (0 at the
+ *                  start); updated
+ * @return Bytes written, at most TRACE_EXPORT_RECORD_MAX
+ */
+size_t trace_export_encode(uint8_t* out, const struct trace_event* event, uint64_t* last_tsc);
+
+/**
+ * Drain every online CPU's trace buffer to `port`
+ *
+ * Writes nothing if no CPU recorded or dropped anything.
+ *
+ * @return Events written, -ENODEV without a port, -EBUSY if another
+ *         export is running
+ */
+int trace_export(struct serial_port* port);
+
+/**
+ * Start a kernel thread that calls trace_export() every period_us
+ *
+ * @return 0, -ENODEV, -ENOMEM
+ */
+int trace_export_start(struct serial_port* port, uint64_t period_us);
+
+#endif // KERNEL_TRACE_H
@@ -115,5 +115,15 @@ static inline bool list_empty(const struct list_head* list) {
 #define EBUSY       16  // Device or resource busy
 #define EIO          5  // I/O error
 #define EPERM        1  // Operation not permitted
+#define EFAULT      14  // Bad address
+#define EOVERFLOW   75  // Value too large for defined data type
+#define EAGAIN      11  // Try again (value changed before blocking)
+#define EDEADLK     35  // Resource deadlock would occur
+#define ETIMEDOUT  110  // Timed out
+#define EPIPE       32  // Other end closed
+#define EMSGSIZE    90  // Message too long
+#define EBADF        9  // Bad handle
+#define EACCES      13  // Permission denied
+#define ENOEXEC      8  // Exec format error
 
 #endif // KERNEL_TYPES_H
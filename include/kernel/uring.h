@@ -0,0 +1,135 @@
+#ifndef KERNEL_URING_H
+#define KERNEL_URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+#include <kernel/ring.h>
+
+/**
+ * Batched syscall submission and completion rings
+ *
+ * io_uring-style: a user task queues syscalls as entries on a shared
+ * submission ring (SQ) and collects their results from a completion ring
+ * (CQ), both single-page SPSC rings (ring.h). One SYS_URING_ENTER runs a
+ * whole batch through the regular syscall table, so the INT 0x80 /
+ * SYSENTER round trip is paid once per batch instead of once per call.
+ *
+ * With URING_SETUP_SQPOLL a kernel thread consumes the SQ instead: it
+ * polls while entries keep coming, then sleeps on the empty SQ, and the
+ * submitter only enters the kernel when ring_doorbell_needed() says the
+ * poller went to sleep.
+ *
+ * Entries run in order, each to completion (a blocking call blocks the
+ * batch), as if called by the task that consumes the SQ: the caller of
+ * SYS_URING_ENTER, or the poller. The poller runs in the owner's address
+ * space, so pointer arguments and futex keys mean the same as for the
+ * owner, but syscalls that act on the calling task itself (getpid, yield,
+ * sleep, quantum, task stats) are refused under SQPOLL. IPC calls are
+ * refused in any batch: their words travel in registers, and a
+ * completion only carries the return value.
+ *
+ * RT Constraints:
+ * - uring_submit(): O(entries) plus whatever the entries cost
+ */
+
+#define URING_SQ_ENTRIES    64   // Submission slots (one stays empty)
+#define URING_CQ_ENTRIES    128  // Completion slots, room for two batches
+#define URING_MAX_RINGS     16   // IDs handed out to user tasks
+#define URING_POLL_IDLE_US  200  // SQPOLL: keep polling this long when idle
+
+// Setup flags
+#define URING_SETUP_SQPOLL  (1u << 0)   // Kernel thread consumes the SQ
+
+// Enter flags
+#define URING_ENTER_WAIT    (1u << 0)   // Then sleep until a completion is queued
+
+// Submission entry: one syscall
+struct uring_sqe {
+    uint32_t opcode;            // Syscall number
+    uint32_t user_data;         // Echoed in the completion
+    int32_t  args[5];           // arg0 - arg4
+    uint32_t reserved;
+};
+
+// Completion entry
+struct uring_cqe {
+    uint32_t user_data;
+    int32_t  result;            // Syscall return value
+};
+
+typedef struct uring {
+    ring_t*  sq;                // User produces, kernel consumes
+    ring_t*  cq;                // Kernel produces, user consumes
+    page_table_t* owner;        // Creating program's address space, NULL once it exited
+    struct task* poller;        // SQPOLL thread, NULL if unused
+    atomic_t poller_stop;       // Set by uring_release_owner()
+    atomic_t poller_done;       // Poller left the owner's address space
+    atomic_t busy;              // SQ consumer in progress (SPSC: one at a time)
+
+    // Statistics
+    uint64_t submitted;         // Entries run
+    uint64_t batches;           // uring_submit() calls that ran entries
+} uring_t;
+
+/**
+ * Create a submission/completion ring pair
+ *
+ * The poller (URING_SETUP_SQPOLL) is started by uring_start_poller(), once
+ * the rings are mapped.
+ *
+ * @param owner Address space of the program the pair belongs to
+ * @return Pair, or NULL if out of memory
+ */
+uring_t* uring_create(page_table_t* owner);
+
+/**
+ * Free a pair that was never installed and has no poller
+ *
+ * Its mappings keep the ring pages until they are released.
+ */
+void uring_destroy(uring_t* uring);
+
+/**
+ * Start the SQPOLL thread
+ *
+ * It runs in the owner's address space until uring_release_owner().
+ *
+ * @return 0, or -ENOMEM
+ */
+int uring_start_poller(uring_t* uring);
+
+/**
+ * Detach an exiting program from its pairs
+ *
+ * Stops their pollers and waits until each has left the address space,
+ * which must stay alive until this returns. A poller blocked in an entry
+ * finishes that entry first. The pairs keep their IDs but no longer
+ * belong to anyone.
+ *
+ * NOT RT-safe: sleeps
+ */
+void uring_release_owner(page_table_t* owner);
+
+/**
+ * Run up to `max` queued entries
+ *
+ * Stops early when the SQ is empty or the CQ has no room for another
+ * result, so no completion is ever dropped.
+ *
+ * @return Entries run, or -EBUSY if another task is consuming the SQ
+ */
+int uring_submit(uring_t* uring, uint32_t max);
+
+/**
+ * uring IDs for user tasks
+ *
+ * uring_install() returns an ID (1..URING_MAX_RINGS) or -ENOMEM once all
+ * are taken; installed pairs live until shutdown. uring_lookup() returns
+ * the pair, or NULL if the ID is unknown or the pair does not belong to
+ * `as` (IDs are global, but only the owner may use them).
+ */
+int uring_install(uring_t* uring);
+uring_t* uring_lookup(int id, page_table_t* as);
+
+#endif // KERNEL_URING_H
@@ -12,16 +12,27 @@
 /**
  * Userspace Virtual Memory Layout
  *
- * 0x00000000 - 0x00400000: Reserved (NULL pointer guard)
- * 0x00400000 - 0x00800000: User code & data (4MB)
- * 0xBFFFF000 - 0xC0000000: User stack (4KB, grows down)
+ * 0x00000000 - 0x08000000: Kernel identity map (NULL page unmapped,
+ *                          not accessible from ring 3)
+ * 0x08000000 - 0x10000000: User code & data (128MB, ELF segments)
+ * 0x10000000 - 0x11000000: User heap (16MB, demand-paged)
+ * 0x11000000 - 0x11001000: Kernel data page (read-only, see kernel/vdso.h)
+ * 0xBFF00000 - 0xC0000000: User stack (1MB, demand-paged, grows down)
  * 0xC0000000 - 0xFFFFFFFF: Kernel space (not accessible from ring 3)
+ *
+ * Heap and stack are reserved with mmu_reserve_region(): creating a task
+ * commits no memory for them, each page gets a frame on first touch.
+ * Everything outside 0x08000000 - 0xC0000000 is the kernel's, shared by
+ * all address spaces (mmu_create_user_address_space()).
  */
 
-#define USER_CODE_BASE    0x00400000  // 4MB - standard ELF load address
-#define USER_CODE_SIZE    0x00400000  // 4MB max
+#define USER_CODE_BASE    0x08000000  // 128MB, covers the i386 ELF default 0x08048000
+#define USER_CODE_SIZE    0x08000000  // Up to the heap
+#define USER_HEAP_BASE    0x10000000  // 256MB, above the kernel identity map
+#define USER_HEAP_SIZE    0x01000000  // 16MB
+#define USER_VDSO_BASE    0x11000000  // Right after the heap
 #define USER_STACK_TOP    0xC0000000  // Just below kernel (3GB)
-#define USER_STACK_SIZE   0x00001000  // 4KB
+#define USER_STACK_SIZE   0x00100000  // 1MB
 
 // GDT selectors for userspace (with RPL=3)
 #define USER_CS_SELECTOR  0x1B  // GDT entry 3 with RPL=3
@@ -41,4 +52,22 @@
 struct task;
 struct task* task_create_user(const char* name, void* entry_point, size_t code_size);
 
+/**
+ * Create a userspace task from an ELF32 executable
+ *
+ * The task gets its own address space. The image is not copied: its
+ * segments are mapped onto the image's frames (see elf_load()), so the
+ * image must stay in place (e.g. a boot module) while any task runs it,
+ * and every task started from the same image shares its read-only pages.
+ *
+ * @param name   Task name
+ * @param image  Physical address of the page-aligned ELF image
+ * @param size   Image size in bytes
+ * @return       Task pointer, or NULL if the image is not loadable or
+ *               memory ran out
+ *
+ * NOT RT-safe: allocates an address space and a kernel stack
+ */
+struct task* task_create_user_elf(const char* name, phys_addr_t image, size_t size);
+
 #endif // KERNEL_USER_H
@@ -0,0 +1,107 @@
+#ifndef KERNEL_VDSO_H
+#define KERNEL_VDSO_H
+
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/mmu.h>
+
+/**
+ * Kernel data page (vDSO-style)
+ *
+ * One page the kernel writes and every user task can read, mapped
+ * read-only at USER_VDSO_BASE. It publishes what user code would
+ * otherwise need a syscall for on a hot path:
+ *
+ * - The clock: TSC frequency and a time base, so a timestamp is an RDTSC
+ *   and a division. The base is seqlock-protected: seq is odd while the
+ *   kernel rewrites it and readers retry across a change.
+ * - Identity: per CPU, the ID of the task running there, rewritten on
+ *   every context switch under the slot's own sequence count. With RDTSCP
+ *   (IA32_TSC_AUX holds the CPU ID) or a single CPU, a task finds its slot
+ *   without entering the kernel.
+ *
+ * Each CPU slot fills its own cache line, so a switch on one CPU does not
+ * disturb readers on another. The readers live in include/user/vdso.h.
+ *
+ * RT Constraints:
+ * - vdso_switch(): O(1), three stores, called with IRQs off
+ * - vdso_update_clock(): O(1)
+ * - vdso_init()/vdso_map(): allocate, not RT-safe
+ */
+
+#define VDSO_VERSION        1
+#define VDSO_CACHE_LINE     64
+#define VDSO_MAX_CPUS       63   // One line each after the clock's line
+
+#define VDSO_FEAT_RDTSCP    (1u << 0)  // rdtscp returns the CPU ID in ECX
+
+// Clock and system facts, line 0
+struct vdso_clock {
+    volatile uint32_t seq;      // Odd while the fields below change
+    uint32_t version;           // VDSO_VERSION
+    uint32_t nr_cpus;           // CPUs that may run tasks
+    uint32_t features;          // VDSO_FEAT_*
+    uint64_t tsc_freq_hz;       // 0 until the TSC is calibrated
+    uint64_t tsc_per_us;        // tsc_freq_hz / 1000000, the divisor
+    uint64_t base_tsc;          // time_us = base_us + (tsc - base_tsc) / tsc_per_us
+    uint64_t base_us;
+} __attribute__((aligned(VDSO_CACHE_LINE)));
+
+// Written by its own CPU only
+struct vdso_cpu {
+    volatile uint32_t seq;      // Odd while task_id changes
+    volatile uint32_t task_id;  // Task running on this CPU
+} __attribute__((aligned(VDSO_CACHE_LINE)));
+
+struct vdso_data {
+    struct vdso_clock clock;
+    struct vdso_cpu   cpu[VDSO_MAX_CPUS];
+};
+
+/**
+ * Allocate and fill the data page, map it into the kernel address space
+ *
+ * Needs the PMM, the MMU, the calibrated TSC and the CPU count.
+ *
+ * @return 0, -ENOMEM, or an error from vdso_map()
+ */
+int vdso_init(void);
+
+/**
+ * Map the data page read-only for user mode at USER_VDSO_BASE
+ *
+ * Safe to repeat on an address space that already has it.
+ *
+ * @return 0, -ENODEV before vdso_init(), -ENOMEM
+ */
+int vdso_map(page_table_t* as);
+
+/**
+ * Publish a new time base
+ *
+ * Callers serialize among themselves; readers never block.
+ */
+void vdso_update_clock(uint64_t tsc_freq_hz, uint64_t base_tsc, uint64_t base_us);
+
+// Kernel view of the page (identity map), NULL before vdso_init()
+extern struct vdso_data* vdso_data_page;
+
+/**
+ * Publish the task now running on a CPU
+ *
+ * Called by the scheduler on every switch, on the CPU itself.
+ */
+static inline void vdso_switch(uint32_t cpu_id, uint32_t task_id) {
+    struct vdso_data* data = vdso_data_page;
+    if (!data || cpu_id >= VDSO_MAX_CPUS) {
+        return;
+    }
+    struct vdso_cpu* slot = &data->cpu[cpu_id];
+    slot->seq++;
+    wmb();
+    slot->task_id = task_id;
+    wmb();
+    slot->seq++;
+}
+
+#endif // KERNEL_VDSO_H
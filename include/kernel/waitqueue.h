@@ -0,0 +1,121 @@
+#ifndef KERNEL_WAITQUEUE_H
+#define KERNEL_WAITQUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/types.h>
+#include <kernel/task.h>
+#include <kernel/spinlock.h>
+
+/**
+ * Wait Queues
+ *
+ * FIFO of tasks blocked until some event, for kernel code that would
+ * otherwise spin or task_yield() in a loop. A blocked task is off every
+ * run queue (TASK_STATE_BLOCKED); waking it makes it READY and hands it
+ * to scheduler_enqueue() on its CPU.
+ *
+ * Lost wakeups are avoided by checking the condition under the queue
+ * lock and blocking without dropping it:
+ *
+ *   uint32_t flags = wait_queue_lock(&wq);
+ *   while (!condition) {
+ *       wait_queue_block_locked(&wq, flags, 0, 0);
+ *       flags = wait_queue_lock(&wq);
+ *   }
+ *   wait_queue_unlock(&wq, flags);
+ *
+ * Lock order: wait queue lock, then run queue lock (see scheduler.c).
+ *
+ * RT Constraints:
+ * - Block, wake-one: O(1)
+ * - Wake-all: O(waiters); wake-key: O(queue length)
+ */
+
+typedef struct wait_queue {
+    task_t*  head;              // Oldest waiter (woken first)
+    task_t*  tail;
+    uint32_t count;             // Tasks blocked here
+    spinlock_t lock;            // Taken with IRQs off
+} wait_queue_t;
+
+/**
+ * Initialize an empty wait queue
+ *
+ * A zero-filled wait_queue_t (e.g. in .bss) is already empty.
+ */
+void wait_queue_init(wait_queue_t* wq);
+
+/**
+ * Lock a wait queue (disables interrupts)
+ *
+ * @return Saved interrupt state for wait_queue_unlock()
+ */
+uint32_t wait_queue_lock(wait_queue_t* wq);
+
+/**
+ * Unlock a wait queue and restore interrupts
+ */
+void wait_queue_unlock(wait_queue_t* wq, uint32_t flags);
+
+/**
+ * Block the current task on a locked wait queue
+ *
+ * Queues the caller, drops the lock and switches away in one step, so a
+ * waker that takes the lock afterwards always finds the task queued.
+ * Returns with the queue unlocked and interrupts restored.
+ *
+ * @param flags      Value returned by wait_queue_lock()
+ * @param key        Opaque waiter key for wait_queue_wake_key() (0 = none)
+ * @param timeout_us Give up after this long (0 = wait forever)
+ * @return 0 when woken, -ETIMEDOUT on timeout, -EPERM from the idle or
+ *         bootstrap context (nothing is queued then)
+ */
+int wait_queue_block_locked(wait_queue_t* wq, uint32_t flags, uint64_t key,
+                            uint64_t timeout_us);
+
+/**
+ * Block the current task until woken (takes and drops the lock)
+ *
+ * Only for callers that need no condition check under the lock.
+ */
+int wait_queue_block(wait_queue_t* wq, uint64_t timeout_us);
+
+/**
+ * Wake the oldest waiter
+ *
+ * @return true if a task was woken
+ *
+ * RT: O(1)
+ */
+bool wait_queue_wake_one(wait_queue_t* wq);
+
+/**
+ * Wake every waiter
+ *
+ * @return Number of tasks woken
+ *
+ * RT: O(waiters)
+ */
+uint32_t wait_queue_wake_all(wait_queue_t* wq);
+
+/**
+ * Wake up to `max` waiters that blocked with `key`, oldest first
+ *
+ * @return Number of tasks woken
+ *
+ * RT: O(queue length)
+ */
+uint32_t wait_queue_wake_key(wait_queue_t* wq, uint64_t key, uint32_t max);
+
+/**
+ * Wake one particular waiter of a locked queue
+ *
+ * For callers that choose the waiter themselves (e.g. by priority),
+ * walking head/wait_next under the lock. Leaves the queue locked.
+ *
+ * RT: O(1)
+ */
+void wait_queue_wake_task_locked(wait_queue_t* wq, task_t* task);
+
+#endif // KERNEL_WAITQUEUE_H
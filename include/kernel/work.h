@@ -0,0 +1,106 @@
+#ifndef KERNEL_WORK_H
+#define KERNEL_WORK_H
+
+#include <kernel/types.h>
+
+/**
+ * Deferred work (bottom halves)
+ *
+ * A top half (hard IRQ handler) does the minimum with interrupts masked
+ * and hands the rest to schedule_work_on_cpu(). Each CPU has one queue:
+ * any CPU may push (a lock-free LIFO of pending items, one CAS), only
+ * the owning CPU takes items off (one exchange grabs them all, then they
+ * run oldest first).
+ *
+ * Work runs on its CPU at two places:
+ * - on the way out of irq_handler(), after the EOI and with interrupts
+ *   enabled, at most WORK_IRQ_BUDGET items per interrupt;
+ * - in that CPU's worker thread ("kworker/N"), which takes what the
+ *   interrupt exit left over and work queued from task context.
+ *
+ * Pushing onto an empty remote queue sends SMP_IPI_WORK, whose exit
+ * drains it. Work functions must not block, and must not take a lock
+ * that task code holds with interrupts enabled: treat them like
+ * interrupt handlers that run with interrupts on.
+ *
+ * An item is queued at most once: it is pending from
+ * schedule_work_on_cpu() until just before its function runs, so the
+ * function may queue it again.
+ *
+ * RT Constraints:
+ * - schedule_work_on_cpu(): O(1), lock-free, plus one IPI or wake-up
+ *   when the queue was empty
+ * - Interrupt exit: O(1) with nothing queued, otherwise bounded by
+ *   WORK_IRQ_BUDGET work functions
+ */
+
+#define WORK_IRQ_BUDGET         8       // Items per interrupt exit
+#define WORK_WORKER_BUDGET      32      // Items per worker pass before yielding
+#define WORK_WORKER_PRIORITY    192     // Above SCHED_DEFAULT_PRIORITY tasks
+
+// CPU-local work queue (for deferred work)
+struct work_item {
+    void (*func)(void* data);
+    void* data;
+    struct work_item* next;
+    volatile uint32_t pending;      // Queued and not yet started
+};
+
+#define WORK_ITEM_INIT(fn, arg) { (fn), (arg), NULL, 0 }
+
+static inline void work_init_item(struct work_item* work, void (*func)(void*), void* data) {
+    work->func = func;
+    work->data = data;
+    work->next = NULL;
+    work->pending = 0;
+}
+
+/**
+ * Queue work on a CPU
+ *
+ * Safe from any context, including hard IRQ handlers.
+ *
+ * @return true if queued, false if it was still pending (it will run
+ *         once) or the CPU is not online
+ *
+ * RT: O(1)
+ */
+bool schedule_work_on_cpu(uint32_t cpu_id, struct work_item* work);
+
+/**
+ * Run up to `budget` pending items of the calling CPU
+ *
+ * Work functions run in the caller's interrupt state. Returns at once
+ * when this CPU is already running work (a nested interrupt).
+ *
+ * @return true if items are left over
+ */
+bool process_pending_work(uint32_t budget);
+
+/**
+ * Called by irq_handler() after the EOI; see above
+ */
+void work_irq_exit(void);
+
+/**
+ * Start a pinned worker thread on every online CPU
+ *
+ * @return 0, -ENOMEM
+ */
+int work_start(void);
+
+/**
+ * Whether a CPU has work queued (racy; for statistics and tests)
+ */
+bool work_pending(uint32_t cpu_id);
+
+struct work_stats {
+    uint32_t queued;
+    uint32_t kicks;     // IPIs and worker wake-ups
+    uint64_t done;
+    uint64_t worker;    // Items the worker ran (the rest ran at interrupt exit)
+};
+
+void work_get_stats(uint32_t cpu_id, struct work_stats* stats);
+
+#endif // KERNEL_WORK_H
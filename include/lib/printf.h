@@ -0,0 +1,53 @@
+#ifndef LIB_PRINTF_H
+#define LIB_PRINTF_H
+
+#include <stddef.h>
+#include <stdarg.h>
+
+/**
+ * Bounded String Formatting
+ *
+ * The formatter behind kprintf(), usable without printing anything.
+ *
+ * Supported conversions:
+ *   %d %i %u %x %X %p %s %c %%
+ *   '0' flag and field width (e.g. %08x), 'l' and 'll' length modifiers
+ *
+ * RT: O(output length), no allocation
+ */
+
+/**
+ * Output sink for kvformat()
+ *
+ * Characters go to buf[0..size). When it fills up, flush() is called to
+ * empty it (it must reset len); without flush() the rest is counted but
+ * dropped.
+ */
+struct kfmt_sink {
+    char*  buf;
+    size_t size;
+    size_t len;
+    void (*flush)(struct kfmt_sink* sink);
+    void*  ctx;     // For flush()
+};
+
+/**
+ * Format into a sink
+ *
+ * @return Number of characters produced (whether kept or not)
+ */
+int kvformat(struct kfmt_sink* sink, const char* format, va_list args);
+
+/**
+ * Format into a buffer (always null-terminates if size > 0)
+ *
+ * @param buf   Destination buffer
+ * @param size  Size of destination buffer
+ * @return      Length of the full output (>= size means truncated)
+ */
+int kvsnprintf(char* buf, size_t size, const char* format, va_list args);
+
+int ksnprintf(char* buf, size_t size, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#endif // LIB_PRINTF_H
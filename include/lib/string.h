@@ -38,6 +38,15 @@ size_t strlcat(char* dst, const char* src, size_t size);
  */
 size_t strlen(const char* s);
 
+/**
+ * String compare
+ *
+ * @param s1  First string
+ * @param s2  Second string
+ * @return    0 if equal, <0 if s1 < s2, >0 if s1 > s2
+ */
+int strcmp(const char* s1, const char* s2);
+
 /**
  * Memory copy
  *
@@ -48,6 +57,16 @@ size_t strlen(const char* s);
  */
 void* memcpy(void* dest, const void* src, size_t n);
 
+/**
+ * Memory move (overlapping regions allowed)
+ *
+ * @param dest  Destination
+ * @param src   Source
+ * @param n     Number of bytes to move
+ * @return      dest pointer
+ */
+void* memmove(void* dest, const void* src, size_t n);
+
 /**
  * Memory set
  *
@@ -58,6 +77,21 @@ void* memcpy(void* dest, const void* src, size_t n);
  */
 void* memset(void* ptr, int value, size_t n);
 
+/**
+ * Zero or copy one 4KB page (page-aligned pointers)
+ *
+ * The _nt variants bypass the caches where the CPU can (SSE2): use them
+ * for pages that will not be read soon, such as pre-zeroed pool frames,
+ * so that they do not evict the working set. The others leave the page
+ * in the cache for a caller about to use it.
+ *
+ * RT: O(4KB), no branches on content
+ */
+void memzero_page(void* page);
+void memcpy_page(void* dst, const void* src);
+void memzero_page_nt(void* page);
+void memcpy_page_nt(void* dst, const void* src);
+
 /**
  * Memory compare
  *
@@ -0,0 +1,112 @@
+#ifndef USER_VDSO_H
+#define USER_VDSO_H
+
+#include <stdint.h>
+#include <kernel/vdso.h>
+#include <kernel/user.h>
+#include <kernel/syscall.h>
+
+/**
+ * User-side readers for the kernel data page
+ *
+ * Header-only: every helper is a few loads and at most two RDTSC(P)s,
+ * and none enters the kernel. Where the page cannot answer (several CPUs
+ * and no RDTSCP, or a CPU beyond VDSO_MAX_CPUS) the helpers return
+ * -ENOSYS and the caller falls back to the syscall (SYS_GETPID).
+ *
+ * RT: O(1); a reader retries only while the kernel rewrites what it reads
+ */
+
+static inline const struct vdso_data* vdso_data(void) {
+    return (const struct vdso_data*)USER_VDSO_BASE;
+}
+
+/**
+ * Monotonic time in microseconds, same clock as timer_read_us()
+ *
+ * @return 0 until the kernel has calibrated the TSC
+ */
+static inline uint64_t vdso_time_us(void) {
+    const struct vdso_clock* clock = &vdso_data()->clock;
+    uint32_t seq;
+    uint64_t us;
+
+    do {
+        seq = clock->seq;
+        rmb();  // Sequence before the fields it covers
+        if (clock->tsc_per_us == 0) {
+            us = 0;
+        } else {
+            uint64_t tsc = __builtin_ia32_rdtsc();
+            us = clock->base_us + (tsc - clock->base_tsc) / clock->tsc_per_us;
+        }
+        rmb();  // Fields before the recheck
+    } while ((seq & 1) || seq != clock->seq);
+    return us;
+}
+
+/**
+ * TSC frequency in Hz (0 before calibration)
+ */
+static inline uint64_t vdso_tsc_freq_hz(void) {
+    const struct vdso_clock* clock = &vdso_data()->clock;
+    uint32_t seq;
+    uint64_t hz;
+
+    do {
+        seq = clock->seq;
+        rmb();
+        hz = clock->tsc_freq_hz;
+        rmb();
+    } while ((seq & 1) || seq != clock->seq);
+    return hz;
+}
+
+/**
+ * CPU the caller runs on; may be stale as soon as it returns
+ *
+ * @return CPU ID, or -ENOSYS if the page cannot tell
+ */
+static inline int vdso_cpu_id(void) {
+    const struct vdso_clock* clock = &vdso_data()->clock;
+    if (clock->features & VDSO_FEAT_RDTSCP) {
+        unsigned int aux;
+        __builtin_ia32_rdtscp(&aux);
+        return (int)aux;
+    }
+    return clock->nr_cpus == 1 ? 0 : -ENOSYS;
+}
+
+/**
+ * ID of the calling task, as SYS_GETPID returns it
+ *
+ * The CPU ID is read again after the slot's sequence: a task still on
+ * that CPU with an unchanged sequence cannot have been switched out in
+ * between, so the slot names it.
+ *
+ * @return Task ID, or -ENOSYS if the page cannot tell
+ */
+static inline int vdso_task_id(void) {
+    const struct vdso_data* data = vdso_data();
+
+    for (;;) {
+        int cpu = vdso_cpu_id();
+        if (cpu < 0 || cpu >= VDSO_MAX_CPUS) {
+            return -ENOSYS;
+        }
+
+        const struct vdso_cpu* slot = &data->cpu[cpu];
+        uint32_t seq = slot->seq;
+        rmb();
+        if (vdso_cpu_id() != cpu) {
+            continue;  // Migrated
+        }
+        uint32_t task_id = slot->task_id;
+        rmb();
+        if (!(seq & 1) && seq == slot->seq) {
+            return (int)task_id;
+        }
+    }
+}
+
+#endif // USER_VDSO_H
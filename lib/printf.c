@@ -0,0 +1,347 @@
+// Bounded string formatting (see include/lib/printf.h)
+
+#include <lib/printf.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+static void sink_putc(struct kfmt_sink* sink, char c) {
+    if (sink->len == sink->size) {
+        if (!sink->flush) {
+            return;
+        }
+        sink->flush(sink);
+    }
+    sink->buf[sink->len++] = c;
+}
+
+static void sink_write(struct kfmt_sink* sink, const char* str, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        sink_putc(sink, str[i]);
+    }
+}
+
+// Helper: convert 32-bit integer to string
+static int itoa(int32_t value, char* buf, int base) {
+    char* ptr = buf;
+    char* ptr1 = buf;
+    char tmp_char;
+    int32_t tmp_value;
+
+    if (base < 2 || base > 36) {
+        *buf = '\0';
+        return 0;
+    }
+
+    do {
+        tmp_value = value;
+        value /= base;
+        *ptr++ = "zyxwvutsrqponmlkjihgfedcba9876543210123456789abcdefghijklmnopqrstuvwxyz"[35 + (tmp_value - value * base)];
+    } while (value);
+
+    // Handle negative numbers
+    if (tmp_value < 0 && base == 10) {
+        *ptr++ = '-';
+    }
+
+    // Save length before null terminator
+    int len = ptr - buf;
+    *ptr-- = '\0';
+
+    // Reverse string
+    while (ptr1 < ptr) {
+        tmp_char = *ptr;
+        *ptr-- = *ptr1;
+        *ptr1++ = tmp_char;
+    }
+
+    return len;
+}
+
+// Helper: convert 32-bit unsigned integer to string
+static int utoa(uint32_t value, char* buf, int base) {
+    char* ptr = buf;
+    char* ptr1 = buf;
+    char tmp_char;
+    uint32_t tmp_value;
+
+    if (base < 2 || base > 36) {
+        *buf = '\0';
+        return 0;
+    }
+
+    do {
+        tmp_value = value;
+        value /= base;
+        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"[tmp_value - value * base];
+    } while (value);
+
+    // Save length before null terminator
+    int len = ptr - buf;
+    *ptr-- = '\0';
+
+    // Reverse string
+    while (ptr1 < ptr) {
+        tmp_char = *ptr;
+        *ptr-- = *ptr1;
+        *ptr1++ = tmp_char;
+    }
+
+    return len;
+}
+
+// Helper: convert 64-bit unsigned integer to string
+static int utoa64(uint64_t value, char* buf, int base) {
+    char* ptr = buf;
+    char* ptr1 = buf;
+    char tmp_char;
+    uint64_t tmp_value;
+
+    if (base < 2 || base > 36) {
+        *buf = '\0';
+        return 0;
+    }
+
+    if (value == 0) {
+        *ptr++ = '0';
+        *ptr = '\0';
+        return 1;
+    }
+
+    do {
+        tmp_value = value;
+        value /= base;
+        *ptr++ = "0123456789abcdefghijklmnopqrstuvwxyz"
+                 [tmp_value - value * base];
+    } while (value);
+
+    // Save length before null terminator
+    int len = ptr - buf;
+    *ptr-- = '\0';
+
+    // Reverse string
+    while (ptr1 < ptr) {
+        tmp_char = *ptr;
+        *ptr-- = *ptr1;
+        *ptr1++ = tmp_char;
+    }
+
+    return len;
+}
+
+// Helper: convert 64-bit signed integer to string
+static int itoa64(int64_t value, char* buf, int base) {
+    if (value < 0) {
+        int len = utoa64((uint64_t)(-value), buf + 1, base);
+        buf[0] = '-';
+        buf[len + 1] = '\0';
+        return len + 1;
+    }
+    return utoa64((uint64_t)value, buf, base);
+}
+
+int kvformat(struct kfmt_sink* sink, const char* format, va_list args) {
+    int written = 0;
+    char buf[32];
+
+    while (*format) {
+        if (*format == '%') {
+            format++;
+            if (*format == '\0') {
+                // Trailing '%': print it, don't run past the terminator
+                sink_putc(sink, '%');
+                written++;
+                break;
+            }
+
+            // Parse flags and width
+            bool zero_pad = false;
+            int width = 0;
+
+            // Check for '0' flag (zero padding)
+            if (*format == '0') {
+                zero_pad = true;
+                format++;
+            }
+
+            // Parse width (e.g., "8" in "%08x")
+            while (*format >= '0' && *format <= '9') {
+                width = width * 10 + (*format - '0');
+                format++;
+            }
+
+            // Optional length modifier: 'l' or 'll'
+            // On this 32-bit kernel, long is 32-bit and long long is 64-bit.
+            bool long_mod = false;
+            bool long_long_mod = false;
+            if (*format == 'l') {
+                if (*(format + 1) == 'l') {
+                    long_long_mod = true;
+                    format += 2;
+                } else {
+                    long_mod = true;
+                    format++;
+                }
+            }
+
+            switch (*format) {
+                case 'd':  // Signed decimal
+                case 'i': {
+                    int len = 0;
+                    if (long_long_mod) {
+                        long long v = va_arg(args, long long);
+                        len = itoa64((int64_t)v, buf, 10);
+                    } else if (long_mod) {
+                        long v = va_arg(args, long);
+                        int32_t val = (int32_t)v;
+                        len = itoa(val, buf, 10);
+                    } else {
+                        int v = va_arg(args, int);
+                        int32_t val = (int32_t)v;
+                        len = itoa(val, buf, 10);
+                    }
+                    // Apply padding if specified
+                    if (zero_pad && width > len) {
+                        for (int i = len; i < width; i++) {
+                            sink_putc(sink, '0');
+                            written++;
+                        }
+                    }
+                    sink_write(sink, buf, len);
+                    written += len;
+                    break;
+                }
+
+                case 'u': {  // Unsigned decimal
+                    int len = 0;
+                    if (long_long_mod) {
+                        unsigned long long v = va_arg(args, unsigned long long);
+                        len = utoa64((uint64_t)v, buf, 10);
+                    } else if (long_mod) {
+                        unsigned long v = va_arg(args, unsigned long);
+                        uint32_t val = (uint32_t)v;
+                        len = utoa(val, buf, 10);
+                    } else {
+                        unsigned int v = va_arg(args, unsigned int);
+                        uint32_t val = (uint32_t)v;
+                        len = utoa(val, buf, 10);
+                    }
+                    // Apply padding if specified
+                    if (zero_pad && width > len) {
+                        for (int i = len; i < width; i++) {
+                            sink_putc(sink, '0');
+                            written++;
+                        }
+                    }
+                    sink_write(sink, buf, len);
+                    written += len;
+                    break;
+                }
+
+                case 'x':  // Hexadecimal (lowercase)
+                case 'X': {  // Hexadecimal (uppercase)
+                    int len = 0;
+                    if (long_long_mod) {
+                        unsigned long long v = va_arg(args, unsigned long long);
+                        len = utoa64((uint64_t)v, buf, 16);
+                    } else if (long_mod) {
+                        unsigned long v = va_arg(args, unsigned long);
+                        uint32_t val = (uint32_t)v;
+                        len = utoa(val, buf, 16);
+                    } else {
+                        unsigned int v = va_arg(args, unsigned int);
+                        uint32_t val = (uint32_t)v;
+                        len = utoa(val, buf, 16);
+                    }
+                    // Apply padding if specified
+                    if (zero_pad && width > len) {
+                        for (int i = len; i < width; i++) {
+                            sink_putc(sink, '0');
+                            written++;
+                        }
+                    }
+                    sink_write(sink, buf, len);
+                    written += len;
+                    break;
+                }
+
+                case 'p': {  // Pointer
+                    sink_write(sink, "0x", 2);
+                    uintptr_t ptr = (uintptr_t)va_arg(args, void*);
+                    uint32_t val = (uint32_t)ptr;
+                    int len = utoa(val, buf, 16);
+                    // Pad to 8 digits
+                    for (int i = len; i < 8; i++) {
+                        sink_putc(sink, '0');
+                        written++;
+                    }
+                    sink_write(sink, buf, len);
+                    written += len + 2;
+                    break;
+                }
+
+                case 's': {  // String
+                    const char* str = va_arg(args, const char*);
+                    if (!str) {
+                        str = "(null)";
+                    }
+                    size_t len = 0;
+                    while (str[len]) len++;
+                    sink_write(sink, str, len);
+                    written += len;
+                    break;
+                }
+
+                case 'c': {  // Character
+                    char c = (char)va_arg(args, int);
+                    sink_putc(sink, c);
+                    written++;
+                    break;
+                }
+
+                case '%': {  // Literal %
+                    sink_putc(sink, '%');
+                    written++;
+                    break;
+                }
+
+                default:
+                    // Unknown format, print as-is
+                    sink_putc(sink, '%');
+                    sink_putc(sink, *format);
+                    written += 2;
+                    break;
+            }
+
+            format++;
+        } else {
+            sink_putc(sink, *format);
+            written++;
+            format++;
+        }
+    }
+
+    return written;
+}
+
+int kvsnprintf(char* buf, size_t size, const char* format, va_list args) {
+    struct kfmt_sink sink = {
+        .buf = buf,
+        .size = size ? size - 1 : 0,
+        .len = 0,
+        .flush = NULL,
+        .ctx = NULL,
+    };
+    int written = kvformat(&sink, format, args);
+    if (size) {
+        buf[sink.len] = '\0';
+    }
+    return written;
+}
+
+int ksnprintf(char* buf, size_t size, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = kvsnprintf(buf, size, format, args);
+    va_end(args);
+    return written;
+}
@@ -1,16 +1,51 @@
 // Safe String Library for Kernel
 // NO unsafe functions like strcpy, strcat, sprintf!
+//
+// strlen, strcmp, strncmp and memcmp look at four bytes per step once
+// their pointers are word-aligned. An aligned word never straddles a
+// page, so they read nothing from a page the string does not reach
+// into; bytes after the terminator in the same word are read but never
+// affect the result. Pointers with different alignments take the byte
+// loops.
 
 #include <stddef.h>
 #include <stdint.h>
 
+typedef uint32_t __attribute__((may_alias)) str_word_t;
+
+#define WORD_SIZE   sizeof(str_word_t)
+#define WORD_ONES   0x01010101u
+#define WORD_HIGHS  0x80808080u
+
+// Non-zero iff some byte of w is zero
+static inline uint32_t word_has_zero(uint32_t w) {
+    return (w - WORD_ONES) & ~w & WORD_HIGHS;
+}
+
+static inline int word_aligned(const void* p) {
+    return ((uintptr_t)p & (WORD_SIZE - 1)) == 0;
+}
+
+static inline int same_alignment(const void* a, const void* b) {
+    return (((uintptr_t)a ^ (uintptr_t)b) & (WORD_SIZE - 1)) == 0;
+}
+
 // Get string length
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (str[len]) {
-        len++;
+    const char* p = str;
+    for (; !word_aligned(p); p++) {
+        if (!*p) {
+            return (size_t)(p - str);
+        }
+    }
+
+    const str_word_t* w = (const str_word_t*)p;
+    while (!word_has_zero(*w)) {
+        w++;
+    }
+    for (p = (const char*)w; *p; p++) {
     }
-    return len;
+    return (size_t)(p - str);
 }
 
 // Safe string copy (always null-terminates)
@@ -53,6 +88,23 @@ size_t strlcat(char* dst, const char* src, size_t size) {
 
 // Compare strings
 int strcmp(const char* s1, const char* s2) {
+    if (same_alignment(s1, s2)) {
+        for (; !word_aligned(s1); s1++, s2++) {
+            if (!*s1 || *s1 != *s2) {
+                return *(unsigned char*)s1 - *(unsigned char*)s2;
+            }
+        }
+        // Skip equal words with no terminator; the byte loop settles the rest
+        const str_word_t* w1 = (const str_word_t*)s1;
+        const str_word_t* w2 = (const str_word_t*)s2;
+        while (*w1 == *w2 && !word_has_zero(*w1)) {
+            w1++;
+            w2++;
+        }
+        s1 = (const char*)w1;
+        s2 = (const char*)w2;
+    }
+
     while (*s1 && (*s1 == *s2)) {
         s1++;
         s2++;
@@ -62,6 +114,23 @@ int strcmp(const char* s1, const char* s2) {
 
 // Compare strings (up to n characters)
 int strncmp(const char* s1, const char* s2, size_t n) {
+    if (same_alignment(s1, s2)) {
+        for (; n && !word_aligned(s1); s1++, s2++, n--) {
+            if (!*s1 || *s1 != *s2) {
+                return *(unsigned char*)s1 - *(unsigned char*)s2;
+            }
+        }
+        const str_word_t* w1 = (const str_word_t*)s1;
+        const str_word_t* w2 = (const str_word_t*)s2;
+        while (n >= WORD_SIZE && *w1 == *w2 && !word_has_zero(*w1)) {
+            w1++;
+            w2++;
+            n -= WORD_SIZE;
+        }
+        s1 = (const char*)w1;
+        s2 = (const char*)w2;
+    }
+
     while (n && *s1 && (*s1 == *s2)) {
         s1++;
         s2++;
@@ -75,52 +144,31 @@ int strncmp(const char* s1, const char* s2, size_t n) {
     return *(unsigned char*)s1 - *(unsigned char*)s2;
 }
 
-// Memory copy
-void* memcpy(void* dest, const void* src, size_t n) {
-    uint8_t* d = (uint8_t*)dest;
-    const uint8_t* s = (const uint8_t*)src;
-
-    for (size_t i = 0; i < n; i++) {
-        d[i] = s[i];
-    }
-
-    return dest;
-}
-
-// Memory move (handles overlapping regions)
-void* memmove(void* dest, const void* src, size_t n) {
-    uint8_t* d = (uint8_t*)dest;
-    const uint8_t* s = (const uint8_t*)src;
-
-    if (d < s) {
-        // Copy forward
-        for (size_t i = 0; i < n; i++) {
-            d[i] = s[i];
-        }
-    } else {
-        // Copy backward
-        for (size_t i = n; i > 0; i--) {
-            d[i - 1] = s[i - 1];
-        }
-    }
-
-    return dest;
-}
-
-// Memory set
-void* memset(void* ptr, int value, size_t n) {
-    uint8_t* p = (uint8_t*)ptr;
-    for (size_t i = 0; i < n; i++) {
-        p[i] = (uint8_t)value;
-    }
-    return ptr;
-}
+// memcpy, memmove and memset are per architecture (arch/x86/string.c)
 
 // Memory compare
 int memcmp(const void* s1, const void* s2, size_t n) {
     const uint8_t* p1 = (const uint8_t*)s1;
     const uint8_t* p2 = (const uint8_t*)s2;
 
+    if (same_alignment(p1, p2)) {
+        for (; n && !word_aligned(p1); p1++, p2++, n--) {
+            if (*p1 != *p2) {
+                return *p1 - *p2;
+            }
+        }
+        // The first differing word is settled byte by byte below
+        const str_word_t* w1 = (const str_word_t*)p1;
+        const str_word_t* w2 = (const str_word_t*)p2;
+        while (n >= WORD_SIZE && *w1 == *w2) {
+            w1++;
+            w2++;
+            n -= WORD_SIZE;
+        }
+        p1 = (const uint8_t*)w1;
+        p2 = (const uint8_t*)w2;
+    }
+
     for (size_t i = 0; i < n; i++) {
         if (p1[i] != p2[i]) {
             return p1[i] - p2[i];
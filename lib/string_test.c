@@ -13,6 +13,14 @@ extern size_t strlcat(char *dst, const char *src, size_t size);
 extern size_t strlen(const char *s);
 extern void *memset(void *s, int c, size_t n);
 extern void *memcpy(void *dest, const void *src, size_t n);
+extern void *memmove(void *dest, const void *src, size_t n);
+extern int memcmp(const void *s1, const void *s2, size_t n);
+extern int strcmp(const char *s1, const char *s2);
+extern int strncmp(const char *s1, const char *s2, size_t n);
+extern void memzero_page(void *page);
+extern void memcpy_page(void *dst, const void *src);
+extern void memzero_page_nt(void *page);
+extern void memcpy_page_nt(void *dst, const void *src);
 
 // Test: strlen basic functionality
 static int test_strlen_basic(void) {
@@ -110,6 +118,119 @@ static int test_memcpy_basic(void) {
 }
 
 // Register all tests
+static uint8_t mem_src[96];
+static uint8_t mem_dst[96];
+static uint8_t mem_pages[2][4096] __attribute__((aligned(4096)));
+
+static void mem_pattern(uint8_t* buf, size_t len, uint8_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+// Test: memcpy/memset at every alignment and length around the
+// small/aligned split, without touching neighbouring bytes
+static int test_memcpy_alignment(void) {
+    mem_pattern(mem_src, sizeof(mem_src), 1);
+    for (size_t off = 0; off < 4; off++) {
+        for (size_t len = 0; len <= 40; len++) {
+            for (size_t i = 0; i < sizeof(mem_dst); i++) {
+                mem_dst[i] = 0xEE;
+            }
+            memcpy(mem_dst + off, mem_src + 3, len);
+            for (size_t i = 0; i < sizeof(mem_dst); i++) {
+                uint8_t want = (i >= off && i < off + len) ? mem_src[3 + i - off] : 0xEE;
+                KTEST_ASSERT_EQ(mem_dst[i], want, "memcpy bytes in range only");
+            }
+
+            memset(mem_dst, 0xEE, sizeof(mem_dst));
+            memset(mem_dst + off, 0x5A, len);
+            for (size_t i = 0; i < sizeof(mem_dst); i++) {
+                uint8_t want = (i >= off && i < off + len) ? 0x5A : 0xEE;
+                KTEST_ASSERT_EQ(mem_dst[i], want, "memset bytes in range only");
+            }
+        }
+    }
+    return KTEST_PASS;
+}
+
+// Test: memmove copies overlapping ranges in either direction
+static int test_memmove_overlap(void) {
+    uint8_t expect[sizeof(mem_dst)];
+    for (size_t shift = 1; shift < 9; shift++) {
+        for (size_t len = 1; len <= 40; len += 3) {
+            // dest above src: must copy top-down
+            mem_pattern(mem_dst, sizeof(mem_dst), 9);
+            mem_pattern(expect, sizeof(expect), 9);
+            for (size_t i = len; i > 0; i--) {
+                expect[10 + shift + i - 1] = expect[10 + i - 1];
+            }
+            memmove(mem_dst + 10 + shift, mem_dst + 10, len);
+            KTEST_ASSERT_EQ(memcmp(mem_dst, expect, sizeof(expect)), 0, "memmove up");
+
+            // dest below src
+            mem_pattern(mem_dst, sizeof(mem_dst), 9);
+            mem_pattern(expect, sizeof(expect), 9);
+            for (size_t i = 0; i < len; i++) {
+                expect[10 + i] = expect[10 + shift + i];
+            }
+            memmove(mem_dst + 10, mem_dst + 10 + shift, len);
+            KTEST_ASSERT_EQ(memcmp(mem_dst, expect, sizeof(expect)), 0, "memmove down");
+        }
+    }
+    return KTEST_PASS;
+}
+
+// Test: page zero/copy, cached and non-temporal, cover exactly one page
+static int test_memzero_page(void) {
+    mem_pattern(mem_pages[0], 4096, 3);
+    memcpy_page(mem_pages[1], mem_pages[0]);
+    KTEST_ASSERT_EQ(memcmp(mem_pages[1], mem_pages[0], 4096), 0, "memcpy_page");
+
+    memzero_page(mem_pages[1]);
+    for (size_t i = 0; i < 4096; i++) {
+        KTEST_ASSERT_EQ(mem_pages[1][i], 0, "memzero_page");
+    }
+
+    memcpy_page_nt(mem_pages[1], mem_pages[0]);
+    KTEST_ASSERT_EQ(memcmp(mem_pages[1], mem_pages[0], 4096), 0, "memcpy_page_nt");
+
+    memzero_page_nt(mem_pages[0]);
+    for (size_t i = 0; i < 4096; i++) {
+        KTEST_ASSERT_EQ(mem_pages[0][i], 0, "memzero_page_nt");
+    }
+    KTEST_ASSERT_EQ(mem_pages[1][0], 3, "neighbouring page untouched");
+    return KTEST_PASS;
+}
+
+// Test: comparisons are decided by the first differing byte, whether it
+// falls in the unaligned head, an aligned word or the tail
+static int test_strcmp_word(void) {
+    static char a[40] __attribute__((aligned(4)));
+    static char b[40] __attribute__((aligned(4)));
+    for (size_t off = 0; off < 4; off++) {
+        for (size_t at = 0; at < 20; at++) {
+            for (size_t i = 0; i < 24; i++) {
+                a[off + i] = b[off + i] = (char)('a' + i);
+            }
+            a[off + 24] = b[off + 24] = '\0';
+            b[off + at] = (char)0xF0;
+
+            KTEST_ASSERT_EQ(strlen(a + off), 24, "strlen");
+            KTEST_ASSERT(strcmp(a + off, b + off) < 0, "strcmp sees the difference");
+            KTEST_ASSERT(strcmp(b + off, a + off) > 0, "strcmp is unsigned");
+            KTEST_ASSERT(strncmp(a + off, b + off, at) == 0, "strncmp stops before it");
+            KTEST_ASSERT(strncmp(a + off, b + off, at + 1) < 0, "strncmp includes it");
+            KTEST_ASSERT(memcmp(a + off, b + off, at) == 0, "memcmp stops before it");
+            KTEST_ASSERT(memcmp(a + off, b + off, 24) < 0, "memcmp sees it");
+            KTEST_ASSERT(strcmp(a + off, a + off) == 0, "equal");
+        }
+    }
+    KTEST_ASSERT(strcmp("abc", "abcd") < 0, "prefix sorts first");
+    KTEST_ASSERT(strcmp(a + 1, a + 2) != 0, "mixed alignment");
+    return KTEST_PASS;
+}
+
 KTEST_DEFINE("string", strlen_basic, test_strlen_basic);
 KTEST_DEFINE("string", strlcpy_basic, test_strlcpy_basic);
 KTEST_DEFINE("string", strlcpy_truncate, test_strlcpy_truncate);
@@ -117,3 +238,7 @@ KTEST_DEFINE("string", strlcat_basic, test_strlcat_basic);
 KTEST_DEFINE("string", strlcat_truncate, test_strlcat_truncate);
 KTEST_DEFINE("string", memset_basic, test_memset_basic);
 KTEST_DEFINE("string", memcpy_basic, test_memcpy_basic);
+KTEST_DEFINE("string", memcpy_alignment, test_memcpy_alignment);
+KTEST_DEFINE("string", memmove_overlap, test_memmove_overlap);
+KTEST_DEFINE("string", memzero_page, test_memzero_page);
+KTEST_DEFINE("string", strcmp_word, test_strcmp_word);
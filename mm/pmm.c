@@ -40,16 +40,56 @@
     // Include kernel headers for types only
     #include "../include/kernel/pmm.h"
     #include "../include/kernel/types.h"
+    #include "../include/kernel/config.h"
+    #include "../include/kernel/smp.h"
+
+    // Mock per-CPU state: a single CPU with interrupts always "off"
+    static struct pmm_magazine host_magazine;
+    #define pmm_local_magazine() (&host_magazine)
+    #define pmm_irq_save() 0u
+    #define pmm_irq_restore(state) ((void)(state))
+    #define pmm_spin_lock() ((void)0)
+    #define pmm_spin_unlock() ((void)0)
+
+    // Frames are plain numbers on the host, there is no memory to zero
+    #define pmm_zero_frame(addr) ((void)(addr))
+    #define pmm_zero_frame_nt(addr) ((void)(addr))
+
+    // ...nor to hold the descriptor array (see host_page_array below)
+    #define pmm_map_page_array(addr, bytes) ((void)(addr), (void)(bytes), host_page_array)
 #else
     // Real kernel includes
     #include <kernel/pmm.h>
     #include <kernel/types.h>
     #include <kernel/hal.h>
+    #include <kernel/spinlock.h>
     #include <kernel/assert.h>
+    #include <kernel/percpu.h>
+    #include <kernel/config.h>
+    #include <kernel/smp.h>
     #include <drivers/vga.h>
     #include <stdint.h>
     #include <stddef.h>
     #include <stdbool.h>
+
+    // Magazines are CPU-local: their fast paths only disable interrupts.
+    // The bitmap, the shared free count, the zero pool and the refcounts
+    // of shared frames are touched by every CPU and also need pmm_lock
+    // (first in the lock order, KERNEL_C_STYLE.md 4.3).
+    #define pmm_local_magazine() (&this_cpu()->page_cache)
+    #define pmm_irq_save() hal->irq_disable()
+    #define pmm_irq_restore(state) hal->irq_restore(state)
+
+    static spinlock_t pmm_lock;
+    #define pmm_spin_lock() spin_lock(&pmm_lock)
+    #define pmm_spin_unlock() spin_unlock(&pmm_lock)
+
+    // Frames are reached through the identity map (phys == virt)
+    #include <lib/string.h>
+    #define pmm_zero_frame(addr) memzero_page((void*)(uintptr_t)(addr))
+    // Pool frames sit unused for a while: keep them out of the cache
+    #define pmm_zero_frame_nt(addr) memzero_page_nt((void*)(uintptr_t)(addr))
+    #define pmm_map_page_array(addr, bytes) ((struct page *)(uintptr_t)(addr))
 #endif
 
 // Frame size (4KB pages)
@@ -59,32 +99,104 @@
 #define MAX_MEMORY (4ULL * 1024 * 1024 * 1024)
 #define MAX_FRAMES (MAX_MEMORY / FRAME_SIZE)
 
-// Bitmap size (1 bit per frame)
-#define BITMAP_SIZE (MAX_FRAMES / 8)
+#ifdef HOST_TEST
+static struct page host_page_array[MAX_FRAMES];
+#endif
+
+// Interrupts off and pmm_lock held: the shared state may be touched
+static inline uint32_t pmm_lock_irqsave(void) {
+    uint32_t state = pmm_irq_save();
+    pmm_spin_lock();
+    return state;
+}
+
+static inline void pmm_unlock_irqrestore(uint32_t state) {
+    pmm_spin_unlock();
+    pmm_irq_restore(state);
+}
+
+// Bitmap size (1 bit per frame, 32 frames per word)
+#define BITMAP_WORDS (MAX_FRAMES / 32)
 
-// Free list size per CPU (number of pre-allocated frames)
-#define FREE_LIST_SIZE 64
+// Summary levels of the free-frame index (1 bit per word of the level below)
+#define SUMMARY_WORDS (BITMAP_WORDS / 32)
+#define TOP_WORDS     (SUMMARY_WORDS / 32)
 
 // PMM state
 static struct {
-    uint8_t *bitmap;           // Frame allocation bitmap
+    uint32_t *bitmap;          // Frame allocation bitmap
     phys_addr_t bitmap_start;  // Physical address of bitmap
     size_t total_frames;       // Total number of frames
-    size_t free_frames;        // Number of free frames
+    size_t free_frames;        // Free frames in the bitmap and zero pool
+                               // (the magazines hold the rest)
     size_t reserved_frames;    // Number of reserved frames
+    size_t cursor;             // Next-fit search start (bitmap word index)
+    size_t max_frame;          // One past the highest usable frame
+    struct page *pages;        // Frame descriptors [0, max_frame), or NULL
+    phys_addr_t metadata_end;  // End of kernel image + descriptor array
     bool initialized;          // PMM initialized flag
 } pmm_state;
 
+// Pre-zeroed frames, filled by the idle thread (see pmm_zero_pool_refill)
+static struct {
+    uint32_t count;
+    phys_addr_t frames[PMM_ZERO_POOL_SIZE];
+} zero_pool;
+
 // Static bitmap storage (placed in .bss)
-static uint8_t frame_bitmap[BITMAP_SIZE];
+static uint32_t frame_bitmap[BITMAP_WORDS];
+
+/**
+ * Free-frame index
+ *
+ * Bit w of free_summary is set when frame_bitmap[w] has at least one
+ * free frame; bit s of free_top is set when free_summary[s] != 0.
+ * A search reads at most TOP_WORDS + 2 words instead of the whole bitmap.
+ */
+static uint32_t free_summary[SUMMARY_WORDS];
+static uint32_t free_top[TOP_WORDS];
+
+/**
+ * Contiguous-block index
+ *
+ * Bit w of empty_summary is set when all 32 frames of frame_bitmap[w] are
+ * free. Blocks of order >= 5 are runs of aligned empty words, so a whole
+ * PMM_MAX_ORDER block is one all-ones empty_summary word.
+ */
+#define WORD_ORDER 5    // log2(frames per bitmap word)
+static uint32_t empty_summary[SUMMARY_WORDS];
 
 /**
  * Test if a bit is set in the bitmap
  */
 static inline bool bitmap_test(size_t frame) {
-    size_t byte = frame / 8;
-    size_t bit = frame % 8;
-    return (frame_bitmap[byte] & (1 << bit)) != 0;
+    return (frame_bitmap[frame / 32] & (1u << (frame % 32))) != 0;
+}
+
+/**
+ * Recompute the summary bits covering bitmap word `word`
+ */
+static inline void summary_update(size_t word) {
+    size_t s = word / 32;
+    uint32_t bit = 1u << (word % 32);
+
+    if (frame_bitmap[word] != 0xFFFFFFFFu) {
+        free_summary[s] |= bit;
+    } else {
+        free_summary[s] &= ~bit;
+    }
+
+    if (frame_bitmap[word] == 0) {
+        empty_summary[s] |= bit;
+    } else {
+        empty_summary[s] &= ~bit;
+    }
+
+    if (free_summary[s] != 0) {
+        free_top[s / 32] |= 1u << (s % 32);
+    } else {
+        free_top[s / 32] &= ~(1u << (s % 32));
+    }
 }
 
 /**
@@ -94,9 +206,12 @@ static inline void bitmap_set(size_t frame) {
     PRECONDITION("frame must be within valid range");
     kassert(frame < MAX_FRAMES);
 
-    size_t byte = frame / 8;
-    size_t bit = frame % 8;
-    frame_bitmap[byte] |= (1 << bit);
+    size_t word = frame / 32;
+    bool was_empty = frame_bitmap[word] == 0;
+    frame_bitmap[word] |= 1u << (frame % 32);
+    if (was_empty || frame_bitmap[word] == 0xFFFFFFFFu) {
+        summary_update(word);
+    }
 
     POSTCONDITION("bit should be set");
     kassert(bitmap_test(frame));
@@ -109,31 +224,332 @@ static inline void bitmap_clear(size_t frame) {
     PRECONDITION("frame must be within valid range");
     kassert(frame < MAX_FRAMES);
 
-    size_t byte = frame / 8;
-    size_t bit = frame % 8;
-    frame_bitmap[byte] &= ~(1 << bit);
+    size_t word = frame / 32;
+    bool was_full = frame_bitmap[word] == 0xFFFFFFFFu;
+    frame_bitmap[word] &= ~(1u << (frame % 32));
+    if (was_full || frame_bitmap[word] == 0) {
+        summary_update(word);
+    }
+
+    // Keep allocations packed into low memory (see bitmap_find_free_word)
+    if (word < pmm_state.cursor) {
+        pmm_state.cursor = word;
+    }
 
     POSTCONDITION("bit should be cleared");
     kassert(!bitmap_test(frame));
 }
 
 /**
- * Find the first free frame in the bitmap
+ * Mark every frame allocated and empty the free-frame index
+ */
+static void bitmap_reset(void) {
+    for (size_t i = 0; i < BITMAP_WORDS; i++) {
+        frame_bitmap[i] = 0xFFFFFFFFu;
+    }
+    for (size_t i = 0; i < SUMMARY_WORDS; i++) {
+        free_summary[i] = 0;
+        empty_summary[i] = 0;
+    }
+    for (size_t i = 0; i < TOP_WORDS; i++) {
+        free_top[i] = 0;
+    }
+    pmm_state.cursor = 0;
+}
+
+/**
+ * Count set bits in a word (SWAR; avoids a libgcc call on i686)
+ */
+static inline uint32_t popcount32(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (x * 0x01010101u) >> 24;
+}
+
+/**
+ * Mask of bits [lo, hi) within one bitmap word (0 <= lo < hi <= 32)
+ */
+static inline uint32_t word_range_mask(uint32_t lo, uint32_t hi) {
+    uint32_t upper = (hi >= 32) ? 0xFFFFFFFFu : ((1u << hi) - 1);
+    return upper & (0xFFFFFFFFu << lo);
+}
+
+/**
+ * Set or clear `count` frames starting at `start`, a word at a time
  *
- * Returns frame number, or MAX_FRAMES if none found.
+ * Partial head and tail words are masked; whole words in between are
+ * filled directly. The free-frame index is refreshed once per word.
  *
- * Note: This is O(n) but only used during initialization
- * and as fallback. Normal allocation uses free lists.
- */
-static size_t bitmap_find_free(void) {
-    // Scan bitmap for first free frame
-    for (size_t i = 0; i < BITMAP_SIZE; i++) {
-        if (frame_bitmap[i] != 0xFF) {
-            // Found a byte with free bits
-            for (size_t bit = 0; bit < 8; bit++) {
-                if ((frame_bitmap[i] & (1 << bit)) == 0) {
-                    return i * 8 + bit;
+ * Returns the number of frames whose state actually changed.
+ * O(count / 32).
+ */
+static size_t bitmap_update_range(size_t start, size_t count, bool set) {
+    if (start >= MAX_FRAMES) {
+        return 0;
+    }
+    size_t end = (count > MAX_FRAMES - start) ? MAX_FRAMES : start + count;
+    size_t changed = 0;
+
+    for (size_t frame = start; frame < end; ) {
+        size_t word = frame / 32;
+        uint32_t lo = (uint32_t)(frame % 32);
+        uint32_t hi = (end - word * 32 >= 32) ? 32 : (uint32_t)(end - word * 32);
+        uint32_t mask = word_range_mask(lo, hi);
+        uint32_t old = frame_bitmap[word];
+
+        if (set) {
+            changed += (size_t)popcount32(~old & mask);
+            frame_bitmap[word] = old | mask;
+        } else {
+            changed += (size_t)popcount32(old & mask);
+            frame_bitmap[word] = old & ~mask;
+        }
+
+        if (frame_bitmap[word] != old) {
+            summary_update(word);
+        }
+        frame = word * 32 + hi;
+    }
+
+    if (!set && start / 32 < pmm_state.cursor) {
+        pmm_state.cursor = start / 32;
+    }
+
+    return changed;
+}
+
+/**
+ * Mark a frame range allocated; returns how many were free before
+ */
+static inline size_t bitmap_set_range(size_t start, size_t count) {
+    return bitmap_update_range(start, count, true);
+}
+
+/**
+ * Mark a frame range free; returns how many were allocated before
+ */
+static inline size_t bitmap_clear_range(size_t start, size_t count) {
+    return bitmap_update_range(start, count, false);
+}
+
+/**
+ * Count allocated frames in a range without modifying it
+ */
+static size_t bitmap_count_set(size_t start, size_t count) {
+    size_t allocated = 0;
+    size_t end = start + count;
+
+    for (size_t frame = start; frame < end; ) {
+        size_t word = frame / 32;
+        uint32_t lo = (uint32_t)(frame % 32);
+        uint32_t hi = (end - word * 32 >= 32) ? 32 : (uint32_t)(end - word * 32);
+        allocated += (size_t)popcount32(frame_bitmap[word] & word_range_mask(lo, hi));
+        frame = word * 32 + hi;
+    }
+
+    return allocated;
+}
+
+/**
+ * Descriptor of frame `frame`, or NULL if it has none
+ */
+static inline struct page *frame_page(size_t frame) {
+    return (pmm_state.pages && frame < pmm_state.max_frame) ? &pmm_state.pages[frame] : NULL;
+}
+
+/**
+ * Record a fresh allocation of the block starting at `frame`
+ */
+static inline void page_mark_allocated(size_t frame, uint32_t order) {
+    struct page *page = frame_page(frame);
+    if (page) {
+        page->refcount = 1;
+        page->order = (uint8_t)order;
+        page->flags &= (uint8_t)~PAGE_FLAG_COW;
+        page->owner = 0;
+    }
+}
+
+static inline void page_mark_free(size_t frame) {
+    struct page *page = frame_page(frame);
+    if (page) {
+        page->refcount = 0;
+    }
+}
+
+/**
+ * Place the frame descriptor array at `base` (frame-aligned)
+ *
+ * The array must sit in usable memory, i.e. every frame it covers must
+ * still be free; it is then reserved like the kernel image. Without it
+ * the PMM still works, but frames cannot be shared.
+ */
+static void page_array_init(phys_addr_t base) {
+    size_t bytes = pmm_state.max_frame * sizeof(struct page);
+    size_t first = base / FRAME_SIZE;
+    size_t count = (bytes + FRAME_SIZE - 1) / FRAME_SIZE;
+
+    pmm_state.pages = NULL;
+    pmm_state.metadata_end = base;
+
+    if (count == 0 || first + count > pmm_state.max_frame ||
+        bitmap_count_set(first, count) != 0) {
+        kprintf("[PMM] WARNING: No room for frame descriptors after kernel\n");
+        return;
+    }
+
+    struct page *pages = pmm_map_page_array(base, bytes);
+    if (!pages) {
+        return;
+    }
+    memset(pages, 0, bytes);
+
+    pmm_state.pages = pages;
+    pmm_state.metadata_end = base + (phys_addr_t)count * FRAME_SIZE;
+    kprintf("[PMM] Frame descriptors: %u frames, %u KB at 0x%08x\n",
+            (unsigned int)pmm_state.max_frame, (unsigned int)(bytes / 1024),
+            (unsigned int)base);
+}
+
+/**
+ * Find the first bitmap word at or after `start` with a free frame
+ *
+ * Returns the word index, or BITMAP_WORDS if there is none.
+ * Bounded: at most TOP_WORDS + 2 word reads.
+ */
+static size_t bitmap_find_free_word_from(size_t start) {
+    size_t s = start / 32;
+    uint32_t bits = free_summary[s] & (0xFFFFFFFFu << (start % 32));
+    if (bits != 0) {
+        return s * 32 + (size_t)__builtin_ctz(bits);
+    }
+
+    // Next non-empty summary word after s
+    size_t t = s / 32;
+    uint32_t top = (s % 32 == 31) ? 0 : free_top[t] & (0xFFFFFFFFu << (s % 32 + 1));
+    while (top == 0) {
+        if (++t >= TOP_WORDS) {
+            return BITMAP_WORDS;
+        }
+        top = free_top[t];
+    }
+
+    s = t * 32 + (size_t)__builtin_ctz(top);
+    return s * 32 + (size_t)__builtin_ctz(free_summary[s]);
+}
+
+/**
+ * Find a bitmap word with a free frame, starting at the next-fit cursor
+ *
+ * The cursor skips exhausted memory below it; frees below the cursor pull
+ * it back down, so allocation still favours low frames, which the kernel
+ * reaches through the low identity map.
+ */
+static size_t bitmap_find_free_word(void) {
+    size_t word = bitmap_find_free_word_from(pmm_state.cursor);
+    if (word >= BITMAP_WORDS && pmm_state.cursor != 0) {
+        word = bitmap_find_free_word_from(0);
+    }
+    if (word < BITMAP_WORDS) {
+        pmm_state.cursor = word;
+    }
+    return word;
+}
+
+/**
+ * Move up to `count` free frames from the bitmap into `out`
+ *
+ * Marks every frame it takes as allocated. Returns the number of frames
+ * taken, which is less than `count` only when memory is exhausted.
+ */
+static uint32_t bitmap_take_batch(phys_addr_t *out, uint32_t count) {
+    uint32_t taken = 0;
+
+    while (taken < count) {
+        size_t word = bitmap_find_free_word();
+        if (word >= BITMAP_WORDS) {
+            break;
+        }
+
+        // Take free frames from this word, lowest first
+        uint32_t free_bits = ~frame_bitmap[word];
+        while (free_bits != 0 && taken < count) {
+            size_t frame = word * 32 + (size_t)__builtin_ctz(free_bits);
+            free_bits &= free_bits - 1;
+            bitmap_set(frame);
+            out[taken++] = (phys_addr_t)(frame * FRAME_SIZE);
+        }
+    }
+
+    return taken;
+}
+
+/**
+ * Mask of `n` low bits (n in 1..32)
+ */
+static inline uint32_t low_mask(uint32_t n) {
+    return (n >= 32) ? 0xFFFFFFFFu : ((1u << n) - 1);
+}
+
+/**
+ * Find an aligned group of `n` clear bits in `bits` (n a power of two <= 16)
+ *
+ * Returns the bit index of the group, or 32 if there is none.
+ */
+static inline uint32_t find_clear_group(uint32_t bits, uint32_t n) {
+    uint32_t mask = low_mask(n);
+    for (uint32_t pos = 0; pos < 32; pos += n) {
+        if (((bits >> pos) & mask) == 0) {
+            return pos;
+        }
+    }
+    return 32;
+}
+
+/**
+ * Find a free, naturally aligned block of 2^order frames
+ *
+ * Small blocks (order < WORD_ORDER) are carved from words that already
+ * have allocations when possible, which keeps empty words - and so large
+ * blocks - intact. Larger blocks are aligned runs of empty words.
+ *
+ * Returns the first frame of the block, or MAX_FRAMES if none exists.
+ * O(n) in the worst case; multi-page allocation is not an RT path.
+ */
+static size_t bitmap_find_block(uint32_t order) {
+    if (order < WORD_ORDER) {
+        uint32_t n = 1u << order;
+        size_t empty_word = BITMAP_WORDS;
+
+        for (size_t w = bitmap_find_free_word_from(0); w < BITMAP_WORDS;
+             w = (w + 1 < BITMAP_WORDS) ? bitmap_find_free_word_from(w + 1) : BITMAP_WORDS) {
+            if (frame_bitmap[w] == 0) {
+                if (empty_word == BITMAP_WORDS) {
+                    empty_word = w;
                 }
+                continue;
+            }
+            uint32_t pos = find_clear_group(frame_bitmap[w], n);
+            if (pos < 32) {
+                return w * 32 + pos;
+            }
+        }
+
+        return (empty_word < BITMAP_WORDS) ? empty_word * 32 : MAX_FRAMES;
+    }
+
+    // Aligned run of 2^(order - WORD_ORDER) empty words
+    uint32_t n = 1u << (order - WORD_ORDER);
+    uint32_t mask = low_mask(n);
+    for (size_t s = 0; s < SUMMARY_WORDS; s++) {
+        uint32_t empty = empty_summary[s];
+        if (empty == 0) {
+            continue;
+        }
+        for (uint32_t pos = 0; pos < 32; pos += n) {
+            if (((empty >> pos) & mask) == mask) {
+                return (s * 32 + pos) * 32;
             }
         }
     }
@@ -141,10 +557,112 @@ static size_t bitmap_find_free(void) {
     return MAX_FRAMES;
 }
 
+/**
+ * Check whether 2^order frames starting at `frame` are all free
+ */
+static bool bitmap_block_free(size_t frame, uint32_t order) {
+    if (order < WORD_ORDER) {
+        uint32_t mask = low_mask(1u << order);
+        return ((frame_bitmap[frame / 32] >> (frame % 32)) & mask) == 0;
+    }
+
+    size_t word = frame / 32;
+    uint32_t mask = low_mask(1u << (order - WORD_ORDER));
+    return ((empty_summary[word / 32] >> (word % 32)) & mask) == mask;
+}
+
+/**
+ * Return `count` frames from `frames` to the bitmap
+ */
+static void bitmap_return_batch(const phys_addr_t *frames, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        size_t frame = frames[i] / FRAME_SIZE;
+
+        INVARIANT("cached frame must be marked allocated in the bitmap");
+        kassert(bitmap_test(frame));
+        bitmap_clear(frame);
+    }
+}
+
+/**
+ * Refill an empty magazine from the bitmap
+ *
+ * With the bitmap exhausted the zero pool is the last local source.
+ * Interrupts disabled; takes pmm_lock.
+ */
+static void magazine_refill(struct pmm_magazine *mag) {
+    PRECONDITION("magazine must be empty");
+    kassert(mag->count == 0);
+
+    pmm_spin_lock();
+    uint32_t n = bitmap_take_batch(mag->frames, PMM_MAGAZINE_BATCH);
+    if (n == 0 && zero_pool.count > 0) {
+        mag->frames[n++] = zero_pool.frames[--zero_pool.count];
+    }
+
+    INVARIANT("frames taken must have been counted free");
+    kassert(pmm_state.free_frames >= n);
+    pmm_state.free_frames -= n;
+    pmm_spin_unlock();
+
+    // Put the lowest frame on top so it is handed out first
+    for (uint32_t i = 0; i < n / 2; i++) {
+        phys_addr_t tmp = mag->frames[i];
+        mag->frames[i] = mag->frames[n - 1 - i];
+        mag->frames[n - 1 - i] = tmp;
+    }
+    mag->count = n;
+}
+
+/**
+ * Drain the PMM_MAGAZINE_BATCH coldest frames of a full magazine
+ *
+ * The bottom of the stack holds the least recently freed frames; the
+ * hot top half stays cached. Interrupts disabled; takes pmm_lock.
+ */
+static void magazine_drain_batch(struct pmm_magazine *mag) {
+    PRECONDITION("magazine must be full");
+    kassert(mag->count == PMM_MAGAZINE_SIZE);
+
+    pmm_spin_lock();
+    bitmap_return_batch(mag->frames, PMM_MAGAZINE_BATCH);
+    pmm_state.free_frames += PMM_MAGAZINE_BATCH;
+    pmm_spin_unlock();
+
+    for (uint32_t i = PMM_MAGAZINE_BATCH; i < PMM_MAGAZINE_SIZE; i++) {
+        mag->frames[i - PMM_MAGAZINE_BATCH] = mag->frames[i];
+    }
+    mag->count = PMM_MAGAZINE_SIZE - PMM_MAGAZINE_BATCH;
+}
+
+/**
+ * Check whether a frame is sitting in the magazine (double-free detection)
+ *
+ * Cached frames look allocated in the bitmap, so only this scan catches a
+ * double free that hits the magazine. O(PMM_MAGAZINE_SIZE): paranoid
+ * builds only.
+ */
+static bool magazine_contains(const struct pmm_magazine *mag, phys_addr_t page) {
+#if CONFIG_ENABLE_PARANOID_CHECKS
+    for (uint32_t i = 0; i < mag->count; i++) {
+        if (mag->frames[i] == page) {
+            return true;
+        }
+    }
+#else
+    (void)mag;
+    (void)page;
+#endif
+    return false;
+}
+
 /**
  * Initialize the physical memory manager
  */
 void pmm_init(uint32_t multiboot_magic, struct multiboot_info *mbi) {
+    const struct multiboot_module *mods = NULL;
+    uint32_t mods_count = 0;
+
     kprintf("[PMM] Initializing physical memory manager...\n");
 
     // Verify multiboot magic
@@ -174,15 +692,21 @@ void pmm_init(uint32_t multiboot_magic, struct multiboot_info *mbi) {
 
     kprintf("[PMM] Initializing physical memory manager...\n");
 
-    // Initialize bitmap (mark all frames as allocated initially)
-    for (size_t i = 0; i < BITMAP_SIZE; i++) {
-        frame_bitmap[i] = 0xFF;
+    // Boot modules stay where the bootloader put them (kernel/bootmod.h)
+    if (mbi->flags & MULTIBOOT_FLAG_MODS) {
+        mods = (const struct multiboot_module *)(uintptr_t)mbi->mods_addr;
+        mods_count = mbi->mods_count;
     }
 
+    // Initialize bitmap (mark all frames as allocated initially)
+    bitmap_reset();
+
     pmm_state.bitmap = frame_bitmap;
     pmm_state.total_frames = 0;
     pmm_state.free_frames = 0;
     pmm_state.reserved_frames = 0;
+    pmm_state.max_frame = 0;
+    pmm_state.pages = NULL;
 
     // Parse multiboot memory map
     struct multiboot_mmap_entry *mmap = (struct multiboot_mmap_entry *)(uintptr_t)mbi->mmap_addr;
@@ -223,13 +747,14 @@ void pmm_init(uint32_t multiboot_magic, struct multiboot_info *mbi) {
             uint64_t frame_start = (region_start + FRAME_SIZE - 1) / FRAME_SIZE;
             uint64_t frame_end = region_end / FRAME_SIZE;
 
-            // Mark frames as free
-            for (uint64_t frame = frame_start; frame < frame_end; frame++) {
-                if (frame < MAX_FRAMES) {
-                    bitmap_clear((size_t)frame);
-                    pmm_state.total_frames++;
-                    pmm_state.free_frames++;
-                }
+            // Mark frames as free; overlapping entries are not counted twice
+            if (frame_start < MAX_FRAMES && frame_end > frame_start) {
+                size_t freed = bitmap_clear_range((size_t)frame_start,
+                                                  (size_t)(frame_end - frame_start));
+                pmm_state.total_frames += freed;
+                pmm_state.free_frames += freed;
+                pmm_state.max_frame = MAX(pmm_state.max_frame,
+                                          (size_t)MIN(frame_end, (uint64_t)MAX_FRAMES));
             }
         }
 
@@ -250,24 +775,27 @@ fallback_init:
     kprintf("\n");
 
     // Initialize bitmap (mark all frames as allocated initially)
-    for (size_t i = 0; i < BITMAP_SIZE; i++) {
-        frame_bitmap[i] = 0xFF;
-    }
+    bitmap_reset();
 
     pmm_state.bitmap = frame_bitmap;
     pmm_state.total_frames = 0;
     pmm_state.free_frames = 0;
     pmm_state.reserved_frames = 0;
+    pmm_state.max_frame = 0;
+    pmm_state.pages = NULL;
 
     // Mark first 128MB as available (128MB = 32768 frames)
     size_t fallback_frames = (128 * 1024 * 1024) / FRAME_SIZE;
-    for (size_t i = 0; i < fallback_frames && i < MAX_FRAMES; i++) {
-        bitmap_clear(i);
-        pmm_state.total_frames++;
-        pmm_state.free_frames++;
-    }
+    size_t freed = bitmap_clear_range(0, fallback_frames);
+    pmm_state.total_frames += freed;
+    pmm_state.free_frames += freed;
+    pmm_state.max_frame = fallback_frames;
 
 reserve_regions:
+    // Any frames cached by a previous init are meaningless now
+    pmm_local_magazine()->count = 0;
+    zero_pool.count = 0;
+
     kprintf("[PMM] Reserving critical regions...\n");
 
     // Get kernel bounds from linker
@@ -285,17 +813,37 @@ reserve_regions:
     kprintf("[PMM] Kernel at 0x%08x - 0x%08x\n",
             (unsigned int)kernel_start, (unsigned int)kernel_end);
 
+    // Frame descriptors go right after the kernel image and any boot
+    // modules loaded behind it
+    phys_addr_t image_end = kernel_end;
+    for (uint32_t i = 0; i < mods_count; i++) {
+        if (mods[i].mod_start >= kernel_start) {
+            image_end = MAX(image_end, (phys_addr_t)mods[i].mod_end);
+        }
+    }
+    page_array_init(ALIGN_UP(image_end, FRAME_SIZE));
+
     // Reserve only critical low-memory regions, not entire 1MB
     // This leaves more frames available for page tables
 
     // Reserve first page (NULL page) to catch null pointer dereferences
     pmm_reserve_region(0, FRAME_SIZE);
 
+    // Reserve the AP startup trampoline page (real-mode code, below 1MB)
+    pmm_reserve_region(SMP_TRAMPOLINE_ADDR, FRAME_SIZE);
+
     // Reserve VGA text buffer: 0xb8000 - 0xc0000 (32 KB)
     pmm_reserve_region(0xb8000, 32 * 1024);
 
-    // Reserve kernel image
-    pmm_reserve_region(kernel_start, kernel_end - kernel_start);
+    // Reserve kernel image and the descriptor array behind it
+    pmm_reserve_region(kernel_start, pmm_state.metadata_end - kernel_start);
+
+    // Boot modules are mapped straight into user address spaces
+    for (uint32_t i = 0; i < mods_count; i++) {
+        kprintf("[PMM] Module %u at 0x%08x - 0x%08x\n", (unsigned int)i,
+                (unsigned int)mods[i].mod_start, (unsigned int)mods[i].mod_end);
+        pmm_reserve_region(mods[i].mod_start, mods[i].mod_end - mods[i].mod_start);
+    }
 
     pmm_state.initialized = true;
 
@@ -319,13 +867,10 @@ bool pmm_is_initialized(void) {
 /**
  * Allocate a physical frame (4KB page)
  *
- * RT Constraint: O(1) operation, <100 cycles (with free list)
- *
- * **CURRENT IMPLEMENTATION: O(n) bitmap scan**
- * This is NOT RT-safe! Do not use in RT-critical paths.
- * Will be optimized with per-CPU free lists for O(1) allocation.
+ * RT Constraint: O(1) operation, <100 cycles (magazine hit)
  *
- * For now, use only during initialization or non-RT code paths.
+ * A miss refills the magazine with PMM_MAGAZINE_BATCH frames in one
+ * bitmap pass, so the scan cost is amortized over the whole batch.
  */
 phys_addr_t pmm_alloc_page(void) {
     // Runtime guard even in release builds to avoid silently returning
@@ -339,30 +884,27 @@ phys_addr_t pmm_alloc_page(void) {
     kassert(pmm_state.initialized);
     kassert_not_null(pmm_state.bitmap);
 
-    INVARIANT("free_frames count must be <= total_frames");
-    kassert(pmm_state.free_frames <= pmm_state.total_frames);
-
-    if (pmm_state.free_frames == 0) {
-        kprintf("[PMM] ERROR: Out of physical frames\n");
-        return 0;
+    // A hit touches only this CPU's magazine and the frame's descriptor
+    uint32_t irq_state = pmm_irq_save();
+
+    struct pmm_magazine *mag = pmm_local_magazine();
+    if (mag->count == 0) {
+        magazine_refill(mag);
+        if (mag->count == 0) {
+            // Any free frames left are cached on other CPUs
+            pmm_irq_restore(irq_state);
+            kprintf("[PMM] ERROR: Out of physical frames\n");
+            return 0;
+        }
     }
 
-    // Find first free frame
-    size_t frame = bitmap_find_free();
-    if (frame >= MAX_FRAMES) {
-        // Out of memory
-        return 0;
-    }
+    phys_addr_t addr = mag->frames[--mag->count];
+    page_mark_allocated(addr / FRAME_SIZE, 0);
 
-    INVARIANT("found frame must be free");
-    kassert(!bitmap_test(frame));
+    pmm_irq_restore(irq_state);
 
-    // Mark frame as allocated
-    bitmap_set(frame);
-    pmm_state.free_frames--;
-
-    // Convert frame number to physical address
-    phys_addr_t addr = (phys_addr_t)(frame * FRAME_SIZE);
+    INVARIANT("cached frame must be marked allocated");
+    kassert(bitmap_test(addr / FRAME_SIZE));
 
     // Even without DEBUG assertions, make sure we never hand back
     // a misaligned frame because that will poison CR3/PD setups.
@@ -381,7 +923,7 @@ phys_addr_t pmm_alloc_page(void) {
 /**
  * Free a physical frame
  *
- * RT Constraint: O(1) operation, <50 cycles
+ * RT Constraint: O(1) operation, <50 cycles (magazine not full)
  */
 void pmm_free_page(phys_addr_t page) {
     PRECONDITION("PMM must be initialized");
@@ -398,51 +940,392 @@ void pmm_free_page(phys_addr_t page) {
     PRECONDITION("frame must be within valid range");
     kassert(frame < MAX_FRAMES);
 
+    uint32_t irq_state = pmm_irq_save();
+    struct pmm_magazine *mag = pmm_local_magazine();
+
+    // Unlocked bitmap read: an allocated frame's bit only changes when it
+    // is freed, and that is this call
     PRECONDITION("frame must be allocated (cannot free twice)");
-    if (!bitmap_test(frame)) {
+    if (!bitmap_test(frame) || magazine_contains(mag, page)) {
+        pmm_irq_restore(irq_state);
         kprintf("[PMM] ERROR: Attempt to free already-free frame %lu (addr 0x%08x)\n",
                 (unsigned long)frame, (unsigned int)page);
         return;
     }
 
-    // Mark frame as free
-    bitmap_clear(frame);
-    pmm_state.free_frames++;
+    PRECONDITION("frame must not be shared");
+    struct page *desc = frame_page(frame);
+    if (desc && desc->refcount > 1) {
+        pmm_irq_restore(irq_state);
+        kprintf("[PMM] ERROR: Attempt to free shared frame 0x%08x (refcount %u)\n",
+                (unsigned int)page, (unsigned int)desc->refcount);
+        return;
+    }
+    page_mark_free(frame);
+
+    if (mag->count == PMM_MAGAZINE_SIZE) {
+        magazine_drain_batch(mag);
+    }
+
+    mag->frames[mag->count++] = page;
+
+    pmm_irq_restore(irq_state);
+}
+
+/**
+ * Allocate a zero-filled frame
+ *
+ * Pops the pre-zeroed pool; zeroes synchronously when it is empty.
+ */
+phys_addr_t pmm_alloc_zeroed_page(void) {
+    uint32_t irq_state = pmm_lock_irqsave();
+    if (zero_pool.count > 0) {
+        phys_addr_t addr = zero_pool.frames[--zero_pool.count];
+        pmm_state.free_frames--;
+        page_mark_allocated(addr / FRAME_SIZE, 0);
+        pmm_unlock_irqrestore(irq_state);
+        return addr;
+    }
+    pmm_unlock_irqrestore(irq_state);
+
+    phys_addr_t addr = pmm_alloc_page();
+    if (addr) {
+        pmm_zero_frame(addr);
+    }
+    return addr;
+}
+
+/**
+ * Zero up to `max_frames` free frames into the pool
+ *
+ * Each frame is taken from the allocator, zeroed with interrupts enabled
+ * and parked in the pool, where it counts as free again.
+ */
+uint32_t pmm_zero_pool_refill(uint32_t max_frames) {
+    uint32_t zeroed = 0;
+
+    while (zeroed < max_frames && zero_pool.count < PMM_ZERO_POOL_SIZE) {
+        // Keep a reserve of unzeroed frames for the normal allocator
+        if (pmm_state.free_frames <= PMM_ZERO_POOL_SIZE + PMM_MAGAZINE_SIZE) {
+            break;
+        }
+
+        phys_addr_t addr = pmm_alloc_page();
+        if (!addr) {
+            break;
+        }
+
+        pmm_zero_frame_nt(addr);
+
+        uint32_t irq_state = pmm_lock_irqsave();
+        if (zero_pool.count < PMM_ZERO_POOL_SIZE) {
+            zero_pool.frames[zero_pool.count++] = addr;
+            pmm_state.free_frames++;
+            page_mark_free(addr / FRAME_SIZE);
+            pmm_unlock_irqrestore(irq_state);
+        } else {
+            // Someone else filled the pool while we were zeroing
+            pmm_unlock_irqrestore(irq_state);
+            pmm_free_page(addr);
+            break;
+        }
+        zeroed++;
+    }
+
+    return zeroed;
+}
+
+/**
+ * Allocate 2^order physically contiguous, naturally aligned frames
+ *
+ * Not RT-safe: the block search is O(n) in the worst case.
+ */
+phys_addr_t pmm_alloc_pages(unsigned int order) {
+    if (order == 0) {
+        return pmm_alloc_page();
+    }
+
+    if (order > PMM_MAX_ORDER) {
+        kprintf("[PMM] ERROR: pmm_alloc_pages order %u > max %u\n",
+                order, (unsigned int)PMM_MAX_ORDER);
+        return 0;
+    }
+
+    if (!pmm_state.initialized || pmm_state.bitmap == NULL) {
+        kprintf("[PMM] ERROR: pmm_alloc_pages called before initialization\n");
+        return 0;
+    }
+
+    size_t count = (size_t)1 << order;
+    uint32_t irq_state = pmm_lock_irqsave();
+
+    size_t frame = bitmap_find_block(order);
+    if (frame >= MAX_FRAMES && pmm_local_magazine()->count > 0) {
+        // Cached frames may be splitting the only suitable block
+        pmm_unlock_irqrestore(irq_state);
+        pmm_drain_local_cache();
+        irq_state = pmm_lock_irqsave();
+        frame = bitmap_find_block(order);
+    }
+
+    if (frame >= MAX_FRAMES) {
+        pmm_unlock_irqrestore(irq_state);
+        return 0;
+    }
+
+    INVARIANT("found block must be free and aligned");
+    kassert(bitmap_block_free(frame, order));
+    kassert((frame & (count - 1)) == 0);
+
+    bitmap_set_range(frame, count);
+    pmm_state.free_frames -= count;
+    page_mark_allocated(frame, order);
+
+    pmm_unlock_irqrestore(irq_state);
+
+    POSTCONDITION("returned block must be aligned to its size");
+    phys_addr_t addr = (phys_addr_t)(frame * FRAME_SIZE);
+    kassert_aligned(addr, count * FRAME_SIZE);
+    return addr;
+}
+
+/**
+ * Free a block returned by pmm_alloc_pages()
+ *
+ * Buddies coalesce implicitly: once both halves are clear in the bitmap
+ * the larger block is found by the next search.
+ */
+void pmm_free_pages(phys_addr_t addr, unsigned int order) {
+    if (order == 0) {
+        pmm_free_page(addr);
+        return;
+    }
+
+    PRECONDITION("PMM must be initialized");
+    kassert(pmm_state.initialized);
+
+    size_t count = (size_t)1 << order;
+    size_t frame = addr / FRAME_SIZE;
+
+    if (order > PMM_MAX_ORDER || (addr & (count * FRAME_SIZE - 1)) != 0 ||
+        frame + count > MAX_FRAMES) {
+        kprintf("[PMM] ERROR: Bad block free 0x%08x order %u\n",
+                (unsigned int)addr, order);
+        return;
+    }
+
+    uint32_t irq_state = pmm_lock_irqsave();
+
+    if (bitmap_count_set(frame, count) != count) {
+        pmm_unlock_irqrestore(irq_state);
+        kprintf("[PMM] ERROR: Attempt to free already-free block 0x%08x order %u\n",
+                (unsigned int)addr, order);
+        return;
+    }
+
+    struct page *desc = frame_page(frame);
+    if (desc && desc->refcount > 1) {
+        pmm_unlock_irqrestore(irq_state);
+        kprintf("[PMM] ERROR: Attempt to free shared block 0x%08x (refcount %u)\n",
+                (unsigned int)addr, (unsigned int)desc->refcount);
+        return;
+    }
+    page_mark_free(frame);
+
+    bitmap_clear_range(frame, count);
+    pmm_state.free_frames += count;
 
-    POSTCONDITION("frame is now marked free");
-    kassert(!bitmap_test(frame));
-    POSTCONDITION("free frame count incremented");
     INVARIANT("free_frames must be <= total_frames");
     kassert(pmm_state.free_frames <= pmm_state.total_frames);
+
+    pmm_unlock_irqrestore(irq_state);
+}
+
+/**
+ * Look up a frame descriptor
+ */
+struct page *pmm_page(phys_addr_t addr) {
+    return frame_page(addr / FRAME_SIZE);
+}
+
+/**
+ * Take an extra reference on an allocated frame
+ */
+int pmm_page_get(phys_addr_t addr) {
+    uint32_t irq_state = pmm_lock_irqsave();
+    struct page *page = frame_page(addr / FRAME_SIZE);
+
+    if (!page || page->refcount == 0) {
+        pmm_unlock_irqrestore(irq_state);
+        return -EINVAL;
+    }
+    if (page->refcount == UINT16_MAX) {
+        pmm_unlock_irqrestore(irq_state);
+        return -EOVERFLOW;
+    }
+
+    int refs = ++page->refcount;
+    pmm_unlock_irqrestore(irq_state);
+    return refs;
+}
+
+/**
+ * Drop a reference; the last one frees the frame or block
+ */
+int pmm_page_put(phys_addr_t addr) {
+    uint32_t irq_state = pmm_lock_irqsave();
+    struct page *page = frame_page(addr / FRAME_SIZE);
+
+    if (!page || page->refcount == 0) {
+        pmm_unlock_irqrestore(irq_state);
+        kprintf("[PMM] ERROR: pmm_page_put on unallocated frame 0x%08x\n",
+                (unsigned int)addr);
+        return -EINVAL;
+    }
+
+    if (page->refcount > 1) {
+        int refs = --page->refcount;
+        pmm_unlock_irqrestore(irq_state);
+        return refs;
+    }
+
+    // Last reference: drop it now so a racing get fails, then hand the
+    // frame back through the normal free path
+    uint32_t order = page->order;
+    page->refcount = 0;
+    pmm_unlock_irqrestore(irq_state);
+    pmm_free_pages(addr & ~(phys_addr_t)(FRAME_SIZE - 1), order);
+    return 0;
+}
+
+phys_addr_t pmm_metadata_end(void) {
+    return pmm_state.metadata_end;
+}
+
+/**
+ * Return this CPU's cached frames to the bitmap
+ */
+void pmm_drain_local_cache(void) {
+    if (!pmm_state.initialized) {
+        return;
+    }
+
+    uint32_t irq_state = pmm_lock_irqsave();
+    struct pmm_magazine *mag = pmm_local_magazine();
+
+    bitmap_return_batch(mag->frames, mag->count);
+    pmm_state.free_frames += mag->count;
+    mag->count = 0;
+
+    pmm_unlock_irqrestore(irq_state);
 }
 
 /**
  * Reserve a physical memory region
  *
- * Marks frames in the region as allocated.
+ * Marks frames in the region as allocated, a word at a time.
+ * Must run before the region's frames can be cached in a magazine
+ * (i.e. during initialization).
  */
 void pmm_reserve_region(phys_addr_t start, size_t size) {
-    // Align start down to frame boundary
-    phys_addr_t frame_start = start / FRAME_SIZE;
-
-    // Align end up to frame boundary
-    phys_addr_t frame_end = (start + size + FRAME_SIZE - 1) / FRAME_SIZE;
-
-    // Mark frames as allocated
-    for (phys_addr_t frame = frame_start; frame < frame_end; frame++) {
-        if (frame < MAX_FRAMES) {
-            // Only count as reserved if it was previously free AND in our total range
-            if (!bitmap_test(frame) && frame < pmm_state.total_frames) {
-                if (pmm_state.free_frames > 0) {
-                    pmm_state.free_frames--;
-                    pmm_state.reserved_frames++;
+    if (size == 0) {
+        return;
+    }
+
+    // Align start down and end up to frame boundaries
+    size_t frame_start = start / FRAME_SIZE;
+    size_t frame_end = (start + size + FRAME_SIZE - 1) / FRAME_SIZE;
+
+    uint32_t irq_state = pmm_lock_irqsave();
+
+    // Only frames that were free move from the free to the reserved count
+    size_t reserved = bitmap_set_range(frame_start, frame_end - frame_start);
+    pmm_state.free_frames -= reserved;
+    pmm_state.reserved_frames += reserved;
+
+    for (size_t frame = frame_start; frame < frame_end; frame++) {
+        struct page *page = frame_page(frame);
+        if (!page) {
+            break;
+        }
+        page->flags |= PAGE_FLAG_RESERVED;
+    }
+
+    pmm_unlock_irqrestore(irq_state);
+}
+
+/**
+ * Count maximal free blocks under summary word `s` (32 bitmap words)
+ *
+ * A block of order k is counted when it is free and the enclosing block
+ * of order k + 1 is not, so every free frame is counted exactly once.
+ */
+static void count_free_blocks(size_t s, size_t *free_blocks) {
+    size_t base = s * 32 * 32;  // First frame under this summary word
+
+    // Orders WORD_ORDER .. PMM_MAX_ORDER: runs of empty words
+    for (uint32_t order = WORD_ORDER; order <= PMM_MAX_ORDER; order++) {
+        size_t n = (size_t)1 << order;
+        for (size_t frame = base; frame < base + 32 * 32; frame += n) {
+            if (bitmap_block_free(frame, order) &&
+                (order == PMM_MAX_ORDER ||
+                 !bitmap_block_free(frame & ~(2 * n - 1), order + 1))) {
+                free_blocks[order]++;
+            }
+        }
+    }
+
+    // Orders 0 .. WORD_ORDER - 1: inside partially used words
+    uint32_t partial = free_summary[s] & ~empty_summary[s];
+    while (partial != 0) {
+        size_t w = s * 32 + (size_t)__builtin_ctz(partial);
+        partial &= partial - 1;
+
+        for (uint32_t order = 0; order < WORD_ORDER; order++) {
+            size_t n = (size_t)1 << order;
+            for (size_t frame = w * 32; frame < w * 32 + 32; frame += n) {
+                if (bitmap_block_free(frame, order) &&
+                    !bitmap_block_free(frame & ~(2 * n - 1), order + 1)) {
+                    free_blocks[order]++;
                 }
             }
-            bitmap_set(frame);
         }
     }
 }
 
+/**
+ * Longest run of free frames in the bitmap (magazine frames count as used)
+ *
+ * O(max_frame / 32): whole words are skipped when empty or full.
+ */
+static size_t largest_free_run(void) {
+    size_t best = 0;
+    size_t run = 0;
+    size_t words = (pmm_state.max_frame + 31) / 32;
+
+    for (size_t w = 0; w < words; w++) {
+        uint32_t bits = frame_bitmap[w];
+        if (bits == 0) {
+            run += 32;
+            continue;
+        }
+        if (bits == 0xFFFFFFFFu) {
+            best = MAX(best, run);
+            run = 0;
+            continue;
+        }
+        for (uint32_t b = 0; b < 32; b++) {
+            if (bits & (1u << b)) {
+                best = MAX(best, run);
+                run = 0;
+            } else {
+                run++;
+            }
+        }
+    }
+    return MAX(best, run);
+}
+
 /**
  * Get PMM statistics
  */
@@ -452,7 +1335,31 @@ void pmm_get_stats(struct pmm_stats *stats) {
     }
 
     stats->total_frames = pmm_state.total_frames;
-    stats->free_frames = pmm_state.free_frames;
     stats->reserved_frames = pmm_state.reserved_frames;
     stats->kernel_frames = pmm_state.reserved_frames; // For now, same as reserved
+
+    // Maximal free blocks per order (blocks whose buddy is not also free)
+    for (uint32_t order = 0; order <= PMM_MAX_ORDER; order++) {
+        stats->free_blocks[order] = 0;
+    }
+    for (size_t s = 0; s < SUMMARY_WORDS; s++) {
+        count_free_blocks(s, stats->free_blocks);
+    }
+    stats->largest_free_run = largest_free_run();
+
+    // Racy snapshot of other CPUs' magazines; good enough for statistics
+    stats->zeroed_frames = zero_pool.count;
+#ifdef HOST_TEST
+    stats->cached_frames = host_magazine.count;
+#else
+    stats->cached_frames = 0;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (per_cpu[cpu]->online) {
+            stats->cached_frames += per_cpu[cpu]->page_cache.count;
+        }
+    }
+#endif
+    // Magazine frames are free too; only the sum is kept (no shared
+    // counter on the alloc/free fast path)
+    stats->free_frames = pmm_state.free_frames + stats->cached_frames;
 }
@@ -0,0 +1,34 @@
+/**
+ * Benchmarks for single-frame allocation
+ *
+ * Both run against this CPU's magazine; the median is the magazine hit,
+ * while p99/max include the batch refills and flushes to the bitmap.
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/pmm.h>
+#include <kernel/timer.h>
+
+static uint64_t bench_alloc_page(void) {
+    uint64_t start = timer_read_tsc();
+    phys_addr_t page = pmm_alloc_page();
+    uint64_t cycles = timer_read_tsc() - start;
+    if (page) {
+        pmm_free_page(page);
+    }
+    return cycles;
+}
+
+static uint64_t bench_free_page(void) {
+    phys_addr_t page = pmm_alloc_page();
+    if (!page) {
+        return 0;
+    }
+    uint64_t start = timer_read_tsc();
+    pmm_free_page(page);
+    return timer_read_tsc() - start;
+}
+
+// Budgets from include/kernel/pmm.h
+KBENCH_DEFINE("pmm", alloc_page, bench_alloc_page, 100);
+KBENCH_DEFINE("pmm", free_page, bench_free_page, 50);
@@ -0,0 +1,392 @@
+/**
+ * Slab Allocator (kmalloc)
+ *
+ * Power-of-two size classes backed by one-page slabs from the PMM, with a
+ * per-CPU front cache of free objects in front of each class.
+ *
+ * RT Constraints:
+ * - kmalloc()/kfree(): O(1), < 100 cycles on front-cache hit
+ * - Depot paths: O(SLAB_CPU_BATCH) plus at most one PMM call
+ */
+
+#include <kernel/slab.h>
+#include <kernel/pmm.h>
+#include <kernel/percpu.h>
+#include <kernel/hal.h>
+#include <kernel/spinlock.h>
+#include <kernel/types.h>
+#include <drivers/vga.h>
+#include <lib/string.h>
+
+#define SLAB_PAGE_SIZE 4096
+#define SLAB_MAGIC     0x51AB51ABu
+
+/**
+ * Slab header (start of every slab page)
+ *
+ * Free objects form a singly linked list through their first word.
+ */
+struct slab {
+    uint32_t     magic;         // SLAB_MAGIC, catches wild kfree()
+    uint16_t     class_idx;     // Size class index
+    uint16_t     free_count;    // Free objects in this slab
+    void*        free_list;     // First free object
+    struct slab* next;          // Depot list linkage
+    struct slab* prev;
+};
+
+/**
+ * Per-class depot (shared by all CPUs)
+ *
+ * Slabs with free objects sit on one list: partially used slabs at the
+ * head, completely free slabs at the tail, so allocation drains partial
+ * slabs first and empty ones can be given back to the PMM.
+ */
+struct slab_depot {
+    struct slab* head;
+    struct slab* tail;
+    uint32_t     object_size;
+    uint16_t     object_offset;     // First object's offset in the page
+    uint16_t     objects_per_slab;
+    size_t       slabs;             // Pages owned by this class
+    size_t       empty_slabs;       // Completely free slabs on the list
+    size_t       in_use;            // Objects outside the depot
+};
+
+// Per-CPU front cache (per_cpu_data.slab_cache points to one of these)
+struct slab_cpu_cache {
+    struct {
+        uint32_t count;
+        void*    objs[SLAB_CPU_CACHE_SIZE];
+    } cls[SLAB_NUM_CLASSES];
+};
+
+// Empty slabs kept per class before pages go back to the PMM
+#define SLAB_MAX_EMPTY 1
+
+static struct slab_depot depots[SLAB_NUM_CLASSES];
+static bool slab_ready = false;
+
+// Depots are shared by all CPUs. Slab growth and shrinking call into the
+// PMM with this held, so depot_lock nests outside pmm_lock.
+static spinlock_t depot_lock;
+
+static inline uint32_t depot_lock_irqsave(void) {
+    return spin_lock_irqsave(&depot_lock);
+}
+
+static inline void depot_unlock_irqrestore(uint32_t flags) {
+    spin_unlock_irqrestore(&depot_lock, flags);
+}
+
+/**
+ * Map a request size to its class index
+ *
+ * RT: O(1)
+ */
+static inline uint32_t size_to_class(size_t size) {
+    if (size <= (1u << SLAB_MIN_SHIFT)) {
+        return 0;
+    }
+    uint32_t shift = 32 - (uint32_t)__builtin_clz((uint32_t)size - 1);
+    return shift - SLAB_MIN_SHIFT;
+}
+
+static inline struct slab* slab_of(const void* obj) {
+    return (struct slab*)((uintptr_t)obj & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+}
+
+// ========== Depot list helpers ==========
+
+static void depot_unlink(struct slab_depot* d, struct slab* s) {
+    if (s->prev) {
+        s->prev->next = s->next;
+    } else {
+        d->head = s->next;
+    }
+    if (s->next) {
+        s->next->prev = s->prev;
+    } else {
+        d->tail = s->prev;
+    }
+    s->next = NULL;
+    s->prev = NULL;
+}
+
+static void depot_push_head(struct slab_depot* d, struct slab* s) {
+    s->prev = NULL;
+    s->next = d->head;
+    if (d->head) {
+        d->head->prev = s;
+    } else {
+        d->tail = s;
+    }
+    d->head = s;
+}
+
+static void depot_push_tail(struct slab_depot* d, struct slab* s) {
+    s->next = NULL;
+    s->prev = d->tail;
+    if (d->tail) {
+        d->tail->next = s;
+    } else {
+        d->head = s;
+    }
+    d->tail = s;
+}
+
+/**
+ * Carve a fresh page into a slab for class `idx`
+ */
+static struct slab* slab_grow(uint32_t idx) {
+    struct slab_depot* d = &depots[idx];
+
+    phys_addr_t page = pmm_alloc_page();
+    if (!page) {
+        return NULL;
+    }
+
+    // Slabs are reached through the identity map (phys == virt)
+    struct slab* s = (struct slab*)(uintptr_t)page;
+    s->magic = SLAB_MAGIC;
+    s->class_idx = (uint16_t)idx;
+    s->free_count = d->objects_per_slab;
+    s->free_list = NULL;
+    s->next = NULL;
+    s->prev = NULL;
+
+    // Thread the free list so the lowest object is handed out first
+    uint8_t* base = (uint8_t*)s + d->object_offset;
+    for (int i = d->objects_per_slab - 1; i >= 0; i--) {
+        void** obj = (void**)(base + (uint32_t)i * d->object_size);
+        *obj = s->free_list;
+        s->free_list = obj;
+    }
+
+    d->slabs++;
+    d->empty_slabs++;
+    depot_push_tail(d, s);
+    return s;
+}
+
+/**
+ * Take up to `count` objects of class `idx` from the depot
+ *
+ * @return Number of objects stored in `out`
+ */
+static uint32_t depot_alloc(uint32_t idx, void** out, uint32_t count) {
+    struct slab_depot* d = &depots[idx];
+    uint32_t taken = 0;
+
+    uint32_t flags = depot_lock_irqsave();
+
+    while (taken < count) {
+        struct slab* s = d->head;
+        if (!s && !(s = slab_grow(idx))) {
+            break;
+        }
+
+        if (s->free_count == d->objects_per_slab) {
+            d->empty_slabs--;
+        }
+
+        while (s->free_count > 0 && taken < count) {
+            void** obj = (void**)s->free_list;
+            s->free_list = *obj;
+            s->free_count--;
+            out[taken++] = obj;
+        }
+
+        if (s->free_count == 0) {
+            depot_unlink(d, s);
+        }
+    }
+
+    d->in_use += taken;
+    depot_unlock_irqrestore(flags);
+    return taken;
+}
+
+/**
+ * Return `count` objects of class `idx` to their slabs
+ */
+static void depot_free(uint32_t idx, void* const* objs, uint32_t count) {
+    struct slab_depot* d = &depots[idx];
+
+    uint32_t flags = depot_lock_irqsave();
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct slab* s = slab_of(objs[i]);
+
+        *(void**)objs[i] = s->free_list;
+        s->free_list = objs[i];
+        s->free_count++;
+
+        if (s->free_count == 1) {
+            // Was full: back on the list with the partial slabs
+            depot_push_head(d, s);
+        }
+
+        if (s->free_count == d->objects_per_slab) {
+            // Completely free: keep a few, give the rest back
+            depot_unlink(d, s);
+            if (d->empty_slabs >= SLAB_MAX_EMPTY) {
+                s->magic = 0;
+                d->slabs--;
+                pmm_free_page((phys_addr_t)(uintptr_t)s);
+            } else {
+                d->empty_slabs++;
+                depot_push_tail(d, s);
+            }
+        }
+    }
+
+    d->in_use -= count;
+    depot_unlock_irqrestore(flags);
+}
+
+/**
+ * Check that `ptr` is an object start inside a live slab
+ */
+static bool slab_valid_object(const void* ptr) {
+    const struct slab* s = slab_of(ptr);
+    if (s->magic != SLAB_MAGIC || s->class_idx >= SLAB_NUM_CLASSES) {
+        return false;
+    }
+
+    const struct slab_depot* d = &depots[s->class_idx];
+    uintptr_t offset = (uintptr_t)ptr - (uintptr_t)s;
+    if (offset < d->object_offset) {
+        return false;
+    }
+    offset -= d->object_offset;
+    return (offset % d->object_size) == 0 &&
+           offset / d->object_size < d->objects_per_slab;
+}
+
+// ========== Public API ==========
+
+void slab_init(void) {
+    kprintf("[SLAB] Initializing slab allocator...\n");
+
+    for (uint32_t idx = 0; idx < SLAB_NUM_CLASSES; idx++) {
+        struct slab_depot* d = &depots[idx];
+        uint32_t size = 1u << (idx + SLAB_MIN_SHIFT);
+        uint32_t align = MIN(size, 64u);
+
+        memset(d, 0, sizeof(*d));
+        d->object_size = size;
+        d->object_offset = (uint16_t)ALIGN_UP((uint32_t)sizeof(struct slab), align);
+        d->objects_per_slab = (uint16_t)((SLAB_PAGE_SIZE - d->object_offset) / size);
+    }
+
+    slab_ready = true;
+
+    if (slab_cpu_init(hal->cpu_id()) < 0) {
+        kprintf("[SLAB] WARNING: No front cache for boot CPU\n");
+    }
+
+    kprintf("[SLAB] %u size classes (%u-%u bytes)\n",
+            (unsigned int)SLAB_NUM_CLASSES,
+            1u << SLAB_MIN_SHIFT, (unsigned int)KMALLOC_MAX_SIZE);
+}
+
+int slab_cpu_init(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS || !slab_ready) {
+        return -EINVAL;
+    }
+
+    void* obj = NULL;
+    if (depot_alloc(size_to_class(sizeof(struct slab_cpu_cache)), &obj, 1) != 1) {
+        return -ENOMEM;
+    }
+
+    struct slab_cpu_cache* cache = (struct slab_cpu_cache*)obj;
+    memset(cache, 0, sizeof(*cache));
+    cpu_data(cpu_id)->slab_cache = cache;
+    return 0;
+}
+
+void* kmalloc(size_t size) {
+    if (size == 0 || size > KMALLOC_MAX_SIZE || !slab_ready) {
+        return NULL;
+    }
+
+    uint32_t idx = size_to_class(size);
+    void* obj = NULL;
+
+    uint32_t flags = hal->irq_disable();
+    struct slab_cpu_cache* cache = this_cpu()->slab_cache;
+
+    if (!cache) {
+        // CPU without a front cache yet: go straight to the depot
+        hal->irq_restore(flags);
+        return (depot_alloc(idx, &obj, 1) == 1) ? obj : NULL;
+    }
+
+    if (cache->cls[idx].count == 0) {
+        cache->cls[idx].count = depot_alloc(idx, cache->cls[idx].objs, SLAB_CPU_BATCH);
+    }
+    if (cache->cls[idx].count > 0) {
+        obj = cache->cls[idx].objs[--cache->cls[idx].count];
+    }
+
+    hal->irq_restore(flags);
+    return obj;
+}
+
+void* kzalloc(size_t size) {
+    void* obj = kmalloc(size);
+    if (obj) {
+        memset(obj, 0, size);
+    }
+    return obj;
+}
+
+void kfree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    if (!slab_valid_object(ptr)) {
+        kprintf("[SLAB] ERROR: kfree of non-slab pointer %p\n", ptr);
+        return;
+    }
+
+    uint32_t idx = slab_of(ptr)->class_idx;
+
+    uint32_t flags = hal->irq_disable();
+    struct slab_cpu_cache* cache = this_cpu()->slab_cache;
+
+    if (!cache) {
+        hal->irq_restore(flags);
+        depot_free(idx, &ptr, 1);
+        return;
+    }
+
+    if (cache->cls[idx].count == SLAB_CPU_CACHE_SIZE) {
+        // Flush the coldest batch (bottom of the stack) to the depot
+        depot_free(idx, cache->cls[idx].objs, SLAB_CPU_BATCH);
+        for (uint32_t i = SLAB_CPU_BATCH; i < SLAB_CPU_CACHE_SIZE; i++) {
+            cache->cls[idx].objs[i - SLAB_CPU_BATCH] = cache->cls[idx].objs[i];
+        }
+        cache->cls[idx].count = SLAB_CPU_CACHE_SIZE - SLAB_CPU_BATCH;
+    }
+    cache->cls[idx].objs[cache->cls[idx].count++] = ptr;
+
+    hal->irq_restore(flags);
+}
+
+void slab_get_stats(struct slab_class_stats* stats) {
+    if (!stats) {
+        return;
+    }
+
+    uint32_t flags = depot_lock_irqsave();
+    for (uint32_t idx = 0; idx < SLAB_NUM_CLASSES; idx++) {
+        stats[idx].object_size = depots[idx].object_size;
+        stats[idx].slabs = depots[idx].slabs;
+        stats[idx].objects_in_use = depots[idx].in_use;
+    }
+    depot_unlock_irqrestore(flags);
+}
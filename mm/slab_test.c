@@ -0,0 +1,77 @@
+/**
+ * Unit tests for the slab allocator
+ *
+ * These tests verify size classes, alignment and object reuse in mm/slab.c
+ */
+
+#include <kernel/ktest.h>
+#include <kernel/slab.h>
+#include <kernel/types.h>
+#include <lib/string.h>
+
+// Test: every class hands out aligned, writable objects
+static int test_kmalloc_classes(void) {
+    for (size_t size = 1; size <= KMALLOC_MAX_SIZE; size *= 2) {
+        uint8_t* p = kmalloc(size);
+        KTEST_ASSERT_NOT_NULL(p, "kmalloc succeeds");
+        KTEST_ASSERT_EQ((uintptr_t)p & (MIN(size, 16u) - 1), 0, "object aligned");
+        memset(p, 0xA5, size);
+        KTEST_ASSERT_EQ(p[size - 1], 0xA5, "object writable to its end");
+        kfree(p);
+    }
+    return KTEST_PASS;
+}
+
+// Test: invalid sizes are rejected
+static int test_kmalloc_bad_sizes(void) {
+    KTEST_ASSERT_NULL(kmalloc(0), "zero-size allocation fails");
+    KTEST_ASSERT_NULL(kmalloc(KMALLOC_MAX_SIZE + 1), "oversized allocation fails");
+    kfree(NULL);
+    return KTEST_PASS;
+}
+
+// Test: kzalloc zeroes, freed objects are reused LIFO
+static int test_kzalloc_and_reuse(void) {
+    uint8_t* a = kzalloc(200);
+    KTEST_ASSERT_NOT_NULL(a, "kzalloc succeeds");
+    for (int i = 0; i < 200; i++) {
+        KTEST_ASSERT_EQ(a[i], 0, "kzalloc memory is zero");
+    }
+    kfree(a);
+    uint8_t* b = kmalloc(200);
+    KTEST_ASSERT_EQ((uintptr_t)b, (uintptr_t)a, "hot object reused first");
+    kfree(b);
+    return KTEST_PASS;
+}
+
+// Test: many live objects are distinct and accounted per class
+static int test_kmalloc_many(void) {
+    static void* objs[300];
+    struct slab_class_stats before[SLAB_NUM_CLASSES];
+    struct slab_class_stats mid[SLAB_NUM_CLASSES];
+    slab_get_stats(before);
+
+    for (int i = 0; i < 300; i++) {
+        objs[i] = kmalloc(64);
+        KTEST_ASSERT_NOT_NULL(objs[i], "kmalloc succeeds");
+        *(int*)objs[i] = i;
+    }
+    for (int i = 0; i < 300; i++) {
+        KTEST_ASSERT_EQ(*(int*)objs[i], i, "objects do not overlap");
+    }
+
+    slab_get_stats(mid);
+    KTEST_ASSERT(mid[2].objects_in_use >= before[2].objects_in_use + 300 - SLAB_CPU_CACHE_SIZE,
+                 "64-byte class accounts live objects");
+
+    for (int i = 0; i < 300; i++) {
+        kfree(objs[i]);
+    }
+    return KTEST_PASS;
+}
+
+// Register all tests
+KTEST_DEFINE("slab", kmalloc_classes, test_kmalloc_classes);
+KTEST_DEFINE("slab", kmalloc_bad_sizes, test_kmalloc_bad_sizes);
+KTEST_DEFINE("slab", kzalloc_and_reuse, test_kzalloc_and_reuse);
+KTEST_DEFINE("slab", kmalloc_many, test_kmalloc_many);
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# Hot-spot report for profiler samples (kernel/pmu.h) in a trace capture.
+#
+# Samples are attributed to the kernel.elf function containing the
+# sampled EIP (no call graphs: the NMI records only where the CPU was).
+#
+#   scripts/profile_report.py com1.bin kernel.elf
+#   scripts/profile_report.py com1.bin kernel.elf --addresses 20 --cpu 1
+#
+
+import argparse
+import bisect
+import collections
+import os
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from trace2json import TRACE_PROFILE_SAMPLE, parse_capture  # noqa: E402
+
+# pmu_event_t (include/kernel/pmu.h)
+EVENTS = ["cycles", "instructions", "ref-cycles", "llc-references", "llc-misses",
+          "branches", "branch-misses"]
+
+
+class Symbols:
+    def __init__(self, elf, nm):
+        out = subprocess.run([nm, "-n", "--defined-only", elf], check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True).stdout
+        self.addrs = []
+        self.names = []
+        for line in out.splitlines():
+            parts = line.split()
+            if len(parts) != 3 or parts[1] not in "tTwW":
+                continue
+            self.addrs.append(int(parts[0], 16))
+            self.names.append(parts[2])
+
+    def lookup(self, addr):
+        """Return (function, offset), or (None, 0) outside the text."""
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return None, 0
+        return self.names[i], addr - self.addrs[i]
+
+
+def table(title, counts, total, limit):
+    print("\n%s" % title)
+    print("%8s %7s %7s  %s" % ("samples", "self%", "cum%", "location"))
+    cum = 0
+    for name, n in counts.most_common(limit):
+        cum += n
+        print("%8d %6.2f%% %6.2f%%  %s" % (n, 100.0 * n / total, 100.0 * cum / total, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Flat hot-spot report from profiler samples in a trace capture")
+    parser.add_argument("capture", help="binary capture from the serial port")
+    parser.add_argument("elf", help="kernel.elf the samples came from")
+    parser.add_argument("--nm", default=os.environ.get("NM", "nm"), help="nm to use")
+    parser.add_argument("--cpu", type=int, help="only samples from this CPU")
+    parser.add_argument("--task", type=int, help="only samples from this task ID")
+    parser.add_argument("--limit", type=int, default=30, help="rows per table")
+    parser.add_argument("--addresses", type=int, default=0,
+                        help="also list the N hottest instructions")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        buf = f.read()
+
+    samples = []
+    for _, records in parse_capture(buf):
+        for kind, cpu, _, words in records:
+            if kind != TRACE_PROFILE_SAMPLE:
+                continue
+            if args.cpu is not None and cpu != args.cpu:
+                continue
+            if args.task is not None and words[1] != args.task:
+                continue
+            samples.append((cpu, words))
+    if not samples:
+        sys.exit("no profiler samples in %s" % args.capture)
+
+    syms = Symbols(args.elf, args.nm)
+    funcs = collections.Counter()
+    addrs = collections.Counter()
+    tasks = collections.Counter()
+    events = collections.Counter()
+    for cpu, (eip, task, event, ring, *_) in samples:
+        events[EVENTS[event] if event < len(EVENTS) else "event %d" % event] += 1
+        tasks["task %d" % task] += 1
+        if ring != 0:
+            funcs["[user]"] += 1
+            continue
+        name, offset = syms.lookup(eip)
+        funcs[name or "[unknown 0x%x]" % eip] += 1
+        addrs["0x%08x  %s+0x%x" % (eip, name, offset) if name else "0x%08x" % eip] += 1
+
+    total = len(samples)
+    print("%d samples (%s)" % (total, ", ".join("%s: %d" % e for e in events.most_common())))
+    table("By function", funcs, total, args.limit)
+    table("By task", tasks, total, args.limit)
+    if args.addresses:
+        table("By instruction (kernel)", addrs, total, args.addresses)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+#
+# Convert a binary trace capture (trace_export(), include/kernel/trace.h)
+# into Chrome trace JSON. Load the output in chrome://tracing or
+# https://ui.perfetto.dev.
+#
+# The capture may be a raw serial log: console text between chunks is
+# skipped.
+#
+#   qemu-system-i386 ... -serial file:com1.bin
+#   scripts/trace2json.py com1.bin -o trace.json
+#
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"AKTR"
+VERSION = 1
+HEADER = struct.Struct("<4sBBHQ")
+
+# enum trace_event_type (include/kernel/percpu.h)
+TRACE_INTERRUPT = 0
+TRACE_SCHEDULE = 1
+TRACE_TASK_SWITCH = 2
+TRACE_SYSCALL = 3
+TRACE_IPI = 4
+TRACE_TLB_FLUSH = 5
+TRACE_CUSTOM = 6
+TRACE_INTERRUPT_EXIT = 7
+TRACE_PROFILE_SAMPLE = 8
+TAG_LOST = 0x1E
+TAG_END = 0x1F
+
+TLB_KINDS = {0: "invlpg", 1: "flush all", 2: "flush global", 3: "address space switch"}
+
+# Thread IDs within a CPU's process
+TID_TASKS = 0
+TID_IRQ = 1
+TID_SYSCALL = 2
+TID_EVENTS = 3
+
+
+class Truncated(Exception):
+    pass
+
+
+def varint(buf, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(buf):
+            raise Truncated()
+        byte = buf[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+        if shift > 63:
+            raise ValueError("varint too long")
+
+
+def parse_chunk(buf, pos):
+    """Decode one chunk at pos; return (tsc_hz, records, next_pos)."""
+    magic, version, _, _, tsc_hz = HEADER.unpack_from(buf, pos)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("bad header")
+    pos += HEADER.size
+    last = {}
+    lost = {}
+    records = []
+    while True:
+        if pos >= len(buf):
+            raise Truncated()
+        tag = buf[pos]
+        pos += 1
+        kind = tag & 0x1F
+        if kind == TAG_END:
+            records.extend((TAG_LOST, cpu, None, words) for cpu, words in lost.items())
+            return tsc_hz, records, pos
+        nwords = tag >> 5
+        if nwords > 4:
+            raise ValueError("bad tag")
+        cpu, pos = varint(buf, pos)
+        delta, pos = varint(buf, pos)
+        words = []
+        for _ in range(nwords):
+            word, pos = varint(buf, pos)
+            words.append(word)
+        words += [0] * (4 - nwords)
+        if kind == TAG_LOST:
+            lost[cpu] = words  # Stamped with the CPU's next event
+            continue
+        last[cpu] = last.get(cpu, 0) + delta
+        if cpu in lost:
+            records.append((TAG_LOST, cpu, last[cpu], lost.pop(cpu)))
+        records.append((kind, cpu, last[cpu], words))
+
+
+def parse_capture(buf):
+    """Yield (tsc_hz, records) for every complete chunk in buf."""
+    pos = 0
+    while True:
+        pos = buf.find(MAGIC, pos)
+        if pos < 0 or pos + HEADER.size > len(buf):
+            return
+        try:
+            tsc_hz, records, end = parse_chunk(buf, pos)
+        except Truncated:
+            return
+        except (ValueError, struct.error):
+            pos += 1  # Text that happened to contain the magic
+            continue
+        yield tsc_hz, records
+        pos = end
+
+
+class Converter:
+    def __init__(self, tsc_hz):
+        self.tsc_hz = tsc_hz
+        self.base = None
+        self.events = []
+        self.running = {}      # cpu -> (task id, start us)
+        self.irq_open = {}     # cpu -> [(vector, start us)]
+        self.cpus = set()
+
+    def us(self, tsc):
+        if self.base is None:
+            self.base = tsc
+        return (tsc - self.base) * 1e6 / self.tsc_hz
+
+    def cycles_us(self, cycles):
+        return cycles * 1e6 / self.tsc_hz
+
+    def slice(self, cpu, tid, name, start, dur, args=None):
+        self.events.append({"name": name, "ph": "X", "pid": cpu, "tid": tid,
+                            "ts": start, "dur": max(dur, 0.0), "args": args or {}})
+
+    def instant(self, cpu, tid, name, ts, args=None, scope="t"):
+        self.events.append({"name": name, "ph": "i", "s": scope, "pid": cpu, "tid": tid,
+                            "ts": ts, "args": args or {}})
+
+    def add(self, kind, cpu, tsc, words):
+        self.cpus.add(cpu)
+        ts = self.us(tsc)
+        if kind == TAG_LOST:
+            self.instant(cpu, TID_EVENTS, "lost events", ts, {"count": words[0]}, "p")
+        elif kind == TRACE_SCHEDULE:
+            prev, nxt, direct = words[0], words[1], words[2]
+            if cpu in self.running:
+                task, start = self.running[cpu]
+                self.slice(cpu, TID_TASKS, "task %d" % task, start, ts - start)
+            else:
+                self.instant(cpu, TID_TASKS, "switch from task %d" % prev, ts)
+            self.running[cpu] = (nxt, ts)
+            if direct:
+                self.instant(cpu, TID_EVENTS, "direct switch", ts, {"to": nxt})
+        elif kind == TRACE_TASK_SWITCH:
+            cycles, prev, nxt, fast = words
+            dur = self.cycles_us(cycles)
+            self.slice(cpu, TID_EVENTS, "context switch", ts - dur, dur,
+                       {"from": prev, "to": nxt, "cycles": cycles, "fast path": fast})
+        elif kind == TRACE_INTERRUPT:
+            self.irq_open.setdefault(cpu, []).append((words[0], ts))
+        elif kind == TRACE_INTERRUPT_EXIT:
+            vector, cycles = words[0], words[1]
+            stack = self.irq_open.get(cpu, [])
+            if stack and stack[-1][0] == vector:
+                start = stack.pop()[1]
+            else:
+                start = ts - self.cycles_us(cycles)
+            self.slice(cpu, TID_IRQ, "irq %d" % vector, start, ts - start,
+                       {"vector": vector, "cycles": cycles})
+        elif kind == TRACE_SYSCALL:
+            number, result, cycles = words[0], words[1], words[2]
+            dur = self.cycles_us(cycles)
+            if result >= 1 << 63:
+                result -= 1 << 64
+            self.slice(cpu, TID_SYSCALL, "syscall %d" % number, ts - dur, dur,
+                       {"result": result, "cycles": cycles})
+        elif kind == TRACE_TLB_FLUSH:
+            args = {"address": "0x%x" % words[1]} if words[0] == 0 else {}
+            self.instant(cpu, TID_EVENTS, "tlb " + TLB_KINDS.get(words[0], str(words[0])),
+                         ts, args)
+        elif kind == TRACE_PROFILE_SAMPLE:
+            self.instant(cpu, TID_EVENTS, "sample", ts,
+                         {"eip": "0x%x" % words[0], "task": words[1], "ring": words[3]})
+        elif kind == TRACE_IPI:
+            self.instant(cpu, TID_EVENTS, "ipi", ts, {"data": words})
+        else:
+            name = "custom" if kind == TRACE_CUSTOM else "event %d" % kind
+            self.instant(cpu, TID_EVENTS, name, ts, {"data": words})
+
+    def finish(self):
+        end = max((e["ts"] + e.get("dur", 0) for e in self.events), default=0.0)
+        for cpu, (task, start) in self.running.items():
+            self.slice(cpu, TID_TASKS, "task %d" % task, start, end - start)
+        for cpu in sorted(self.cpus):
+            self.events.append({"name": "process_name", "ph": "M", "pid": cpu,
+                                "args": {"name": "CPU %d" % cpu}})
+            for tid, name in ((TID_TASKS, "tasks"), (TID_IRQ, "interrupts"),
+                              (TID_SYSCALL, "syscalls"), (TID_EVENTS, "events")):
+                self.events.append({"name": "thread_name", "ph": "M", "pid": cpu, "tid": tid,
+                                    "args": {"name": name}})
+        return {"traceEvents": self.events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Convert a binary kernel trace capture to Chrome trace JSON")
+    parser.add_argument("capture", help="binary capture from the serial port")
+    parser.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    parser.add_argument("--tsc-hz", type=int, default=0,
+                        help="TSC frequency if the kernel did not calibrate one")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        buf = f.read()
+
+    records = []
+    tsc_hz = args.tsc_hz
+    for chunk_hz, chunk in parse_capture(buf):
+        tsc_hz = tsc_hz or chunk_hz
+        records.extend(chunk)
+    if not records:
+        sys.exit("no trace chunks in %s" % args.capture)
+    if not tsc_hz:
+        sys.exit("TSC frequency unknown; pass --tsc-hz")
+
+    # Losses with no later event on their CPU go at the start
+    first = min((r[2] for r in records if r[2] is not None), default=0)
+    records = [(k, c, first if t is None else t, w) for k, c, t, w in records]
+    # Chunks hold one CPU after another; Chrome wants each track in order
+    records.sort(key=lambda r: (r[2], r[1]))
+    conv = Converter(tsc_hz)
+    for kind, cpu, tsc, words in records:
+        conv.add(kind, cpu, tsc, words)
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump(conv.finish(), out)
+    if args.output:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,124 @@
+/**
+ * Host-side unit tests for clock source conversion (core/clocksource.c)
+ *
+ * Validates:
+ * - mul_u64_u32_shr() matches exact 128-bit arithmetic
+ * - mult/shift conversion stays within a few ppm of exact division for
+ *   PIT, tick and TSC rates, also after years of uptime
+ * - Registration rejects incomplete sources and the highest rating wins
+ */
+
+#include "host_test.h"
+#include "../include/kernel/clocksource.h"
+#include "../include/kernel/types.h"
+
+static uint64_t fake_counter;
+
+static uint64_t fake_read(void) {
+    return fake_counter;
+}
+
+// Exact cycles * to_hz / from_hz
+static uint64_t exact_convert(uint64_t cycles, uint64_t from_hz, uint64_t to_hz) {
+    return (uint64_t)(((unsigned __int128)cycles * to_hz) / from_hz);
+}
+
+static uint64_t abs_diff(uint64_t a, uint64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+TEST(clocksource_mul_shr_exact) {
+    static const uint64_t values[] = {
+        0, 1, 0xFFFFFFFFULL, 0x100000000ULL, 0x123456789ABCDEFULL,
+        0xFFFFFFFFFFFFFFFFULL,
+    };
+    static const uint32_t mults[] = { 1, 3, 0x80000000u, 0xFFFFFFFFu };
+    static const uint32_t shifts[] = { 0, 1, 10, 31, 32 };
+
+    for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+        for (size_t m = 0; m < sizeof(mults) / sizeof(mults[0]); m++) {
+            for (size_t s = 0; s < sizeof(shifts) / sizeof(shifts[0]); s++) {
+                unsigned __int128 want = ((unsigned __int128)values[v] * mults[m]) >> shifts[s];
+                uint64_t got = mul_u64_u32_shr(values[v], mults[m], shifts[s]);
+                // Results that fit in 64 bits must be exact
+                if ((want >> 64) == 0) {
+                    TEST_ASSERT(got == (uint64_t)want, "matches 128-bit result");
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+TEST(clocksource_conversion_accuracy) {
+    static const uint64_t rates[] = {
+        1000,               // 1 kHz tick
+        1193182,            // PIT input clock
+        14318180,           // HPET
+        999999999,          // Just under 1 GHz
+        2994321000ULL,      // Odd TSC rate
+        5000000000ULL,      // 5 GHz TSC
+    };
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        uint32_t ns_mult, ns_shift, us_mult, us_shift;
+        clocks_calc_mult_shift(&ns_mult, &ns_shift, rates[r], 1000000000ULL);
+        clocks_calc_mult_shift(&us_mult, &us_shift, rates[r], 1000000ULL);
+        TEST_ASSERT(ns_shift <= 32 && us_shift <= 32, "shift in range");
+
+        // One second, one day and ten years of counts
+        static const uint64_t seconds[] = { 1, 86400, 315360000ULL };
+        for (size_t s = 0; s < sizeof(seconds) / sizeof(seconds[0]); s++) {
+            uint64_t cycles = rates[r] * seconds[s] + 12345;
+            uint64_t ns = exact_convert(cycles, rates[r], 1000000000ULL);
+            uint64_t us = exact_convert(cycles, rates[r], 1000000ULL);
+
+            // Within 1 ppm of exact (plus one unit of rounding)
+            TEST_ASSERT(abs_diff(mul_u64_u32_shr(cycles, ns_mult, ns_shift), ns) <= ns / 1000000 + 1,
+                        "ns within 1 ppm");
+            TEST_ASSERT(abs_diff(mul_u64_u32_shr(cycles, us_mult, us_shift), us) <= us / 1000000 + 1,
+                        "us within 1 ppm");
+        }
+    }
+    return 1;
+}
+
+TEST(clocksource_register_rating) {
+    const struct clocksource* saved = clocksource_active;
+
+    struct clocksource no_read = { .name = "bad", .freq_hz = 1000, .rating = 500 };
+    struct clocksource no_freq = { .name = "bad", .read = fake_read, .rating = 500 };
+    TEST_ASSERT_EQ(clocksource_register(&no_read), -EINVAL, "needs a read function");
+    TEST_ASSERT_EQ(clocksource_register(&no_freq), -EINVAL, "needs a rate");
+    TEST_ASSERT(clocksource_active == saved, "rejected sources are not used");
+
+    struct clocksource tick = {
+        .name = "tick", .read = fake_read, .freq_hz = 1000,
+        .rating = CLOCKSOURCE_RATING_TICK + 1000,
+    };
+    struct clocksource tsc = {
+        .name = "tsc", .read = fake_read, .freq_hz = 2000000000ULL,
+        .rating = CLOCKSOURCE_RATING_TSC + 1000,
+    };
+    struct clocksource worse = {
+        .name = "worse", .read = fake_read, .freq_hz = 1000, .rating = 1,
+    };
+    TEST_ASSERT_EQ(clocksource_register(&tick), 0, "tick registers");
+    TEST_ASSERT(clocksource_active == &tick, "tick outrates the previous source");
+
+    fake_counter = 1500;
+    TEST_ASSERT_EQ(clocksource_read_us(), 1500000, "tick counts in us");
+
+    TEST_ASSERT_EQ(clocksource_register(&tsc), 0, "tsc registers");
+    TEST_ASSERT(clocksource_active == &tsc, "tsc outrates tick");
+    TEST_ASSERT_EQ(clocksource_register(&worse), 0, "worse registers");
+    TEST_ASSERT(clocksource_active == &tsc, "lower rating does not switch");
+
+    fake_counter = 3000000000ULL;   // 1.5 s at 2 GHz
+    TEST_ASSERT_EQ(clocksource_read_ns(), 1500000000ULL, "tsc counts in ns");
+    TEST_ASSERT_EQ(clocksource_read_us(), 1500000, "tsc counts in us");
+    TEST_ASSERT_EQ(clocksource_cyc2ns(2000), 1000, "cyc2ns");
+
+    clocksource_active = saved;
+    return 1;
+}
@@ -0,0 +1,189 @@
+/**
+ * Host-side unit tests for the kernel timing wheel (core/ktimer.c)
+ *
+ * Time is driven by the test through ktimer_host_now_us and explicit
+ * ktimer_run() calls. Validates:
+ * - Timers never fire early and fire within one wheel tick of due
+ * - Cancel, double-add and re-arm from a callback
+ * - Cascading through every level, and delays beyond the wheel span
+ * - Next-deadline reporting for tickless sleeps
+ */
+
+#include "host_test.h"
+#include <string.h>
+#include "../include/kernel/ktimer.h"
+#include "../include/kernel/types.h"
+
+extern uint64_t ktimer_host_now_us;
+
+#define MAX_FIRED 16
+
+static int fired_count;
+static int fired_id[MAX_FIRED];
+static uint64_t fired_at[MAX_FIRED];
+
+static void record_fire(struct ktimer* timer, void* arg) {
+    (void)timer;
+    if (fired_count < MAX_FIRED) {
+        fired_id[fired_count] = (int)(intptr_t)arg;
+        fired_at[fired_count] = ktimer_host_now_us;
+    }
+    fired_count++;
+}
+
+static void reset_fired(void) {
+    fired_count = 0;
+    memset(fired_id, 0, sizeof(fired_id));
+    memset(fired_at, 0, sizeof(fired_at));
+}
+
+// Tests share one wheel, so each starts at a fresh, tick-aligned time
+// after everything earlier (time never runs backwards)
+static uint64_t fresh_time(void) {
+    uint64_t t = (ktimer_host_now_us + 10000000) & ~(uint64_t)(KTIMER_TICK_US - 1);
+    ktimer_host_now_us = t;
+    ktimer_run(t);
+    return t;
+}
+
+// Advance time in wheel-tick steps up to `until`, running the wheel
+static void advance_to(uint64_t until) {
+    while (ktimer_host_now_us < until) {
+        ktimer_host_now_us += KTIMER_TICK_US;
+        if (ktimer_host_now_us > until) {
+            ktimer_host_now_us = until;
+        }
+        ktimer_run(ktimer_host_now_us);
+    }
+}
+
+TEST(ktimer_fires_not_early) {
+    reset_fired();
+    ktimer_host_now_us = fresh_time() + 1000;   // Not tick-aligned
+    uint64_t due = ktimer_host_now_us + 500;
+
+    struct ktimer t;
+    ktimer_init(&t, record_fire, (void*)1);
+    TEST_ASSERT_EQ(ktimer_add(&t, 500), 0, "add succeeds");
+    TEST_ASSERT(t.pending, "timer pending after add");
+
+    ktimer_host_now_us = due - 1;
+    ktimer_run(ktimer_host_now_us);
+    TEST_ASSERT_EQ(fired_count, 0, "not fired before the delay");
+
+    advance_to(due + KTIMER_TICK_US);
+    TEST_ASSERT_EQ(fired_count, 1, "fired within one tick of due");
+    TEST_ASSERT(fired_at[0] >= due, "fire time is not early");
+    TEST_ASSERT(!t.pending, "not pending after firing");
+
+    return 1;
+}
+
+TEST(ktimer_cancel_and_busy) {
+    reset_fired();
+    uint64_t start = fresh_time();
+
+    struct ktimer t;
+    ktimer_init(&t, record_fire, (void*)2);
+    TEST_ASSERT_EQ(ktimer_add(&t, 1000), 0, "add succeeds");
+    TEST_ASSERT(ktimer_add(&t, 1000) == -EBUSY, "double add is -EBUSY");
+
+    TEST_ASSERT(ktimer_cancel(&t), "cancel reports pending");
+    TEST_ASSERT(!ktimer_cancel(&t), "second cancel reports not pending");
+
+    advance_to(start + 10000);
+    TEST_ASSERT_EQ(fired_count, 0, "cancelled timer never fires");
+
+    struct ktimer nofn;
+    ktimer_init(&nofn, NULL, NULL);
+    TEST_ASSERT(ktimer_add(&nofn, 10) == -EINVAL, "no callback is -EINVAL");
+
+    return 1;
+}
+
+TEST(ktimer_cascades_in_order) {
+    reset_fired();
+    uint64_t start = fresh_time();
+
+    // One timer per level: 100us, 10ms, 500ms, 60s
+    static const uint64_t delays[] = { 100, 10000, 500000, 60000000 };
+    struct ktimer t[4];
+    for (int i = 3; i >= 0; i--) {
+        ktimer_init(&t[i], record_fire, (void*)(intptr_t)i);
+        TEST_ASSERT_EQ(ktimer_add(&t[i], delays[i]), 0, "add succeeds");
+    }
+
+    advance_to(start + delays[3] + KTIMER_TICK_US);
+
+    TEST_ASSERT_EQ(fired_count, 4, "all four fired");
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQ(fired_id[i], i, "fired in deadline order");
+        TEST_ASSERT(fired_at[i] >= start + delays[i], "not early");
+        TEST_ASSERT(fired_at[i] < start + delays[i] + 2 * KTIMER_TICK_US, "within a tick");
+    }
+
+    return 1;
+}
+
+TEST(ktimer_next_deadline_drives_sleep) {
+    reset_fired();
+    fresh_time();
+    TEST_ASSERT_EQ(ktimer_next_deadline_us(), KTIMER_NO_DEADLINE, "empty wheel has no deadline");
+
+    // Beyond the wheel span (~17.9 min): must get re-filed on the way
+    uint64_t start = ktimer_host_now_us;
+    uint64_t delay = 3600ULL * 1000000;
+    struct ktimer t;
+    ktimer_init(&t, record_fire, (void*)3);
+    TEST_ASSERT_EQ(ktimer_add(&t, delay), 0, "add succeeds");
+
+    // Tickless sleep: only wake at the reported deadlines
+    int wakeups = 0;
+    while (fired_count == 0 && wakeups < 1000) {
+        uint64_t next = ktimer_next_deadline_us();
+        TEST_ASSERT(next != KTIMER_NO_DEADLINE, "pending timer reports a deadline");
+        TEST_ASSERT(next <= start + delay + KTIMER_TICK_US, "deadline never past due time");
+        if (next > ktimer_host_now_us) {
+            ktimer_host_now_us = next;
+        }
+        ktimer_run(ktimer_host_now_us);
+        wakeups++;
+    }
+
+    TEST_ASSERT_EQ(fired_count, 1, "far timer fired");
+    TEST_ASSERT(fired_at[0] >= start + delay, "not early");
+    TEST_ASSERT(wakeups < 300, "few wakeups for a long sleep");
+    TEST_ASSERT_EQ(ktimer_next_deadline_us(), KTIMER_NO_DEADLINE, "wheel empty again");
+
+    return 1;
+}
+
+static struct ktimer rearm_timer;
+static int rearm_left;
+
+static void rearm_fire(struct ktimer* timer, void* arg) {
+    record_fire(timer, arg);
+    if (--rearm_left > 0) {
+        ktimer_add(timer, 0);
+    }
+}
+
+TEST(ktimer_rearm_from_callback) {
+    reset_fired();
+    fresh_time();
+    rearm_left = 3;
+
+    ktimer_init(&rearm_timer, rearm_fire, (void*)4);
+    TEST_ASSERT_EQ(ktimer_add(&rearm_timer, 0), 0, "add succeeds");
+
+    // One run may only fire the timer once: the re-add lands on a later tick
+    ktimer_host_now_us += KTIMER_TICK_US;
+    ktimer_run(ktimer_host_now_us);
+    TEST_ASSERT_EQ(fired_count, 1, "re-armed timer not fired twice in one run");
+
+    advance_to(ktimer_host_now_us + 10 * KTIMER_TICK_US);
+    TEST_ASSERT_EQ(fired_count, 3, "re-armed timer fired each time");
+    TEST_ASSERT(!rearm_timer.pending, "done after the last shot");
+
+    return 1;
+}
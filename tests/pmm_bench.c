@@ -0,0 +1,343 @@
+/**
+ * Host-side workload benchmark for the Physical Memory Manager (mm/pmm.c)
+ *
+ * Replays allocation patterns against the real allocator (built with
+ * HOST_TEST, like tests/pmm_test.c, but at -O2) on several memory
+ * layouts, and reports per operation:
+ * - mean and worst-case latency of alloc and free, in ns
+ * - allocation failures
+ * and after each workload, with its live set still allocated and again
+ * once everything is freed:
+ * - largest contiguous free run and maximal free blocks per order
+ *
+ * Workloads:
+ * - churn:  fill half of memory with single frames, then free a random
+ *           live frame and allocate a new one, over and over
+ * - burst:  allocate a batch of frames back to back, free it, repeat
+ * - mixed:  short-lived blocks of orders 0-4 (most of the traffic) among
+ *           long-lived ones that pin memory until the end
+ *
+ * Not part of `make test` (it maps whole layouts and takes seconds):
+ * run with `make bench-pmm`. Exits nonzero if memory is lost, i.e. the
+ * free count after a workload differs from the one before it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../include/kernel/pmm.h"
+
+// ========== Layouts ==========
+
+#define MB (1024ULL * 1024)
+
+struct layout {
+    const char *name;
+    struct multiboot_mmap_entry mmap[4];
+    size_t entries;
+};
+
+// PC-style maps: low memory, the VGA/BIOS hole, then extended memory
+#define LOW_MEMORY \
+    { .size = 20, .addr = 0x0, .len = 0xA0000, .type = 1 }, \
+    { .size = 20, .addr = 0xA0000, .len = 0x60000, .type = 2 }
+
+static const struct layout layouts[] = {
+    { "128MB", { LOW_MEMORY, { .size = 20, .addr = MB, .len = 127 * MB, .type = 1 } }, 3 },
+    { "512MB", { LOW_MEMORY, { .size = 20, .addr = MB, .len = 511 * MB, .type = 1 } }, 3 },
+    { "1GB",   { LOW_MEMORY, { .size = 20, .addr = MB, .len = 1023 * MB, .type = 1 } }, 3 },
+    // 4GB machine: the PCI hole takes the top 1GB below 4GB
+    { "4GB",   { LOW_MEMORY, { .size = 20, .addr = MB, .len = 3071 * MB, .type = 1 },
+                 { .size = 20, .addr = 3072 * MB, .len = 1024 * MB, .type = 2 } }, 4 },
+};
+
+#define LAYOUT_COUNT (sizeof(layouts) / sizeof(layouts[0]))
+
+static struct multiboot_info bench_mbi;
+
+// pmm_init() reports the map on stdout: keep the benchmark output readable
+static void quiet_pmm_init(const struct layout *layout) {
+    bench_mbi.flags = MULTIBOOT_FLAG_MMAP;
+    bench_mbi.mmap_addr = (uintptr_t)layout->mmap;
+    bench_mbi.mmap_length = layout->entries * sizeof(layout->mmap[0]);
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved >= 0 && null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+    }
+    pmm_init(MULTIBOOT_MAGIC, &bench_mbi);
+    fflush(stdout);
+    if (saved >= 0 && null_fd >= 0) {
+        dup2(saved, STDOUT_FILENO);
+    }
+    if (null_fd >= 0) {
+        close(null_fd);
+    }
+    if (saved >= 0) {
+        close(saved);
+    }
+}
+
+// ========== Timing ==========
+
+struct op_stats {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t worst_ns;
+    uint64_t failures;
+};
+
+static struct op_stats alloc_stats;
+static struct op_stats free_stats;
+static uint64_t clock_overhead_ns;
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Cheapest back-to-back clock read pair, subtracted from every sample
+static void measure_clock_overhead(void) {
+    clock_overhead_ns = ~0ULL;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t start = now_ns();
+        uint64_t ns = now_ns() - start;
+        if (ns < clock_overhead_ns) {
+            clock_overhead_ns = ns;
+        }
+    }
+}
+
+static inline void record(struct op_stats *stats, uint64_t ns) {
+    ns = ns > clock_overhead_ns ? ns - clock_overhead_ns : 0;
+    stats->count++;
+    stats->total_ns += ns;
+    if (ns > stats->worst_ns) {
+        stats->worst_ns = ns;
+    }
+}
+
+static phys_addr_t timed_alloc(unsigned int order) {
+    uint64_t start = now_ns();
+    phys_addr_t addr = order == 0 ? pmm_alloc_page() : pmm_alloc_pages(order);
+    record(&alloc_stats, now_ns() - start);
+    if (!addr) {
+        alloc_stats.failures++;
+    }
+    return addr;
+}
+
+static void timed_free(phys_addr_t addr, unsigned int order) {
+    uint64_t start = now_ns();
+    if (order == 0) {
+        pmm_free_page(addr);
+    } else {
+        pmm_free_pages(addr, order);
+    }
+    record(&free_stats, now_ns() - start);
+}
+
+// ========== Live set ==========
+
+struct block {
+    phys_addr_t addr;
+    unsigned int order;
+};
+
+// Enough single frames for half of the largest layout
+#define LIVE_MAX (1u << 19)
+
+static struct block live[LIVE_MAX];
+static size_t live_count;
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void) {
+    // xorshift32: reproducible across hosts
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void live_push(phys_addr_t addr, unsigned int order) {
+    if (addr && live_count < LIVE_MAX) {
+        live[live_count].addr = addr;
+        live[live_count].order = order;
+        live_count++;
+    } else if (addr) {
+        pmm_free_pages(addr, order);
+    }
+}
+
+static void live_free_all(void) {
+    while (live_count > 0) {
+        live_count--;
+        timed_free(live[live_count].addr, live[live_count].order);
+    }
+}
+
+// ========== Workloads ==========
+
+static void workload_churn(size_t free_frames) {
+    size_t target = free_frames / 2 < LIVE_MAX ? free_frames / 2 : LIVE_MAX;
+    while (live_count < target) {
+        phys_addr_t addr = timed_alloc(0);
+        if (!addr) {
+            break;
+        }
+        live_push(addr, 0);
+    }
+
+    for (int i = 0; i < 1000000 && live_count > 0; i++) {
+        size_t victim = rng() % live_count;
+        timed_free(live[victim].addr, 0);
+        live[victim].addr = timed_alloc(0);
+        if (!live[victim].addr) {
+            live[victim] = live[--live_count];
+        }
+    }
+}
+
+static void workload_burst(size_t free_frames) {
+    (void)free_frames;
+    for (int round = 0; round < 200; round++) {
+        size_t batch = 1024 + rng() % 4096;
+        for (size_t i = 0; i < batch; i++) {
+            live_push(timed_alloc(0), 0);
+        }
+        // Alternate LIFO and FIFO release
+        if (round & 1) {
+            live_free_all();
+        } else {
+            for (size_t i = 0; i < live_count; i++) {
+                timed_free(live[i].addr, live[i].order);
+            }
+            live_count = 0;
+        }
+    }
+}
+
+static unsigned int mixed_order(void) {
+    uint32_t r = rng() % 100;
+    return r < 85 ? 0 : r < 93 ? 1 : r < 97 ? 2 : r < 99 ? 3 : 4;
+}
+
+#define MIXED_SHORT_SLOTS 512
+
+static void workload_mixed(size_t free_frames) {
+    static struct block short_lived[MIXED_SHORT_SLOTS];
+    memset(short_lived, 0, sizeof(short_lived));
+
+    // Long-lived blocks pin about a quarter of memory by the end
+    size_t long_budget = free_frames / 4;
+    size_t long_frames = 0;
+
+    for (int i = 0; i < 1000000; i++) {
+        unsigned int order = mixed_order();
+        if (rng() % 16 == 0 && long_frames + (1u << order) <= long_budget) {
+            phys_addr_t addr = timed_alloc(order);
+            if (addr) {
+                live_push(addr, order);
+                long_frames += 1u << order;
+            }
+            continue;
+        }
+
+        struct block *slot = &short_lived[rng() % MIXED_SHORT_SLOTS];
+        if (slot->addr) {
+            timed_free(slot->addr, slot->order);
+        }
+        slot->addr = timed_alloc(order);
+        slot->order = order;
+    }
+
+    for (size_t i = 0; i < MIXED_SHORT_SLOTS; i++) {
+        if (short_lived[i].addr) {
+            timed_free(short_lived[i].addr, short_lived[i].order);
+        }
+    }
+}
+
+// ========== Reporting ==========
+
+static void print_fragmentation(const char *when) {
+    struct pmm_stats stats;
+    pmm_drain_local_cache();
+    pmm_get_stats(&stats);
+
+    printf("    %-5s free frames %7zu, largest run %7zu, blocks per order:", when,
+           stats.free_frames, stats.largest_free_run);
+    for (unsigned int order = 0; order <= PMM_MAX_ORDER; order++) {
+        printf(" %zu", stats.free_blocks[order]);
+    }
+    printf("\n");
+}
+
+static void print_ops(const char *name, const struct op_stats *stats) {
+    printf("%s %6.1f ns (worst %7llu ns, %llu ops", name,
+           stats->count ? (double)stats->total_ns / (double)stats->count : 0.0,
+           (unsigned long long)stats->worst_ns, (unsigned long long)stats->count);
+    if (stats->failures) {
+        printf(", %llu failed", (unsigned long long)stats->failures);
+    }
+    printf(")");
+}
+
+struct workload {
+    const char *name;
+    void (*run)(size_t free_frames);
+};
+
+static const struct workload workloads[] = {
+    { "churn", workload_churn },
+    { "burst", workload_burst },
+    { "mixed", workload_mixed },
+};
+
+int main(void) {
+    int lost = 0;
+    measure_clock_overhead();
+    printf("PMM workload benchmark (clock overhead %llu ns, subtracted)\n",
+           (unsigned long long)clock_overhead_ns);
+
+    for (size_t l = 0; l < LAYOUT_COUNT; l++) {
+        for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+            quiet_pmm_init(&layouts[l]);
+            struct pmm_stats before;
+            pmm_get_stats(&before);
+
+            memset(&alloc_stats, 0, sizeof(alloc_stats));
+            memset(&free_stats, 0, sizeof(free_stats));
+            live_count = 0;
+            rng_state = 0x2545F491u;
+
+            printf("\n[%s] %s\n    ", layouts[l].name, workloads[w].name);
+            workloads[w].run(before.free_frames);
+            print_ops("alloc", &alloc_stats);
+            printf("\n    ");
+            print_ops("free ", &free_stats);
+            printf("\n");
+
+            print_fragmentation("live");
+            live_free_all();
+            print_fragmentation("empty");
+
+            struct pmm_stats after;
+            pmm_get_stats(&after);
+            if (after.free_frames != before.free_frames) {
+                printf("    LOST %zd frames\n",
+                       (ssize_t)before.free_frames - (ssize_t)after.free_frames);
+                lost = 1;
+            }
+        }
+    }
+    return lost;
+}
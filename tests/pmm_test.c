@@ -7,35 +7,9 @@
 
 #include "host_test.h"
 
-// Mock multiboot structures for testing
-#define MULTIBOOT_MAGIC 0x2BADB002
-#define MULTIBOOT_FLAG_MMAP (1 << 6)
-
-struct multiboot_mmap_entry {
-    uint32_t size;
-    uint64_t addr;
-    uint64_t len;
-    uint32_t type;
-} __attribute__((packed));
-
-struct multiboot_info {
-    uint32_t flags;
-    uint32_t mem_lower;
-    uint32_t mem_upper;
-    uint32_t boot_device;
-    uint32_t cmdline;
-    uint32_t mods_count;
-    uint32_t mods_addr;
-    uint32_t syms[4];
-    uint32_t mmap_length;
-    // Use uintptr_t for host tests to avoid pointer truncation on 64-bit
-    uintptr_t mmap_addr;
-} __attribute__((packed));
-
-// Forward declare PMM functions (from mm/pmm.c)
-extern void pmm_init(uint32_t multiboot_magic, struct multiboot_info* mbi);
-extern uint64_t pmm_alloc_page(void);
-extern void pmm_free_page(uint64_t page);
+// Real PMM interface (mm/pmm.c is built with -DHOST_TEST)
+#include "../include/kernel/pmm.h"
+#include "../include/kernel/config.h"
 
 // Test memory map (simulates GRUB's memory map)
 static struct multiboot_mmap_entry test_mmap[] = {
@@ -71,7 +45,7 @@ TEST(pmm_frames_are_aligned) {
 
     // Allocate 10 frames and verify alignment
     for (int i = 0; i < 10; i++) {
-        uint64_t addr = pmm_alloc_page();
+        phys_addr_t addr = pmm_alloc_page();
         TEST_ASSERT_NEQ(addr, 0, "allocation should succeed");
         TEST_ASSERT_EQ(addr & 0xFFF, 0, "frame must be 4K-aligned");
         pmm_free_page(addr);
@@ -85,12 +59,12 @@ TEST(pmm_frame_calculation_correct) {
     init_test_mbi();
     pmm_init(MULTIBOOT_MAGIC, &test_mbi);
 
-    uint64_t addr = pmm_alloc_page();
+    phys_addr_t addr = pmm_alloc_page();
     TEST_ASSERT_NEQ(addr, 0, "allocation should succeed");
 
     // Verify: frame_number * 4096 = address
     uint32_t frame_num = addr / 4096;
-    uint64_t reconstructed = (uint64_t)frame_num * 4096;
+    phys_addr_t reconstructed = (phys_addr_t)frame_num * 4096;
     TEST_ASSERT_EQ(addr, reconstructed, "frame*4096 calculation is reversible");
 
     // Specifically test that frame 33 is 0x21000, NOT 0xd34
@@ -109,7 +83,7 @@ TEST(pmm_frames_in_valid_range) {
 
     // Allocate several frames
     for (int i = 0; i < 5; i++) {
-        uint64_t addr = pmm_alloc_page();
+        phys_addr_t addr = pmm_alloc_page();
         TEST_ASSERT_NEQ(addr, 0, "allocation should succeed");
 
         // Should be < 128MB (our test memory map limit)
@@ -130,14 +104,14 @@ TEST(pmm_free_and_realloc) {
     pmm_init(MULTIBOOT_MAGIC, &test_mbi);
 
     // Allocate a frame
-    uint64_t addr1 = pmm_alloc_page();
+    phys_addr_t addr1 = pmm_alloc_page();
     TEST_ASSERT_NEQ(addr1, 0, "first allocation succeeds");
 
     // Free it
     pmm_free_page(addr1);
 
     // Allocate again - should get same frame back (or another valid one)
-    uint64_t addr2 = pmm_alloc_page();
+    phys_addr_t addr2 = pmm_alloc_page();
     TEST_ASSERT_NEQ(addr2, 0, "second allocation succeeds");
     TEST_ASSERT_EQ(addr2 & 0xFFF, 0, "reused frame is still aligned");
 
@@ -147,3 +121,354 @@ TEST(pmm_free_and_realloc) {
     pmm_free_page(addr2);
     return 1;
 }
+
+// Test 6: Magazine hands back the most recently freed frame (LIFO)
+TEST(pmm_magazine_is_lifo) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    phys_addr_t a = pmm_alloc_page();
+    phys_addr_t b = pmm_alloc_page();
+    TEST_ASSERT_NEQ(a, 0, "first allocation succeeds");
+    TEST_ASSERT_NEQ(b, 0, "second allocation succeeds");
+    TEST_ASSERT_NEQ(a, b, "distinct frames");
+
+    pmm_free_page(a);
+    TEST_ASSERT_EQ(pmm_alloc_page(), a, "hot frame is reused first");
+
+    pmm_free_page(a);
+    pmm_free_page(b);
+    return 1;
+}
+
+// Test 7: Free count stays exact across refills and drains
+TEST(pmm_magazine_accounting) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    struct pmm_stats before;
+    pmm_get_stats(&before);
+
+    // Enough to force several refills, then several drains
+    enum { N = PMM_MAGAZINE_SIZE * 3 + 5 };
+    static phys_addr_t frames[N];
+    for (int i = 0; i < N; i++) {
+        frames[i] = pmm_alloc_page();
+        TEST_ASSERT_NEQ(frames[i], 0, "allocation succeeds");
+        for (int j = 0; j < i; j++) {
+            TEST_ASSERT_NEQ(frames[i], frames[j], "no frame handed out twice");
+        }
+    }
+
+    struct pmm_stats mid;
+    pmm_get_stats(&mid);
+    TEST_ASSERT_EQ(mid.free_frames, before.free_frames - N, "free count drops by N");
+    TEST_ASSERT(mid.cached_frames <= PMM_MAGAZINE_SIZE, "magazine never exceeds its size");
+
+    for (int i = 0; i < N; i++) {
+        pmm_free_page(frames[i]);
+    }
+
+    struct pmm_stats after;
+    pmm_get_stats(&after);
+    TEST_ASSERT_EQ(after.free_frames, before.free_frames, "all frames returned");
+    TEST_ASSERT(after.cached_frames <= PMM_MAGAZINE_SIZE, "magazine never exceeds its size");
+
+    pmm_drain_local_cache();
+    pmm_get_stats(&after);
+    TEST_ASSERT_EQ(after.cached_frames, 0, "drain empties the magazine");
+    TEST_ASSERT_EQ(after.free_frames, before.free_frames, "drain keeps free count");
+    return 1;
+}
+
+// Test 8: Every free frame can be allocated exactly once, then reused
+TEST(pmm_exhaust_and_recover) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    struct pmm_stats before;
+    pmm_get_stats(&before);
+
+    static phys_addr_t frames[0x8000];
+    size_t n = 0;
+    phys_addr_t addr;
+    while ((addr = pmm_alloc_page()) != 0) {
+        TEST_ASSERT(n < 0x8000, "no more frames than the memory map holds");
+        frames[n++] = addr;
+    }
+    TEST_ASSERT_EQ(n, before.free_frames, "all free frames were found");
+
+    // Free a frame deep in memory; the index must find it again
+    pmm_free_page(frames[n / 2]);
+    TEST_ASSERT_EQ(pmm_alloc_page(), frames[n / 2], "freed frame is found again");
+
+    for (size_t i = 0; i < n; i++) {
+        pmm_free_page(frames[i]);
+    }
+
+    struct pmm_stats after;
+    pmm_get_stats(&after);
+    TEST_ASSERT_EQ(after.free_frames, before.free_frames, "all frames returned");
+    return 1;
+}
+
+// Test 9: Allocation prefers low memory after frees behind the cursor
+TEST(pmm_cursor_follows_frees) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    enum { N = PMM_MAGAZINE_SIZE * 4 };
+    static phys_addr_t frames[N];
+    for (int i = 0; i < N; i++) {
+        frames[i] = pmm_alloc_page();
+        TEST_ASSERT_NEQ(frames[i], 0, "allocation succeeds");
+    }
+
+    phys_addr_t lowest = frames[0];
+    for (int i = 0; i < N; i++) {
+        if (frames[i] < lowest) {
+            lowest = frames[i];
+        }
+        pmm_free_page(frames[i]);
+    }
+
+    pmm_drain_local_cache();
+    TEST_ASSERT_EQ(pmm_alloc_page(), lowest, "lowest free frame comes back first");
+    return 1;
+}
+
+// Sum of frames covered by the per-order free block counts
+static size_t block_frames(const struct pmm_stats *st) {
+    size_t frames = 0;
+    for (unsigned int order = 0; order <= PMM_MAX_ORDER; order++) {
+        frames += st->free_blocks[order] << order;
+    }
+    return frames;
+}
+
+// Test 10: Multi-page blocks are aligned, disjoint and accounted
+TEST(pmm_alloc_pages_aligned) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    struct pmm_stats before;
+    pmm_get_stats(&before);
+
+    phys_addr_t blocks[PMM_MAX_ORDER + 1];
+    for (unsigned int order = 0; order <= PMM_MAX_ORDER; order++) {
+        blocks[order] = pmm_alloc_pages(order);
+        TEST_ASSERT_NEQ(blocks[order], 0, "block allocation succeeds");
+        TEST_ASSERT_EQ(blocks[order] & ((4096UL << order) - 1), 0,
+                       "block is naturally aligned");
+        for (unsigned int j = 0; j < order; j++) {
+            phys_addr_t lo = blocks[order], hi = lo + (4096UL << order);
+            TEST_ASSERT(blocks[j] < lo || blocks[j] >= hi, "blocks are disjoint");
+        }
+    }
+
+    for (unsigned int order = 0; order <= PMM_MAX_ORDER; order++) {
+        pmm_free_pages(blocks[order], order);
+    }
+
+    struct pmm_stats after;
+    pmm_get_stats(&after);
+    TEST_ASSERT_EQ(after.free_frames, before.free_frames, "all blocks returned");
+    return 1;
+}
+
+// Test 11: Freed buddies coalesce back into large blocks
+TEST(pmm_buddies_coalesce) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+    pmm_drain_local_cache();
+
+    struct pmm_stats before;
+    pmm_get_stats(&before);
+    TEST_ASSERT_EQ(block_frames(&before), before.free_frames - before.cached_frames,
+                   "block counts cover every free frame");
+
+    // Split a max-order block into single pages, then give them all back
+    enum { N = 1 << PMM_MAX_ORDER };
+    static phys_addr_t pages[N];
+    for (int i = 0; i < N; i++) {
+        pages[i] = pmm_alloc_pages(0);
+        TEST_ASSERT_NEQ(pages[i], 0, "page allocation succeeds");
+    }
+    for (int i = 0; i < N; i++) {
+        pmm_free_pages(pages[i], 0);
+    }
+    pmm_drain_local_cache();
+
+    struct pmm_stats after;
+    pmm_get_stats(&after);
+    TEST_ASSERT_EQ(after.free_frames, before.free_frames, "all pages returned");
+    TEST_ASSERT_EQ(after.free_blocks[PMM_MAX_ORDER], before.free_blocks[PMM_MAX_ORDER],
+                   "max-order blocks are whole again");
+    TEST_ASSERT_EQ(block_frames(&after), after.free_frames, "block counts still exact");
+    return 1;
+}
+
+// Test 12: Bad block frees are rejected
+TEST(pmm_free_pages_rejects_bad_blocks) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    phys_addr_t block = pmm_alloc_pages(2);
+    TEST_ASSERT_NEQ(block, 0, "block allocation succeeds");
+
+    struct pmm_stats s1, s2;
+    pmm_get_stats(&s1);
+    pmm_free_pages(block + 4096, 2);    // Misaligned for order 2
+    pmm_get_stats(&s2);
+    TEST_ASSERT_EQ(s2.free_frames, s1.free_frames, "misaligned free ignored");
+
+    pmm_free_pages(block, 2);
+    pmm_free_pages(block, 2);           // Double free
+    pmm_get_stats(&s2);
+    TEST_ASSERT_EQ(s2.free_frames, s1.free_frames + 4, "double free ignored");
+    return 1;
+}
+
+// Test 13: Reserving an unaligned range moves exactly its free frames
+TEST(pmm_reserve_range_accounting) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    struct pmm_stats before, after;
+    pmm_get_stats(&before);
+
+    // 70 frames starting mid-word, ending mid-word, well above the kernel
+    pmm_reserve_region(0x4003000, 70 * 4096);
+    pmm_get_stats(&after);
+    TEST_ASSERT_EQ(after.free_frames, before.free_frames - 70, "70 frames left the free pool");
+    TEST_ASSERT_EQ(after.reserved_frames, before.reserved_frames + 70, "70 frames reserved");
+
+    // Reserving the same range again changes nothing
+    pmm_reserve_region(0x4003000, 70 * 4096);
+    pmm_get_stats(&before);
+    TEST_ASSERT_EQ(before.free_frames, after.free_frames, "re-reserve is a no-op");
+
+    // No frame in the range is ever handed out
+    pmm_drain_local_cache();
+    phys_addr_t addr;
+    while ((addr = pmm_alloc_page()) != 0) {
+        TEST_ASSERT(addr < 0x4003000 || addr >= 0x4003000 + 70 * 4096,
+                    "reserved frame never allocated");
+    }
+    return 1;
+}
+
+// Test 14: Overlapping memory map entries are not double counted
+TEST(pmm_overlapping_mmap_entries) {
+    static struct multiboot_mmap_entry overlap_mmap[] = {
+        { .size = 20, .addr = 0x100000, .len = 0x1000000, .type = 1 },
+        { .size = 20, .addr = 0x800000, .len = 0x1000000, .type = 1 },
+    };
+    static struct multiboot_info mbi;
+    mbi.flags = MULTIBOOT_FLAG_MMAP;
+    mbi.mmap_addr = (uintptr_t)overlap_mmap;
+    mbi.mmap_length = sizeof(overlap_mmap);
+
+    pmm_init(MULTIBOOT_MAGIC, &mbi);
+
+    struct pmm_stats st;
+    pmm_get_stats(&st);
+    // 1MB..24MB is 23MB = 5888 unique frames
+    TEST_ASSERT_EQ(st.total_frames, 5888, "union of entries counted once");
+    TEST_ASSERT_EQ(st.free_frames + st.reserved_frames, st.total_frames,
+                   "free + reserved covers the map");
+    return 1;
+}
+
+// Test 15: Zero pool fills in the background and serves zeroed allocations
+TEST(pmm_zero_pool) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    struct pmm_stats before, st;
+    pmm_get_stats(&before);
+    TEST_ASSERT_EQ(before.zeroed_frames, 0, "pool starts empty");
+
+    // Synchronous fallback while the pool is empty
+    phys_addr_t sync = pmm_alloc_zeroed_page();
+    TEST_ASSERT_NEQ(sync, 0, "fallback allocation succeeds");
+    pmm_free_page(sync);
+
+    TEST_ASSERT_EQ(pmm_zero_pool_refill(4), 4, "refill honours its budget");
+    TEST_ASSERT_EQ(pmm_zero_pool_refill(1000), PMM_ZERO_POOL_SIZE - 4, "refill stops when full");
+    TEST_ASSERT_EQ(pmm_zero_pool_refill(1), 0, "full pool takes no more");
+
+    pmm_get_stats(&st);
+    TEST_ASSERT_EQ(st.zeroed_frames, PMM_ZERO_POOL_SIZE, "pool is full");
+    TEST_ASSERT_EQ(st.free_frames, before.free_frames, "pooled frames still count as free");
+
+    phys_addr_t z = pmm_alloc_zeroed_page();
+    TEST_ASSERT_NEQ(z, 0, "pooled allocation succeeds");
+    pmm_get_stats(&st);
+    TEST_ASSERT_EQ(st.zeroed_frames, PMM_ZERO_POOL_SIZE - 1, "allocation came from the pool");
+    TEST_ASSERT_EQ(st.free_frames, before.free_frames - 1, "free count drops by one");
+
+    pmm_free_page(z);
+    return 1;
+}
+
+// Test 16: Frame descriptors track shared references
+TEST(pmm_page_refcounts) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    TEST_ASSERT(pmm_metadata_end() > 0x200000, "descriptors placed after the kernel");
+    TEST_ASSERT_NOT_NULL(pmm_page(0), "low frames have descriptors");
+    TEST_ASSERT(pmm_page(0)->flags & PAGE_FLAG_RESERVED, "NULL page marked reserved");
+    TEST_ASSERT_NULL(pmm_page(0xFFFFF000u), "unmanaged frame has none");
+
+    struct pmm_stats before, st;
+    pmm_get_stats(&before);
+
+    phys_addr_t a = pmm_alloc_page();
+    TEST_ASSERT_EQ(pmm_page(a)->refcount, 1, "fresh frame has one reference");
+    TEST_ASSERT_EQ(pmm_page_get(a), 2, "second holder");
+
+    pmm_free_page(a);
+    pmm_get_stats(&st);
+    TEST_ASSERT_EQ(st.free_frames, before.free_frames - 1, "shared frame not freed");
+
+    TEST_ASSERT_EQ(pmm_page_put(a), 1, "one holder left");
+    TEST_ASSERT_EQ(pmm_page_put(a), 0, "last put frees");
+    pmm_get_stats(&st);
+    TEST_ASSERT_EQ(st.free_frames, before.free_frames, "frame returned");
+    TEST_ASSERT_EQ(pmm_page_put(a), -EINVAL, "put on free frame rejected");
+    TEST_ASSERT_EQ(pmm_page_get(a), -EINVAL, "get on free frame rejected");
+
+    // Blocks are referenced through their first frame
+    phys_addr_t blk = pmm_alloc_pages(2);
+    TEST_ASSERT_NEQ(blk, 0, "block allocation succeeds");
+    TEST_ASSERT_EQ(pmm_page(blk)->order, 2, "head records order");
+    TEST_ASSERT_EQ(pmm_page_get(blk + 4096), -EINVAL, "tail frames carry no count");
+    TEST_ASSERT_EQ(pmm_page_get(blk), 2, "block shared");
+    TEST_ASSERT_EQ(pmm_page_put(blk), 1, "still shared");
+    TEST_ASSERT_EQ(pmm_page_put(blk), 0, "last put frees the block");
+    pmm_get_stats(&st);
+    TEST_ASSERT_EQ(st.free_frames, before.free_frames, "whole block returned");
+
+    return 1;
+}
+
+// Test 17: Double free of a cached frame is rejected (paranoid builds only)
+#if CONFIG_ENABLE_PARANOID_CHECKS
+TEST(pmm_magazine_double_free_rejected) {
+    init_test_mbi();
+    pmm_init(MULTIBOOT_MAGIC, &test_mbi);
+
+    phys_addr_t a = pmm_alloc_page();
+    TEST_ASSERT_NEQ(a, 0, "allocation succeeds");
+
+    struct pmm_stats s1, s2;
+    pmm_free_page(a);
+    pmm_get_stats(&s1);
+    pmm_free_page(a);
+    pmm_get_stats(&s2);
+    TEST_ASSERT_EQ(s2.free_frames, s1.free_frames, "second free ignored");
+    return 1;
+}
+#endif
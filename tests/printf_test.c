@@ -0,0 +1,97 @@
+/**
+ * Host-side unit tests for bounded formatting (lib/printf.c)
+ *
+ * Validates:
+ * - Every conversion kprintf() relies on, with width and zero padding
+ * - Truncation: always terminated, return value is the full length
+ * - Flushing sinks see all output, in order, in buffer-sized pieces
+ */
+
+#include "host_test.h"
+#include <string.h>
+#include "../include/lib/printf.h"
+
+// No format attribute: lets the tests pass what the compiler would flag
+static int unchecked(char* buf, size_t size, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = kvsnprintf(buf, size, format, args);
+    va_end(args);
+    return n;
+}
+
+TEST(ksnprintf_conversions) {
+    char buf[128];
+
+    int n = ksnprintf(buf, sizeof(buf), "%d %i %u %x %c %s %%", -42, 7, 4096u, 0xbeefu, 'z', "ok");
+    TEST_ASSERT(strcmp(buf, "-42 7 4096 beef z ok %") == 0, "basic conversions");
+    TEST_ASSERT_EQ(n, (int)strlen(buf), "length returned");
+
+    ksnprintf(buf, sizeof(buf), "[%08x] [%03d] [%p]", 0x1234u, 5, (void*)0x10);
+    TEST_ASSERT(strcmp(buf, "[00001234] [005] [0x00000010]") == 0, "zero padding");
+
+    ksnprintf(buf, sizeof(buf), "%llu %lld %llx", 10000000000ull, -5ll, 0x123456789ull);
+    TEST_ASSERT(strcmp(buf, "10000000000 -5 123456789") == 0, "64-bit conversions");
+
+    unchecked(buf, sizeof(buf), "%s|%u|", (const char*)NULL, 0u);
+    TEST_ASSERT(strcmp(buf, "(null)|0|") == 0, "NULL string and zero");
+
+    unchecked(buf, sizeof(buf), "100%");
+    TEST_ASSERT(strcmp(buf, "100%") == 0, "trailing percent stops cleanly");
+
+    return 1;
+}
+
+TEST(ksnprintf_truncation) {
+    char buf[8];
+    memset(buf, 'X', sizeof(buf));
+
+    int n = ksnprintf(buf, sizeof(buf), "abcdefghij%u", 123u);
+    TEST_ASSERT_EQ(n, 13, "returns the untruncated length");
+    TEST_ASSERT(strcmp(buf, "abcdefg") == 0, "truncated and terminated");
+
+    n = ksnprintf(buf, 1, "abc");
+    TEST_ASSERT_EQ(n, 3, "size 1 still counts");
+    TEST_ASSERT_EQ(buf[0], '\0', "size 1 gives an empty string");
+
+    n = ksnprintf(NULL, 0, "%d", 12345);
+    TEST_ASSERT_EQ(n, 5, "size 0 only measures");
+
+    return 1;
+}
+
+static char flushed[256];
+static size_t flushed_len;
+static int flush_calls;
+
+static void collect(struct kfmt_sink* sink) {
+    memcpy(flushed + flushed_len, sink->buf, sink->len);
+    flushed_len += sink->len;
+    flush_calls++;
+    sink->len = 0;
+}
+
+static int format_into(struct kfmt_sink* sink, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = kvformat(sink, format, args);
+    va_end(args);
+    return n;
+}
+
+TEST(kvformat_flushing_sink) {
+    char buf[4];
+    struct kfmt_sink sink = { .buf = buf, .size = sizeof(buf), .flush = collect };
+    flushed_len = 0;
+    flush_calls = 0;
+
+    int n = format_into(&sink, "value=%u name=%s", 31337u, "klog");
+    collect(&sink);
+    flushed[flushed_len] = '\0';
+
+    TEST_ASSERT_EQ(n, 21, "every character counted");
+    TEST_ASSERT(strcmp(flushed, "value=31337 name=klog") == 0, "output intact and in order");
+    TEST_ASSERT_EQ(flush_calls, 6, "flushed once per full buffer, plus the tail");
+
+    return 1;
+}
@@ -0,0 +1,803 @@
+/**
+ * Host-side discrete-event simulator for the scheduler (core/scheduler.c)
+ *
+ * Runs the real scheduler, compiled with HOST_TEST, on simulated CPUs.
+ * This file supplies its environment: a HAL whose cpu_id() is the CPU
+ * the simulator is currently acting for, a context_switch() that returns
+ * at once (the caller immediately continues as the CPU's new current
+ * task), periodic 1 kHz ticks, reschedule IPIs delivered after
+ * SIM_IPI_NS, and a 1 GHz TSC that reads simulated time.
+ *
+ * Each synthetic task alternates CPU bursts and sleeps. The events are:
+ * - tick:      scheduler_tick() on one CPU, schedule() if it asks
+ * - burst end: the running task blocks and schedule() picks the next
+ * - wakeup:    from a random CPU's interrupt, scheduler_enqueue()
+ * - IPI:       the reschedule handler, then schedule() if it asks
+ *
+ * Workloads (N tasks, offered load SIM_LOAD of every CPU):
+ * - uniform:  every task at SCHED_DEFAULT_PRIORITY, 200 us bursts
+ * - skewed:   10% interactive tasks (priority 200+, 20 us bursts) over
+ *             batch tasks on a Zipf-like spread of 32 low priorities
+ * - wide:     priorities spread over all 255 non-idle levels
+ *
+ * Reported per run: completed bursts per simulated second, utilization,
+ * switches, steals and IPIs, wakeup-to-dispatch latency (percentiles per
+ * class and a log2 histogram), and the host time spent in enqueue,
+ * schedule() and the tick, which is where scaling regressions show.
+ *
+ * Deadline tasks are not simulated (ktimer is stubbed out).
+ *
+ * Not part of `make test`: run with `make sim-sched`. Exits nonzero if an
+ * invariant breaks: a CPU running something while a higher priority is
+ * queued locally, going idle with work queued, losing a task, or (in the
+ * uniform workload, where round-robin must serve everyone) leaving a
+ * woken task waiting for more than SIM_STARVE_NS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/kernel/scheduler.h"
+#include "../include/kernel/ktimer.h"
+#include "../include/kernel/vdso.h"
+#include "../include/kernel/mmu.h"
+#include "../include/kernel/smp.h"
+
+#define SIM_TICK_NS     1000000ULL          // 1 kHz periodic tick
+#define SIM_IPI_NS      1000ULL             // Reschedule IPI delivery
+#define SIM_DURATION_NS 2000000000ULL       // Simulated time per run
+#define SIM_STARVE_NS   1000000000ULL       // Woken but never run: failure
+#define SIM_LOAD        0.9                 // Offered load per CPU
+#define SIM_IDLE_ID     0x80000000u         // Idle task IDs: | cpu
+
+// ========== Simulated machine ==========
+
+struct sim_task {
+    task_t   task;              // First: the scheduler hands back task_t*
+    uint64_t burst_mean_ns;
+    uint64_t sleep_mean_ns;
+    uint64_t remaining_ns;      // Rest of the current burst
+    uint64_t dispatched_ns;     // Last put on a CPU
+    uint64_t woken_ns;          // Woken, not dispatched yet (0 = no)
+    uint32_t gen;               // Bumped when switched away (stale burst ends)
+    bool     interactive;
+};
+
+static uint64_t sim_now_ns;
+static uint32_t sim_cpu;
+static uint32_t sim_ncpus;
+
+static struct sim_task* sim_tasks;
+static uint32_t sim_ntasks;
+static task_t idle_tasks[MAX_CPUS];
+
+static void (*resched_ipi)(void);
+static bool ipi_pending[MAX_CPUS];
+
+static uint64_t run_start_ns[MAX_CPUS];    // Current task put on the CPU
+static uint64_t busy_ns[MAX_CPUS];        // Time not spent idle
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    // xorshift32: reproducible across hosts
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Uniform in [1, 2 * mean]: mean `mean`, no libm
+static uint64_t rng_around(uint64_t mean) {
+    return 1 + (uint64_t)((double)rng() * (2.0 * (double)mean) / 4294967296.0);
+}
+
+static struct sim_task* sim_of(task_t* task) {
+    struct sim_task* st = (struct sim_task*)task;
+    return st >= sim_tasks && st < sim_tasks + sim_ntasks ? st : NULL;
+}
+
+// ========== Kernel environment ==========
+
+static uint32_t sim_hal_cpu_id(void) {
+    return sim_cpu;
+}
+
+// One host thread: interrupts are whatever the event loop says they are
+static uint32_t sim_hal_irq_disable(void) {
+    return 0;
+}
+
+static void sim_hal_irq_restore(uint32_t state) {
+    (void)state;
+}
+
+static int sim_hal_irq_register(uint8_t vector, void (*handler)(void)) {
+    if (vector == SMP_IPI_RESCHEDULE) {
+        resched_ipi = handler;
+    }
+    return 0;
+}
+
+static uint32_t sim_hal_smp_num_cpus(void) {
+    return sim_ncpus;
+}
+
+static struct hal_ops sim_hal = {
+    .cpu_id = sim_hal_cpu_id,
+    .irq_disable = sim_hal_irq_disable,
+    .irq_restore = sim_hal_irq_restore,
+    .irq_register = sim_hal_irq_register,
+    .smp_num_cpus = sim_hal_smp_num_cpus,
+};
+
+struct hal_ops* hal = &sim_hal;
+static struct per_cpu_data sim_areas[MAX_CPUS];
+struct per_cpu_data* per_cpu[MAX_CPUS];
+struct vdso_data* vdso_data_page;
+volatile uint32_t log_enabled_mask;     // Quiet
+volatile uint32_t trace_enabled_mask;
+
+// The caller continues as the CPU's new current task
+uint32_t context_switch(cpu_context_t* old_ctx, cpu_context_t* new_ctx) {
+    (void)old_ctx;
+    (void)new_ctx;
+    return 1;
+}
+
+void gdt_set_kernel_stack(uintptr_t esp0) {
+    (void)esp0;
+}
+
+void fpu_switch(struct task* next) {
+    (void)next;
+}
+
+page_table_t* mmu_get_kernel_address_space(void) {
+    return NULL;
+}
+
+void mmu_switch_address_space(page_table_t* pt) {
+    (void)pt;
+}
+
+void pmu_sync(void) {
+}
+
+void rcu_tick(void) {
+}
+
+void trace_event(enum trace_event_type type, uint64_t d0, uint64_t d1,
+                 uint64_t d2, uint64_t d3) {
+    (void)type;
+    (void)d0;
+    (void)d1;
+    (void)d2;
+    (void)d3;
+}
+
+int kprintf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int ret = vprintf(format, args);
+    va_end(args);
+    return ret;
+}
+
+void* kzalloc(size_t size) {
+    return calloc(1, size);
+}
+
+// Run queue blocks (scheduler_init_cpu())
+phys_addr_t pmm_alloc_pages(unsigned int order) {
+    return (phys_addr_t)calloc(1, (size_t)PAGE_SIZE << order);
+}
+
+void pmm_free_pages(phys_addr_t addr, unsigned int order) {
+    (void)order;
+    free((void*)addr);
+}
+
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+task_t* task_create_idle(uint32_t cpu_id) {
+    task_t* idle = &idle_tasks[cpu_id];
+    memset(idle, 0, sizeof(*idle));
+    strlcpy(idle->name, "idle", sizeof(idle->name));
+    idle->task_id = SIM_IDLE_ID | cpu_id;
+    idle->state = TASK_STATE_READY;
+    idle->priority = SCHED_IDLE_PRIORITY;
+    idle->base_priority = SCHED_IDLE_PRIORITY;
+    idle->cpu = cpu_id;
+    per_cpu[cpu_id]->idle_task = idle;
+    return idle;
+}
+
+void task_queue_zombie(task_t* task) {
+    (void)task;     // Simulated tasks never exit
+}
+
+void ktimer_init(struct ktimer* timer, ktimer_fn fn, void* arg) {
+    (void)timer;
+    (void)fn;
+    (void)arg;
+}
+
+int ktimer_add(struct ktimer* timer, uint64_t delay_us) {
+    (void)timer;
+    (void)delay_us;
+    return 0;
+}
+
+bool ktimer_cancel_sync(struct ktimer* timer) {
+    (void)timer;
+    return false;
+}
+
+uint64_t timer_read_tsc(void) {
+    return sim_now_ns;      // 1 GHz
+}
+
+uint64_t timer_read_us(void) {
+    return sim_now_ns / 1000;
+}
+
+uint32_t timer_get_frequency(void) {
+    return (uint32_t)(1000000000ULL / SIM_TICK_NS);
+}
+
+uint64_t timer_get_tsc_freq(void) {
+    return 1000000000ULL;
+}
+
+bool timer_is_tickless(void) {
+    return false;
+}
+
+void timer_event_update(uint64_t deadline_us) {
+    (void)deadline_us;
+}
+
+// ========== Events ==========
+
+enum sim_event_type {
+    EV_TICK,
+    EV_BURST_END,
+    EV_WAKE,
+    EV_IPI,
+};
+
+struct sim_event {
+    uint64_t time;
+    uint64_t seq;               // FIFO among equal times: deterministic
+    enum sim_event_type type;
+    uint32_t cpu;
+    uint32_t gen;
+    struct sim_task* task;
+};
+
+static struct sim_event* events;
+static size_t nr_events;
+static size_t max_events;
+static uint64_t event_seq;
+
+static bool event_before(const struct sim_event* a, const struct sim_event* b) {
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static void event_push(uint64_t time, enum sim_event_type type, uint32_t cpu,
+                       struct sim_task* task, uint32_t gen) {
+    if (nr_events == max_events) {
+        max_events = max_events ? max_events * 2 : 1024;
+        events = realloc(events, max_events * sizeof(*events));
+        if (!events) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+
+    size_t i = nr_events++;
+    struct sim_event ev = { time, event_seq++, type, cpu, gen, task };
+    while (i > 0 && event_before(&ev, &events[(i - 1) / 2])) {
+        events[i] = events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    events[i] = ev;
+}
+
+static struct sim_event event_pop(void) {
+    struct sim_event top = events[0];
+    struct sim_event last = events[--nr_events];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= nr_events) {
+            break;
+        }
+        if (child + 1 < nr_events && event_before(&events[child + 1], &events[child])) {
+            child++;
+        }
+        if (!event_before(&events[child], &last)) {
+            break;
+        }
+        events[i] = events[child];
+        i = child;
+    }
+    if (nr_events > 0) {
+        events[i] = last;
+    }
+    return top;
+}
+
+void smp_send_reschedule(uint32_t cpu_id) {
+    if (cpu_id < sim_ncpus && !ipi_pending[cpu_id]) {
+        ipi_pending[cpu_id] = true;
+        event_push(sim_now_ns + SIM_IPI_NS, EV_IPI, cpu_id, NULL, 0);
+    }
+}
+
+// Simulated idle CPUs sleep in HLT: every wakeup is an IPI
+void idle_wake_cpu(uint32_t cpu_id) {
+    smp_send_reschedule(cpu_id);
+}
+
+void idle_exit(void) {
+}
+
+// ========== Measurements ==========
+
+struct op_stats {
+    uint64_t count;
+    uint64_t total_ns;
+};
+
+struct latency_log {
+    uint64_t* samples;
+    size_t count;
+    size_t capacity;
+};
+
+#define HIST_BUCKETS 24     // log2 of us: [2^i, 2^(i+1)), bucket 0 from 0
+
+static struct op_stats enqueue_stats, schedule_stats, tick_stats;
+static uint64_t clock_overhead_ns;
+static struct latency_log latency[2];      // [interactive]
+static uint64_t latency_hist[HIST_BUCKETS];
+static uint64_t bursts_done;
+static uint64_t violations;
+
+static inline uint64_t host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Cheapest back-to-back clock read pair, subtracted from every sample
+static void measure_clock_overhead(void) {
+    clock_overhead_ns = ~0ULL;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t start = host_ns();
+        uint64_t ns = host_ns() - start;
+        if (ns < clock_overhead_ns) {
+            clock_overhead_ns = ns;
+        }
+    }
+}
+
+static inline void record(struct op_stats* stats, uint64_t start) {
+    uint64_t ns = host_ns() - start;
+    stats->count++;
+    stats->total_ns += ns > clock_overhead_ns ? ns - clock_overhead_ns : 0;
+}
+
+static void latency_add(struct sim_task* st, uint64_t ns) {
+    struct latency_log* log = &latency[st->interactive];
+    if (log->count == log->capacity) {
+        log->capacity = log->capacity ? log->capacity * 2 : 4096;
+        log->samples = realloc(log->samples, log->capacity * sizeof(*log->samples));
+        if (!log->samples) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+    log->samples[log->count++] = ns;
+
+    uint64_t us = ns / 1000;
+    uint32_t bucket = us ? 63 - (uint32_t)__builtin_clzll(us) : 0;
+    latency_hist[bucket < HIST_BUCKETS ? bucket : HIST_BUCKETS - 1]++;
+}
+
+static void violation(const char* what, uint32_t cpu) {
+    if (violations++ < 10) {
+        printf("    VIOLATION at %llu ns on CPU %u: %s\n",
+               (unsigned long long)sim_now_ns, (unsigned int)cpu, what);
+    }
+}
+
+// Highest priority queued on `rq`, -1 for none
+static int highest_queued(const scheduler_t* rq) {
+    for (int word = 7; word >= 0; word--) {
+        if (rq->priority_bitmap[word]) {
+            return word * 32 + 31 - __builtin_clz(rq->priority_bitmap[word]);
+        }
+    }
+    return -1;
+}
+
+// ========== Event handlers ==========
+
+/**
+ * schedule() on `cpu`, then follow the switch: the outgoing task's burst
+ * stops, the incoming one's resumes (and its wakeup latency ends)
+ */
+static void sim_resched(uint32_t cpu) {
+    struct per_cpu_data* pcpu = per_cpu[cpu];
+    task_t* prev = pcpu->current_task;
+
+    sim_cpu = cpu;
+    uint64_t start = host_ns();
+    schedule();
+    record(&schedule_stats, start);
+
+    task_t* next = pcpu->current_task;
+    if (next->state != TASK_STATE_RUNNING) {
+        violation("picked a task that is not RUNNING", cpu);
+    }
+    if (next == pcpu->idle_task && pcpu->sched->nr_ready > 0) {
+        violation("idle with tasks queued", cpu);
+    }
+    if (next != pcpu->idle_task && highest_queued(pcpu->sched) > next->priority) {
+        violation("higher priority queued than running", cpu);
+    }
+    if (prev == next) {
+        return;
+    }
+
+    if (prev != pcpu->idle_task) {
+        busy_ns[cpu] += sim_now_ns - run_start_ns[cpu];
+    }
+    run_start_ns[cpu] = sim_now_ns;
+
+    struct sim_task* st = sim_of(prev);
+    if (st) {
+        uint64_t ran = sim_now_ns - st->dispatched_ns;
+        st->remaining_ns = st->remaining_ns > ran ? st->remaining_ns - ran : 0;
+        st->gen++;
+    }
+
+    st = sim_of(next);
+    if (st) {
+        st->dispatched_ns = sim_now_ns;
+        if (st->woken_ns) {
+            latency_add(st, sim_now_ns - st->woken_ns);
+            st->woken_ns = 0;
+        }
+        event_push(sim_now_ns + st->remaining_ns, EV_BURST_END, cpu, st, st->gen);
+    }
+}
+
+static void sim_resched_if_needed(uint32_t cpu) {
+    if (per_cpu[cpu]->sched->need_resched) {
+        sim_resched(cpu);
+    }
+}
+
+static void on_tick(uint32_t cpu) {
+    sim_cpu = cpu;
+    per_cpu[cpu]->ticks++;
+    uint64_t start = host_ns();
+    bool preempt = scheduler_tick();
+    record(&tick_stats, start);
+    if (preempt) {
+        sim_resched(cpu);
+    } else {
+        sim_resched_if_needed(cpu);
+    }
+    event_push(sim_now_ns + SIM_TICK_NS, EV_TICK, cpu, NULL, 0);
+}
+
+static void on_burst_end(const struct sim_event* ev) {
+    struct sim_task* st = ev->task;
+    if (st->gen != ev->gen || per_cpu[ev->cpu]->current_task != &st->task) {
+        return;     // Preempted before the burst was over
+    }
+
+    bursts_done++;
+    st->task.state = TASK_STATE_BLOCKED;
+    st->remaining_ns = 0;
+    sim_resched(ev->cpu);
+
+    st->remaining_ns = rng_around(st->burst_mean_ns);
+    event_push(sim_now_ns + rng_around(st->sleep_mean_ns), EV_WAKE, 0, st, 0);
+}
+
+static void on_wake(struct sim_task* st) {
+    uint32_t waker = rng() % sim_ncpus;
+    sim_cpu = waker;
+    st->woken_ns = sim_now_ns;
+    st->task.state = TASK_STATE_READY;
+
+    uint64_t start = host_ns();
+    scheduler_enqueue(&st->task);
+    record(&enqueue_stats, start);
+
+    // Interrupt exit on the waker
+    sim_resched_if_needed(waker);
+}
+
+static void on_ipi(uint32_t cpu) {
+    ipi_pending[cpu] = false;
+    sim_cpu = cpu;
+    resched_ipi();
+    sim_resched_if_needed(cpu);
+}
+
+// ========== Workloads ==========
+
+struct workload {
+    const char* name;
+    void (*setup)(struct sim_task* st, uint32_t index);
+    bool round_robin;       // One priority: nobody may starve
+};
+
+static void setup_uniform(struct sim_task* st, uint32_t index) {
+    (void)index;
+    st->task.priority = SCHED_DEFAULT_PRIORITY;
+    st->burst_mean_ns = 200000;
+}
+
+static void setup_skewed(struct sim_task* st, uint32_t index) {
+    if (index % 10 == 0) {
+        st->interactive = true;
+        st->task.priority = (uint8_t)(200 + rng() % 8);
+        st->burst_mean_ns = 20000;
+        return;
+    }
+    // P(level k) ~ 1 / (k + 1) over 32 levels
+    uint32_t r = rng() % 4058;     // Sum of 1000 / (k + 1), k < 32
+    uint32_t level = 0;
+    while (level < 31 && r >= 1000 / (level + 1)) {
+        r -= 1000 / (level + 1);
+        level++;
+    }
+    st->task.priority = (uint8_t)(10 + level);
+    st->burst_mean_ns = 500000;
+}
+
+static void setup_wide(struct sim_task* st, uint32_t index) {
+    (void)index;
+    st->task.priority = (uint8_t)(1 + rng() % 255);
+    st->interactive = st->task.priority >= 192;
+    st->burst_mean_ns = 100000;
+}
+
+static const struct workload workloads[] = {
+    { "uniform", setup_uniform, true },
+    { "skewed", setup_skewed, false },
+    { "wide", setup_wide, false },
+};
+
+static void sim_reset(uint32_t ncpus) {
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        free(sim_areas[cpu].sched);
+    }
+    memset(sim_areas, 0, sizeof(sim_areas));
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        per_cpu[cpu] = &sim_areas[cpu];
+    }
+    memset(ipi_pending, 0, sizeof(ipi_pending));
+    memset(run_start_ns, 0, sizeof(run_start_ns));
+    memset(busy_ns, 0, sizeof(busy_ns));
+    memset(latency_hist, 0, sizeof(latency_hist));
+    memset(&enqueue_stats, 0, sizeof(enqueue_stats));
+    memset(&schedule_stats, 0, sizeof(schedule_stats));
+    memset(&tick_stats, 0, sizeof(tick_stats));
+    latency[0].count = 0;
+    latency[1].count = 0;
+    nr_events = 0;
+    event_seq = 0;
+    bursts_done = 0;
+    violations = 0;
+    sim_now_ns = 0;
+    sim_ncpus = ncpus;
+    rng_state = 0x2545F491u;
+
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+        per_cpu[cpu]->cpu_id = cpu;
+        per_cpu[cpu]->online = true;
+    }
+    sim_cpu = 0;
+    scheduler_init();
+    for (uint32_t cpu = 1; cpu < ncpus; cpu++) {
+        if (scheduler_init_cpu(cpu) < 0) {
+            printf("scheduler_init_cpu(%u) failed\n", (unsigned int)cpu);
+            exit(2);
+        }
+    }
+}
+
+static void sim_create_tasks(const struct workload* workload, uint32_t ntasks) {
+    free(sim_tasks);
+    sim_tasks = calloc(ntasks, sizeof(*sim_tasks));
+    if (!sim_tasks) {
+        perror("calloc");
+        exit(2);
+    }
+    sim_ntasks = ntasks;
+
+    // Every task asks for the same share: SIM_LOAD of all CPUs in total
+    double duty = SIM_LOAD * sim_ncpus / ntasks;
+    for (uint32_t i = 0; i < ntasks; i++) {
+        struct sim_task* st = &sim_tasks[i];
+        workload->setup(st, i);
+        snprintf(st->task.name, sizeof(st->task.name), "sim%u", (unsigned int)i);
+        st->task.task_id = i + 1;
+        st->task.base_priority = st->task.priority;
+        st->task.state = TASK_STATE_BLOCKED;
+        st->task.cpu = i % sim_ncpus;
+        st->sleep_mean_ns = (uint64_t)((double)st->burst_mean_ns * (1.0 / duty - 1.0));
+        st->remaining_ns = rng_around(st->burst_mean_ns);
+        event_push(rng_around(st->sleep_mean_ns) / 2, EV_WAKE, 0, st, 0);
+    }
+}
+
+// ========== Reporting ==========
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_latency(const char* name, struct latency_log* log) {
+    if (log->count == 0) {
+        return;
+    }
+    qsort(log->samples, log->count, sizeof(*log->samples), cmp_u64);
+    printf("    wake latency %-11s p50 %7.1f us, p99 %8.1f us, max %8.1f us (%zu wakeups)\n",
+           name, (double)log->samples[log->count / 2] / 1000.0,
+           (double)log->samples[log->count * 99 / 100] / 1000.0,
+           (double)log->samples[log->count - 1] / 1000.0, log->count);
+}
+
+static double mean_ns(const struct op_stats* stats) {
+    return stats->count ? (double)stats->total_ns / (double)stats->count : 0.0;
+}
+
+// Everything is either running, queued or asleep with a wakeup pending
+static void check_conservation(const struct workload* workload) {
+    uint32_t running = 0, queued = 0, blocked = 0, starved = 0;
+    uint32_t nr_ready = 0;
+
+    for (uint32_t cpu = 0; cpu < sim_ncpus; cpu++) {
+        nr_ready += per_cpu[cpu]->sched->nr_ready;
+        running += sim_of(per_cpu[cpu]->current_task) != NULL;
+    }
+    for (uint32_t i = 0; i < sim_ntasks; i++) {
+        const struct sim_task* st = &sim_tasks[i];
+        queued += st->task.on_rq;
+        blocked += st->task.state == TASK_STATE_BLOCKED;
+        if (st->woken_ns && sim_now_ns - st->woken_ns > SIM_STARVE_NS) {
+            starved++;
+        }
+    }
+
+    if (running + queued + blocked != sim_ntasks || queued != nr_ready) {
+        printf("    LOST tasks: %u running + %u queued + %u blocked of %u, nr_ready %u\n",
+               (unsigned int)running, (unsigned int)queued, (unsigned int)blocked,
+               (unsigned int)sim_ntasks, (unsigned int)nr_ready);
+        violations++;
+    }
+    // Below the busiest priorities, long waits are what strict priority means
+    if (starved) {
+        printf("    %s %u tasks (woken over %llu ms ago)\n",
+               workload->round_robin ? "STARVED" : "waiting", (unsigned int)starved,
+               (unsigned long long)(SIM_STARVE_NS / 1000000));
+        violations += workload->round_robin;
+    }
+}
+
+static void report(const struct workload* workload) {
+    uint64_t switches = 0, steals = 0, ipis = 0, busy = 0;
+    for (uint32_t cpu = 0; cpu < sim_ncpus; cpu++) {
+        const scheduler_t* rq = per_cpu[cpu]->sched;
+        switches += rq->context_switches;
+        steals += rq->steals;
+        ipis += per_cpu[cpu]->ipis_received;
+        busy += busy_ns[cpu];
+        if (per_cpu[cpu]->current_task != per_cpu[cpu]->idle_task) {
+            busy += sim_now_ns - run_start_ns[cpu];
+        }
+    }
+
+    printf("\n[%s] %u tasks, %u CPU%s\n", workload->name, (unsigned int)sim_ntasks,
+           (unsigned int)sim_ncpus, sim_ncpus > 1 ? "s" : "");
+    printf("    %.0f bursts/s, utilization %.1f%%, %llu switches, %llu steals, %llu IPIs\n",
+           (double)bursts_done * 1e9 / (double)sim_now_ns,
+           100.0 * (double)busy / ((double)sim_now_ns * sim_ncpus),
+           (unsigned long long)switches, (unsigned long long)steals,
+           (unsigned long long)ipis);
+    print_latency("interactive", &latency[1]);
+    print_latency(latency[1].count ? "other" : "all", &latency[0]);
+
+    printf("    latency histogram (us, log2):");
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        if (latency_hist[b]) {
+            printf(" %s%llu:%llu", b == HIST_BUCKETS - 1 ? ">=" : "",
+                   b ? 1ULL << b : 0ULL, (unsigned long long)latency_hist[b]);
+        }
+    }
+    printf("\n");
+    printf("    host ns: enqueue %.1f, schedule %.1f, tick %.1f\n",
+           mean_ns(&enqueue_stats), mean_ns(&schedule_stats), mean_ns(&tick_stats));
+}
+
+static void sim_run(const struct workload* workload, uint32_t ntasks, uint32_t ncpus) {
+    sim_reset(ncpus);
+    sim_create_tasks(workload, ntasks);
+
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+        sim_resched(cpu);   // Leave the bootstrap context
+        event_push(SIM_TICK_NS * (cpu + 1) / ncpus, EV_TICK, cpu, NULL, 0);
+    }
+
+    while (nr_events > 0 && events[0].time <= SIM_DURATION_NS) {
+        struct sim_event ev = event_pop();
+        sim_now_ns = ev.time;
+        switch (ev.type) {
+        case EV_TICK:
+            on_tick(ev.cpu);
+            break;
+        case EV_BURST_END:
+            on_burst_end(&ev);
+            break;
+        case EV_WAKE:
+            on_wake(ev.task);
+            break;
+        case EV_IPI:
+            on_ipi(ev.cpu);
+            break;
+        }
+    }
+    sim_now_ns = SIM_DURATION_NS;
+
+    report(workload);
+    check_conservation(workload);
+}
+
+static const uint32_t task_counts[] = { 1000, 16000 };
+static const uint32_t cpu_counts[] = { 1, 2, 4, 8 };
+
+int main(void) {
+    uint64_t failed = 0;
+    measure_clock_overhead();
+    printf("Scheduler simulation (%llu ms simulated per run, load %.0f%%, "
+           "clock overhead %llu ns subtracted)\n",
+           (unsigned long long)(SIM_DURATION_NS / 1000000), SIM_LOAD * 100,
+           (unsigned long long)clock_overhead_ns);
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        for (size_t n = 0; n < sizeof(task_counts) / sizeof(task_counts[0]); n++) {
+            for (size_t c = 0; c < sizeof(cpu_counts) / sizeof(cpu_counts[0]); c++) {
+                sim_run(&workloads[w], task_counts[n], cpu_counts[c]);
+                failed += violations;
+            }
+        }
+    }
+
+    if (failed) {
+        printf("\n%llu invariant violation(s)\n", (unsigned long long)failed);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * Host-side tests for the word-at-a-time string functions (lib/string.c)
+ *
+ * Validates:
+ * - strlen, strcmp, strncmp and memcmp agree with plain byte loops on
+ *   random data at every alignment, length and mismatch position
+ * - Strings that end at a page boundary are read without touching the
+ *   (inaccessible) next page
+ * - Rough speed against the byte loops (printed, never fails; the host
+ *   runner is built at -O0)
+ */
+
+#include "host_test.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// Pull the kernel versions in under their own names so they do not
+// replace the host C library's
+#define strlen  kstrlen
+#define strlcpy kstrlcpy
+#define strlcat kstrlcat
+#define strcmp  kstrcmp
+#define strncmp kstrncmp
+#define memcmp  kmemcmp
+#include "../lib/string.c"
+#undef strlen
+#undef strlcpy
+#undef strlcat
+#undef strcmp
+#undef strncmp
+#undef memcmp
+
+// ========== Byte-at-a-time references ==========
+
+static size_t ref_strlen(const char* s) {
+    size_t n = 0;
+    while (s[n]) {
+        n++;
+    }
+    return n;
+}
+
+static int ref_strcmp(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *(const unsigned char*)a - *(const unsigned char*)b;
+}
+
+static int ref_strncmp(const char* a, const char* b, size_t n) {
+    while (n && *a && *a == *b) {
+        a++;
+        b++;
+        n--;
+    }
+    return n ? *(const unsigned char*)a - *(const unsigned char*)b : 0;
+}
+
+static int ref_memcmp(const void* a, const void* b, size_t n) {
+    const unsigned char* p = a;
+    const unsigned char* q = b;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] != q[i]) {
+            return p[i] - q[i];
+        }
+    }
+    return 0;
+}
+
+static int sign(int v) {
+    return (v > 0) - (v < 0);
+}
+
+// Random non-NUL byte, biased towards a few values so strings collide
+static char rand_char(void) {
+    return (char)(rand() % 4 ? 'a' + rand() % 3 : 1 + rand() % 255);
+}
+
+// ========== Equivalence ==========
+
+TEST(string_word_equivalence) {
+    static char a[256];
+    static char b[256];
+    srand(42);
+
+    for (int iter = 0; iter < 200000; iter++) {
+        size_t off_a = rand() % 8;
+        size_t off_b = rand() % 2 ? off_a : (size_t)(rand() % 8);
+        size_t len = rand() % 64;
+        for (size_t i = 0; i < len; i++) {
+            a[off_a + i] = rand_char();
+            b[off_b + i] = a[off_a + i];
+        }
+        a[off_a + len] = '\0';
+        b[off_b + len] = '\0';
+
+        // Optionally make b differ at one position (or be shorter)
+        if (rand() % 2 && len > 0) {
+            size_t at = rand() % len;
+            b[off_b + at] = rand() % 8 ? rand_char() : '\0';
+        }
+        // Junk after the terminators must not matter
+        for (size_t i = len + 1; i < len + 8; i++) {
+            a[off_a + i] = (char)rand();
+            b[off_b + i] = (char)rand();
+        }
+
+        const char* sa = a + off_a;
+        const char* sb = b + off_b;
+        size_t n = rand() % 72;
+
+        TEST_ASSERT_EQ(kstrlen(sa), ref_strlen(sa), "strlen");
+        TEST_ASSERT_EQ(kstrlen(sb), ref_strlen(sb), "strlen (b)");
+        TEST_ASSERT_EQ(sign(kstrcmp(sa, sb)), sign(ref_strcmp(sa, sb)), "strcmp");
+        TEST_ASSERT_EQ(sign(kstrncmp(sa, sb, n)), sign(ref_strncmp(sa, sb, n)), "strncmp");
+        TEST_ASSERT_EQ(sign(kmemcmp(sa, sb, n)), sign(ref_memcmp(sa, sb, n)), "memcmp");
+    }
+    return 1;
+}
+
+TEST(string_word_high_bytes) {
+    // Bytes >= 0x80 must compare as unsigned, also inside a word
+    static const char x[] __attribute__((aligned(4))) = "abc\x80xyz";
+    static const char y[] __attribute__((aligned(4))) = "abc\x7fxyz";
+    TEST_ASSERT(kstrcmp(x, y) > 0, "0x80 > 0x7f");
+    TEST_ASSERT(kmemcmp(x, y, 8) > 0, "memcmp unsigned");
+    TEST_ASSERT(kstrncmp(x, y, 3) == 0, "strncmp stops before the difference");
+    TEST_ASSERT_EQ(kstrlen("\x80\x80\x80\x80\x80"), 5, "high bytes are not terminators");
+    return 1;
+}
+
+// ========== Page boundary ==========
+
+TEST(string_word_page_end) {
+    long page = sysconf(_SC_PAGESIZE);
+    char* map = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    TEST_ASSERT(map != MAP_FAILED, "mmap");
+    TEST_ASSERT(mprotect(map + page, page, PROT_NONE) == 0, "guard page");
+
+    // Strings of every short length whose NUL is the page's last byte;
+    // any read past it faults
+    char* end = map + page;
+    for (size_t len = 0; len < 12; len++) {
+        char* s = end - len - 1;
+        memset(s, 'q', len);
+        s[len] = '\0';
+        TEST_ASSERT_EQ(kstrlen(s), len, "strlen at page end");
+        TEST_ASSERT(kstrcmp(s, s) == 0, "strcmp at page end");
+        TEST_ASSERT(kstrncmp(s, s, 64) == 0, "strncmp at page end");
+        TEST_ASSERT(kmemcmp(s, s, len + 1) == 0, "memcmp up to page end");
+    }
+
+    munmap(map, 2 * page);
+    return 1;
+}
+
+// ========== Benchmark ==========
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+TEST(string_word_bench) {
+    static char a[4096] __attribute__((aligned(4)));
+    static char b[4096] __attribute__((aligned(4)));
+    memset(a, 'x', sizeof(a) - 1);
+    memset(b, 'x', sizeof(b) - 1);
+    enum { ROUNDS = 2000 };
+    volatile long sink = 0;
+
+    double t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += ref_strlen(a) + ref_strcmp(a, b) + ref_memcmp(a, b, sizeof(a));
+    }
+    double t1 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += kstrlen(a) + kstrcmp(a, b) + kmemcmp(a, b, sizeof(a));
+    }
+    double t2 = now_ns();
+    (void)sink;
+
+    printf("\n    4KB strlen+strcmp+memcmp: byte %.0f ns, word %.0f ns (%.1fx) ",
+           (t1 - t0) / ROUNDS, (t2 - t1) / ROUNDS, (t1 - t0) / (t2 - t1));
+    return 1;
+}